@@ -0,0 +1,43 @@
+# - Try to find cuFile (GPUDirect Storage)
+# Once done this will define
+#  CUFILE_FOUND - System has cuFile
+#  CUFILE_INCLUDE_DIRS - The cuFile include directories
+#  CUFILE_LIBRARIES - The libraries needed to use cuFile
+
+FIND_PATH(WITH_CUFILE_PREFIX
+    NAMES include/cufile.h
+)
+
+FIND_LIBRARY(CUFILE_LIBRARIES
+    NAMES cufile
+    HINTS ${WITH_CUFILE_PREFIX}/lib64 ${WITH_CUFILE_PREFIX}/lib
+)
+
+# the host staging fallback copies through the CUDA runtime
+FIND_LIBRARY(CUDART_LIBRARIES
+    NAMES cudart
+    HINTS ${WITH_CUFILE_PREFIX}/lib64 ${WITH_CUFILE_PREFIX}/lib
+)
+
+FIND_PATH(CUFILE_INCLUDE_DIRS
+    NAMES cufile.h
+    HINTS ${WITH_CUFILE_PREFIX}/include
+)
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(CUFILE DEFAULT_MSG
+    CUFILE_LIBRARIES
+    CUDART_LIBRARIES
+    CUFILE_INCLUDE_DIRS
+)
+
+IF(CUFILE_FOUND)
+    LIST(APPEND CUFILE_LIBRARIES ${CUDART_LIBRARIES})
+ENDIF(CUFILE_FOUND)
+
+# Hide these vars from ccmake GUI
+MARK_AS_ADVANCED(
+	CUFILE_LIBRARIES
+	CUDART_LIBRARIES
+	CUFILE_INCLUDE_DIRS
+)
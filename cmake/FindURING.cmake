@@ -0,0 +1,31 @@
+# - Try to find liburing
+# Once done this will define
+#  URING_FOUND - System has liburing
+#  URING_INCLUDE_DIRS - The liburing include directories
+#  URING_LIBRARIES - The libraries needed to use liburing
+
+FIND_PATH(WITH_URING_PREFIX
+    NAMES include/liburing.h
+)
+
+FIND_LIBRARY(URING_LIBRARIES
+    NAMES uring
+    HINTS ${WITH_URING_PREFIX}/lib
+)
+
+FIND_PATH(URING_INCLUDE_DIRS
+    NAMES liburing.h
+    HINTS ${WITH_URING_PREFIX}/include
+)
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(URING DEFAULT_MSG
+    URING_LIBRARIES
+    URING_INCLUDE_DIRS
+)
+
+# Hide these vars from ccmake GUI
+MARK_AS_ADVANCED(
+	URING_LIBRARIES
+	URING_INCLUDE_DIRS
+)
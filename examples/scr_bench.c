@@ -0,0 +1,448 @@
+#define _GNU_SOURCE 1
+
+/* Checkpoint bandwidth benchmark for SCR.
+ *
+ * Sweeps file size and files-per-rank within a single run and reports
+ * per-phase bandwidth and latency percentiles as machine-readable CSV
+ * on stdout (rank 0 only, status messages go to stderr).  Redundancy
+ * scheme, cache bypass, and flush mode are fixed at SCR_Init, so each
+ * invocation covers one such cell, use scr_bench.sh to sweep them
+ * across runs into a single CSV.
+ *
+ * Example:
+ *   srun -n 32 ./scr_bench --sizes 1m,64m --files 1,4 --times 10 \
+ *        --type XOR --bypass 0 --flush sync > scr_bench.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "mpi.h"
+
+#include "scr.h"
+
+/* maximum number of values in a --sizes or --files list */
+#define BENCH_MAX_LIST (16)
+
+static int rank  = -1;
+static int ranks = 0;
+
+static size_t sizes[BENCH_MAX_LIST] = {1024*1024};
+static int num_sizes = 1;
+
+static int files[BENCH_MAX_LIST] = {1};
+static int num_files = 1;
+
+static int times = 5;
+static int header = 1;
+
+static const char* copy_type  = "XOR";
+static int         bypass     = 0;
+static const char* flush_mode = "sync";
+
+static int timestep = 0;
+
+/* parse a byte count like "64m" or "1gb", returns 0 on failure */
+static size_t parse_size(const char* str)
+{
+  char* next = NULL;
+  double num = strtod(str, &next);
+  if (next == str || num <= 0) {
+    return 0;
+  }
+
+  unsigned long long units = 1;
+  switch (*next) {
+  case '\0':
+    break;
+  case 'k': case 'K':
+    units = 1024ULL;
+    next++;
+    break;
+  case 'm': case 'M':
+    units = 1024ULL*1024;
+    next++;
+    break;
+  case 'g': case 'G':
+    units = 1024ULL*1024*1024;
+    next++;
+    break;
+  default:
+    return 0;
+  }
+  if (*next == 'b' || *next == 'B') {
+    next++;
+  }
+  if (*next != '\0') {
+    return 0;
+  }
+
+  return (size_t) (num * (double) units);
+}
+
+/* parse a comma-separated list of byte counts, returns count or 0 */
+static int parse_size_list(char* str, size_t* vals, int max)
+{
+  int count = 0;
+  char* item = strtok(str, ",");
+  while (item != NULL && count < max) {
+    size_t v = parse_size(item);
+    if (v == 0) {
+      return 0;
+    }
+    vals[count++] = v;
+    item = strtok(NULL, ",");
+  }
+  return count;
+}
+
+/* parse a comma-separated list of positive integers, returns count or 0 */
+static int parse_int_list(char* str, int* vals, int max)
+{
+  int count = 0;
+  char* item = strtok(str, ",");
+  while (item != NULL && count < max) {
+    int v = atoi(item);
+    if (v < 1) {
+      return 0;
+    }
+    vals[count++] = v;
+    item = strtok(NULL, ",");
+  }
+  return count;
+}
+
+/* fill buffer with a simple pattern so writes aren't all zero pages */
+static void fill_buffer(char* buf, size_t size)
+{
+  size_t i;
+  for (i = 0; i < size; i++) {
+    buf[i] = (char) ((i + (size_t) rank + (size_t) timestep) & 0xFF);
+  }
+}
+
+/* write size bytes from buf to fd, returns 0 on success */
+static int write_file(int fd, const char* buf, size_t size)
+{
+  size_t written = 0;
+  while (written < size) {
+    ssize_t rc = write(fd, buf + written, size - written);
+    if (rc < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return 1;
+    }
+    written += (size_t) rc;
+  }
+  return 0;
+}
+
+/* compare doubles for qsort */
+static int compare_double(const void* a, const void* b)
+{
+  double da = *(const double*) a;
+  double db = *(const double*) b;
+  if (da < db) { return -1; }
+  if (da > db) { return  1; }
+  return 0;
+}
+
+/* return the p-th percentile of a sorted array of n doubles */
+static double percentile(const double* sorted, int n, double p)
+{
+  int idx = (int) (p * (double) (n - 1) + 0.5);
+  return sorted[idx];
+}
+
+/* run one benchmark cell: times checkpoints of nfiles files of size
+ * bytes per rank, prints one CSV row from rank 0 when report is set */
+static int bench_cell(size_t size, int nfiles, int report)
+{
+  char* buf = (char*) malloc(size);
+  if (buf == NULL) {
+    fprintf(stderr, "scr_bench: %d: Failed to allocate %lu byte buffer @ %s:%d\n",
+      rank, (unsigned long) size, __FILE__, __LINE__
+    );
+    return 1;
+  }
+
+  double* start_secs    = (double*) malloc(sizeof(double) * times);
+  double* write_secs    = (double*) malloc(sizeof(double) * times);
+  double* complete_secs = (double*) malloc(sizeof(double) * times);
+  double* total_secs    = (double*) malloc(sizeof(double) * times);
+
+  int failed = 0;
+  int iter;
+  for (iter = 0; iter < times; iter++) {
+    fill_buffer(buf, size);
+
+    char label[SCR_MAX_FILENAME];
+    sprintf(label, "bench.%d", timestep);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+
+    /* start the dataset */
+    if (SCR_Start_output(label, SCR_FLAG_CHECKPOINT) != SCR_SUCCESS) {
+      fprintf(stderr, "scr_bench: %d: SCR_Start_output failed @ %s:%d\n",
+        rank, __FILE__, __LINE__
+      );
+      failed = 1;
+    }
+    double t1 = MPI_Wtime();
+
+    /* write our files */
+    int valid = 1;
+    int f;
+    for (f = 0; f < nfiles; f++) {
+      char name[SCR_MAX_FILENAME];
+      sprintf(name, "%s/rank_%d.%d.ckpt", label, rank, f);
+
+      char file[SCR_MAX_FILENAME];
+      if (SCR_Route_file(name, file) != SCR_SUCCESS) {
+        fprintf(stderr, "scr_bench: %d: SCR_Route_file failed for %s @ %s:%d\n",
+          rank, name, __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+
+      int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+      if (fd < 0) {
+        fprintf(stderr, "scr_bench: %d: Failed to open %s errno=%d %s @ %s:%d\n",
+          rank, file, errno, strerror(errno), __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+      if (write_file(fd, buf, size) != 0) {
+        fprintf(stderr, "scr_bench: %d: Failed to write %s @ %s:%d\n",
+          rank, file, __FILE__, __LINE__
+        );
+        valid = 0;
+      }
+      fsync(fd);
+      close(fd);
+    }
+    double t2 = MPI_Wtime();
+
+    /* complete the dataset, this includes redundancy encoding and,
+     * depending on the flush mode, the flush itself */
+    if (SCR_Complete_output(valid) != SCR_SUCCESS) {
+      fprintf(stderr, "scr_bench: %d: SCR_Complete_output failed @ %s:%d\n",
+        rank, __FILE__, __LINE__
+      );
+      failed = 1;
+    }
+    double t3 = MPI_Wtime();
+
+    /* take the slowest rank for each phase, that's the time the
+     * application actually pays */
+    double phase[4] = {t1 - t0, t2 - t1, t3 - t2, t3 - t0};
+    double phase_max[4];
+    MPI_Allreduce(phase, phase_max, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    start_secs[iter]    = phase_max[0];
+    write_secs[iter]    = phase_max[1];
+    complete_secs[iter] = phase_max[2];
+    total_secs[iter]    = phase_max[3];
+
+    timestep++;
+  }
+
+  if (rank == 0 && report && !failed) {
+    /* aggregate data moved per checkpoint in MB */
+    double agg_mb = (double) size * nfiles * ranks / (1024.0 * 1024.0);
+
+    /* bandwidths from median iteration times */
+    qsort(start_secs,    times, sizeof(double), compare_double);
+    qsort(write_secs,    times, sizeof(double), compare_double);
+    qsort(complete_secs, times, sizeof(double), compare_double);
+    qsort(total_secs,    times, sizeof(double), compare_double);
+
+    double write_bw = agg_mb / percentile(write_secs, times, 0.50);
+    double total_bw = agg_mb / percentile(total_secs, times, 0.50);
+
+    printf("%d,%s,%d,%s,%lu,%d,%d,%.2f,%.2f,%.2f,"
+           "%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+      ranks, copy_type, bypass, flush_mode,
+      (unsigned long) size, nfiles, times,
+      agg_mb, write_bw, total_bw,
+      percentile(start_secs,    times, 0.50),
+      percentile(start_secs,    times, 1.00),
+      percentile(write_secs,    times, 0.50),
+      percentile(write_secs,    times, 1.00),
+      percentile(complete_secs, times, 0.50),
+      percentile(complete_secs, times, 1.00),
+      percentile(total_secs,    times, 0.50),
+      percentile(total_secs,    times, 0.90),
+      percentile(total_secs,    times, 1.00)
+    );
+    fflush(stdout);
+  }
+
+  free(total_secs);
+  free(complete_secs);
+  free(write_secs);
+  free(start_secs);
+  free(buf);
+
+  return failed;
+}
+
+void print_usage()
+{
+  printf("\n");
+  printf("  Usage: scr_bench [options]\n");
+  printf("\n");
+  printf("  Options:\n");
+  printf("    -s, --sizes=<LIST>   Comma-separated file sizes, e.g., 1m,64m (default 1m)\n");
+  printf("    -n, --files=<LIST>   Comma-separated files per rank, e.g., 1,4 (default 1)\n");
+  printf("    -t, --times=<COUNT>  Checkpoints per cell (default %d)\n", times);
+  printf("    -T, --type=<TYPE>    Redundancy: SINGLE, PARTNER, XOR, or RS (default %s)\n", copy_type);
+  printf("    -b, --bypass=<0|1>   Write direct to file system, skipping cache (default %d)\n", bypass);
+  printf("    -F, --flush=<MODE>   Flush mode: none, sync, or async (default %s)\n", flush_mode);
+  printf("    -H, --no-header      Omit the CSV header line, for appending to a file\n");
+  printf("    -h, --help           Print usage\n");
+  printf("\n");
+  return;
+}
+
+int main (int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+  static const char *opt_string = "s:n:t:T:b:F:Hh";
+  static struct option long_options[] = {
+    {"sizes",     required_argument, NULL, 's'},
+    {"files",     required_argument, NULL, 'n'},
+    {"times",     required_argument, NULL, 't'},
+    {"type",      required_argument, NULL, 'T'},
+    {"bypass",    required_argument, NULL, 'b'},
+    {"flush",     required_argument, NULL, 'F'},
+    {"no-header", no_argument,       NULL, 'H'},
+    {"help",      no_argument,       NULL, 'h'},
+    {NULL,        no_argument,       NULL,   0}
+  };
+
+  int usage = 0;
+  int long_index = 0;
+  int opt = getopt_long(argc, argv, opt_string, long_options, &long_index);
+  while (opt != -1) {
+    switch(opt) {
+      case 's':
+        num_sizes = parse_size_list(optarg, sizes, BENCH_MAX_LIST);
+        if (num_sizes == 0) {
+          usage = 1;
+        }
+        break;
+      case 'n':
+        num_files = parse_int_list(optarg, files, BENCH_MAX_LIST);
+        if (num_files == 0) {
+          usage = 1;
+        }
+        break;
+      case 't':
+        times = atoi(optarg);
+        if (times < 1) {
+          usage = 1;
+        }
+        break;
+      case 'T':
+        copy_type = strdup(optarg);
+        break;
+      case 'b':
+        bypass = atoi(optarg);
+        break;
+      case 'F':
+        flush_mode = strdup(optarg);
+        break;
+      case 'H':
+        header = 0;
+        break;
+      case 'h':
+      default:
+        usage = 1;
+        break;
+    }
+
+    /* get the next option */
+    opt = getopt_long(argc, argv, opt_string, long_options, &long_index);
+  }
+
+  if (strcmp(flush_mode, "none")  != 0 &&
+      strcmp(flush_mode, "sync")  != 0 &&
+      strcmp(flush_mode, "async") != 0)
+  {
+    usage = 1;
+  }
+
+  if (usage) {
+    if (rank == 0) {
+      print_usage();
+    }
+    MPI_Finalize();
+    return 1;
+  }
+
+  /* apply this cell's configuration before init,
+   * these can't change without reinitializing the library */
+  SCR_Configf("SCR_COPY_TYPE=%s", copy_type);
+  SCR_Configf("SCR_CACHE_BYPASS=%d", bypass);
+  if (strcmp(flush_mode, "none") == 0) {
+    SCR_Config("SCR_FLUSH=0");
+  } else {
+    SCR_Config("SCR_FLUSH=1");
+    SCR_Configf("SCR_FLUSH_ASYNC=%d", strcmp(flush_mode, "async") == 0 ? 1 : 0);
+  }
+
+  if (SCR_Init() != SCR_SUCCESS) {
+    fprintf(stderr, "scr_bench: Failed initializing SCR\n");
+    MPI_Finalize();
+    return 1;
+  }
+
+  if (rank == 0 && header) {
+    printf("ranks,copy_type,bypass,flush,size_bytes,files_per_rank,iters,"
+           "agg_mb,write_bw_mbs,total_bw_mbs,"
+           "start_p50_s,start_max_s,write_p50_s,write_max_s,"
+           "complete_p50_s,complete_max_s,"
+           "total_p50_s,total_p90_s,total_max_s\n");
+    fflush(stdout);
+  }
+
+  /* prime the system with a single untimed checkpoint */
+  int times_save = times;
+  times = 1;
+  bench_cell(sizes[0], files[0], 0);
+  times = times_save;
+
+  /* sweep the cells */
+  int rc = 0;
+  int si, fi;
+  for (si = 0; si < num_sizes; si++) {
+    for (fi = 0; fi < num_files; fi++) {
+      if (rank == 0) {
+        fprintf(stderr, "scr_bench: size %lu bytes, %d files per rank, %d iterations\n",
+          (unsigned long) sizes[si], files[fi], times
+        );
+      }
+      rc |= bench_cell(sizes[si], files[fi], 1);
+    }
+  }
+
+  SCR_Finalize();
+  MPI_Finalize();
+
+  return rc;
+}
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Sweep driver for scr_bench.
+#
+# Runs scr_bench once per (redundancy type, bypass, flush mode) cell,
+# since those are fixed at SCR_Init, and appends all rows to a single
+# CSV so results are comparable across sites.  File size and files per
+# rank are swept inside each run.
+#
+# Configure through the environment:
+#   SCR_BENCH_LAUNCH  launcher command (default: srun -n 4)
+#   SCR_BENCH_SIZES   file sizes to sweep (default: 1m,16m,64m)
+#   SCR_BENCH_FILES   files per rank to sweep (default: 1,4)
+#   SCR_BENCH_TIMES   checkpoints per cell (default: 5)
+#   SCR_BENCH_TYPES   redundancy types (default: SINGLE PARTNER XOR RS)
+#   SCR_BENCH_OUT     output CSV file (default: scr_bench.csv)
+
+LAUNCH=${SCR_BENCH_LAUNCH:-"srun -n 4"}
+SIZES=${SCR_BENCH_SIZES:-"1m,16m,64m"}
+FILES=${SCR_BENCH_FILES:-"1,4"}
+TIMES=${SCR_BENCH_TIMES:-5}
+TYPES=${SCR_BENCH_TYPES:-"SINGLE PARTNER XOR RS"}
+OUT=${SCR_BENCH_OUT:-scr_bench.csv}
+
+bench=./scr_bench
+if [ ! -x "$bench" ]; then
+  echo "scr_bench.sh: ERROR: $bench not found, run from the examples build directory" 1>&2
+  exit 1
+fi
+
+rm -f "$OUT"
+
+header=""
+for type in $TYPES; do
+  for bypass in 0 1; do
+    for flush in none sync async; do
+      echo "scr_bench.sh: type=$type bypass=$bypass flush=$flush" 1>&2
+      $LAUNCH $bench --sizes "$SIZES" --files "$FILES" --times "$TIMES" \
+        --type "$type" --bypass "$bypass" --flush "$flush" $header >> "$OUT"
+      if [ $? -ne 0 ]; then
+        echo "scr_bench.sh: ERROR: cell type=$type bypass=$bypass flush=$flush failed" 1>&2
+      fi
+      header="--no-header"
+    done
+  done
+done
+
+echo "scr_bench.sh: results in $OUT" 1>&2
@@ -0,0 +1,446 @@
+#define _GNU_SOURCE 1
+
+/* Synthetic checkpoint workload generator for SCR.
+ *
+ * Unlike test_api, which writes one uniform file per rank, this tool
+ * draws per-file sizes from a distribution so runs look like the
+ * production mix of tiny metadata files next to large field dumps.
+ * Each rank writes --count files per checkpoint with sizes drawn from
+ * --dist (lognormal, uniform, or fixed) around --median, clamped to
+ * [--min, --max].  Per checkpoint, a --dirty fraction of the files is
+ * rewritten with fresh contents while the rest are rewritten with
+ * identical bytes, which matters for any change detection downstream.
+ *
+ * Sizes are drawn from a seeded generator, so two sites running the
+ * same spec produce the same file mix.
+ *
+ * Example, 64 files per rank, log-normal around 4 MB with heavy tails
+ * clamped to [1 KB, 1 GB], a quarter of files dirty per checkpoint:
+ *   srun -n 32 ./scr_loadgen --count 64 --median 4m --sigma 1.5 \
+ *        --min 1k --max 1g --dirty 0.25 --times 10
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+
+#include "mpi.h"
+
+#include "scr.h"
+
+static int rank  = -1;
+static int ranks = 0;
+
+/* distribution kinds for file sizes */
+#define DIST_LOGNORMAL (0)
+#define DIST_UNIFORM   (1)
+#define DIST_FIXED     (2)
+
+static int    count    = 16;             /* files per rank */
+static int    dist     = DIST_LOGNORMAL; /* file size distribution */
+static size_t median   = 1024*1024;      /* median (or fixed) file size */
+static double sigma    = 1.5;            /* log-normal shape parameter */
+static size_t min_size = 1024;           /* smallest file size */
+static size_t max_size = 1024*1024*1024; /* largest file size */
+static double dirty    = 1.0;            /* fraction of files rewritten with new data */
+static int    times    = 5;              /* number of checkpoints to write */
+static unsigned int seed = 1;            /* base random seed */
+
+static int timestep = 0;
+
+/* parse a byte count like "64m" or "1gb", returns 0 on failure */
+static size_t parse_size(const char* str)
+{
+  char* next = NULL;
+  double num = strtod(str, &next);
+  if (next == str || num <= 0) {
+    return 0;
+  }
+
+  unsigned long long units = 1;
+  switch (*next) {
+  case '\0':
+    break;
+  case 'k': case 'K':
+    units = 1024ULL;
+    next++;
+    break;
+  case 'm': case 'M':
+    units = 1024ULL*1024;
+    next++;
+    break;
+  case 'g': case 'G':
+    units = 1024ULL*1024*1024;
+    next++;
+    break;
+  default:
+    return 0;
+  }
+  if (*next == 'b' || *next == 'B') {
+    next++;
+  }
+  if (*next != '\0') {
+    return 0;
+  }
+
+  return (size_t) (num * (double) units);
+}
+
+/* uniform double in (0,1), never returns 0 so log() below is safe */
+static double rand_unit(unsigned int* state)
+{
+  return ((double) rand_r(state) + 1.0) / ((double) RAND_MAX + 2.0);
+}
+
+/* standard normal deviate via Box-Muller */
+static double rand_normal(unsigned int* state)
+{
+  double u1 = rand_unit(state);
+  double u2 = rand_unit(state);
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* draw one file size from the configured distribution */
+static size_t draw_size(unsigned int* state)
+{
+  double size;
+  switch (dist) {
+  case DIST_LOGNORMAL:
+    /* median * exp(sigma * N(0,1)), the classic heavy-tailed file
+     * size model, most files land near the median with rare files
+     * orders of magnitude larger or smaller */
+    size = (double) median * exp(sigma * rand_normal(state));
+    break;
+  case DIST_UNIFORM:
+    size = (double) min_size +
+      rand_unit(state) * ((double) max_size - (double) min_size);
+    break;
+  case DIST_FIXED:
+  default:
+    size = (double) median;
+    break;
+  }
+
+  if (size < (double) min_size) { size = (double) min_size; }
+  if (size > (double) max_size) { size = (double) max_size; }
+  return (size_t) size;
+}
+
+/* fill buffer with data derived from val */
+static void fill_buffer(char* buf, size_t size, unsigned int val)
+{
+  size_t i;
+  for (i = 0; i < size; i++) {
+    buf[i] = (char) ((i + (size_t) val) & 0xFF);
+  }
+}
+
+/* write size bytes from buf to fd, returns 0 on success */
+static int write_file(int fd, const char* buf, size_t size)
+{
+  size_t written = 0;
+  while (written < size) {
+    ssize_t rc = write(fd, buf + written, size - written);
+    if (rc < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return 1;
+    }
+    written += (size_t) rc;
+  }
+  return 0;
+}
+
+/* compare sizes for qsort */
+static int compare_size(const void* a, const void* b)
+{
+  size_t sa = *(const size_t*) a;
+  size_t sb = *(const size_t*) b;
+  if (sa < sb) { return -1; }
+  if (sa > sb) { return  1; }
+  return 0;
+}
+
+void print_usage()
+{
+  printf("\n");
+  printf("  Usage: scr_loadgen [options]\n");
+  printf("\n");
+  printf("  Options:\n");
+  printf("    -c, --count=<N>      Files per rank (default %d)\n", count);
+  printf("    -d, --dist=<KIND>    Size distribution: lognormal, uniform, or fixed (default lognormal)\n");
+  printf("    -m, --median=<SIZE>  Median (or fixed) file size, e.g., 4m (default 1m)\n");
+  printf("    -g, --sigma=<S>      Log-normal shape parameter (default %.1f)\n", sigma);
+  printf("    -l, --min=<SIZE>     Smallest file size (default 1k)\n");
+  printf("    -u, --max=<SIZE>     Largest file size (default 1g)\n");
+  printf("    -f, --dirty=<FRAC>   Fraction of files rewritten with new data per checkpoint (default %.2f)\n", dirty);
+  printf("    -t, --times=<COUNT>  Number of checkpoints to write (default %d)\n", times);
+  printf("    -S, --seed=<N>       Base random seed (default %u)\n", seed);
+  printf("    -h, --help           Print usage\n");
+  printf("\n");
+  return;
+}
+
+int main (int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+  static const char *opt_string = "c:d:m:g:l:u:f:t:S:h";
+  static struct option long_options[] = {
+    {"count",  required_argument, NULL, 'c'},
+    {"dist",   required_argument, NULL, 'd'},
+    {"median", required_argument, NULL, 'm'},
+    {"sigma",  required_argument, NULL, 'g'},
+    {"min",    required_argument, NULL, 'l'},
+    {"max",    required_argument, NULL, 'u'},
+    {"dirty",  required_argument, NULL, 'f'},
+    {"times",  required_argument, NULL, 't'},
+    {"seed",   required_argument, NULL, 'S'},
+    {"help",   no_argument,       NULL, 'h'},
+    {NULL,     no_argument,       NULL,   0}
+  };
+
+  int usage = 0;
+  int long_index = 0;
+  int opt = getopt_long(argc, argv, opt_string, long_options, &long_index);
+  while (opt != -1) {
+    switch(opt) {
+      case 'c':
+        count = atoi(optarg);
+        if (count < 1) {
+          usage = 1;
+        }
+        break;
+      case 'd':
+        if (strcmp(optarg, "lognormal") == 0) {
+          dist = DIST_LOGNORMAL;
+        } else if (strcmp(optarg, "uniform") == 0) {
+          dist = DIST_UNIFORM;
+        } else if (strcmp(optarg, "fixed") == 0) {
+          dist = DIST_FIXED;
+        } else {
+          usage = 1;
+        }
+        break;
+      case 'm':
+        median = parse_size(optarg);
+        if (median == 0) {
+          usage = 1;
+        }
+        break;
+      case 'g':
+        sigma = atof(optarg);
+        if (sigma < 0) {
+          usage = 1;
+        }
+        break;
+      case 'l':
+        min_size = parse_size(optarg);
+        if (min_size == 0) {
+          usage = 1;
+        }
+        break;
+      case 'u':
+        max_size = parse_size(optarg);
+        if (max_size == 0) {
+          usage = 1;
+        }
+        break;
+      case 'f':
+        dirty = atof(optarg);
+        if (dirty < 0.0 || dirty > 1.0) {
+          usage = 1;
+        }
+        break;
+      case 't':
+        times = atoi(optarg);
+        if (times < 1) {
+          usage = 1;
+        }
+        break;
+      case 'S':
+        seed = (unsigned int) atoi(optarg);
+        break;
+      case 'h':
+      default:
+        usage = 1;
+        break;
+    }
+
+    /* get the next option */
+    opt = getopt_long(argc, argv, opt_string, long_options, &long_index);
+  }
+
+  if (min_size > max_size) {
+    usage = 1;
+  }
+
+  if (usage) {
+    if (rank == 0) {
+      print_usage();
+    }
+    MPI_Finalize();
+    return 1;
+  }
+
+  if (SCR_Init() != SCR_SUCCESS) {
+    fprintf(stderr, "scr_loadgen: Failed initializing SCR\n");
+    MPI_Finalize();
+    return 1;
+  }
+
+  /* draw this rank's file sizes, the generator is seeded from the
+   * rank so the mix is reproducible across runs and sites */
+  unsigned int size_state = seed * 1000003u + (unsigned int) rank;
+  size_t* sizes = (size_t*) malloc(sizeof(size_t) * count);
+  size_t biggest = 0;
+  size_t rank_bytes = 0;
+  int f;
+  for (f = 0; f < count; f++) {
+    sizes[f] = draw_size(&size_state);
+    rank_bytes += sizes[f];
+    if (sizes[f] > biggest) {
+      biggest = sizes[f];
+    }
+  }
+
+  /* one buffer large enough for the biggest file */
+  char* buf = (char*) malloc(biggest);
+  if (buf == NULL) {
+    fprintf(stderr, "scr_loadgen: %d: Failed to allocate %lu byte buffer @ %s:%d\n",
+      rank, (unsigned long) biggest, __FILE__, __LINE__
+    );
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  /* per-file content version, bumped when a file goes dirty */
+  unsigned int* versions = (unsigned int*) malloc(sizeof(unsigned int) * count);
+  for (f = 0; f < count; f++) {
+    versions[f] = (unsigned int) rank;
+  }
+
+  /* print the mix we're about to write */
+  double total_gb;
+  double rank_gb = (double) rank_bytes / (1024.0*1024.0*1024.0);
+  MPI_Reduce(&rank_gb, &total_gb, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  if (rank == 0) {
+    size_t* sorted = (size_t*) malloc(sizeof(size_t) * count);
+    memcpy(sorted, sizes, sizeof(size_t) * count);
+    qsort(sorted, count, sizeof(size_t), compare_size);
+    printf("scr_loadgen: %d ranks x %d files, %.2f GB per checkpoint\n",
+      ranks, count, total_gb
+    );
+    printf("scr_loadgen: rank 0 sizes: min %lu B, median %lu B, max %lu B\n",
+      (unsigned long) sorted[0],
+      (unsigned long) sorted[count / 2],
+      (unsigned long) sorted[count - 1]
+    );
+    fflush(stdout);
+    free(sorted);
+  }
+
+  /* separate stream for dirty decisions so the size mix above is
+   * unaffected by the dirty fraction */
+  unsigned int dirty_state = seed * 2000003u + (unsigned int) rank;
+
+  /* write the checkpoints */
+  int rc = 0;
+  int iter;
+  for (iter = 0; iter < times; iter++) {
+    /* mark a fraction of files dirty with fresh contents */
+    int ndirty = 0;
+    for (f = 0; f < count; f++) {
+      if (rand_unit(&dirty_state) < dirty) {
+        versions[f] += 1000u;
+        ndirty++;
+      }
+    }
+
+    char label[SCR_MAX_FILENAME];
+    sprintf(label, "loadgen.%d", timestep);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+
+    if (SCR_Start_output(label, SCR_FLAG_CHECKPOINT) != SCR_SUCCESS) {
+      fprintf(stderr, "scr_loadgen: %d: SCR_Start_output failed @ %s:%d\n",
+        rank, __FILE__, __LINE__
+      );
+      rc = 1;
+    }
+
+    int valid = 1;
+    for (f = 0; f < count; f++) {
+      char name[SCR_MAX_FILENAME];
+      sprintf(name, "%s/rank_%d.%d.ckpt", label, rank, f);
+
+      char file[SCR_MAX_FILENAME];
+      if (SCR_Route_file(name, file) != SCR_SUCCESS) {
+        fprintf(stderr, "scr_loadgen: %d: SCR_Route_file failed for %s @ %s:%d\n",
+          rank, name, __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+
+      int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+      if (fd < 0) {
+        fprintf(stderr, "scr_loadgen: %d: Failed to open %s errno=%d %s @ %s:%d\n",
+          rank, file, errno, strerror(errno), __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+
+      fill_buffer(buf, sizes[f], versions[f]);
+      if (write_file(fd, buf, sizes[f]) != 0) {
+        fprintf(stderr, "scr_loadgen: %d: Failed to write %s @ %s:%d\n",
+          rank, file, __FILE__, __LINE__
+        );
+        valid = 0;
+      }
+      fsync(fd);
+      close(fd);
+    }
+
+    if (SCR_Complete_output(valid) != SCR_SUCCESS) {
+      fprintf(stderr, "scr_loadgen: %d: SCR_Complete_output failed @ %s:%d\n",
+        rank, __FILE__, __LINE__
+      );
+      rc = 1;
+    }
+
+    double t1 = MPI_Wtime();
+    double secs = t1 - t0;
+    double secs_max;
+    MPI_Reduce(&secs, &secs_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+      printf("scr_loadgen: checkpoint %d: %.3f s, %.2f GB/s, %d of %d files dirty on rank 0\n",
+        timestep, secs_max, total_gb / secs_max, ndirty, count
+      );
+      fflush(stdout);
+    }
+
+    timestep++;
+  }
+
+  free(versions);
+  free(buf);
+  free(sizes);
+
+  SCR_Finalize();
+  MPI_Finalize();
+
+  return rc;
+}
@@ -0,0 +1,352 @@
+#define _GNU_SOURCE 1
+
+/* Micro-benchmark for the SCR metadata layer.
+ *
+ * Times scr_meta set/get round trips, scr_filemap build, merge, and
+ * file I/O, and scr_index_api set, write, read, and query operations
+ * across synthetic scales (files per rank, rank maps per node,
+ * datasets retained in the index), and prints ops/sec baselines as
+ * machine-readable CSV on stdout, status messages go to stderr.
+ * These operations all sit on the SCR_Init and flush-complete paths,
+ * so their costs are worth watching across refactors.
+ *
+ * This is a serial program, it links the metadata objects directly
+ * rather than going through the SCR library interface.
+ *
+ * Example:
+ *   ./scr_metabench --files 64 --ranks 8 --dsets 16 --times 10 > metabench.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "scr.h"
+#include "scr_io.h"
+#include "scr_util.h"
+#include "scr_meta.h"
+#include "scr_filemap.h"
+#include "scr_dataset.h"
+#include "scr_index_api.h"
+
+#include "spath.h"
+#include "kvtree.h"
+
+#ifdef SCR_GLOBALS_H
+#error "globals.h accessed from tools"
+#endif
+
+static int files  = 64; /* files per rank filemap */
+static int ranks  = 8;  /* rank filemaps merged per node */
+static int dsets  = 16; /* datasets retained in the index */
+static int times  = 5;  /* repetitions of each phase */
+static int header = 1;  /* whether to print the CSV header row */
+
+/* monotonic wall clock in seconds */
+static double now_secs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1.0e9;
+}
+
+/* print one CSV row for a timed phase */
+static void report(const char* op, long ops, double secs)
+{
+  double rate = 0.0;
+  if (secs > 0.0) {
+    rate = (double) ops / secs;
+  }
+  printf("%s,%d,%d,%d,%d,%ld,%.6f,%.0f\n",
+    op, files, ranks, dsets, times, ops, secs, rate
+  );
+}
+
+/* fill in the meta data fields the library records for a cached file */
+static void fill_meta(scr_meta* meta, const char* name, unsigned long size)
+{
+  scr_meta_set_orig(meta, name);
+  scr_meta_set_origpath(meta, "/prefix/job/output");
+  scr_meta_set_origname(meta, name);
+  scr_meta_set_filesize(meta, size);
+  scr_meta_set_complete(meta, 1);
+}
+
+/* build a filemap with the given number of files for one rank */
+static scr_filemap* build_map(int rank, int numfiles)
+{
+  scr_filemap* map = scr_filemap_new();
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    char name[SCR_MAX_FILENAME];
+    snprintf(name, sizeof(name), "/cache/dataset.1/rank_%d_file_%d.ckpt", rank, i);
+    scr_filemap_add_file(map, name);
+
+    scr_meta* meta = scr_meta_new();
+    fill_meta(meta, name, 1024UL * (unsigned long)(i + 1));
+    scr_filemap_set_meta(map, name, meta);
+    scr_meta_delete(&meta);
+  }
+  return map;
+}
+
+/* time scr_meta set/get round trips */
+static void bench_meta(void)
+{
+  long ops = (long) times * files;
+  double start = now_secs();
+  long i;
+  for (i = 0; i < ops; i++) {
+    char name[SCR_MAX_FILENAME];
+    snprintf(name, sizeof(name), "rank_%ld.ckpt", i);
+
+    scr_meta* meta = scr_meta_new();
+    fill_meta(meta, name, 1024UL * (unsigned long)(i + 1));
+
+    unsigned long size;
+    scr_meta_get_filesize(meta, &size);
+    int complete;
+    scr_meta_get_complete(meta, &complete);
+    scr_meta_is_complete(meta);
+
+    scr_meta_delete(&meta);
+  }
+  report("meta_set_get", ops, now_secs() - start);
+}
+
+/* time building a filemap one file at a time */
+static void bench_filemap_add(void)
+{
+  long ops = (long) times * files;
+  double start = now_secs();
+  int t;
+  for (t = 0; t < times; t++) {
+    scr_filemap* map = build_map(0, files);
+    scr_filemap_delete(&map);
+  }
+  report("filemap_add", ops, now_secs() - start);
+}
+
+/* time merging per-rank filemaps into one node map */
+static void bench_filemap_merge(void)
+{
+  long ops = (long) times * ranks;
+  double secs = 0.0;
+  int t;
+  for (t = 0; t < times; t++) {
+    /* build one map per rank outside the timed region */
+    scr_filemap** maps = (scr_filemap**) malloc(ranks * sizeof(scr_filemap*));
+    int r;
+    for (r = 0; r < ranks; r++) {
+      maps[r] = build_map(r, files);
+    }
+
+    /* merge them all into the first map */
+    double start = now_secs();
+    for (r = 1; r < ranks; r++) {
+      scr_filemap_merge(maps[0], maps[r]);
+    }
+    secs += now_secs() - start;
+
+    for (r = 0; r < ranks; r++) {
+      scr_filemap_delete(&maps[r]);
+    }
+    scr_free(&maps);
+  }
+  report("filemap_merge", ops, secs);
+}
+
+/* time writing and reading a filemap to and from disk */
+static void bench_filemap_io(const char* tmpdir)
+{
+  spath* path = spath_from_str(tmpdir);
+  spath_append_str(path, "filemap_bench");
+
+  scr_filemap* map = build_map(0, files);
+
+  int t;
+  double start = now_secs();
+  for (t = 0; t < times; t++) {
+    scr_filemap_write(path, map);
+  }
+  report("filemap_write", times, now_secs() - start);
+
+  start = now_secs();
+  for (t = 0; t < times; t++) {
+    scr_filemap* in = scr_filemap_new();
+    scr_filemap_read(path, in);
+    scr_filemap_delete(&in);
+  }
+  report("filemap_read", times, now_secs() - start);
+
+  scr_filemap_delete(&map);
+
+  char* file = spath_strdup(path);
+  scr_file_unlink(file);
+  scr_free(&file);
+  spath_delete(&path);
+}
+
+/* build an index holding the given number of complete datasets */
+static kvtree* build_index(int numdsets)
+{
+  kvtree* index = kvtree_new();
+  int d;
+  for (d = 1; d <= numdsets; d++) {
+    char name[SCR_MAX_FILENAME];
+    snprintf(name, sizeof(name), "ckpt.%d", d);
+
+    scr_dataset* dataset = scr_dataset_new();
+    scr_dataset_set_id(dataset, d);
+    scr_dataset_set_name(dataset, name);
+    scr_dataset_set_files(dataset, files);
+    scr_dataset_set_size(dataset, 1024UL * 1024UL);
+
+    scr_index_set_dataset(index, d, name, dataset, 1);
+    scr_index_mark_flushed(index, d, name);
+
+    scr_dataset_delete(&dataset);
+  }
+  return index;
+}
+
+/* time index build, write, read, and query operations */
+static void bench_index(const char* tmpdir)
+{
+  spath* dir = spath_from_str(tmpdir);
+
+  /* time adding dataset entries */
+  long ops = (long) times * dsets;
+  double start = now_secs();
+  int t;
+  kvtree* index = NULL;
+  for (t = 0; t < times; t++) {
+    kvtree_delete(&index);
+    index = build_index(dsets);
+  }
+  report("index_set", ops, now_secs() - start);
+
+  /* time writing the index to disk */
+  start = now_secs();
+  for (t = 0; t < times; t++) {
+    scr_index_write(dir, index);
+  }
+  report("index_write", times, now_secs() - start);
+
+  /* time reading it back */
+  start = now_secs();
+  for (t = 0; t < times; t++) {
+    kvtree* in = kvtree_new();
+    scr_index_read(dir, in);
+    kvtree_delete(&in);
+  }
+  report("index_read", times, now_secs() - start);
+
+  /* time the queries the fetch path issues at restart */
+  start = now_secs();
+  for (t = 0; t < times; t++) {
+    int d;
+    for (d = 1; d <= dsets; d++) {
+      char name[SCR_MAX_FILENAME];
+      int id;
+      scr_index_get_most_recent_complete(index, d + 1, &id, name);
+      snprintf(name, sizeof(name), "ckpt.%d", d);
+      scr_index_get_id_by_name(index, name, &id);
+    }
+  }
+  report("index_query", ops * 2, now_secs() - start);
+
+  kvtree_delete(&index);
+  spath_delete(&dir);
+}
+
+int main(int argc, char* argv[])
+{
+  static struct option long_options[] = {
+    {"files",     required_argument, NULL, 'f'},
+    {"ranks",     required_argument, NULL, 'r'},
+    {"dsets",     required_argument, NULL, 'd'},
+    {"times",     required_argument, NULL, 't'},
+    {"no-header", no_argument,       NULL, 'n'},
+    {"help",      no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  int c;
+  do {
+    int option_index = 0;
+    c = getopt_long(argc, argv, "f:r:d:t:nh", long_options, &option_index);
+    switch (c) {
+      case 'f':
+        files = atoi(optarg);
+        break;
+      case 'r':
+        ranks = atoi(optarg);
+        break;
+      case 'd':
+        dsets = atoi(optarg);
+        break;
+      case 't':
+        times = atoi(optarg);
+        break;
+      case 'n':
+        header = 0;
+        break;
+      case 'h':
+        printf("Usage: scr_metabench [--files <n>] [--ranks <n>] [--dsets <n>] [--times <n>] [--no-header]\n");
+        return 0;
+      case '?':
+        return 1;
+      default:
+        break;
+    }
+  } while (c != -1);
+
+  if (files <= 0 || ranks <= 0 || dsets <= 0 || times <= 0) {
+    fprintf(stderr, "scr_metabench: counts must be positive\n");
+    return 1;
+  }
+
+  /* create a scratch directory for the I/O phases, the index code
+   * expects a prefix directory holding a .scr subdirectory */
+  char tmpdir[SCR_MAX_FILENAME];
+  snprintf(tmpdir, sizeof(tmpdir), "./scr_metabench.tmp.%d", (int) getpid());
+  char tmpscr[SCR_MAX_FILENAME];
+  snprintf(tmpscr, sizeof(tmpscr), "%s/.scr", tmpdir);
+  if (scr_mkdir(tmpdir, S_IRWXU) != SCR_SUCCESS ||
+      scr_mkdir(tmpscr, S_IRWXU) != SCR_SUCCESS)
+  {
+    fprintf(stderr, "scr_metabench: failed to create scratch directory %s\n", tmpdir);
+    return 1;
+  }
+
+  fprintf(stderr, "scr_metabench: files=%d ranks=%d dsets=%d times=%d\n",
+    files, ranks, dsets, times
+  );
+
+  if (header) {
+    printf("op,files,ranks,dsets,times,ops,secs,ops_per_sec\n");
+  }
+
+  bench_meta();
+  bench_filemap_add();
+  bench_filemap_merge();
+  bench_filemap_io(tmpdir);
+  bench_index(tmpdir);
+
+  /* clean up our scratch directory */
+  char file[SCR_MAX_FILENAME];
+  snprintf(file, sizeof(file), "%s/index.scr", tmpscr);
+  scr_file_unlink(file);
+  snprintf(file, sizeof(file), "%s/index.journal.scr", tmpscr);
+  scr_file_unlink(file);
+  rmdir(tmpscr);
+  rmdir(tmpdir);
+
+  return 0;
+}
@@ -0,0 +1,542 @@
+#define _GNU_SOURCE 1
+
+/* Restart-path benchmark for SCR.
+ *
+ * Where scr_bench measures checkpoint writes, this tool measures the
+ * restart side.  Run it once with --write to produce checkpoints, then
+ * run it again (same launch parameters) to time each restart phase
+ * separately: SCR_Init, which covers dataset distribution, cache
+ * rebuild, and any fetch from the prefix directory; restart metadata
+ * resolution (SCR_Have_restart and SCR_Start_restart); the data reads
+ * themselves; and SCR_Complete_restart.  Results are one CSV row on
+ * stdout from rank 0, status messages go to stderr.
+ *
+ * To simulate lost ranks, the write phase records the cache path of
+ * each routed file in a per-rank manifest (scr_restartbench.files.N in
+ * the working directory), and --missing makes the listed ranks unlink
+ * their cached files before SCR_Init, forcing a rebuild from redundancy
+ * data or a fetch from the prefix directory.  Missing-rank simulation
+ * requires cache mode (SCR_CACHE_BYPASS=0), in bypass mode the routed
+ * paths point at the only copy of the data.
+ *
+ * Example:
+ *   srun -n 32 ./scr_restartbench --write --size 64m --files 4
+ *   srun -n 32 ./scr_restartbench --missing 3,7 > restart.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "mpi.h"
+
+#include "scr.h"
+
+/* maximum number of ranks in a --missing list */
+#define BENCH_MAX_MISSING (64)
+
+static int rank  = -1;
+static int ranks = 0;
+
+static int do_write = 0;
+static size_t size  = 1024*1024;
+static int nfiles   = 1;
+static int times    = 1;
+static int header   = 1;
+
+static int missing[BENCH_MAX_MISSING];
+static int num_missing = 0;
+
+/* parse a byte count like "64m" or "1gb", returns 0 on failure */
+static size_t parse_size(const char* str)
+{
+  char* next = NULL;
+  double num = strtod(str, &next);
+  if (next == str || num <= 0) {
+    return 0;
+  }
+
+  unsigned long long units = 1;
+  switch (*next) {
+  case '\0':
+    break;
+  case 'k': case 'K':
+    units = 1024ULL;
+    next++;
+    break;
+  case 'm': case 'M':
+    units = 1024ULL*1024;
+    next++;
+    break;
+  case 'g': case 'G':
+    units = 1024ULL*1024*1024;
+    next++;
+    break;
+  default:
+    return 0;
+  }
+  if (*next == 'b' || *next == 'B') {
+    next++;
+  }
+  if (*next != '\0') {
+    return 0;
+  }
+
+  return (size_t) (num * (double) units);
+}
+
+/* parse a comma-separated list of ranks, returns count or -1 */
+static int parse_rank_list(char* str, int* vals, int max)
+{
+  int count = 0;
+  char* item = strtok(str, ",");
+  while (item != NULL && count < max) {
+    int v = atoi(item);
+    if (v < 0) {
+      return -1;
+    }
+    vals[count++] = v;
+    item = strtok(NULL, ",");
+  }
+  return count;
+}
+
+/* returns 1 if this rank is named in the --missing list */
+static int rank_is_missing(void)
+{
+  int i;
+  for (i = 0; i < num_missing; i++) {
+    if (missing[i] == rank) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* name of this rank's manifest of routed cache paths */
+static void manifest_name(char* buf, size_t bufsize)
+{
+  snprintf(buf, bufsize, "scr_restartbench.files.%d", rank);
+}
+
+/* write size bytes from buf to fd, returns 0 on success */
+static int write_file(int fd, const char* buf, size_t bytes)
+{
+  size_t written = 0;
+  while (written < bytes) {
+    ssize_t rc = write(fd, buf + written, bytes - written);
+    if (rc < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return 1;
+    }
+    written += (size_t) rc;
+  }
+  return 0;
+}
+
+/* read the whole file on fd into buf of bufsize, returns bytes read or -1 */
+static ssize_t read_file(int fd, char* buf, size_t bufsize)
+{
+  size_t total = 0;
+  while (total < bufsize) {
+    ssize_t rc = read(fd, buf + total, bufsize - total);
+    if (rc < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    total += (size_t) rc;
+  }
+  return (ssize_t) total;
+}
+
+/* write times checkpoints and record the routed cache paths of the
+ * last one in this rank's manifest, returns 0 on success */
+static int run_write(void)
+{
+  int rc = 0;
+
+  char* buf = (char*) malloc(size);
+  if (buf == NULL) {
+    fprintf(stderr, "scr_restartbench: %d: Failed to allocate %lu byte buffer @ %s:%d\n",
+      rank, (unsigned long) size, __FILE__, __LINE__
+    );
+    return 1;
+  }
+
+  /* fill buffer with a simple pattern so writes aren't all zero pages */
+  size_t i;
+  for (i = 0; i < size; i++) {
+    buf[i] = (char) ((i + (size_t) rank) & 0xFF);
+  }
+
+  if (SCR_Init() != SCR_SUCCESS) {
+    fprintf(stderr, "scr_restartbench: Failed initializing SCR\n");
+    free(buf);
+    return 1;
+  }
+
+  char manifest[SCR_MAX_FILENAME];
+  manifest_name(manifest, sizeof(manifest));
+
+  int t;
+  for (t = 0; t < times; t++) {
+    char label[SCR_MAX_FILENAME];
+    sprintf(label, "restartbench.%d", t);
+
+    if (SCR_Start_output(label, SCR_FLAG_CHECKPOINT) != SCR_SUCCESS) {
+      fprintf(stderr, "scr_restartbench: %d: SCR_Start_output failed @ %s:%d\n",
+        rank, __FILE__, __LINE__
+      );
+      rc = 1;
+    }
+
+    /* rewrite the manifest each checkpoint so it always lists the
+     * routed paths of the most recent one */
+    FILE* mf = fopen(manifest, "w");
+
+    int valid = 1;
+    int f;
+    for (f = 0; f < nfiles; f++) {
+      char name[SCR_MAX_FILENAME];
+      sprintf(name, "%s/rank_%d.%d.ckpt", label, rank, f);
+
+      char file[SCR_MAX_FILENAME];
+      if (SCR_Route_file(name, file) != SCR_SUCCESS) {
+        fprintf(stderr, "scr_restartbench: %d: SCR_Route_file failed for %s @ %s:%d\n",
+          rank, name, __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+
+      int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+      if (fd < 0) {
+        fprintf(stderr, "scr_restartbench: %d: Failed to open %s errno=%d %s @ %s:%d\n",
+          rank, file, errno, strerror(errno), __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+      if (write_file(fd, buf, size) != 0) {
+        fprintf(stderr, "scr_restartbench: %d: Failed to write %s @ %s:%d\n",
+          rank, file, __FILE__, __LINE__
+        );
+        valid = 0;
+      }
+      fsync(fd);
+      close(fd);
+
+      if (mf != NULL) {
+        fprintf(mf, "%s\n", file);
+      }
+    }
+
+    if (mf != NULL) {
+      fclose(mf);
+    }
+
+    if (SCR_Complete_output(valid) != SCR_SUCCESS) {
+      fprintf(stderr, "scr_restartbench: %d: SCR_Complete_output failed @ %s:%d\n",
+        rank, __FILE__, __LINE__
+      );
+      rc = 1;
+    }
+  }
+
+  SCR_Finalize();
+  free(buf);
+
+  if (rank == 0 && rc == 0) {
+    fprintf(stderr, "scr_restartbench: wrote %d checkpoint(s), run again without --write to time the restart\n",
+      times
+    );
+  }
+
+  return rc;
+}
+
+/* unlink this rank's cached files listed in its manifest, returns
+ * the number of files removed */
+static int clobber_cache(void)
+{
+  char manifest[SCR_MAX_FILENAME];
+  manifest_name(manifest, sizeof(manifest));
+
+  FILE* mf = fopen(manifest, "r");
+  if (mf == NULL) {
+    fprintf(stderr, "scr_restartbench: %d: No manifest %s, cannot simulate missing rank @ %s:%d\n",
+      rank, manifest, __FILE__, __LINE__
+    );
+    return 0;
+  }
+
+  int removed = 0;
+  char line[SCR_MAX_FILENAME];
+  while (fgets(line, sizeof(line), mf) != NULL) {
+    /* strip the trailing newline */
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n') {
+      line[len - 1] = '\0';
+    }
+    if (unlink(line) == 0) {
+      removed++;
+    }
+  }
+  fclose(mf);
+
+  fprintf(stderr, "scr_restartbench: %d: Removed %d cached file(s) to simulate a lost rank\n",
+    rank, removed
+  );
+  return removed;
+}
+
+/* time the restart phases and print one CSV row from rank 0,
+ * returns 0 on success */
+static int run_restart(void)
+{
+  int rc = 0;
+
+  /* listed ranks drop their cached files first, so SCR_Init has to
+   * rebuild them from redundancy data or fetch from the prefix */
+  if (rank_is_missing()) {
+    clobber_cache();
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double t0 = MPI_Wtime();
+
+  /* covers dataset distribution, cache rebuild, and fetch */
+  if (SCR_Init() != SCR_SUCCESS) {
+    fprintf(stderr, "scr_restartbench: Failed initializing SCR\n");
+    return 1;
+  }
+  double t1 = MPI_Wtime();
+
+  /* restart metadata resolution */
+  int have_restart = 0;
+  char dset[SCR_MAX_FILENAME];
+  if (SCR_Have_restart(&have_restart, dset) != SCR_SUCCESS) {
+    fprintf(stderr, "scr_restartbench: %d: SCR_Have_restart failed @ %s:%d\n",
+      rank, __FILE__, __LINE__
+    );
+    rc = 1;
+  }
+  if (have_restart && SCR_Start_restart(dset) != SCR_SUCCESS) {
+    fprintf(stderr, "scr_restartbench: %d: SCR_Start_restart failed @ %s:%d\n",
+      rank, __FILE__, __LINE__
+    );
+    rc = 1;
+    have_restart = 0;
+  }
+  double t2 = MPI_Wtime();
+
+  /* read our files back */
+  char* buf = (char*) malloc(size);
+  double my_bytes = 0.0;
+  int valid = 1;
+  if (have_restart && buf != NULL) {
+    int f;
+    for (f = 0; f < nfiles; f++) {
+      char name[SCR_MAX_FILENAME];
+      sprintf(name, "%s/rank_%d.%d.ckpt", dset, rank, f);
+
+      char file[SCR_MAX_FILENAME];
+      if (SCR_Route_file(name, file) != SCR_SUCCESS) {
+        fprintf(stderr, "scr_restartbench: %d: SCR_Route_file failed for %s @ %s:%d\n",
+          rank, name, __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+
+      int fd = open(file, O_RDONLY);
+      if (fd < 0) {
+        fprintf(stderr, "scr_restartbench: %d: Failed to open %s errno=%d %s @ %s:%d\n",
+          rank, file, errno, strerror(errno), __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+      ssize_t n = read_file(fd, buf, size);
+      close(fd);
+      if (n < 0 || (size_t) n != size) {
+        fprintf(stderr, "scr_restartbench: %d: Short read of %s @ %s:%d\n",
+          rank, file, __FILE__, __LINE__
+        );
+        valid = 0;
+        continue;
+      }
+      my_bytes += (double) n;
+    }
+  }
+  double t3 = MPI_Wtime();
+
+  if (have_restart && SCR_Complete_restart(valid) != SCR_SUCCESS) {
+    fprintf(stderr, "scr_restartbench: %d: SCR_Complete_restart failed @ %s:%d\n",
+      rank, __FILE__, __LINE__
+    );
+    rc = 1;
+  }
+  double t4 = MPI_Wtime();
+
+  free(buf);
+
+  /* take the slowest rank for each phase, that's the time the
+   * application actually pays, and sum the bytes read */
+  double phase[4] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3};
+  double phase_max[4];
+  MPI_Allreduce(phase, phase_max, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+  double total_bytes = 0.0;
+  MPI_Allreduce(&my_bytes, &total_bytes, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  /* a rank that failed to read its data fails the benchmark */
+  int all_valid = 0;
+  int my_valid = (valid && have_restart) ? 1 : 0;
+  MPI_Allreduce(&my_valid, &all_valid, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (! all_valid) {
+    rc = 1;
+  }
+
+  if (rank == 0) {
+    if (! have_restart) {
+      fprintf(stderr, "scr_restartbench: No restart available, run with --write first\n");
+    }
+
+    if (header) {
+      printf("ranks,missing,files_per_rank,size_bytes,read_mb,"
+             "init_s,start_restart_s,read_s,complete_s,total_s,read_bw_mbs\n");
+    }
+
+    double read_mb = total_bytes / (1024.0 * 1024.0);
+    double total_s = phase_max[0] + phase_max[1] + phase_max[2] + phase_max[3];
+    double read_bw = 0.0;
+    if (phase_max[2] > 0.0) {
+      read_bw = read_mb / phase_max[2];
+    }
+    printf("%d,%d,%d,%lu,%.2f,%.6f,%.6f,%.6f,%.6f,%.6f,%.2f\n",
+      ranks, num_missing, nfiles, (unsigned long) size, read_mb,
+      phase_max[0], phase_max[1], phase_max[2], phase_max[3],
+      total_s, read_bw
+    );
+    fflush(stdout);
+  }
+
+  SCR_Finalize();
+
+  return rc;
+}
+
+void print_usage()
+{
+  printf("\n");
+  printf("  Usage: scr_restartbench [options]\n");
+  printf("\n");
+  printf("  Options:\n");
+  printf("    -w, --write           Write checkpoints instead of timing a restart\n");
+  printf("    -s, --size=<BYTES>    File size per rank, e.g., 64m (default 1m)\n");
+  printf("    -n, --files=<COUNT>   Files per rank (default %d)\n", nfiles);
+  printf("    -t, --times=<COUNT>   Checkpoints to write in --write mode (default %d)\n", times);
+  printf("    -m, --missing=<LIST>  Ranks whose cached files to drop before restart, e.g., 3,7\n");
+  printf("    -H, --no-header       Omit the CSV header line, for appending to a file\n");
+  printf("    -h, --help            Print usage\n");
+  printf("\n");
+  return;
+}
+
+int main (int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+  static const char *opt_string = "ws:n:t:m:Hh";
+  static struct option long_options[] = {
+    {"write",     no_argument,       NULL, 'w'},
+    {"size",      required_argument, NULL, 's'},
+    {"files",     required_argument, NULL, 'n'},
+    {"times",     required_argument, NULL, 't'},
+    {"missing",   required_argument, NULL, 'm'},
+    {"no-header", no_argument,       NULL, 'H'},
+    {"help",      no_argument,       NULL, 'h'},
+    {NULL,        no_argument,       NULL,   0}
+  };
+
+  int usage = 0;
+  int long_index = 0;
+  int opt = getopt_long(argc, argv, opt_string, long_options, &long_index);
+  while (opt != -1) {
+    switch(opt) {
+      case 'w':
+        do_write = 1;
+        break;
+      case 's':
+        size = parse_size(optarg);
+        if (size == 0) {
+          usage = 1;
+        }
+        break;
+      case 'n':
+        nfiles = atoi(optarg);
+        if (nfiles < 1) {
+          usage = 1;
+        }
+        break;
+      case 't':
+        times = atoi(optarg);
+        if (times < 1) {
+          usage = 1;
+        }
+        break;
+      case 'm':
+        num_missing = parse_rank_list(optarg, missing, BENCH_MAX_MISSING);
+        if (num_missing < 0) {
+          usage = 1;
+        }
+        break;
+      case 'H':
+        header = 0;
+        break;
+      case 'h':
+      default:
+        usage = 1;
+        break;
+    }
+
+    /* get the next option */
+    opt = getopt_long(argc, argv, opt_string, long_options, &long_index);
+  }
+
+  if (usage) {
+    if (rank == 0) {
+      print_usage();
+    }
+    MPI_Finalize();
+    return 1;
+  }
+
+  int rc;
+  if (do_write) {
+    rc = run_write();
+  } else {
+    rc = run_restart();
+  }
+
+  MPI_Finalize();
+
+  return rc;
+}
@@ -148,6 +148,127 @@ static int axl_create_dirs(int count, const char** filelist, MPI_Comm comm)
     return AXL_SUCCESS;
 }
 
+/* Warm-handle pool.  AXL handles are single-use: once a transfer has
+ * been waited on, the handle must be freed and a fresh one created,
+ * and that create re-initializes transfer state and backend resources
+ * (bbapi sessions, pthread pools) at the start of every flush.  To
+ * take that cost off the critical path, AXL_Free_comm pre-creates a
+ * replacement handle of the same transfer type right after the free,
+ * when the dataset has already been flushed, and AXL_Create_comm
+ * serves later requests from that pool.  Pooled handles carry no
+ * state file, so requests that pass one bypass the pool.  The pool is
+ * stocked and drained collectively, which keeps its contents
+ * consistent across ranks without extra messages on the create path. */
+#define AXL_POOL_SIZE (4)
+static struct {
+    int valid;       /* whether this slot holds a warm handle */
+    axl_xfer_t type; /* transfer type the handle was created with */
+    int id;          /* the handle itself */
+} axl_pool[AXL_POOL_SIZE];
+
+/* remember the transfer type of each handle we hand out so the free
+ * path knows what to re-warm */
+static struct {
+    int id;
+    axl_xfer_t type;
+} *axl_pool_live = NULL;
+static int axl_pool_live_count = 0;
+static int axl_pool_live_size  = 0;
+
+/* record the transfer type for a live handle */
+static void axl_pool_remember(int id, axl_xfer_t type)
+{
+    if (axl_pool_live_count >= axl_pool_live_size) {
+        axl_pool_live_size = (axl_pool_live_size > 0) ? axl_pool_live_size * 2 : 8;
+        axl_pool_live = realloc(axl_pool_live, axl_pool_live_size * sizeof(*axl_pool_live));
+        if (axl_pool_live == NULL) {
+            scr_abort(-1, "Failed to allocate handle registry @ %s:%d",
+                __FILE__, __LINE__
+            );
+        }
+    }
+    axl_pool_live[axl_pool_live_count].id   = id;
+    axl_pool_live[axl_pool_live_count].type = type;
+    axl_pool_live_count++;
+}
+
+/* drop a handle from the registry and return its transfer type,
+ * returns AXL_XFER_NULL if the handle is unknown */
+static axl_xfer_t axl_pool_forget(int id)
+{
+    int i;
+    for (i = 0; i < axl_pool_live_count; i++) {
+        if (axl_pool_live[i].id == id) {
+            axl_xfer_t type = axl_pool_live[i].type;
+            axl_pool_live_count--;
+            axl_pool_live[i] = axl_pool_live[axl_pool_live_count];
+            return type;
+        }
+    }
+    return AXL_XFER_NULL;
+}
+
+/* take a warm handle of the given type from the pool,
+ * returns -1 if none is available */
+static int axl_pool_take(axl_xfer_t type)
+{
+    int i;
+    for (i = 0; i < AXL_POOL_SIZE; i++) {
+        if (axl_pool[i].valid && axl_pool[i].type == type) {
+            axl_pool[i].valid = 0;
+            return axl_pool[i].id;
+        }
+    }
+    return -1;
+}
+
+/* pre-create a handle of the given type and stash it in the pool,
+ * collective so the pool stays consistent across ranks, a rank that
+ * fails to create drops the handle everywhere */
+static void axl_pool_stock(axl_xfer_t type, const char* name, MPI_Comm comm)
+{
+    /* find a free slot, give up if the pool is full */
+    int slot = -1;
+    int i;
+    for (i = 0; i < AXL_POOL_SIZE; i++) {
+        if (! axl_pool[i].valid) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        /* still collective, everyone sees the same pool */
+        return;
+    }
+
+    /* create the replacement handle */
+    int id = AXL_Create(type, name, NULL);
+
+    /* only keep it if everyone succeeded */
+    if (axl_alltrue(id != -1, comm)) {
+        axl_pool[slot].valid = 1;
+        axl_pool[slot].type  = type;
+        axl_pool[slot].id    = id;
+    } else if (id != -1) {
+        AXL_Free(id);
+    }
+}
+
+/* free any handles left in the pool */
+static void axl_pool_drain(void)
+{
+    int i;
+    for (i = 0; i < AXL_POOL_SIZE; i++) {
+        if (axl_pool[i].valid) {
+            AXL_Free(axl_pool[i].id);
+            axl_pool[i].valid = 0;
+        }
+    }
+    axl_free2(&axl_pool_live);
+    axl_pool_live_count = 0;
+    axl_pool_live_size  = 0;
+}
+
 int AXL_Init_comm (
     MPI_Comm comm)    /**< [IN]  - communicator used for coordination and flow control */
 {
@@ -184,6 +305,9 @@ int AXL_Finalize_comm (
 {
     int rc = AXL_SUCCESS;
 
+    /* free any warm handles left in the pool */
+    axl_pool_drain();
+
 #ifdef HAVE_LIBDTCMP
     int dtcmp_rc = DTCMP_Finalize();
     if (dtcmp_rc != DTCMP_SUCCESS) {
@@ -214,6 +338,17 @@ int AXL_Create_comm (
     const char* file,
     MPI_Comm comm)    /**< [IN]  - communicator used for coordination and flow control */
 {
+    /* serve the request from the warm-handle pool when we can,
+     * the pool is stocked collectively so either every rank hits
+     * or every rank misses */
+    if (file == NULL) {
+        int pooled = axl_pool_take(type);
+        if (pooled != -1) {
+            axl_pool_remember(pooled, type);
+            return pooled;
+        }
+    }
+
     int id = AXL_Create(type, name, file);
 
     /* NOTE: We do not force id to be the same on all ranks.
@@ -234,6 +369,11 @@ int AXL_Create_comm (
       id = -1;
     }
 
+    /* remember the type so the free path can re-warm the pool */
+    if (id != -1 && file == NULL) {
+        axl_pool_remember(id, type);
+    }
+
     return id;
 }
 
@@ -371,6 +511,8 @@ int AXL_Free_comm (
     int id,        /**< [IN]  - transfer hander ID returned from AXL_Create */
     MPI_Comm comm) /**< [IN]  - communicator used for coordination and flow control */
 {
+    axl_xfer_t type = axl_pool_forget(id);
+
     int rc = AXL_Free(id);
 
     /* return same value on all ranks */
@@ -379,6 +521,13 @@ int AXL_Free_comm (
         rc = AXL_FAILURE;
     }
 
+    /* pre-create a replacement handle of the same type now, while
+     * we're off the critical path, so the next flush start finds a
+     * warm handle in the pool */
+    if (rc == AXL_SUCCESS && type != AXL_XFER_NULL) {
+        axl_pool_stock(type, "scr_axl_pool", comm);
+    }
+
     return rc;
 }
 
@@ -31,11 +31,29 @@
  */
 
 #include "scr_globals.h"
+#include "scr_stats.h"
+#include "scr_trace_api.h"
+
+#include <pthread.h>
+
+/* sqrt for the Young/Daly checkpoint interval model */
+#include <math.h>
+
+/* halt file watcher waits on file events with a timed poll */
+#include <sys/select.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 #include "dtcmp.h"
 #include "er.h"
 #include "axl_mpi.h"
 
+#ifdef HAVE_LIBCUFILE
+#include <cufile.h>
+#include <cuda_runtime.h>
+#endif
+
 /* define which state we're in for API calls, this is to help ensure
  * users call SCR functions in the correct order */
 typedef enum {
@@ -46,8 +64,10 @@ typedef enum {
     SCR_STATE_OUTPUT      /* between start/complete output */
 } SCR_STATE;
 
-/* initialize our state to uninit */
-static SCR_STATE scr_state = SCR_STATE_UNINIT;
+/* initialize our state to uninit,
+ * volatile so that worker threads routing files see transitions
+ * made by the thread driving the collective calls */
+static volatile SCR_STATE scr_state = SCR_STATE_UNINIT;
 
 /* tracks set of files in current dataset */
 static scr_filemap* scr_map = NULL;
@@ -55,6 +75,31 @@ static scr_filemap* scr_map = NULL;
 /* tracks redundancy descriptor for current dataset */
 static scr_reddesc* scr_rd = NULL;
 
+/* an open streaming write handle, the application hands us its data
+ * as it is produced, so the CRC is folded in as the bytes pass
+ * through rather than by reading the file back afterwards */
+typedef struct {
+  char* file;         /* routed path of the file, NULL marks a free slot */
+  int fd;             /* open file descriptor */
+  uLong crc;          /* running crc over bytes written */
+  unsigned long size; /* number of bytes written so far */
+  int error;          /* set once any write fails */
+  int direct;         /* set once any bytes bypass the host and its inline crc */
+#ifdef HAVE_LIBCUFILE
+  CUfileHandle_t cf_handle; /* cuFile handle for GPU-direct writes */
+  int cf_registered;        /* whether cf_handle is valid */
+#endif
+} scr_stream;
+
+/* table of open streaming handles, grown on demand,
+ * an SCR_Open/SCR_Write/SCR_Close handle is an index into this table */
+static scr_stream* scr_streams = NULL;
+static int scr_streams_size = 0;
+
+/* guards slot allocation and release in the handle table, a given
+ * handle itself may only be used by one thread at a time */
+static pthread_mutex_t scr_stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static double scr_time_compute_start;     /* records the start time of the current compute phase */
 static double scr_time_compute_end;       /* records the end time of the current compute phase */
 
@@ -65,6 +110,15 @@ static time_t scr_timestamp_output_start; /* record timestamp of start of output
 static double scr_time_output_start;      /* records the start time of the current output phase */
 static double scr_time_output_end;        /* records the end time of the current output phase */
 
+static int scr_nodes = 0; /* number of nodes in the allocation, scales node MTBF to a job MTBF */
+
+/* per-descriptor checkpoint cost totals, indexed like scr_reddescs,
+ * rank 0 records a sample for each checkpoint it times and the
+ * adaptive scheduler retunes descriptor intervals from the averages
+ * (see SCR_CHECKPOINT_ADAPTIVE) */
+static double* scr_ckpt_cost_total = NULL;
+static int*    scr_ckpt_cost_count = NULL;
+
 /* look up redundancy descriptor we should use for this dataset */
 static scr_reddesc* scr_get_reddesc(const scr_dataset* dataset, int ndescs, scr_reddesc* descs)
 {
@@ -132,6 +186,70 @@ static scr_reddesc* scr_get_reddesc(const scr_dataset* dataset, int ndescs, scr_
   return d;
 }
 
+/* charge the measured cost of a checkpoint to the descriptor that
+ * protected it and retune descriptor intervals from the averages
+ * seen so far, in the two-level model the overhead-optimal rate of
+ * an expensive level relative to a cheap one scales as the square
+ * root of their cost ratio, applying that against the cheapest
+ * enabled level sets each descriptor's interval without hand-tuned
+ * counts that go stale when I/O performance changes, collective
+ * since every rank must select descriptors identically */
+static void scr_ckpt_sched_update(double cost)
+{
+  int i;
+
+  /* rank 0 tallies the sample and recomputes the intervals */
+  int* intervals = (int*) SCR_MALLOC(scr_nreddescs * sizeof(int));
+  if (scr_my_rank_world == 0) {
+    /* record the cost against the descriptor we just used */
+    int index = (int) (scr_rd - scr_reddescs);
+    if (index >= 0 && index < scr_nreddescs) {
+      scr_ckpt_cost_total[index] += cost;
+      scr_ckpt_cost_count[index]++;
+    }
+
+    /* find the cheapest enabled level we have measured */
+    double base = -1.0;
+    for (i = 0; i < scr_nreddescs; i++) {
+      if (scr_reddescs[i].enabled && scr_ckpt_cost_count[i] > 0) {
+        double avg = scr_ckpt_cost_total[i] / (double) scr_ckpt_cost_count[i];
+        if (base < 0.0 || avg < base) {
+          base = avg;
+        }
+      }
+    }
+
+    /* set each measured level's interval from its cost relative to
+     * the cheapest, a level we have not measured keeps its configured
+     * interval so it still gets exercised and costed */
+    for (i = 0; i < scr_nreddescs; i++) {
+      intervals[i] = scr_reddescs[i].interval;
+      if (scr_reddescs[i].enabled && scr_ckpt_cost_count[i] > 0 && base > 0.0) {
+        double avg = scr_ckpt_cost_total[i] / (double) scr_ckpt_cost_count[i];
+        int n = (int) (sqrt(avg / base) + 0.5);
+        if (n < 1) {
+          n = 1;
+        }
+        intervals[i] = n;
+      }
+    }
+  }
+
+  /* apply the new intervals everywhere */
+  MPI_Bcast(intervals, scr_nreddescs, MPI_INT, 0, scr_comm_world);
+  for (i = 0; i < scr_nreddescs; i++) {
+    if (scr_reddescs[i].interval != intervals[i]) {
+      if (scr_my_rank_world == 0) {
+        scr_dbg(1, "Adaptive scheduler set interval %d on redundancy descriptor %d (%s)",
+          intervals[i], i, scr_reddescs[i].base
+        );
+      }
+      scr_reddescs[i].interval = intervals[i];
+    }
+  }
+  scr_free(&intervals);
+}
+
 /*
 =========================================
 Halt logic
@@ -142,6 +260,154 @@ Halt logic
 #define SCR_TEST_BUT_DONT_HALT (2)
 #define SCR_FINALIZE_CALLED "SCR_FINALIZE_CALLED"
 
+/* when SCR_HALT_WATCH is set, rank 0 runs a background thread that
+ * watches the halt file, so that halt checks only take the file lock
+ * after the file has actually changed rather than locking, reading,
+ * and rewriting it at every checkpoint, on Linux the thread waits for
+ * inotify events on the prefix .scr directory, and it also stats the
+ * file on a timed poll since inotify does not report changes made
+ * from other nodes on network file systems */
+static pthread_t scr_halt_watch_thread;
+static int scr_halt_watch_running = 0;        /* set while the watcher thread is active */
+static volatile int scr_halt_watch_quit = 0;  /* tells the watcher thread to exit */
+static volatile int scr_halt_file_dirty = 1;  /* set when the halt file may have new contents */
+static int scr_halt_watch_pipe[2] = {-1, -1}; /* self-pipe to wake the watcher on shutdown */
+
+static void* scr_halt_watch_func(void* arg)
+{
+  /* get name of the halt file */
+  char* file = spath_strdup(scr_halt_file);
+
+  /* record modification time and size of the halt file as we last saw it */
+  time_t mtime = 0;
+  off_t size = -1;
+  struct stat sb;
+  if (stat(file, &sb) == 0) {
+    mtime = sb.st_mtime;
+    size  = sb.st_size;
+  }
+
+#ifdef __linux__
+  /* watch the directory holding the halt file so we catch the file
+   * being created or replaced as well as being rewritten in place */
+  int ifd = inotify_init();
+  if (ifd >= 0) {
+    inotify_add_watch(ifd, scr_prefix_scr, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  }
+#else
+  int ifd = -1;
+#endif
+
+  while (! scr_halt_watch_quit) {
+    /* sleep until a file event arrives or the poll interval expires,
+     * the shutdown pipe wakes us immediately when stopping */
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(scr_halt_watch_pipe[0], &fds);
+    int maxfd = scr_halt_watch_pipe[0];
+    if (ifd >= 0) {
+      FD_SET(ifd, &fds);
+      if (ifd > maxfd) {
+        maxfd = ifd;
+      }
+    }
+    struct timeval tv;
+    tv.tv_sec  = scr_halt_watch_seconds;
+    tv.tv_usec = 0;
+    int nready = select(maxfd + 1, &fds, NULL, NULL, &tv);
+
+    /* drain queued file events, we stat the halt file below no
+     * matter which event woke us */
+    if (nready > 0 && ifd >= 0 && FD_ISSET(ifd, &fds)) {
+      char buf[4096];
+      ssize_t nread = read(ifd, buf, sizeof(buf));
+      if (nread < 0) {
+        /* nothing to do, the stat below still runs */
+      }
+    }
+
+    /* flag a change if the halt file mtime or size moved */
+    if (stat(file, &sb) == 0) {
+      if (sb.st_mtime != mtime || sb.st_size != size) {
+        mtime = sb.st_mtime;
+        size  = sb.st_size;
+        scr_halt_file_dirty = 1;
+      }
+    }
+  }
+
+#ifdef __linux__
+  if (ifd >= 0) {
+    close(ifd);
+  }
+#endif
+
+  scr_free(&file);
+  return NULL;
+}
+
+/* start the background halt file watcher on rank 0,
+ * on failure the watcher stays off and halt checks
+ * fall back to reading the file every time */
+static int scr_halt_watch_start(void)
+{
+  if (scr_my_rank_world != 0 || scr_halt_watch_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* create pipe used to wake the watcher when we shut it down */
+  if (pipe(scr_halt_watch_pipe) != 0) {
+    scr_err("Failed to create pipe for halt file watcher @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* force a full sync on the first check after starting */
+  scr_halt_watch_quit = 0;
+  scr_halt_file_dirty = 1;
+
+  /* start the watcher thread */
+  if (pthread_create(&scr_halt_watch_thread, NULL, scr_halt_watch_func, NULL) != 0) {
+    scr_err("Failed to start halt file watcher thread @ %s:%d",
+      __FILE__, __LINE__
+    );
+    close(scr_halt_watch_pipe[0]);
+    close(scr_halt_watch_pipe[1]);
+    scr_halt_watch_pipe[0] = -1;
+    scr_halt_watch_pipe[1] = -1;
+    return SCR_FAILURE;
+  }
+
+  scr_halt_watch_running = 1;
+  return SCR_SUCCESS;
+}
+
+/* stop the background halt file watcher if it is running */
+static int scr_halt_watch_stop(void)
+{
+  if (! scr_halt_watch_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* wake the watcher and wait for it to exit */
+  scr_halt_watch_quit = 1;
+  ssize_t nwrite = write(scr_halt_watch_pipe[1], "x", 1);
+  if (nwrite < 0) {
+    /* watcher will still notice the quit flag at its next poll */
+  }
+  pthread_join(scr_halt_watch_thread, NULL);
+
+  /* close down the shutdown pipe */
+  close(scr_halt_watch_pipe[0]);
+  close(scr_halt_watch_pipe[1]);
+  scr_halt_watch_pipe[0] = -1;
+  scr_halt_watch_pipe[1] = -1;
+
+  scr_halt_watch_running = 0;
+  return SCR_SUCCESS;
+}
+
 /* writes entry to halt file to indicate that SCR should exit job at first opportunity */
 static int scr_halt(const char* reason)
 {
@@ -179,8 +445,15 @@ static int scr_bool_check_halt_and_decrement(int halt_cond, int decrement)
     int now = tv.tv_sec;
 
     /* locks halt file, reads it to pick up new values, decrements the
-     * checkpoint counter, writes it out, and unlocks it */
-    scr_halt_sync_and_decrement(scr_halt_file, scr_halt_hash, decrement);
+     * checkpoint counter, writes it out, and unlocks it,
+     * when the watcher thread is running and has not seen the file
+     * change, skip the lock/read/write and evaluate the cached hash,
+     * we still sync when decrementing since the counter must be
+     * updated in the file for external tools to see */
+    if (decrement > 0 || ! scr_halt_watch_running || scr_halt_file_dirty) {
+      scr_halt_file_dirty = 0;
+      scr_halt_sync_and_decrement(scr_halt_file, scr_halt_hash, decrement);
+    }
 
     /* set halt seconds to value found in our halt hash */
     int halt_seconds;
@@ -396,6 +669,13 @@ static int scr_check_flush(scr_cache_index* map)
     need_flush = 1;
   }
 
+  /* urgent datasets are always flushed, even if the checkpoint
+   * interval would otherwise skip this one */
+  int is_urgent = scr_dataset_is_urgent(dataset);
+  if (is_urgent) {
+    need_flush = 1;
+  }
+
   /* check whether user has flush enabled */
   if (scr_flush > 0) {
     /* if this is a checkpoint, then every scr_flush checkpoints, flush the checkpoint set */
@@ -413,10 +693,20 @@ static int scr_check_flush(scr_cache_index* map)
         scr_dbg(2, "async flush attempt @ %s:%d", __FILE__, __LINE__);;
       }
 
-      /* check that we don't start an async flush if one is already in progress */
-      if (scr_flush_async_in_progress) {
-        /* we need to flush the current dataset, however, another flush is ongoing,
-         * so wait for this other flush to complete before starting the next one */
+      /* complete any outstanding flushes that have finished */
+      if (scr_flush_async_progress(scr_cindex) != SCR_SUCCESS) {
+        scr_abort(-1, "Flush of dataset failed @ %s:%d",
+          __FILE__, __LINE__
+        );
+      }
+
+      /* check that we don't exceed the limit on outstanding async flushes,
+       * urgent datasets skip this wait and start immediately, ahead of
+       * whatever is already queued */
+      if (! is_urgent && scr_flush_async_in_progress >= scr_flush_async_depth) {
+        /* we need to flush the current dataset, however, we're already
+         * at the limit of ongoing flushes, so wait for those to complete
+         * before starting the next one */
         int flush_rc = scr_flush_async_wait(scr_cindex);
         if (flush_rc != SCR_SUCCESS) {
           scr_abort(-1, "Flush of dataset %d failed @ %s:%d",
@@ -447,163 +737,901 @@ static int scr_check_flush(scr_cache_index* map)
   return SCR_SUCCESS;
 }
 
-/* given a dataset id and a filename,
- * return the full path to the file which the caller should use to access the file */
-static int scr_route_file(int id, const char* file, char* newfile, int n)
-{
-  /* check that we got a file and newfile to write to */
-  if (file == NULL || strcmp(file, "") == 0 || newfile == NULL) {
-    return SCR_FAILURE;
-  }
-
-  /* check that user's filename is not too long */
-  if (strlen(file) >= SCR_MAX_FILENAME) {
-    scr_abort(-1, "file name (%s) is longer than SCR_MAX_FILENAME (%d) @ %s:%d",
-      file, SCR_MAX_FILENAME, __FILE__, __LINE__
-    );
-  }
+/*
+=========================================
+Background fetch during SCR_Init
+=========================================
+*/
 
-  /* convert path string to path object */
-  spath* path_file = spath_from_str(file);
+/* when SCR_FETCH_ASYNC is set, SCR_Init starts the fetch of the latest
+ * checkpoint in a background thread and returns, the thread is joined
+ * the first time the application asks about its restart state */
+static pthread_t scr_prefetch_thread;
+static int scr_prefetch_running   = 0;           /* set while the background fetch is active */
+static int scr_prefetch_rc        = SCR_SUCCESS; /* return code of the background fetch */
+static int scr_prefetch_attempted = 0;           /* whether the background fetch was attempted */
 
-  /* determine whether we're in bypass mode for this dataset */
-  int bypass = 0;
-  scr_cache_index_get_bypass(scr_cindex, id, &bypass);
+static void* scr_prefetch_func(void* arg)
+{
+  scr_prefetch_rc = scr_fetch_latest(scr_cindex, &scr_prefetch_attempted);
+  return NULL;
+}
 
-  /* if we're in bypass route file to its location in prefix directory,
-   * otherwise place it in a cache directory */
-  if (bypass) {
-    /* build absolute path to file */
-    if (! spath_is_absolute(path_file)) {
-      /* the path is not absolute, so prepend the current working directory */
-      char cwd[SCR_MAX_FILENAME];
-      if (scr_getcwd(cwd, sizeof(cwd)) == SCR_SUCCESS) {
-        spath_prepend_str(path_file, cwd);
-      } else {
-        /* problem acquiring current working directory */
-        scr_abort(-1, "Failed to build absolute path to %s @ %s:%d",
-          file, __FILE__, __LINE__
-        );
-      }
+/* kick off fetch of latest checkpoint in a background thread,
+ * returns SCR_FAILURE if the thread cannot be started, in which case
+ * the caller should fall back to a synchronous fetch */
+static int scr_prefetch_start(void)
+{
+  /* the background fetch issues MPI collectives from a second thread,
+   * which is only legal when MPI provides full thread support */
+  int provided;
+  MPI_Query_thread(&provided);
+  if (provided != MPI_THREAD_MULTIPLE) {
+    if (scr_my_rank_world == 0) {
+      scr_dbg(1, "Disabling background fetch: MPI_THREAD_MULTIPLE is not provided");
     }
-
-    /* TODO: should we check path is a child in prefix here? */
-  } else {
-    /* lookup the cache directory for this dataset */
-    char* dir = NULL;
-    scr_cache_index_get_dir(scr_cindex, id, &dir);
-
-    /* chop file to just the file name and prepend directory */
-    spath_basename(path_file);
-    spath_prepend_str(path_file, dir);
+    return SCR_FAILURE;
   }
 
-  /* simplify the absolute path (removes "." and ".." entries) */
-  spath_reduce(path_file);
-
-  /* copy to user's buffer */
-  size_t n_size = (size_t) n;
-  spath_strcpy(newfile, n_size, path_file);
-
-  /* free the file path */
-  spath_delete(&path_file);
+  /* start the fetch thread */
+  if (pthread_create(&scr_prefetch_thread, NULL, scr_prefetch_func, NULL) != 0) {
+    scr_err("Failed to start background fetch thread @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
 
+  scr_prefetch_running = 1;
   return SCR_SUCCESS;
 }
 
-/* given the current state, abort with an informative error message */
-static void scr_state_transition_error(int state, const char* function, const char* file, int line)
+/* wait for a background fetch started during SCR_Init to finish,
+ * and apply the same cache cleanup as a synchronous fetch,
+ * this is a no-op if no background fetch is running */
+static void scr_prefetch_finish(void)
 {
-  switch(state) {
-  case SCR_STATE_UNINIT:
-    /* tried to call some SCR function while uninitialized */
-    scr_abort(-1, "Must call SCR_Init() before %s @ %s:%d",
-      function, file, line
-    );
-    break;
-  case SCR_STATE_RESTART:
-    /* tried to call some SCR function while in Start_restart region */
-    scr_abort(-1, "Must call SCR_Complete_restart() before %s @ %s:%d",
-      function, file, line
-    );
-    break;
-  case SCR_STATE_CHECKPOINT:
-    /* tried to call some SCR function while in Start_checkpoint region */
-    scr_abort(-1, "Must call SCR_Complete_checkpoint() before %s @ %s:%d",
-      function, file, line
-    );
-    break;
-  case SCR_STATE_OUTPUT:
-    /* tried to call some SCR function while in Start_output region */
-    scr_abort(-1, "Must call SCR_Complete_output() before %s @ %s:%d",
-      function, file, line
-    );
-    break;
+  if (! scr_prefetch_running) {
+    return;
   }
 
-  /* fall back message, less informative, but at least something */
-  scr_abort(-1, "Called %s from invalid state %d @ %s:%d",
-    function, state, file, line
-  );
+  /* wait for the fetch thread */
+  pthread_join(scr_prefetch_thread, NULL);
+  scr_prefetch_running = 0;
 
-  return;
+  /* if the fetch failed, clear the cache just like a synchronous
+   * fetch failure during SCR_Init would */
+  if (scr_prefetch_rc != SCR_SUCCESS) {
+    scr_cache_purge(scr_cindex);
+    scr_dataset_id    = 0;
+    scr_checkpoint_id = 0;
+    scr_ckpt_dset_id  = 0;
+
+    if (scr_my_rank_world == 0 && scr_prefetch_attempted) {
+      scr_err("Failed to fetch checkpoint set into cache. Restarting from the beginning @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* now that the fetch has settled, we know whether we have a restart */
+  scr_have_restart = (scr_checkpoint_id > 0);
 }
 
 /*
 =========================================
-Configuration parameters
+Deferred redundancy encoding
 =========================================
 */
 
-/* read in environment variables */
-static int scr_get_params()
+/* when SCR_ENCODE_ASYNC is set, scr_complete_output hands the raw
+ * checkpoint back to the application and computes the redundancy
+ * encoding in a background thread, the thread is joined at the next
+ * SCR call that needs the dataset to be fully protected */
+static pthread_t scr_encode_thread;
+static int scr_encode_running = 0;            /* set while the background encode is active */
+static volatile int scr_encode_done = 0;      /* set by the encode thread when it has finished */
+static int scr_encode_rc      = SCR_SUCCESS;  /* return code of the background encode */
+static int scr_encode_final_rc = SCR_SUCCESS; /* result of the most recent completed encode */
+static scr_filemap* scr_encode_map = NULL;    /* filemap kept alive for the encode thread */
+static const scr_reddesc* scr_encode_rd = NULL; /* redundancy descriptor being applied */
+static int scr_encode_id        = -1;         /* dataset id being encoded */
+static int scr_encode_is_ckpt   = 0;          /* whether that dataset is a checkpoint */
+static int scr_encode_is_output = 0;          /* whether that dataset is output */
+static int scr_encode_flush_started = 0;      /* set when a pipelined flush was started before the encode */
+
+/* defined below, the scrubber must stop before we delete from cache */
+static int scr_scrub_stop(void);
+
+static void* scr_encode_func(void* arg)
 {
-  const char* value;
-  kvtree* tmp;
-  double d;
-  unsigned long long ull;
+  scr_encode_rc = scr_reddesc_apply(scr_encode_map, scr_encode_rd, scr_encode_id);
+  scr_encode_done = 1;
+  return NULL;
+}
 
-  /* user may want to disable SCR at runtime, read env var to avoid reading config files */
-  if ((value = getenv("SCR_ENABLE")) != NULL) {
-    scr_enabled = atoi(value);
+/* kick off redundancy encoding in a background thread,
+ * returns SCR_SUCCESS if the encode was deferred on all ranks,
+ * otherwise the encode is executed before returning and its result
+ * is stored in inline_rc, takes ownership of map when deferred */
+static int scr_encode_start(
+  scr_filemap* map,
+  const scr_reddesc* rd,
+  int id,
+  int is_ckpt,
+  int is_output,
+  int* inline_rc)
+{
+  /* the encode thread issues MPI collectives from a second thread,
+   * which is only legal when MPI provides full thread support */
+  int provided;
+  MPI_Query_thread(&provided);
+  if (provided != MPI_THREAD_MULTIPLE) {
+    if (scr_my_rank_world == 0) {
+      scr_dbg(1, "Disabling deferred encoding: MPI_THREAD_MULTIPLE is not provided");
+    }
+    *inline_rc = scr_reddesc_apply(map, rd, id);
+    return SCR_FAILURE;
   }
 
-  /* if not enabled, bail with an error */
-  if (! scr_enabled) {
+  /* record state for the encode thread */
+  scr_encode_map       = map;
+  scr_encode_rd        = rd;
+  scr_encode_id        = id;
+  scr_encode_is_ckpt   = is_ckpt;
+  scr_encode_is_output = is_output;
+  scr_encode_rc        = SCR_SUCCESS;
+  scr_encode_done      = 0;
+
+  /* start the encode thread */
+  int started = (pthread_create(&scr_encode_thread, NULL, scr_encode_func, NULL) == 0);
+
+  /* the encode is collective, so we can only defer it if every rank
+   * managed to start its thread, otherwise ranks without a thread
+   * run the encode inline while ranks with a thread wait on theirs,
+   * which amounts to the same synchronous encode either way */
+  if (! scr_alltrue(started, scr_comm_world)) {
+    if (started) {
+      pthread_join(scr_encode_thread, NULL);
+      *inline_rc = scr_encode_rc;
+    } else {
+      scr_err("Failed to start encode thread @ %s:%d",
+        __FILE__, __LINE__
+      );
+      *inline_rc = scr_reddesc_apply(map, rd, id);
+    }
+    scr_encode_map = NULL;
+    scr_encode_rd  = NULL;
     return SCR_FAILURE;
   }
 
-  /* read in our configuration parameters */
-  scr_param_init();
+  /* mark dataset in the cache index so restart logic knows its
+   * redundancy data is not yet complete */
+  scr_cache_index_set_encoding(scr_cindex, id, 1);
+  scr_cache_index_write(scr_cindex_file, scr_cindex);
 
-  /* check enabled parameter again, this time including settings from config files */
-  if ((value = scr_param_get("SCR_ENABLE")) != NULL) {
-    scr_enabled = atoi(value);
-  }
+  scr_encode_running = 1;
+  return SCR_SUCCESS;
+}
 
-  /* if not enabled, bail with an error */
-  if (! scr_enabled) {
-    scr_param_finalize();
-    return SCR_FAILURE;
+/* wait for a deferred encode to finish and run the bookkeeping that
+ * scr_complete_output skipped: record the flush file entry and check
+ * halt and flush conditions on success, or drop the dataset from
+ * cache on failure, this is a no-op if no encode is outstanding */
+static int scr_encode_finish(void)
+{
+  if (! scr_encode_running) {
+    return SCR_SUCCESS;
   }
 
-  /* set debug verbosity level */
-  if ((value = scr_param_get("SCR_DEBUG")) != NULL) {
-    scr_debug = atoi(value);
-  }
+  /* wait for the encode thread */
+  pthread_join(scr_encode_thread, NULL);
+  scr_encode_running = 0;
+  int rc = scr_encode_rc;
+  int id = scr_encode_id;
 
-  /* set scr_prefix_path and scr_prefix */
-  value = scr_param_get("SCR_PREFIX");
-  scr_prefix_path = scr_get_prefix(value);
-  scr_prefix = spath_strdup(scr_prefix_path);
+  /* encoding is settled one way or the other, clear the marker */
+  scr_cache_index_set_encoding(scr_cindex, id, 0);
+  scr_cache_index_write(scr_cindex_file, scr_cindex);
 
-  /* define the path to the .scr subdir within the prefix dir */
-  spath* path_prefix_scr = spath_dup(scr_prefix_path);
-  spath_append_str(path_prefix_scr, ".scr");
-  scr_prefix_scr = spath_strdup(path_prefix_scr);
-  spath_delete(&path_prefix_scr);
+  /* get the dataset corresponding to this id */
+  scr_dataset* dataset = scr_dataset_new();
+  scr_cache_index_get_dataset(scr_cindex, id, dataset);
 
-  /* TODO: create store descriptor for prefix directory */
+  if (rc == SCR_SUCCESS) {
+    /* apply any dataset-level sync policy for the store now that
+     * the encode has finished writing its redundancy files */
+    int sync_store = scr_storedescs_index_from_name(scr_encode_rd->base);
+    if (sync_store >= 0 && sync_store < scr_nstoredescs) {
+      scr_storedesc_sync_dataset(&scr_storedescs[sync_store]);
+    }
+
+    /* record entry in flush file for this dataset, with a pipelined
+     * flush the entry was recorded and the flush check already ran
+     * before the encode started, so only the halt check remains */
+    if (! scr_encode_flush_started) {
+      char* dset_name;
+      scr_dataset_get_name(dataset, &dset_name);
+      scr_flush_file_new_entry(id, dset_name, dataset, SCR_FLUSH_KEY_LOCATION_CACHE,
+        scr_encode_is_ckpt, scr_encode_is_output);
+    }
+
+    /* check_flush may start an async flush, whereas check_halt will call sync flush,
+     * so place check_flush after check_halt */
+    if (scr_encode_is_ckpt) {
+      /* only halt on checkpoints */
+      scr_bool_check_halt_and_decrement(SCR_TEST_AND_HALT, 1);
+    }
+    if (! scr_encode_flush_started) {
+      scr_check_flush(scr_cindex);
+    }
+    scr_encode_flush_started = 0;
+  } else {
+    /* the encode failed, the dataset is not protected,
+     * so delete it from cache to conserve space,
+     * a pipelined flush started before the encode is still reading
+     * the data files, so wait for it to drain before deleting them */
+    scr_err("Deferred encode of dataset %d failed @ %s:%d",
+      id, __FILE__, __LINE__
+    );
+    if (scr_encode_flush_started) {
+      scr_flush_async_wait(scr_cindex);
+      scr_encode_flush_started = 0;
+    }
+    scr_scrub_stop();
+    scr_cache_delete(scr_cindex, id);
+  }
+
+  scr_dataset_delete(&dataset);
+
+  /* free the filemap we kept alive for the encode thread */
+  scr_filemap_delete(&scr_encode_map);
+  scr_encode_rd = NULL;
+  scr_encode_id = -1;
+
+  /* remember the result for SCR_Complete_output_test */
+  scr_encode_final_rc = rc;
+
+  return rc;
+}
+
+/*
+=========================================
+Bypass cache mirroring
+=========================================
+*/
+
+/* when SCR_CACHE_MIRROR is set, a bypass dataset written straight
+ * to the parallel file system is copied back into cache by a
+ * background thread once its flush completes, when the copies have
+ * landed everywhere the dataset is re-registered as cached,
+ * redundancy is applied, and its bypass marker is cleared, so a
+ * later failure restarts from cache at node-local speed while the
+ * checkpoint itself still wrote at bypass speed, the thread only
+ * does file I/O, the collective re-registration runs at the next
+ * SCR call that can host it */
+static pthread_t scr_mirror_thread;
+static int scr_mirror_running = 0;       /* set while the mirror thread is active */
+static volatile int scr_mirror_done = 0; /* set by the mirror thread when its copies finish */
+static int scr_mirror_rc = SCR_SUCCESS;  /* result of the background copies */
+static int scr_mirror_id = -1;           /* dataset id being mirrored, -1 if none */
+static const scr_reddesc* scr_mirror_rd = NULL; /* descriptor whose cache we mirror into */
+static scr_filemap* scr_mirror_map = NULL;      /* filemap of cache copies, registered on success */
+static scr_filemap* scr_mirror_orig_map = NULL; /* copy of the bypass filemap, restored on failure */
+static int scr_mirror_nfiles = 0;
+static char** scr_mirror_src = NULL;     /* source files in the prefix directory */
+static char** scr_mirror_dst = NULL;     /* destination files in cache */
+static int scr_mirror_direct = 0;        /* whether to write cache copies with O_DIRECT */
+
+static void* scr_mirror_func(void* arg)
+{
+  int i;
+  for (i = 0; i < scr_mirror_nfiles; i++) {
+    if (scr_file_copy_opts(scr_mirror_src[i], scr_mirror_dst[i],
+          scr_file_buf_size, NULL, scr_mirror_direct) != SCR_SUCCESS)
+    {
+      scr_mirror_rc = SCR_FAILURE;
+      break;
+    }
+  }
+  scr_mirror_done = 1;
+  return NULL;
+}
+
+/* free the file lists and filemaps of the current mirror */
+static void scr_mirror_free(void)
+{
+  int i;
+  for (i = 0; i < scr_mirror_nfiles; i++) {
+    scr_free(&scr_mirror_src[i]);
+    scr_free(&scr_mirror_dst[i]);
+  }
+  scr_free(&scr_mirror_src);
+  scr_free(&scr_mirror_dst);
+  scr_filemap_delete(&scr_mirror_map);
+  scr_filemap_delete(&scr_mirror_orig_map);
+  scr_mirror_nfiles = 0;
+  scr_mirror_id     = -1;
+  scr_mirror_rd     = NULL;
+}
+
+/* unlink whatever cache copies the mirror thread wrote */
+static void scr_mirror_unlink(void)
+{
+  int i;
+  for (i = 0; i < scr_mirror_nfiles; i++) {
+    scr_file_unlink(scr_mirror_dst[i]);
+  }
+}
+
+/* kick off a background mirror of a bypass dataset into cache,
+ * collective, the mirror is skipped on every rank unless every
+ * rank manages to start its thread */
+static int scr_mirror_start(scr_filemap* map, const scr_reddesc* rd, int id)
+{
+  /* only one mirror at a time */
+  if (scr_mirror_running) {
+    return SCR_FAILURE;
+  }
+
+  /* create the cache directory for this dataset, Start_output
+   * skipped this since bypass wrote to the prefix directory */
+  scr_cache_dir_create(rd, id);
+  char* dir = scr_cache_dir_get(rd, id);
+
+  /* write cache copies with O_DIRECT when the store asks for it */
+  scr_mirror_direct = 0;
+  int store_index = scr_storedescs_index_from_name(rd->base);
+  if (store_index >= 0 && store_index < scr_nstoredescs) {
+    scr_mirror_direct = scr_storedescs[store_index].direct;
+  }
+
+  /* snapshot source and destination paths and build the filemap
+   * we'll register if the copies succeed, the meta data carries
+   * over from the bypass entries, keep a copy of the bypass map
+   * so we can restore it if the mirror fails */
+  int nfiles = scr_filemap_num_files(map);
+  scr_mirror_src = (char**) SCR_MALLOC(nfiles * sizeof(char*));
+  scr_mirror_dst = (char**) SCR_MALLOC(nfiles * sizeof(char*));
+  scr_mirror_map = scr_filemap_new();
+  scr_mirror_orig_map = scr_filemap_new();
+  scr_filemap_merge(scr_mirror_orig_map, map);
+  int i = 0;
+  kvtree_elem* elem;
+  for (elem = scr_filemap_first_file(map);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    const char* file = kvtree_elem_key(elem);
+
+    /* take basename of file and prepend cache directory */
+    spath* dpath = spath_from_str(file);
+    spath_basename(dpath);
+    spath_prepend_str(dpath, dir);
+    spath_reduce(dpath);
+    char* dst = spath_strdup(dpath);
+    spath_delete(&dpath);
+
+    scr_mirror_src[i] = strdup(file);
+    scr_mirror_dst[i] = dst;
+
+    scr_filemap_add_file(scr_mirror_map, dst);
+    scr_meta* meta = scr_meta_new();
+    if (scr_filemap_get_meta(map, file, meta) == SCR_SUCCESS) {
+      scr_filemap_set_meta(scr_mirror_map, dst, meta);
+    }
+    scr_meta_delete(&meta);
+
+    i++;
+  }
+  scr_mirror_nfiles = nfiles;
+  scr_mirror_id     = id;
+  scr_mirror_rd     = rd;
+  scr_mirror_rc     = SCR_SUCCESS;
+  scr_mirror_done   = 0;
+  scr_free(&dir);
+
+  /* the re-registration is collective, so only mirror when every
+   * rank gets its thread */
+  int started = (pthread_create(&scr_mirror_thread, NULL, scr_mirror_func, NULL) == 0);
+  if (! scr_alltrue(started, scr_comm_world)) {
+    if (started) {
+      pthread_join(scr_mirror_thread, NULL);
+    }
+    scr_mirror_unlink();
+    scr_mirror_free();
+    return SCR_FAILURE;
+  }
+
+  scr_mirror_running = 1;
+  return SCR_SUCCESS;
+}
+
+/* finalize a completed mirror: register the cache copies, apply
+ * redundancy, and clear the dataset's bypass marker so restart
+ * reads it from cache, collective, when wait is set this blocks
+ * until the background copies finish, otherwise it returns without
+ * doing anything while any rank is still copying */
+static int scr_mirror_progress(int wait)
+{
+  if (! scr_mirror_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* check whether every rank's copies have landed */
+  int done = (scr_mirror_done != 0);
+  if (! wait && ! scr_alltrue(done, scr_comm_world)) {
+    return SCR_SUCCESS;
+  }
+
+  /* collect the thread */
+  pthread_join(scr_mirror_thread, NULL);
+  scr_mirror_running = 0;
+
+  int id = scr_mirror_id;
+  int rc = SCR_SUCCESS;
+  if (scr_alltrue(scr_mirror_rc == SCR_SUCCESS, scr_comm_world)) {
+    /* all copies landed, register them and apply redundancy */
+    scr_cache_set_map(scr_cindex, id, scr_mirror_map);
+    rc = scr_reddesc_apply(scr_mirror_map, scr_mirror_rd, id);
+    if (scr_alltrue(rc == SCR_SUCCESS, scr_comm_world)) {
+      /* dataset is cached and protected, clear its bypass marker
+       * so restart routes reads to cache */
+      scr_cache_index_set_bypass(scr_cindex, id, 0);
+      scr_cache_index_write(scr_cindex_file, scr_cindex);
+      if (scr_my_rank_world == 0) {
+        scr_dbg(1, "Mirrored dataset %d into cache", id);
+      }
+    } else {
+      /* the encode failed, restore the bypass filemap and drop our
+       * copies, the dataset remains protected by the copy in the
+       * prefix directory */
+      scr_cache_set_map(scr_cindex, id, scr_mirror_orig_map);
+      scr_mirror_unlink();
+      rc = SCR_FAILURE;
+    }
+  } else {
+    /* some rank failed to copy, drop whatever landed and leave the
+     * dataset as bypass */
+    scr_mirror_unlink();
+    rc = SCR_FAILURE;
+  }
+
+  scr_mirror_free();
+  return rc;
+}
+
+/*
+=========================================
+Background CRC scrubber
+=========================================
+*/
+
+/* when SCR_SCRUB is set, a background thread re-reads cached files
+ * during compute phases and verifies them against the CRCs recorded
+ * in their meta data (see SCR_CRC_ON_COPY), a dataset that fails is
+ * marked in the cache index so flush refuses to copy known-bad data
+ * and restart rebuilds it from redundancy data, the thread only
+ * touches plain file I/O, it works from a task list snapshotted on
+ * the main thread and is stopped before any SCR call that may
+ * modify the cache */
+
+/* one unit of scrub work, built on the main thread */
+struct scr_scrub_task {
+  int id;            /* dataset id the file belongs to */
+  char* file;        /* path to file in cache */
+  unsigned long crc; /* crc32 recorded in the file's meta data */
+};
+
+static pthread_t scr_scrub_thread;
+static int scr_scrub_running = 0;       /* set while the scrubber thread is active */
+static volatile int scr_scrub_quit = 0; /* tells the scrubber to stop early */
+
+static struct scr_scrub_task* scr_scrub_tasks = NULL; /* snapshot of files to verify */
+static int scr_scrub_ntasks = 0;                      /* number of tasks in snapshot */
+static int scr_scrub_cursor = 0;                      /* position kept across compute phases */
+
+static int* scr_scrub_bad  = NULL; /* dataset ids that failed verification */
+static int  scr_scrub_nbad = 0;    /* number of entries in bad list */
+
+/* read one file and compare its crc32 against the recorded value,
+ * returns SCR_SUCCESS if the file matches, pauses between chunks to
+ * hold the read rate near scr_scrub_bw bytes/sec */
+static int scr_scrub_check_file(const char* file, unsigned long crc_meta)
+{
+  int fd = scr_open(file, O_RDONLY);
+  if (fd < 0) {
+    /* treat an unreadable file as a failed verification, the caller
+     * filters out files whose dataset has since left the cache */
+    return SCR_FAILURE;
+  }
+
+  /* read the file in chunks, folding each into the crc */
+  int rc = SCR_SUCCESS;
+  uLong crc = scr_crc_init();
+  size_t bufsize = scr_file_buf_size;
+  char* buf = (char*) scr_buf_get(bufsize);
+  if (buf == NULL) {
+    scr_close(file, fd);
+    return SCR_FAILURE;
+  }
+  while (! scr_scrub_quit) {
+    ssize_t nread = scr_read_attempt(file, fd, buf, bufsize);
+    if (nread < 0) {
+      rc = SCR_FAILURE;
+      break;
+    }
+    if (nread == 0) {
+      /* reached end of file, check the final crc value */
+      if (crc != (uLong) crc_meta) {
+        rc = SCR_FAILURE;
+      }
+      break;
+    }
+    crc = scr_crc_update(crc, buf, (size_t) nread);
+
+    /* pause to keep our read rate near the configured budget */
+    if (scr_scrub_bw > 0.0) {
+      double secs = (double) nread / scr_scrub_bw;
+      usleep((useconds_t) (secs * 1000000.0));
+    }
+  }
+  scr_buf_put(buf);
+
+  scr_close(file, fd);
+
+  return rc;
+}
+
+/* scrubber thread, makes one pass over the task list starting from
+ * where the previous compute phase left off */
+static void* scr_scrub_func(void* arg)
+{
+  int checked = 0;
+  while (! scr_scrub_quit && checked < scr_scrub_ntasks) {
+    struct scr_scrub_task* task = &scr_scrub_tasks[scr_scrub_cursor % scr_scrub_ntasks];
+    if (scr_scrub_check_file(task->file, task->crc) != SCR_SUCCESS && ! scr_scrub_quit) {
+      /* remember the dataset id if we don't have it already */
+      int i;
+      int known = 0;
+      for (i = 0; i < scr_scrub_nbad; i++) {
+        if (scr_scrub_bad[i] == task->id) {
+          known = 1;
+        }
+      }
+      if (! known) {
+        scr_scrub_bad[scr_scrub_nbad] = task->id;
+        scr_scrub_nbad++;
+      }
+    }
+    scr_scrub_cursor = (scr_scrub_cursor + 1) % scr_scrub_ntasks;
+    checked++;
+  }
+  return NULL;
+}
+
+/* free the scrub task snapshot */
+static void scr_scrub_free_tasks(void)
+{
+  int i;
+  for (i = 0; i < scr_scrub_ntasks; i++) {
+    scr_free(&scr_scrub_tasks[i].file);
+  }
+  scr_free(&scr_scrub_tasks);
+  scr_free(&scr_scrub_bad);
+  scr_scrub_ntasks = 0;
+  scr_scrub_nbad   = 0;
+}
+
+/* snapshot the list of cached files that carry CRCs and kick off the
+ * scrubber thread, called as we return to the application */
+static int scr_scrub_start(void)
+{
+  if (! scr_scrub || scr_scrub_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* drop any prior snapshot */
+  scr_scrub_free_tasks();
+
+  /* get list of datasets in cache */
+  int ndsets;
+  int* dsets;
+  scr_cache_index_list_datasets(scr_cindex, &ndsets, &dsets);
+
+  /* count and collect one task per cached file with a recorded crc */
+  int cap = 0;
+  int d;
+  for (d = 0; d < ndsets; d++) {
+    int id = dsets[d];
+
+    /* bypass datasets live on the parallel file system, not on the
+     * cache devices we are scrubbing */
+    int bypass = 0;
+    scr_cache_index_get_bypass(scr_cindex, id, &bypass);
+    if (bypass) {
+      continue;
+    }
+
+    /* skip datasets we've already flagged */
+    int failed = 0;
+    scr_cache_index_get_failed(scr_cindex, id, &failed);
+    if (failed) {
+      continue;
+    }
+
+    /* read the filemap for this dataset */
+    scr_filemap* map = scr_filemap_new();
+    scr_cache_get_map(scr_cindex, id, map);
+
+    /* add a task for each file that has a crc in its meta data */
+    kvtree_elem* file_elem;
+    for (file_elem = scr_filemap_first_file(map);
+         file_elem != NULL;
+         file_elem = kvtree_elem_next(file_elem))
+    {
+      char* file = kvtree_elem_key(file_elem);
+
+      scr_meta* meta = scr_meta_new();
+      uLong crc;
+      if (scr_filemap_get_meta(map, file, meta) == SCR_SUCCESS &&
+          scr_meta_get_crc32(meta, &crc) == SCR_SUCCESS)
+      {
+        if (scr_scrub_ntasks >= cap) {
+          cap = (cap > 0) ? cap * 2 : 64;
+          scr_scrub_tasks = (struct scr_scrub_task*) realloc(scr_scrub_tasks, cap * sizeof(struct scr_scrub_task));
+          if (scr_scrub_tasks == NULL) {
+            scr_abort(-1, "Failed to allocate scrub task list @ %s:%d",
+              __FILE__, __LINE__
+            );
+          }
+        }
+        scr_scrub_tasks[scr_scrub_ntasks].id   = id;
+        scr_scrub_tasks[scr_scrub_ntasks].file = strdup(file);
+        scr_scrub_tasks[scr_scrub_ntasks].crc  = (unsigned long) crc;
+        scr_scrub_ntasks++;
+      }
+      scr_meta_delete(&meta);
+    }
+
+    scr_filemap_delete(&map);
+  }
+  scr_free(&dsets);
+
+  /* nothing to verify */
+  if (scr_scrub_ntasks == 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* worst case every task belongs to a distinct dataset */
+  scr_scrub_bad = (int*) SCR_MALLOC(scr_scrub_ntasks * sizeof(int));
+
+  /* start the scrubber thread */
+  scr_scrub_quit = 0;
+  if (pthread_create(&scr_scrub_thread, NULL, scr_scrub_func, NULL) != 0) {
+    /* couldn't start the thread, we'll try again next compute phase */
+    scr_scrub_free_tasks();
+    return SCR_FAILURE;
+  }
+
+  scr_scrub_running = 1;
+  return SCR_SUCCESS;
+}
+
+/* stop the scrubber thread and flag any datasets that failed
+ * verification, called on entry to SCR calls that may modify
+ * the cache */
+static int scr_scrub_stop(void)
+{
+  if (! scr_scrub_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* signal the thread and wait for it */
+  scr_scrub_quit = 1;
+  pthread_join(scr_scrub_thread, NULL);
+  scr_scrub_running = 0;
+
+  /* mark datasets that failed verification, skipping any that have
+   * left the cache since the snapshot was taken, their files were
+   * deleted out from under the scrubber rather than corrupt */
+  int i;
+  for (i = 0; i < scr_scrub_nbad; i++) {
+    int id = scr_scrub_bad[i];
+    char* dir = NULL;
+    if (scr_cache_index_get_dir(scr_cindex, id, &dir) == SCR_SUCCESS) {
+      scr_err("Scrubber found CRC mismatch in cached dataset %d, marking it as failed @ %s:%d",
+        id, __FILE__, __LINE__
+      );
+      scr_cache_index_set_failed(scr_cindex, id, 1);
+      scr_cache_index_write(scr_cindex_file, scr_cindex);
+
+      /* log the event so it shows up alongside other failures */
+      if (scr_log_enable) {
+        scr_log_event("SCRUB_FAIL", NULL, &id, NULL, NULL, NULL);
+      }
+    }
+  }
+  scr_scrub_nbad = 0;
+
+  return SCR_SUCCESS;
+}
+
+/* given a dataset id and a filename,
+ * return the full path to the file which the caller should use to access the file */
+/* keys for route cache entries */
+#define SCR_ROUTE_KEY_FILE ("FILE")
+#define SCR_ROUTE_KEY_PATH ("PATH")
+#define SCR_ROUTE_KEY_DIR  ("DIR")
+
+/* cache of resolved file routes and created directories for the
+ * current output dataset, so routing the same file a second time
+ * and re-creating its directory become simple lookups */
+static kvtree* scr_route_cache = NULL;
+static int scr_route_cache_id  = -1;
+
+/* serializes access to the state Route_file mutates (the filemap,
+ * the route cache, and the filemap file in cache), so that worker
+ * threads can call SCR_Route_file concurrently during output,
+ * routing makes no MPI calls, so this requires no more than
+ * MPI_THREAD_FUNNELED as long as the collective SCR calls are still
+ * made by a single thread with no Route_file calls in flight */
+static pthread_mutex_t scr_route_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int scr_route_file(int id, const char* file, char* newfile, int n)
+{
+  /* check that we got a file and newfile to write to */
+  if (file == NULL || strcmp(file, "") == 0 || newfile == NULL) {
+    return SCR_FAILURE;
+  }
+
+  /* check that user's filename is not too long */
+  if (strlen(file) >= SCR_MAX_FILENAME) {
+    scr_abort(-1, "file name (%s) is longer than SCR_MAX_FILENAME (%d) @ %s:%d",
+      file, SCR_MAX_FILENAME, __FILE__, __LINE__
+    );
+  }
+
+  /* convert path string to path object */
+  spath* path_file = spath_from_str(file);
+
+  /* determine whether we're in bypass mode for this dataset */
+  int bypass = 0;
+  scr_cache_index_get_bypass(scr_cindex, id, &bypass);
+
+  /* if we're in bypass route file to its location in prefix directory,
+   * otherwise place it in a cache directory */
+  if (bypass) {
+    /* build absolute path to file */
+    if (! spath_is_absolute(path_file)) {
+      /* the path is not absolute, so prepend the current working directory */
+      char cwd[SCR_MAX_FILENAME];
+      if (scr_getcwd(cwd, sizeof(cwd)) == SCR_SUCCESS) {
+        spath_prepend_str(path_file, cwd);
+      } else {
+        /* problem acquiring current working directory */
+        scr_abort(-1, "Failed to build absolute path to %s @ %s:%d",
+          file, __FILE__, __LINE__
+        );
+      }
+    }
+
+    /* TODO: should we check path is a child in prefix here? */
+  } else {
+    /* lookup the cache directory for this dataset */
+    char* dir = NULL;
+    scr_cache_index_get_dir(scr_cindex, id, &dir);
+
+    /* chop file to just the file name and prepend directory */
+    spath_basename(path_file);
+    spath_prepend_str(path_file, dir);
+  }
+
+  /* simplify the absolute path (removes "." and ".." entries) */
+  spath_reduce(path_file);
+
+  /* copy to user's buffer */
+  size_t n_size = (size_t) n;
+  spath_strcpy(newfile, n_size, path_file);
+
+  /* free the file path */
+  spath_delete(&path_file);
+
+  return SCR_SUCCESS;
+}
+
+/* given the current state, abort with an informative error message */
+static void scr_state_transition_error(int state, const char* function, const char* file, int line)
+{
+  switch(state) {
+  case SCR_STATE_UNINIT:
+    /* tried to call some SCR function while uninitialized */
+    scr_abort(-1, "Must call SCR_Init() before %s @ %s:%d",
+      function, file, line
+    );
+    break;
+  case SCR_STATE_RESTART:
+    /* tried to call some SCR function while in Start_restart region */
+    scr_abort(-1, "Must call SCR_Complete_restart() before %s @ %s:%d",
+      function, file, line
+    );
+    break;
+  case SCR_STATE_CHECKPOINT:
+    /* tried to call some SCR function while in Start_checkpoint region */
+    scr_abort(-1, "Must call SCR_Complete_checkpoint() before %s @ %s:%d",
+      function, file, line
+    );
+    break;
+  case SCR_STATE_OUTPUT:
+    /* tried to call some SCR function while in Start_output region */
+    scr_abort(-1, "Must call SCR_Complete_output() before %s @ %s:%d",
+      function, file, line
+    );
+    break;
+  }
+
+  /* fall back message, less informative, but at least something */
+  scr_abort(-1, "Called %s from invalid state %d @ %s:%d",
+    function, state, file, line
+  );
+
+  return;
+}
+
+/*
+=========================================
+Configuration parameters
+=========================================
+*/
+
+/* read in environment variables */
+static int scr_get_params()
+{
+  const char* value;
+  kvtree* tmp;
+  double d;
+  unsigned long long ull;
+
+  /* user may want to disable SCR at runtime, read env var to avoid reading config files */
+  if ((value = getenv("SCR_ENABLE")) != NULL) {
+    scr_enabled = atoi(value);
+  }
+
+  /* if not enabled, bail with an error */
+  if (! scr_enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* read in our configuration parameters */
+  scr_param_init();
+
+  /* check enabled parameter again, this time including settings from config files */
+  if ((value = scr_param_get("SCR_ENABLE")) != NULL) {
+    scr_enabled = atoi(value);
+  }
+
+  /* if not enabled, bail with an error */
+  if (! scr_enabled) {
+    scr_param_finalize();
+    return SCR_FAILURE;
+  }
+
+  /* set debug verbosity level */
+  if ((value = scr_param_get("SCR_DEBUG")) != NULL) {
+    scr_debug = atoi(value);
+  }
+
+  /* set scr_prefix_path and scr_prefix */
+  value = scr_param_get("SCR_PREFIX");
+  scr_prefix_path = scr_get_prefix(value);
+  scr_prefix = spath_strdup(scr_prefix_path);
+
+  /* define the path to the .scr subdir within the prefix dir */
+  spath* path_prefix_scr = spath_dup(scr_prefix_path);
+  spath_append_str(path_prefix_scr, ".scr");
+  scr_prefix_scr = spath_strdup(path_prefix_scr);
+  spath_delete(&path_prefix_scr);
+
+  /* TODO: create store descriptor for prefix directory */
   /* create the .scr subdirectory */
   if (scr_my_rank_world == 0) {
     mode_t mode_dir = scr_getmode(1, 1, 1);
@@ -729,6 +1757,38 @@ static int scr_get_params()
     kvtree_set(scr_groupdesc_hash, SCR_CONFIG_KEY_GROUPDESC, tmp);
   }
 
+  /* merge group entries from a failure-domain map file if one is given,
+   * the file uses the same syntax as GROUPS entries in scr.conf, e.g.,
+   *   GROUPS=atlas23 RACK=r4 ROW=row2
+   * so an admin can describe shared power and switch domains in one
+   * place, pointing SCR_GROUP at one of these names then spreads
+   * redundancy set members across those domains instead of just nodes */
+  if ((value = scr_param_get("SCR_FAILURE_DOMAIN_FILE")) != NULL) {
+    kvtree* domain_hash = kvtree_new();
+    if (scr_config_read(value, domain_hash) == SCR_SUCCESS) {
+      /* merge entries for each host under any existing GROUPS entries */
+      kvtree* domain_groups = kvtree_get(domain_hash, SCR_CONFIG_KEY_GROUPDESC);
+      kvtree_elem* elem;
+      for (elem = kvtree_elem_first(domain_groups);
+           elem != NULL;
+           elem = kvtree_elem_next(elem))
+      {
+        char* host = kvtree_elem_key(elem);
+        kvtree* host_hash = kvtree_set_kv(
+          scr_groupdesc_hash, SCR_CONFIG_KEY_GROUPDESC, host
+        );
+        kvtree_merge(host_hash, kvtree_elem_hash(elem));
+      }
+    } else {
+      /* user asked for topology-aware groups but we can't read the map,
+       * stop rather than silently fall back to node-level protection */
+      scr_abort(-1, "Failed to read failure domain file %s @ %s:%d",
+        value, __FILE__, __LINE__
+      );
+    }
+    kvtree_delete(&domain_hash);
+  }
+
   /* fill in a hash of store descriptors */
   scr_storedesc_hash = kvtree_new();
   tmp = scr_param_get_hash(SCR_CONFIG_KEY_STOREDESC);
@@ -763,6 +1823,12 @@ static int scr_get_params()
     }
   }
 
+  /* specify whether partner descriptors stream copies with the
+   * native one-sided path instead of the ER encode */
+  if ((value = scr_param_get("SCR_PARTNER_RMA")) != NULL) {
+    scr_partner_rma = atoi(value);
+  }
+
   /* specify the number of tasks in xor set */
   if ((value = scr_param_get("SCR_SET_SIZE")) != NULL) {
     scr_set_size = atoi(value);
@@ -773,6 +1839,25 @@ static int scr_get_params()
     scr_set_failures = atoi(value);
   }
 
+  /* specify the number of threads to use when computing the
+   * redundancy encoding */
+  if ((value = scr_param_get("SCR_ENCODE_THREADS")) != NULL) {
+    scr_encode_threads = atoi(value);
+  }
+
+  /* specify whether to defer redundancy encoding to a background
+   * thread so scr_complete_output can return sooner */
+  if ((value = scr_param_get("SCR_ENCODE_ASYNC")) != NULL) {
+    scr_encode_async = atoi(value);
+  }
+
+  /* specify whether to start the async flush of a dataset while its
+   * deferred encode is still running, so the transfer to the parallel
+   * file system overlaps with the encode */
+  if ((value = scr_param_get("SCR_FLUSH_PIPELINE")) != NULL) {
+    scr_flush_pipeline = atoi(value);
+  }
+
   /* specify the group name to protect failures */
   if ((value = scr_param_get("SCR_GROUP")) != NULL) {
     scr_group = strdup(value);
@@ -826,6 +1911,30 @@ static int scr_get_params()
     scr_cache_bypass = atoi(value);
   }
 
+  /* set the threshold below which files are packed into a per-rank
+   * packfile in cache */
+  if ((value = scr_param_get("SCR_CACHE_PACK_SIZE")) != NULL) {
+    if (scr_abtoull(value, &ull) == SCR_SUCCESS) {
+      scr_cache_pack_size = (unsigned long) ull;
+    } else {
+      scr_err("Failed to read SCR_CACHE_PACK_SIZE successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* set whether to reuse a persisted topology snapshot to skip
+   * hostname sorts during group setup */
+  if ((value = scr_param_get("SCR_TOPO_CACHE")) != NULL) {
+    scr_topo_cache = atoi(value);
+  }
+
+  /* set whether to mirror bypass checkpoints back into cache in the
+   * background so a later failure can restart from cache */
+  if ((value = scr_param_get("SCR_CACHE_MIRROR")) != NULL) {
+    scr_cache_mirror = atoi(value);
+  }
+
   /* if job has fewer than SCR_HALT_SECONDS remaining after completing a checkpoint,
    * halt it */
   if ((value = scr_param_get("SCR_HALT_SECONDS")) != NULL) {
@@ -837,6 +1946,29 @@ static int scr_get_params()
     scr_halt_exit = atoi(value);
   }
 
+  /* determine whether rank 0 should run a thread to watch the halt file,
+   * so halt checks only lock and read the file after it has changed */
+  if ((value = scr_param_get("SCR_HALT_WATCH")) != NULL) {
+    scr_halt_watch = atoi(value);
+  }
+
+  /* set the number of seconds between halt file polls by the watcher */
+  if ((value = scr_param_get("SCR_HALT_WATCH_SECONDS")) != NULL) {
+    scr_halt_watch_seconds = atoi(value);
+  }
+
+  /* determine whether to dump per-rank performance counters as JSON
+   * files in the prefix directory at SCR_Finalize */
+  if ((value = scr_param_get("SCR_STATS_DUMP")) != NULL) {
+    scr_stats_dump = atoi(value);
+  }
+
+  /* determine whether to record phase and transfer events in a
+   * binary trace ring in the control directory */
+  if ((value = scr_param_get("SCR_TRACE")) != NULL) {
+    scr_trace = atoi(value);
+  }
+
   /* set MPI buffer size (file chunk size) */
   if ((value = scr_param_get("SCR_MPI_BUF_SIZE")) != NULL) {
     if (scr_abtoull(value, &ull) == SCR_SUCCESS) {
@@ -869,6 +2001,37 @@ static int scr_get_params()
     scr_fetch_width = atoi(value);
   }
 
+  /* specify number of worker threads each process uses to read its
+   * files during fetch */
+  if ((value = scr_param_get("SCR_FETCH_THREADS")) != NULL) {
+    scr_fetch_threads = atoi(value);
+  }
+
+  /* specify whether SCR_Init may fetch the latest checkpoint in a
+   * background thread rather than blocking until the fetch completes */
+  if ((value = scr_param_get("SCR_FETCH_ASYNC")) != NULL) {
+    scr_fetch_async = atoi(value);
+  }
+
+  /* specify whether to fetch files on demand as the restart routes
+   * them rather than copying the full list before restart begins */
+  if ((value = scr_param_get("SCR_FETCH_LAZY")) != NULL) {
+    scr_fetch_lazy = atoi(value);
+  }
+
+  /* specify whether to validate a fetch candidate before copying
+   * its files so a damaged checkpoint is skipped without paying
+   * for a failed fetch attempt */
+  if ((value = scr_param_get("SCR_FETCH_VALIDATE")) != NULL) {
+    scr_fetch_validate = atoi(value);
+  }
+
+  /* specify the AXL transfer type to use when fetching files,
+   * AXL defaults to its multi-stream pthread backend when unset */
+  if ((value = scr_param_get("SCR_FETCH_TYPE")) != NULL) {
+    scr_fetch_type = strdup(value);
+  }
+
   /* allow user to specify checkpoint to start with on fetch */
   if ((value = scr_param_get("SCR_CURRENT")) != NULL) {
     scr_fetch_current = strdup(value);
@@ -884,6 +2047,73 @@ static int scr_get_params()
     scr_flush_width = atoi(value);
   }
 
+  /* specify number of worker threads each process uses to flush its
+   * files during a synchronous flush */
+  if ((value = scr_param_get("SCR_FLUSH_THREADS")) != NULL) {
+    scr_flush_threads = atoi(value);
+  }
+
+  /* specify max number of ranks per node to act as parallel file
+   * system clients during a synchronous flush */
+  if ((value = scr_param_get("SCR_FLUSH_LEADERS")) != NULL) {
+    scr_flush_leaders = atoi(value);
+  }
+
+  /* specify whether to pack files into per-node container files during flush */
+  if ((value = scr_param_get("SCR_FLUSH_CONTAINER")) != NULL) {
+    scr_flush_container = atoi(value);
+  }
+
+  /* specify whether to skip flushing files that have not changed since the last flush */
+  if ((value = scr_param_get("SCR_FLUSH_INCREMENTAL")) != NULL) {
+    scr_flush_incremental = atoi(value);
+  }
+
+  /* number of consecutive slow flushes before a node is reported as a straggler */
+  if ((value = scr_param_get("SCR_FLUSH_STRAGGLER")) != NULL) {
+    scr_flush_straggler = atoi(value);
+  }
+
+  /* aggregate bandwidth limit imposed during flush (in bytes/sec) */
+  if ((value = scr_param_get("SCR_FLUSH_BW")) != NULL) {
+    if (scr_atod(value, &d) == SCR_SUCCESS) {
+      scr_flush_bw = d;
+    } else {
+      scr_err("Failed to read SCR_FLUSH_BW successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* bandwidth limit applied to datasets marked SCR_FLAG_BULK (in bytes/sec) */
+  if ((value = scr_param_get("SCR_FLUSH_BW_BULK")) != NULL) {
+    if (scr_atod(value, &d) == SCR_SUCCESS) {
+      scr_flush_bw_bulk = d;
+    } else {
+      scr_err("Failed to read SCR_FLUSH_BW_BULK successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* number of ranks gathered into each rank2file part file during flush */
+  if ((value = scr_param_get("SCR_RANK2FILE_SHARD")) != NULL) {
+    scr_rank2file_shard = atoi(value);
+  }
+
+  /* specify whether to compress file data during flush */
+  if ((value = scr_param_get("SCR_FLUSH_COMPRESSION")) != NULL) {
+    if (strcasecmp(value, "zlib") == 0) {
+      scr_flush_compress = 1;
+    } else if (strcasecmp(value, "none") == 0) {
+      scr_flush_compress = 0;
+    } else {
+      scr_err("Unknown value for SCR_FLUSH_COMPRESSION: %s @ %s:%d",
+        value, __FILE__, __LINE__
+      );
+    }
+  }
+
   /* specify whether to always flush latest checkpoint from cache on restart */
   if ((value = scr_param_get("SCR_FLUSH_ON_RESTART")) != NULL) {
     scr_flush_on_restart = atoi(value);
@@ -921,6 +2151,36 @@ static int scr_get_params()
     scr_flush_async = atoi(value);
   }
 
+  /* max number of datasets that may be flushing at the same time */
+  if ((value = scr_param_get("SCR_FLUSH_ASYNC_DEPTH")) != NULL) {
+    scr_flush_async_depth = atoi(value);
+    if (scr_flush_async_depth < 1) {
+      scr_flush_async_depth = 1;
+    }
+  }
+
+  /* seconds without byte progress before an async flush is declared stalled (0 disables) */
+  if ((value = scr_param_get("SCR_FLUSH_ASYNC_STALL_SECONDS")) != NULL) {
+    scr_flush_async_stall_secs = atoi(value);
+  }
+
+  /* whether to hand an outstanding async flush off to the standalone
+   * scr_flush_handoff helper at SCR_Finalize instead of blocking to drain it */
+  if ((value = scr_param_get("SCR_FLUSH_HANDOFF")) != NULL) {
+    scr_flush_handoff = atoi(value);
+  }
+
+  /* chunk size for per-chunk crc32 markers used to resume interrupted flushes (in bytes) */
+  if ((value = scr_param_get("SCR_FLUSH_CHUNK_SIZE")) != NULL) {
+    if (scr_abtoull(value, &ull) == SCR_SUCCESS) {
+      scr_flush_chunk_size = (unsigned long) ull;
+    } else {
+      scr_err("Failed to read SCR_FLUSH_CHUNK_SIZE successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
   /* bandwidth limit imposed during async flush (in bytes/sec) */
   if ((value = scr_param_get("SCR_FLUSH_ASYNC_BW")) != NULL) {
     if (scr_atod(value, &d) == SCR_SUCCESS) {
@@ -969,6 +2229,67 @@ static int scr_get_params()
     scr_crc_on_delete = atoi(value);
   }
 
+  /* specify whether to verify cached files against recorded CRCs in
+   * a background thread between SCR calls */
+  if ((value = scr_param_get("SCR_SCRUB")) != NULL) {
+    scr_scrub = atoi(value);
+  }
+
+  /* per-process read bandwidth consumed by the scrubber (in bytes/sec) */
+  if ((value = scr_param_get("SCR_SCRUB_BW")) != NULL) {
+    if (scr_atod(value, &d) == SCR_SUCCESS) {
+      scr_scrub_bw = d;
+    } else {
+      scr_err("Failed to read SCR_SCRUB_BW successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* specify whether to delete evicted datasets from cache in a
+   * background thread */
+  if ((value = scr_param_get("SCR_DELETE_ASYNC")) != NULL) {
+    scr_delete_async = atoi(value);
+  }
+
+  /* specify whether to write flushed files to the parallel file
+   * system with O_DIRECT */
+  if ((value = scr_param_get("SCR_FLUSH_DIRECT")) != NULL) {
+    scr_flush_direct = atoi(value);
+  }
+
+  /* specify whether to dedup unchanged blocks between consecutive
+   * flushes */
+  if ((value = scr_param_get("SCR_DEDUP")) != NULL) {
+    scr_dedup = atoi(value);
+  }
+
+  /* set block size used to hash and match content during dedup */
+  if ((value = scr_param_get("SCR_DEDUP_BLOCK")) != NULL) {
+    if (scr_abtoull(value, &ull) == SCR_SUCCESS) {
+      scr_dedup_block = (size_t) ull;
+    } else {
+      scr_err("Failed to read SCR_DEDUP_BLOCK successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* select checksum engine used when computing file CRCs,
+   * CRC32C can use the crc32 instruction on cpus that have it,
+   * but its values do not match metadata recorded with the ZLIB engine */
+  if ((value = scr_param_get("SCR_CRC_TYPE")) != NULL) {
+    if (strcasecmp(value, "ZLIB") == 0) {
+      scr_crc_type = SCR_CRC_TYPE_ZLIB;
+    } else if (strcasecmp(value, "CRC32C") == 0) {
+      scr_crc_type = SCR_CRC_TYPE_CRC32C;
+    } else {
+      scr_err("Unknown value for SCR_CRC_TYPE: %s @ %s:%d",
+        value, __FILE__, __LINE__
+      );
+    }
+  }
+
   /* override default checkpoint interval
    * (number of times to call Need_checkpoint between checkpoints) */
   if ((value = scr_param_get("SCR_CHECKPOINT_INTERVAL")) != NULL) {
@@ -991,6 +2312,23 @@ static int scr_get_params()
     }
   }
 
+  /* set node MTBF to drive the Young/Daly optimal checkpoint interval */
+  if ((value = scr_param_get("SCR_CHECKPOINT_MTBF_NODE")) != NULL) {
+    if (scr_atod(value, &d) == SCR_SUCCESS) {
+      scr_checkpoint_mtbf_node = d;
+    } else {
+      scr_err("Failed to read SCR_CHECKPOINT_MTBF_NODE successfully @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  /* specify whether to retune redundancy descriptor intervals online
+   * from measured checkpoint costs */
+  if ((value = scr_param_get("SCR_CHECKPOINT_ADAPTIVE")) != NULL) {
+    scr_checkpoint_adaptive = atoi(value);
+  }
+
   /* TODO: allow someone to silence this if they are not using scripts? */
   /* check that user didn't set something different in $SCR_PREFIX or current working dir */
   value = getenv("SCR_PREFIX");
@@ -1032,12 +2370,31 @@ static int scr_start_output(const char* name, int flags)
   /* set the output flag to indicate we have started a new output dataset */
   scr_in_output = 1;
 
+  /* stop the scrubber while we may delete checkpoints from cache */
+  scr_scrub_stop();
+
   /* make sure everyone is ready to start before we delete any existing checkpoints */
   MPI_Barrier(scr_comm_world);
 
+  /* finish any lazy fetch still in flight, we may be about to
+   * delete checkpoints from cache */
+  scr_fetch_lazy_wait(scr_cindex);
+
+  /* settle any outstanding cache mirror before we may delete
+   * datasets from cache */
+  scr_mirror_progress(1);
+
   /* determine whether this is a checkpoint */
   int is_ckpt = (flags & SCR_FLAG_CHECKPOINT);
 
+  /* urgent and bulk are opposing priorities, refuse to accept both */
+  if ((flags & SCR_FLAG_URGENT) && (flags & SCR_FLAG_BULK)) {
+    scr_abort(-1, "SCR_FLAG_URGENT and SCR_FLAG_BULK may not be combined in SCR_Start_output @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
   /* if we have a checkpoint, stop clock recording compute time,
    * we count normal output cost as part of compute time for
    * computing optimal checkpoint frequency */
@@ -1291,7 +2648,7 @@ static int scr_start_output(const char* name, int flags)
 
 /* detect files that have been registered by more than one process,
  * drop filemap entries from all but one process */
-static int scr_assign_ownership(scr_filemap* map, int bypass)
+static int scr_assign_ownership(scr_filemap* map, int bypass, int* multiple_owner_out)
 {
   int rc = SCR_SUCCESS;
 
@@ -1378,14 +2735,10 @@ static int scr_assign_ownership(scr_filemap* map, int bypass)
     }
   }
 
-  /* fatal error if any file is on more than one rank and not in bypass */
-  int any_multiple_owner = 0;
-  MPI_Allreduce(&multiple_owner, &any_multiple_owner, 1, MPI_INT, MPI_LOR, scr_comm_world);
-  if (any_multiple_owner && !bypass) {
-    scr_abort(-1, "Shared file access detected while not in bypass mode @ %s:%d",
-      __FILE__, __LINE__
-    );
-  }
+  /* hand our local shared-file flag back to the caller, which folds
+   * it into its combined allreduce rather than paying for a separate
+   * collective here */
+  *multiple_owner_out = multiple_owner;
 
   /* free dtcmp buffers */
   scr_free(&group_id);
@@ -1405,7 +2758,7 @@ static int scr_assign_ownership(scr_filemap* map, int bypass)
 }
 
 /* end phase for current output dataset */
-static int scr_complete_output(int valid)
+static int scr_complete_output(int valid, int defer)
 {
   /* bail out if there is no active call to Start_output */
   if (! scr_in_output) {
@@ -1424,12 +2777,13 @@ static int scr_complete_output(int valid)
    * set of ranks that share a file, however, that requires fixing up lots of
    * other parts of the code.  For now, ensure that at most one file lists the
    * file in their file map. */
-  rc = scr_assign_ownership(scr_map, scr_rd->bypass);
+  int multiple_owner = 0;
+  rc = scr_assign_ownership(scr_map, scr_rd->bypass, &multiple_owner);
 
   /* count number of files, number of bytes, and record filesize for each file
    * as written by this process */
   int files_valid = valid;
-  unsigned long my_counts[3] = {0, 0, 0};
+  unsigned long my_counts[5] = {0, 0, 0, 0, 0};
   kvtree_elem* elem;
   for (elem = scr_filemap_first_file(scr_map);
        elem != NULL;
@@ -1477,19 +2831,51 @@ static int scr_complete_output(int valid)
     scr_meta_delete(&meta);
   }
 
+  /* pack small files into a per-rank packfile so the encode and
+   * flush phases pay one file's overhead for the whole set, the
+   * packed entries fold into the packfile in the filemap, so the
+   * file and byte counts below are adjusted to match */
+  if (scr_cache_pack_size > 0 && !scr_rd->bypass && rc == SCR_SUCCESS && files_valid) {
+    int pack_files_cut = 0;
+    unsigned long pack_bytes_add = 0;
+    scr_pack_apply(scr_map, scr_dataset_id, &pack_files_cut, &pack_bytes_add);
+    my_counts[0] -= (unsigned long) pack_files_cut;
+    my_counts[1] += pack_bytes_add;
+  }
+
   /* we execute a sum as a logical allreduce to determine whether everyone is valid
    * we interpret the result to be true only if the sum adds up to the number of processes */
   if (files_valid) {
     my_counts[2] = 1;
   }
 
-  /* execute allreduce to total up number of files, bytes, and number of valid ranks */
-  unsigned long total_counts[3];
-  MPI_Allreduce(my_counts, total_counts, 3, MPI_UNSIGNED_LONG, MPI_SUM, scr_comm_world);
+  /* pack remaining per-rank conditions into the same reduction,
+   * count of ranks that found a shared file during ownership
+   * assignment and count of ranks that failed the assignment */
+  my_counts[3] = multiple_owner;
+  my_counts[4] = (rc != SCR_SUCCESS);
+
+  /* execute allreduce to total up number of files, bytes, and number of valid ranks,
+   * along with the ownership check conditions, all in a single collective */
+  unsigned long total_counts[5];
+  MPI_Allreduce(my_counts, total_counts, 5, MPI_UNSIGNED_LONG, MPI_SUM, scr_comm_world);
   unsigned long total_files = total_counts[0];
   unsigned long total_bytes = total_counts[1];
   unsigned long total_valid = total_counts[2];
 
+  /* fatal error if any file is on more than one rank and not in bypass */
+  if (total_counts[3] > 0 && !scr_rd->bypass) {
+    scr_abort(-1, "Shared file access detected while not in bypass mode @ %s:%d",
+      __FILE__, __LINE__
+    );
+  }
+
+  /* if any rank failed to assign ownership, consider the dataset failed everywhere,
+   * otherwise ranks could diverge at the collectives below */
+  if (total_counts[4] > 0) {
+    rc = SCR_FAILURE;
+  }
+
   /* get dataset from filemap */
   scr_dataset* dataset = scr_dataset_new();
   scr_cache_index_get_dataset(scr_cindex, scr_dataset_id, dataset);
@@ -1543,12 +2929,53 @@ static int scr_complete_output(int valid)
     }
   }
 
-  /* apply redundancy scheme if we're still valid */
+  /* with pipelined flush enabled, kick off the async flush of the
+   * dataset before starting the deferred encode, the transfer threads
+   * only read the data files, which are finished at this point, so
+   * the copy to the parallel file system runs while the encode
+   * computes redundancy rather than waiting behind it, the encode
+   * completion bookkeeping then skips the flush check it would
+   * otherwise run */
+  if (rc == SCR_SUCCESS && scr_flush_pipeline && scr_flush_async &&
+      defer && !scr_rd->bypass)
+  {
+    /* record entry in flush file for this dataset */
+    char* dset_name;
+    scr_dataset_get_name(dataset, &dset_name);
+    scr_flush_file_new_entry(scr_dataset_id, dset_name, dataset, SCR_FLUSH_KEY_LOCATION_CACHE, is_ckpt, is_output);
+
+    /* this may start an async flush of the current dataset */
+    scr_check_flush(scr_cindex);
+    scr_encode_flush_started = 1;
+  }
+
+  /* apply redundancy scheme if we're still valid, when deferred
+   * encoding is enabled the encode runs in a background thread and
+   * the flush and halt checks below run when it completes */
+  int deferred = 0;
   if (rc == SCR_SUCCESS) {
-    rc = scr_reddesc_apply(scr_map, scr_rd, scr_dataset_id);
+    if (defer && !scr_rd->bypass) {
+      if (scr_encode_start(scr_map, scr_rd, scr_dataset_id, is_ckpt, is_output, &rc) == SCR_SUCCESS) {
+        deferred = 1;
+      }
+    } else {
+      rc = scr_reddesc_apply(scr_map, scr_rd, scr_dataset_id);
+    }
+  }
+
+  /* apply any dataset-level sync policy for the store we just
+   * wrote, one file system sync here stands in for the per-file
+   * fsyncs that the RANGE and DATASET policies skip at close,
+   * files from a deferred encode are synced when it completes */
+  if (rc == SCR_SUCCESS && ! deferred) {
+    int sync_store = scr_storedescs_index_from_name(scr_rd->base);
+    if (sync_store >= 0 && sync_store < scr_nstoredescs) {
+      scr_storedesc_sync_dataset(&scr_storedescs[sync_store]);
+    }
   }
 
   /* record the cost of the output and log its completion */
+  double output_cost = 0.0;
   if (scr_my_rank_world == 0) {
     /* stop the clock for this output */
     scr_time_output_end = MPI_Wtime();
@@ -1570,6 +2997,11 @@ static int scr_complete_output(int valid)
       scr_time_checkpoint_total += time_diff;
       scr_time_checkpoint_count++;
     }
+    output_cost = time_diff;
+
+    /* record the cost of the output in our stats counters */
+    scr_stats_sample(is_ckpt ? SCR_STATS_PHASE_CHECKPOINT : SCR_STATS_PHASE_OUTPUT, time_diff);
+    scr_stats_add_bytes(scr_rd->base, bytes, files);
 
     /* log data on the output */
     if (scr_log_enable) {
@@ -1597,22 +3029,44 @@ static int scr_complete_output(int valid)
     );
   }
 
+  /* with adaptive scheduling enabled, charge this checkpoint's
+   * cost to its descriptor and retune descriptor intervals, a
+   * deferred encode is skipped since its cost is not known yet */
+  if (scr_checkpoint_adaptive && is_ckpt && ! deferred && rc == SCR_SUCCESS) {
+    scr_ckpt_sched_update(output_cost);
+  }
+
   /* if copy is good, check whether we need to flush or halt,
-   * otherwise delete the checkpoint to conserve space */
-  if (rc == SCR_SUCCESS) {
-    /* record entry in flush file for this dataset */
-    char* dset_name;
-    scr_dataset_get_name(dataset, &dset_name);
-    scr_flush_file_new_entry(scr_dataset_id, dset_name, dataset, SCR_FLUSH_KEY_LOCATION_CACHE, is_ckpt, is_output);
+   * otherwise delete the checkpoint to conserve space,
+   * when the encode was deferred this bookkeeping runs in
+   * scr_encode_finish once the encode completes */
+  if (deferred) {
+    /* nothing to do yet, the encode is still running */
+  } else if (rc == SCR_SUCCESS) {
+    /* when a pipelined flush was started above, the flush file entry
+     * and flush check have already run, only the halt check remains */
+    if (! scr_encode_flush_started) {
+      /* record entry in flush file for this dataset */
+      char* dset_name;
+      scr_dataset_get_name(dataset, &dset_name);
+      scr_flush_file_new_entry(scr_dataset_id, dset_name, dataset, SCR_FLUSH_KEY_LOCATION_CACHE, is_ckpt, is_output);
 
-    /* go ahead and flush any bypass dataset since
-     * it's just a bit more work to finish at this point */
-    if (scr_rd->bypass) {
-      int flush_rc = scr_flush_sync(scr_cindex, scr_dataset_id);
-      if (flush_rc != SCR_SUCCESS) {
-        scr_abort(-1, "Flush of dataset %d failed @ %s:%d",
-          scr_dataset_id, __FILE__, __LINE__
-        );
+      /* go ahead and flush any bypass dataset since
+       * it's just a bit more work to finish at this point */
+      if (scr_rd->bypass) {
+        int flush_rc = scr_flush_sync(scr_cindex, scr_dataset_id);
+        if (flush_rc != SCR_SUCCESS) {
+          scr_abort(-1, "Flush of dataset %d failed @ %s:%d",
+            scr_dataset_id, __FILE__, __LINE__
+          );
+        }
+
+        /* mirror the checkpoint back into cache in the background
+         * so a later failure can restart from cache rather than the
+         * parallel file system (see SCR_CACHE_MIRROR) */
+        if (scr_cache_mirror && is_ckpt) {
+          scr_mirror_start(scr_map, scr_rd, scr_dataset_id);
+        }
       }
     }
 
@@ -1622,38 +3076,54 @@ static int scr_complete_output(int valid)
       /* only halt on checkpoints */
       scr_bool_check_halt_and_decrement(SCR_TEST_AND_HALT, 1);
     }
-    scr_check_flush(scr_cindex);
+    if (! scr_encode_flush_started) {
+      scr_check_flush(scr_cindex);
+    }
+    scr_encode_flush_started = 0;
   } else {
-    /* something went wrong, so delete this checkpoint from the cache */
+    /* something went wrong, so delete this checkpoint from the cache,
+     * if a pipelined flush was started it is still reading the data
+     * files, so wait for it to drain before deleting them */
+    if (scr_encode_flush_started) {
+      scr_flush_async_wait(scr_cindex);
+      scr_encode_flush_started = 0;
+    }
     scr_cache_delete(scr_cindex, scr_dataset_id);
 
     /* TODODSET: probably should return error or abort if this is output */
   }
 
-  /* if we have an async flush ongoing, take this chance to check whether it's completed */
+  /* take this chance to finalize a cache mirror whose copies have
+   * all landed, this is a no-op while any rank is still copying */
+  scr_mirror_progress(0);
+
+  /* if we have async flushes ongoing, take this chance to check whether
+   * any have completed */
   if (scr_flush_async_in_progress) {
-    /* got an outstanding async flush, let's check it */
-    if (scr_flush_async_test(scr_cindex, scr_flush_async_dataset_id) == SCR_SUCCESS) {
-      /* async flush has finished, go ahead and complete it */
-      int flush_rc = scr_flush_async_complete(scr_cindex, scr_flush_async_dataset_id);
-      if (flush_rc != SCR_SUCCESS) {
-        scr_abort(-1, "Flush of dataset %d failed @ %s:%d",
-          scr_flush_async_dataset_id, __FILE__, __LINE__
-        );
-      }
-    } else {
-      /* not done yet, just print a progress message to the screen */
-      if (scr_my_rank_world == 0) {
-        scr_dbg(1, "Flush of dataset %d is ongoing", scr_flush_async_dataset_id);
-      }
+    /* got outstanding async flushes, complete any that have finished */
+    if (scr_flush_async_progress(scr_cindex) != SCR_SUCCESS) {
+      scr_abort(-1, "Flush of dataset failed @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+
+    /* if any are still going, just print a progress message to the screen */
+    if (scr_flush_async_in_progress && scr_my_rank_world == 0) {
+      scr_dbg(1, "Flush of dataset %d is ongoing", scr_flush_async_dataset_id);
     }
   }
 
   /* done with dataset */
   scr_dataset_delete(&dataset);
 
-  /* free off the filemap we allocated in the start call */
-  scr_filemap_delete(&scr_map);
+  /* free off the filemap we allocated in the start call,
+   * when the encode was deferred the background thread still
+   * reads it, scr_encode_finish frees it instead */
+  if (deferred) {
+    scr_map = NULL;
+  } else {
+    scr_filemap_delete(&scr_map);
+  }
 
   /* set redundancy descriptor back to NULL */
   scr_rd = NULL;
@@ -1675,6 +3145,13 @@ static int scr_complete_output(int valid)
     }
   }
 
+  /* let the scrubber verify cached files while the application
+   * computes, skip this phase if a deferred encode is still
+   * updating file meta data */
+  if (! scr_encode_running) {
+    scr_scrub_start();
+  }
+
   return rc;
 }
 
@@ -1833,6 +3310,17 @@ int SCR_Init()
     }
   }
 
+  /* allocate cost counters for the adaptive checkpoint scheduler */
+  if (scr_nreddescs > 0) {
+    scr_ckpt_cost_total = (double*) SCR_MALLOC(scr_nreddescs * sizeof(double));
+    scr_ckpt_cost_count = (int*)    SCR_MALLOC(scr_nreddescs * sizeof(int));
+    int i;
+    for (i = 0; i < scr_nreddescs; i++) {
+      scr_ckpt_cost_total[i] = 0.0;
+      scr_ckpt_cost_count[i] = 0;
+    }
+  }
+
   /* check that we have an enabled redundancy descriptor with
    * interval of one, this is necessary so a reddesc is defined
    * for every checkpoint */
@@ -1873,6 +3361,10 @@ int SCR_Init()
   int num_nodes;
   rankstr_mpi(scr_my_hostname, scr_comm_world, 0, 1, &num_nodes, &scr_my_hostid);
 
+  /* remember the node count, the checkpoint interval model uses it
+   * to scale the per-node MTBF to a job failure rate */
+  scr_nodes = num_nodes;
+
   /* check that scr_prefix is set */
   if (scr_prefix == NULL || strcmp(scr_prefix, "") == 0) {
     if (scr_my_rank_world == 0) {
@@ -1937,6 +3429,17 @@ int SCR_Init()
   /* TODO: should we check for access and required space in cntl
    * directory at this point? */
 
+  /* open this rank's binary trace ring in the control directory,
+   * the scr_trace tool merges rings from all ranks after the run */
+  if (scr_trace) {
+    spath* trace_path = spath_from_str(scr_cntl_prefix);
+    spath_append_strf(trace_path, "trace.%d.scr", scr_my_rank_world);
+    char* trace_file = spath_strdup(trace_path);
+    scr_trace_open(trace_file, scr_my_rank_world, 0);
+    scr_free(&trace_file);
+    spath_delete(&trace_path);
+  }
+
   /* create the cache directories */
   for (i=0; i < scr_nreddescs; i++) {
     /* TODO: if checkpoints can be enabled at run time,
@@ -1998,6 +3501,9 @@ int SCR_Init()
   scr_flush_file = spath_from_str(scr_prefix_scr);
   spath_append_str(scr_flush_file, "flush.scr");
 
+  scr_status_file = spath_from_str(scr_prefix_scr);
+  spath_append_str(scr_status_file, SCR_STATUS_FILENAME);
+
   scr_nodes_file = spath_from_str(scr_prefix_scr);
   spath_append_str(scr_nodes_file, "nodes.scr");
 
@@ -2040,6 +3546,15 @@ int SCR_Init()
   /* exit right now if we need to halt */
   scr_bool_check_halt_and_decrement(SCR_TEST_AND_HALT, 0);
 
+  /* optionally start a thread on rank 0 to watch the halt file so
+   * that later checks can skip the file lock when nothing changed */
+  if (scr_halt_watch) {
+    scr_halt_watch_start();
+  }
+
+  /* zero out our performance counters for this run */
+  scr_stats_init();
+
   /* if the code is restarting from the parallel file system,
    * disable fetch and enable flush_on_restart */
   if (scr_global_restart) {
@@ -2119,10 +3634,18 @@ int SCR_Init()
   /* attempt to fetch files from parallel file system */
   int fetch_attempted = 0;
   if ((rc != SCR_SUCCESS || scr_global_restart) && scr_fetch) {
-    /* sets scr_dataset_id and scr_checkpoint_id upon success */
-    rc = scr_fetch_latest(scr_cindex, &fetch_attempted);
-    if (scr_my_rank_world == 0) {
-      scr_dbg(2, "scr_fetch_latest attempted on restart");
+    if (scr_fetch_async && scr_prefetch_start() == SCR_SUCCESS) {
+      /* the fetch continues in a background thread while the
+       * application runs its setup code, SCR_Have_restart and friends
+       * join the thread before reading any cache state; treat the
+       * fetch as successful for now so we don't purge the cache below */
+      rc = SCR_SUCCESS;
+    } else {
+      /* sets scr_dataset_id and scr_checkpoint_id upon success */
+      rc = scr_fetch_latest(scr_cindex, &fetch_attempted);
+      if (scr_my_rank_world == 0) {
+        scr_dbg(2, "scr_fetch_latest attempted on restart");
+      }
     }
   }
 
@@ -2197,6 +3720,25 @@ int SCR_Finalize()
     return SCR_FAILURE;
   }
 
+  /* wait on any fetch still running from SCR_Init */
+  scr_prefetch_finish();
+
+  /* finish any lazy fetch still in flight before tearing down */
+  scr_fetch_lazy_wait(scr_cindex);
+
+  /* wait on any deferred encode before tearing down */
+  scr_encode_finish();
+
+  /* settle any outstanding cache mirror before tearing down */
+  scr_mirror_progress(1);
+
+  /* stop the scrubber and release its task snapshot */
+  scr_scrub_stop();
+  scr_scrub_free_tasks();
+
+  /* stop watching the halt file if we started a watcher */
+  scr_halt_watch_stop();
+
   /* this is not required, but it helps ensure apps
    * are calling this as a collective */
   MPI_Barrier(scr_comm_world);
@@ -2215,7 +3757,12 @@ int SCR_Finalize()
   }
 
   /* handle any async flush */
-  if (scr_flush_async_in_progress) {
+  if (scr_flush_async_in_progress && scr_flush_handoff) {
+    /* rather than drain the transfer inside our remaining walltime,
+     * stop it and leave handoff files in the control directory for
+     * the standalone scr_flush_handoff helper to finish outside MPI */
+    scr_flush_async_handoff();
+  } else if (scr_flush_async_in_progress) {
     int flush_rc;
     if (scr_flush_async_dataset_id == scr_dataset_id) {
 #ifdef HAVE_LIBCPPR
@@ -2247,8 +3794,11 @@ int SCR_Finalize()
     }
   }
 
-  /* flush checkpoint set if we need to */
-  if (scr_flush > 0 && scr_flush_file_need_flush(scr_ckpt_dset_id)) {
+  /* flush checkpoint set if we need to,
+   * skip datasets we just handed off to the helper */
+  if (scr_flush > 0 && scr_flush_file_need_flush(scr_ckpt_dset_id) &&
+      ! scr_flush_async_is_handed_off(scr_ckpt_dset_id))
+  {
     if (scr_my_rank_world == 0) {
       scr_dbg(2, "Sync flush in SCR_Finalize @ %s:%d", __FILE__, __LINE__);
     }
@@ -2264,6 +3814,26 @@ int SCR_Finalize()
     scr_flush_async_finalize();
   }
 
+  /* optionally dump this rank's performance counters as JSON now
+   * that all transfers have settled */
+  if (scr_stats_dump) {
+    spath* stats_path = spath_from_str(scr_prefix_scr);
+    spath_append_strf(stats_path, "stats.%d.json", scr_my_rank_world);
+    char* stats_file = spath_strdup(stats_path);
+    scr_stats_write(stats_file);
+    scr_free(&stats_file);
+    spath_delete(&stats_path);
+  }
+  scr_stats_finalize();
+
+  /* close the binary trace ring, the file stays in the control
+   * directory for scr_trace to collect */
+  scr_trace_close();
+
+  /* free cost counters for the adaptive checkpoint scheduler */
+  scr_free(&scr_ckpt_cost_total);
+  scr_free(&scr_ckpt_cost_count);
+
   /* free off the memory allocated for our descriptors */
   scr_reddescs_free();
   scr_storedescs_free();
@@ -2277,9 +3847,38 @@ int SCR_Finalize()
   /* Free memory cache of a halt file */
   kvtree_delete(&scr_halt_hash);
 
+  /* free cache of resolved file routes */
+  kvtree_delete(&scr_route_cache);
+  scr_route_cache_id = -1;
+
   /* free off our global filemap object */
   scr_filemap_delete(&scr_map);
 
+  /* drop in-memory filemap copies */
+  scr_cache_free_maps();
+
+  /* wait for the background reaper to finish deleting any
+   * evicted datasets before the job ends */
+  scr_reap_finish();
+
+  /* release buffers held by the aligned buffer pool */
+  scr_buf_pool_free();
+
+  /* free the streaming write handle table, any handle left open
+   * at this point was leaked by the application */
+  int sh;
+  for (sh = 0; sh < scr_streams_size; sh++) {
+    if (scr_streams[sh].file != NULL) {
+      scr_warn("Streaming handle for %s never closed @ %s:%d",
+        scr_streams[sh].file, __FILE__, __LINE__
+      );
+      scr_close(scr_streams[sh].file, scr_streams[sh].fd);
+      scr_free(&scr_streams[sh].file);
+    }
+  }
+  scr_free(&scr_streams);
+  scr_streams_size = 0;
+
   /* free off our global filemap object */
   scr_cache_index_delete(&scr_cindex);
 
@@ -2332,6 +3931,7 @@ int SCR_Finalize()
 
   /* free memory allocated for variables */
   scr_free(&scr_fetch_current);
+  scr_free(&scr_fetch_type);
   scr_free(&scr_log_db_host);
   scr_free(&scr_log_db_user);
   scr_free(&scr_log_db_pass);
@@ -2350,6 +3950,7 @@ int SCR_Finalize()
 
   spath_delete(&scr_cindex_file);
   spath_delete(&scr_nodes_file);
+  spath_delete(&scr_status_file);
   spath_delete(&scr_flush_file);
   spath_delete(&scr_halt_file);
   spath_delete(&scr_prefix_path);
@@ -2813,11 +4414,48 @@ int SCR_Need_checkpoint(int* flag)
       }
     }
 
+    /* if a node MTBF is configured, compute the Young/Daly optimal
+     * interval from the measured checkpoint cost and the job failure
+     * rate, and check the time since the last checkpoint against it */
+    if (!*flag && scr_checkpoint_mtbf_node > 0) {
+      if (scr_time_checkpoint_count == 0) {
+        /* if we haven't taken a checkpoint, we need to take one in order
+         * to get a cost estimate */
+        *flag = 1;
+      } else {
+        /* scale node MTBF down to a job MTBF assuming independent
+         * node failures */
+        double mtbf = scr_checkpoint_mtbf_node;
+        if (scr_nodes > 0) {
+          mtbf /= (double) scr_nodes;
+        }
+
+        /* average cost of a checkpoint as measured so far,
+         * this updates online as more checkpoints complete */
+        double avg_cost = scr_time_checkpoint_total / (double) scr_time_checkpoint_count;
+
+        /* Daly's first-order optimal interval sqrt(2*C*M) - C,
+         * never let it drop below the cost of a checkpoint itself */
+        double interval = sqrt(2.0 * avg_cost * mtbf) - avg_cost;
+        if (interval < avg_cost) {
+          interval = avg_cost;
+        }
+
+        /* checkpoint once the optimal interval has elapsed since
+         * the end of the last checkpoint */
+        double now = MPI_Wtime();
+        if (now - scr_time_checkpoint_end >= interval) {
+          *flag = 1;
+        }
+      }
+    }
+
     /* no way to determine whether we need to checkpoint, so always say yes */
     if (!*flag &&
-        scr_checkpoint_interval <= 0 &&
-        scr_checkpoint_seconds  <= 0 &&
-        scr_checkpoint_overhead <= 0)
+        scr_checkpoint_interval  <= 0 &&
+        scr_checkpoint_seconds   <= 0 &&
+        scr_checkpoint_overhead  <= 0 &&
+        scr_checkpoint_mtbf_node <= 0)
     {
       *flag = 1;
     }
@@ -2851,6 +4489,12 @@ int SCR_Start_output(const char* name, int flags)
     return SCR_FAILURE;
   }
 
+  /* wait on any fetch still running from SCR_Init */
+  scr_prefetch_finish();
+
+  /* wait on any deferred encode from the previous dataset */
+  scr_encode_finish();
+
   /* delegate the rest to start_output */
   return scr_start_output(name, flags);
 }
@@ -2877,11 +4521,251 @@ int SCR_Start_checkpoint()
     return SCR_FAILURE;
   }
 
+  /* wait on any fetch still running from SCR_Init */
+  scr_prefetch_finish();
+
+  /* wait on any deferred encode from the previous dataset */
+  scr_encode_finish();
+
   /* delegate the rest to start_output */
   return scr_start_output(NULL, SCR_FLAG_CHECKPOINT);
 }
 
 /* given a filename, return the full path to the file which the user should write to */
+/* route a single file and register it in the filemap during output,
+ * when defer_map_write is set the caller takes responsibility for
+ * writing out the filemap after it has routed all of its files */
+/* route a file and update the filemap and route cache,
+ * caller must hold scr_route_mutex */
+static int scr_route_file_nolock(const char* file, char* newfile, int defer_map_write)
+{
+  /* during output, serve repeat requests for a file from the route
+   * cache, skipping the meta data and filemap updates the first
+   * request already made */
+  if (scr_in_output) {
+    if (scr_route_cache_id != scr_dataset_id) {
+      /* new dataset, drop routes cached for the previous one */
+      kvtree_delete(&scr_route_cache);
+      scr_route_cache    = kvtree_new();
+      scr_route_cache_id = scr_dataset_id;
+    }
+    kvtree* route = kvtree_get_kv(scr_route_cache, SCR_ROUTE_KEY_FILE, file);
+    if (route != NULL) {
+      char* cached = NULL;
+      if (kvtree_util_get_str(route, SCR_ROUTE_KEY_PATH, &cached) == KVTREE_SUCCESS) {
+        strncpy(newfile, cached, SCR_MAX_FILENAME);
+        return SCR_SUCCESS;
+      }
+    }
+  }
+
+  /* route the file based on current redundancy descriptor */
+  int n = SCR_MAX_FILENAME;
+  if (scr_route_file(scr_dataset_id, file, newfile, n) != SCR_SUCCESS) {
+    return SCR_FAILURE;
+  }
+
+  /* if we are in a new dataset, record this file in our filemap,
+   * otherwise, we are likely in a restart, so check whether the file exists */
+  if (scr_in_output) {
+    /* TODO: to avoid duplicates, check that the file is not already in the filemap,
+     * at the moment duplicates just overwrite each other, so there's no harm */
+
+    /* add the file to the filemap */
+    scr_filemap_add_file(scr_map, newfile);
+
+    /* read meta data for this file */
+    scr_meta* meta = scr_meta_new();
+    scr_filemap_get_meta(scr_map, newfile, meta);
+
+    /* set parameters for the file */
+    scr_meta_set_complete(meta, 0);
+    /* TODO: move the ranks field elsewhere, for now it's needed by scr_index.c */
+    scr_meta_set_ranks(meta, scr_ranks_world);
+    scr_meta_set_orig(meta, file);
+
+    /* build absolute path to file */
+    spath* path_abs = spath_from_str(file);
+    if (! spath_is_absolute(path_abs)) {
+      /* the path is not absolute, so prepend the current working directory */
+      char cwd[SCR_MAX_FILENAME];
+      if (scr_getcwd(cwd, sizeof(cwd)) == SCR_SUCCESS) {
+        spath_prepend_str(path_abs, cwd);
+      } else {
+        /* problem acquiring current working directory */
+        scr_abort(-1, "Failed to build absolute path to %s @ %s:%d",
+          file, __FILE__, __LINE__
+        );
+      }
+    }
+
+    /* simplify the absolute path (removes "." and ".." entries) */
+    spath_reduce(path_abs);
+
+    /* check that file is somewhere under prefix */
+    if (! spath_is_child(scr_prefix_path, path_abs)) {
+      /* found a file that's outside of prefix, throw an error */
+      char* path_abs_str = spath_strdup(path_abs);
+      scr_abort(-1, "File `%s' must be under SCR_PREFIX `%s' @ %s:%d",
+        path_abs_str, scr_prefix, __FILE__, __LINE__
+      );
+    }
+
+    /* cut absolute path into direcotry and file name */
+    spath* path_name = spath_cut(path_abs, -1);
+
+    /* store the full path and name of the original file */
+    char* path = spath_strdup(path_abs);
+    char* name = spath_strdup(path_name);
+    scr_meta_set_origpath(meta, path);
+    scr_meta_set_origname(meta, name);
+
+    /* if we're in bypass mode, we need to be sure directory exists
+     * for this file before user starts to write to it, skip the mkdir
+     * when we already created this directory for this dataset */
+    if (scr_rd->bypass) {
+      if (kvtree_get_kv(scr_route_cache, SCR_ROUTE_KEY_DIR, path) == NULL) {
+        mode_t mode_dir = scr_getmode(1, 1, 1);
+        if (scr_mkdir(path, mode_dir) != SCR_SUCCESS) {
+          scr_abort(-1, "Failed to create directory %s @ %s:%d",
+            path, __FILE__, __LINE__
+          );
+        }
+        kvtree_set_kv(scr_route_cache, SCR_ROUTE_KEY_DIR, path);
+      }
+    }
+
+    /* free full path and name of original file */
+    scr_free(&name);
+    scr_free(&path);
+
+    /* free directory and file name paths */
+    spath_delete(&path_name);
+    spath_delete(&path_abs);
+
+    /* record the meta data for this file */
+    scr_filemap_set_meta(scr_map, newfile, meta);
+
+    /* write out the filemap, unless the caller is routing a batch
+     * of files and will write the map once at the end */
+    if (! defer_map_write) {
+      scr_cache_set_map(scr_cindex, scr_dataset_id, scr_map);
+    }
+
+    /* remember the route so a repeat request for this file
+     * is served from the cache */
+    kvtree* route = kvtree_set_kv(scr_route_cache, SCR_ROUTE_KEY_FILE, file);
+    kvtree_util_set_str(route, SCR_ROUTE_KEY_PATH, newfile);
+
+    /* delete the meta data object */
+    scr_meta_delete(&meta);
+  } else {
+    /* if user specified path to file within prefix, return */
+    if (scr_file_is_readable(newfile) == SCR_SUCCESS) {
+      return SCR_SUCCESS;
+    }
+
+    /* TODO: To support backwards compatibility, the user is allowed
+     * to pass just the file name with no path component during restart.
+     * This means that they cannot have two files in the same checkpoint
+     * with the same basename even if those files would be in two
+     * different directories, e.g., one can't do something like:
+     *   ckpt.1.root
+     *   ckpt.1/ckpt.1.root
+     *
+     * With bypass, we need to figure out which directory the file is
+     * in, so we have to scan through the filemap to find a match on
+     * the basename.
+     *
+     * The proper fix would be to force users to include path components
+     * even in restart.  This would make route_file symmetric in output
+     * and restart, which is better.  It would take a step in enabling
+     * two files with the same basename but in different directories.
+     * However, it also requires that users names their checkpoints,
+     * so SCR_Start_checkpoint must be deprecated ro changed to take a
+     * name argument. */
+
+    /* compute basename of new file */
+    spath* path = spath_from_str(newfile);
+    spath_basename(path);
+    char* newfilebase = spath_strdup(path);
+    spath_delete(&path);
+
+    /* get the filemap for this checkpoint */
+    scr_filemap* map = scr_filemap_new();
+    scr_cache_get_map(scr_cindex, scr_dataset_id, map);
+
+    /* loop over each file in the map */
+    int found_file = 0;
+    kvtree_elem* file_elem;
+    for (file_elem = scr_filemap_first_file(map);
+         file_elem != NULL;
+         file_elem = kvtree_elem_next(file_elem))
+    {
+      /* get the filename */
+      char* mapfile = kvtree_elem_key(file_elem);
+
+      /* get meta data for this file */
+      scr_meta* meta = scr_meta_new();
+      if (scr_filemap_get_meta(map, mapfile, meta) == SCR_SUCCESS) {
+        /* lookup basename for this file from meta data */
+        char* origname = NULL;
+        if (scr_meta_get_origname(meta, &origname) == SCR_SUCCESS) {
+          /* check whether basename in meta matches basename of input file */
+          if (strcmp(origname, newfilebase) == 0) {
+            /* found a matching base name in our file map,
+             * overwrite output file path in newfile with
+             * full path to checkpoint file */
+            strncpy(newfile, mapfile, SCR_MAX_FILENAME);
+            found_file = 1;
+          }
+        }
+      }
+      scr_meta_delete(&meta);
+
+      /* stop looping early if we found the file */
+      if (found_file) {
+        break;
+      }
+    }
+
+    /* free the filemap */
+    scr_filemap_delete(&map);
+
+    /* free the base name of new file */
+    scr_free(&newfilebase);
+
+    /* return an error if we failed to find the basename in the file map */
+    if (! found_file) {
+      return SCR_FAILURE;
+    }
+
+    /* if we're fetching lazily, pull this file into cache now,
+     * files the application asks for jump ahead of the prefetch */
+    if (scr_fetch_lazy_file(newfile) != SCR_SUCCESS) {
+      return SCR_FAILURE;
+    }
+
+    /* if we can't read the file, return an error */
+    if (scr_file_is_readable(newfile) != SCR_SUCCESS) {
+      return SCR_FAILURE;
+    }
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* thread-safe entry to scr_route_file_nolock,
+ * takes the route lock so that worker threads can route files
+ * concurrently during output */
+static int scr_route_file_cached(const char* file, char* newfile, int defer_map_write)
+{
+  pthread_mutex_lock(&scr_route_mutex);
+  int rc = scr_route_file_nolock(file, newfile, defer_map_write);
+  pthread_mutex_unlock(&scr_route_mutex);
+  return rc;
+}
+
 int SCR_Route_file(const char* file, char* newfile)
 {
   /* manage state transition */
@@ -2924,183 +4808,315 @@ int SCR_Route_file(const char* file, char* newfile)
     return SCR_FAILURE;
   }
 
-  /* route the file based on current redundancy descriptor */
-  int n = SCR_MAX_FILENAME;
-  if (scr_route_file(scr_dataset_id, file, newfile, n) != SCR_SUCCESS) {
+  return scr_route_file_cached(file, newfile, 0);
+}
+
+/* batch version of SCR_Route_file, routes a list of files in one call,
+ * performing the state checks once and writing out the filemap once */
+int SCR_Route_files(int numfiles, const char** files, char** newfiles)
+{
+  int i;
+
+  /* check that we got lists to read from and write to */
+  if (numfiles < 0 || (numfiles > 0 && (files == NULL || newfiles == NULL))) {
     return SCR_FAILURE;
   }
 
-  /* if we are in a new dataset, record this file in our filemap,
-   * otherwise, we are likely in a restart, so check whether the file exists */
-  if (scr_in_output) {
-    /* TODO: to avoid duplicates, check that the file is not already in the filemap,
-     * at the moment duplicates just overwrite each other, so there's no harm */
+  /* outside of a Start/Complete pair, defer to the single file
+   * routine which copies each name through unchanged */
+  if (scr_state != SCR_STATE_RESTART    &&
+      scr_state != SCR_STATE_CHECKPOINT &&
+      scr_state != SCR_STATE_OUTPUT)
+  {
+    int rc = SCR_SUCCESS;
+    for (i = 0; i < numfiles; i++) {
+      if (SCR_Route_file(files[i], newfiles[i]) != SCR_SUCCESS) {
+        rc = SCR_FAILURE;
+      }
+    }
+    return rc;
+  }
 
-    /* add the file to the filemap */
-    scr_filemap_add_file(scr_map, newfile);
+  /* if not enabled, bail with an error */
+  if (! scr_enabled) {
+    return SCR_FAILURE;
+  }
 
-    /* read meta data for this file */
-    scr_meta* meta = scr_meta_new();
-    scr_filemap_get_meta(scr_map, newfile, meta);
+  /* bail out if not initialized -- will get bad results */
+  if (! scr_initialized) {
+    scr_abort(-1, "SCR has not been initialized @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
 
-    /* set parameters for the file */
-    scr_meta_set_complete(meta, 0);
-    /* TODO: move the ranks field elsewhere, for now it's needed by scr_index.c */
-    scr_meta_set_ranks(meta, scr_ranks_world);
-    scr_meta_set_orig(meta, file);
+  /* route each file in the list, deferring the filemap write,
+   * hold the route lock across the whole batch rather than
+   * acquiring it once per file */
+  int rc = SCR_SUCCESS;
+  pthread_mutex_lock(&scr_route_mutex);
+  for (i = 0; i < numfiles; i++) {
+    if (scr_route_file_nolock(files[i], newfiles[i], 1) != SCR_SUCCESS) {
+      rc = SCR_FAILURE;
+    }
+  }
+
+  /* write out the filemap once for the whole batch */
+  if (scr_in_output && numfiles > 0) {
+    scr_cache_set_map(scr_cindex, scr_dataset_id, scr_map);
+  }
+  pthread_mutex_unlock(&scr_route_mutex);
+
+  return rc;
+}
+
+/*
+=========================================
+Streaming write API
+=========================================
+*/
+
+/* returns pointer to stream for given handle,
+ * or NULL if the handle is not open */
+static scr_stream* scr_stream_lookup(int fh)
+{
+  if (fh < 0 || fh >= scr_streams_size || scr_streams[fh].file == NULL) {
+    return NULL;
+  }
+  return &scr_streams[fh];
+}
+
+/* open a file for writing through SCR, the file is routed like
+ * SCR_Route_file and a handle for SCR_Write is returned in fh */
+int SCR_Open(const char* name, int* fh)
+{
+  /* check that we can write the handle back */
+  if (fh == NULL) {
+    return SCR_FAILURE;
+  }
+  *fh = -1;
 
-    /* build absolute path to file */
-    spath* path_abs = spath_from_str(file);
-    if (! spath_is_absolute(path_abs)) {
-      /* the path is not absolute, so prepend the current working directory */
-      char cwd[SCR_MAX_FILENAME];
-      if (scr_getcwd(cwd, sizeof(cwd)) == SCR_SUCCESS) {
-        spath_prepend_str(path_abs, cwd);
-      } else {
-        /* problem acquiring current working directory */
-        scr_abort(-1, "Failed to build absolute path to %s @ %s:%d",
-          file, __FILE__, __LINE__
-        );
-      }
-    }
+  /* route the file, this applies the same state checks as
+   * SCR_Route_file and registers the file in the filemap */
+  char file[SCR_MAX_FILENAME];
+  if (SCR_Route_file(name, file) != SCR_SUCCESS) {
+    return SCR_FAILURE;
+  }
 
-    /* simplify the absolute path (removes "." and ".." entries) */
-    spath_reduce(path_abs);
+  /* open the file for writing */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (fd < 0) {
+    scr_err("Opening file for streaming write: scr_open(%s) errno=%d %s @ %s:%d",
+      file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
 
-    /* check that file is somewhere under prefix */
-    if (! spath_is_child(scr_prefix_path, path_abs)) {
-      /* found a file that's outside of prefix, throw an error */
-      char* path_abs_str = spath_strdup(path_abs);
-      scr_abort(-1, "File `%s' must be under SCR_PREFIX `%s' @ %s:%d",
-        path_abs_str, scr_prefix, __FILE__, __LINE__
+  /* grab a free slot in the handle table, growing it if needed */
+  pthread_mutex_lock(&scr_stream_mutex);
+  int i;
+  for (i = 0; i < scr_streams_size; i++) {
+    if (scr_streams[i].file == NULL) {
+      break;
+    }
+  }
+  if (i == scr_streams_size) {
+    int size = (scr_streams_size > 0) ? scr_streams_size * 2 : 8;
+    scr_streams = (scr_stream*) realloc(scr_streams, size * sizeof(scr_stream));
+    if (scr_streams == NULL) {
+      scr_abort(-1, "Failed to allocate stream handle table @ %s:%d",
+        __FILE__, __LINE__
       );
     }
+    int j;
+    for (j = scr_streams_size; j < size; j++) {
+      scr_streams[j].file = NULL;
+    }
+    scr_streams_size = size;
+  }
+
+  /* initialize the handle */
+  scr_streams[i].file  = strdup(file);
+  scr_streams[i].fd    = fd;
+  scr_streams[i].crc    = scr_crc_init();
+  scr_streams[i].size   = 0;
+  scr_streams[i].error  = 0;
+  scr_streams[i].direct = 0;
+#ifdef HAVE_LIBCUFILE
+  scr_streams[i].cf_registered = 0;
+#endif
+  pthread_mutex_unlock(&scr_stream_mutex);
 
-    /* cut absolute path into direcotry and file name */
-    spath* path_name = spath_cut(path_abs, -1);
+  *fh = i;
+  return SCR_SUCCESS;
+}
 
-    /* store the full path and name of the original file */
-    char* path = spath_strdup(path_abs);
-    char* name = spath_strdup(path_name);
-    scr_meta_set_origpath(meta, path);
-    scr_meta_set_origname(meta, name);
+/* write size bytes from buf to the file behind the given handle,
+ * folding the bytes into the running CRC as they pass through */
+int SCR_Write(int fh, const void* buf, unsigned long size)
+{
+  /* check that we got an open handle and a buffer */
+  scr_stream* s = scr_stream_lookup(fh);
+  if (s == NULL || (buf == NULL && size > 0)) {
+    return SCR_FAILURE;
+  }
 
-    /* TODO: would be nice to limit mkdir ops here */
-    /* if we're in bypass mode, we need to be sure directory exists
-     * for this file before user starts to write to it */
-    if (scr_rd->bypass) {
-      mode_t mode_dir = scr_getmode(1, 1, 1);
-      if (scr_mkdir(path, mode_dir) != SCR_SUCCESS) {
-        scr_abort(-1, "Failed to create directory %s @ %s:%d",
-          path, __FILE__, __LINE__
-        );
-      }
-    }
+  /* write the data */
+  ssize_t nwrite = scr_write_attempt(s->file, s->fd, buf, (size_t) size);
+  if (nwrite < 0 || (unsigned long) nwrite < size) {
+    s->error = 1;
+    return SCR_FAILURE;
+  }
 
-    /* free full path and name of original file */
-    scr_free(&name);
-    scr_free(&path);
+  /* fold the bytes into the running crc while they are still in
+   * the application's buffer */
+  if (scr_crc_on_copy) {
+    s->crc = scr_crc_update(s->crc, buf, (size_t) size);
+  }
 
-    /* free directory and file name paths */
-    spath_delete(&path_name);
-    spath_delete(&path_abs);
+  s->size += size;
+  return SCR_SUCCESS;
+}
 
-    /* record the meta data for this file */
-    scr_filemap_set_meta(scr_map, newfile, meta);
+/* variant of SCR_Write that accepts a device memory pointer, when
+ * built with cuFile support the bytes move from device memory to
+ * storage without passing through the host */
+int SCR_Write_device(int fh, const void* buf, unsigned long size)
+{
+  /* check that we got an open handle and a buffer */
+  scr_stream* s = scr_stream_lookup(fh);
+  if (s == NULL || (buf == NULL && size > 0)) {
+    return SCR_FAILURE;
+  }
 
-    /* write out the filemap */
-    scr_cache_set_map(scr_cindex, scr_dataset_id, scr_map);
+#ifdef HAVE_LIBCUFILE
+  /* open the cuFile driver and register the file on first use,
+   * registration fails on file systems cuFile cannot drive, in
+   * which case we fall through to host staging below */
+  if (! s->cf_registered && ! s->error) {
+    static int cf_driver_open = 0;
+    pthread_mutex_lock(&scr_stream_mutex);
+    if (! cf_driver_open) {
+      cuFileDriverOpen();
+      cf_driver_open = 1;
+    }
+    pthread_mutex_unlock(&scr_stream_mutex);
+
+    CUfileDescr_t descr;
+    memset(&descr, 0, sizeof(descr));
+    descr.handle.fd = s->fd;
+    descr.type = CU_FILE_HANDLE_TYPE_OPAQUE_FD;
+    CUfileError_t err = cuFileHandleRegister(&s->cf_handle, &descr);
+    if (err.err == CU_FILE_SUCCESS) {
+      s->cf_registered = 1;
+    }
+  }
 
-    /* delete the meta data object */
-    scr_meta_delete(&meta);
-  } else {
-    /* if user specified path to file within prefix, return */
-    if (scr_file_is_readable(newfile) == SCR_SUCCESS) {
+  /* write straight from device memory to storage */
+  if (s->cf_registered) {
+    ssize_t nwrite = cuFileWrite(s->cf_handle, buf, (size_t) size, (off_t) s->size, 0);
+    if (nwrite >= 0 && (unsigned long) nwrite == size) {
+      /* the bytes never passed through the host, so there is no
+       * inline crc for this file */
+      s->direct = 1;
+      s->size += size;
       return SCR_SUCCESS;
     }
+  }
 
-    /* TODO: To support backwards compatibility, the user is allowed
-     * to pass just the file name with no path component during restart.
-     * This means that they cannot have two files in the same checkpoint
-     * with the same basename even if those files would be in two
-     * different directories, e.g., one can't do something like:
-     *   ckpt.1.root
-     *   ckpt.1/ckpt.1.root
-     *
-     * With bypass, we need to figure out which directory the file is
-     * in, so we have to scan through the filemap to find a match on
-     * the basename.
-     *
-     * The proper fix would be to force users to include path components
-     * even in restart.  This would make route_file symmetric in output
-     * and restart, which is better.  It would take a step in enabling
-     * two files with the same basename but in different directories.
-     * However, it also requires that users names their checkpoints,
-     * so SCR_Start_checkpoint must be deprecated ro changed to take a
-     * name argument. */
-
-    /* compute basename of new file */
-    spath* path = spath_from_str(newfile);
-    spath_basename(path);
-    char* newfilebase = spath_strdup(path);
-    spath_delete(&path);
-
-    /* get the filemap for this checkpoint */
-    scr_filemap* map = scr_filemap_new();
-    scr_cache_get_map(scr_cindex, scr_dataset_id, map);
+  /* cuFile could not take the write, stage the data through a host
+   * buffer instead, SCR_Write folds the bytes into the inline crc
+   * as they pass through */
+  size_t bufsize = scr_file_buf_size;
+  char* host = (char*) scr_buf_get(bufsize);
 
-    /* loop over each file in the map */
-    int found_file = 0;
-    kvtree_elem* file_elem;
-    for (file_elem = scr_filemap_first_file(map);
-         file_elem != NULL;
-         file_elem = kvtree_elem_next(file_elem))
-    {
-      /* get the filename */
-      char* mapfile = kvtree_elem_key(file_elem);
+  int rc = SCR_SUCCESS;
+  unsigned long offset = 0;
+  while (rc == SCR_SUCCESS && offset < size) {
+    size_t amount = bufsize;
+    if (amount > size - offset) {
+      amount = (size_t) (size - offset);
+    }
+    if (cudaMemcpy(host, (const char*) buf + offset, amount, cudaMemcpyDeviceToHost) != cudaSuccess) {
+      scr_err("Failed to copy device buffer to host for %s @ %s:%d",
+        s->file, __FILE__, __LINE__
+      );
+      s->error = 1;
+      rc = SCR_FAILURE;
+      break;
+    }
+    rc = SCR_Write(fh, host, (unsigned long) amount);
+    offset += amount;
+  }
 
-      /* get meta data for this file */
-      scr_meta* meta = scr_meta_new();
-      if (scr_filemap_get_meta(map, mapfile, meta) == SCR_SUCCESS) {
-        /* lookup basename for this file from meta data */
-        char* origname = NULL;
-        if (scr_meta_get_origname(meta, &origname) == SCR_SUCCESS) {
-          /* check whether basename in meta matches basename of input file */
-          if (strcmp(origname, newfilebase) == 0) {
-            /* found a matching base name in our file map,
-             * overwrite output file path in newfile with
-             * full path to checkpoint file */
-            strncpy(newfile, mapfile, SCR_MAX_FILENAME);
-            found_file = 1;
-          }
-        }
-      }
-      scr_meta_delete(&meta);
+  scr_buf_put(host);
+  return rc;
+#else
+  scr_err("SCR_Write_device requires an SCR build with cuFile support @ %s:%d",
+    __FILE__, __LINE__
+  );
+  s->error = 1;
+  return SCR_FAILURE;
+#endif
+}
 
-      /* stop looping early if we found the file */
-      if (found_file) {
-        break;
-      }
-    }
+/* close a streaming write handle, recording the CRC computed inline
+ * so later passes need not read the file back to checksum it */
+int SCR_Close(int fh)
+{
+  /* check that we got an open handle */
+  scr_stream* s = scr_stream_lookup(fh);
+  if (s == NULL) {
+    return SCR_FAILURE;
+  }
 
-    /* free the filemap */
-    scr_filemap_delete(&map);
+  int rc = s->error ? SCR_FAILURE : SCR_SUCCESS;
 
-    /* free the base name of new file */
-    scr_free(&newfilebase);
+#ifdef HAVE_LIBCUFILE
+  /* release the cuFile handle if this stream used GPU-direct writes */
+  if (s->cf_registered) {
+    cuFileHandleDeregister(s->cf_handle);
+    s->cf_registered = 0;
+  }
+#endif
 
-    /* return an error if we failed to find the basename in the file map */
-    if (! found_file) {
-      return SCR_FAILURE;
+  /* close the file applying the sync policy of the store it
+   * landed on, fall back to a full fsync when we have no store */
+  int sync = SCR_SYNC_FSYNC;
+  if (scr_in_output && scr_rd != NULL && ! scr_rd->bypass) {
+    scr_storedesc* store = scr_reddesc_get_store(scr_rd);
+    if (store != NULL) {
+      sync = store->sync;
     }
+  }
+  if (scr_close_policy(s->file, s->fd, sync) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
 
-    /* if we can't read the file, return an error */
-    if (scr_file_is_readable(newfile) != SCR_SUCCESS) {
-      return SCR_FAILURE;
+  /* record the inline crc in the file's meta data, which lets
+   * scr_reddesc_apply skip its read-back checksum pass, if any
+   * bytes went straight from device memory to storage they never
+   * passed through the crc, so we must not record a partial one */
+  if (rc == SCR_SUCCESS && scr_in_output && scr_crc_on_copy && !s->direct) {
+    pthread_mutex_lock(&scr_route_mutex);
+    scr_meta* meta = scr_meta_new();
+    if (scr_filemap_get_meta(scr_map, s->file, meta) == SCR_SUCCESS) {
+      scr_meta_set_crc32(meta, s->crc);
+      scr_filemap_set_meta(scr_map, s->file, meta);
+      scr_cache_set_map(scr_cindex, scr_dataset_id, scr_map);
     }
+    scr_meta_delete(&meta);
+    pthread_mutex_unlock(&scr_route_mutex);
   }
 
-  return SCR_SUCCESS;
+  /* release the handle */
+  pthread_mutex_lock(&scr_stream_mutex);
+  scr_free(&s->file);
+  s->fd = -1;
+  pthread_mutex_unlock(&scr_stream_mutex);
+
+  return rc;
 }
 
 /* inform library that the current dataset is complete */
@@ -3127,7 +5143,89 @@ int SCR_Complete_output(int valid)
     return SCR_FAILURE;
   }
 
-  return scr_complete_output(valid);
+  return scr_complete_output(valid, scr_encode_async);
+}
+
+/* split-phase variant of SCR_Complete_output, returns as soon as the
+ * redundancy encoding has been handed to a background thread so the
+ * application can resume computing, the application must then poll
+ * SCR_Complete_output_test until it reports the output is done,
+ * if the encode cannot be deferred (bypass datasets, or MPI without
+ * MPI_THREAD_MULTIPLE) the call completes the output synchronously */
+int SCR_Complete_output_begin(int valid)
+{
+  /* manage state transition */
+  if (scr_state != SCR_STATE_OUTPUT) {
+    scr_abort(-1, "Must call SCR_Start_output() before SCR_Complete_output_begin() @ %s:%d",
+      __FILE__, __LINE__
+    );
+  }
+  scr_state = SCR_STATE_IDLE;
+
+  /* if not enabled, bail with an error */
+  if (! scr_enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* bail out if not initialized -- will get bad results */
+  if (! scr_initialized) {
+    scr_abort(-1, "SCR has not been initialized @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  return scr_complete_output(valid, 1);
+}
+
+/* poll for completion of a split-phase output, sets done to 1 and
+ * returns the final result once the background encode and its
+ * bookkeeping have finished, this call is collective and all ranks
+ * must keep calling until it reports done */
+int SCR_Complete_output_test(int* done)
+{
+  /* manage state transition */
+  if (scr_state != SCR_STATE_IDLE) {
+    scr_state_transition_error(scr_state, "SCR_Complete_output_test()", __FILE__, __LINE__);
+  }
+
+  /* if not enabled, bail with an error */
+  if (! scr_enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* bail out if not initialized -- will get bad results */
+  if (! scr_initialized) {
+    scr_abort(-1, "SCR has not been initialized @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* check that we got a pointer to write the flag to */
+  if (done == NULL) {
+    return SCR_FAILURE;
+  }
+
+  /* if no encode is outstanding, the output has settled,
+   * this is uniform across ranks since deferral is all-or-nothing */
+  if (! scr_encode_running) {
+    *done = 1;
+    return scr_encode_final_rc;
+  }
+
+  /* agree across ranks on whether every encode thread has finished,
+   * the completion bookkeeping is collective so all ranks must enter
+   * scr_encode_finish together */
+  *done = 0;
+  int finished = scr_encode_done;
+  if (scr_alltrue(finished, scr_comm_world)) {
+    int rc = scr_encode_finish();
+    *done = 1;
+    return rc;
+  }
+
+  return SCR_SUCCESS;
 }
 
 /* completes the checkpoint set and marks it as valid or not */
@@ -3154,7 +5252,7 @@ int SCR_Complete_checkpoint(int valid)
     return SCR_FAILURE;
   }
 
-  return scr_complete_output(valid);
+  return scr_complete_output(valid, scr_encode_async);
 }
 
 /* determine whether SCR has a restart available to read,
@@ -3185,6 +5283,9 @@ int SCR_Have_restart(int* flag, char* name)
    * are calling this as a collective */
   MPI_Barrier(scr_comm_world);
 
+  /* wait on any fetch still running from SCR_Init */
+  scr_prefetch_finish();
+
   /* TODO: a more proper check would be to examine the filemap, perhaps across ranks */
 
   /* set flag depending on whether checkpoint_id is greater than 0,
@@ -3215,6 +5316,9 @@ int SCR_Start_restart(char* name)
   }
   scr_state = SCR_STATE_RESTART;
 
+  /* wait on any fetch still running from SCR_Init */
+  scr_prefetch_finish();
+
   /* only valid to call this if we have a checkpoint to restart from */
   if (! scr_have_restart) {
     scr_abort(-1, "Can only call SCR_Start_restart() if SCR_Have_restart() indicates a checkpoint is available @ %s:%d",
@@ -3271,6 +5375,9 @@ int SCR_Complete_restart(int valid)
   }
   scr_state = SCR_STATE_IDLE;
 
+  /* stop the scrubber, a failed restart deletes checkpoints from cache */
+  scr_scrub_stop();
+
   /* if not enabled, bail with an error */
   if (! scr_enabled) {
     return SCR_FAILURE;
@@ -3287,6 +5394,14 @@ int SCR_Complete_restart(int valid)
   /* turn off our restart flag */
   scr_have_restart = 0;
 
+  /* drain any lazy fetch still in flight and run its deferred
+   * redundancy encode, a failed copy already showed up to the
+   * application as an unreadable file in SCR_Route_file, and an
+   * encode failure only drops the cached copy, the dataset remains
+   * intact in the prefix directory, so we don't fold the result
+   * into valid here */
+  scr_fetch_lazy_wait(scr_cindex);
+
   /* since we have no output flag to return to user whether all procs
    * passed in valid=1, we'll overload the return code for that purpose,
    * this should eventually be changed to use an output flag instead */
@@ -3455,6 +5570,52 @@ int SCR_Should_exit(int* flag)
   return SCR_SUCCESS;
 }
 
+/* report progress of any outstanding asynchronous flush */
+int SCR_Flush_progress(double* bytes_transferred, double* bytes_total, double* secs_remaining)
+{
+  /* manage state transition */
+  if (scr_state != SCR_STATE_IDLE) {
+    scr_state_transition_error(scr_state, "SCR_Flush_progress()", __FILE__, __LINE__);
+  }
+
+  /* if not enabled, bail with an error */
+  if (! scr_enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* bail out if not initialized -- will get bad results */
+  if (! scr_initialized) {
+    scr_abort(-1, "SCR has not been initialized @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* check that we have variables to write to */
+  if (bytes_transferred == NULL || bytes_total == NULL || secs_remaining == NULL) {
+    return SCR_FAILURE;
+  }
+
+  /* each process sums its local progress,
+   * the reduction makes this a collective call */
+  return scr_flush_async_progress_info(bytes_transferred, bytes_total, secs_remaining);
+}
+
+/* render this process's performance counters as JSON */
+int SCR_Get_stats(char* buf, int size)
+{
+  /* reject a destination we can't write to */
+  if (buf == NULL && size > 0) {
+    return -1;
+  }
+  if (size < 0) {
+    return -1;
+  }
+
+  /* local counters only, so no state or collective requirements */
+  return scr_stats_json(buf, (size_t) size);
+}
+
 /* user is telling us which checkpoint they loaded,
  * lookup the dataset and checkpoint ids from the index file,
  * update the current marker */
@@ -3472,6 +5633,9 @@ int SCR_Current(const char* name)
     return SCR_FAILURE;
   }
 
+  /* stop the scrubber while we may delete checkpoints from cache */
+  scr_scrub_stop();
+
   /* bail out if not initialized -- will get bad results */
   if (! scr_initialized) {
     scr_abort(-1, "SCR has not been initialized @ %s:%d",
@@ -30,6 +30,8 @@ extern "C" {
 #define SCR_FLAG_NONE       (0 << 0) /* empty flags */
 #define SCR_FLAG_CHECKPOINT (1 << 0) /* means that job can be restarted using this dataset */
 #define SCR_FLAG_OUTPUT     (1 << 1) /* means this dataset must be flushed to the file system */
+#define SCR_FLAG_URGENT     (1 << 2) /* flush this dataset ahead of others at full bandwidth */
+#define SCR_FLAG_BULK       (1 << 3) /* low priority, dataset yields bandwidth to other transfers */
 
 /* see the SCR user manual for full details on these functions */
 
@@ -65,9 +67,42 @@ const char* SCR_Configf(const char* format, ...);
  * File registration
  ****************/
 
-/* determine the path and filename to be used to open a file */
+/* determine the path and filename to be used to open a file,
+ * thread-safe: worker threads may call this concurrently between a
+ * Start/Complete pair, routing makes no MPI calls, all other SCR
+ * functions are collective and must be called by a single thread
+ * with no Route_file calls in flight */
 int SCR_Route_file(const char* name, char* file);
 
+/* batch version of SCR_Route_file, routes a list of num files in one
+ * call, amortizing the state checks and filemap update over the list */
+int SCR_Route_files(int num, const char** names, char** files);
+
+/*****************
+ * Streaming write routines
+ ****************/
+
+/* open a file for writing through SCR, the name is routed like
+ * SCR_Route_file, returns a handle in fh for use with SCR_Write,
+ * data streamed through the handle is checksummed as it passes
+ * through so SCR need not read the file back afterwards */
+int SCR_Open(const char* name, int* fh);
+
+/* write size bytes from buf to the file behind the given handle,
+ * a handle may be used by one thread at a time */
+int SCR_Write(int fh, const void* buf, unsigned long size);
+
+/* variant of SCR_Write that accepts a device memory pointer, when
+ * SCR is built with cuFile support the data moves from device memory
+ * to storage directly (GPUDirect Storage), falling back to staging
+ * through a host buffer on file systems cuFile cannot drive, without
+ * cuFile support this call fails since the pointer cannot be read */
+int SCR_Write_device(int fh, const void* buf, unsigned long size);
+
+/* close a streaming write handle, returns SCR_FAILURE if any
+ * write to the handle failed */
+int SCR_Close(int fh);
+
 /*****************
  * Restart routines
  ****************/
@@ -106,6 +141,17 @@ int SCR_Start_output(const char* name, int flags);
 /* inform library that the current dataset is complete */
 int SCR_Complete_output(int valid);
 
+/* split-phase variant of SCR_Complete_output, returns as soon as
+ * redundancy encoding has been handed to a background thread so the
+ * application can resume computing, poll SCR_Complete_output_test
+ * for the final result */
+int SCR_Complete_output_begin(int valid);
+
+/* poll for completion of a split-phase output, sets done to 1 and
+ * returns the final result once the output has settled, collective,
+ * all processes must keep calling until it reports done */
+int SCR_Complete_output_test(int* done);
+
 /*****************
  * Dataset management routines
  ****************/
@@ -131,6 +177,22 @@ char* SCR_Get_version(void);
 /* query whether it is time to exit */
 int SCR_Should_exit(int* flag);
 
+/* report progress of any outstanding asynchronous flush, returns the
+ * number of bytes written so far and the total number of bytes to be
+ * written summed across all processes, along with an estimate of the
+ * seconds remaining based on the transfer rate so far, the estimate
+ * is -1 until it can be computed, all values are zero when no flush
+ * is outstanding, this call is collective */
+int SCR_Flush_progress(double* bytes_transferred, double* bytes_total, double* secs_remaining);
+
+/* render this process's internal performance counters as JSON into
+ * buf, including per-phase latency histograms and bytes moved per
+ * store, returns the number of characters needed not counting the
+ * terminating NUL, like snprintf, so a return value >= size means
+ * the output was truncated, call with size 0 to size a buffer,
+ * this call is local to the calling process, not collective */
+int SCR_Get_stats(char* buf, int size);
+
 /* enable C++ codes to include this header directly */
 #ifdef __cplusplus
 } /* extern "C" */
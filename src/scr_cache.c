@@ -22,13 +22,33 @@ Dataset cache functions
 =========================================
 */
 
-static char* scr_cache_dir_from_str(const char* dir, const char* storage_view, int id)
+/* key to hold filemaps in our in-memory cache */
+#define SCR_CACHE_KEY_MAP ("MAP")
+
+/* in-memory copies of filemaps read from disk, keyed by dataset id,
+ * so repeat calls to scr_cache_get_map avoid re-reading and parsing
+ * the filemap file each time */
+static kvtree* scr_map_cache = NULL;
+
+/* append node-local directory components for a global-view store,
+ * with a FANOUT setting the node directories are hashed across a
+ * level of set.%d subdirectories so that no single parent collects
+ * one entry per node of the job */
+static void scr_cache_dir_append_node(spath* path, const scr_storedesc* store)
 {
-  /* build the dataset directory name */
-  spath* path = spath_from_str(dir);
-  if(! strcmp(storage_view, "GLOBAL")) {
+  if (! strcmp(store->view, "GLOBAL")) {
+    if (store->fanout > 1) {
+      spath_append_strf(path, "set.%d", scr_my_hostid % store->fanout);
+    }
     spath_append_strf(path, "node.%d", scr_my_hostid);
   }
+}
+
+static char* scr_cache_dir_from_str(const char* dir, const scr_storedesc* store, int id)
+{
+  /* build the dataset directory name */
+  spath* path = spath_from_str(dir);
+  scr_cache_dir_append_node(path, store);
   spath_append_strf(path, "scr.dataset.%d", id);
   spath_reduce(path);
   char* str = spath_strdup(path);
@@ -36,13 +56,11 @@ static char* scr_cache_dir_from_str(const char* dir, const char* storage_view, i
   return str;
 }
 
-static char* scr_cache_dir_hidden_from_str(const char* dir, const char* storage_view, int id)
+static char* scr_cache_dir_hidden_from_str(const char* dir, const scr_storedesc* store, int id)
 {
   /* build the dataset directory name */
   spath* path = spath_from_str(dir);
-  if(! strcmp(storage_view, "GLOBAL")) {
-    spath_append_strf(path, "node.%d", scr_my_hostid);
-  }
+  scr_cache_dir_append_node(path, store);
   spath_append_strf(path, "scr.dataset.%d", id);
   spath_append_str(path, ".scr");
   spath_reduce(path);
@@ -71,7 +89,7 @@ char* scr_cache_dir_get(const scr_reddesc* red, int id)
   }
 
   /* build the dataset directory name */
-  char* str = scr_cache_dir_from_str(red->directory, store->view, id);
+  char* str = scr_cache_dir_from_str(red->directory, store, id);
   return str;
 }
 
@@ -96,7 +114,7 @@ char* scr_cache_dir_hidden_get(const scr_reddesc* red, int id)
   }
 
   /* build the hidden directory name */
-  char* str = scr_cache_dir_hidden_from_str(red->directory, store->view, id);
+  char* str = scr_cache_dir_hidden_from_str(red->directory, store, id);
   return str;
 }
 
@@ -109,25 +127,21 @@ int scr_cache_dir_create(const scr_reddesc* red, int id)
   /* get store descriptor for this redudancy descriptor */
   scr_storedesc* store = scr_reddesc_get_store(red);
   if (store != NULL) {
-    /* create directory on store */
-    char* dir = scr_cache_dir_get(red, id);
-    if (scr_storedesc_dir_create(store, dir) != SCR_SUCCESS) {
-      /* check that we created the directory successfully,
+    /* create the dataset directory and its hidden .scr subdir in a
+     * single batched pass, which costs one collective rather than
+     * one per directory */
+    char* dir     = scr_cache_dir_get(red, id);
+    char* dir_scr = scr_cache_dir_hidden_get(red, id);
+    const char* dirs[2] = { dir, dir_scr };
+    if (scr_storedesc_dirs_create(store, 2, dirs) != SCR_SUCCESS) {
+      /* check that we created the directories successfully,
        * fatal error if not */
       scr_abort(-1, "Failed to create dataset directory %s, aborting @ %s:%d",
         dir, __FILE__, __LINE__
       );
     }
-    scr_free(&dir);
-
-    /* create hidden .scr subdir within dataset directory */
-    char* dir_scr = scr_cache_dir_hidden_get(red, id);
-    if (scr_storedesc_dir_create(store, dir_scr) != SCR_SUCCESS) {
-      scr_abort(-1, "Failed to create dataset directory %s, aborting @ %s:%d",
-        dir_scr, __FILE__, __LINE__
-      );
-    }
     scr_free(&dir_scr);
+    scr_free(&dir);
   } else {
     scr_abort(-1, "Invalid store descriptor @ %s:%d",
       __FILE__, __LINE__
@@ -175,6 +189,15 @@ const char* scr_cache_get_map_file(const scr_cache_index* cindex, int id)
 /* read file map for dataset from cache directory */
 int scr_cache_get_map(const scr_cache_index* cindex, int id, scr_filemap* map)
 {
+  /* serve the map from our in-memory copy if we have one */
+  if (scr_map_cache != NULL) {
+    kvtree* cached = kvtree_get_kv_int(scr_map_cache, SCR_CACHE_KEY_MAP, id);
+    if (cached != NULL) {
+      kvtree_merge(map, cached);
+      return SCR_SUCCESS;
+    }
+  }
+
   /* get directory for dataset */
   spath* path = scr_cache_get_map_path(cindex, id);
   if (path == NULL) {
@@ -187,6 +210,16 @@ int scr_cache_get_map(const scr_cache_index* cindex, int id, scr_filemap* map)
     rc = SCR_FAILURE;
   }
 
+  /* keep a copy in memory to serve later calls,
+   * only cache maps we actually read from disk */
+  if (rc == SCR_SUCCESS) {
+    if (scr_map_cache == NULL) {
+      scr_map_cache = kvtree_new();
+    }
+    kvtree* cached = kvtree_set_kv_int(scr_map_cache, SCR_CACHE_KEY_MAP, id);
+    kvtree_merge(cached, map);
+  }
+
   /* free the path to the map file */
   spath_delete(&path);
 
@@ -208,12 +241,30 @@ int scr_cache_set_map(const scr_cache_index* cindex, int id, const scr_filemap*
     rc = SCR_FAILURE;
   }
 
+  /* replace our in-memory copy with the new map contents */
+  if (scr_map_cache == NULL) {
+    scr_map_cache = kvtree_new();
+  }
+  kvtree_unset_kv_int(scr_map_cache, SCR_CACHE_KEY_MAP, id);
+  if (rc == SCR_SUCCESS) {
+    kvtree* cached = kvtree_set_kv_int(scr_map_cache, SCR_CACHE_KEY_MAP, id);
+    kvtree_merge(cached, map);
+  }
+
   /* free the path to the map file */
   spath_delete(&path);
 
   return rc;
 }
 
+/* drop all in-memory filemap copies, called at finalize */
+int scr_cache_free_maps(void)
+{
+  kvtree_delete(&scr_map_cache);
+  scr_map_cache = NULL;
+  return SCR_SUCCESS;
+}
+
 /* delete file map file for dataset from cache directory */
 int scr_cache_unset_map(const scr_cache_index* cindex, int id)
 {
@@ -223,6 +274,11 @@ int scr_cache_unset_map(const scr_cache_index* cindex, int id)
     return SCR_FAILURE;
   }
 
+  /* drop any in-memory copy of the map */
+  if (scr_map_cache != NULL) {
+    kvtree_unset_kv_int(scr_map_cache, SCR_CACHE_KEY_MAP, id);
+  }
+
   /* delete the file */
   const char* file = spath_strdup(path);
   scr_file_unlink(file);
@@ -234,8 +290,11 @@ int scr_cache_unset_map(const scr_cache_index* cindex, int id)
   return SCR_SUCCESS;
 }
 
-/* remove all files associated with specified dataset */
-int scr_cache_delete(scr_cache_index* cindex, int id)
+/* remove all files associated with specified dataset,
+ * when purge is set the per-file change detection and crc checks
+ * are skipped and the cache index is only updated in memory, the
+ * caller is responsible for disposing of the index file */
+static int scr_cache_delete_common(scr_cache_index* cindex, int id, int purge)
 {
   /* get cache directory for this dataset */
   char* dir = NULL;
@@ -269,6 +328,17 @@ int scr_cache_delete(scr_cache_index* cindex, int id)
   int bypass = 0;
   scr_cache_index_get_bypass(cindex, id, &bypass);
 
+  /* lookup the store descriptor for this directory,
+   * needed to remove the dataset directory below */
+  int store_index = scr_storedescs_index_from_child_path(dir);
+  int have_dir = (store_index >= 0 && store_index < scr_nstoredescs && dir != NULL);
+  int all_have_dir = scr_alltrue(have_dir, scr_comm_world);
+
+  /* if enabled, skip the per-file unlinks below and instead hand the
+   * whole dataset directory to the background reaper with a single
+   * rename, so eviction does not hold up the application */
+  int reap = (scr_delete_async && all_have_dir && ! bypass);
+
   /* get list of files for this dataset */
   scr_filemap* map = scr_filemap_new();
   scr_cache_get_map(cindex, id, map);
@@ -280,8 +350,18 @@ int scr_cache_delete(scr_cache_index* cindex, int id)
        file_elem = kvtree_elem_next(file_elem))
   {
     /* get the filename */
-    char* file = kvtree_elem_key(file_elem); 
-  
+    char* file = kvtree_elem_key(file_elem);
+
+    /* skip the change detection and crc checks below when purging,
+     * an unusable cache is being discarded wholesale and the stat
+     * and read of every cached file is what makes a purge slow */
+    if (purge) {
+      if (! bypass && ! reap) {
+        scr_file_unlink(file);
+      }
+      continue;
+    }
+
     /* verify that file mtime and ctime have not changed since scr_complete_output,
      * which could idenitfy a bug in the user's code */
     struct stat statbuf;
@@ -328,8 +408,10 @@ int scr_cache_delete(scr_cache_index* cindex, int id)
       }
     }
 
-    /* if we're not using bypass, delete data files from cache */
-    if (! bypass) {
+    /* if we're not using bypass, delete data files from cache,
+     * the reaper unlinks them in the background instead when
+     * async delete is enabled */
+    if (! bypass && ! reap) {
       /* delete the file */
       scr_file_unlink(file);
     }
@@ -345,24 +427,34 @@ int scr_cache_delete(scr_cache_index* cindex, int id)
    * from somewhere other than the redundancy descriptor, which may not be defined */
 
   /* remove the cache directory for this dataset */
-  int store_index = scr_storedescs_index_from_child_path(dir);
-  int have_dir = (store_index >= 0 && store_index < scr_nstoredescs && dir != NULL);
-  if (scr_alltrue(have_dir, scr_comm_world)) {
+  if (all_have_dir) {
     /* get store descriptor */
     scr_storedesc* store = &scr_storedescs[store_index];
 
-    /* remove hidden .scr subdirectory from cache */
-    if (scr_storedesc_dir_delete(store, dir_scr) != SCR_SUCCESS) {
-      scr_err("Failed to remove dataset directory: %s @ %s:%d",
-        dir_scr, __FILE__, __LINE__
-      );
-    }
-    
-    /* remove the dataset directory from cache */
-    if (scr_storedesc_dir_delete(store, dir) != SCR_SUCCESS) {
-      scr_err("Failed to remove dataset directory: %s @ %s:%d",
-        dir, __FILE__, __LINE__
-      );
+    if (reap) {
+      /* one rename moves the dataset directory, including the
+       * hidden .scr subdirectory, onto the reaper's queue, rotate
+       * the leader by dataset id so that deleting many datasets
+       * spreads the background unlink work across local ranks */
+      if (scr_storedesc_dir_reap_shift(store, dir, id) != SCR_SUCCESS) {
+        scr_err("Failed to reap dataset directory: %s @ %s:%d",
+          dir, __FILE__, __LINE__
+        );
+      }
+    } else {
+      /* remove hidden .scr subdirectory from cache */
+      if (scr_storedesc_dir_delete(store, dir_scr) != SCR_SUCCESS) {
+        scr_err("Failed to remove dataset directory: %s @ %s:%d",
+          dir_scr, __FILE__, __LINE__
+        );
+      }
+
+      /* remove the dataset directory from cache */
+      if (scr_storedesc_dir_delete(store, dir) != SCR_SUCCESS) {
+        scr_err("Failed to remove dataset directory: %s @ %s:%d",
+          dir, __FILE__, __LINE__
+        );
+      }
     }
   } else {
     /* TODO: We end up here if at least one process does not have its
@@ -380,9 +472,13 @@ int scr_cache_delete(scr_cache_index* cindex, int id)
 
   /* TODO: remove data from transfer file for this dataset */
 
-  /* remove this dataset from the index and write updated index to disk */
+  /* remove this dataset from the index and write updated index to disk,
+   * during a purge the caller deletes the index file once at the end
+   * rather than rewriting it after each dataset */
   scr_cache_index_remove_dataset(cindex, id);
-  scr_cache_index_write(scr_cindex_file, cindex);
+  if (! purge) {
+    scr_cache_index_write(scr_cindex_file, cindex);
+  }
 
   /* free path to hidden directory */
   scr_free(&dir_scr);
@@ -390,6 +486,12 @@ int scr_cache_delete(scr_cache_index* cindex, int id)
   return SCR_SUCCESS;
 }
 
+/* remove all files associated with specified dataset */
+int scr_cache_delete(scr_cache_index* cindex, int id)
+{
+  return scr_cache_delete_common(cindex, id, 0);
+}
+
 /* delete dataset with matching name from cache, if one exists */
 int scr_cache_delete_by_name(scr_cache_index* cindex, const char* name)
 {
@@ -485,10 +587,15 @@ int scr_cache_purge(scr_cache_index* cindex)
      * this also updates our dset_index value if appropriate */
     scr_next_dataset(ndsets, dsets, &dset_index, &current_id);
     
-    /* if we found a dataset, delete it */
+    /* if we found a dataset, delete it, skipping the per-file
+     * checks and per-dataset index writes since we discard the
+     * whole cache and delete the index file below, with async
+     * delete enabled the dataset directories are renamed onto the
+     * background reaper so the purge costs one rename per dataset
+     * on the startup path */
     if (current_id != -1) {
       /* remove this dataset from all tasks */
-      scr_cache_delete(cindex, current_id);
+      scr_cache_delete_common(cindex, current_id, 1);
     }
   } while (current_id != -1);
 
@@ -623,8 +730,26 @@ int scr_cache_check_files(const scr_cache_index* cindex, int id)
   scr_filemap* map = scr_filemap_new();
   scr_cache_get_map(cindex, id, map);
 
-  /* loop over each file in the map */
+  /* build a list of file names so we can query their attributes in
+   * one batched pass, issuing one synchronous stat per file is the
+   * dominant cost of this check on high-latency file systems */
+  int numfiles = scr_filemap_num_files(map);
+  const char** files    = (const char**)  SCR_MALLOC(numfiles * sizeof(const char*));
+  struct stat* statbufs = (struct stat*)  SCR_MALLOC(numfiles * sizeof(struct stat));
+  int* rcs              = (int*)          SCR_MALLOC(numfiles * sizeof(int));
+  int i = 0;
   kvtree_elem* file_elem;
+  for (file_elem = scr_filemap_first_file(map);
+       file_elem != NULL;
+       file_elem = kvtree_elem_next(file_elem))
+  {
+    files[i] = kvtree_elem_key(file_elem);
+    i++;
+  }
+  scr_file_stat_batch(numfiles, files, statbufs, rcs);
+
+  /* loop over each file in the map */
+  i = 0;
   for (file_elem = scr_filemap_first_file(map);
        file_elem != NULL;
        file_elem = kvtree_elem_next(file_elem))
@@ -632,10 +757,11 @@ int scr_cache_check_files(const scr_cache_index* cindex, int id)
     /* get the filename */
     char* file = kvtree_elem_key(file_elem);
 
-    /* check that we can read the file */
-    if (scr_file_is_readable(file) != SCR_SUCCESS) {
+    /* check that the file is there */
+    if (rcs[i] != SCR_SUCCESS) {
       failed_read = 1;
     }
+    i++;
 
     /* get meta data for this file */
     scr_meta* meta = scr_meta_new();
@@ -650,6 +776,11 @@ int scr_cache_check_files(const scr_cache_index* cindex, int id)
     scr_meta_delete(&meta);
   }
 
+  /* free the attribute lists */
+  scr_free(&rcs);
+  scr_free(&statbufs);
+  scr_free(&files);
+
   /* free the map */
   scr_filemap_delete(&map);
 
@@ -34,6 +34,9 @@ int scr_cache_set_map(const scr_cache_index* cindex, int id, const scr_filemap*
 /* delete file map file for dataset from cache directory */
 int scr_cache_unset_map(const scr_cache_index* cindex, int id);
 
+/* drop all in-memory filemap copies, called at finalize */
+int scr_cache_free_maps(void);
+
 /* return string pointing to filemap file, caller must free string when done */
 const char* scr_cache_get_map_file(const scr_cache_index* cindex, int id);
 
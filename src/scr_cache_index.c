@@ -40,6 +40,8 @@
 #define SCR_CINDEX_KEY_DATA      ("DSETDESC")
 #define SCR_CINDEX_KEY_PATH      ("PATH")
 #define SCR_CINDEX_KEY_BYPASS    ("BYPASS")
+#define SCR_CINDEX_KEY_ENCODING  ("ENCODING")
+#define SCR_CINDEX_KEY_FAILED    ("FAILED")
 
 /* returns the DSET hash */
 static kvtree* scr_cache_index_get_dh(const kvtree* h)
@@ -206,6 +208,68 @@ int scr_cache_index_get_bypass(const scr_cache_index* cindex, int dset, int* byp
   return SCR_FAILURE; 
 }
 
+/* mark dataset as having its redundancy encoding in progress,
+ * set when encoding is deferred to a background thread and cleared
+ * once the encoding completes */
+int scr_cache_index_set_encoding(scr_cache_index* cindex, int dset, int encoding)
+{
+  /* set indicies and get hash reference */
+  kvtree* d = scr_cache_index_set_d(cindex, dset);
+
+  /* set the ENCODING value under the RANK/DSET hash */
+  kvtree_util_set_int(d, SCR_CINDEX_KEY_ENCODING, encoding);
+
+  return SCR_SUCCESS;
+}
+
+/* get value of encoding flag for dataset */
+int scr_cache_index_get_encoding(const scr_cache_index* cindex, int dset, int* encoding)
+{
+  /* assume the dataset is not in the middle of an encode */
+  *encoding = 0;
+
+  /* get RANK/CKPT hash */
+  kvtree* d = scr_cache_index_get_d(cindex, dset);
+
+  /* get the ENCODING value under the RANK/DSET hash */
+  if (kvtree_util_get_int(d, SCR_CINDEX_KEY_ENCODING, encoding) == KVTREE_SUCCESS) {
+    return SCR_SUCCESS;
+  }
+
+  return SCR_FAILURE;
+}
+
+/* mark dataset as having failed a CRC verification in cache,
+ * set by the background scrubber so flush refuses to copy known-bad
+ * data and restart rebuilds the dataset from its redundancy data */
+int scr_cache_index_set_failed(scr_cache_index* cindex, int dset, int failed)
+{
+  /* set indicies and get hash reference */
+  kvtree* d = scr_cache_index_set_d(cindex, dset);
+
+  /* set the FAILED value under the RANK/DSET hash */
+  kvtree_util_set_int(d, SCR_CINDEX_KEY_FAILED, failed);
+
+  return SCR_SUCCESS;
+}
+
+/* get value of failed flag for dataset */
+int scr_cache_index_get_failed(const scr_cache_index* cindex, int dset, int* failed)
+{
+  /* assume the dataset has not failed a verification */
+  *failed = 0;
+
+  /* get RANK/CKPT hash */
+  kvtree* d = scr_cache_index_get_d(cindex, dset);
+
+  /* get the FAILED value under the RANK/DSET hash */
+  if (kvtree_util_get_int(d, SCR_CINDEX_KEY_FAILED, failed) == KVTREE_SUCCESS) {
+    return SCR_SUCCESS;
+  }
+
+  return SCR_FAILURE;
+}
+
 /* remove all associations for a given dataset */
 int scr_cache_index_remove_dataset(scr_cache_index* cindex, int dset)
 {
@@ -81,6 +81,18 @@ int scr_cache_index_set_bypass(scr_cache_index* cindex, int dset, int bypass);
 /* get value of bypass flag for dataset */
 int scr_cache_index_get_bypass(const scr_cache_index* cindex, int dset, int* bypass);
 
+/* mark dataset as having its redundancy encoding in progress */
+int scr_cache_index_set_encoding(scr_cache_index* cindex, int dset, int encoding);
+
+/* get value of encoding flag for dataset */
+int scr_cache_index_get_encoding(const scr_cache_index* cindex, int dset, int* encoding);
+
+/* mark dataset as having failed a CRC verification in cache */
+int scr_cache_index_set_failed(scr_cache_index* cindex, int dset, int failed);
+
+/* get value of failed flag for dataset */
+int scr_cache_index_get_failed(const scr_cache_index* cindex, int dset, int* failed);
+
 /*
 =========================================
 Cache index clear and copy functions
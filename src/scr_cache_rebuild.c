@@ -31,6 +31,7 @@
  */
 
 #include "scr_globals.h"
+#include "scr_flush_file_io.h"
 
 /*
 =========================================
@@ -38,19 +39,31 @@ Distribute and file rebuild functions
 =========================================
 */
 
-/* broadcast dataset hash from smallest rank we can find that has a copy */
-static int scr_distribute_datasets(scr_cache_index* cindex, int id)
+/* distribute dataset descriptor, bypass property, and cache
+ * directory for the given dataset in one packed broadcast, these
+ * were formerly shipped as separate tree and string broadcasts per
+ * dataset, whose latency dominated rebuild time at scale before any
+ * file data moved */
+static int scr_distribute_metadata(scr_cache_index* cindex, int id, char** hidden_dir)
 {
-  int i;
+  /* initialize output path to NULL */
+  *hidden_dir = NULL;
 
-  /* attempt to read dataset from our index */
-  int source_rank = scr_ranks_world;
+  /* determine whether we have the metadata for this dataset,
+   * the entries are written to the cache index together, so one
+   * election covers the whole set */
   scr_dataset* dataset = scr_dataset_new();
-  if (scr_cache_index_get_dataset(cindex, id, dataset) == SCR_SUCCESS) {
+  int bypass = 0;
+  char* dir_tmp = NULL;
+  int source_rank = scr_ranks_world;
+  if (scr_cache_index_get_dataset(cindex, id, dataset) == SCR_SUCCESS &&
+      scr_cache_index_get_bypass(cindex, id, &bypass)  == SCR_SUCCESS &&
+      scr_cache_index_get_dir(cindex, id, &dir_tmp)    == SCR_SUCCESS)
+  {
     source_rank = scr_my_rank_world;
   }
 
-  /* identify the smallest rank that has the dataset */
+  /* identify the smallest rank that has the metadata */
   int min_rank;
   MPI_Allreduce(&source_rank, &min_rank, 1, MPI_INT, MPI_MIN, scr_comm_world);
 
@@ -60,82 +73,60 @@ static int scr_distribute_datasets(scr_cache_index* cindex, int id)
     return SCR_FAILURE;
   }
 
-  /* otherwise, bcast the dataset from the minimum rank */
-  if (scr_my_rank_world != min_rank) {
-    kvtree_unset_all(dataset);
+  /* the source packs the bypass flag, directory string, and dataset
+   * hash into one contiguous buffer */
+  unsigned long size = 0;
+  char* buf = NULL;
+  char* dir = NULL;
+  if (scr_my_rank_world == min_rank) {
+    dir = strdup(dir_tmp);
+    size_t dir_len  = strlen(dir) + 1;
+    size_t pack_len = kvtree_pack_size(dataset);
+    size = 2 * sizeof(int) + dir_len + pack_len;
+
+    buf = (char*) SCR_MALLOC(size);
+    char* p = buf;
+    memcpy(p, &bypass, sizeof(int));
+    p += sizeof(int);
+    int len = (int) dir_len;
+    memcpy(p, &len, sizeof(int));
+    p += sizeof(int);
+    memcpy(p, dir, dir_len);
+    p += dir_len;
+    kvtree_pack(p, dataset);
   }
-  kvtree_bcast(dataset, min_rank, scr_comm_world);
 
-  /* attempt to read bypass property from our index */
-  source_rank = scr_ranks_world;
-  int bypass;
-  if (scr_cache_index_get_bypass(cindex, id, &bypass) == SCR_SUCCESS) {
-    source_rank = scr_my_rank_world;
+  /* one size message and one payload message per dataset */
+  MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG, min_rank, scr_comm_world);
+  if (scr_my_rank_world != min_rank) {
+    buf = (char*) SCR_MALLOC(size);
   }
+  MPI_Bcast(buf, (int) size, MPI_BYTE, min_rank, scr_comm_world);
 
-  /* identify the smallest rank that has the value */
-  MPI_Allreduce(&source_rank, &min_rank, 1, MPI_INT, MPI_MIN, scr_comm_world);
-
-  /* if there is no rank, return with failure */
-  if (min_rank >= scr_ranks_world) {
-    scr_dataset_delete(&dataset);
-    return SCR_FAILURE;
+  /* everyone else unpacks the buffer */
+  if (scr_my_rank_world != min_rank) {
+    char* p = buf;
+    memcpy(&bypass, p, sizeof(int));
+    p += sizeof(int);
+    int len;
+    memcpy(&len, p, sizeof(int));
+    p += sizeof(int);
+    dir = strdup(p);
+    p += len;
+    kvtree_unset_all(dataset);
+    kvtree_unpack(p, dataset);
   }
+  scr_free(&buf);
 
-  /* otherwise, bcast the bypass property from the minimum rank */
-  MPI_Bcast(&bypass, 1, MPI_INT, min_rank, scr_comm_world);
-
-  /* record the descriptor in our cache index */
+  /* record the metadata in our cache index */
   scr_cache_index_set_dataset(cindex, id, dataset);
   scr_cache_index_set_bypass(cindex, id, bypass);
+  scr_cache_index_set_dir(cindex, id, dir);
   scr_cache_index_write(scr_cindex_file, cindex);
 
   /* free off dataset object */
   scr_dataset_delete(&dataset);
 
-  return SCR_SUCCESS;
-}
-
-/* broadcast dir from smallest rank and lookup store descriptor we can find that has a copy */
-static int scr_distribute_dir(scr_cache_index* cindex, int id, char** hidden_dir)
-{
-  int i;
-
-  /* initialize output path to NULL */
-  *hidden_dir = NULL;
-
-  /* determine whether we have the cache directory for this dataset */
-  char* dir  = NULL;
-  char* path = NULL;
-  int source_rank = scr_ranks_world;
-  if (scr_cache_index_get_dir(cindex, id, &path) == SCR_SUCCESS) {
-    /* we've got a copy, make a copy */
-    dir = strdup(path);
-    source_rank = scr_my_rank_world;
-  }
-
-  /* identify the smallest rank that has the dataset */
-  int min_rank;
-  MPI_Allreduce(&source_rank, &min_rank, 1, MPI_INT, MPI_MIN, scr_comm_world);
-
-  /* if there is no rank, return with failure */
-  if (min_rank >= scr_ranks_world) {
-    return SCR_FAILURE;
-  }
-
-  /* if we're not bcasting the string, free our copy if we have one,
-   * we'll get a new copy from the bcast */
-  if (scr_my_rank_world != min_rank) {
-    scr_free(&dir);
-  }
-
-  /* bcast the dataset from the minimum rank */
-  scr_str_bcast(&dir, min_rank, scr_comm_world);
-
-  /* record the directory in the cache index */
-  scr_cache_index_set_dir(cindex, id, dir);
-  scr_cache_index_write(scr_cindex_file, cindex);
-
   /* lookup store descriptor for this path */
   int store_index = scr_storedescs_index_from_child_path(dir);
 
@@ -154,11 +145,9 @@ static int scr_distribute_dir(scr_cache_index* cindex, int id, char** hidden_dir
   /* get store descriptor */
   scr_storedesc* store = &scr_storedescs[store_index];
 
-  /* create the directory */
-  scr_storedesc_dir_create(store, dir);
-
-  /* create the hidden directory */
-  scr_storedesc_dir_create(store, *hidden_dir);
+  /* create the directory and its hidden subdirectory in one pass */
+  const char* dirs[2] = { dir, *hidden_dir };
+  scr_storedesc_dirs_create(store, 2, dirs);
 
   /* free direcotry string */
   scr_free(&dir);
@@ -166,6 +155,146 @@ static int scr_distribute_dir(scr_cache_index* cindex, int id, char** hidden_dir
   return SCR_SUCCESS;
 }
 
+/* distribute metadata and rebuild files for one dataset, updates
+ * dataset and checkpoint counters on success, records in
+ * output_failed_rebuild whether we lost an output set, and sets rc
+ * to SCR_SUCCESS once any checkpoint has been rebuilt */
+static void scr_cache_rebuild_dataset(
+  scr_cache_index* cindex,
+  int current_id,
+  int* output_failed_rebuild,
+  int* rc)
+{
+  /* log the attempt */
+  if (scr_my_rank_world == 0) {
+    scr_dbg(1, "Attempting to distribute and rebuild dataset %d", current_id);
+    if (scr_log_enable) {
+      scr_log_event("REBUILD_START", NULL, &current_id, NULL, NULL, NULL);
+    }
+  }
+
+  /* assume we'll fail to rebuild */
+  int rebuild_succeeded = 0;
+
+  /* distribute dataset descriptor, bypass flag, and cache
+   * directory for this dataset in one packed broadcast,
+   * this also recreates the directory */
+  char* path;
+  if (scr_distribute_metadata(cindex, current_id, &path) == SCR_SUCCESS) {
+    /* get dataset for this id */
+    scr_dataset* dataset = scr_dataset_new();
+    scr_cache_index_get_dataset(cindex, current_id, dataset);
+
+    /* rebuild files for this dataset */
+    int tmp_rc = scr_reddesc_recover(cindex, current_id, path);
+    if (tmp_rc == SCR_SUCCESS) {
+      /* rebuild succeeded */
+      rebuild_succeeded = 1;
+
+      /* if we have a checkpoint, update dataset and checkpoint counters,
+       * however skip this if we failed to rebuild an output set, in this
+       * case we'll restart from the checkpoint before the lost output set */
+      int is_ckpt = scr_dataset_is_ckpt(dataset);
+      if (is_ckpt && !*output_failed_rebuild) {
+        /* if we rebuild any checkpoint, return success */
+        *rc = SCR_SUCCESS;
+
+        /* if id of dataset we just rebuilt is newer,
+         * update scr_dataset_id */
+        if (current_id > scr_dataset_id) {
+          scr_dataset_id = current_id;
+        }
+
+        /* get checkpoint id for dataset */
+        int ckpt_id;
+        scr_dataset_get_ckpt(dataset, &ckpt_id);
+
+        /* if checkpoint id of dataset we just rebuilt is newer,
+         * update scr_checkpoint_id and scr_ckpt_dset_id */
+        if (ckpt_id > scr_checkpoint_id) {
+          /* got a more recent checkpoint, update our checkpoint info */
+          scr_checkpoint_id = ckpt_id;
+          scr_ckpt_dset_id = current_id;
+        }
+      }
+
+      /* if a previous run was killed while a deferred encode was
+       * in flight, the dataset is marked as ENCODING, the recover
+       * above has verified or rebuilt its redundancy data, so the
+       * marker can be cleared */
+      int encoding = 0;
+      scr_cache_index_get_encoding(cindex, current_id, &encoding);
+      if (encoding) {
+        scr_cache_index_set_encoding(cindex, current_id, 0);
+        scr_cache_index_write(scr_cindex_file, cindex);
+      }
+
+      /* update our flush file to indicate this dataset is in cache */
+      scr_flush_file_location_set(current_id, SCR_FLUSH_KEY_LOCATION_CACHE);
+
+      /* TODO: if storing flush file in control directory on each node,
+       * if we find any process that has marked the dataset as flushed,
+       * marked it as flushed in every flush file */
+
+      /* TODO: would like to restore flushing status to datasets that
+       * were in the middle of a flush, but we need to better manage
+       * the transfer file to do this, so for now just forget about
+       * flushing this dataset */
+      scr_flush_file_location_unset(current_id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
+
+      /* recreate any small files held in packfiles so the
+       * application can read them directly on restart */
+      scr_filemap* pack_map = scr_filemap_new();
+      scr_cache_get_map(cindex, current_id, pack_map);
+      scr_pack_extract(pack_map);
+      scr_filemap_delete(&pack_map);
+    }
+
+    /* free path */
+    scr_free(&path);
+
+    /* remember if we fail to rebuild an output set */
+    int is_output = scr_dataset_is_output(dataset);
+    if (!rebuild_succeeded && is_output) {
+      *output_failed_rebuild = 1;
+    }
+
+    /* free dataset */
+    scr_dataset_delete(&dataset);
+  } else {
+    /* if we failed to distribute dataset info, then we can't know
+     * whether this was output or not, so we have to assume it was */
+    *output_failed_rebuild = 1;
+  }
+
+  /* if the distribute or rebuild failed, delete the dataset */
+  if (! rebuild_succeeded) {
+    /* log that we failed */
+    if (scr_my_rank_world == 0) {
+      scr_dbg(1, "Failed to rebuild dataset %d", current_id);
+      if (scr_log_enable) {
+        scr_log_event("REBUILD_FAIL", NULL, &current_id, NULL, NULL, NULL);
+      }
+    }
+
+    /* TODO: there is a bug here, since scr_cache_delete needs to read
+     * the redundancy descriptor from the filemap in order to delete the
+     * cache directory, but we may have failed to distribute the reddescs
+     * above so not every task has one */
+
+    /* rebuild failed, delete this dataset from cache */
+    scr_cache_delete(cindex, current_id);
+  } else {
+    /* rebuid worked, log success */
+    if (scr_my_rank_world == 0) {
+      scr_dbg(1, "Rebuilt dataset %d", current_id);
+      if (scr_log_enable) {
+        scr_log_event("REBUILD_SUCCESS", NULL, &current_id, NULL, NULL, NULL);
+      }
+    }
+  }
+}
+
 /* distribute and rebuild files in cache */
 int scr_cache_rebuild(scr_cache_index* cindex)
 {
@@ -224,134 +353,70 @@ int scr_cache_rebuild(scr_cache_index* cindex)
   int* dsets;
   scr_cache_index_list_datasets(cindex, &ndsets, &dsets);
 
-  /* TODO: put dataset selection logic into a function */
-
   /* TODO: also attempt to recover datasets which we were in the
    * middle of flushing */
+
+  /* find the most recent checkpoint across all ranks, along with the
+   * oldest output set, ranks on replacement nodes have an empty cache
+   * and contribute nothing, the checkpoint the job will restart from
+   * is rebuilt first below so the job can resume as soon as its data
+   * is decoded rather than after every older dataset has been redone */
+  int my_latest_ckpt = -1;
+  int my_first_output = -1;
+  int i;
+  for (i = 0; i < ndsets; i++) {
+    scr_dataset* dataset = scr_dataset_new();
+    if (scr_cache_index_get_dataset(cindex, dsets[i], dataset) == SCR_SUCCESS) {
+      if (scr_dataset_is_ckpt(dataset) && dsets[i] > my_latest_ckpt) {
+        my_latest_ckpt = dsets[i];
+      }
+      if (scr_dataset_is_output(dataset) &&
+          (my_first_output == -1 || dsets[i] < my_first_output))
+      {
+        my_first_output = dsets[i];
+      }
+    }
+    scr_dataset_delete(&dataset);
+  }
+
+  int latest_ckpt;
+  MPI_Allreduce(&my_latest_ckpt, &latest_ckpt, 1, MPI_INT, MPI_MAX, scr_comm_world);
+
+  /* an output set must be rebuilt in id order, since losing one holds
+   * the restart back to the checkpoint before it, so we only rebuild
+   * the latest checkpoint out of order when no output set precedes it */
+  int my_neg_output = (my_first_output != -1) ? -my_first_output : INT_MIN;
+  int neg_output;
+  MPI_Allreduce(&my_neg_output, &neg_output, 1, MPI_INT, MPI_MAX, scr_comm_world);
+  int first_output = (neg_output != INT_MIN) ? -neg_output : -1;
+
   int current_id;
   int dset_index = 0;
   int output_failed_rebuild = 0;
+
+  int first_id = -1;
+  if (latest_ckpt != -1 && (first_output == -1 || first_output > latest_ckpt)) {
+    first_id = latest_ckpt;
+    distribute_attempted = 1;
+    if (scr_my_rank_world == 0) {
+      scr_dbg(1, "Rebuilding most recent checkpoint dataset %d first", first_id);
+    }
+    scr_cache_rebuild_dataset(cindex, first_id, &output_failed_rebuild, &rc);
+  }
+
+  /* rebuild the remaining datasets in id order */
   do {
     /* get the smallest index across all processes (returned in current_id),
      * this also updates our dset_index value if appropriate */
     scr_next_dataset(ndsets, dsets, &dset_index, &current_id);
 
-    /* if we found a dataset, try to distribute and rebuild it */
-    if (current_id != -1) {
+    /* if we found a dataset, try to distribute and rebuild it,
+     * skipping the checkpoint we already rebuilt above */
+    if (current_id != -1 && current_id != first_id) {
       /* remember that we made an attempt to distribute at least one dataset */
       distribute_attempted = 1;
-      
-      /* log the attempt */
-      if (scr_my_rank_world == 0) {
-        scr_dbg(1, "Attempting to distribute and rebuild dataset %d", current_id);
-        if (scr_log_enable) {
-          scr_log_event("REBUILD_START", NULL, &current_id, NULL, NULL, NULL);
-        }
-      }
 
-      /* assume we'll fail to rebuild */
-      int rebuild_succeeded = 0;
-
-      /* distribute dataset descriptor for this dataset */
-      if (scr_distribute_datasets(cindex, current_id) == SCR_SUCCESS) {
-        /* get dataset for this id */
-        scr_dataset* dataset = scr_dataset_new();
-        scr_cache_index_get_dataset(cindex, current_id, dataset);
-
-        /* get and recreate directory from cindex */
-        char* path;
-        if (scr_distribute_dir(cindex, current_id, &path) == SCR_SUCCESS) {
-          /* rebuild files for this dataset */
-          int tmp_rc = scr_reddesc_recover(cindex, current_id, path);
-          if (tmp_rc == SCR_SUCCESS) {
-            /* rebuild succeeded */
-            rebuild_succeeded = 1;
-
-            /* if we have a checkpoint, update dataset and checkpoint counters,
-             * however skip this if we failed to rebuild an output set, in this
-             * case we'll restart from the checkpoint before the lost output set */
-            int is_ckpt = scr_dataset_is_ckpt(dataset);
-            if (is_ckpt && !output_failed_rebuild) {
-              /* if we rebuild any checkpoint, return success */
-              rc = SCR_SUCCESS;
-
-              /* if id of dataset we just rebuilt is newer,
-               * update scr_dataset_id */
-              if (current_id > scr_dataset_id) {
-                scr_dataset_id = current_id;
-              }
-
-              /* get checkpoint id for dataset */
-              int ckpt_id;
-              scr_dataset_get_ckpt(dataset, &ckpt_id);
-
-              /* if checkpoint id of dataset we just rebuilt is newer,
-               * update scr_checkpoint_id and scr_ckpt_dset_id */
-              if (ckpt_id > scr_checkpoint_id) {
-                /* got a more recent checkpoint, update our checkpoint info */
-                scr_checkpoint_id = ckpt_id;
-                scr_ckpt_dset_id = current_id;
-              }
-            }
-
-            /* update our flush file to indicate this dataset is in cache */
-            scr_flush_file_location_set(current_id, SCR_FLUSH_KEY_LOCATION_CACHE);
-
-            /* TODO: if storing flush file in control directory on each node,
-             * if we find any process that has marked the dataset as flushed,
-             * marked it as flushed in every flush file */
-
-            /* TODO: would like to restore flushing status to datasets that
-             * were in the middle of a flush, but we need to better manage
-             * the transfer file to do this, so for now just forget about
-             * flushing this dataset */
-            scr_flush_file_location_unset(current_id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
-          }
-
-          /* free path */
-          scr_free(&path);
-        }
-
-        /* remember if we fail to rebuild an output set */
-        int is_output = scr_dataset_is_output(dataset);
-        if (!rebuild_succeeded && is_output) {
-          output_failed_rebuild = 1;
-        }
-
-        /* free dataset */
-        scr_dataset_delete(&dataset);
-      } else {
-        /* if we failed to distribute dataset info, then we can't know
-         * whether this was output or not, so we have to assume it was */
-        output_failed_rebuild = 1;
-      }
-
-      /* if the distribute or rebuild failed, delete the dataset */
-      if (! rebuild_succeeded) {
-        /* log that we failed */
-        if (scr_my_rank_world == 0) {
-          scr_dbg(1, "Failed to rebuild dataset %d", current_id);
-          if (scr_log_enable) {
-            scr_log_event("REBUILD_FAIL", NULL, &current_id, NULL, NULL, NULL);
-          }
-        }
-
-        /* TODO: there is a bug here, since scr_cache_delete needs to read
-         * the redundancy descriptor from the filemap in order to delete the
-         * cache directory, but we may have failed to distribute the reddescs
-         * above so not every task has one */
-
-        /* rebuild failed, delete this dataset from cache */
-        scr_cache_delete(cindex, current_id);
-      } else {
-        /* rebuid worked, log success */
-        if (scr_my_rank_world == 0) {
-          scr_dbg(1, "Rebuilt dataset %d", current_id);
-          if (scr_log_enable) {
-            scr_log_event("REBUILD_SUCCESS", NULL, &current_id, NULL, NULL, NULL);
-          }
-        }
-      }
+      scr_cache_rebuild_dataset(cindex, current_id, &output_failed_rebuild, &rc);
     }
   } while (current_id != -1);
 
@@ -411,7 +476,7 @@ int scr_flush_file_rebuild(const scr_cache_index* cindex)
   if (scr_my_rank_world == 0) {
     /* read the flush file */
     kvtree* hash = kvtree_new();
-    kvtree_read_path(scr_flush_file, hash);
+    scr_flush_file_read_path(scr_flush_file, hash);
 
     /* get ordered list of dataset ids in flush file */
     int flush_ndsets;
@@ -475,7 +540,7 @@ int scr_flush_file_rebuild(const scr_cache_index* cindex)
     scr_free(&flush_dsets);
 
     /* write the hash back to the flush file */
-    kvtree_write_path(scr_flush_file, hash);
+    scr_flush_file_write_path(scr_flush_file, hash);
 
     /* delete the hash */
     kvtree_delete(&hash);
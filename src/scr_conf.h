@@ -72,6 +72,21 @@
 #define SCR_LOG_SYSLOG_LEVEL LOG_INFO
 #endif
 
+/* number of transfer records to batch per database insert */
+#ifndef SCR_LOG_DB_BATCH
+#define SCR_LOG_DB_BATCH (1)
+#endif
+
+/* whether to emit log entries from a background thread */
+#ifndef SCR_LOG_ASYNC_ENABLE
+#define SCR_LOG_ASYNC_ENABLE (0)
+#endif
+
+/* number of entries in the ring buffer of deferred log entries */
+#ifndef SCR_LOG_ASYNC_ENTRIES
+#define SCR_LOG_ASYNC_ENTRIES (256)
+#endif
+
 /* default number of halt seconds to apply to a job */
 #ifndef SCR_HALT_SECONDS
 #define SCR_HALT_SECONDS (0)
@@ -82,6 +97,30 @@
 #define SCR_HALT_EXIT (0)
 #endif
 
+/* whether rank 0 runs a thread to watch the halt file for changes,
+ * when set, halt checks only lock and read the file after the
+ * watcher has seen it change rather than at every checkpoint */
+#ifndef SCR_HALT_WATCH
+#define SCR_HALT_WATCH (0)
+#endif
+
+/* seconds between polls of the halt file by the watcher thread */
+#ifndef SCR_HALT_WATCH_SECONDS
+#define SCR_HALT_WATCH_SECONDS (10)
+#endif
+
+/* whether to dump per-rank performance counters as JSON files
+ * in the prefix directory at SCR_Finalize */
+#ifndef SCR_STATS_DUMP
+#define SCR_STATS_DUMP (0)
+#endif
+
+/* whether to record phase and transfer events in a binary trace
+ * ring in the control directory, merged by the scr_trace tool */
+#ifndef SCR_TRACE
+#define SCR_TRACE (0)
+#endif
+
 /* =========================================================================
  * Default config file location, control directory, and cache and checkpoint configuration.
  * ========================================================================= */
@@ -97,6 +136,10 @@
 /* name of application config file */
 #define SCR_CONFIG_FILE_APP "app.conf"
 
+/* name of compiled config bundle, caches the parsed contents of the
+ * system, user, and app config files in one packed file */
+#define SCR_CONFIG_FILE_BUNDLE "config.bundle"
+
 /* base control directory */
 #ifndef SCR_CNTL_BASE
 #define SCR_CNTL_BASE "/dev/shm"
@@ -117,6 +160,12 @@
 #define SCR_COPY_TYPE (SCR_COPY_XOR)
 #endif
 
+/* whether PARTNER descriptors copy files with the native one-sided
+ * path instead of the ER encode */
+#ifndef SCR_PARTNER_RMA
+#define SCR_PARTNER_RMA (0)
+#endif
+
 /* default failure group */
 #ifndef SCR_GROUP
 #define SCR_GROUP (SCR_GROUP_NODE)
@@ -132,11 +181,51 @@
 #define SCR_SET_FAILURES (2)
 #endif
 
+/* default number of threads to use when computing redundancy encoding,
+ * set to 0 to leave the encode library's team size alone */
+#ifndef SCR_ENCODE_THREADS
+#define SCR_ENCODE_THREADS (0)
+#endif
+
+/* whether to defer redundancy encoding to a background thread after
+ * scr_complete_output rather than encoding before returning */
+#ifndef SCR_ENCODE_ASYNC
+#define SCR_ENCODE_ASYNC (0)
+#endif
+
+/* whether to start the async flush of a dataset before its deferred
+ * redundancy encode finishes, so the transfer to the parallel file
+ * system overlaps with the encode, requires SCR_ENCODE_ASYNC and
+ * SCR_FLUSH_ASYNC */
+#ifndef SCR_FLUSH_PIPELINE
+#define SCR_FLUSH_PIPELINE (0)
+#endif
+
 /* default cache bypass setting */
 #ifndef SCR_CACHE_BYPASS
 #define SCR_CACHE_BYPASS (1)
 #endif
 
+/* files smaller than this number of bytes are packed into a single
+ * per-rank packfile in cache so encode and flush pay one file's
+ * overhead for the whole set, set to 0 to disable packing */
+#ifndef SCR_CACHE_PACK_SIZE
+#define SCR_CACHE_PACK_SIZE (0)
+#endif
+
+/* whether to persist a topology snapshot in the prefix directory
+ * so SCR_Init in a later run of the same allocation can skip the
+ * hostname sorts when setting up group communicators */
+#ifndef SCR_TOPO_CACHE
+#define SCR_TOPO_CACHE (1)
+#endif
+
+/* whether to mirror bypass checkpoints back into cache in the
+ * background so a later failure can restart from cache */
+#ifndef SCR_CACHE_MIRROR
+#define SCR_CACHE_MIRROR (0)
+#endif
+
 /* =========================================================================
  * Default buffer sizes for MPI and file I/O operations.
  * ========================================================================= */
@@ -176,6 +265,28 @@
 #define SCR_FETCH_BYPASS (0)
 #endif
 
+/* number of worker threads per process used to copy files during fetch */
+#ifndef SCR_FETCH_THREADS
+#define SCR_FETCH_THREADS (1)
+#endif
+
+/* whether SCR_Init may fetch in a background thread */
+#ifndef SCR_FETCH_ASYNC
+#define SCR_FETCH_ASYNC (0)
+#endif
+
+/* whether to fetch files on demand as the restart routes them */
+#ifndef SCR_FETCH_LAZY
+#define SCR_FETCH_LAZY (0)
+#endif
+
+/* whether to validate a fetch candidate before copying its files,
+ * a damaged checkpoint is then skipped at the cost of a stat pass
+ * rather than a failed fetch attempt */
+#ifndef SCR_FETCH_VALIDATE
+#define SCR_FETCH_VALIDATE (1)
+#endif
+
 /* set to 0 to disable flush, set to a positive number to set how many checkpoints between flushes */
 #ifndef SCR_FLUSH
 #define SCR_FLUSH (10)
@@ -186,6 +297,54 @@
 #define SCR_FLUSH_WIDTH (SCR_FETCH_WIDTH)
 #endif
 
+/* number of worker threads each process uses to flush its files during
+ * a synchronous flush, set to 0 or 1 to flush files one at a time */
+#ifndef SCR_FLUSH_THREADS
+#define SCR_FLUSH_THREADS (0)
+#endif
+
+/* max number of ranks per node to act as parallel file system clients
+ * during a synchronous flush, set to 0 to have every rank write its own files */
+#ifndef SCR_FLUSH_LEADERS
+#define SCR_FLUSH_LEADERS (0)
+#endif
+
+/* whether to pack files into per-node container files during flush */
+#ifndef SCR_FLUSH_CONTAINER
+#define SCR_FLUSH_CONTAINER (0)
+#endif
+
+/* whether to skip flushing files that have not changed since the last flush */
+#ifndef SCR_FLUSH_INCREMENTAL
+#define SCR_FLUSH_INCREMENTAL (0)
+#endif
+
+/* number of consecutive flushes a node must trail the median bandwidth
+ * before it is reported as a straggler (0 disables detection) */
+#ifndef SCR_FLUSH_STRAGGLER
+#define SCR_FLUSH_STRAGGLER (3)
+#endif
+
+/* whether to compress file data during flush (0 none, 1 zlib) */
+#ifndef SCR_FLUSH_COMPRESS
+#define SCR_FLUSH_COMPRESS (0)
+#endif
+
+/* aggregate bandwidth limit imposed during flush in bytes/sec (0 disables) */
+#ifndef SCR_FLUSH_BW
+#define SCR_FLUSH_BW (0.0)
+#endif
+
+/* aggregate bandwidth limit for datasets marked SCR_FLAG_BULK in bytes/sec (0 disables) */
+#ifndef SCR_FLUSH_BW_BULK
+#define SCR_FLUSH_BW_BULK (0.0)
+#endif
+
+/* ranks per rank2file part file during flush (0 picks a value based on job size) */
+#ifndef SCR_RANK2FILE_SHARD
+#define SCR_RANK2FILE_SHARD (0)
+#endif
+
 /* whether to force a flush on a restart (useful for codes that must restart from parallel file system) */
 #ifndef SCR_FLUSH_ON_RESTART
 #define SCR_FLUSH_ON_RESTART (0)
@@ -211,6 +370,29 @@
 #define SCR_FLUSH_ASYNC_PERCENT (0.0) /* TODO: the fsync complicates this throttling, disable it for now */
 #endif
 
+/* max number of datasets that may be flushing at the same time */
+#ifndef SCR_FLUSH_ASYNC_DEPTH
+#define SCR_FLUSH_ASYNC_DEPTH (1)
+#endif
+
+/* chunk size for per-chunk crc32 markers used to resume interrupted flushes (in bytes) */
+#ifndef SCR_FLUSH_CHUNK_SIZE
+#define SCR_FLUSH_CHUNK_SIZE (64*1024*1024)
+#endif
+
+/* seconds without byte progress before an async flush is declared stalled
+ * and its transfer is cancelled and restarted (0 disables the monitor) */
+/* whether to hand an outstanding async flush off to the standalone
+ * scr_flush_handoff helper at SCR_Finalize rather than blocking to
+ * drain it inside the job's remaining walltime */
+#ifndef SCR_FLUSH_HANDOFF
+#define SCR_FLUSH_HANDOFF (0)
+#endif
+
+#ifndef SCR_FLUSH_ASYNC_STALL_SECONDS
+#define SCR_FLUSH_ASYNC_STALL_SECONDS (0)
+#endif
+
 /* max number of checkpoints to keep in prefix (0 disables) */
 #ifndef SCR_PREFIX_SIZE
 #define SCR_PREFIX_SIZE (0)
@@ -235,6 +417,42 @@
 #define SCR_CRC_ON_DELETE (0)
 #endif
 
+/* whether to verify cached files against recorded CRCs in a background
+ * thread between SCR calls */
+#ifndef SCR_SCRUB
+#define SCR_SCRUB (0)
+#endif
+
+/* per-process read bandwidth consumed by the scrubber in bytes/sec (0 disables throttle) */
+#ifndef SCR_SCRUB_BW
+#define SCR_SCRUB_BW (10*1024*1024)
+#endif
+
+/* whether to write flushed files to the parallel file system with
+ * O_DIRECT, keeping checkpoint traffic out of the page cache */
+#ifndef SCR_FLUSH_DIRECT
+#define SCR_FLUSH_DIRECT (0)
+#endif
+
+/* whether to delete evicted datasets from cache in a background thread,
+ * the dataset directory is renamed aside and its files are unlinked
+ * by a reaper thread */
+#ifndef SCR_DELETE_ASYNC
+#define SCR_DELETE_ASYNC (0)
+#endif
+
+/* whether to dedup unchanged blocks between consecutive flushes,
+ * blocks already present in the previously flushed dataset are
+ * spliced from there instead of being written from the node again */
+#ifndef SCR_DEDUP
+#define SCR_DEDUP (0)
+#endif
+
+/* block size used to hash and match content during dedup */
+#ifndef SCR_DEDUP_BLOCK
+#define SCR_DEDUP_BLOCK (1024*1024)
+#endif
+
 /* =========================================================================
  * The following settings adjust when SCR_Need_checkpoint() will return true.
  * If all settings are 0, all options are disabled and Need_checkpoint() always returns true.
@@ -255,6 +473,21 @@
 #define SCR_CHECKPOINT_OVERHEAD (0)
 #endif
 
+/* mean time between failures of a single node in seconds,
+ * when set, Need_checkpoint computes the Young/Daly optimal
+ * checkpoint interval from the measured checkpoint cost and
+ * the job failure rate, set to 0 to disable */
+#ifndef SCR_CHECKPOINT_MTBF_NODE
+#define SCR_CHECKPOINT_MTBF_NODE (0)
+#endif
+
+/* when set, retune each redundancy descriptor's checkpoint interval
+ * online from its measured cost instead of keeping the configured
+ * modulo counts, set to 0 to disable */
+#ifndef SCR_CHECKPOINT_ADAPTIVE
+#define SCR_CHECKPOINT_ADAPTIVE (0)
+#endif
+
 /* =========================================================================
  * The following applies to the scr_transfer process.
  * ========================================================================= */
@@ -268,6 +501,16 @@
  * The following applies to scr_io operations
  * ========================================================================= */
 
+/* max number of files to keep in flight at once in scr_file_copy_batch */
+#ifndef SCR_COPY_BATCH_DEPTH
+#define SCR_COPY_BATCH_DEPTH (16)
+#endif
+
+/* max number of statx requests to keep in flight at once in scr_file_stat_batch */
+#ifndef SCR_STAT_BATCH_DEPTH
+#define SCR_STAT_BATCH_DEPTH (64)
+#endif
+
 /* number of times to attempt to open a file before giving up */
 #ifndef SCR_OPEN_TRIES
 #define SCR_OPEN_TRIES (5)
@@ -31,6 +31,7 @@
 #include "scr_util.h"
 #include "scr_io.h"
 #include "kvtree.h"
+#include "kvtree_util.h"
 #include "scr_config.h"
 
 #include <stdlib.h>
@@ -40,6 +41,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <strings.h>
+#include <unistd.h>
 #include <assert.h>
 
 /* variable length args */
@@ -430,3 +432,155 @@ int scr_config_write_common(const char* file, const kvtree* hash)
 
   return rc;
 }
+
+/*
+=========================================
+Compiled config bundle
+=========================================
+*/
+
+/* The bundle caches the parsed contents of the system, user, and app
+ * config files in one packed kvtree file, so a process can load all
+ * three with a single binary read instead of re-parsing the same text.
+ * Each source file is stamped with its mtime and size at compile time,
+ * and the bundle is rejected if any source has changed since. */
+
+#define SCR_CONFIG_BUNDLE_KEY_VERSION ("VERSION")
+#define SCR_CONFIG_BUNDLE_KEY_SOURCE  ("SOURCE")
+#define SCR_CONFIG_BUNDLE_KEY_MTIME   ("MTIME")
+#define SCR_CONFIG_BUNDLE_KEY_SIZE    ("SIZE")
+
+/* bump when the bundle layout changes so stale formats are re-parsed */
+#define SCR_CONFIG_BUNDLE_VERSION (1)
+
+/* record the mtime and size of a source config file under its path,
+ * a missing file is stamped with zeros so it stays current while
+ * it remains absent */
+static void scr_config_bundle_stamp(kvtree* bundle, const char* file)
+{
+  unsigned long mtime = 0;
+  unsigned long size  = 0;
+  struct stat sb;
+  if (stat(file, &sb) == 0) {
+    mtime = (unsigned long) sb.st_mtime;
+    size  = (unsigned long) sb.st_size;
+  }
+
+  kvtree* source = kvtree_set_kv(bundle, SCR_CONFIG_BUNDLE_KEY_SOURCE, file);
+  kvtree_util_set_unsigned_long(source, SCR_CONFIG_BUNDLE_KEY_MTIME, mtime);
+  kvtree_util_set_unsigned_long(source, SCR_CONFIG_BUNDLE_KEY_SIZE, size);
+}
+
+/* returns 1 if the stamp recorded for a source config file still
+ * matches the file on disk, 0 otherwise */
+static int scr_config_bundle_fresh(const kvtree* bundle, const char* file)
+{
+  /* look up the stamp recorded when the bundle was compiled */
+  kvtree* source = kvtree_get_kv(bundle, SCR_CONFIG_BUNDLE_KEY_SOURCE, file);
+  if (source == NULL) {
+    return 0;
+  }
+
+  unsigned long bundle_mtime = 0;
+  unsigned long bundle_size  = 0;
+  kvtree_util_get_unsigned_long(source, SCR_CONFIG_BUNDLE_KEY_MTIME, &bundle_mtime);
+  kvtree_util_get_unsigned_long(source, SCR_CONFIG_BUNDLE_KEY_SIZE,  &bundle_size);
+
+  /* stat the source file, a missing file matches a zero stamp */
+  unsigned long mtime = 0;
+  unsigned long size  = 0;
+  struct stat sb;
+  if (stat(file, &sb) == 0) {
+    mtime = (unsigned long) sb.st_mtime;
+    size  = (unsigned long) sb.st_size;
+  }
+
+  return (mtime == bundle_mtime && size == bundle_size);
+}
+
+/* load the compiled config bundle, filling in the app, user, and
+ * system hashes, fails if the bundle is missing or any source config
+ * file changed since the bundle was compiled */
+int scr_config_bundle_load(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, kvtree* app, kvtree* user, kvtree* system)
+{
+  int rc = SCR_FAILURE;
+
+  /* check whether we can read the bundle (special case so as not
+   * to print an error below when it simply doesn't exist yet) */
+  if (scr_file_is_readable(bundle_file) != SCR_SUCCESS) {
+    return SCR_FAILURE;
+  }
+
+  /* read in the packed bundle */
+  kvtree* bundle = kvtree_new();
+  if (kvtree_read_file(bundle_file, bundle) != KVTREE_SUCCESS) {
+    goto cleanup;
+  }
+
+  /* reject bundles compiled by a different layout */
+  int version = 0;
+  if (kvtree_util_get_int(bundle, SCR_CONFIG_BUNDLE_KEY_VERSION, &version) != KVTREE_SUCCESS ||
+      version != SCR_CONFIG_BUNDLE_VERSION)
+  {
+    goto cleanup;
+  }
+
+  /* reject the bundle if any source config file changed since
+   * it was compiled */
+  if (! scr_config_bundle_fresh(bundle, app_file)    ||
+      ! scr_config_bundle_fresh(bundle, user_file)   ||
+      ! scr_config_bundle_fresh(bundle, system_file))
+  {
+    goto cleanup;
+  }
+
+  /* bundle is current, copy its hashes out */
+  kvtree_merge(app,    kvtree_get(bundle, SCR_CONFIG_BUNDLE_KEY_APP));
+  kvtree_merge(user,   kvtree_get(bundle, SCR_CONFIG_BUNDLE_KEY_USER));
+  kvtree_merge(system, kvtree_get(bundle, SCR_CONFIG_BUNDLE_KEY_SYSTEM));
+  rc = SCR_SUCCESS;
+
+cleanup:
+  kvtree_delete(&bundle);
+  return rc;
+}
+
+/* store the three parsed config hashes as a compiled bundle,
+ * stamping the mtime and size of each source file so a later load
+ * can tell whether the bundle is still current */
+int scr_config_bundle_store(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, const kvtree* app, const kvtree* user, const kvtree* system)
+{
+  int rc = SCR_SUCCESS;
+
+  /* assemble the bundle: version, source stamps, and a copy of
+   * each parsed hash */
+  kvtree* bundle = kvtree_new();
+  kvtree_util_set_int(bundle, SCR_CONFIG_BUNDLE_KEY_VERSION, SCR_CONFIG_BUNDLE_VERSION);
+  scr_config_bundle_stamp(bundle, app_file);
+  scr_config_bundle_stamp(bundle, user_file);
+  scr_config_bundle_stamp(bundle, system_file);
+
+  kvtree* copy;
+  copy = kvtree_set(bundle, SCR_CONFIG_BUNDLE_KEY_APP, kvtree_new());
+  kvtree_merge(copy, app);
+  copy = kvtree_set(bundle, SCR_CONFIG_BUNDLE_KEY_USER, kvtree_new());
+  kvtree_merge(copy, user);
+  copy = kvtree_set(bundle, SCR_CONFIG_BUNDLE_KEY_SYSTEM, kvtree_new());
+  kvtree_merge(copy, system);
+
+  /* write to a temporary name and rename into place, so concurrent
+   * processes compiling the same bundle never see a torn file */
+  char* tmp_file = (char*) SCR_MALLOC(strlen(bundle_file) + 32);
+  sprintf(tmp_file, "%s.%d", bundle_file, (int) getpid());
+  if (kvtree_write_file(tmp_file, bundle) != KVTREE_SUCCESS) {
+    scr_file_unlink(tmp_file);
+    rc = SCR_FAILURE;
+  } else if (rename(tmp_file, bundle_file) != 0) {
+    scr_file_unlink(tmp_file);
+    rc = SCR_FAILURE;
+  }
+  scr_free(&tmp_file);
+
+  kvtree_delete(&bundle);
+  return rc;
+}
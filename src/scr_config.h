@@ -14,6 +14,11 @@
 
 #include "kvtree.h"
 
+/* keys for the hashes packed into the compiled config bundle */
+#define SCR_CONFIG_BUNDLE_KEY_APP    ("APP")
+#define SCR_CONFIG_BUNDLE_KEY_USER   ("USER")
+#define SCR_CONFIG_BUNDLE_KEY_SYSTEM ("SYSTEM")
+
 int scr_config_read_common(const char* file, kvtree* hash);
 
 int scr_config_read(const char* file, kvtree* hash);
@@ -23,4 +28,19 @@ int scr_config_write_common(const char* file, const kvtree* hash);
 /* write parameters to config file */
 int scr_config_write(const char* file, const kvtree* hash);
 
+/* load the compiled config bundle, filling in the app, user, and
+ * system hashes, fails if the bundle is missing or any source config
+ * file changed since the bundle was compiled */
+int scr_config_bundle_load(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, kvtree* app, kvtree* user, kvtree* system);
+
+/* store the three parsed config hashes as a compiled bundle,
+ * stamping the mtime and size of each source file so a later load
+ * can tell whether the bundle is still current */
+int scr_config_bundle_store(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, const kvtree* app, const kvtree* user, const kvtree* system);
+
+/* read the app, user, and system config files, loading the compiled
+ * bundle when it is current and recompiling it after a text parse,
+ * in the MPI library only rank 0 touches the file system */
+int scr_config_read_bundled(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, kvtree* app, kvtree* user, kvtree* system);
+
 #endif
@@ -60,3 +60,43 @@ int scr_config_write(const char* file, const kvtree* hash)
 
   return rc;
 }
+
+/* read the app, user, and system config files (parallel), rank 0
+ * loads the compiled bundle when it is current or parses the text
+ * and recompiles it, then all three hashes travel in one broadcast */
+int scr_config_read_bundled(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, kvtree* app, kvtree* user, kvtree* system)
+{
+  /* only rank 0 touches the file system */
+  if (scr_my_rank_world == 0) {
+    if (scr_config_bundle_load(bundle_file, app_file, user_file, system_file, app, user, system) != SCR_SUCCESS) {
+      /* bundle missing or stale, parse the text and recompile the
+       * bundle for later tool invocations, the app and user files
+       * need not exist so their read calls may fail */
+      scr_config_read_common(app_file, app);
+      scr_config_read_common(user_file, user);
+      scr_config_read_common(system_file, system);
+      scr_config_bundle_store(bundle_file, app_file, user_file, system_file, app, user, system);
+    }
+  }
+
+  /* pack the three hashes so they travel in a single broadcast */
+  kvtree* all = kvtree_new();
+  if (scr_my_rank_world == 0) {
+    kvtree* copy;
+    copy = kvtree_set(all, SCR_CONFIG_BUNDLE_KEY_APP, kvtree_new());
+    kvtree_merge(copy, app);
+    copy = kvtree_set(all, SCR_CONFIG_BUNDLE_KEY_USER, kvtree_new());
+    kvtree_merge(copy, user);
+    copy = kvtree_set(all, SCR_CONFIG_BUNDLE_KEY_SYSTEM, kvtree_new());
+    kvtree_merge(copy, system);
+  }
+  kvtree_bcast(all, 0, scr_comm_world);
+  if (scr_my_rank_world != 0) {
+    kvtree_merge(app,    kvtree_get(all, SCR_CONFIG_BUNDLE_KEY_APP));
+    kvtree_merge(user,   kvtree_get(all, SCR_CONFIG_BUNDLE_KEY_USER));
+    kvtree_merge(system, kvtree_get(all, SCR_CONFIG_BUNDLE_KEY_SYSTEM));
+  }
+  kvtree_delete(&all);
+
+  return SCR_SUCCESS;
+}
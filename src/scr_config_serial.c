@@ -44,3 +44,23 @@ int scr_config_write(const char* file, const kvtree* hash)
   int rc = scr_config_write_common(file, hash);
   return rc;
 }
+
+/* read the app, user, and system config files, loading the compiled
+ * bundle when it is current and recompiling it after a text parse */
+int scr_config_read_bundled(const char* bundle_file, const char* app_file, const char* user_file, const char* system_file, kvtree* app, kvtree* user, kvtree* system)
+{
+  /* the bundle caches all three parsed files in one packed read */
+  if (scr_config_bundle_load(bundle_file, app_file, user_file, system_file, app, user, system) == SCR_SUCCESS) {
+    return SCR_SUCCESS;
+  }
+
+  /* bundle missing or stale, parse the text and recompile the
+   * bundle for the next process, the app and user files need not
+   * exist so their read calls may fail */
+  scr_config_read_common(app_file, app);
+  scr_config_read_common(user_file, user);
+  scr_config_read_common(system_file, system);
+  scr_config_bundle_store(bundle_file, app_file, user_file, system_file, app, user, system);
+
+  return SCR_SUCCESS;
+}
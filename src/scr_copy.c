@@ -17,11 +17,13 @@
 #include "scr_conf.h"
 #include "scr.h"
 #include "scr_io.h"
+#include "scr_crc.h"
 #include "scr_err.h"
 #include "scr_util.h"
 #include "scr_meta.h"
 #include "scr_filemap.h"
 #include "scr_dataset.h"
+#include "scr_keys.h"
 
 #include "spath.h"
 #include "kvtree.h"
@@ -40,6 +42,7 @@
 #include <getopt.h>
 #include <dirent.h>
 #include <regex.h>
+#include <pthread.h>
 
 #ifdef SCR_GLOBALS_H
 #error "globals.h accessed from tools"
@@ -61,6 +64,7 @@ struct arglist {
   int id;                 /* dataset id */
   char* prefix;           /* prefix directory */
   unsigned long buf_size; /* number of bytes to copy file data to file system */
+  int threads;            /* number of worker threads to copy files */
   int crc_flag;           /* whether to compute crc32 during copy */
   int partner_flag;       /* whether to copy data for partner */
 };
@@ -73,6 +77,7 @@ int process_args(int argc, char **argv, struct arglist* args)
     {"id",         required_argument, NULL, 'i'},
     {"prefix",     required_argument, NULL, 'd'},
     {"buf",        required_argument, NULL, 'b'},
+    {"jobs",       required_argument, NULL, 'j'},
     {"crc",        no_argument,       NULL, 'r'},
     {"partner",    no_argument,       NULL, 'p'},
     {0, 0, 0, 0}
@@ -83,6 +88,7 @@ int process_args(int argc, char **argv, struct arglist* args)
   args->id             = -1;
   args->prefix         = NULL;
   args->buf_size       = SCR_FILE_BUF_SIZE;
+  args->threads        = 1;
   args->crc_flag       = SCR_CRC_ON_FLUSH;
   args->partner_flag   = 0;
 
@@ -92,7 +98,7 @@ int process_args(int argc, char **argv, struct arglist* args)
   do {
     /* read in our next option */
     int option_index = 0;
-    c = getopt_long(argc, argv, "c:i:d:b:rph", long_options, &option_index);
+    c = getopt_long(argc, argv, "c:i:d:b:j:rph", long_options, &option_index);
     switch (c) {
       case 'c':
         /* control directory */
@@ -123,6 +129,16 @@ int process_args(int argc, char **argv, struct arglist* args)
         }
         args->buf_size = (unsigned long) bytes;
         break;
+      case 'j':
+        /* number of worker threads to copy files */
+        if (atoi(optarg) <= 0) {
+          scr_err("%s: Thread count must be positive '--jobs %s'",
+            PROG, optarg
+          );
+          return 0;
+        }
+        args->threads = atoi(optarg);
+        break;
       case 'r':
         /* compute and record crc32 during copy */
         args->crc_flag = 1;
@@ -175,28 +191,60 @@ int process_args(int argc, char **argv, struct arglist* args)
   return 1;
 }
 
-/* checks whether specifed file exists, is readable, and is complete */
+/* query attributes for every file in the set in one batched pass,
+ * which overlaps the stat calls on high-latency file systems,
+ * caller must free both returned lists with scr_free */
+static void scr_fset_stat_batch(
+  const scr_filemap_fset* fset,
+  struct stat** statbufs_out,
+  int** rcs_out)
+{
+  int numfiles = scr_filemap_fset_num_files(fset);
+  const char** files    = (const char**) malloc(numfiles * sizeof(const char*));
+  struct stat* statbufs = (struct stat*) malloc(numfiles * sizeof(struct stat));
+  int* rcs              = (int*)         malloc(numfiles * sizeof(int));
+  if (files == NULL || statbufs == NULL || rcs == NULL) {
+    scr_err("%s: Failed to allocate stat lists for %d files", PROG, numfiles);
+    exit(1);
+  }
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    files[i] = scr_filemap_fset_file(fset, i)->file;
+  }
+  scr_file_stat_batch(numfiles, files, statbufs, rcs);
+  scr_free(&files);
+  *statbufs_out = statbufs;
+  *rcs_out = rcs;
+}
+
+/* checks whether the file of a file-set entry exists, is readable,
+ * and is complete, reads meta data through the entry so repeated
+ * checks avoid a hash lookup per file, the caller supplies the
+ * file's attributes from a batched query */
 static int scr_bool_have_file(
-  const scr_filemap* map,
-  const char* file)
+  const scr_filemap_fset_entry* entry,
+  const struct stat* statbuf,
+  int stat_rc)
 {
+  const char* file = entry->file;
+  scr_meta* meta = entry->meta;
+
   /* if no filename is given return false */
   if (file == NULL || strcmp(file,"") == 0) {
     scr_dbg(2, "%s: File name is null or the empty string", PROG);
     return 0;
   }
 
-  /* check that we can read the file */
-  if (scr_file_is_readable(file) != SCR_SUCCESS) {
+  /* check that the batched query found the file */
+  if (stat_rc != SCR_SUCCESS) {
     scr_dbg(2, "%s: Do not have read access to file: %s", PROG, file);
     return 0;
   }
 
   int valid = 1;
 
-  /* check that we can read meta file for the file */
-  scr_meta* meta = scr_meta_new();
-  if (valid && scr_filemap_get_meta(map, file, meta) != SCR_SUCCESS) {
+  /* check that the filemap lists meta data for the file */
+  if (valid && meta == NULL) {
     scr_dbg(2, "%s: Failed to read meta data for file: %s", PROG, file);
     valid = 0;
   }
@@ -230,7 +278,7 @@ static int scr_bool_have_file(
 #endif
 
   /* check that the file size matches (use strtol while reading data) */
-  unsigned long size = scr_file_size(file);
+  unsigned long size = (unsigned long) statbuf->st_size;
   if (valid && scr_meta_check_filesize(meta, size) != SCR_SUCCESS) {
     scr_dbg(2, "%s: Filesize is incorrect, currently %lu for %s",
       PROG, size, file
@@ -238,34 +286,216 @@ static int scr_bool_have_file(
     valid = 0;
   }
 
-  scr_meta_delete(&meta);
-
   /* TODO: check that crc32 match if set (this would be expensive) */
 
   /* if we made it here, assume the file is good */
   return valid;
 }
 
+/* returns 1 if the flush file in the prefix directory marks this
+ * dataset as flushed or partially flushed to the parallel file
+ * system, in that case some of its files may already be at their
+ * destination and the scavenge only needs to copy the delta */
+static int scr_bool_dataset_flushing(const spath* path_prefix, int id)
+{
+  int flushing = 0;
+
+  /* build path to the flush file in the prefix directory */
+  spath* path_flush = spath_dup(path_prefix);
+  spath_append_str(path_flush, ".scr");
+  spath_append_str(path_flush, "flush.scr");
+  char* file = spath_strdup(path_flush);
+  spath_delete(&path_flush);
+
+  /* read the flush file and check which locations
+   * are recorded for this dataset */
+  kvtree* hash = kvtree_new();
+  if (kvtree_read_file(file, hash) == KVTREE_SUCCESS) {
+    kvtree* dset_hash = kvtree_get_kv_int(hash, SCR_FLUSH_KEY_DATASET, id);
+    kvtree* location_hash = kvtree_get(dset_hash, SCR_FLUSH_KEY_LOCATION);
+    if (kvtree_get(location_hash, SCR_FLUSH_KEY_LOCATION_PFS)           != NULL ||
+        kvtree_get(location_hash, SCR_FLUSH_KEY_LOCATION_FLUSHING)      != NULL ||
+        kvtree_get(location_hash, SCR_FLUSH_KEY_LOCATION_SYNC_FLUSHING) != NULL)
+    {
+      flushing = 1;
+    }
+  }
+  kvtree_delete(&hash);
+  scr_free(&file);
+
+  return flushing;
+}
+
+/* returns 1 if the destination file already holds a full copy of the
+ * source from an earlier flush, the file must exist at its final name,
+ * which the flush only renames into place after a complete transfer,
+ * and its size must match the meta data, when check_crc is set and the
+ * meta data records a crc32 we re-read the destination to verify it */
+static int scr_bool_file_flushed(
+  const char* dst_file,
+  const scr_meta* meta,
+  int check_crc)
+{
+  /* the file must exist at its final destination name */
+  if (scr_file_is_readable(dst_file) != SCR_SUCCESS) {
+    return 0;
+  }
+
+  /* its size must match the size recorded in the meta data */
+  unsigned long size = scr_file_size(dst_file);
+  if (scr_meta_check_filesize(meta, size) != SCR_SUCCESS) {
+    return 0;
+  }
+
+  /* when asked, verify the crc32 of the destination against the one
+   * recorded in the meta data, reading the destination back is still
+   * cheaper than copying the file again, skip the check if no crc
+   * was recorded */
+  if (check_crc) {
+    uLong meta_crc;
+    if (scr_meta_get_crc32(meta, &meta_crc) == SCR_SUCCESS) {
+      uLong crc;
+      if (scr_crc32(dst_file, &crc) != SCR_SUCCESS || crc != meta_crc) {
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
 static int scr_bool_have_files(scr_filemap* map)
 {
   int have_files = 1;
 
-  kvtree_elem* file_elem = NULL;
-  for (file_elem = scr_filemap_first_file(map);
-       file_elem != NULL;
-       file_elem = kvtree_elem_next(file_elem))
-  {
-    /* get filename and check that we can read it */
-    char* file = kvtree_elem_key(file_elem);
-
-    if (! scr_bool_have_file(map, file)) {
+  /* walk a sorted array view of the map so each check reads its
+   * meta data without a hash lookup, query all file attributes
+   * up front in one batched pass */
+  scr_filemap_fset* fset = scr_filemap_fset_from_map(map);
+  struct stat* statbufs;
+  int* stat_rcs;
+  scr_fset_stat_batch(fset, &statbufs, &stat_rcs);
+  int i;
+  int numfiles = scr_filemap_fset_num_files(fset);
+  for (i = 0; i < numfiles; i++) {
+    const scr_filemap_fset_entry* entry = scr_filemap_fset_file(fset, i);
+    if (! scr_bool_have_file(entry, &statbufs[i], stat_rcs[i])) {
       have_files = 0;
     }
   }
+  scr_free(&stat_rcs);
+  scr_free(&statbufs);
+  scr_filemap_fset_delete(&fset);
 
   return have_files;
 }
 
+/* worker pool state for threaded copies, each worker claims the
+ * next unclaimed file index until the lists are exhausted */
+struct copy_pool {
+  int count;              /* number of files in the lists */
+  int next;               /* next file index to be claimed */
+  pthread_mutex_t lock;   /* guards next */
+  const char** src;       /* source file names */
+  const char** dst;       /* destination file names */
+  unsigned long buf_size; /* buffer size to copy file data */
+  uLong* crcs;            /* per-file crc32 computed during copy, NULL to skip */
+  int* valid;             /* per-file flag set to 1 if copy succeeded */
+};
+
+static void* copy_pool_worker(void* arg)
+{
+  struct copy_pool* pool = (struct copy_pool*) arg;
+  while (1) {
+    /* claim the next file in the lists */
+    pthread_mutex_lock(&pool->lock);
+    int i = pool->next;
+    pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+    if (i >= pool->count) {
+      break;
+    }
+
+    /* copy the file, computing its crc32 along the way if asked */
+    uLong* crc_p = NULL;
+    if (pool->crcs != NULL) {
+      pool->crcs[i] = scr_crc_init();
+      crc_p = &pool->crcs[i];
+    }
+    if (scr_file_copy(pool->src[i], pool->dst[i], pool->buf_size, crc_p) == SCR_SUCCESS) {
+      pool->valid[i] = 1;
+    }
+  }
+  return NULL;
+}
+
+/* copy a list of files using a pool of worker threads, records the
+ * crc32 of each file in crcs if not NULL, and sets valid[i] to 1 for
+ * each file copied successfully, returns SCR_FAILURE if any file
+ * failed to copy */
+static int copy_pool_run(
+  int threads,
+  int count,
+  const char** src,
+  const char** dst,
+  unsigned long buf_size,
+  uLong* crcs,
+  int* valid)
+{
+  int rc = SCR_SUCCESS;
+  int i;
+
+  /* record file lists and copy parameters for the workers */
+  struct copy_pool pool;
+  pool.count    = count;
+  pool.next     = 0;
+  pool.src      = src;
+  pool.dst      = dst;
+  pool.buf_size = buf_size;
+  pool.crcs     = crcs;
+  pool.valid    = valid;
+  pthread_mutex_init(&pool.lock, NULL);
+
+  /* no sense starting more workers than we have files */
+  if (threads > count) {
+    threads = count;
+  }
+
+  /* start our workers */
+  int started = 0;
+  pthread_t* tids = (pthread_t*) malloc(threads * sizeof(pthread_t));
+  if (tids != NULL) {
+    for (i = 0; i < threads; i++) {
+      if (pthread_create(&tids[i], NULL, copy_pool_worker, &pool) != 0) {
+        break;
+      }
+      started++;
+    }
+  }
+
+  /* if we failed to get any workers going,
+   * run the copies on this thread instead */
+  if (started == 0) {
+    copy_pool_worker(&pool);
+  }
+
+  /* wait for all workers to finish */
+  for (i = 0; i < started; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  scr_free(&tids);
+  pthread_mutex_destroy(&pool.lock);
+
+  /* check that every file was copied */
+  for (i = 0; i < count; i++) {
+    if (! valid[i]) {
+      rc = SCR_FAILURE;
+    }
+  }
+
+  return rc;
+}
+
 static int copy_files_for_filemap(
   const spath* path_prefix,
   const spath* path_scr,
@@ -273,6 +503,7 @@ static int copy_files_for_filemap(
   const char* entryname,
   int rank,
   const struct arglist* args,
+  int delta,
   const char* hostname)
 {
   int rc = 0;
@@ -291,20 +522,66 @@ static int copy_files_for_filemap(
   /* allocate a rank filemap object */
   scr_filemap* rank_map = scr_filemap_new();
 
+  /* when not computing CRCs, we defer the data copies and issue them
+   * as one batch so the copy engine can keep multiple files in flight,
+   * with worker threads we defer the copies even when computing CRCs,
+   * since each worker computes the crc32 of its own files */
+  int batch_count = 0;
+  char** batch_src = NULL;
+  char** batch_dst = NULL;
+  scr_meta** batch_meta = NULL;
+  uLong* batch_crc = NULL;
+  int* batch_valid = NULL;
+  if (! args->crc_flag || args->threads > 1) {
+    int numfiles = scr_filemap_num_files(map);
+    if (numfiles > 0) {
+      batch_src   = (char**) malloc(numfiles * sizeof(char*));
+      batch_dst   = (char**) malloc(numfiles * sizeof(char*));
+      batch_meta  = (scr_meta**) malloc(numfiles * sizeof(scr_meta*));
+      batch_valid = (int*) malloc(numfiles * sizeof(int));
+      if (args->crc_flag) {
+        batch_crc = (uLong*) malloc(numfiles * sizeof(uLong));
+      }
+      if (batch_src == NULL || batch_dst == NULL || batch_meta == NULL ||
+          batch_valid == NULL || (args->crc_flag && batch_crc == NULL))
+      {
+        /* couldn't get memory for the batch lists,
+         * fall back to copying files one at a time */
+        scr_free(&batch_src);
+        scr_free(&batch_dst);
+        scr_free(&batch_meta);
+        scr_free(&batch_valid);
+        scr_free(&batch_crc);
+      }
+    }
+  }
+
+  /* count files we skip because an earlier flush already moved them */
+  int skipped = 0;
+
+  /* build a sorted array view of the map, the loop below reads each
+   * file's meta data through the array rather than by hash lookup,
+   * query all file attributes up front in one batched pass */
+  scr_filemap_fset* fset = scr_filemap_fset_from_map(map);
+  int numfiles_fset = scr_filemap_fset_num_files(fset);
+  struct stat* fset_statbufs;
+  int* fset_stat_rcs;
+  scr_fset_stat_batch(fset, &fset_statbufs, &fset_stat_rcs);
+
   /* step through each file we have for this rank */
-  kvtree_elem* file_elem = NULL;
-  for (file_elem = scr_filemap_first_file(map);
-       file_elem != NULL;
-       file_elem = kvtree_elem_next(file_elem))
+  int file_index;
+  for (file_index = 0; file_index < numfiles_fset; file_index++)
   {
     /* get filename */
-    char* file = kvtree_elem_key(file_elem);
-  
+    const scr_filemap_fset_entry* entry = scr_filemap_fset_file(fset, file_index);
+    const char* file = entry->file;
+
     /* check that we can read the file */
-    if (scr_bool_have_file(map, file)) {
-      /* read the meta data for this file */
+    if (scr_bool_have_file(entry, &fset_statbufs[file_index], fset_stat_rcs[file_index])) {
+      /* copy the meta data for this file, the copy is handed to the
+       * batch lists and updated with CRCs, so it must be writable */
       scr_meta* meta = scr_meta_new();
-      scr_filemap_get_meta(map, file, meta);
+      scr_meta_copy(meta, entry->meta);
   
       /* TODO: filemap no longer lists redundancy files,
        * so need another way to grab those */
@@ -317,11 +594,14 @@ static int copy_files_for_filemap(
         );
         printf("scr_copy: %s: Return code: 1\n", hostname);
         scr_meta_delete(&meta);
+        scr_free(&fset_stat_rcs);
+        scr_free(&fset_statbufs);
+        scr_filemap_fset_delete(&fset);
         scr_filemap_delete(&map);
         scr_filemap_delete(&rank_map);
         return 1;
       }
-  
+
       /* TODO: keep a cache of directory names that we've already created */
   
       /* make directory to file */
@@ -331,11 +611,14 @@ static int copy_files_for_filemap(
         );
         printf("scr_copy: %s: Return code: 1\n", hostname);
         scr_meta_delete(&meta);
+        scr_free(&fset_stat_rcs);
+        scr_free(&fset_statbufs);
+        scr_filemap_fset_delete(&fset);
         scr_filemap_delete(&map);
         scr_filemap_delete(&rank_map);
         return 1;
       }
-  
+
       /* create destination file name */
       spath* dst_path = spath_from_str(file);
       spath_basename(dst_path);
@@ -345,15 +628,33 @@ static int copy_files_for_filemap(
   
       /* copy the file and optionally compute the crc during the copy */
       int crc_valid = 0;
-      uLong crc = crc32(0L, Z_NULL, 0);
+      uLong crc = scr_crc_init();
       uLong* crc_p = NULL;
       if (args->crc_flag) {
         crc_valid = 1;
         crc_p = &crc;
       }
-      if (strcmp(file, dst_file) != 0) {
+      int queued = 0;
+      if (delta && strcmp(file, dst_file) != 0 &&
+          scr_bool_file_flushed(dst_file, meta, args->crc_flag))
+      {
+        /* an earlier flush already moved this file to its destination,
+         * skip the copy and scavenge only the delta */
+        skipped++;
+        crc_valid = 0;
+      } else if (strcmp(file, dst_file) != 0) {
         /* in case of bypass, only copy file if source and dest paths are different */
-        if (scr_file_copy(file, dst_file, args->buf_size, crc_p) != SCR_SUCCESS) {
+        if (batch_src != NULL) {
+          /* queue the file, the copy itself happens after the loop,
+           * along with the crc check if we're computing CRCs */
+          batch_src[batch_count]   = strdup(file);
+          batch_dst[batch_count]   = dst_file;
+          batch_meta[batch_count]  = meta;
+          batch_valid[batch_count] = 0;
+          batch_count++;
+          queued = 1;
+          crc_valid = 0;
+        } else if (scr_file_copy(file, dst_file, args->buf_size, crc_p) != SCR_SUCCESS) {
           crc_valid = 0;
           rc = 1;
         }
@@ -363,8 +664,9 @@ static int copy_files_for_filemap(
         crc_valid = 0;
       }
 
-      /* apply metadata to file */
-      if (scr_meta_apply_stat(meta, dst_file) != SCR_SUCCESS) {
+      /* apply metadata to file, for queued files we wait until the
+       * batch copy completes */
+      if (!queued && scr_meta_apply_stat(meta, dst_file) != SCR_SUCCESS) {
         rc = 1;
         scr_err("scr_copy: Failed to copy file metadata properties from %s to %s @ %s:%d",
           file, dst_file, __FILE__, __LINE__
@@ -411,12 +713,13 @@ static int copy_files_for_filemap(
       /* record its meta data in the filemap */
       scr_filemap_set_meta(rank_map, file, meta);
   
-      /* free the destination file path and string */
-      scr_free(&dst_file);
+      /* free the destination file path and string,
+       * queued files hand their name and meta data to the batch lists */
       spath_delete(&dst_path);
-  
-      /* free the meta data object */
-      scr_meta_delete(&meta);
+      if (! queued) {
+        scr_free(&dst_file);
+        scr_meta_delete(&meta);
+      }
     } else {
       /* have_file failed, so there was some problem accessing file */
       rc = 1;
@@ -426,6 +729,75 @@ static int copy_files_for_filemap(
     }
   }
   
+  if (skipped > 0) {
+    scr_dbg(1, "%s: %s: Skipped %d file(s) already flushed for dataset id %d",
+      PROG, hostname, skipped, args->id
+    );
+  }
+
+  /* issue any deferred copies, through the worker pool when extra
+   * threads were requested and as a single batch otherwise,
+   * then apply metadata to the new files */
+  if (batch_src != NULL) {
+    int i;
+    if (args->threads > 1) {
+      if (copy_pool_run(args->threads, batch_count,
+          (const char**) batch_src, (const char**) batch_dst,
+          args->buf_size, batch_crc, batch_valid) != SCR_SUCCESS)
+      {
+        rc = 1;
+      }
+    } else {
+      /* the batch interface doesn't report per-file status,
+       * consider each file valid unless the batch fails as a whole */
+      for (i = 0; i < batch_count; i++) {
+        batch_valid[i] = 1;
+      }
+      if (scr_file_copy_batch(batch_count, (const char**) batch_src, (const char**) batch_dst, args->buf_size) != SCR_SUCCESS) {
+        rc = 1;
+      }
+    }
+    for (i = 0; i < batch_count; i++) {
+      if (scr_meta_apply_stat(batch_meta[i], batch_dst[i]) != SCR_SUCCESS) {
+        rc = 1;
+        scr_err("scr_copy: Failed to copy file metadata properties from %s to %s @ %s:%d",
+          batch_src[i], batch_dst[i], __FILE__, __LINE__
+        );
+      }
+
+      /* if file has crc32, check it against the one the worker
+       * computed during the copy, otherwise record the new crc32 */
+      if (batch_crc != NULL && batch_valid[i]) {
+        uLong meta_crc;
+        if (scr_meta_get_crc32(batch_meta[i], &meta_crc) == SCR_SUCCESS) {
+          if (batch_crc[i] != meta_crc) {
+            /* detected a crc mismatch during the copy,
+             * mark the file as invalid */
+            scr_meta_set_complete(batch_meta[i], 0);
+
+            rc = 1;
+            scr_err("scr_copy: CRC32 mismatch detected when flushing file %s to %s @ %s:%d",
+              batch_src[i], batch_dst[i], __FILE__, __LINE__
+            );
+          }
+        } else {
+          /* the crc was not already in the metafile, but we just
+           * computed it, so set it */
+          scr_meta_set_crc32(batch_meta[i], batch_crc[i]);
+        }
+      }
+
+      scr_free(&batch_src[i]);
+      scr_free(&batch_dst[i]);
+      scr_meta_delete(&batch_meta[i]);
+    }
+    scr_free(&batch_src);
+    scr_free(&batch_dst);
+    scr_free(&batch_meta);
+    scr_free(&batch_valid);
+    scr_free(&batch_crc);
+  }
+
   /* TODO: would be nice to use the updated filemap, since it has the CRC on the file,
    * but we have to keep the same file that we applied the encoding to in case we need
    * to rebuild it */
@@ -445,6 +817,11 @@ static int copy_files_for_filemap(
   scr_free(&src_filemap);
   spath_delete(&path_rank);
 
+  /* delete the file set before the map that backs it */
+  scr_free(&fset_stat_rcs);
+  scr_free(&fset_statbufs);
+  scr_filemap_fset_delete(&fset);
+
   /* delete the rank filemap object */
   scr_filemap_delete(&rank_map);
   scr_filemap_delete(&map);
@@ -534,6 +911,11 @@ int main (int argc, char *argv[])
   spath* path_prefix = spath_from_str(args.prefix);
   spath_reduce(path_prefix);
 
+  /* determine whether an earlier flush moved part of this dataset to
+   * the parallel file system, if so we skip files that are already at
+   * their destination and scavenge only the delta */
+  int delta = scr_bool_dataset_flushing(path_prefix, args.id);
+
   /* define the path to the dataset metadata subdirectory in prefix */
   spath* path_scr = spath_dup(path_prefix);
   spath_append_str(path_scr, ".scr");
@@ -589,7 +971,7 @@ int main (int argc, char *argv[])
         }
 
         /* found a filemap, copy its files */
-        int tmp_rc = copy_files_for_filemap(path_prefix, path_scr, cache_path, entryname, rank, &args, hostname);
+        int tmp_rc = copy_files_for_filemap(path_prefix, path_scr, cache_path, entryname, rank, &args, delta, hostname);
         if (tmp_rc != 0) {
           rc = tmp_rc;
         }
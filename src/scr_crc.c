@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Implements the checksum engines used when computing file CRCs.
+ * The default engine is the zlib crc32, which matches all existing
+ * metadata.  The CRC32C engine uses the Castagnoli polynomial, which
+ * maps to the SSE4.2 crc32 instruction, we detect support for that
+ * instruction at runtime and fall back to a table-driven loop when
+ * it's missing. */
+
+#include "scr_conf.h"
+#include "scr_crc.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* compute crc32 */
+#include <zlib.h>
+
+/* selects checksum engine used by scr_crc_update,
+ * defaults to SCR_CRC_TYPE_ZLIB for compatibility with existing metadata */
+int scr_crc_type = SCR_CRC_TYPE_ZLIB;
+
+/*
+=========================================
+CRC32C (Castagnoli) engine
+=========================================
+*/
+
+/* reflected CRC32C polynomial */
+#define SCR_CRC32C_POLY (0x82F63B78)
+
+/* table for the software CRC32C loop, built on first use */
+static uint32_t scr_crc32c_table[256];
+static int scr_crc32c_table_built = 0;
+
+/* build lookup table for table-driven CRC32C */
+static void scr_crc32c_build_table(void)
+{
+  uint32_t i;
+  for (i = 0; i < 256; i++) {
+    uint32_t c = i;
+    int j;
+    for (j = 0; j < 8; j++) {
+      if (c & 1) {
+        c = (c >> 1) ^ SCR_CRC32C_POLY;
+      } else {
+        c = c >> 1;
+      }
+    }
+    scr_crc32c_table[i] = c;
+  }
+  scr_crc32c_table_built = 1;
+}
+
+/* table-driven CRC32C update, used when the crc32 instruction is unavailable */
+static uLong scr_crc32c_sw(uLong crc, const unsigned char* buf, size_t size)
+{
+  if (! scr_crc32c_table_built) {
+    scr_crc32c_build_table();
+  }
+
+  uint32_t c = ((uint32_t) crc) ^ 0xFFFFFFFF;
+  size_t i;
+  for (i = 0; i < size; i++) {
+    c = scr_crc32c_table[(c ^ buf[i]) & 0xFF] ^ (c >> 8);
+  }
+  return (uLong) (c ^ 0xFFFFFFFF);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SCR_CRC32C_HAVE_HW (1)
+
+/* CRC32C update using the SSE4.2 crc32 instruction,
+ * only called after we've checked the cpu supports it */
+__attribute__((target("sse4.2")))
+static uLong scr_crc32c_hw(uLong crc, const unsigned char* buf, size_t size)
+{
+  uint64_t c = ((uint32_t) crc) ^ 0xFFFFFFFF;
+
+  /* crunch 8 bytes at a time */
+  while (size >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, buf, sizeof(chunk));
+    c = __builtin_ia32_crc32di(c, chunk);
+    buf  += 8;
+    size -= 8;
+  }
+
+  /* pick up any remaining bytes */
+  uint32_t c32 = (uint32_t) c;
+  while (size > 0) {
+    c32 = __builtin_ia32_crc32qi(c32, *buf);
+    buf++;
+    size--;
+  }
+
+  return (uLong) (c32 ^ 0xFFFFFFFF);
+}
+#endif
+
+/* compute CRC32C over buffer, dispatching to the crc32 instruction
+ * when the cpu has it */
+static uLong scr_crc32c(uLong crc, const unsigned char* buf, size_t size)
+{
+#ifdef SCR_CRC32C_HAVE_HW
+  /* check for the crc32 instruction once and remember the answer */
+  static int have_hw = -1;
+  if (have_hw < 0) {
+    have_hw = __builtin_cpu_supports("sse4.2");
+  }
+  if (have_hw) {
+    return scr_crc32c_hw(crc, buf, size);
+  }
+#endif
+  return scr_crc32c_sw(crc, buf, size);
+}
+
+/*
+=========================================
+Checksum engine interface
+=========================================
+*/
+
+/* returns initial crc value for the active checksum engine */
+uLong scr_crc_init(void)
+{
+  /* both engines start from 0, same as crc32(0L, Z_NULL, 0) */
+  return crc32(0L, Z_NULL, 0);
+}
+
+/* fold size bytes from buf into crc using the active checksum engine,
+ * returns the updated crc value */
+uLong scr_crc_update(uLong crc, const void* buf, size_t size)
+{
+  if (scr_crc_type == SCR_CRC_TYPE_CRC32C) {
+    return scr_crc32c(crc, (const unsigned char*) buf, size);
+  }
+  return crc32(crc, (const Bytef*) buf, (uInt) size);
+}
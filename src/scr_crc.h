@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_CRC_H
+#define SCR_CRC_H
+
+#include <stddef.h>
+
+/* compute crc32 */
+#include <zlib.h>
+
+/* checksum engines for file CRC computations,
+ * ZLIB is the historical zlib crc32, which all existing metadata records,
+ * CRC32C uses the Castagnoli polynomial so it can run on the SSE4.2
+ * crc32 instruction where available */
+#define SCR_CRC_TYPE_ZLIB   (1)
+#define SCR_CRC_TYPE_CRC32C (2)
+
+/* selects checksum engine used by scr_crc_update,
+ * defaults to SCR_CRC_TYPE_ZLIB for compatibility with existing metadata */
+extern int scr_crc_type;
+
+/* returns initial crc value for the active checksum engine */
+uLong scr_crc_init(void);
+
+/* fold size bytes from buf into crc using the active checksum engine,
+ * returns the updated crc value */
+uLong scr_crc_update(uLong crc, const void* buf, size_t size);
+
+#endif
@@ -9,14 +9,19 @@
  * Please also read this file: LICENSE.TXT.
 */
 
-/* Utility to compute the crc32 value of a file.
- * Given a filename as a command line argument,
- * compute and print out that file's crc32 value. */
+/* Utility to compute the crc32 value of one or more files.
+ * Given a single filename, compute and print that file's crc32 value,
+ * matching the historical output of this tool.  Given several files,
+ * checksum them in parallel worker threads and print one
+ * "crc filename" line per file in command line order.  The scavenge
+ * scripts run this over every recovered file, so the parallel path
+ * turns a serial verification tail into a threaded one. */
 
 #include "scr.h"
 #include "scr_io.h"
 #include "scr_err.h"
 #include "scr_util.h"
+#include "scr_crc.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -25,6 +30,9 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
 
 /* compute crc32 */
 #include <zlib.h>
@@ -33,29 +41,275 @@
 #error "globals.h accessed from tools"
 #endif
 
-int buffer_size = 128*1024;
+/* default number of worker threads when checksumming multiple files */
+#define SCR_CRC32_DEFAULT_THREADS (4)
 
-int main(int argc, char* argv[])
+/* bounds for the per-file read buffer, small files get a small buffer
+ * rather than paying for a large allocation they'll never fill */
+#define SCR_CRC32_MIN_BUF_SIZE (64*1024)
+#define SCR_CRC32_MAX_BUF_SIZE (4*1024*1024)
+
+int print_usage()
+{
+  printf("\n");
+  printf("  Usage:  scr_crc32 [options] <file> ...\n");
+  printf("\n");
+  printf("  Options:\n");
+  printf("    -j, --threads=N      Number of worker threads (default %d)\n", SCR_CRC32_DEFAULT_THREADS);
+  printf("    -t, --type=TYPE      Checksum engine: zlib or crc32c (default zlib)\n");
+  printf("    -h, --help           Print usage\n");
+  printf("\n");
+  exit(1);
+}
+
+struct arglist {
+  int threads;    /* number of worker threads to checksum files */
+  int numfiles;   /* number of files to process */
+  char** files;   /* list of filenames from the command line */
+};
+
+int process_args(int argc, char **argv, struct arglist* args)
+{
+  /* define our options */
+  static struct option long_options[] = {
+    {"threads", required_argument, NULL, 'j'},
+    {"type",    required_argument, NULL, 't'},
+    {"help",    no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  /* set defaults */
+  args->threads  = SCR_CRC32_DEFAULT_THREADS;
+  args->numfiles = 0;
+  args->files    = NULL;
+
+  /* loop through and process all options */
+  int c;
+  do {
+    /* read in our next option */
+    int option_index = 0;
+    c = getopt_long(argc, argv, "j:t:h", long_options, &option_index);
+    switch (c) {
+      case 'j':
+        /* number of worker threads */
+        args->threads = atoi(optarg);
+        if (args->threads < 1) {
+          args->threads = 1;
+        }
+        break;
+      case 't':
+        /* checksum engine */
+        if (strcmp(optarg, "zlib") == 0) {
+          scr_crc_type = SCR_CRC_TYPE_ZLIB;
+        } else if (strcmp(optarg, "crc32c") == 0) {
+          scr_crc_type = SCR_CRC_TYPE_CRC32C;
+        } else {
+          scr_err("Unknown checksum type: %s @ %s:%d",
+            optarg, __FILE__, __LINE__
+          );
+          return 0;
+        }
+        break;
+      case 'h':
+        /* print help message and exit */
+        print_usage();
+        break;
+      case '?':
+        /* getopt_long printed an error message */
+        break;
+      default:
+        if (c != -1) {
+          /* missed an option */
+          scr_err("scr_crc32: Option '%s' specified but not processed @ %s:%d",
+            argv[option_index], __FILE__, __LINE__
+          );
+        }
+    }
+  } while (c != -1);
+
+  /* remaining arguments are the files to checksum */
+  args->numfiles = argc - optind;
+  args->files    = &argv[optind];
+  if (args->numfiles < 1) {
+    scr_err("scr_crc32: Must specify at least one file @ %s:%d",
+      __FILE__, __LINE__
+    );
+    return 0;
+  }
+
+  return 1;
+}
+
+/* pick a read buffer size for a file of the given size,
+ * clamped to [SCR_CRC32_MIN_BUF_SIZE, SCR_CRC32_MAX_BUF_SIZE] */
+static size_t scr_crc32_buf_size(off_t filesize)
 {
-  /* TODO: need to check that we got one and only one parameter */
+  size_t size = SCR_CRC32_MIN_BUF_SIZE;
+  while (size < (size_t) filesize && size < SCR_CRC32_MAX_BUF_SIZE) {
+    size <<= 1;
+  }
+  return size;
+}
 
-  /* read in the filename */
-  char* filename = strdup(argv[1]);
+/* opens, reads, and computes the crc value for the given filename,
+ * sizing the read buffer from the file size */
+static int scr_crc32_file(const char* filename, uLong* crc)
+{
+  /* initialize our crc value */
+  *crc = scr_crc_init();
 
   /* open the file for reading */
-  uLong crc = crc32(0L, Z_NULL, 0);
-  if (scr_crc32(filename, &crc) != SCR_SUCCESS) {
-    scr_err("Failed to compute CRC32 for file %s @ file %s:%d",
-            filename, __FILE__, __LINE__
+  int fd = scr_open(filename, O_RDONLY);
+  if (fd < 0) {
+    scr_err("Failed to open file to compute crc: %s errno=%d %s @ %s:%d",
+      filename, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* size the read buffer from the file size */
+  size_t buffer_size = SCR_CRC32_MAX_BUF_SIZE;
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) == 0) {
+    buffer_size = scr_crc32_buf_size(statbuf.st_size);
+  }
+  char* buf = (char*) SCR_MALLOC(buffer_size);
+
+  /* read the file data in and compute its crc */
+  ssize_t nread = 0;
+  do {
+    nread = scr_read(filename, fd, buf, buffer_size);
+    if (nread > 0) {
+      *crc = scr_crc_update(*crc, buf, (size_t) nread);
+    }
+  } while (nread == (ssize_t) buffer_size);
+
+  scr_free(&buf);
+
+  /* if we got an error, don't print anything and bailout */
+  if (nread < 0) {
+    scr_err("Error while reading file to compute crc: %s @ %s:%d",
+      filename, __FILE__, __LINE__
     );
+    close(fd);
+    return SCR_FAILURE;
+  }
+
+  /* close the file */
+  scr_close(filename, fd);
+
+  return SCR_SUCCESS;
+}
+
+/* work queue shared by the checksum threads, workers grab the next
+ * unclaimed file index until the list is exhausted */
+struct crc_workset {
+  struct arglist* args; /* command line arguments, including file list */
+  int next;             /* index of next unclaimed file */
+  pthread_mutex_t lock; /* protects next */
+  uLong* crcs;          /* crc value per file */
+  int* rcs;             /* SCR_SUCCESS / SCR_FAILURE per file */
+};
+
+/* checksum thread, claims and processes files until none remain */
+static void* scr_crc32_worker(void* arg)
+{
+  struct crc_workset* work = (struct crc_workset*) arg;
+  while (1) {
+    /* grab the next unclaimed file */
+    pthread_mutex_lock(&work->lock);
+    int i = work->next;
+    work->next++;
+    pthread_mutex_unlock(&work->lock);
+    if (i >= work->args->numfiles) {
+      break;
+    }
+
+    /* checksum it */
+    work->rcs[i] = scr_crc32_file(work->args->files[i], &work->crcs[i]);
+  }
+  return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+  /* process command line arguments */
+  struct arglist args;
+  if (! process_args(argc, argv, &args)) {
     return 1;
   }
 
-  /* print out the crc32 value */
-  printf("%lx\n", (unsigned long) crc);
+  /* allocate space for per-file results */
+  uLong* crcs = (uLong*) SCR_MALLOC(sizeof(uLong) * args.numfiles);
+  int*   rcs  = (int*)   SCR_MALLOC(sizeof(int)   * args.numfiles);
+
+  /* set up the shared work queue */
+  struct crc_workset work;
+  work.args = &args;
+  work.next = 0;
+  work.crcs = crcs;
+  work.rcs  = rcs;
+  pthread_mutex_init(&work.lock, NULL);
+
+  /* no point spinning up more threads than we have files */
+  int threads = args.threads;
+  if (threads > args.numfiles) {
+    threads = args.numfiles;
+  }
+
+  if (threads > 1) {
+    /* start the workers and wait for them to drain the queue */
+    pthread_t* tids = (pthread_t*) SCR_MALLOC(sizeof(pthread_t) * threads);
+    int t;
+    int started = 0;
+    for (t = 0; t < threads; t++) {
+      if (pthread_create(&tids[t], NULL, scr_crc32_worker, &work) != 0) {
+        scr_err("Failed to create checksum thread %d @ %s:%d",
+          t, __FILE__, __LINE__
+        );
+        break;
+      }
+      started++;
+    }
+
+    /* if we failed to start any thread, drain the queue ourselves */
+    if (started == 0) {
+      scr_crc32_worker(&work);
+    }
+
+    for (t = 0; t < started; t++) {
+      pthread_join(tids[t], NULL);
+    }
+    scr_free(&tids);
+  } else {
+    /* single file or single thread, just run the queue inline */
+    scr_crc32_worker(&work);
+  }
+
+  pthread_mutex_destroy(&work.lock);
+
+  /* print results in command line order,
+   * keep the bare crc output when given a single file since existing
+   * scripts parse it that way */
+  int rc = 0;
+  int i;
+  for (i = 0; i < args.numfiles; i++) {
+    if (rcs[i] != SCR_SUCCESS) {
+      scr_err("Failed to compute CRC32 for file %s @ file %s:%d",
+        args.files[i], __FILE__, __LINE__
+      );
+      rc = 1;
+      continue;
+    }
+    if (args.numfiles == 1) {
+      printf("%lx\n", (unsigned long) crcs[i]);
+    } else {
+      printf("%lx %s\n", (unsigned long) crcs[i], args.files[i]);
+    }
+  }
 
-  /* free off the string we strdup'ed at the start */
-  scr_free(&filename);
+  scr_free(&rcs);
+  scr_free(&crcs);
 
-  return 0;
+  return rc;
 }
@@ -54,6 +54,8 @@
 #define SCR_DATASET_KEY_COMPLETE ("COMPLETE")
 #define SCR_DATASET_KEY_FLAG_CKPT   ("FLAG_CKPT")
 #define SCR_DATASET_KEY_FLAG_OUTPUT ("FLAG_OUTPUT")
+#define SCR_DATASET_KEY_FLAG_URGENT ("FLAG_URGENT")
+#define SCR_DATASET_KEY_FLAG_BULK   ("FLAG_BULK")
 
 static int convert_kvtree_rc(int kvtree_rc)
 {
@@ -261,7 +263,11 @@ int scr_dataset_set_flags(scr_dataset* dataset, int flags)
 {
   int is_ckpt   = (flags & SCR_FLAG_CHECKPOINT) ? 1 : 0;
   int is_output = (flags & SCR_FLAG_OUTPUT)     ? 1 : 0;
+  int is_urgent = (flags & SCR_FLAG_URGENT)     ? 1 : 0;
+  int is_bulk   = (flags & SCR_FLAG_BULK)       ? 1 : 0;
   kvtree_util_set_int(dataset, SCR_DATASET_KEY_FLAG_CKPT, is_ckpt);
+  kvtree_util_set_int(dataset, SCR_DATASET_KEY_FLAG_URGENT, is_urgent);
+  kvtree_util_set_int(dataset, SCR_DATASET_KEY_FLAG_BULK, is_bulk);
   int kvtree_rc = kvtree_util_set_int(dataset, SCR_DATASET_KEY_FLAG_OUTPUT, is_output);
   return convert_kvtree_rc(kvtree_rc);
 }
@@ -290,6 +296,26 @@ int scr_dataset_is_ckpt(const scr_dataset* dataset)
   return 0;
 }
 
+/* returns 1 if dataset is marked urgent, 0 otherwise */
+int scr_dataset_is_urgent(const scr_dataset* dataset)
+{
+  int flag;
+  if (kvtree_util_get_int(dataset, SCR_DATASET_KEY_FLAG_URGENT, &flag) == KVTREE_SUCCESS) {
+    return flag;
+  }
+  return 0;
+}
+
+/* returns 1 if dataset is marked bulk, 0 otherwise */
+int scr_dataset_is_bulk(const scr_dataset* dataset)
+{
+  int flag;
+  if (kvtree_util_get_int(dataset, SCR_DATASET_KEY_FLAG_BULK, &flag) == KVTREE_SUCCESS) {
+    return flag;
+  }
+  return 0;
+}
+
 /* returns 1 if dataset is output, 0 otherwise */
 int scr_dataset_is_output(const scr_dataset* dataset)
 {
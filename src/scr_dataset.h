@@ -145,6 +145,12 @@ int scr_dataset_set_flags(scr_dataset* dataset, int flags);
 /* returns 1 if dataset is an output set, 0 otherwise */
 int scr_dataset_is_ckpt(const scr_dataset* dataset);
 
+/* returns 1 if urgent flag is set on this dataset, 0 otherwise */
+int scr_dataset_is_urgent(const scr_dataset* dataset);
+
+/* returns 1 if bulk flag is set on this dataset, 0 otherwise */
+int scr_dataset_is_bulk(const scr_dataset* dataset);
+
 /* returns 1 if dataset is a checkpoint, 0 otherwise */
 int scr_dataset_is_output(const scr_dataset* dataset);
 
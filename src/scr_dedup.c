@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Block-level dedup between consecutive flushes.  Successive
+ * checkpoints of many applications share most of their content, so
+ * rewriting every byte to the parallel file system on each flush is
+ * wasted bandwidth.  Each rank hashes its files in fixed-size blocks
+ * as it copies them and records where each block landed.  On the
+ * next flush, blocks whose hash matches an entry from the previous
+ * flush are spliced from their prior location on the file system
+ * with copy_file_range rather than written from the node, so only
+ * changed blocks cross the network where the file system supports
+ * server-side copies.  The destination file is always complete, no
+ * reconstruction is needed on fetch or scavenge, and a stale or
+ * missing index only costs the savings, never correctness. */
+
+#include "scr_globals.h"
+
+#include "spath.h"
+#include "kvtree.h"
+#include "kvtree_util.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* keys used in the per-rank dedup index file */
+#define SCR_DEDUP_KEY_BLOCK  ("BLOCK")
+#define SCR_DEDUP_KEY_HASH   ("HASH")
+#define SCR_DEDUP_KEY_FILE   ("FILE")
+#define SCR_DEDUP_KEY_OFFSET ("OFFSET")
+#define SCR_DEDUP_KEY_SIZE   ("SIZE")
+
+/* index from our previous flush, read-only while a pass is active */
+static kvtree* scr_dedup_index = NULL;
+
+/* index being built for the current flush */
+static kvtree* scr_dedup_index_new = NULL;
+
+/* serializes inserts into the new index from worker threads */
+static pthread_mutex_t scr_dedup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* whether a dedup pass is active */
+static int scr_dedup_active = 0;
+
+/*
+=========================================
+MD5 (RFC 1321)
+=========================================
+*/
+
+/* a dedup hit skips rewriting a block, so a hash collision would
+ * silently corrupt data, we use MD5 for a 128-bit digest, its known
+ * weaknesses require crafted inputs and do not raise the chance of
+ * an accidental collision between checkpoint blocks */
+
+typedef struct {
+  uint32_t h[4];         /* running state */
+  uint64_t len;          /* total bytes processed */
+  unsigned char buf[64]; /* partial input block */
+} scr_md5_ctx;
+
+/* per-round shift amounts */
+static const uint32_t scr_md5_r[64] = {
+  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
+  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
+  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
+  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21
+};
+
+/* per-round additive constants, floor(2^32 * abs(sin(i+1))) */
+static const uint32_t scr_md5_k[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static void scr_md5_init(scr_md5_ctx* ctx)
+{
+  ctx->h[0] = 0x67452301;
+  ctx->h[1] = 0xefcdab89;
+  ctx->h[2] = 0x98badcfe;
+  ctx->h[3] = 0x10325476;
+  ctx->len  = 0;
+}
+
+/* run the compression function over one 64-byte block */
+static void scr_md5_block(scr_md5_ctx* ctx, const unsigned char* p)
+{
+  /* decode block into little-endian words */
+  uint32_t m[16];
+  int i;
+  for (i = 0; i < 16; i++) {
+    m[i] = (uint32_t) p[i * 4]
+         | ((uint32_t) p[i * 4 + 1] << 8)
+         | ((uint32_t) p[i * 4 + 2] << 16)
+         | ((uint32_t) p[i * 4 + 3] << 24);
+  }
+
+  uint32_t a = ctx->h[0];
+  uint32_t b = ctx->h[1];
+  uint32_t c = ctx->h[2];
+  uint32_t d = ctx->h[3];
+
+  for (i = 0; i < 64; i++) {
+    uint32_t f;
+    int g;
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      g = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+    }
+    uint32_t tmp = d;
+    d = c;
+    c = b;
+    uint32_t x = a + f + scr_md5_k[i] + m[g];
+    b = b + ((x << scr_md5_r[i]) | (x >> (32 - scr_md5_r[i])));
+    a = tmp;
+  }
+
+  ctx->h[0] += a;
+  ctx->h[1] += b;
+  ctx->h[2] += c;
+  ctx->h[3] += d;
+}
+
+static void scr_md5_update(scr_md5_ctx* ctx, const void* data, size_t size)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  size_t fill = (size_t) (ctx->len % 64);
+  ctx->len += size;
+
+  /* top off any partial block from a previous call */
+  if (fill > 0) {
+    size_t need = 64 - fill;
+    if (size < need) {
+      memcpy(ctx->buf + fill, p, size);
+      return;
+    }
+    memcpy(ctx->buf + fill, p, need);
+    scr_md5_block(ctx, ctx->buf);
+    p += need;
+    size -= need;
+  }
+
+  /* process full blocks straight from the input */
+  while (size >= 64) {
+    scr_md5_block(ctx, p);
+    p += 64;
+    size -= 64;
+  }
+
+  /* stash the remainder */
+  if (size > 0) {
+    memcpy(ctx->buf, p, size);
+  }
+}
+
+static void scr_md5_final(scr_md5_ctx* ctx, unsigned char digest[16])
+{
+  /* append the 0x80 terminator and pad with zeros up to the
+   * 8 bytes reserved for the length */
+  uint64_t bits = ctx->len * 8;
+  static const unsigned char pad[64] = { 0x80 };
+  size_t fill = (size_t) (ctx->len % 64);
+  size_t padlen = (fill < 56) ? (56 - fill) : (120 - fill);
+  scr_md5_update(ctx, pad, padlen);
+
+  /* append the message length in bits, little endian */
+  unsigned char lenbuf[8];
+  int i;
+  for (i = 0; i < 8; i++) {
+    lenbuf[i] = (unsigned char) (bits >> (8 * i));
+  }
+  scr_md5_update(ctx, lenbuf, 8);
+
+  /* encode the state little endian */
+  for (i = 0; i < 4; i++) {
+    digest[i * 4]     = (unsigned char) (ctx->h[i]);
+    digest[i * 4 + 1] = (unsigned char) (ctx->h[i] >> 8);
+    digest[i * 4 + 2] = (unsigned char) (ctx->h[i] >> 16);
+    digest[i * 4 + 3] = (unsigned char) (ctx->h[i] >> 24);
+  }
+}
+
+/* hash a block and format the digest as a hex string,
+ * hex must have room for 33 characters */
+static void scr_dedup_hash_hex(const void* data, size_t size, char* hex)
+{
+  scr_md5_ctx ctx;
+  unsigned char digest[16];
+  scr_md5_init(&ctx);
+  scr_md5_update(&ctx, data, size);
+  scr_md5_final(&ctx, digest);
+
+  int i;
+  for (i = 0; i < 16; i++) {
+    sprintf(hex + i * 2, "%02x", digest[i]);
+  }
+}
+
+/*
+=========================================
+Dedup pass
+=========================================
+*/
+
+/* build path to this rank's index file in the prefix directory,
+ * caller must free returned string */
+static char* scr_dedup_index_file(void)
+{
+  spath* path = spath_from_str(scr_prefix_scr);
+  spath_append_str(path, "dedup");
+  spath_append_strf(path, "rank.%d", scr_my_rank_world);
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* load this rank's dedup index from the prefix directory,
+ * called before the copies of a flush begin */
+int scr_dedup_start(void)
+{
+  /* start both indexes from scratch */
+  kvtree_delete(&scr_dedup_index);
+  kvtree_delete(&scr_dedup_index_new);
+  scr_dedup_index     = kvtree_new();
+  scr_dedup_index_new = kvtree_new();
+
+  /* read the index we wrote after our previous flush, a missing
+   * file just means there is nothing to match against yet */
+  char* file = scr_dedup_index_file();
+  kvtree_read_file(file, scr_dedup_index);
+  scr_free(&file);
+
+  /* drop the index if its entries were hashed with a different
+   * block size, they can never line up with this flush */
+  unsigned long block = 0;
+  kvtree_util_get_unsigned_long(scr_dedup_index, SCR_DEDUP_KEY_BLOCK, &block);
+  if (block != (unsigned long) scr_dedup_block) {
+    kvtree_delete(&scr_dedup_index);
+    scr_dedup_index = kvtree_new();
+  }
+
+  scr_dedup_active = 1;
+  return SCR_SUCCESS;
+}
+
+/* returns 1 if a dedup pass is active */
+int scr_dedup_enabled(void)
+{
+  return scr_dedup_active;
+}
+
+/* copy src_file to dst_file, sourcing blocks that match the previous
+ * flush from their prior location, safe to call from worker threads */
+int scr_dedup_copy(const char* src_file, const char* dst_file)
+{
+  /* fall back to a plain copy if no dedup pass is active */
+  if (! scr_dedup_active) {
+    return scr_file_copy_opts(src_file, dst_file, scr_file_buf_size, NULL, scr_flush_direct);
+  }
+
+  int rc = SCR_SUCCESS;
+  size_t block_size = (size_t) scr_dedup_block;
+
+  /* open source file for reading */
+  int src_fd = scr_open(src_file, O_RDONLY);
+  if (src_fd < 0) {
+    scr_err("Opening file to copy: scr_open(%s) errno=%d %s @ %s:%d",
+      src_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* open destination file for writing */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int dst_fd = scr_open(dst_file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (dst_fd < 0) {
+    scr_err("Opening file for writing: scr_open(%s) errno=%d %s @ %s:%d",
+      dst_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    scr_close_nofsync(src_file, src_fd);
+    return SCR_FAILURE;
+  }
+
+  /* grab a block-sized buffer from the pool */
+  char* buf = scr_buf_get(block_size);
+  if (buf == NULL) {
+    scr_err("Allocating memory: scr_buf_get(%lu) @ %s:%d",
+      (unsigned long) block_size, __FILE__, __LINE__
+    );
+    scr_close_nofsync(src_file, src_fd);
+    scr_close(dst_file, dst_fd);
+    return SCR_FAILURE;
+  }
+
+  /* cache the base file descriptor from the most recent hit,
+   * matched blocks usually come from the same file */
+  char* base_file = NULL;
+  int base_fd = -1;
+
+  unsigned long offset = 0;
+  ssize_t nread = 0;
+  while (rc == SCR_SUCCESS &&
+         (nread = scr_read_attempt(src_file, src_fd, buf, block_size)) > 0)
+  {
+    /* hash the block */
+    char hex[33];
+    scr_dedup_hash_hex(buf, (size_t) nread, hex);
+
+    /* check whether our previous flush wrote a block with this
+     * content, if so splice it from its prior location so the
+     * bytes need not travel from this node again */
+    int copied = 0;
+#ifdef HAVE_COPY_FILE_RANGE
+    kvtree* entry = kvtree_get_kv(scr_dedup_index, SCR_DEDUP_KEY_HASH, hex);
+    if (entry != NULL) {
+      char* file = NULL;
+      unsigned long base_offset = 0;
+      unsigned long size = 0;
+      kvtree_util_get_str(entry, SCR_DEDUP_KEY_FILE, &file);
+      kvtree_util_get_unsigned_long(entry, SCR_DEDUP_KEY_OFFSET, &base_offset);
+      kvtree_util_get_unsigned_long(entry, SCR_DEDUP_KEY_SIZE, &size);
+      if (file != NULL && size == (unsigned long) nread) {
+        /* open the base file, reusing the descriptor if the last
+         * hit came from the same file */
+        if (base_fd < 0 || strcmp(base_file, file) != 0) {
+          if (base_fd >= 0) {
+            close(base_fd);
+          }
+          scr_free(&base_file);
+          base_fd = open(file, O_RDONLY);
+          if (base_fd >= 0) {
+            base_file = strdup(file);
+          }
+        }
+
+        /* splice the block across, a base file that has been
+         * deleted or truncated since we indexed it just means we
+         * write the block ourselves below */
+        if (base_fd >= 0) {
+          off_t off_in  = (off_t) base_offset;
+          off_t off_out = (off_t) offset;
+          ssize_t remaining = nread;
+          while (remaining > 0) {
+            ssize_t n = copy_file_range(base_fd, &off_in, dst_fd, &off_out,
+              (size_t) remaining, 0
+            );
+            if (n <= 0) {
+              break;
+            }
+            remaining -= n;
+          }
+          if (remaining == 0) {
+            copied = 1;
+          }
+        }
+      }
+    }
+#endif /* HAVE_COPY_FILE_RANGE */
+
+    /* no match (or the splice came up short), write the block from
+     * the buffer, seeking first since copy_file_range does not
+     * advance the descriptor offset */
+    if (! copied) {
+      if (lseek(dst_fd, (off_t) offset, SEEK_SET) == (off_t) -1) {
+        scr_err("Seeking in %s errno=%d %s @ %s:%d",
+          dst_file, errno, strerror(errno), __FILE__, __LINE__
+        );
+        rc = SCR_FAILURE;
+      } else if (scr_write_attempt(dst_file, dst_fd, buf, (size_t) nread) < nread) {
+        rc = SCR_FAILURE;
+      }
+    }
+
+    /* record where this block now lives so our next flush can
+     * source it from this file */
+    if (rc == SCR_SUCCESS) {
+      pthread_mutex_lock(&scr_dedup_mutex);
+      kvtree* new_entry = kvtree_set_kv(scr_dedup_index_new, SCR_DEDUP_KEY_HASH, hex);
+      kvtree_util_set_str(new_entry, SCR_DEDUP_KEY_FILE, dst_file);
+      kvtree_util_set_unsigned_long(new_entry, SCR_DEDUP_KEY_OFFSET, offset);
+      kvtree_util_set_unsigned_long(new_entry, SCR_DEDUP_KEY_SIZE, (unsigned long) nread);
+      pthread_mutex_unlock(&scr_dedup_mutex);
+    }
+
+    offset += (unsigned long) nread;
+  }
+
+  /* check that we didn't hit a read error */
+  if (nread < 0) {
+    scr_err("Reading file: %s @ %s:%d",
+      src_file, __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+
+  /* release the base descriptor and buffer */
+  if (base_fd >= 0) {
+    close(base_fd);
+  }
+  scr_free(&base_file);
+  scr_buf_put(buf);
+
+  /* close source without fsync since we only read from it */
+  scr_close_nofsync(src_file, src_fd);
+
+  /* close destination, which syncs its data to disk */
+  if (scr_close(dst_file, dst_fd) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  return rc;
+}
+
+/* end the dedup pass, writing the updated index to the prefix
+ * directory if the flush succeeded */
+int scr_dedup_stop(int success)
+{
+  if (! scr_dedup_active) {
+    return SCR_SUCCESS;
+  }
+  scr_dedup_active = 0;
+
+  int rc = SCR_SUCCESS;
+  if (success) {
+    /* note the block size the entries were hashed with */
+    kvtree_util_set_unsigned_long(scr_dedup_index_new, SCR_DEDUP_KEY_BLOCK,
+      (unsigned long) scr_dedup_block
+    );
+
+    /* write out the index for our next flush to match against */
+    char* file = scr_dedup_index_file();
+    spath* path = spath_from_str(file);
+    spath_dirname(path);
+    char* dir = spath_strdup(path);
+    spath_delete(&path);
+
+    /* create the dedup directory, scr_mkdir tolerates a directory
+     * another rank already created */
+    mode_t mode_dir = scr_getmode(1, 1, 1);
+    scr_mkdir(dir, mode_dir);
+    scr_free(&dir);
+
+    if (kvtree_write_file(file, scr_dedup_index_new) != KVTREE_SUCCESS) {
+      scr_err("Failed to write dedup index %s @ %s:%d",
+        file, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+    scr_free(&file);
+  }
+
+  /* drop both indexes, a failed flush leaves the old index on disk
+   * for the next attempt */
+  kvtree_delete(&scr_dedup_index);
+  kvtree_delete(&scr_dedup_index_new);
+
+  return rc;
+}
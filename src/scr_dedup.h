@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_DEDUP_H
+#define SCR_DEDUP_H
+
+/* Block-level dedup for flushes (see SCR_DEDUP).  Each rank keeps an
+ * index in the prefix directory mapping block content hashes to the
+ * file and offset where that block landed in its previous flush.
+ * When a block of the current flush hashes to a known entry, the
+ * block is spliced from its prior location with copy_file_range
+ * instead of being written from the node again, so only blocks that
+ * changed since the last checkpoint travel to the file system.
+ * Every flushed file remains a complete standalone copy, fetch and
+ * scavenge need no reconstruction step. */
+
+/* load this rank's dedup index from the prefix directory,
+ * called before the copies of a flush begin */
+int scr_dedup_start(void);
+
+/* returns 1 if a dedup pass is active, worker threads use this to
+ * route copies through scr_dedup_copy */
+int scr_dedup_enabled(void);
+
+/* copy src_file to dst_file, sourcing blocks that match the previous
+ * flush from their prior location, safe to call from worker threads */
+int scr_dedup_copy(const char* src_file, const char* dst_file);
+
+/* end the dedup pass, writing the updated index to the prefix
+ * directory if the flush succeeded */
+int scr_dedup_stop(int success);
+
+#endif
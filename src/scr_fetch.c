@@ -31,12 +31,16 @@
  */
 
 #include "scr_globals.h"
+#include "scr_stats.h"
 
 #include "spath.h"
 #include "kvtree.h"
 #include "kvtree_util.h"
 #include "axl_mpi.h"
 
+#include <pthread.h>
+#include <sys/mman.h>
+
 /*
 =========================================
 Fetch functions
@@ -59,6 +63,77 @@ Fetch functions
  *      and repeat #2
  */
 
+/* broadcast the summary header from rank 0 with one copy per node,
+ * the packed header crosses the network once per node to a leader
+ * rank, which parks it in a shared-memory segment that its node
+ * peers unpack from directly, so a node holds a single copy of the
+ * packed metadata no matter how many ranks it runs */
+static int scr_fetch_summary_bcast(kvtree* header)
+{
+  /* the lowest rank on each node receives the header for the node */
+  int leader = (scr_my_rank_host == 0);
+
+  /* rank 0 packs the header it just read */
+  size_t pack_size = 0;
+  char* pack_buf = NULL;
+  if (scr_my_rank_world == 0) {
+    pack_size = kvtree_pack_size(header);
+    pack_buf = (char*) SCR_MALLOC(pack_size);
+    kvtree_pack(pack_buf, header);
+  }
+
+  /* send the packed size to the other node leaders */
+  MPI_Comm comm_leaders = MPI_COMM_NULL;
+  MPI_Comm_split(scr_comm_world, leader ? 0 : MPI_UNDEFINED, scr_my_rank_world, &comm_leaders);
+  unsigned long size_ul = (unsigned long) pack_size;
+  if (leader) {
+    MPI_Bcast(&size_ul, 1, MPI_UNSIGNED_LONG, 0, comm_leaders);
+  }
+
+  /* node peers need the size to know how many bytes to unpack */
+  MPI_Bcast(&size_ul, 1, MPI_UNSIGNED_LONG, 0, scr_comm_node);
+  pack_size = (size_t) size_ul;
+
+  /* allocate the node-shared segment, peers request zero bytes
+   * and attach to the leader's allocation */
+  void* win_buf = NULL;
+  MPI_Win win;
+  MPI_Aint win_bytes = leader ? (MPI_Aint) pack_size : 0;
+  MPI_Win_allocate_shared(win_bytes, 1, MPI_INFO_NULL, scr_comm_node, &win_buf, &win);
+
+  /* leaders fill the segment, rank 0 from the buffer it packed,
+   * the rest from the bcast over the leader communicator */
+  if (leader) {
+    if (scr_my_rank_world == 0) {
+      memcpy(win_buf, pack_buf, pack_size);
+    }
+    MPI_Bcast(win_buf, (int) pack_size, MPI_BYTE, 0, comm_leaders);
+    MPI_Comm_free(&comm_leaders);
+  }
+
+  /* wait for our leader to finish writing before we read */
+  MPI_Win_fence(0, win);
+
+  /* peers look up the address of the leader's segment and unpack
+   * the header from the single node copy, rank 0 already has it */
+  if (scr_my_rank_world != 0) {
+    if (! leader) {
+      MPI_Aint query_size;
+      int query_disp;
+      MPI_Win_shared_query(win, 0, &query_size, &query_disp, &win_buf);
+    }
+    kvtree_unpack((char*) win_buf, header);
+  }
+
+  /* hold the segment until every peer has unpacked */
+  MPI_Win_fence(0, win);
+  MPI_Win_free(&win);
+
+  scr_free(&pack_buf);
+
+  return SCR_SUCCESS;
+}
+
 /* read contents of summary file */
 static int scr_fetch_summary(
   const char* summary_dir,
@@ -130,8 +205,9 @@ static int scr_fetch_summary(
     goto cleanup;
   }
 
-  /* broadcast the summary hash */
-  kvtree_bcast(header, 0, scr_comm_world);
+  /* broadcast the summary hash, staging one copy per node in
+   * shared memory rather than sending a copy to every rank */
+  scr_fetch_summary_bcast(header);
 
   /* extract and record the datast in summary info */
   kvtree* dataset_hash = kvtree_new();
@@ -149,6 +225,653 @@ cleanup:
   return rc;
 }
 
+/* state shared by the fetch worker threads,
+ * workers pull the next unclaimed file from the list until it's empty */
+struct scr_fetch_pool {
+  int numfiles;              /* number of files in the list */
+  int next;                  /* index of next unclaimed file */
+  const char** src_filelist; /* source path for each file */
+  const char** dst_filelist; /* destination path for each file */
+  int direct;                /* whether to write destinations with O_DIRECT */
+  int rc;                    /* set to SCR_FAILURE if any copy fails */
+  pthread_mutex_t lock;      /* protects next and rc */
+};
+
+/* worker thread, copies files from the shared list until none remain */
+static void* scr_fetch_worker(void* arg)
+{
+  struct scr_fetch_pool* pool = (struct scr_fetch_pool*) arg;
+  while (1) {
+    /* claim the next file in the list */
+    pthread_mutex_lock(&pool->lock);
+    int i = pool->next;
+    if (i < pool->numfiles) {
+      pool->next++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    /* stop when the list is empty */
+    if (i >= pool->numfiles) {
+      break;
+    }
+
+    /* copy this file into cache */
+    if (scr_file_copy_opts(pool->src_filelist[i], pool->dst_filelist[i], scr_file_buf_size, NULL, pool->direct) != SCR_SUCCESS) {
+      pthread_mutex_lock(&pool->lock);
+      pool->rc = SCR_FAILURE;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+  return NULL;
+}
+
+/* fetch files in the list with a pool of worker threads so that
+ * several reads are in flight at once, returns SCR_SUCCESS if all
+ * files copy */
+static int scr_fetch_sync_threads(
+  int numfiles,
+  const char** src_filelist,
+  const char** dst_filelist,
+  int nthreads,
+  int direct)
+{
+  /* no sense in starting more workers than we have files */
+  if (nthreads > numfiles) {
+    nthreads = numfiles;
+  }
+
+  /* set up the shared work list */
+  struct scr_fetch_pool pool;
+  pool.numfiles     = numfiles;
+  pool.next         = 0;
+  pool.src_filelist = src_filelist;
+  pool.dst_filelist = dst_filelist;
+  pool.direct       = direct;
+  pool.rc           = SCR_SUCCESS;
+  pthread_mutex_init(&pool.lock, NULL);
+
+  /* start the workers */
+  pthread_t* threads = (pthread_t*) malloc(nthreads * sizeof(pthread_t));
+  if (threads == NULL) {
+    scr_err("Allocating memory for fetch threads: malloc(%lu) errno=%d %s @ %s:%d",
+      nthreads * sizeof(pthread_t), errno, strerror(errno), __FILE__, __LINE__
+    );
+    pthread_mutex_destroy(&pool.lock);
+    return SCR_FAILURE;
+  }
+  int started = 0;
+  int i;
+  for (i = 0; i < nthreads; i++) {
+    if (pthread_create(&threads[i], NULL, scr_fetch_worker, &pool) == 0) {
+      started++;
+    } else {
+      scr_err("Failed to start fetch worker thread %d @ %s:%d",
+        i, __FILE__, __LINE__
+      );
+      break;
+    }
+  }
+
+  /* if we couldn't start any workers, run the list ourselves */
+  if (started == 0) {
+    scr_fetch_worker(&pool);
+  }
+
+  /* wait for the workers to drain the list */
+  for (i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  scr_free(&threads);
+  pthread_mutex_destroy(&pool.lock);
+
+  return pool.rc;
+}
+
+/*
+=========================================
+Lazy fetch
+=========================================
+*/
+
+/* With SCR_FETCH_LAZY, the fetch registers a rank's files and
+ * returns without copying them, so the restart can begin as soon as
+ * the metadata is read.  A background thread prefetches the files
+ * in list order, and SCR_Route_file pulls the requested file to the
+ * front by copying it on the calling thread if the prefetcher has
+ * not reached it yet.  The redundancy encode of the fetched dataset
+ * is deferred until every file has landed (scr_fetch_lazy_wait),
+ * which is safe because the dataset remains restorable from the
+ * parallel file system until then. */
+
+/* states of a lazily fetched file */
+#define SCR_FETCH_LAZY_PENDING (0)
+#define SCR_FETCH_LAZY_ACTIVE  (1)
+#define SCR_FETCH_LAZY_DONE    (2)
+
+/* one file registered for lazy fetch */
+struct scr_fetch_lazy_entry {
+  char* src; /* path of file in prefix */
+  char* dst; /* path of file in cache */
+  int state; /* PENDING, ACTIVE, or DONE */
+  int rc;    /* result of the copy, valid once DONE */
+};
+
+static struct scr_fetch_lazy_entry* scr_fetch_lazy_list = NULL;
+static int scr_fetch_lazy_count   = 0;  /* number of entries in the list */
+static int scr_fetch_lazy_id      = -1; /* dataset id being fetched, -1 if none */
+static int scr_fetch_lazy_dst_direct = 0; /* whether to write to cache with O_DIRECT */
+
+/* redundancy descriptor of the dataset, held for the deferred encode */
+static kvtree* scr_fetch_lazy_rd_hash = NULL;
+
+/* background prefetch thread */
+static pthread_t scr_fetch_lazy_thread;
+static int scr_fetch_lazy_running = 0;
+
+/* protects entry states, the condition signals entries becoming DONE */
+static pthread_mutex_t scr_fetch_lazy_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  scr_fetch_lazy_cond  = PTHREAD_COND_INITIALIZER;
+
+/* copy one claimed entry into cache and mark it DONE,
+ * caller must have set the entry ACTIVE under the lock */
+static void scr_fetch_lazy_copy_entry(struct scr_fetch_lazy_entry* e)
+{
+  int rc = scr_file_copy_opts(e->src, e->dst, scr_file_buf_size, NULL, scr_fetch_lazy_dst_direct);
+
+  pthread_mutex_lock(&scr_fetch_lazy_mutex);
+  e->rc    = rc;
+  e->state = SCR_FETCH_LAZY_DONE;
+  pthread_cond_broadcast(&scr_fetch_lazy_cond);
+  pthread_mutex_unlock(&scr_fetch_lazy_mutex);
+}
+
+/* prefetch thread, copies pending files until none remain */
+static void* scr_fetch_lazy_func(void* arg)
+{
+  while (1) {
+    /* claim the first file still pending */
+    pthread_mutex_lock(&scr_fetch_lazy_mutex);
+    struct scr_fetch_lazy_entry* e = NULL;
+    int i;
+    for (i = 0; i < scr_fetch_lazy_count; i++) {
+      if (scr_fetch_lazy_list[i].state == SCR_FETCH_LAZY_PENDING) {
+        e = &scr_fetch_lazy_list[i];
+        e->state = SCR_FETCH_LAZY_ACTIVE;
+        break;
+      }
+    }
+    pthread_mutex_unlock(&scr_fetch_lazy_mutex);
+
+    /* stop when every file has been claimed */
+    if (e == NULL) {
+      break;
+    }
+
+    scr_fetch_lazy_copy_entry(e);
+  }
+  return NULL;
+}
+
+/* returns 1 if a lazy fetch is in flight */
+int scr_fetch_lazy_active(void)
+{
+  return (scr_fetch_lazy_id >= 0);
+}
+
+/* register a rank's files for lazy fetch and start the prefetch
+ * thread, called in place of the upfront copies, a failed check
+ * that the source files are readable fails the whole fetch just as
+ * a failed copy would */
+static int scr_fetch_lazy_register(
+  int id,
+  int direct,
+  int num_files,
+  const char** src_filelist,
+  const char** dest_filelist)
+{
+  /* check that each source file is readable before we promise to
+   * deliver it later, this is a metadata operation so it does not
+   * touch the file data */
+  int i;
+  for (i = 0; i < num_files; i++) {
+    if (access(src_filelist[i], R_OK) < 0) {
+      scr_err("Missing or unreadable file for lazy fetch %s @ %s:%d",
+        src_filelist[i], __FILE__, __LINE__
+      );
+      return SCR_FAILURE;
+    }
+  }
+
+  /* build the entry list */
+  scr_fetch_lazy_list = (struct scr_fetch_lazy_entry*) SCR_MALLOC(
+    num_files * sizeof(struct scr_fetch_lazy_entry)
+  );
+  for (i = 0; i < num_files; i++) {
+    scr_fetch_lazy_list[i].src   = strdup(src_filelist[i]);
+    scr_fetch_lazy_list[i].dst   = strdup(dest_filelist[i]);
+    scr_fetch_lazy_list[i].state = SCR_FETCH_LAZY_PENDING;
+    scr_fetch_lazy_list[i].rc    = SCR_SUCCESS;
+  }
+  scr_fetch_lazy_count      = num_files;
+  scr_fetch_lazy_id         = id;
+  scr_fetch_lazy_dst_direct = direct;
+
+  /* start the prefetch thread, if it fails to start the files are
+   * still fetched on demand by Route_file and the remainder is
+   * drained on the main thread in scr_fetch_lazy_wait */
+  scr_fetch_lazy_running = 0;
+  if (num_files > 0) {
+    if (pthread_create(&scr_fetch_lazy_thread, NULL, scr_fetch_lazy_func, NULL) == 0) {
+      scr_fetch_lazy_running = 1;
+    } else {
+      scr_err("Failed to start lazy fetch thread @ %s:%d",
+        __FILE__, __LINE__
+      );
+    }
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* tear down lazy fetch state without running the deferred encode,
+ * used when the fetch fails on some rank before it completes */
+static void scr_fetch_lazy_abort(void)
+{
+  if (scr_fetch_lazy_id < 0) {
+    return;
+  }
+
+  /* drain remaining entries so the thread exits, then join it */
+  scr_fetch_lazy_func(NULL);
+  if (scr_fetch_lazy_running) {
+    pthread_join(scr_fetch_lazy_thread, NULL);
+    scr_fetch_lazy_running = 0;
+  }
+
+  int i;
+  for (i = 0; i < scr_fetch_lazy_count; i++) {
+    scr_free(&scr_fetch_lazy_list[i].src);
+    scr_free(&scr_fetch_lazy_list[i].dst);
+  }
+  scr_free(&scr_fetch_lazy_list);
+  scr_fetch_lazy_count = 0;
+  scr_fetch_lazy_id    = -1;
+  kvtree_delete(&scr_fetch_lazy_rd_hash);
+}
+
+/* stash a copy of the redundancy descriptor used for the fetch,
+ * the deferred encode in scr_fetch_lazy_wait recreates it */
+static void scr_fetch_lazy_set_reddesc(const scr_reddesc* d)
+{
+  kvtree_delete(&scr_fetch_lazy_rd_hash);
+  scr_fetch_lazy_rd_hash = kvtree_new();
+  scr_reddesc_store_to_hash(d, scr_fetch_lazy_rd_hash);
+}
+
+/* fetch the given file now if it is registered and still pending,
+ * called from SCR_Route_file during restart so the file the
+ * application asks for jumps ahead of the prefetch order */
+int scr_fetch_lazy_file(const char* file)
+{
+  /* nothing to do when no lazy fetch is in flight */
+  if (scr_fetch_lazy_id < 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* look up the entry for this file */
+  pthread_mutex_lock(&scr_fetch_lazy_mutex);
+  struct scr_fetch_lazy_entry* e = NULL;
+  int i;
+  for (i = 0; i < scr_fetch_lazy_count; i++) {
+    if (strcmp(scr_fetch_lazy_list[i].dst, file) == 0) {
+      e = &scr_fetch_lazy_list[i];
+      break;
+    }
+  }
+
+  /* files we don't track (e.g. from another dataset) pass through */
+  if (e == NULL) {
+    pthread_mutex_unlock(&scr_fetch_lazy_mutex);
+    return SCR_SUCCESS;
+  }
+
+  /* if the prefetcher has not reached this file, claim it and copy
+   * it on the calling thread */
+  if (e->state == SCR_FETCH_LAZY_PENDING) {
+    e->state = SCR_FETCH_LAZY_ACTIVE;
+    pthread_mutex_unlock(&scr_fetch_lazy_mutex);
+    scr_fetch_lazy_copy_entry(e);
+    pthread_mutex_lock(&scr_fetch_lazy_mutex);
+  }
+
+  /* otherwise wait for whoever claimed it to finish */
+  while (e->state != SCR_FETCH_LAZY_DONE) {
+    pthread_cond_wait(&scr_fetch_lazy_cond, &scr_fetch_lazy_mutex);
+  }
+  int rc = e->rc;
+  pthread_mutex_unlock(&scr_fetch_lazy_mutex);
+
+  return rc;
+}
+
+/* drain any lazy fetch still in flight and run the deferred
+ * redundancy encode, collective over scr_comm_world, called before
+ * anything that requires the cached dataset to be complete */
+int scr_fetch_lazy_wait(scr_cache_index* cindex)
+{
+  /* the decision to fetch lazily was agreed on by all ranks,
+   * so either everyone enters the collectives below or no one does */
+  if (scr_fetch_lazy_id < 0) {
+    return SCR_SUCCESS;
+  }
+  int id = scr_fetch_lazy_id;
+
+  /* help drain the list on this thread rather than just waiting */
+  scr_fetch_lazy_func(NULL);
+
+  /* wait for any file the prefetch thread still has in flight */
+  if (scr_fetch_lazy_running) {
+    pthread_join(scr_fetch_lazy_thread, NULL);
+    scr_fetch_lazy_running = 0;
+  }
+
+  /* check whether all of our files landed */
+  int success = 1;
+  int i;
+  for (i = 0; i < scr_fetch_lazy_count; i++) {
+    if (scr_fetch_lazy_list[i].rc != SCR_SUCCESS) {
+      success = 0;
+    }
+    scr_free(&scr_fetch_lazy_list[i].src);
+    scr_free(&scr_fetch_lazy_list[i].dst);
+  }
+  scr_free(&scr_fetch_lazy_list);
+  scr_fetch_lazy_count = 0;
+  scr_fetch_lazy_id    = -1;
+
+  /* recreate the redundancy descriptor used for the fetch */
+  scr_reddesc rd;
+  scr_reddesc_init(&rd);
+  scr_reddesc_create_from_hash(&rd, -1, scr_fetch_lazy_rd_hash);
+  kvtree_delete(&scr_fetch_lazy_rd_hash);
+
+  /* run the deferred encode if everyone has all of their files */
+  int rc = SCR_FAILURE;
+  if (scr_alltrue(success, scr_comm_world)) {
+    scr_filemap* map = scr_filemap_new();
+    scr_cache_get_map(cindex, id, map);
+
+    /* recreate any small files held in fetched packfiles now that
+     * their bytes have landed */
+    scr_pack_extract(map);
+
+    rc = scr_reddesc_apply(map, &rd, id);
+    scr_filemap_delete(&map);
+  }
+
+  if (rc == SCR_SUCCESS) {
+    /* the cached copy is now complete and protected */
+    scr_flush_file_location_set(id, SCR_FLUSH_KEY_LOCATION_CACHE);
+  } else {
+    /* drop the partial copy from cache, the dataset is still
+     * intact in the prefix directory */
+    scr_err("Lazy fetch of dataset %d failed, dropping it from cache @ %s:%d",
+      id, __FILE__, __LINE__
+    );
+    scr_cache_delete(cindex, id);
+  }
+
+  scr_reddesc_free(&rd);
+
+  return rc;
+}
+
+/* copy one file out of its container segment into dst_file,
+ * sync gives the SCR_SYNC_* policy of the destination store,
+ * which decides how the file is synced on close */
+static int scr_fetch_file_from_container(
+  const char* dst_file,
+  const char* ctr_file,
+  unsigned long offset,
+  unsigned long length,
+  int sync)
+{
+  int rc = SCR_SUCCESS;
+
+  /* open the container for reading */
+  int ctr_fd = scr_open(ctr_file, O_RDONLY);
+  if (ctr_fd < 0) {
+    scr_err("Opening container for read: scr_open(%s) errno=%d %s @ %s:%d",
+      ctr_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* create the destination file */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(dst_file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (fd < 0) {
+    scr_err("Opening file to extract from container: scr_open(%s) errno=%d %s @ %s:%d",
+      dst_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    scr_close(ctr_file, ctr_fd);
+    return SCR_FAILURE;
+  }
+
+  /* grab buffer from the pool to chunk copies */
+  char* buf = (char*) scr_buf_get(scr_file_buf_size);
+  if (buf == NULL) {
+    scr_close_nofsync(dst_file, fd);
+    scr_close_nofsync(ctr_file, ctr_fd);
+    return SCR_FAILURE;
+  }
+
+  /* read the segment out of the container and write it to the file */
+  off_t pos = (off_t) offset;
+  unsigned long remaining = length;
+  while (remaining > 0 && rc == SCR_SUCCESS) {
+    size_t count = scr_file_buf_size;
+    if ((unsigned long) count > remaining) {
+      count = (size_t) remaining;
+    }
+
+    ssize_t nread = pread(ctr_fd, buf, count, pos);
+    if (nread < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      scr_err("Error reading container: pread(%s) errno=%d %s @ %s:%d",
+        ctr_file, errno, strerror(errno), __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+      break;
+    }
+    if (nread == 0) {
+      /* hit end of container before reading the full segment */
+      scr_err("Container %s is shorter than expected @ %s:%d",
+        ctr_file, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+      break;
+    }
+
+    if (scr_write_attempt(dst_file, fd, buf, nread) != nread) {
+      rc = SCR_FAILURE;
+      break;
+    }
+
+    pos += nread;
+    remaining -= (unsigned long) nread;
+  }
+
+  scr_buf_put(buf);
+
+  /* sync the extracted file according to the store's policy,
+   * the container was only read so there is nothing to sync there */
+  scr_close_policy(dst_file, fd, sync);
+  scr_close_nofsync(ctr_file, ctr_fd);
+
+  return rc;
+}
+
+/* attempt to read our file list from the binary rank2file map,
+ * the fixed-stride rank index lets a reader seek directly to a
+ * record rather than walking the kvtree map level by level, one
+ * rank per node reads the records for all of its node peers and
+ * drops them into a shared-memory segment, so the file system sees
+ * one open per node and a node holds one copy of the packed
+ * records no matter how many ranks it runs */
+static int scr_fetch_rank2file_bin(const char* file, kvtree* filelist)
+{
+  /* rank 0 checks whether the binary map exists, datasets flushed
+   * by older versions only have the kvtree map and we want to avoid
+   * a failed open in that case */
+  int have = 0;
+  if (scr_my_rank_world == 0) {
+    have = (scr_file_is_readable(file) == SCR_SUCCESS);
+  }
+  MPI_Bcast(&have, 1, MPI_INT, 0, scr_comm_world);
+  if (! have) {
+    return SCR_FAILURE;
+  }
+
+  /* assume we will not find our record */
+  int valid = 0;
+
+  /* the lowest rank on each node reads for the node */
+  int leader = (scr_my_rank_host == 0);
+
+  /* gather the world ranks of the tasks on our node to the leader
+   * so it can pick their records out of the rank index */
+  int ranks_node;
+  MPI_Comm_size(scr_comm_node, &ranks_node);
+  int* node_ranks = NULL;
+  if (leader) {
+    node_ranks = (int*) SCR_MALLOC(ranks_node * sizeof(int));
+  }
+  MPI_Gather(&scr_my_rank_world, 1, MPI_INT, node_ranks, 1, MPI_INT, 0, scr_comm_node);
+
+  /* leader reads the record for each local rank and packs them
+   * back to back into a buffer, extents[2*i] holds the offset of
+   * rank i's record in that buffer and extents[2*i+1] its length,
+   * a zero length marks a record we failed to read */
+  unsigned long total = 0;
+  unsigned long* extents = NULL;
+  char* records = NULL;
+  if (leader) {
+    extents = (unsigned long*) SCR_MALLOC(2 * ranks_node * sizeof(unsigned long));
+    memset(extents, 0, 2 * ranks_node * sizeof(unsigned long));
+    uint64_t* srcoffs = (uint64_t*) SCR_MALLOC(ranks_node * sizeof(uint64_t));
+
+    /* open and map the file */
+    int fd = scr_open(file, O_RDONLY);
+    if (fd >= 0) {
+      struct stat st;
+      if (fstat(fd, &st) == 0 &&
+          st.st_size >= SCR_RANK2FILE_BIN_HEADER_SIZE)
+      {
+        size_t map_size = (size_t) st.st_size;
+        void* map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+          const char* base = (const char*) map;
+
+          /* check that this file is a binary rank2file map written
+           * by a job of our size */
+          uint64_t ranks64;
+          memcpy(&ranks64, base + SCR_RANK2FILE_BIN_MAGIC_SIZE, sizeof(uint64_t));
+          if (memcmp(base, SCR_RANK2FILE_BIN_MAGIC, SCR_RANK2FILE_BIN_MAGIC_SIZE) == 0 &&
+              ranks64 == (uint64_t) scr_ranks_world)
+          {
+            /* records must lie within the data region, a zero or
+             * short entry means the map is only partially written */
+            uint64_t data_start = (uint64_t) SCR_RANK2FILE_BIN_HEADER_SIZE +
+              (uint64_t) scr_ranks_world * SCR_RANK2FILE_BIN_ENTRY_SIZE;
+
+            /* size each local rank's record and compute where it
+             * lands in the packed buffer */
+            int i;
+            for (i = 0; i < ranks_node; i++) {
+              uint64_t entry[2];
+              size_t entry_pos = SCR_RANK2FILE_BIN_HEADER_SIZE +
+                (size_t) node_ranks[i] * SCR_RANK2FILE_BIN_ENTRY_SIZE;
+              memcpy(entry, base + entry_pos, sizeof(entry));
+              if (entry[1] > 0 &&
+                  entry[0] >= data_start &&
+                  entry[0] + entry[1] <= (uint64_t) map_size)
+              {
+                srcoffs[i]       = entry[0];
+                extents[2*i]     = total;
+                extents[2*i + 1] = (unsigned long) entry[1];
+                total += (unsigned long) entry[1];
+              }
+            }
+
+            /* copy the records out of the mapping */
+            records = (char*) SCR_MALLOC(total);
+            for (i = 0; i < ranks_node; i++) {
+              if (extents[2*i + 1] > 0) {
+                memcpy(records + extents[2*i], base + srcoffs[i], extents[2*i + 1]);
+              }
+            }
+          }
+
+          munmap(map, map_size);
+        }
+      }
+      scr_close(file, fd);
+    }
+
+    scr_free(&srcoffs);
+  }
+
+  /* hand each rank the extent of its record within the segment */
+  unsigned long extent[2];
+  MPI_Scatter(extents, 2, MPI_UNSIGNED_LONG, extent, 2, MPI_UNSIGNED_LONG, 0, scr_comm_node);
+
+  /* allocate the node-shared segment and fill it from the packed
+   * buffer, peers request zero bytes and attach to the leader's
+   * allocation */
+  void* win_buf = NULL;
+  MPI_Win win;
+  MPI_Aint win_bytes = leader ? (MPI_Aint) total : 0;
+  MPI_Win_allocate_shared(win_bytes, 1, MPI_INFO_NULL, scr_comm_node, &win_buf, &win);
+  if (leader && total > 0) {
+    memcpy(win_buf, records, total);
+  }
+
+  /* wait for our leader to finish writing before we read */
+  MPI_Win_fence(0, win);
+
+  /* unpack our file list from the single node copy */
+  if (extent[1] > 0) {
+    if (! leader) {
+      MPI_Aint query_size;
+      int query_disp;
+      MPI_Win_shared_query(win, 0, &query_size, &query_disp, &win_buf);
+    }
+    kvtree_unpack((char*) win_buf + extent[0], filelist);
+    valid = 1;
+  }
+
+  /* hold the segment until every peer has unpacked */
+  MPI_Win_fence(0, win);
+  MPI_Win_free(&win);
+
+  scr_free(&records);
+  scr_free(&extents);
+  scr_free(&node_ranks);
+
+  /* only use the binary map if every rank found its record,
+   * otherwise everyone falls back to the kvtree map together */
+  if (! scr_alltrue(valid, scr_comm_world)) {
+    kvtree_unset_all(filelist);
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
 /* fetch files from fetch_dir into cache_dir and update filemap */
 static int scr_fetch_data(
   const kvtree* summary_hash,
@@ -164,9 +887,15 @@ static int scr_fetch_data(
   spath_append_str(rank2file_path, "rank2file");
   const char* rank2file = spath_strdup(rank2file_path);
 
-  /* get the list of files to read */
+  /* get the list of files to read, try the binary rank-indexed map
+   * first since each rank can seek straight to its record, fall back
+   * to scattering the kvtree map for datasets that lack one */
   kvtree* filelist = kvtree_new();
-  if (kvtree_read_scatter(rank2file, filelist, scr_comm_world) != KVTREE_SUCCESS) {
+  char rank2file_bin[SCR_MAX_FILENAME];
+  snprintf(rank2file_bin, sizeof(rank2file_bin), "%s.bin", rank2file);
+  if (scr_fetch_rank2file_bin(rank2file_bin, filelist) != SCR_SUCCESS &&
+      kvtree_read_scatter(rank2file, filelist, scr_comm_world) != KVTREE_SUCCESS)
+  {
     scr_err("Failed to rank2file map: `%s' @ %s:%d",
       rank2file, __FILE__, __LINE__
     );
@@ -177,9 +906,14 @@ static int scr_fetch_data(
   scr_free(&rank2file);
   spath_delete(&rank2file_path);
 
-  /* get AXL transfer type */
+  /* get the store descriptor for the cache we're fetching into */
   const scr_storedesc* storedesc = scr_cache_get_storedesc(cindex, id);
-  axl_xfer_t xfer_type = axl_xfer_str_to_type(storedesc->type);
+
+  /* fetch reads from the parallel file system rather than the cache
+   * store, so we pick the transfer type from SCR_FETCH_TYPE instead
+   * of the cache store's type, when unset this selects AXL's
+   * multi-stream pthread backend, the same engine flush uses */
+  axl_xfer_t xfer_type = axl_xfer_str_to_type(scr_fetch_type);
 
   /* TODO: gather list of files to leader for each store descriptor,
    * then use comm of store descriptor leaders in axl call,
@@ -191,6 +925,18 @@ static int scr_fetch_data(
   const char** src_filelist  = (const char**) SCR_MALLOC(num_files * sizeof(char*));
   const char** dest_filelist = (const char**) SCR_MALLOC(num_files * sizeof(char*));
 
+  /* container segment for each file, if the dataset was flushed
+   * in container mode (see SCR_FLUSH_CONTAINER) */
+  int have_containers = 0;
+  char** ctr_filelist = (char**) SCR_MALLOC(num_files * sizeof(char*));
+  unsigned long* ctr_offsets = (unsigned long*) SCR_MALLOC(num_files * sizeof(unsigned long));
+  unsigned long* ctr_lengths = (unsigned long*) SCR_MALLOC(num_files * sizeof(unsigned long));
+
+  /* set for files that were compressed during their flush
+   * (see SCR_FLUSH_COMPRESSION) */
+  int have_compressed = 0;
+  int* compressed = (int*) SCR_MALLOC(num_files * sizeof(int));
+
   /* create list of file names */
   int i = 0;
   kvtree_elem* elem;
@@ -208,6 +954,34 @@ static int scr_fetch_data(
     src_filelist[i] = spath_strdup(srcpath);
     spath_delete(&srcpath);
 
+    /* check whether this file was packed into a container during
+     * its flush, if so record the container path and segment */
+    ctr_filelist[i] = NULL;
+    ctr_offsets[i] = 0;
+    ctr_lengths[i] = 0;
+    kvtree* file_hash = kvtree_elem_hash(elem);
+    char* ctr = NULL;
+    if (kvtree_util_get_str(file_hash, SCR_KEY_CONTAINER, &ctr) == KVTREE_SUCCESS) {
+      /* prepend prefix directory to container path */
+      spath* cpath = spath_from_str(scr_prefix);
+      spath_append_str(cpath, ctr);
+      spath_reduce(cpath);
+      ctr_filelist[i] = spath_strdup(cpath);
+      spath_delete(&cpath);
+
+      kvtree_util_get_unsigned_long(file_hash, SCR_KEY_OFFSET, &ctr_offsets[i]);
+      kvtree_util_get_unsigned_long(file_hash, SCR_KEY_LENGTH, &ctr_lengths[i]);
+      have_containers = 1;
+    }
+
+    /* check whether this file was compressed during its flush */
+    compressed[i] = 0;
+    char* alg = NULL;
+    if (kvtree_util_get_str(file_hash, SCR_KEY_COMPRESS, &alg) == KVTREE_SUCCESS) {
+      compressed[i] = 1;
+      have_compressed = 1;
+    }
+
     /* compute and strdup detination name into dest list */
     if (cache_dir != NULL) {
       /* take basename of file and prepend cache directory */
@@ -229,6 +1003,14 @@ static int scr_fetch_data(
   /* free the list of files */
   kvtree_delete(&filelist);
 
+  /* decide whether to defer the copies and fetch files lazily,
+   * lazy mode only handles plain synchronous copies into cache,
+   * all ranks must agree so that the deferred encode later runs
+   * as a proper collective */
+  int lazy = scr_fetch_lazy && cache_dir != NULL &&
+    ! have_containers && ! have_compressed && xfer_type == AXL_XFER_SYNC;
+  lazy = scr_alltrue(lazy, scr_comm_world);
+
   /* now we can finally fetch the actual files */
   int success = 1;
   if (cache_dir != NULL) {
@@ -240,17 +1022,73 @@ static int scr_fetch_data(
     char* dset_name = NULL;
     scr_dataset_get_name(dataset, &dset_name);
 
-    /* fetch these files into the directory */
-    if (scr_axl(dset_name, num_files, src_filelist, dest_filelist, xfer_type, scr_comm_world) != SCR_SUCCESS) {
-      success = 0;
+    if (have_containers) {
+      /* files were packed into containers during their flush,
+       * extract each file from its container segment */
+      for (i = 0; i < num_files; i++) {
+        if (ctr_filelist[i] == NULL ||
+            scr_fetch_file_from_container(dest_filelist[i], ctr_filelist[i],
+              ctr_offsets[i], ctr_lengths[i], storedesc->sync) != SCR_SUCCESS)
+        {
+          success = 0;
+          break;
+        }
+      }
+    } else if (have_compressed) {
+      /* files were compressed during their flush,
+       * decompress each one on its way back into cache */
+      for (i = 0; i < num_files; i++) {
+        int fetch_rc;
+        if (compressed[i]) {
+          fetch_rc = scr_file_decompress_zlib(src_filelist[i], dest_filelist[i], scr_file_buf_size);
+        } else {
+          fetch_rc = scr_file_copy(src_filelist[i], dest_filelist[i], scr_file_buf_size, NULL);
+        }
+        if (fetch_rc != SCR_SUCCESS) {
+          success = 0;
+          break;
+        }
+      }
+    } else if (lazy) {
+      /* register the files and return without copying them,
+       * a background thread prefetches them while SCR_Route_file
+       * pulls requested files ahead of the prefetch order */
+      if (scr_fetch_lazy_register(id, storedesc->direct, num_files, src_filelist, dest_filelist) != SCR_SUCCESS) {
+        success = 0;
+      }
+    } else {
+      /* determine how many worker threads to use for this fetch,
+       * applying the per-store cap if the descriptor defines one */
+      int nthreads = scr_fetch_threads;
+      if (storedesc->threads > 0 && nthreads > storedesc->threads) {
+        nthreads = storedesc->threads;
+      }
+
+      if (nthreads > 1 && xfer_type == AXL_XFER_SYNC) {
+        /* user asked for plain synchronous copies with a worker pool,
+         * read several files concurrently ourselves */
+        if (scr_fetch_sync_threads(num_files, src_filelist, dest_filelist, nthreads, storedesc->direct) != SCR_SUCCESS) {
+          success = 0;
+        }
+      } else {
+        /* fetch these files into the directory */
+        if (scr_axl(dset_name, num_files, src_filelist, dest_filelist, xfer_type, scr_comm_world) != SCR_SUCCESS) {
+          success = 0;
+        }
+      }
     }
 
     /* free datase */
     scr_dataset_delete(&dataset);
   } else {
-    /* just stat the file to check that it exists */
+    /* just stat the file to check that it exists,
+     * if the file lives in a container, check the container */
     for (i = 0; i < num_files; i++) {
-      if (access(src_filelist[i], R_OK) < 0) {
+      const char* check = src_filelist[i];
+      if (ctr_filelist[i] != NULL) {
+        check = ctr_filelist[i];
+      }
+      if (access(check, R_OK) < 0) {
         /* either can't read this file or it doesn't exist */
         success = 0;
         break;
@@ -262,6 +1100,10 @@ static int scr_fetch_data(
   if (! scr_alltrue(success, scr_comm_world)) {
     /* TODO: auto delete files? */
     rc = SCR_FAILURE;
+
+    /* tear down any lazy fetch we started, another rank may have
+     * failed after we registered our files */
+    scr_fetch_lazy_abort();
   }
 
   /* create a filemap for the files we just read in */
@@ -299,9 +1141,12 @@ static int scr_fetch_data(
     spath_delete(&path_name);
     spath_delete(&path_abs);
 
-    /* stat the file to get its size and other metadata */
+    /* stat the file to get its size and other metadata,
+     * in lazy mode the cache copy may not exist yet, so stat the
+     * source file, which holds the same content */
+    const char* stat_file = lazy ? src_file : dest_file;
     struct stat stat_buf;
-    int stat_rc = stat(dest_file, &stat_buf);
+    int stat_rc = stat(stat_file, &stat_buf);
     if (stat_rc == 0) {
       unsigned long filesize = (unsigned long) stat_buf.st_size;
       scr_meta_set_filesize(meta, filesize);
@@ -315,6 +1160,15 @@ static int scr_fetch_data(
 
   /* write out filemap */
   scr_cache_set_map(cindex, id, map);
+
+  /* recreate any small files held in fetched packfiles so the
+   * application can read them directly on restart, in lazy mode the
+   * packfile has not landed yet and the extract runs again once the
+   * lazy fetch drains */
+  if (! lazy) {
+    scr_pack_extract(map);
+  }
+
   scr_filemap_delete(&map);
 
   /* free memory allocated for file list */
@@ -322,9 +1176,14 @@ static int scr_fetch_data(
     /* free filename strings */
     scr_free(&src_filelist[i]);
     scr_free(&dest_filelist[i]);
+    scr_free(&ctr_filelist[i]);
   }
   scr_free(&src_filelist);
   scr_free(&dest_filelist);
+  scr_free(&ctr_filelist);
+  scr_free(&ctr_offsets);
+  scr_free(&ctr_lengths);
+  scr_free(&compressed);
 
   return rc;
 }
@@ -487,30 +1346,44 @@ int scr_fetch_dset(scr_cache_index* cindex, int dset_id, const char* dset_name,
     return SCR_FAILURE;
   }
 
-  /* read file map for this dataset */
-  scr_filemap* map = scr_filemap_new();
-  scr_cache_get_map(cindex, dset_id, map);
-
-  /* apply redundancy scheme */
-  int rc = scr_reddesc_apply(map, c, dset_id);
-  if (rc == SCR_SUCCESS) {
-    /* record checkpoint id */
+  int rc;
+  if (scr_fetch_lazy_active()) {
+    /* the copies are still in flight in the background, stash the
+     * redundancy descriptor and defer the encode until they land
+     * (scr_fetch_lazy_wait), the dataset remains restorable from
+     * the parallel file system until the encode completes, so we
+     * only record the PFS location for now */
+    scr_fetch_lazy_set_reddesc(c);
     *checkpoint_id = ckpt_id;
-
-    /* update our flush file to indicate this checkpoint is in cache
-     * as well as the parallel file system */
-    /* TODO: should we place SCR_FLUSH_KEY_LOCATION_PFS before
-     * scr_reddesc_apply? */
-    scr_flush_file_location_set(dset_id, SCR_FLUSH_KEY_LOCATION_CACHE);
     scr_flush_file_location_set(dset_id, SCR_FLUSH_KEY_LOCATION_PFS);
     scr_flush_file_location_unset(dset_id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
+    rc = SCR_SUCCESS;
   } else {
-    /* something went wrong, so delete this checkpoint from the cache */
-    scr_cache_delete(cindex, dset_id);
-  }
+    /* read file map for this dataset */
+    scr_filemap* map = scr_filemap_new();
+    scr_cache_get_map(cindex, dset_id, map);
+
+    /* apply redundancy scheme */
+    rc = scr_reddesc_apply(map, c, dset_id);
+    if (rc == SCR_SUCCESS) {
+      /* record checkpoint id */
+      *checkpoint_id = ckpt_id;
+
+      /* update our flush file to indicate this checkpoint is in cache
+       * as well as the parallel file system */
+      /* TODO: should we place SCR_FLUSH_KEY_LOCATION_PFS before
+       * scr_reddesc_apply? */
+      scr_flush_file_location_set(dset_id, SCR_FLUSH_KEY_LOCATION_CACHE);
+      scr_flush_file_location_set(dset_id, SCR_FLUSH_KEY_LOCATION_PFS);
+      scr_flush_file_location_unset(dset_id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
+    } else {
+      /* something went wrong, so delete this checkpoint from the cache */
+      scr_cache_delete(cindex, dset_id);
+    }
 
-  /* free filemap object */
-  scr_filemap_delete(&map);
+    /* free filemap object */
+    scr_filemap_delete(&map);
+  }
 
   /* free our temporary fetch redudancy descriptor */
   scr_reddesc_free(c);
@@ -539,6 +1412,10 @@ int scr_fetch_dset(scr_cache_index* cindex, int dset_id, const char* dset_name,
         &timestamp_start, &time_diff, &total_bytes, &files
       );
     }
+
+    /* record the fetch in our stats counters */
+    scr_stats_sample(SCR_STATS_PHASE_FETCH, time_diff);
+    scr_stats_add_bytes(scr_prefix, total_bytes, files);
   }
 
   /* free cache directory name */
@@ -550,6 +1427,154 @@ int scr_fetch_dset(scr_cache_index* cindex, int dset_id, const char* dset_name,
   return rc;
 }
 
+/* quick validation pass over a fetch candidate, checks that the
+ * summary and rank2file metadata are readable and that every file
+ * in the dataset still exists on the file system, with each rank
+ * checking its own list in parallel, so a damaged checkpoint is
+ * rejected at the cost of a stat pass rather than a full fetch
+ * attempt, collective over scr_comm_world */
+static int scr_fetch_validate_dset(int id)
+{
+  int rc = SCR_SUCCESS;
+
+  /* build path to dataset metadata directory */
+  spath* path = spath_from_str(scr_prefix_scr);
+  spath_append_strf(path, "scr.dataset.%d", id);
+  char* fetch_dir = spath_strdup(path);
+  spath_delete(&path);
+
+  /* read the summary file, which also proves it is readable */
+  kvtree* summary_hash = kvtree_new();
+  if (scr_fetch_summary(fetch_dir, summary_hash) != SCR_SUCCESS) {
+    kvtree_delete(&summary_hash);
+    scr_free(&fetch_dir);
+    return SCR_FAILURE;
+  }
+
+  /* pick up expected file count and byte total for the dataset */
+  scr_dataset* dataset = kvtree_get(summary_hash, SCR_KEY_DATASET);
+  unsigned long bytes = 0;
+  scr_dataset_get_size(dataset, &bytes);
+  int files = 0;
+  scr_dataset_get_files(dataset, &files);
+
+  /* read our file list from the rank2file map */
+  spath* rank2file_path = spath_from_str(fetch_dir);
+  spath_append_str(rank2file_path, "rank2file");
+  const char* rank2file = spath_strdup(rank2file_path);
+  spath_delete(&rank2file_path);
+
+  kvtree* filelist = kvtree_new();
+  char rank2file_bin[SCR_MAX_FILENAME];
+  snprintf(rank2file_bin, sizeof(rank2file_bin), "%s.bin", rank2file);
+  if (scr_fetch_rank2file_bin(rank2file_bin, filelist) != SCR_SUCCESS &&
+      kvtree_read_scatter(rank2file, filelist, scr_comm_world) != KVTREE_SUCCESS)
+  {
+    kvtree_delete(&filelist);
+    scr_free(&rank2file);
+    kvtree_delete(&summary_hash);
+    scr_free(&fetch_dir);
+    return SCR_FAILURE;
+  }
+  scr_free(&rank2file);
+
+  /* check each of our files, counting files and bytes as we go */
+  int ok = 1;
+  int plain = 1;
+  int my_files = 0;
+  unsigned long my_bytes = 0;
+  kvtree* files_hash = kvtree_get(filelist, "FILE");
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(files_hash);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    const char* file = kvtree_elem_key(elem);
+    kvtree* file_hash = kvtree_elem_hash(elem);
+    my_files++;
+
+    /* a file packed into a container is checked through its
+     * container segment */
+    char* ctr = NULL;
+    if (kvtree_util_get_str(file_hash, SCR_KEY_CONTAINER, &ctr) == KVTREE_SUCCESS) {
+      plain = 0;
+
+      unsigned long offset = 0;
+      unsigned long length = 0;
+      kvtree_util_get_unsigned_long(file_hash, SCR_KEY_OFFSET, &offset);
+      kvtree_util_get_unsigned_long(file_hash, SCR_KEY_LENGTH, &length);
+
+      spath* cpath = spath_from_str(scr_prefix);
+      spath_append_str(cpath, ctr);
+      spath_reduce(cpath);
+      char* ctr_file = spath_strdup(cpath);
+      spath_delete(&cpath);
+
+      /* our segment must lie within the container */
+      struct stat st;
+      if (stat(ctr_file, &st) != 0 ||
+          offset + length > (unsigned long) st.st_size)
+      {
+        ok = 0;
+      }
+      scr_free(&ctr_file);
+      continue;
+    }
+
+    /* a compressed file changed size during its flush, so skip the
+     * aggregate byte check when we see one */
+    char* alg = NULL;
+    if (kvtree_util_get_str(file_hash, SCR_KEY_COMPRESS, &alg) == KVTREE_SUCCESS) {
+      plain = 0;
+    }
+
+    /* plain file, check that it still exists and is readable */
+    spath* srcpath = spath_from_str(scr_prefix);
+    spath_append_str(srcpath, file);
+    spath_reduce(srcpath);
+    char* src_file = spath_strdup(srcpath);
+    spath_delete(&srcpath);
+
+    struct stat st;
+    if (stat(src_file, &st) != 0 || access(src_file, R_OK) != 0) {
+      ok = 0;
+    } else {
+      my_bytes += (unsigned long) st.st_size;
+    }
+    scr_free(&src_file);
+  }
+  kvtree_delete(&filelist);
+
+  /* every rank must have found all of its files */
+  if (! scr_alltrue(ok, scr_comm_world)) {
+    rc = SCR_FAILURE;
+  }
+
+  /* cross-check the totals against the dataset: the file count must
+   * match, and when no file was packed or compressed the bytes on
+   * disk must add up to the dataset size, this stands in for a
+   * checksum pass since the rank2file map carries no checksums */
+  if (rc == SCR_SUCCESS && files > 0) {
+    int total_files = 0;
+    MPI_Allreduce(&my_files, &total_files, 1, MPI_INT, MPI_SUM, scr_comm_world);
+    if (total_files != files) {
+      rc = SCR_FAILURE;
+    }
+  }
+  if (rc == SCR_SUCCESS && bytes > 0 && scr_alltrue(plain, scr_comm_world)) {
+    unsigned long total_bytes = 0;
+    MPI_Allreduce(&my_bytes, &total_bytes, 1, MPI_UNSIGNED_LONG, MPI_SUM, scr_comm_world);
+    if (total_bytes != bytes) {
+      rc = SCR_FAILURE;
+    }
+  }
+
+  kvtree_delete(&summary_hash);
+  scr_free(&fetch_dir);
+
+  return rc;
+}
+
 /* attempt to fetch most recent checkpoint from prefix directory into
  * cache, fills in map if successful and sets fetch_attempted to 1 if
  * any fetch is attempted, returns SCR_SUCCESS if successful */
@@ -681,6 +1706,23 @@ int scr_fetch_latest(scr_cache_index* cindex, int* fetch_attempted)
 
     /* check whether we've got a path */
     if (strcmp(target, "") != 0) {
+      /* before committing to a full fetch, run a cheap validation
+       * pass over the candidate, if its metadata or files are
+       * damaged we mark it failed and walk back to the next
+       * checkpoint right away instead of burning a fetch attempt */
+      if (scr_fetch_validate && scr_fetch_validate_dset(target_id) != SCR_SUCCESS) {
+        if (scr_my_rank_world == 0) {
+          scr_dbg(1, "Checkpoint %s failed pre-fetch validation", target);
+          if (scr_log_enable) {
+            scr_log_event("FETCH_INVALID", NULL, &target_id, target, NULL, NULL);
+          }
+          scr_index_unset_current(index_hash);
+          scr_index_mark_failed(index_hash, target_id, target);
+          scr_index_write(scr_prefix_path, index_hash);
+        }
+        continue;
+      }
+
       /* got something, attempt to fetch the checkpoint */
       int ckpt_id;
       rc = scr_fetch_dset(cindex, target_id, target, &ckpt_id);
@@ -19,4 +19,16 @@ int scr_fetch_latest(scr_filemap* map, int* fetch_attempted);
  * return its checkpoint id */
 int scr_fetch_dset(scr_cache_index* cindex, int dset_id, const char* dset_name, int* checkpoint_id);
 
+/* returns 1 if a lazy fetch is in flight (see SCR_FETCH_LAZY) */
+int scr_fetch_lazy_active(void);
+
+/* fetch the given cache file now if a lazy fetch is in flight and
+ * the file has not been copied yet, called from SCR_Route_file
+ * during restart, local to the calling process */
+int scr_fetch_lazy_file(const char* file);
+
+/* drain any lazy fetch still in flight and run the deferred
+ * redundancy encode, collective over scr_comm_world */
+int scr_fetch_lazy_wait(scr_cache_index* cindex);
+
 #endif
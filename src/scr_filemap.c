@@ -220,6 +220,138 @@ kvtree_elem* scr_filemap_first_file(const scr_filemap* map)
   return elem;
 }
 
+/* compare two file-set entries by filename for sorting */
+static int scr_filemap_fset_compare(const void* a, const void* b)
+{
+  const scr_filemap_fset_entry* entry_a = (const scr_filemap_fset_entry*) a;
+  const scr_filemap_fset_entry* entry_b = (const scr_filemap_fset_entry*) b;
+  return strcmp(entry_a->file, entry_b->file);
+}
+
+/* build a sorted file set over the files in the given filemap */
+scr_filemap_fset* scr_filemap_fset_from_map(const scr_filemap* map)
+{
+  /* allocate the set and an entry for each file in the map */
+  scr_filemap_fset* set = (scr_filemap_fset*) SCR_MALLOC(sizeof(scr_filemap_fset));
+  set->count   = 0;
+  set->entries = NULL;
+
+  kvtree* fh = scr_filemap_get_fh(map);
+  int count = kvtree_size(fh);
+  if (count == 0) {
+    return set;
+  }
+  set->entries = (scr_filemap_fset_entry*) SCR_MALLOC(count * sizeof(scr_filemap_fset_entry));
+
+  /* intern pointers to each filename and its meta data,
+   * the single walk here replaces a hash lookup per file
+   * on every later pass over the map */
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(fh);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    scr_filemap_fset_entry* entry = &set->entries[set->count];
+    entry->file = kvtree_elem_key(elem);
+    entry->meta = kvtree_get(kvtree_elem_hash(elem), SCR_FILEMAP_KEY_META);
+    set->count++;
+  }
+
+  /* sort entries by filename so lookups can binary search */
+  qsort(set->entries, set->count, sizeof(scr_filemap_fset_entry), scr_filemap_fset_compare);
+
+  return set;
+}
+
+/* return the union of two sorted sets as a new set via linear merge,
+ * on duplicate filenames the entry from set1 is kept */
+scr_filemap_fset* scr_filemap_fset_union(const scr_filemap_fset* set1, const scr_filemap_fset* set2)
+{
+  scr_filemap_fset* set = (scr_filemap_fset*) SCR_MALLOC(sizeof(scr_filemap_fset));
+  set->count   = 0;
+  set->entries = NULL;
+
+  int total = set1->count + set2->count;
+  if (total == 0) {
+    return set;
+  }
+  set->entries = (scr_filemap_fset_entry*) SCR_MALLOC(total * sizeof(scr_filemap_fset_entry));
+
+  /* step through both sorted inputs, always taking the smaller
+   * filename, and collapsing duplicates in favor of set1 */
+  int i = 0;
+  int j = 0;
+  while (i < set1->count || j < set2->count) {
+    int cmp;
+    if (i >= set1->count) {
+      cmp = 1;
+    } else if (j >= set2->count) {
+      cmp = -1;
+    } else {
+      cmp = strcmp(set1->entries[i].file, set2->entries[j].file);
+    }
+
+    if (cmp < 0) {
+      set->entries[set->count] = set1->entries[i];
+      i++;
+    } else if (cmp > 0) {
+      set->entries[set->count] = set2->entries[j];
+      j++;
+    } else {
+      set->entries[set->count] = set1->entries[i];
+      i++;
+      j++;
+    }
+    set->count++;
+  }
+
+  return set;
+}
+
+/* binary search for the entry of the given file, returns NULL if not found */
+const scr_filemap_fset_entry* scr_filemap_fset_lookup(const scr_filemap_fset* set, const char* file)
+{
+  if (set == NULL || file == NULL) {
+    return NULL;
+  }
+  scr_filemap_fset_entry key;
+  key.file = file;
+  key.meta = NULL;
+  return (const scr_filemap_fset_entry*) bsearch(
+    &key, set->entries, set->count,
+    sizeof(scr_filemap_fset_entry), scr_filemap_fset_compare
+  );
+}
+
+/* return the number of entries in the set */
+int scr_filemap_fset_num_files(const scr_filemap_fset* set)
+{
+  if (set == NULL) {
+    return 0;
+  }
+  return set->count;
+}
+
+/* return the ith entry in sorted filename order, returns NULL if out of range */
+const scr_filemap_fset_entry* scr_filemap_fset_file(const scr_filemap_fset* set, int i)
+{
+  if (set == NULL || i < 0 || i >= set->count) {
+    return NULL;
+  }
+  return &set->entries[i];
+}
+
+/* free the set, the backing filemap is left untouched */
+int scr_filemap_fset_delete(scr_filemap_fset** ptr_set)
+{
+  if (ptr_set != NULL && *ptr_set != NULL) {
+    scr_filemap_fset* set = *ptr_set;
+    scr_free(&set->entries);
+    scr_free(ptr_set);
+  }
+  return SCR_SUCCESS;
+}
+
 /* return the number of files in the filemap */
 int scr_filemap_num_files(const scr_filemap* map)
 {
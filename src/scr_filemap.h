@@ -104,6 +104,52 @@ Filemap iterator functions
 /* given a filemap, return a hash elem pointer to the first file */
 kvtree_elem* scr_filemap_first_file(const scr_filemap* map);
 
+/*
+=========================================
+Filemap sorted file-set functions
+=========================================
+*/
+
+/* A read-only sorted-array view over the files of a filemap for
+ * merge-heavy, walk-heavy paths like scavenge and rebuild, where maps
+ * are bulk-constructed and then only read.  Entries intern pointers
+ * into the backing filemap rather than copying strings or meta data,
+ * so the backing map must outlive the set and must not be modified
+ * while the set is in use.  Iterating the array and looking up meta
+ * data through an entry avoids the per-file hash lookups of the
+ * generic filemap calls. */
+
+/* one file record, pointers reference memory owned by the backing map */
+typedef struct scr_filemap_fset_entry {
+  const char* file; /* interned pointer to the filename key */
+  scr_meta* meta;   /* pointer to the meta data for the file, NULL if unset */
+} scr_filemap_fset_entry;
+
+/* array of file records sorted by filename */
+typedef struct scr_filemap_fset {
+  int count;                       /* number of entries */
+  scr_filemap_fset_entry* entries; /* entries sorted by filename */
+} scr_filemap_fset;
+
+/* build a sorted file set over the files in the given filemap */
+scr_filemap_fset* scr_filemap_fset_from_map(const scr_filemap* map);
+
+/* return the union of two sorted sets as a new set via linear merge,
+ * on duplicate filenames the entry from set1 is kept */
+scr_filemap_fset* scr_filemap_fset_union(const scr_filemap_fset* set1, const scr_filemap_fset* set2);
+
+/* binary search for the entry of the given file, returns NULL if not found */
+const scr_filemap_fset_entry* scr_filemap_fset_lookup(const scr_filemap_fset* set, const char* file);
+
+/* return the number of entries in the set */
+int scr_filemap_fset_num_files(const scr_filemap_fset* set);
+
+/* return the ith entry in sorted filename order, returns NULL if out of range */
+const scr_filemap_fset_entry* scr_filemap_fset_file(const scr_filemap_fset* set, int i);
+
+/* free the set, the backing filemap is left untouched */
+int scr_filemap_fset_delete(scr_filemap_fset** ptr_set);
+
 /*
 =========================================
 Filemap query count functions
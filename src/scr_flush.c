@@ -11,11 +11,16 @@
 
 #include "scr_globals.h"
 
+#include "scr_stats.h"
+
 #include "spath.h"
 #include "kvtree.h"
 #include "kvtree_util.h"
 #include "dtcmp.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 /*
 =========================================
 Prepare for flush by building list of files, creating directories,
@@ -131,12 +136,8 @@ int scr_flush_create_dirs(
 {
   /* TODO: need to list dirs in order from parent to child */
 
-  /* allocate buffers to hold the directory needed for each file */
-  int* leader           = (int*)         SCR_MALLOC(sizeof(int)         * count);
-  const char** dirs     = (const char**) SCR_MALLOC(sizeof(const char*) * count);
-  uint64_t* group_id    = (uint64_t*)    SCR_MALLOC(sizeof(uint64_t)    * count);
-  uint64_t* group_ranks = (uint64_t*)    SCR_MALLOC(sizeof(uint64_t)    * count);
-  uint64_t* group_rank  = (uint64_t*)    SCR_MALLOC(sizeof(uint64_t)    * count);
+  /* allocate buffer to hold the directory needed for each file */
+  const char** dirs = (const char**) SCR_MALLOC(sizeof(const char*) * count);
 
   /* lookup directory from meta data for each file */
   int i;
@@ -147,25 +148,51 @@ int scr_flush_create_dirs(
     spath_dirname(path);
     dirs[i] = spath_strdup(path);
     spath_delete(&path);
+  }
 
-    /* we'll use DTCMP to select one leader for each directory later */
-    leader[i] = 0;
+  /* drop local duplicates before the global ranking, most ranks
+   * write all of their files to one directory, so this collapses
+   * the list handed to DTCMP from one entry per file down to one
+   * entry per directory */
+  int udirs = 0;
+  for (i = 0; i < count; i++) {
+    int j;
+    int found = 0;
+    for (j = 0; j < udirs; j++) {
+      if (strcmp(dirs[i], dirs[j]) == 0) {
+        found = 1;
+        break;
+      }
+    }
+    if (found) {
+      /* seen this directory already, free the copy */
+      const char* dir = dirs[i];
+      scr_free(&dir);
+    } else {
+      /* first time we've seen this directory, keep it */
+      dirs[udirs] = dirs[i];
+      udirs++;
+    }
   }
 
+  /* allocate buffers for the ranking of unique directories */
+  int* leader           = (int*)      SCR_MALLOC(sizeof(int)      * udirs);
+  uint64_t* group_id    = (uint64_t*) SCR_MALLOC(sizeof(uint64_t) * udirs);
+  uint64_t* group_ranks = (uint64_t*) SCR_MALLOC(sizeof(uint64_t) * udirs);
+  uint64_t* group_rank  = (uint64_t*) SCR_MALLOC(sizeof(uint64_t) * udirs);
+
   /* with DTCMP we identify a single process to create each directory */
 
   /* identify the set of unique directories */
   uint64_t groups;
   DTCMP_Rankv_strings(
-    count, dirs, &groups, group_id, group_ranks, group_rank,
+    udirs, dirs, &groups, group_id, group_ranks, group_rank,
     DTCMP_FLAG_NONE, comm
   );
 
   /* select leader for each directory */
-  for (i = 0; i < count; i++) {
-    if (group_rank[i] == 0) {
-      leader[i] = 1;
-    }
+  for (i = 0; i < udirs; i++) {
+    leader[i] = (group_rank[i] == 0);
   }
 
   /* get file mode for directory permissions */
@@ -175,7 +202,7 @@ int scr_flush_create_dirs(
 
   /* create other directories in file list */
   int success = 1;
-  for (i = 0; i < count; i++) {
+  for (i = 0; i < udirs; i++) {
     /* get directory name */
     const char* dir = dirs[i];
 
@@ -232,7 +259,9 @@ int scr_flush_prepare(const scr_cache_index* cindex, int id, kvtree* file_list)
   /* assume we'll succeed */
   int rc = SCR_SUCCESS;
 
-  /* check that we have all of our files */
+  /* check that we have all of our files,
+   * we defer the global check until after we build the file list
+   * so that we can verify both conditions in a single collective */
   int have_files = 1;
   if (scr_cache_check_files(cindex, id) != SCR_SUCCESS) {
     scr_err("Missing one or more files for dataset %d @ %s:%d",
@@ -241,13 +270,15 @@ int scr_flush_prepare(const scr_cache_index* cindex, int id, kvtree* file_list)
     have_files = 0;
   }
 
-  if (! scr_alltrue(have_files, scr_comm_world)) {
-    if (scr_my_rank_world == 0) {
-      scr_err("One or more processes are missing files for dataset %d @ %s:%d",
-        id, __FILE__, __LINE__
-      );
-    }
-    return SCR_FAILURE;
+  /* refuse to flush a dataset the scrubber found to be corrupt,
+   * restart will rebuild it from redundancy data instead */
+  int failed = 0;
+  scr_cache_index_get_failed(cindex, id, &failed);
+  if (failed) {
+    scr_err("Dataset %d failed a CRC scrub @ %s:%d",
+      id, __FILE__, __LINE__
+    );
+    have_files = 0;
   }
 
   /* lookup dataset from filemap and store in file list */
@@ -291,7 +322,22 @@ int scr_flush_prepare(const scr_cache_index* cindex, int id, kvtree* file_list)
   /* free map object */
   scr_filemap_delete(&map);
 
-  if (! scr_alltrue(rc == SCR_SUCCESS, scr_comm_world)) {
+  /* verify that everyone has their files and built their list,
+   * both conditions ride a single allreduce, on failure the file
+   * list may be partially filled but callers discard it */
+  int flags[2], all_flags[2];
+  flags[0] = have_files;
+  flags[1] = (rc == SCR_SUCCESS);
+  scr_alltrue_multi(flags, all_flags, 2, scr_comm_world);
+  if (! all_flags[0]) {
+    if (scr_my_rank_world == 0) {
+      scr_err("One or more processes are missing files for dataset %d @ %s:%d",
+        id, __FILE__, __LINE__
+      );
+    }
+    rc = SCR_FAILURE;
+  }
+  if (! all_flags[1]) {
     if (scr_my_rank_world == 0) {
       scr_err("Failed to create list of files and metadata for dataset %d @ %s:%d",
         id, __FILE__, __LINE__
@@ -445,10 +491,6 @@ int scr_flush_complete(const scr_cache_index* cindex, int id, kvtree* file_list)
   /* update index file */
   if (scr_my_rank_world == 0) {
     if (flushed == SCR_SUCCESS) {
-      /* read the index file */
-      kvtree* index_hash = kvtree_new();
-      scr_index_read(scr_prefix_path, index_hash);
-
       /* get name of dataset */
       char* name;
       if (scr_dataset_get_name(dataset, &name) != SCR_SUCCESS) {
@@ -457,29 +499,26 @@ int scr_flush_complete(const scr_cache_index* cindex, int id, kvtree* file_list)
         );
       }
 
-      /* clear any existing entry for this dataset */
-      scr_index_remove(index_hash, name);
+      /* append updates to the index journal rather than rewriting the
+       * index file, the full dataset entry was already recorded by
+       * scr_flush_init_index when the flush started, so here we only
+       * flip its flags, appends do not take the index file lock so a
+       * concurrent index reader cannot stall flush completion */
 
       /* update complete flag in index file */
-      scr_index_set_dataset(index_hash, id, name, dataset, complete);
+      scr_index_journal_set_complete(scr_prefix_path, id, name, complete);
 
       /* record flushed tag */
-      scr_index_mark_flushed(index_hash, id, name);
+      scr_index_journal_mark_flushed(scr_prefix_path, id, name);
 
       /* remove any failed marker, since we may have flushed over
        * a previously failed dataset */
-      scr_index_clear_failed(index_hash, id, name);
+      scr_index_journal_clear_failed(scr_prefix_path, id, name);
 
-      /* if this is a checkpoint, update current to point to new dataset,
-       * this must come after index_set_dataset above because set_current
-       * checks that named dataset is a checkpoint */
+      /* if this is a checkpoint, update current to point to new dataset */
       if (scr_dataset_is_ckpt(dataset)) {
-        scr_index_set_current(index_hash, name);
+        scr_index_journal_set_current(scr_prefix_path, name);
       }
-
-      /* write the index file and delete the hash */
-      scr_index_write(scr_prefix_path, index_hash);
-      kvtree_delete(&index_hash);
     }
   }
 
@@ -510,3 +549,158 @@ int scr_flush_complete(const scr_cache_index* cindex, int id, kvtree* file_list)
 
   return flushed;
 }
+
+/*
+=========================================
+Straggler-node detection
+=========================================
+*/
+
+/* fraction of the median node bandwidth below which a flush counts
+ * as slow for that node */
+#define SCR_FLUSH_STRAGGLER_FRACTION (0.5)
+
+/* fixed hostname field width for the gather to rank 0 */
+#define SCR_FLUSH_STRAGGLER_HOSTLEN (256)
+
+/* maps hostname to its count of consecutive slow flushes,
+ * rank 0 only, a fast flush resets the count */
+static kvtree* scr_flush_straggler_counts = NULL;
+
+/* compare doubles for qsort */
+static int scr_flush_straggler_compare(const void* a, const void* b)
+{
+  double bw_a = *(const double*) a;
+  double bw_b = *(const double*) b;
+  if (bw_a < bw_b) {
+    return -1;
+  }
+  if (bw_a > bw_b) {
+    return 1;
+  }
+  return 0;
+}
+
+/* given the file list of a completed flush and the seconds this process
+ * spent writing its data, compute the achieved bandwidth of each node,
+ * and flag nodes that persistently trail the median, collective over
+ * scr_comm_world */
+void scr_flush_straggler_check(const kvtree* file_list, double secs)
+{
+  /* nothing to do if straggler detection is disabled */
+  if (scr_flush_straggler <= 0) {
+    return;
+  }
+
+  /* sum up the bytes this process wrote */
+  double my_bytes = 0.0;
+  kvtree_elem* elem;
+  kvtree* files = kvtree_get(file_list, SCR_KEY_FILE);
+  for (elem = kvtree_elem_first(files);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    kvtree* hash = kvtree_elem_hash(elem);
+    scr_meta* meta = kvtree_get(hash, SCR_KEY_META);
+    unsigned long filesize;
+    if (scr_meta_get_filesize(meta, &filesize) == SCR_SUCCESS) {
+      my_bytes += (double) filesize;
+    }
+  }
+
+  /* the node moves the sum of its ranks' bytes,
+   * and its slowest rank sets the time */
+  double node_bytes, node_secs;
+  MPI_Reduce(&my_bytes, &node_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, scr_comm_node);
+  MPI_Reduce(&secs, &node_secs, 1, MPI_DOUBLE, MPI_MAX, 0, scr_comm_node);
+
+  /* node leaders forward their bandwidth to rank 0 for the comparison */
+  int leader = (scr_my_rank_host == 0);
+  MPI_Comm comm_leaders;
+  MPI_Comm_split(scr_comm_world, leader ? 0 : MPI_UNDEFINED,
+    scr_my_rank_world, &comm_leaders
+  );
+  if (! leader) {
+    return;
+  }
+
+  int leader_rank, leader_ranks;
+  MPI_Comm_rank(comm_leaders, &leader_rank);
+  MPI_Comm_size(comm_leaders, &leader_ranks);
+
+  /* compute the bandwidth this node achieved */
+  double bw = 0.0;
+  if (node_secs > 0.0) {
+    bw = node_bytes / node_secs;
+  }
+
+  /* copy our hostname into a fixed-width field for the gather */
+  char host[SCR_FLUSH_STRAGGLER_HOSTLEN];
+  memset(host, 0, sizeof(host));
+  if (scr_my_hostname != NULL) {
+    strncpy(host, scr_my_hostname, sizeof(host) - 1);
+  }
+
+  /* gather bandwidth and hostname of every node to rank 0 */
+  double* bws = NULL;
+  char* hosts = NULL;
+  if (leader_rank == 0) {
+    bws   = (double*) SCR_MALLOC(leader_ranks * sizeof(double));
+    hosts = (char*)   SCR_MALLOC(leader_ranks * SCR_FLUSH_STRAGGLER_HOSTLEN);
+  }
+  MPI_Gather(&bw, 1, MPI_DOUBLE, bws, 1, MPI_DOUBLE, 0, comm_leaders);
+  MPI_Gather(host, SCR_FLUSH_STRAGGLER_HOSTLEN, MPI_CHAR,
+    hosts, SCR_FLUSH_STRAGGLER_HOSTLEN, MPI_CHAR, 0, comm_leaders
+  );
+
+  /* rank 0 compares each node against the median and tracks repeat offenders */
+  if (leader_rank == 0 && leader_ranks > 1) {
+    /* sort a copy of the bandwidths to find the median */
+    double* sorted = (double*) SCR_MALLOC(leader_ranks * sizeof(double));
+    memcpy(sorted, bws, leader_ranks * sizeof(double));
+    qsort(sorted, leader_ranks, sizeof(double), scr_flush_straggler_compare);
+    double median = sorted[leader_ranks / 2];
+    double threshold = median * SCR_FLUSH_STRAGGLER_FRACTION;
+    scr_free(&sorted);
+
+    /* create the strike map on first use */
+    if (scr_flush_straggler_counts == NULL) {
+      scr_flush_straggler_counts = kvtree_new();
+    }
+
+    int i;
+    for (i = 0; i < leader_ranks; i++) {
+      const char* name = hosts + i * SCR_FLUSH_STRAGGLER_HOSTLEN;
+
+      /* look up how many flushes in a row this node has been slow */
+      int strikes = 0;
+      kvtree_util_get_int(scr_flush_straggler_counts, name, &strikes);
+
+      if (bws[i] < threshold) {
+        /* another slow flush for this node */
+        strikes++;
+        kvtree_util_set_int(scr_flush_straggler_counts, name, strikes);
+
+        /* report the node once it has been slow often enough that
+         * transient interference is unlikely to explain it */
+        if (strikes >= scr_flush_straggler) {
+          scr_dbg(1, "Flush straggler: node %s achieved %f MB/s, median node %f MB/s, slow for %d consecutive flushes",
+            name, bws[i] / (1024.0 * 1024.0), median / (1024.0 * 1024.0), strikes
+          );
+          if (scr_log_enable) {
+            double secs_log = node_secs;
+            scr_log_event("FLUSH_STRAGGLER", name, NULL, NULL, NULL, &secs_log);
+          }
+          scr_stats_set_straggler(name, bws[i], strikes);
+        }
+      } else {
+        /* node kept up this time, forgive earlier strikes */
+        kvtree_util_set_int(scr_flush_straggler_counts, name, 0);
+      }
+    }
+  }
+
+  scr_free(&bws);
+  scr_free(&hosts);
+  MPI_Comm_free(&comm_leaders);
+}
@@ -56,4 +56,10 @@ int scr_flush_prepare(const scr_cache_index* cindex, int id, kvtree* file_list);
  * complete the flush by writing the summary file */
 int scr_flush_complete(const scr_cache_index* cindex, int id, kvtree* file_list);
 
+/* given the file list of a completed flush and the seconds this process
+ * spent writing its data, compute the achieved bandwidth of each node,
+ * and flag nodes that persistently trail the median, collective over
+ * scr_comm_world */
+void scr_flush_straggler_check(const kvtree* file_list, double secs);
+
 #endif
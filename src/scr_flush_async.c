@@ -19,24 +19,109 @@
 #define FILO_KEY_OUT_NAME "NAME"
 #define FILO_KEY_OUT_AXL  "AXL"
 
-/* records the time the async flush started */
-static time_t scr_flush_async_timestamp_start;
-
-/* records the time the async flush started from MPI_Wtime */
-static double scr_flush_async_time_start;
-
-/* tracks list of files written with flush */
-static kvtree* scr_flush_async_file_list = NULL;
+/* keys for per-dataset flush state, so that flushes of multiple
+ * datasets can be outstanding at the same time */
+#define SCR_FLUSH_ASYNC_KEY_DSET      ("DSET")
+#define SCR_FLUSH_ASYNC_KEY_FILES     ("FILES")
+#define SCR_FLUSH_ASYNC_KEY_RANKFILE  ("RANKFILE")
+#define SCR_FLUSH_ASYNC_KEY_FLUSHED   ("FLUSHED")
+#define SCR_FLUSH_ASYNC_KEY_TIMESTAMP ("TIMESTAMP")
+#define SCR_FLUSH_ASYNC_KEY_TIME      ("TIME")
+#define SCR_FLUSH_ASYNC_KEY_BYTES     ("BYTES")
+#define SCR_FLUSH_ASYNC_KEY_PROGRESS  ("PROGRESS")
+#define SCR_FLUSH_ASYNC_KEY_RESTARTS  ("RESTARTS")
+
+/* number of times a stalled transfer is re-dispatched through AXL
+ * before we give up on it and fall back to a synchronous flush */
+#define SCR_FLUSH_ASYNC_MAX_RESTARTS (1)
+
+/* tracks state for each dataset being flushed, keyed by dataset id,
+ * each entry records the file list, rank2file path, timer values,
+ * and whether any stage of that flush has failed */
+static kvtree* scr_flush_async_datasets = NULL;
 
 /* tracks AXL id for outstanding transfer */
 static kvtree* scr_flush_async_axl_list = NULL;
 
-/* path to rankfile for ongoing flush */
-static char* scr_flush_async_rankfile = NULL;
+/* lookup state hash for given dataset id,
+ * returns NULL if this dataset is not being flushed */
+static kvtree* scr_flush_async_state(int id)
+{
+  return kvtree_get_kv_int(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET, id);
+}
 
-/* flag indicating whether we have detected failure
- * at any point in process of async flush */
-static int scr_flush_async_flushed = SCR_FAILURE;
+/*
+=========================================
+Flush handoff files
+=========================================
+*/
+
+/* ids of datasets handed off at finalize, so the sync flush in
+ * SCR_Finalize knows not to redo them */
+static kvtree* scr_flush_async_handoff_ids = NULL;
+
+/* build path to this rank's handoff file for the given dataset,
+ * caller must free returned string */
+static char* scr_flush_async_handoff_name(int id)
+{
+  spath* path = spath_from_str(scr_cntl_prefix);
+  spath_append_strf(path, "handoff.%d.%d", id, scr_my_rank_world);
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* record the outstanding transfer for this rank in a handoff file
+ * in the control directory, so that the standalone scr_flush_handoff
+ * helper can finish the transfer if the job ends before we do */
+static int scr_flush_async_handoff_write(
+  int id,
+  const char* name,
+  int numfiles,
+  char** src_filelist,
+  char** dst_filelist)
+{
+  if (! scr_flush_handoff) {
+    return SCR_SUCCESS;
+  }
+
+  /* record dataset id and name along with the source and
+   * destination path of each file this rank has to move */
+  kvtree* hash = kvtree_new();
+  kvtree_util_set_int(hash, SCR_HANDOFF_KEY_DSET, id);
+  kvtree_util_set_str(hash, SCR_HANDOFF_KEY_NAME, name);
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    kvtree* file_hash = kvtree_set_kv(hash, SCR_HANDOFF_KEY_FILE, src_filelist[i]);
+    kvtree_util_set_str(file_hash, SCR_HANDOFF_KEY_DEST, dst_filelist[i]);
+  }
+
+  /* write the handoff file to the control directory */
+  char* file = scr_flush_async_handoff_name(id);
+  int rc = SCR_SUCCESS;
+  if (kvtree_write_file(file, hash) != KVTREE_SUCCESS) {
+    scr_err("Failed to write flush handoff file %s @ %s:%d",
+      file, __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+  scr_free(&file);
+  kvtree_delete(&hash);
+
+  return rc;
+}
+
+/* remove the handoff file for the given dataset, called once the
+ * library itself completes or abandons the transfer */
+static void scr_flush_async_handoff_clear(int id)
+{
+  if (! scr_flush_handoff) {
+    return;
+  }
+  char* file = scr_flush_async_handoff_name(id);
+  scr_file_unlink(file);
+  scr_free(&file);
+}
 
 /*
 =========================================
@@ -162,6 +247,547 @@ static int scr_axl_wait(const char* name, MPI_Comm comm)
   return rc;
 }
 
+/* cancel an outstanding transfer and release its handle, the wait
+ * after the cancel is required to quiesce the handle before it can
+ * be freed */
+static int scr_axl_cancel(const char* name, MPI_Comm comm)
+{
+  int rc = SCR_SUCCESS;
+
+  /* lookup AXL id in outstanding list */
+  int id;
+  kvtree* name_hash = kvtree_get_kv(scr_flush_async_axl_list, FILO_KEY_OUT_NAME, name);
+  if (kvtree_util_get_int(name_hash, FILO_KEY_OUT_AXL, &id) == KVTREE_SUCCESS) {
+    if (AXL_Cancel_comm(id, comm) != AXL_SUCCESS) {
+      scr_err("Failed to cancel AXL transfer handle %d @ %s:%d",
+        id, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+
+    /* a cancelled transfer reports failure from its wait, that is expected */
+    AXL_Wait_comm(id, comm);
+
+    /* release the handle */
+    if (AXL_Free_comm(id, comm) != AXL_SUCCESS) {
+      scr_err("Failed to free AXL transfer handle %d @ %s:%d",
+        id, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+
+    /* delete entry for this transfer from AXL list */
+    kvtree_unset_kv(scr_flush_async_axl_list, FILO_KEY_OUT_NAME, name);
+  } else {
+    /* failed to lookup id */
+    rc = SCR_FAILURE;
+  }
+
+  return rc;
+}
+
+/*
+=========================================
+Resume support for interrupted flushes
+=========================================
+*/
+
+/* compute the crc32 of count bytes of the given file starting at
+ * offset, reading through buf, folds the bytes into the value in crc */
+static int scr_flush_async_crc_chunk(
+  const char* file,
+  int fd,
+  off_t offset,
+  unsigned long count,
+  char* buf,
+  size_t buf_size,
+  uLong* crc)
+{
+  /* seek to the start of the chunk */
+  if (lseek(fd, offset, SEEK_SET) == (off_t) -1) {
+    scr_err("Failed to seek to %lu in %s (errno=%d %s) @ %s:%d",
+      (unsigned long) offset, file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* read the chunk through our buffer, updating the crc as we go */
+  while (count > 0) {
+    size_t amount = (count > buf_size) ? buf_size : (size_t) count;
+    ssize_t nread = scr_read_attempt(file, fd, buf, amount);
+    if (nread <= 0 || (size_t) nread != amount) {
+      /* hit an error or the file is shorter than expected */
+      return SCR_FAILURE;
+    }
+    *crc = scr_crc_update(*crc, buf, (size_t) nread);
+    count -= (unsigned long) nread;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* attempt to resume a file that an earlier interrupted flush left
+ * partially written at its destination, verifies the partial file
+ * chunk by chunk against per-chunk crc32 markers recorded in the
+ * file's meta data, computing and recording any markers that are
+ * missing from the cached source file, then copies only the bytes
+ * beyond the last verified chunk, sets resumed to 1 if the
+ * destination file is complete when this call returns */
+static int scr_flush_async_resume_file(
+  const char* src,
+  const char* dst,
+  scr_meta* meta,
+  int* resumed)
+{
+  *resumed = 0;
+
+  /* we need the file size to know when the destination is complete */
+  unsigned long filesize = 0;
+  if (scr_meta_get_filesize(meta, &filesize) != SCR_SUCCESS) {
+    return SCR_SUCCESS;
+  }
+
+  /* use the chunk size recorded with any existing markers so that
+   * a changed setting does not silently invalidate them */
+  unsigned long chunk_size = scr_flush_chunk_size;
+  scr_meta_get_chunk_size(meta, &chunk_size);
+  if (chunk_size == 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* look for a partial file at the final destination, and failing
+   * that, at the temporary name AXL uses before its rename */
+  char partial[SCR_MAX_FILENAME];
+  snprintf(partial, sizeof(partial), "%s", dst);
+  if (scr_file_is_readable(partial) != SCR_SUCCESS) {
+    snprintf(partial, sizeof(partial), "%s._AXL", dst);
+    if (scr_file_is_readable(partial) != SCR_SUCCESS) {
+      /* no partial file, nothing to resume */
+      return SCR_SUCCESS;
+    }
+  }
+  unsigned long partial_size = scr_file_size(partial);
+
+  /* open source for reading and partial file for reading and writing */
+  int src_fd = scr_open(src, O_RDONLY);
+  if (src_fd < 0) {
+    scr_err("Failed to open source file to resume flush %s @ %s:%d",
+      src, __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+  int dst_fd = scr_open(partial, O_RDWR);
+  if (dst_fd < 0) {
+    scr_err("Failed to open partial file to resume flush %s @ %s:%d",
+      partial, __FILE__, __LINE__
+    );
+    scr_close_nofsync(src, src_fd);
+    return SCR_FAILURE;
+  }
+
+  /* allocate a buffer to carry file data */
+  size_t buf_size = scr_file_buf_size;
+  char* buf = (char*) scr_buf_get(buf_size);
+
+  int rc = SCR_SUCCESS;
+
+  /* verify the partial file chunk by chunk until we hit a mismatch,
+   * an incomplete trailing chunk, or the end of the file */
+  unsigned long verified = 0;
+  int chunk = 0;
+  while (verified < filesize) {
+    /* determine the number of bytes in this chunk */
+    unsigned long this_chunk = filesize - verified;
+    if (this_chunk > chunk_size) {
+      this_chunk = chunk_size;
+    }
+
+    /* we can only verify chunks the partial file holds in full */
+    if (partial_size < verified + this_chunk) {
+      break;
+    }
+
+    /* get the crc of this chunk of the source file, using the
+     * recorded marker if we have one, and computing and recording
+     * it from the cached source otherwise */
+    uLong crc_src;
+    if (scr_meta_get_chunk_crc32(meta, chunk, &crc_src) != SCR_SUCCESS) {
+      crc_src = scr_crc_init();
+      if (scr_flush_async_crc_chunk(src, src_fd, (off_t) verified, this_chunk,
+          buf, buf_size, &crc_src) != SCR_SUCCESS)
+      {
+        rc = SCR_FAILURE;
+        break;
+      }
+      scr_meta_set_chunk_crc32(meta, chunk, crc_src);
+    }
+
+    /* compute the crc of the corresponding chunk of the partial file */
+    uLong crc_dst = scr_crc_init();
+    if (scr_flush_async_crc_chunk(partial, dst_fd, (off_t) verified, this_chunk,
+        buf, buf_size, &crc_dst) != SCR_SUCCESS)
+    {
+      rc = SCR_FAILURE;
+      break;
+    }
+
+    /* stop at the first chunk that does not match */
+    if (crc_src != crc_dst) {
+      break;
+    }
+
+    verified += this_chunk;
+    chunk++;
+  }
+
+  /* if we could not verify anything, drop the partial file and
+   * let the transfer resend it in full */
+  if (rc != SCR_SUCCESS || verified == 0) {
+    scr_buf_put(buf);
+    scr_close_nofsync(src, src_fd);
+    scr_close_nofsync(partial, dst_fd);
+    if (rc == SCR_SUCCESS) {
+      scr_file_unlink(partial);
+    }
+    return rc;
+  }
+
+  /* throw away any unverified tail of the partial file */
+  if (ftruncate(dst_fd, (off_t) verified) != 0) {
+    scr_err("Failed to truncate partial file %s (errno=%d %s) @ %s:%d",
+      partial, errno, strerror(errno), __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+
+  /* position both files at the end of the verified prefix */
+  if (rc == SCR_SUCCESS &&
+      (lseek(src_fd, (off_t) verified, SEEK_SET) == (off_t) -1 ||
+       lseek(dst_fd, (off_t) verified, SEEK_SET) == (off_t) -1))
+  {
+    scr_err("Failed to seek to resume offset %lu for %s @ %s:%d",
+      verified, dst, __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+
+  /* copy the remaining bytes, recording chunk markers as we go in
+   * case this attempt is interrupted as well, reads are kept within
+   * chunk boundaries so the markers line up */
+  unsigned long offset = verified;
+  unsigned long chunk_bytes = 0;
+  uLong crc = scr_crc_init();
+  while (rc == SCR_SUCCESS && offset < filesize) {
+    size_t amount = buf_size;
+    if (amount > filesize - offset) {
+      amount = (size_t) (filesize - offset);
+    }
+    if (amount > chunk_size - chunk_bytes) {
+      amount = (size_t) (chunk_size - chunk_bytes);
+    }
+
+    ssize_t nread = scr_read_attempt(src, src_fd, buf, amount);
+    if (nread <= 0 || (size_t) nread != amount) {
+      scr_err("Failed to read source file to resume flush %s @ %s:%d",
+        src, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+      break;
+    }
+    if (scr_write_attempt(partial, dst_fd, buf, (size_t) nread) != nread) {
+      scr_err("Failed to write partial file to resume flush %s @ %s:%d",
+        partial, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+      break;
+    }
+
+    crc = scr_crc_update(crc, buf, (size_t) nread);
+    chunk_bytes += (unsigned long) nread;
+    offset += (unsigned long) nread;
+
+    /* record a marker at each chunk boundary and at the end of the file */
+    if (chunk_bytes == chunk_size || offset == filesize) {
+      scr_meta_set_chunk_crc32(meta, chunk, crc);
+      chunk++;
+      chunk_bytes = 0;
+      crc = scr_crc_init();
+    }
+  }
+
+  /* record the chunk size alongside the markers */
+  scr_meta_set_chunk_size(meta, chunk_size);
+
+  scr_buf_put(buf);
+  scr_close_nofsync(src, src_fd);
+
+  /* make sure resumed bytes are down before we report the file complete */
+  if (scr_close(partial, dst_fd) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  if (rc != SCR_SUCCESS) {
+    return SCR_FAILURE;
+  }
+
+  /* if we completed the file at the temporary name, move it into place */
+  if (strcmp(partial, dst) != 0) {
+    if (rename(partial, dst) != 0) {
+      scr_err("Failed to rename resumed file %s to %s (errno=%d %s) @ %s:%d",
+        partial, dst, errno, strerror(errno), __FILE__, __LINE__
+      );
+      return SCR_FAILURE;
+    }
+  }
+
+  *resumed = 1;
+  return SCR_SUCCESS;
+}
+
+/* scan the file lists for files that an earlier interrupted flush
+ * left partially written at the destination, complete any such file
+ * from its last verified chunk, and remove it from the lists so it
+ * is not handed to AXL, persists updated chunk markers back to the
+ * filemap so a later retry can pick up where this one leaves off */
+static int scr_flush_async_resume(
+  scr_cache_index* cindex,
+  int id,
+  int* numfiles_p,
+  char** src_filelist,
+  char** dst_filelist)
+{
+  /* read our filemap so we can persist updated chunk markers */
+  scr_filemap* map = scr_filemap_new();
+  scr_cache_get_map(cindex, id, map);
+
+  int numfiles = *numfiles_p;
+  int count = 0;
+  int resumes = 0;
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    int resumed = 0;
+    scr_meta* meta = scr_meta_new();
+    if (scr_filemap_get_meta(map, src_filelist[i], meta) == SCR_SUCCESS) {
+      scr_flush_async_resume_file(src_filelist[i], dst_filelist[i], meta, &resumed);
+      scr_filemap_set_meta(map, src_filelist[i], meta);
+    }
+    scr_meta_delete(&meta);
+
+    if (resumed) {
+      /* file is already complete at its destination,
+       * drop it from the list we hand to AXL */
+      scr_free(&src_filelist[i]);
+      scr_free(&dst_filelist[i]);
+      resumes++;
+    } else {
+      src_filelist[count] = src_filelist[i];
+      dst_filelist[count] = dst_filelist[i];
+      count++;
+    }
+  }
+  *numfiles_p = count;
+
+  /* save updated chunk markers so the next retry can use them */
+  scr_cache_set_map(cindex, id, map);
+  scr_filemap_delete(&map);
+
+  if (resumes > 0) {
+    scr_dbg(1, "Resumed %d file(s) from earlier interrupted flush of dataset %d",
+      resumes, id
+    );
+  }
+
+  return SCR_SUCCESS;
+}
+
+/*
+=========================================
+Stall detection and transfer restart
+=========================================
+*/
+
+/* sum the bytes this rank has landed at the destination and the total
+ * bytes it has to move for one outstanding dataset, AXL moves data
+ * through a temporary file before renaming it into place so we check
+ * the temporary name when the final name is not there yet */
+static void scr_flush_async_bytes_state(const kvtree* state, double* landed, double* total)
+{
+  *landed = 0.0;
+  *total  = 0.0;
+
+  /* walk the file list for this dataset */
+  kvtree* file_list = kvtree_get((kvtree*) state, SCR_FLUSH_ASYNC_KEY_FILES);
+  int numfiles;
+  char** src_filelist;
+  char** dst_filelist;
+  scr_flush_list_alloc(file_list, &numfiles, &src_filelist, &dst_filelist);
+
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    /* count the full source size against the total */
+    unsigned long src_size = scr_file_size(src_filelist[i]);
+    *total += (double) src_size;
+
+    /* measure bytes that have landed at the destination */
+    unsigned long dst_size = scr_file_size(dst_filelist[i]);
+    if (dst_size == 0) {
+      char tmp[SCR_MAX_FILENAME];
+      snprintf(tmp, sizeof(tmp), "%s._AXL", dst_filelist[i]);
+      dst_size = scr_file_size(tmp);
+    }
+    if (dst_size > src_size) {
+      dst_size = src_size;
+    }
+    *landed += (double) dst_size;
+  }
+
+  scr_flush_list_free(numfiles, &src_filelist, &dst_filelist);
+}
+
+/* check whether the transfer for this dataset has made byte progress
+ * within the stall window, updates the tracking fields in the dataset
+ * state, returns 1 if the transfer is stalled, this is a collective
+ * call and all ranks return the same value */
+static int scr_flush_async_stalled(int id)
+{
+  /* the monitor is disabled unless a stall window is set */
+  if (scr_flush_async_stall_secs <= 0) {
+    return 0;
+  }
+
+  /* lookup state for this dataset */
+  kvtree* state = scr_flush_async_state(id);
+  if (state == NULL) {
+    return 0;
+  }
+
+  /* sum bytes landed at the destination across all ranks */
+  double landed, total;
+  scr_flush_async_bytes_state(state, &landed, &total);
+  double bytes = 0.0;
+  MPI_Reduce(&landed, &bytes, 1, MPI_DOUBLE, MPI_SUM, 0, scr_comm_world);
+
+  /* rank 0 tracks the last byte count and the time it last advanced,
+   * and declares a stall when the count holds still for too long */
+  int stalled = 0;
+  if (scr_my_rank_world == 0) {
+    double now = MPI_Wtime();
+
+    double last_bytes = 0.0;
+    double last_prog  = 0.0;
+    kvtree_util_get_double(state, SCR_FLUSH_ASYNC_KEY_BYTES,    &last_bytes);
+    kvtree_util_get_double(state, SCR_FLUSH_ASYNC_KEY_PROGRESS, &last_prog);
+
+    if (bytes > last_bytes) {
+      /* transfer is moving, remember where and when */
+      kvtree_util_set_double(state, SCR_FLUSH_ASYNC_KEY_BYTES,    bytes);
+      kvtree_util_set_double(state, SCR_FLUSH_ASYNC_KEY_PROGRESS, now);
+    } else if (now - last_prog > (double) scr_flush_async_stall_secs) {
+      stalled = 1;
+    }
+  }
+
+  /* all ranks must agree on the verdict */
+  MPI_Bcast(&stalled, 1, MPI_INT, 0, scr_comm_world);
+
+  return stalled;
+}
+
+/* cancel the transfer for a dataset that has stopped making progress
+ * and restart it, the first attempts re-dispatch through AXL, reusing
+ * bytes already landed via the resume machinery, once the restart
+ * budget is spent we tear down the async state and fall back to a
+ * synchronous flush, which writes through a code path independent of
+ * AXL and bounds the delay even if AXL itself is wedged */
+static int scr_flush_async_restart(scr_cache_index* cindex, int id)
+{
+  /* get the dataset corresponding to this id */
+  scr_dataset* dataset = scr_dataset_new();
+  scr_cache_index_get_dataset(cindex, id, dataset);
+
+  /* lookup dataset name */
+  char* dset_name = NULL;
+  scr_dataset_get_name(dataset, &dset_name);
+
+  /* lookup state for this dataset */
+  kvtree* state = scr_flush_async_state(id);
+
+  /* count how many times we've already restarted this flush */
+  int restarts = 0;
+  kvtree_util_get_int(state, SCR_FLUSH_ASYNC_KEY_RESTARTS, &restarts);
+  int fallback = (restarts >= SCR_FLUSH_ASYNC_MAX_RESTARTS);
+
+  /* a silent hang just became a visible event, tell the user and the log */
+  if (scr_my_rank_world == 0) {
+    scr_err("Async flush of dataset %d `%s' made no progress for %d secs, %s @ %s:%d",
+      id, dset_name, scr_flush_async_stall_secs,
+      fallback ? "falling back to sync flush" : "restarting transfer",
+      __FILE__, __LINE__
+    );
+    if (scr_log_enable) {
+      time_t now = scr_log_seconds();
+      scr_log_event("ASYNC_FLUSH_STALL",
+        fallback ? "Falling back to sync flush" : "Restarting transfer",
+        &id, dset_name, &now, NULL
+      );
+    }
+  }
+
+  /* cancel the wedged transfer and release its handle */
+  scr_axl_cancel(dset_name, scr_comm_world);
+
+  int rc = SCR_SUCCESS;
+  if (! fallback) {
+    /* rebuild the source and destination lists from the saved file list */
+    kvtree* file_list = kvtree_get(state, SCR_FLUSH_ASYNC_KEY_FILES);
+    int numfiles;
+    char** src_filelist;
+    char** dst_filelist;
+    scr_flush_list_alloc(file_list, &numfiles, &src_filelist, &dst_filelist);
+
+    /* complete files the cancelled attempt left partially written and
+     * drop finished files from the list we hand back to AXL */
+    scr_flush_async_resume(cindex, id, &numfiles, src_filelist, dst_filelist);
+
+    /* re-dispatch with the same transfer type as the original attempt */
+    const scr_storedesc* storedesc = scr_cache_get_storedesc(cindex, id);
+    axl_xfer_t xfer_type = axl_xfer_str_to_type(storedesc->type);
+    if (scr_axl_start(dset_name, numfiles, src_filelist, dst_filelist,
+      xfer_type, scr_comm_world) != SCR_SUCCESS)
+    {
+      /* failed to restart, record the failure so complete reports it */
+      kvtree_util_set_int(state, SCR_FLUSH_ASYNC_KEY_FLUSHED, SCR_FAILURE);
+      rc = SCR_FAILURE;
+    }
+
+    /* charge this restart against the budget and reset the stall clock */
+    kvtree_util_set_int(state, SCR_FLUSH_ASYNC_KEY_RESTARTS, restarts + 1);
+    if (scr_my_rank_world == 0) {
+      kvtree_util_set_double(state, SCR_FLUSH_ASYNC_KEY_PROGRESS, MPI_Wtime());
+    }
+
+    /* free our file list */
+    scr_flush_list_free(numfiles, &src_filelist, &dst_filelist);
+  } else {
+    /* drop the async state for this dataset so the sync flush below
+     * does not wait on the flush we just cancelled */
+    if (scr_flush_async_in_progress > 0) {
+      scr_flush_async_in_progress--;
+    }
+    scr_flush_file_location_unset(id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
+    kvtree_unset_kv_int(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET, id);
+
+    /* flush the dataset synchronously,
+     * this completes the flush bookkeeping as well */
+    rc = scr_flush_sync(cindex, id);
+  }
+
+  /* free the dataset */
+  scr_dataset_delete(&dataset);
+
+  return rc;
+}
+
 /* stop all ongoing asynchronous flush operations */
 int scr_flush_async_stop()
 {
@@ -186,9 +812,21 @@ int scr_flush_async_stop()
   scr_flush_file_location_unset(id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
   */
 
-  /* clear internal flush_async variables to indicate there is no flush */
-  kvtree_delete(&scr_flush_async_file_list);
-  scr_free(&scr_flush_async_rankfile);
+  /* drop handoff files for the stopped transfers, a stopped flush
+   * is redone by the library rather than finished by the helper */
+  if (scr_flush_handoff) {
+    kvtree* dsets = kvtree_get(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET);
+    kvtree_elem* elem;
+    for (elem = kvtree_elem_first(dsets);
+         elem != NULL;
+         elem = kvtree_elem_next(elem))
+    {
+      scr_flush_async_handoff_clear(kvtree_elem_key_int(elem));
+    }
+  }
+
+  /* drop state for all outstanding flushes to indicate there is no flush */
+  kvtree_unset(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET);
 
   /* make sure all processes have made it this far before we leave */
   MPI_Barrier(scr_comm_world);
@@ -226,42 +864,47 @@ int scr_flush_async_start(scr_cache_index* cindex, int id)
   MPI_Barrier(scr_comm_world);
 
   /* start timer */
+  time_t timestamp_start = scr_log_seconds();
+  double time_start = MPI_Wtime();
   if (scr_my_rank_world == 0) {
-    scr_flush_async_timestamp_start = scr_log_seconds();
-    scr_flush_async_time_start = MPI_Wtime();
-
     /* log the start of the flush */
     if (scr_log_enable) {
       scr_log_event("ASYNC_FLUSH_START", NULL, &id, dset_name,
-                    &scr_flush_async_timestamp_start, NULL);
+                    &timestamp_start, NULL);
     }
   }
 
-  /* mark that we've started a flush */
-  scr_flush_async_in_progress = 1;
+  /* note whether an earlier run left this dataset mid-flush before
+   * we mark it as flushing again, if so the destination may hold
+   * partial files that we can resume */
+  int interrupted = scr_flush_file_is_flushing(id);
+
+  /* mark that we've started another flush */
+  scr_flush_async_in_progress++;
   scr_flush_async_dataset_id = id;
   scr_flush_file_location_set(id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
 
   /* this flag will remember whether any stage fails */
-  scr_flush_async_flushed = SCR_SUCCESS;
+  int flushed = SCR_SUCCESS;
 
   /* get list of files to flush */
-  scr_flush_async_file_list = kvtree_new();
-  if (scr_flush_prepare(cindex, id, scr_flush_async_file_list) != SCR_SUCCESS) {
+  kvtree* file_list = kvtree_new();
+  if (scr_flush_prepare(cindex, id, file_list) != SCR_SUCCESS) {
     if (scr_my_rank_world == 0) {
       scr_err("scr_flush_async_start: Failed to prepare flush @ %s:%d",
         __FILE__, __LINE__
       );
       if (scr_log_enable) {
         double time_end = MPI_Wtime();
-        double time_diff = time_end - scr_flush_async_time_start;
+        double time_diff = time_end - time_start;
         scr_log_event("ASYNC_FLUSH_FAIL", "Failed to prepare flush",
                       &id, dset_name, NULL, &time_diff);
       }
     }
     scr_dataset_delete(&dataset);
-    kvtree_delete(&scr_flush_async_file_list);
-    scr_flush_async_flushed = SCR_FAILURE;
+    kvtree_delete(&file_list);
+    scr_flush_async_in_progress--;
+    scr_flush_file_location_unset(id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
     return SCR_FAILURE;
   }
 
@@ -269,7 +912,7 @@ int scr_flush_async_start(scr_cache_index* cindex, int id)
   int numfiles;
   char** src_filelist;
   char** dst_filelist;
-  scr_flush_list_alloc(scr_flush_async_file_list, &numfiles, &src_filelist, &dst_filelist);
+  scr_flush_list_alloc(file_list, &numfiles, &src_filelist, &dst_filelist);
 
   /* create entry in index file to indicate that dataset may exist,
    * but is not yet complete */
@@ -296,7 +939,7 @@ int scr_flush_async_start(scr_cache_index* cindex, int id)
 
   /* define path for rank2file map */
   spath_append_str(dataset_path, "rank2file");
-  scr_flush_async_rankfile = spath_strdup(dataset_path);
+  char* rankfile = spath_strdup(dataset_path);
   spath_delete(&dataset_path);
 
   /* build a list of files for this rank */
@@ -321,7 +964,7 @@ int scr_flush_async_start(scr_cache_index* cindex, int id)
   }
 
   /* save our file list to disk */
-  kvtree_write_gather(scr_flush_async_rankfile, filelist, scr_comm_world);
+  scr_summary_write_rank2file(rankfile, filelist, scr_comm_world);
   kvtree_delete(&filelist);
 
   /* get AXL transfer type to use */
@@ -336,6 +979,13 @@ int scr_flush_async_start(scr_cache_index* cindex, int id)
   /* create directories */
   scr_flush_create_dirs(scr_prefix, numfiles, dst_filelist, scr_comm_world);
 
+  /* if an earlier run was interrupted mid-flush, complete any
+   * partially written files from their last verified chunk and
+   * drop them from the list to be transferred */
+  if (interrupted) {
+    scr_flush_async_resume(cindex, id, &numfiles, src_filelist, dst_filelist);
+  }
+
   /* start writing files via AXL */
   int rc = SCR_SUCCESS;
   if (scr_axl_start(dset_name, numfiles, src_filelist, dst_filelist,
@@ -344,9 +994,28 @@ int scr_flush_async_start(scr_cache_index* cindex, int id)
     /* failed to initiate AXL transfer */
     /* TODO: auto delete files? */
     rc = SCR_FAILURE;
-    scr_flush_async_flushed = SCR_FAILURE;
+    flushed = SCR_FAILURE;
+  }
+
+  /* record this rank's transfer in a handoff file so the standalone
+   * helper can finish it if the job ends before we do */
+  if (rc == SCR_SUCCESS) {
+    scr_flush_async_handoff_write(id, dset_name, numfiles, src_filelist, dst_filelist);
   }
 
+  /* record state for this dataset so that flushes of multiple
+   * datasets can be outstanding at the same time */
+  kvtree* state = kvtree_set_kv_int(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET, id);
+  kvtree_util_set_str(state, SCR_FLUSH_ASYNC_KEY_RANKFILE, rankfile);
+  kvtree_util_set_int(state, SCR_FLUSH_ASYNC_KEY_FLUSHED, flushed);
+  kvtree_util_set_unsigned_long(state, SCR_FLUSH_ASYNC_KEY_TIMESTAMP, (unsigned long) timestamp_start);
+  kvtree_util_set_double(state, SCR_FLUSH_ASYNC_KEY_TIME, time_start);
+  kvtree_util_set_double(state, SCR_FLUSH_ASYNC_KEY_BYTES, 0.0);
+  kvtree_util_set_double(state, SCR_FLUSH_ASYNC_KEY_PROGRESS, time_start);
+  kvtree_util_set_int(state, SCR_FLUSH_ASYNC_KEY_RESTARTS, 0);
+  kvtree_set(state, SCR_FLUSH_ASYNC_KEY_FILES, file_list);
+  scr_free(&rankfile);
+
   /* free our file list */
   scr_flush_list_free(numfiles, &src_filelist, &dst_filelist);
 
@@ -367,7 +1036,10 @@ int scr_flush_async_test(scr_cache_index* cindex, int id)
   }
 
   /* if the transfer failed, indicate that transfer has completed */
-  if (scr_flush_async_flushed != SCR_SUCCESS) {
+  int flushed = SCR_SUCCESS;
+  kvtree* state = scr_flush_async_state(id);
+  kvtree_util_get_int(state, SCR_FLUSH_ASYNC_KEY_FLUSHED, &flushed);
+  if (flushed != SCR_SUCCESS) {
     return SCR_SUCCESS;
   }
 
@@ -411,26 +1083,46 @@ int scr_flush_async_complete(scr_cache_index* cindex, int id)
     scr_dbg(1, "Completing flush of dataset %d %s @ %s:%d", id, dset_name, __FILE__, __LINE__);
   }
 
+  /* lookup state for this dataset */
+  kvtree* state = scr_flush_async_state(id);
+
+  /* get result of the stages executed so far */
+  int flushed = SCR_SUCCESS;
+  kvtree_util_get_int(state, SCR_FLUSH_ASYNC_KEY_FLUSHED, &flushed);
+
+  /* lookup time at which this flush was started */
+  double time_start = 0.0;
+  unsigned long timestamp_ul = 0;
+  kvtree_util_get_double(state, SCR_FLUSH_ASYNC_KEY_TIME, &time_start);
+  kvtree_util_get_unsigned_long(state, SCR_FLUSH_ASYNC_KEY_TIMESTAMP, &timestamp_ul);
+  time_t timestamp_start = (time_t) timestamp_ul;
+
   /* TODO: wait on Filo if we failed to start? */
   /* wait for transfer to complete */
   if (scr_axl_wait(dset_name, scr_comm_world) != SCR_SUCCESS) {
-    scr_flush_async_flushed = SCR_FAILURE;
+    flushed = SCR_FAILURE;
   }
 
   /* write summary file */
-  if (scr_flush_async_flushed == SCR_SUCCESS &&
-      scr_flush_complete(cindex, id, scr_flush_async_file_list) != SCR_SUCCESS)
+  kvtree* file_list = kvtree_get(state, SCR_FLUSH_ASYNC_KEY_FILES);
+  if (flushed == SCR_SUCCESS &&
+      scr_flush_complete(cindex, id, file_list) != SCR_SUCCESS)
   {
-    scr_flush_async_flushed = SCR_FAILURE;
+    flushed = SCR_FAILURE;
   }
 
-  /* mark that we've stopped the flush */
-  scr_flush_async_in_progress = 0;
+  /* mark that we've stopped this flush */
+  if (scr_flush_async_in_progress > 0) {
+    scr_flush_async_in_progress--;
+  }
   scr_flush_file_location_unset(id, SCR_FLUSH_KEY_LOCATION_FLUSHING);
 
-  /* free the file list for this checkpoint */
-  kvtree_delete(&scr_flush_async_file_list);
-  scr_free(&scr_flush_async_rankfile);
+  /* the library handled this transfer itself,
+   * so drop its handoff file */
+  scr_flush_async_handoff_clear(id);
+
+  /* drop the state for this dataset, this frees its file list */
+  kvtree_unset_kv_int(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET, id);
 
   /* stop timer, compute bandwidth, and report performance */
   if (scr_my_rank_world == 0) {
@@ -454,7 +1146,7 @@ int scr_flush_async_complete(scr_cache_index* cindex, int id)
 
     /* stop timer and compute bandwidth */
     double time_end = MPI_Wtime();
-    double time_diff = time_end - scr_flush_async_time_start;
+    double time_diff = time_end - time_start;
     double bw = 0.0;
     if (time_diff > 0.0) {
       bw = scr_flush_async_bytes / (1024.0 * 1024.0 * time_diff);
@@ -464,7 +1156,7 @@ int scr_flush_async_complete(scr_cache_index* cindex, int id)
     );
 
     /* log messages about flush */
-    if (scr_flush_async_flushed == SCR_SUCCESS) {
+    if (flushed == SCR_SUCCESS) {
       /* the flush worked, print a debug message */
       scr_dbg(1, "scr_flush_async_complete: Flush of dataset succeeded %d `%s'", id, dset_name);
 
@@ -487,7 +1179,7 @@ int scr_flush_async_complete(scr_cache_index* cindex, int id)
       char* dir = NULL;
       scr_cache_index_get_dir(cindex, id, &dir);
       scr_log_transfer("FLUSH_ASYNC", dir, scr_prefix, &id, dset_name,
-        &scr_flush_async_timestamp_start, &time_diff, &total_bytes, &total_files
+        &timestamp_start, &time_diff, &total_bytes, &total_files
       );
     }
   }
@@ -495,27 +1187,220 @@ int scr_flush_async_complete(scr_cache_index* cindex, int id)
   /* free the dataset */
   scr_dataset_delete(&dataset);
 
-  return scr_flush_async_flushed;
+  return flushed;
+}
+
+/* get ids of all outstanding flushes, caller must free list with scr_free,
+ * we copy ids into an array since completing a flush drops its state entry */
+static void scr_flush_async_ids(int* num_out, int** ids_out)
+{
+  int num = kvtree_size(kvtree_get(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET));
+  int* ids = (int*) SCR_MALLOC(num * sizeof(int));
+
+  int i = 0;
+  kvtree_elem* elem;
+  kvtree* dsets = kvtree_get(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET);
+  for (elem = kvtree_elem_first(dsets);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    ids[i] = kvtree_elem_key_int(elem);
+    i++;
+  }
+
+  *num_out = num;
+  *ids_out = ids;
+}
+
+/* check each outstanding flush, and complete those that have finished,
+ * returns SCR_FAILURE if any completed flush failed */
+int scr_flush_async_progress(scr_cache_index* cindex)
+{
+  int rc = SCR_SUCCESS;
+
+  /* get ids of all outstanding flushes */
+  int num;
+  int* ids;
+  scr_flush_async_ids(&num, &ids);
+
+  /* complete each dataset whose transfer has finished */
+  int i;
+  for (i = 0; i < num; i++) {
+    int id = ids[i];
+    if (scr_flush_async_test(cindex, id) == SCR_SUCCESS) {
+      if (scr_flush_async_complete(cindex, id) != SCR_SUCCESS) {
+        rc = SCR_FAILURE;
+      }
+    } else if (scr_flush_async_stalled(id)) {
+      /* transfer has stopped moving, cancel and restart it */
+      if (scr_flush_async_restart(cindex, id) != SCR_SUCCESS) {
+        rc = SCR_FAILURE;
+      }
+    }
+  }
+
+  scr_free(&ids);
+
+  return rc;
+}
+
+/* report progress of outstanding flushes, sums the bytes written so
+ * far and the total bytes to be written across all ranks and all
+ * outstanding datasets, and estimates the seconds remaining from the
+ * transfer rate so far, the estimate is -1 until some bytes have
+ * moved, all values are zero if no flush is outstanding, this is a
+ * collective call */
+int scr_flush_async_progress_info(
+  double* bytes_xferd,
+  double* bytes_total,
+  double* secs_remain)
+{
+  *bytes_xferd = 0.0;
+  *bytes_total = 0.0;
+  *secs_remain = 0.0;
+
+  /* add up source and destination bytes for each outstanding dataset */
+  double send[2] = {0.0, 0.0};
+  double time_start = 0.0;
+  kvtree_elem* elem;
+  kvtree* dsets = kvtree_get(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET);
+  for (elem = kvtree_elem_first(dsets);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    kvtree* state = kvtree_elem_hash(elem);
+
+    /* remember the start time of the oldest outstanding flush */
+    double start = 0.0;
+    kvtree_util_get_double(state, SCR_FLUSH_ASYNC_KEY_TIME, &start);
+    if (time_start == 0.0 || start < time_start) {
+      time_start = start;
+    }
+
+    /* add up bytes landed and bytes to move for this dataset */
+    double landed, total;
+    scr_flush_async_bytes_state(state, &landed, &total);
+    send[0] += landed;
+    send[1] += total;
+  }
+
+  /* sum progress across all ranks */
+  double recv[2];
+  MPI_Allreduce(send, recv, 2, MPI_DOUBLE, MPI_SUM, scr_comm_world);
+  *bytes_xferd = recv[0];
+  *bytes_total = recv[1];
+
+  /* estimate seconds remaining from the rate so far,
+   * we can't predict the rate before any bytes have moved */
+  double remaining = recv[1] - recv[0];
+  if (remaining > 0.0) {
+    *secs_remain = -1.0;
+    if (recv[0] > 0.0 && time_start > 0.0) {
+      double elapsed = MPI_Wtime() - time_start;
+      if (elapsed > 0.0) {
+        *secs_remain = remaining * elapsed / recv[0];
+      }
+    }
+  }
+
+  return SCR_SUCCESS;
 }
 
-/* wait until the checkpoint currently being flushed completes */
+/* wait until all datasets currently being flushed complete */
 int scr_flush_async_wait(scr_cache_index* cindex)
 {
-  if (scr_flush_async_in_progress) {
-    while (scr_flush_file_is_flushing(scr_flush_async_dataset_id)) {
+  /* get ids of all outstanding flushes */
+  int num;
+  int* ids;
+  scr_flush_async_ids(&num, &ids);
+
+  /* wait on each outstanding dataset in turn */
+  int i;
+  for (i = 0; i < num; i++) {
+    int id = ids[i];
+    while (scr_flush_file_is_flushing(id)) {
       /* test whether the flush has completed, and if so complete the flush */
-      if (scr_flush_async_test(cindex, scr_flush_async_dataset_id) == SCR_SUCCESS) {
+      if (scr_flush_async_test(cindex, id) == SCR_SUCCESS) {
         /* complete the flush */
-        scr_flush_async_complete(cindex, scr_flush_async_dataset_id);
+        scr_flush_async_complete(cindex, id);
+      } else if (scr_flush_async_stalled(id)) {
+        /* transfer has stopped moving, cancel and restart it */
+        scr_flush_async_restart(cindex, id);
       } else {
         /* otherwise, sleep to get out of the way */
         usleep(10*1000*1000);
       }
     }
   }
+
+  scr_free(&ids);
+
   return SCR_SUCCESS;
 }
 
+/* hand all outstanding flushes off to the standalone
+ * scr_flush_handoff helper, stops the AXL transfer threads but
+ * leaves the handoff files and the FLUSHING markers in the flush
+ * file in place so the helper and the scavenge machinery can finish
+ * and index the datasets outside of MPI, called from SCR_Finalize
+ * when SCR_FLUSH_HANDOFF is set */
+int scr_flush_async_handoff(void)
+{
+  /* if user has disabled flush, return failure */
+  if (scr_flush <= 0) {
+    return SCR_FAILURE;
+  }
+
+  /* nothing to hand off if no flush is outstanding */
+  if (! scr_flush_async_in_progress) {
+    return SCR_SUCCESS;
+  }
+
+  /* this changes how the job ends, so tell user what we're doing */
+  if (scr_my_rank_world == 0) {
+    scr_dbg(1, "Handing off outstanding flush to scr_flush_handoff");
+  }
+
+  /* halt the transfer threads, partially written files stay at
+   * their temporary names for the helper to complete */
+  if (AXL_Stop_comm(scr_comm_world) != AXL_SUCCESS) {
+    return SCR_FAILURE;
+  }
+
+  /* remember which datasets we handed off so the sync flush in
+   * SCR_Finalize does not redo them */
+  if (scr_flush_async_handoff_ids == NULL) {
+    scr_flush_async_handoff_ids = kvtree_new();
+  }
+  kvtree* dsets = kvtree_get(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET);
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(dsets);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    int id = kvtree_elem_key_int(elem);
+    kvtree_set_kv_int(scr_flush_async_handoff_ids, SCR_FLUSH_ASYNC_KEY_DSET, id);
+  }
+
+  /* drop in-library state, the handoff files and the FLUSHING
+   * markers stay behind on purpose */
+  scr_flush_async_in_progress = 0;
+  kvtree_unset(scr_flush_async_datasets, SCR_FLUSH_ASYNC_KEY_DSET);
+
+  /* make sure all processes have made it this far before we leave */
+  MPI_Barrier(scr_comm_world);
+  return SCR_SUCCESS;
+}
+
+/* returns 1 if the given dataset was handed off at finalize */
+int scr_flush_async_is_handed_off(int id)
+{
+  if (scr_flush_async_handoff_ids == NULL) {
+    return 0;
+  }
+  return (kvtree_get_kv_int(scr_flush_async_handoff_ids, SCR_FLUSH_ASYNC_KEY_DSET, id) != NULL);
+}
+
 /* start any processes for later asynchronous flush operations */
 int scr_flush_async_init()
 {
@@ -525,6 +1410,7 @@ int scr_flush_async_init()
   }
 
   scr_flush_async_axl_list = kvtree_new();
+  scr_flush_async_datasets = kvtree_new();
 
   return SCR_SUCCESS;
 }
@@ -538,6 +1424,8 @@ int scr_flush_async_finalize()
   }
 
   kvtree_delete(&scr_flush_async_axl_list);
+  kvtree_delete(&scr_flush_async_datasets);
+  kvtree_delete(&scr_flush_async_handoff_ids);
 
   return SCR_SUCCESS;
 }
@@ -26,9 +26,27 @@ int scr_flush_async_test(scr_cache_index* cindex, int id);
 /* complete the flush from cache to parallel file system */
 int scr_flush_async_complete(scr_cache_index* cindex, int id);
 
-/* wait until the checkpoint currently being flushed completes */
+/* check each outstanding flush, and complete those that have finished */
+int scr_flush_async_progress(scr_cache_index* cindex);
+
+/* report bytes written, total bytes, and estimated seconds remaining
+ * for all outstanding flushes, collective over scr_comm_world */
+int scr_flush_async_progress_info(
+  double* bytes_xferd,
+  double* bytes_total,
+  double* secs_remain
+);
+
+/* wait until all datasets currently being flushed complete */
 int scr_flush_async_wait(scr_cache_index* cindex);
 
+/* hand all outstanding flushes off to the standalone scr_flush_handoff
+ * helper, which finishes them outside of MPI */
+int scr_flush_async_handoff(void);
+
+/* returns 1 if the given dataset was handed off at finalize */
+int scr_flush_async_is_handed_off(int id);
+
 /* initialize the async transfer processes */
 int scr_flush_async_init(void);
 
@@ -17,6 +17,8 @@
 #include "scr_io.h"
 #include "scr_err.h"
 #include "scr_util.h"
+#include "scr_status.h"
+#include "scr_flush_file_io.h"
 
 #include "spath.h"
 #include "kvtree.h"
@@ -216,11 +218,45 @@ int main (int argc, char *argv[])
   /* assume we'll fail */
   int rc = 1;
 
+  /* for the common prejob queries, try the binary status file first,
+   * it answers with a single read instead of a kvtree parse, but only
+   * trust it if it's at least as new as the flush file */
+  if (args.latest || args.name != -1) {
+    spath* status_path = spath_from_str(args.dir);
+    spath_append_str(status_path, ".scr");
+    spath_append_str(status_path, SCR_STATUS_FILENAME);
+    char* status_file = spath_strdup(status_path);
+    spath_delete(&status_path);
+
+    scr_status status;
+    if (scr_status_fresh(status_file, file) == SCR_SUCCESS &&
+        scr_status_read(status_file, &status) == SCR_SUCCESS)
+    {
+      if (args.latest && status.dset_id != -1) {
+        /* print the latest dataset id and return success */
+        printf("%d\n", status.dset_id);
+        scr_free(&status_file);
+        scr_free(&file);
+        return 0;
+      }
+      if (args.name == status.ckpt_id && status.ckpt_name[0] != '\0') {
+        /* requested dataset is the latest checkpoint, print its name */
+        printf("%s\n", status.ckpt_name);
+        scr_free(&status_file);
+        scr_free(&file);
+        return 0;
+      }
+    }
+    scr_free(&status_file);
+
+    /* fall through to parse the flush file */
+  }
+
   /* create a new hash to hold the file data */
   kvtree* hash = kvtree_new();
 
   /* read in our flush file */
-  if (kvtree_read_file(file, hash) != KVTREE_SUCCESS) {
+  if (scr_flush_file_read(file, hash) != SCR_SUCCESS) {
     /* failed to read the flush file */
     goto cleanup;
   }
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Implements the seqlock-style read/write helpers for the flush file,
+ * see scr_flush_file_io.h for the protocol. */
+
+#include "scr.h"
+#include "scr_io.h"
+#include "scr_err.h"
+#include "scr_util.h"
+#include "scr_flush_file_io.h"
+
+#include "kvtree.h"
+#include "spath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* number of lock-free read attempts before falling back to the
+ * blocking read lock on the sequence file */
+#define SCR_FLUSH_FILE_READ_RETRIES (5)
+
+/* microseconds to pause between lock-free read attempts */
+#define SCR_FLUSH_FILE_READ_USLEEP (1000)
+
+/* build the name of the sequence file that sits next to the flush
+ * file, the caller must free the returned string */
+static char* scr_flush_file_seq_name(const char* file)
+{
+  size_t len = strlen(file) + strlen(".seq") + 1;
+  char* seqname = (char*) SCR_MALLOC(len);
+  snprintf(seqname, len, "%s.seq", file);
+  return seqname;
+}
+
+/* read the current sequence value, a missing or short sequence file
+ * reads as 0, which counts as a quiescent (even) value since no
+ * writer has ever touched the flush file through this path */
+static unsigned long scr_flush_file_seq_get(const char* seqname)
+{
+  unsigned long seq = 0;
+  int fd = scr_open(seqname, O_RDONLY);
+  if (fd >= 0) {
+    ssize_t n = scr_read_attempt(seqname, fd, &seq, sizeof(seq));
+    if (n != sizeof(seq)) {
+      seq = 0;
+    }
+    scr_close_nofsync(seqname, fd);
+  }
+  return seq;
+}
+
+/* write a sequence value through an open descriptor */
+static void scr_flush_file_seq_put(const char* seqname, int fd, unsigned long seq)
+{
+  scr_lseek(seqname, fd, 0, SEEK_SET);
+  scr_write_attempt(seqname, fd, &seq, sizeof(seq));
+}
+
+/* read the flush file into hash without taking a lock in the common
+ * case, returns SCR_FAILURE if the file cannot be read */
+int scr_flush_file_read(const char* file, kvtree* hash)
+{
+  char* seqname = scr_flush_file_seq_name(file);
+
+  /* lock-free path: read the sequence on either side of the read and
+   * accept the data only if no writer ran in between */
+  int tries;
+  for (tries = 0; tries < SCR_FLUSH_FILE_READ_RETRIES; tries++) {
+    unsigned long seq1 = scr_flush_file_seq_get(seqname);
+    if (seq1 % 2 != 0) {
+      /* odd sequence means a writer is mid-update */
+      usleep(SCR_FLUSH_FILE_READ_USLEEP);
+      continue;
+    }
+
+    /* read into a scratch hash so a torn read never leaks partial
+     * entries into the caller's hash */
+    kvtree* tmp = kvtree_new();
+    int read_rc = kvtree_read_file(file, tmp);
+
+    unsigned long seq2 = scr_flush_file_seq_get(seqname);
+    if (seq1 == seq2) {
+      /* no writer interfered, the read is consistent, it may still
+       * have failed outright, e.g. if the flush file does not exist */
+      int rc = SCR_FAILURE;
+      if (read_rc == KVTREE_SUCCESS) {
+        kvtree_merge(hash, tmp);
+        rc = SCR_SUCCESS;
+      }
+      kvtree_delete(&tmp);
+      scr_free(&seqname);
+      return rc;
+    }
+
+    /* a writer ran during our read, toss the data and try again */
+    kvtree_delete(&tmp);
+  }
+
+  /* a writer keeps interfering, fall back to blocking on the read
+   * lock, which excludes writers since they hold the write lock on
+   * the sequence file for the duration of their update */
+  int rc = SCR_FAILURE;
+  int fd = scr_open(seqname, O_RDONLY);
+  if (fd >= 0) {
+    scr_file_lock_read(seqname, fd);
+    if (kvtree_read_file(file, hash) == KVTREE_SUCCESS) {
+      rc = SCR_SUCCESS;
+    }
+    scr_file_unlock(seqname, fd);
+    scr_close_nofsync(seqname, fd);
+  } else {
+    /* no sequence file to lock, just read the flush file directly */
+    if (kvtree_read_file(file, hash) == KVTREE_SUCCESS) {
+      rc = SCR_SUCCESS;
+    }
+  }
+
+  scr_free(&seqname);
+  return rc;
+}
+
+/* write hash to the flush file, holding the write lock on the
+ * sequence file and bumping the sequence around the update so
+ * lock-free readers can detect a concurrent write */
+int scr_flush_file_write(const char* file, const kvtree* hash)
+{
+  char* seqname = scr_flush_file_seq_name(file);
+
+  /* open and lock the sequence file, this serializes writers against
+   * each other and against readers that have fallen back to the lock */
+  mode_t mode = scr_getmode(1, 1, 0);
+  int fd = scr_open(seqname, O_RDWR | O_CREAT, mode);
+  if (fd < 0) {
+    /* cannot maintain the sequence, write the flush file unguarded
+     * rather than dropping the update */
+    scr_err("Opening flush sequence file for write: scr_open(%s) errno=%d %s @ %s:%d",
+      seqname, errno, strerror(errno), __FILE__, __LINE__
+    );
+    int rc = (kvtree_write_file(file, hash) == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+    scr_free(&seqname);
+    return rc;
+  }
+  scr_file_lock_write(seqname, fd);
+
+  /* bump the sequence to an odd value to flag the update in progress,
+   * force it odd in case a writer died mid-update and left it odd */
+  unsigned long seq = 0;
+  ssize_t n = scr_read_attempt(seqname, fd, &seq, sizeof(seq));
+  if (n != sizeof(seq)) {
+    seq = 0;
+  }
+  seq = (seq + 1) | 1;
+  scr_flush_file_seq_put(seqname, fd, seq);
+
+  /* write the flush file itself */
+  int rc = (kvtree_write_file(file, hash) == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+
+  /* bump the sequence back to even to publish the update */
+  seq++;
+  scr_flush_file_seq_put(seqname, fd, seq);
+
+  scr_file_unlock(seqname, fd);
+  scr_close(seqname, fd);
+
+  scr_free(&seqname);
+  return rc;
+}
+
+/* spath variant of scr_flush_file_read */
+int scr_flush_file_read_path(const spath* path, kvtree* hash)
+{
+  char* file = spath_strdup(path);
+  int rc = scr_flush_file_read(file, hash);
+  scr_free(&file);
+  return rc;
+}
+
+/* spath variant of scr_flush_file_write */
+int scr_flush_file_write_path(const spath* path, const kvtree* hash)
+{
+  char* file = spath_strdup(path);
+  int rc = scr_flush_file_write(file, hash);
+  scr_free(&file);
+  return rc;
+}
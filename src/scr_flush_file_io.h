@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_FLUSH_FILE_IO_H
+#define SCR_FLUSH_FILE_IO_H
+
+#include "kvtree.h"
+#include "spath.h"
+
+/* Shared read/write helpers for the flush file, usable from both the
+ * library and standalone tools.  The library and prejob/postjob tools
+ * read the flush file concurrently, so writers bump a sequence file
+ * next to the flush file around each update and readers validate the
+ * sequence around each read, retrying on a torn read and falling back
+ * to a blocking file lock only when a writer keeps interfering.  Pure
+ * reads therefore take no lock at all in the common case. */
+
+/* read the flush file into hash without taking a lock in the common
+ * case, returns SCR_FAILURE if the file cannot be read */
+int scr_flush_file_read(const char* file, kvtree* hash);
+
+/* write hash to the flush file, holding the write lock on the
+ * sequence file and bumping the sequence around the update so
+ * lock-free readers can detect a concurrent write */
+int scr_flush_file_write(const char* file, const kvtree* hash);
+
+/* spath variants of the above */
+int scr_flush_file_read_path(const spath* path, kvtree* hash);
+int scr_flush_file_write_path(const spath* path, const kvtree* hash);
+
+#endif
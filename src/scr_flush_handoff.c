@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* This is a utility program that runs on the compute node after the
+ * application has exited to complete flushes that the library handed
+ * off at SCR_Finalize (see SCR_FLUSH_HANDOFF).  It reads the per-rank
+ * handoff files the library left in the control directory, each of
+ * which lists the source and destination path of every file a rank
+ * still had to move, and copies any file that has not yet landed in
+ * full at its destination.  It must not run while the application is
+ * still transferring, so it is launched by the scavenge machinery or
+ * from a job epilogue rather than alongside the job.  Completed
+ * datasets still need to be indexed with scr_index --build, which
+ * the postrun scripts already do for scavenged datasets. */
+
+#include "scr_conf.h"
+#include "scr.h"
+#include "scr_io.h"
+#include "scr_err.h"
+#include "scr_util.h"
+#include "scr_keys.h"
+
+#include "spath.h"
+#include "kvtree.h"
+#include "kvtree_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <dirent.h>
+
+#ifdef SCR_GLOBALS_H
+#error "globals.h accessed from tools"
+#endif
+
+#define PROG ("scr_flush_handoff")
+
+int print_usage()
+{
+  printf("\n");
+  printf("  Usage:  %s --cntldir <dir> [--id <id>] [--buf <size>]\n", PROG);
+  printf("\n");
+  exit(1);
+}
+
+struct arglist {
+  char* cntldir;          /* control directory */
+  int id;                 /* dataset id, -1 processes all handoff files */
+  unsigned long buf_size; /* number of bytes to copy file data to file system */
+};
+
+int process_args(int argc, char **argv, struct arglist* args)
+{
+  /* define our options */
+  static struct option long_options[] = {
+    {"cntldir",    required_argument, NULL, 'c'},
+    {"id",         required_argument, NULL, 'i'},
+    {"buf",        required_argument, NULL, 'b'},
+    {0, 0, 0, 0}
+  };
+
+  /* set our options to default values */
+  args->cntldir  = NULL;
+  args->id       = -1;
+  args->buf_size = SCR_FILE_BUF_SIZE;
+
+  /* loop through and process all options */
+  int c, id;
+  unsigned long long bytes;
+  do {
+    /* read in our next option */
+    int option_index = 0;
+    c = getopt_long(argc, argv, "c:i:b:h", long_options, &option_index);
+    switch (c) {
+      case 'c':
+        /* control directory */
+        args->cntldir = optarg;
+        break;
+      case 'i':
+        /* restrict to one dataset id */
+        id = atoi(optarg);
+        if (id <= 0) {
+          scr_err("%s: Dataset id must be positive '--id %s'",
+            PROG, optarg
+          );
+          return 0;
+        }
+        args->id = id;
+        break;
+      case 'b':
+        /* buffer size to copy file data to file system */
+        if (scr_abtoull(optarg, &bytes) != SCR_SUCCESS) {
+          scr_err("%s: Invalid value for buffer size '--buf %s'",
+            PROG, optarg
+          );
+          return 0;
+        }
+        args->buf_size = (unsigned long) bytes;
+        break;
+      case 'h':
+        /* print help message and exit */
+        print_usage();
+        break;
+      case '?':
+        /* getopt_long printed an error message */
+        break;
+      default:
+        if (c != -1) {
+          /* missed an option */
+          scr_err("%s: Option '%s' specified but not processed",
+            PROG, argv[option_index]
+          );
+        }
+    }
+  } while (c != -1);
+
+  /* check that we got a directory name */
+  if (args->cntldir == NULL) {
+    scr_err("%s: Must specify control directory via '--cntldir <dir>'",
+      PROG
+    );
+    return 0;
+  }
+
+  return 1;
+}
+
+/* complete the transfers recorded in one handoff file, copies each
+ * file that is not already in full at its destination, deletes the
+ * handoff file if every file lands, returns SCR_SUCCESS if so */
+static int process_handoff_file(const char* file, unsigned long buf_size)
+{
+  /* read the handoff file */
+  kvtree* hash = kvtree_new();
+  if (kvtree_read_file(file, hash) != KVTREE_SUCCESS) {
+    scr_err("%s: Failed to read handoff file %s",
+      PROG, file
+    );
+    kvtree_delete(&hash);
+    return SCR_FAILURE;
+  }
+
+  /* get dataset id and name for reporting */
+  int id = -1;
+  char* name = NULL;
+  kvtree_util_get_int(hash, SCR_HANDOFF_KEY_DSET, &id);
+  kvtree_util_get_str(hash, SCR_HANDOFF_KEY_NAME, &name);
+
+  int rc = SCR_SUCCESS;
+  int copied = 0;
+  int skipped = 0;
+
+  /* move each file that has not yet landed in full */
+  kvtree* files = kvtree_get(hash, SCR_HANDOFF_KEY_FILE);
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(files);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    /* get source and destination paths */
+    char* src = kvtree_elem_key(elem);
+    char* dst = NULL;
+    kvtree_util_get_str(kvtree_elem_hash(elem), SCR_HANDOFF_KEY_DEST, &dst);
+    if (dst == NULL) {
+      scr_err("%s: Handoff entry for %s has no destination in %s",
+        PROG, src, file
+      );
+      rc = SCR_FAILURE;
+      continue;
+    }
+
+    /* we need the source to size up and complete the destination,
+     * without it the dataset has to come back through a restart */
+    if (scr_file_is_readable(src) != SCR_SUCCESS) {
+      scr_err("%s: Source file is unreadable: %s",
+        PROG, src
+      );
+      rc = SCR_FAILURE;
+      continue;
+    }
+    unsigned long src_size = scr_file_size(src);
+
+    /* skip files that already landed in full */
+    if (scr_file_is_readable(dst) == SCR_SUCCESS &&
+        scr_file_size(dst) == src_size)
+    {
+      skipped++;
+      continue;
+    }
+
+    /* drop any partial file AXL left at its temporary name,
+     * we resend the file in full */
+    char partial[SCR_MAX_FILENAME];
+    snprintf(partial, sizeof(partial), "%s._AXL", dst);
+    scr_file_unlink(partial);
+
+    /* copy the file to its destination */
+    if (scr_file_copy(src, dst, buf_size, NULL) != SCR_SUCCESS) {
+      scr_err("%s: Failed to copy %s to %s",
+        PROG, src, dst
+      );
+      rc = SCR_FAILURE;
+      continue;
+    }
+    copied++;
+  }
+
+  if (rc == SCR_SUCCESS) {
+    /* every file is at its destination,
+     * drop the handoff file so we don't process it again */
+    scr_file_unlink(file);
+    printf("%s: Completed flush of dataset %d `%s': %d file(s) copied, %d already complete\n",
+      PROG, id, (name != NULL) ? name : "UNKNOWN", copied, skipped
+    );
+  }
+
+  kvtree_delete(&hash);
+  return rc;
+}
+
+int main(int argc, char* argv[])
+{
+  /* process command line arguments */
+  struct arglist args;
+  if (! process_args(argc, argv, &args)) {
+    return 1;
+  }
+
+  /* scan the control directory for handoff files */
+  DIR* dirp = opendir(args.cntldir);
+  if (dirp == NULL) {
+    scr_err("%s: Failed to open control directory %s",
+      PROG, args.cntldir
+    );
+    return 1;
+  }
+
+  int rc = 0;
+  int found = 0;
+  struct dirent* de;
+  while ((de = readdir(dirp)) != NULL) {
+    /* handoff files are named handoff.<id>.<rank> */
+    int id, rank;
+    if (sscanf(de->d_name, "handoff.%d.%d", &id, &rank) != 2) {
+      continue;
+    }
+
+    /* restrict to the requested dataset if one was given */
+    if (args.id != -1 && id != args.id) {
+      continue;
+    }
+    found++;
+
+    /* build full path to the handoff file and process it */
+    spath* path = spath_from_str(args.cntldir);
+    spath_append_str(path, de->d_name);
+    char* file = spath_strdup(path);
+    spath_delete(&path);
+
+    if (process_handoff_file(file, args.buf_size) != SCR_SUCCESS) {
+      rc = 1;
+    }
+
+    scr_free(&file);
+  }
+  closedir(dirp);
+
+  if (found == 0) {
+    printf("%s: No handoff files found in %s\n",
+      PROG, args.cntldir
+    );
+  }
+
+  return rc;
+}
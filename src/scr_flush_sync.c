@@ -10,6 +10,7 @@
 */
 
 #include "scr_globals.h"
+#include "scr_stats.h"
 
 #include "spath.h"
 #include "kvtree.h"
@@ -17,12 +18,530 @@
 
 #include "axl_mpi.h"
 
+#include <pthread.h>
+
 /*
 =========================================
 Synchronous flush functions
 =========================================
 */
 
+/* token bucket that paces how fast this process may write to the
+ * parallel file system during a flush, the cluster-wide budget is
+ * divided evenly across ranks so no communication is needed while
+ * the flush runs */
+struct scr_flush_bucket {
+  double rate;          /* bytes per second this process may write */
+  double tokens;        /* bytes currently available (may go negative) */
+  double last;          /* time of last refill in seconds */
+  pthread_mutex_t lock; /* worker threads share the bucket */
+};
+
+/* get current time in seconds for pacing,
+ * we avoid MPI_Wtime since workers may call this from threads */
+static double scr_flush_bucket_now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
+
+static void scr_flush_bucket_init(struct scr_flush_bucket* b, double rate)
+{
+  b->rate   = rate;
+  b->tokens = rate; /* allow a one second burst to start */
+  b->last   = scr_flush_bucket_now();
+  pthread_mutex_init(&b->lock, NULL);
+}
+
+static void scr_flush_bucket_destroy(struct scr_flush_bucket* b)
+{
+  pthread_mutex_destroy(&b->lock);
+}
+
+/* charge the bucket for writing the given number of bytes,
+ * sleeping as needed to hold the average rate at the limit */
+static void scr_flush_bucket_take(struct scr_flush_bucket* b, unsigned long bytes)
+{
+  if (b == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&b->lock);
+
+  /* add tokens for the time that has passed, capped at a one second burst */
+  double now = scr_flush_bucket_now();
+  b->tokens += (now - b->last) * b->rate;
+  if (b->tokens > b->rate) {
+    b->tokens = b->rate;
+  }
+  b->last = now;
+
+  /* charge for this write, and compute how long to sit out
+   * if we have overdrawn the budget */
+  b->tokens -= (double) bytes;
+  double wait = 0.0;
+  if (b->tokens < 0.0) {
+    wait = -b->tokens / b->rate;
+  }
+
+  pthread_mutex_unlock(&b->lock);
+
+  if (wait > 0.0) {
+    usleep((useconds_t) (wait * 1000000.0));
+  }
+}
+
+/* when CRC on flush is enabled, points at the FILE hash of the file
+ * list for the duration of the transfer so the copy loops can fold
+ * checksumming into the copy itself rather than re-reading each file */
+static const kvtree* scr_flush_sync_crc_files = NULL;
+
+/* handle a CRC computed over the copy buffers for the given source
+ * file, verifying it against any value already recorded in the file's
+ * metadata or recording it otherwise so the summary metadata carries it,
+ * safe to call from worker threads since each file has its own meta
+ * object, returns SCR_FAILURE on a mismatch */
+static int scr_flush_sync_crc_check(const char* src, uLong crc)
+{
+  /* nothing to check unless CRC on flush is active */
+  if (scr_flush_sync_crc_files == NULL) {
+    return SCR_SUCCESS;
+  }
+
+  /* look up metadata for this file, a leader flushing a peer's file
+   * finds no entry since the peer rank holds that metadata */
+  kvtree* hash = kvtree_get(scr_flush_sync_crc_files, src);
+  scr_meta* meta = kvtree_get(hash, SCR_KEY_META);
+  if (meta == NULL) {
+    return SCR_SUCCESS;
+  }
+
+  uLong crc_meta;
+  if (scr_meta_get_crc32(meta, &crc_meta) == SCR_SUCCESS) {
+    /* metadata already has a CRC, verify the copy matched it */
+    if (crc != crc_meta) {
+      scr_err("CRC32 mismatch detected when flushing file %s @ %s:%d",
+        src, __FILE__, __LINE__
+      );
+      return SCR_FAILURE;
+    }
+  } else {
+    /* no CRC recorded yet, save the one we just computed */
+    scr_meta_set_crc32(meta, crc);
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* state shared by the flush worker threads,
+ * workers pull the next unclaimed file from the list until it's empty */
+struct scr_flush_pool {
+  int numfiles;            /* number of files in the list */
+  int next;                /* index of next unclaimed file */
+  char** src_filelist;     /* source path for each file */
+  char** dst_filelist;     /* destination path for each file */
+  int direct;              /* whether to write destinations with O_DIRECT */
+  int rc;                  /* set to SCR_FAILURE if any copy fails */
+  pthread_mutex_t lock;    /* protects next and rc */
+  struct scr_flush_bucket* bucket; /* optional bandwidth limiter */
+};
+
+/* worker thread, copies files from the shared list until none remain */
+static void* scr_flush_worker(void* arg)
+{
+  struct scr_flush_pool* pool = (struct scr_flush_pool*) arg;
+  while (1) {
+    /* claim the next file in the list */
+    pthread_mutex_lock(&pool->lock);
+    int i = pool->next;
+    if (i < pool->numfiles) {
+      pool->next++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    /* stop when the list is empty */
+    if (i >= pool->numfiles) {
+      break;
+    }
+
+    /* charge the bandwidth budget for this file before writing it */
+    scr_flush_bucket_take(pool->bucket, scr_file_size(pool->src_filelist[i]));
+
+    /* copy this file to its destination, routing it through the
+     * dedup pass when one is active */
+    int copy_rc;
+    if (scr_dedup_enabled()) {
+      copy_rc = scr_dedup_copy(pool->src_filelist[i], pool->dst_filelist[i]);
+    } else if (scr_crc_on_flush) {
+      /* fold the CRC into the copy loop so verification reads no extra data */
+      uLong crc = scr_crc_init();
+      copy_rc = scr_file_copy_opts(pool->src_filelist[i], pool->dst_filelist[i], scr_file_buf_size, &crc, pool->direct);
+      if (copy_rc == SCR_SUCCESS) {
+        copy_rc = scr_flush_sync_crc_check(pool->src_filelist[i], crc);
+      }
+    } else {
+      copy_rc = scr_file_copy_opts(pool->src_filelist[i], pool->dst_filelist[i], scr_file_buf_size, NULL, pool->direct);
+    }
+    if (copy_rc != SCR_SUCCESS) {
+      pthread_mutex_lock(&pool->lock);
+      pool->rc = SCR_FAILURE;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+  return NULL;
+}
+
+/* flush files in the list with a pool of worker threads so that several
+ * files are in flight at once, returns SCR_SUCCESS if all files copy */
+static int scr_flush_sync_threads(
+  int numfiles,
+  char** src_filelist,
+  char** dst_filelist,
+  int nthreads,
+  struct scr_flush_bucket* bucket)
+{
+  /* no sense in starting more workers than we have files */
+  if (nthreads > numfiles) {
+    nthreads = numfiles;
+  }
+
+  /* set up the shared work list */
+  struct scr_flush_pool pool;
+  pool.numfiles     = numfiles;
+  pool.next         = 0;
+  pool.src_filelist = src_filelist;
+  pool.dst_filelist = dst_filelist;
+  pool.direct       = scr_flush_direct;
+  pool.rc           = SCR_SUCCESS;
+  pool.bucket       = bucket;
+  pthread_mutex_init(&pool.lock, NULL);
+
+  /* start the workers */
+  pthread_t* threads = (pthread_t*) malloc(nthreads * sizeof(pthread_t));
+  if (threads == NULL) {
+    scr_err("Allocating memory for flush threads: malloc(%lu) errno=%d %s @ %s:%d",
+      nthreads * sizeof(pthread_t), errno, strerror(errno), __FILE__, __LINE__
+    );
+    pthread_mutex_destroy(&pool.lock);
+    return SCR_FAILURE;
+  }
+  int started = 0;
+  int i;
+  for (i = 0; i < nthreads; i++) {
+    if (pthread_create(&threads[i], NULL, scr_flush_worker, &pool) == 0) {
+      started++;
+    } else {
+      scr_err("Failed to start flush worker thread %d @ %s:%d",
+        i, __FILE__, __LINE__
+      );
+      break;
+    }
+  }
+
+  /* if we couldn't start any workers, run the list ourselves */
+  if (started == 0) {
+    scr_flush_worker(&pool);
+  }
+
+  /* wait for the workers to drain the list */
+  for (i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  scr_free(&threads);
+  pthread_mutex_destroy(&pool.lock);
+
+  return pool.rc;
+}
+
+/* two-phase flush that caps the number of parallel file system
+ * clients per node, only the first nwriters ranks that share the
+ * store write to the file system, the remaining ranks hand their
+ * file lists to a writer over MPI, and the writer reads their files
+ * directly from the shared store, each rank returns the outcome for
+ * its own files */
+static int scr_flush_sync_leaders(
+  const scr_storedesc* storedesc,
+  int numfiles,
+  char** src_filelist,
+  char** dst_filelist,
+  int nwriters,
+  int nthreads,
+  struct scr_flush_bucket* bucket)
+{
+  int i;
+  int rc = SCR_SUCCESS;
+
+  /* ranks in this communicator can read each other's files */
+  MPI_Comm comm = storedesc->comm;
+  int rank  = storedesc->rank;
+  int ranks = storedesc->ranks;
+
+  /* no sense in more writers than ranks that share the store */
+  if (nwriters > ranks) {
+    nwriters = ranks;
+  }
+
+  if (rank < nwriters) {
+    /* we act as a writer, get a file count from each peer assigned to us */
+    int* counts = (int*) SCR_MALLOC(ranks * sizeof(int));
+    int total = numfiles;
+    int peer;
+    for (peer = rank + nwriters; peer < ranks; peer += nwriters) {
+      MPI_Status status;
+      MPI_Recv(&counts[peer], 1, MPI_INT, peer, 0, comm, &status);
+      total += counts[peer];
+    }
+
+    /* build a combined list starting with our own files */
+    char** src = (char**) SCR_MALLOC(total * sizeof(char*));
+    char** dst = (char**) SCR_MALLOC(total * sizeof(char*));
+    int n = 0;
+    for (i = 0; i < numfiles; i++) {
+      src[n] = strdup(src_filelist[i]);
+      dst[n] = strdup(dst_filelist[i]);
+      n++;
+    }
+
+    /* receive source and destination paths from each peer */
+    for (peer = rank + nwriters; peer < ranks; peer += nwriters) {
+      for (i = 0; i < counts[peer]; i++) {
+        scr_str_recv(&src[n], peer, comm);
+        scr_str_recv(&dst[n], peer, comm);
+        n++;
+      }
+    }
+
+    /* since we write on behalf of our peers, claim their shares of
+     * the bandwidth budget as well */
+    if (bucket != NULL) {
+      int served = 1 + (ranks - 1 - rank) / nwriters;
+      bucket->rate  *= (double) served;
+      bucket->tokens = bucket->rate;
+    }
+
+    /* copy the files, using worker threads if configured */
+    if (nthreads > 1) {
+      rc = scr_flush_sync_threads(total, src, dst, nthreads, bucket);
+    } else {
+      for (i = 0; i < total; i++) {
+        scr_flush_bucket_take(bucket, scr_file_size(src[i]));
+        int copy_rc;
+        if (scr_dedup_enabled()) {
+          copy_rc = scr_dedup_copy(src[i], dst[i]);
+        } else if (scr_crc_on_flush) {
+          /* checksum the buffers as they pass through the copy */
+          uLong crc = scr_crc_init();
+          copy_rc = scr_file_copy_opts(src[i], dst[i], scr_file_buf_size, &crc, scr_flush_direct);
+          if (copy_rc == SCR_SUCCESS) {
+            copy_rc = scr_flush_sync_crc_check(src[i], crc);
+          }
+        } else {
+          copy_rc = scr_file_copy_opts(src[i], dst[i], scr_file_buf_size, NULL, scr_flush_direct);
+        }
+        if (copy_rc != SCR_SUCCESS) {
+          rc = SCR_FAILURE;
+          break;
+        }
+      }
+    }
+
+    /* let each peer know whether its files made it */
+    for (peer = rank + nwriters; peer < ranks; peer += nwriters) {
+      MPI_Send(&rc, 1, MPI_INT, peer, 0, comm);
+    }
+
+    /* free the combined lists */
+    for (i = 0; i < total; i++) {
+      scr_free(&src[i]);
+      scr_free(&dst[i]);
+    }
+    scr_free(&src);
+    scr_free(&dst);
+    scr_free(&counts);
+  } else {
+    /* hand our file list to our writer */
+    int writer = rank % nwriters;
+    MPI_Send(&numfiles, 1, MPI_INT, writer, 0, comm);
+    for (i = 0; i < numfiles; i++) {
+      scr_str_send(src_filelist[i], writer, comm);
+      scr_str_send(dst_filelist[i], writer, comm);
+    }
+
+    /* wait for the writer to report the outcome */
+    MPI_Status status;
+    MPI_Recv(&rc, 1, MPI_INT, writer, 0, comm, &status);
+  }
+
+  return rc;
+}
+
+/* records size and mtime of each file at its last successful flush,
+ * keyed by destination path, used to skip unchanged files when
+ * incremental flush is enabled (see SCR_FLUSH_INCREMENTAL) */
+static kvtree* scr_flush_sync_flushed = NULL;
+
+/* returns 1 if the source file still matches what we last flushed
+ * to dst_file, in which case the copy can be skipped */
+static int scr_flush_sync_unchanged(const char* src_file, const char* dst_file)
+{
+  /* look up record from our last flush to this destination */
+  kvtree* record = kvtree_get_kv(scr_flush_sync_flushed, SCR_KEY_FILE, dst_file);
+  if (record == NULL) {
+    return 0;
+  }
+
+  /* get size and mtime recorded at our last flush */
+  unsigned long last_size  = 0;
+  unsigned long last_secs  = 0;
+  unsigned long last_nsecs = 0;
+  if (kvtree_util_get_unsigned_long(record, SCR_META_KEY_SIZE, &last_size) != KVTREE_SUCCESS ||
+      kvtree_util_get_unsigned_long(record, SCR_META_KEY_MTIME_SECS, &last_secs) != KVTREE_SUCCESS ||
+      kvtree_util_get_unsigned_long(record, SCR_META_KEY_MTIME_NSECS, &last_nsecs) != KVTREE_SUCCESS)
+  {
+    return 0;
+  }
+
+  /* stat the source file in cache */
+  struct stat statbuf;
+  if (stat(src_file, &statbuf) != 0) {
+    return 0;
+  }
+
+  /* the application rewrote the file if its size or mtime moved */
+  if ((unsigned long) statbuf.st_size != last_size ||
+      (unsigned long) statbuf.st_mtim.tv_sec != last_secs ||
+      (unsigned long) statbuf.st_mtim.tv_nsec != last_nsecs)
+  {
+    return 0;
+  }
+
+  /* check that the copy we flushed earlier is still at the destination
+   * with the size it had when we wrote it (which may differ from the
+   * source size if the flush compressed the file) */
+  unsigned long last_dst_size = 0;
+  if (kvtree_util_get_unsigned_long(record, SCR_KEY_SIZE, &last_dst_size) != KVTREE_SUCCESS) {
+    return 0;
+  }
+  if (scr_file_size(dst_file) != last_dst_size) {
+    return 0;
+  }
+
+  return 1;
+}
+
+/* record size and mtime of each file we just flushed,
+ * so later flushes can skip files that have not changed */
+static void scr_flush_sync_record(int numfiles, char** src_filelist, char** dst_filelist)
+{
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    struct stat statbuf;
+    if (stat(src_filelist[i], &statbuf) != 0) {
+      continue;
+    }
+    kvtree* record = kvtree_set_kv(scr_flush_sync_flushed, SCR_KEY_FILE, dst_filelist[i]);
+    kvtree_util_set_unsigned_long(record, SCR_META_KEY_SIZE, (unsigned long) statbuf.st_size);
+    kvtree_util_set_unsigned_long(record, SCR_META_KEY_MTIME_SECS, (unsigned long) statbuf.st_mtim.tv_sec);
+    kvtree_util_set_unsigned_long(record, SCR_META_KEY_MTIME_NSECS, (unsigned long) statbuf.st_mtim.tv_nsec);
+    kvtree_util_set_unsigned_long(record, SCR_KEY_SIZE, scr_file_size(dst_filelist[i]));
+  }
+}
+
+/* write each of this rank's files into the node's container file at
+ * the given offsets, the container must already exist */
+static int scr_flush_sync_container(
+  int numfiles,
+  char** src_filelist,
+  const char* ctr_file,
+  unsigned long* offsets,
+  struct scr_flush_bucket* bucket)
+{
+  int rc = SCR_SUCCESS;
+
+  /* nothing to write if we have no files */
+  if (numfiles == 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* open the container, the node leader has already created it */
+  int ctr_fd = scr_open(ctr_file, O_WRONLY);
+  if (ctr_fd < 0) {
+    scr_err("Opening container for write: scr_open(%s) errno=%d %s @ %s:%d",
+      ctr_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* grab buffer from the pool to chunk copies */
+  char* buf = (char*) scr_buf_get(scr_file_buf_size);
+  if (buf == NULL) {
+    scr_close(ctr_file, ctr_fd);
+    return SCR_FAILURE;
+  }
+
+  int i;
+  for (i = 0; i < numfiles && rc == SCR_SUCCESS; i++) {
+    const char* file = src_filelist[i];
+
+    /* charge the bandwidth budget for this file before writing it */
+    scr_flush_bucket_take(bucket, scr_file_size(file));
+
+    /* open the source file */
+    int fd = scr_open(file, O_RDONLY);
+    if (fd < 0) {
+      scr_err("Opening file to copy into container: scr_open(%s) errno=%d %s @ %s:%d",
+        file, errno, strerror(errno), __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+      break;
+    }
+
+    /* copy file data into container at its segment offset,
+     * ranks write concurrently so we use pwrite rather than
+     * sharing a file position */
+    off_t offset = (off_t) offsets[i];
+    ssize_t nread = scr_read_attempt(file, fd, buf, scr_file_buf_size);
+    while (nread > 0 && rc == SCR_SUCCESS) {
+      ssize_t nwritten = 0;
+      while (nwritten < nread) {
+        ssize_t n = pwrite(ctr_fd, buf + nwritten, nread - nwritten, offset + nwritten);
+        if (n < 0) {
+          if (errno == EINTR || errno == EAGAIN) {
+            continue;
+          }
+          scr_err("Error writing container: pwrite(%s) errno=%d %s @ %s:%d",
+            ctr_file, errno, strerror(errno), __FILE__, __LINE__
+          );
+          rc = SCR_FAILURE;
+          break;
+        }
+        nwritten += n;
+      }
+      offset += nwritten;
+
+      /* read the next chunk */
+      if (rc == SCR_SUCCESS) {
+        nread = scr_read_attempt(file, fd, buf, scr_file_buf_size);
+      }
+    }
+    if (nread < 0) {
+      rc = SCR_FAILURE;
+    }
+
+    /* source file was only read, nothing to sync */
+    scr_close_nofsync(file, fd);
+  }
+
+  scr_buf_put(buf);
+
+  /* flush container contents to disk */
+  scr_close(ctr_file, ctr_fd);
+
+  return rc;
+}
+
 /* flushes data for files specified in file_list (with flow control),
  * and records status of each file in data */
 static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_list)
@@ -33,6 +552,13 @@ static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_lis
   char** dst_filelist;
   scr_flush_list_alloc(file_list, &numfiles, &src_filelist, &dst_filelist);
 
+  /* when CRC on flush is enabled, expose the file list so the copy
+   * loops can compute each file's CRC over the copy buffers instead
+   * of re-reading the file after the transfer */
+  if (scr_crc_on_flush) {
+    scr_flush_sync_crc_files = kvtree_get(file_list, SCR_KEY_FILE);
+  }
+
   /* get the dataset of this flush */
   scr_dataset* dataset = kvtree_get(file_list, SCR_KEY_DATASET);
 
@@ -59,15 +585,66 @@ static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_lis
   }
   MPI_Barrier(scr_comm_world);
 
+  /* if container mode is enabled, lay out a per-node container file,
+   * compute the offset of each of this rank's files within it */
+  int i;
+  char* ctr_path = NULL;             /* absolute path to container */
+  char* ctr_rel = NULL;              /* container path relative to prefix */
+  unsigned long* ctr_offsets = NULL; /* offset of each file within container */
+  unsigned long* ctr_lengths = NULL; /* length of each file */
+  int bypass = 0;
+  scr_cache_index_get_bypass(cindex, id, &bypass);
+  if (scr_flush_container && !bypass) {
+    /* sum up the bytes this rank will write,
+     * recording the offset of each file relative to our first byte */
+    unsigned long my_bytes = 0;
+    ctr_offsets = (unsigned long*) SCR_MALLOC(numfiles * sizeof(unsigned long));
+    ctr_lengths = (unsigned long*) SCR_MALLOC(numfiles * sizeof(unsigned long));
+    for (i = 0; i < numfiles; i++) {
+      ctr_offsets[i] = my_bytes;
+      ctr_lengths[i] = scr_file_size(src_filelist[i]);
+      my_bytes += ctr_lengths[i];
+    }
+
+    /* scan across ranks on the node to get our starting offset,
+     * and shift each file offset by that amount */
+    unsigned long my_offset = 0;
+    MPI_Scan(&my_bytes, &my_offset, 1, MPI_UNSIGNED_LONG, MPI_SUM, scr_comm_node);
+    my_offset -= my_bytes;
+    for (i = 0; i < numfiles; i++) {
+      ctr_offsets[i] += my_offset;
+    }
+
+    /* name the container after the world rank of the node leader,
+     * it lives alongside the other dataset metadata files */
+    int leader = scr_my_rank_world;
+    MPI_Bcast(&leader, 1, MPI_INT, 0, scr_comm_node);
+    char ctr_name[SCR_MAX_FILENAME];
+    snprintf(ctr_name, sizeof(ctr_name), "ctr_%d.scr", leader);
+    spath* cpath = spath_dup(dataset_path);
+    spath_append_str(cpath, ctr_name);
+    ctr_path = spath_strdup(cpath);
+
+    /* compute container path relative to prefix directory,
+     * this is what we record in the rank2file map */
+    spath* base = spath_from_str(scr_prefix);
+    spath* rel = spath_relative(base, cpath);
+    ctr_rel = spath_strdup(rel);
+    spath_delete(&rel);
+    spath_delete(&base);
+    spath_delete(&cpath);
+  }
+
+  /* compress file data during the transfer when enabled, this does
+   * not apply to bypass datasets or when packing into containers */
+  int compress = (scr_flush_compress && !bypass && ctr_offsets == NULL);
+
   /* define path for rank2file map */
   spath_append_str(dataset_path, "rank2file");
   const char* rank2file = spath_strdup(dataset_path);
 
   /* we can skip transfer if all paths match */
   int skip_transfer = 1;
-
-  /* build a list of files for this rank */
-  int i;
   kvtree* filelist = kvtree_new();
   for (i = 0; i < numfiles; i++) {
     /* get path to destination file */
@@ -86,6 +663,28 @@ static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_lis
 
     kvtree_set_kv(filelist, "FILE", relfile);
 
+    /* when using containers, record the segment holding this file,
+     * fetch reads the file back through these offsets */
+    if (ctr_offsets != NULL) {
+      kvtree* file_hash = kvtree_get_kv(filelist, "FILE", relfile);
+      kvtree_util_set_str(file_hash, SCR_KEY_CONTAINER, ctr_rel);
+      kvtree_util_set_unsigned_long(file_hash, SCR_KEY_OFFSET, ctr_offsets[i]);
+      kvtree_util_set_unsigned_long(file_hash, SCR_KEY_LENGTH, ctr_lengths[i]);
+
+      /* packing into a container always requires a transfer */
+      skip_transfer = 0;
+    }
+
+    /* when compressing, record the algorithm so fetch knows to
+     * decompress the file on its way back */
+    if (compress) {
+      kvtree* file_hash = kvtree_get_kv(filelist, "FILE", relfile);
+      kvtree_util_set_str(file_hash, SCR_KEY_COMPRESS, "zlib");
+
+      /* compressed destination never matches the source */
+      skip_transfer = 0;
+    }
+
     scr_free(&relfile);
     spath_delete(&rel);
     spath_delete(&dest);
@@ -93,16 +692,67 @@ static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_lis
   }
 
   /* save our file list to disk */
-  kvtree_write_gather(rank2file, filelist, scr_comm_world);
+  scr_summary_write_rank2file(rank2file, filelist, scr_comm_world);
   kvtree_delete(&filelist);
 
   /* get AXL transfer type to use */
   const scr_storedesc* storedesc = scr_cache_get_storedesc(cindex, id);
   axl_xfer_t xfer_type = axl_xfer_str_to_type(storedesc->type);
 
+  /* set up a bandwidth limiter if a limit is configured for this
+   * flush, each process takes an even share of the aggregate budget,
+   * the per-store limit overrides the global one */
+  double bw_limit = scr_flush_bw;
+  if (storedesc->bw > 0.0) {
+    bw_limit = storedesc->bw;
+  }
+
+  /* honor dataset priority: urgent datasets run at full speed regardless
+   * of any configured limit, bulk datasets yield to other traffic by
+   * taking the (lower) bulk budget when one is set */
+  if (scr_dataset_is_urgent(dataset)) {
+    bw_limit = 0.0;
+  } else if (scr_dataset_is_bulk(dataset) && scr_flush_bw_bulk > 0.0) {
+    bw_limit = scr_flush_bw_bulk;
+  }
+
+  struct scr_flush_bucket bucket;
+  struct scr_flush_bucket* bucketp = NULL;
+  if (bw_limit > 0.0) {
+    scr_flush_bucket_init(&bucket, bw_limit / scr_ranks_world);
+    bucketp = &bucket;
+  }
+
   /* after writing out file above, see if we can skip the transfer */
   int success = 1;
   if (! scr_alltrue(skip_transfer, scr_comm_world)) {
+    if (ctr_offsets != NULL) {
+      /* node leader creates the container file,
+       * then all ranks on the node write their segments concurrently */
+      if (scr_my_rank_host == 0) {
+        mode_t mode_file = scr_getmode(1, 1, 0);
+        int fd = scr_open(ctr_path, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+        if (fd < 0) {
+          scr_err("Failed to create container file %s @ %s:%d",
+            ctr_path, __FILE__, __LINE__
+          );
+          success = 0;
+        } else {
+          scr_close(ctr_path, fd);
+        }
+      }
+      MPI_Barrier(scr_comm_node);
+
+      /* pack our files into the container */
+      if (success &&
+          scr_flush_sync_container(numfiles, src_filelist, ctr_path, ctr_offsets, bucketp) != SCR_SUCCESS)
+      {
+        success = 0;
+      }
+
+      goto transfer_done;
+    }
+
     /* create directories */
     scr_flush_create_dirs(scr_prefix, numfiles, dst_filelist, scr_comm_world);
 
@@ -115,9 +765,125 @@ static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_lis
 
     /* TODO: configure AXL to not create directories */
 
-    /* write files (via AXL) */
-    if (scr_axl(dset_name, numfiles, src_filelist, dst_filelist, xfer_type, scr_comm_world) != SCR_SUCCESS) {
-      success = 0;
+    /* determine which files actually need a transfer */
+    int xfer_numfiles = numfiles;
+    char** xfer_src = src_filelist;
+    char** xfer_dst = dst_filelist;
+
+    /* if incremental flush is enabled, filter out files whose content
+     * has not changed since we last flushed them */
+    if (scr_flush_incremental) {
+      if (scr_flush_sync_flushed == NULL) {
+        scr_flush_sync_flushed = kvtree_new();
+      }
+      xfer_src = (char**) SCR_MALLOC(numfiles * sizeof(char*));
+      xfer_dst = (char**) SCR_MALLOC(numfiles * sizeof(char*));
+      xfer_numfiles = 0;
+      for (i = 0; i < numfiles; i++) {
+        if (scr_flush_sync_unchanged(src_filelist[i], dst_filelist[i])) {
+          continue;
+        }
+        xfer_src[xfer_numfiles] = src_filelist[i];
+        xfer_dst[xfer_numfiles] = dst_filelist[i];
+        xfer_numfiles++;
+      }
+      scr_dbg(2, "scr_flush_sync: %d of %d files unchanged since last flush",
+        numfiles - xfer_numfiles, numfiles
+      );
+    }
+
+    /* determine how many worker threads to use for this flush,
+     * applying the per-store cap if the descriptor defines one */
+    int nthreads = scr_flush_threads;
+    if (storedesc->threads > 0 && nthreads > storedesc->threads) {
+      nthreads = storedesc->threads;
+    }
+
+    /* start a dedup pass when block dedup applies to this flush,
+     * it covers the copies SCR makes itself but not compressed
+     * files or transfers handed to other AXL backends */
+    int use_dedup = scr_dedup && ! compress && xfer_type == AXL_XFER_SYNC;
+    if (use_dedup) {
+      scr_dedup_start();
+    }
+
+    if (compress) {
+      /* compress each file to its destination rather than copying it */
+      for (i = 0; i < xfer_numfiles; i++) {
+        scr_flush_bucket_take(bucketp, scr_file_size(xfer_src[i]));
+        if (scr_file_compress_zlib(xfer_src[i], xfer_dst[i], scr_file_buf_size) != SCR_SUCCESS) {
+          success = 0;
+          break;
+        }
+      }
+    } else if (scr_flush_leaders > 0 && storedesc->ranks > 1 && xfer_type == AXL_XFER_SYNC) {
+      /* funnel the flush through a few writer ranks per node to cap
+       * the number of parallel file system clients, this requires a
+       * store that ranks share so writers can read peers' files */
+      if (scr_flush_sync_leaders(storedesc, xfer_numfiles, xfer_src, xfer_dst,
+            scr_flush_leaders, nthreads, bucketp) != SCR_SUCCESS)
+      {
+        success = 0;
+      }
+    } else if (nthreads > 1 && xfer_type == AXL_XFER_SYNC) {
+      /* user asked for a worker pool and this store uses plain
+       * synchronous copies, flush several files concurrently */
+      if (scr_flush_sync_threads(xfer_numfiles, xfer_src, xfer_dst, nthreads, bucketp) != SCR_SUCCESS) {
+        success = 0;
+      }
+    } else if (use_dedup) {
+      /* dedup pass with no worker pool, copy the files ourselves
+       * so each block can be matched against the previous flush */
+      for (i = 0; i < xfer_numfiles; i++) {
+        scr_flush_bucket_take(bucketp, scr_file_size(xfer_src[i]));
+        if (scr_dedup_copy(xfer_src[i], xfer_dst[i]) != SCR_SUCCESS) {
+          success = 0;
+          break;
+        }
+      }
+    } else if (bucketp != NULL && xfer_type == AXL_XFER_SYNC) {
+      /* AXL offers no pacing hook, so when a bandwidth limit is set
+       * and the store uses plain synchronous copies, copy the files
+       * ourselves and pace each one against the budget */
+      for (i = 0; i < xfer_numfiles; i++) {
+        scr_flush_bucket_take(bucketp, scr_file_size(xfer_src[i]));
+        int copy_rc;
+        if (scr_crc_on_flush) {
+          /* checksum the buffers as they pass through the copy */
+          uLong crc = scr_crc_init();
+          copy_rc = scr_file_copy_opts(xfer_src[i], xfer_dst[i], scr_file_buf_size, &crc, scr_flush_direct);
+          if (copy_rc == SCR_SUCCESS) {
+            copy_rc = scr_flush_sync_crc_check(xfer_src[i], crc);
+          }
+        } else {
+          copy_rc = scr_file_copy_opts(xfer_src[i], xfer_dst[i], scr_file_buf_size, NULL, scr_flush_direct);
+        }
+        if (copy_rc != SCR_SUCCESS) {
+          success = 0;
+          break;
+        }
+      }
+    } else {
+      /* write files (via AXL) */
+      if (scr_axl(dset_name, xfer_numfiles, xfer_src, xfer_dst, xfer_type, scr_comm_world) != SCR_SUCCESS) {
+        success = 0;
+      }
+    }
+
+    /* end the dedup pass, persisting the new index only if the
+     * copies all succeeded */
+    if (use_dedup) {
+      scr_dedup_stop(success);
+    }
+
+    /* remember what we just flushed so later incremental flushes
+     * can skip files that have not changed */
+    if (scr_flush_incremental) {
+      if (success) {
+        scr_flush_sync_record(xfer_numfiles, xfer_src, xfer_dst);
+      }
+      scr_free(&xfer_src);
+      scr_free(&xfer_dst);
     }
   } else {
     /* just stat the file to check that it exists */
@@ -130,6 +896,22 @@ static int scr_flush_sync_data(scr_cache_index* cindex, int id, kvtree* file_lis
     }
   }
 
+transfer_done:
+
+  /* transfer is over, stop folding CRCs into copies */
+  scr_flush_sync_crc_files = NULL;
+
+  /* tear down the bandwidth limiter */
+  if (bucketp != NULL) {
+    scr_flush_bucket_destroy(bucketp);
+  }
+
+  /* free container layout */
+  scr_free(&ctr_offsets);
+  scr_free(&ctr_lengths);
+  scr_free(&ctr_rel);
+  scr_free(&ctr_path);
+
   /* free path and file name */
   scr_free(&rank2file);
   spath_delete(&dataset_path);
@@ -219,12 +1001,21 @@ int scr_flush_sync(scr_cache_index* cindex, int id)
     flushed = SCR_FAILURE;
   }
 
-  /* write the data out to files */
+  /* write the data out to files, timing the data phase on each
+   * process so we can spot nodes writing slower than their peers */
+  double data_start = MPI_Wtime();
   if (flushed == SCR_SUCCESS &&
       scr_flush_sync_data(cindex, id, file_list) != SCR_SUCCESS)
   {
     flushed = SCR_FAILURE;
   }
+  double data_secs = MPI_Wtime() - data_start;
+
+  /* compare per-node bandwidth of this flush against the other nodes,
+   * flagging any node that persistently trails the rest */
+  if (flushed == SCR_SUCCESS) {
+    scr_flush_straggler_check(file_list, data_secs);
+  }
 
   /* write summary file */
   if (flushed == SCR_SUCCESS &&
@@ -290,6 +1081,10 @@ int scr_flush_sync(scr_cache_index* cindex, int id)
         &timestamp_start, &time_diff, &total_bytes, &total_files
       );
     }
+
+    /* record the flush in our stats counters */
+    scr_stats_sample(SCR_STATS_PHASE_FLUSH, time_diff);
+    scr_stats_add_bytes(scr_prefix, total_bytes, total_files);
   }
 
   /* delete the dataset object */
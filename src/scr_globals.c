@@ -70,8 +70,9 @@ char* scr_transfer_file    = NULL;
 
 /* we keep the halt, flush, and nodes files in the prefix directory
  * so that the batch script and / or external commands can access them */
-spath* scr_halt_file  = NULL;
-spath* scr_flush_file = NULL;
+spath* scr_halt_file   = NULL;
+spath* scr_flush_file  = NULL;
+spath* scr_status_file = NULL;
 spath* scr_nodes_file = NULL;
 
 scr_cache_index* scr_cindex  = NULL; /* tracks datasets in cache */
@@ -103,25 +104,51 @@ char* scr_log_db_name     = NULL;                  /* mysql database name */
 
 int scr_cache_size    = SCR_CACHE_SIZE;   /* set number of checkpoints to keep at one time */
 int scr_copy_type     = SCR_COPY_TYPE;    /* select which redundancy algorithm to use */
+int scr_partner_rma   = SCR_PARTNER_RMA;  /* whether to use native one-sided partner copies */
 char* scr_group       = NULL;             /* name of process group likely to fail */
 int scr_set_size      = SCR_SET_SIZE;     /* specify number of tasks in redundancy set */
 int scr_set_failures  = SCR_SET_FAILURES; /* specify number of failures to tolerate per set */
+int scr_encode_threads = SCR_ENCODE_THREADS; /* number of threads to use when computing redundancy encoding */
+int scr_encode_async  = SCR_ENCODE_ASYNC;  /* whether to defer redundancy encoding to a background thread */
+int scr_flush_pipeline = SCR_FLUSH_PIPELINE; /* whether to start the async flush before a deferred encode finishes */
 int scr_cache_bypass  = SCR_CACHE_BYPASS; /* default bypass, whether to directly read/write parallel file system */
+unsigned long scr_cache_pack_size = SCR_CACHE_PACK_SIZE; /* files below this size are packed into a per-rank packfile, 0 disables */
+int scr_topo_cache    = SCR_TOPO_CACHE;   /* whether to reuse a persisted topology snapshot to speed up SCR_Init */
+int scr_cache_mirror  = SCR_CACHE_MIRROR; /* whether to mirror bypass checkpoints back into cache in the background */
 
 size_t scr_mpi_buf_size  = SCR_MPI_BUF_SIZE;  /* set MPI buffer size to chunk file transfer */
 size_t scr_file_buf_size = SCR_FILE_BUF_SIZE; /* set buffer size to chunk file copies to/from parallel file system */
 
 int scr_halt_seconds     = SCR_HALT_SECONDS; /* secs remaining in allocation before job should be halted */
 int scr_halt_exit        = SCR_HALT_EXIT;    /* whether SCR will call exit if halt condition is detected */
+int scr_halt_watch       = SCR_HALT_WATCH;   /* whether rank 0 runs a thread to watch the halt file for changes */
+int scr_halt_watch_seconds = SCR_HALT_WATCH_SECONDS; /* secs between halt file polls by the watcher thread */
+
+int scr_stats_dump = SCR_STATS_DUMP; /* whether to dump per-rank performance counters as JSON at SCR_Finalize */
+int scr_trace      = SCR_TRACE;      /* whether to record events in a binary trace ring in the control directory */
 
 int   scr_purge            = 0;                    /* whether to delete all datasets from cache during SCR_Init */
 int   scr_distribute       = SCR_DISTRIBUTE;       /* whether to call scr_distribute_files during SCR_Init */
 int   scr_fetch            = SCR_FETCH;            /* whether to call scr_fetch_files during SCR_Init */
 int   scr_fetch_width      = SCR_FETCH_WIDTH;      /* specify number of processes to read files simultaneously */
+int   scr_fetch_threads    = SCR_FETCH_THREADS;    /* number of worker threads per process for fetch */
+int   scr_fetch_async      = SCR_FETCH_ASYNC;      /* whether SCR_Init may fetch in a background thread */
+int   scr_fetch_lazy       = SCR_FETCH_LAZY;       /* whether to fetch files on demand as restart routes them */
+int   scr_fetch_validate   = SCR_FETCH_VALIDATE;   /* whether to validate a fetch candidate before copying its files */
 int   scr_fetch_bypass     = SCR_FETCH_BYPASS;     /* whether to use implied bypass mode on fetch */
 char* scr_fetch_current    = NULL;                 /* name of checkpoint to start with during fetch */
+char* scr_fetch_type       = NULL;                 /* AXL transfer type used during fetch (NULL uses pthread) */
 int   scr_flush            = SCR_FLUSH;            /* how many checkpoints between flushes */
 int   scr_flush_width      = SCR_FLUSH_WIDTH;      /* specify number of processes to write files simultaneously */
+int   scr_flush_threads    = SCR_FLUSH_THREADS;    /* number of worker threads per process for synchronous flush */
+int   scr_flush_leaders    = SCR_FLUSH_LEADERS;    /* max number of PFS writer ranks per node during flush (0 for all) */
+int   scr_flush_container  = SCR_FLUSH_CONTAINER;  /* whether to pack files into per-node containers during flush */
+int   scr_flush_incremental = SCR_FLUSH_INCREMENTAL; /* whether to skip flushing files unchanged since last flush */
+int   scr_flush_straggler  = SCR_FLUSH_STRAGGLER;  /* consecutive slow flushes before a node is reported (0 disables) */
+int   scr_flush_compress   = SCR_FLUSH_COMPRESS;   /* whether to compress file data during flush (0 none, 1 zlib) */
+double scr_flush_bw        = SCR_FLUSH_BW;         /* aggregate bandwidth limit imposed during flush (0 disables) */
+double scr_flush_bw_bulk   = SCR_FLUSH_BW_BULK;    /* aggregate bandwidth limit for bulk-priority datasets (0 disables) */
+int   scr_rank2file_shard  = SCR_RANK2FILE_SHARD;  /* ranks per rank2file part file during flush (0 adapts to job size) */
 int   scr_flush_on_restart = SCR_FLUSH_ON_RESTART; /* specify whether to flush cache on restart */
 int   scr_global_restart   = SCR_GLOBAL_RESTART;   /* set if code must be restarted from parallel file system */
 int   scr_drop_after_current = 0;                  /* whether to drop datasets from index that come after dataset named in SCR_Current */
@@ -129,9 +156,13 @@ int   scr_drop_after_current = 0;                  /* whether to drop datasets f
 int    scr_flush_async             = SCR_FLUSH_ASYNC;         /* whether to use asynchronous flush */
 double scr_flush_async_bw          = SCR_FLUSH_ASYNC_BW;      /* bandwidth limit imposed during async flush */
 double scr_flush_async_percent     = SCR_FLUSH_ASYNC_PERCENT; /* runtime limit imposed during async flush */
-int    scr_flush_async_in_progress = 0;                       /* tracks whether an async flush is currently underway */
-int    scr_flush_async_dataset_id  = -1;                      /* tracks the id of the checkpoint being flushed */
+int    scr_flush_async_depth       = SCR_FLUSH_ASYNC_DEPTH;   /* max number of datasets that may be flushing at the same time */
+int    scr_flush_async_stall_secs  = SCR_FLUSH_ASYNC_STALL_SECONDS; /* seconds without progress before an async flush is restarted (0 disables) */
+int    scr_flush_handoff           = SCR_FLUSH_HANDOFF;       /* whether to hand outstanding flushes to the scr_flush_handoff helper at finalize */
+int    scr_flush_async_in_progress = 0;                       /* tracks the number of async flushes currently underway */
+int    scr_flush_async_dataset_id  = -1;                      /* tracks the id of the most recent checkpoint being flushed */
 double scr_flush_async_bytes       = 0.0;                     /* records the total number of bytes to be flushed */
+unsigned long scr_flush_chunk_size = SCR_FLUSH_CHUNK_SIZE;    /* chunk size for per-chunk crc32 markers used to resume interrupted flushes */
 
 int scr_prefix_size  = SCR_PREFIX_SIZE; /* max number of checkpoints to keep in prefix directory */
 int scr_prefix_purge = 0;               /* whether to delete all datasets listed in index file during SCR_Init */
@@ -140,9 +171,21 @@ int scr_crc_on_copy   = SCR_CRC_ON_COPY;   /* whether to enable crc32 checks dur
 int scr_crc_on_flush  = SCR_CRC_ON_FLUSH;  /* whether to enable crc32 checks during flush and fetch */
 int scr_crc_on_delete = SCR_CRC_ON_DELETE; /* whether to enable crc32 checks when deleting checkpoints */
 
+int    scr_scrub    = SCR_SCRUB;    /* whether to verify cached files against recorded CRCs in the background */
+double scr_scrub_bw = SCR_SCRUB_BW; /* per-process read bandwidth consumed by the scrubber (0 disables throttle) */
+
+int scr_delete_async = SCR_DELETE_ASYNC; /* whether to delete evicted datasets from cache in a background thread */
+
+int scr_flush_direct = SCR_FLUSH_DIRECT; /* whether to write flushed files to the parallel file system with O_DIRECT */
+
+int    scr_dedup       = SCR_DEDUP;       /* whether to dedup unchanged blocks between consecutive flushes */
+size_t scr_dedup_block = SCR_DEDUP_BLOCK; /* block size used to hash and match content during dedup */
+
 int    scr_checkpoint_interval = SCR_CHECKPOINT_INTERVAL; /* times to call Need_checkpoint between checkpoints */
 int    scr_checkpoint_seconds  = SCR_CHECKPOINT_SECONDS;  /* min number of seconds between checkpoints */
 double scr_checkpoint_overhead = SCR_CHECKPOINT_OVERHEAD; /* max allowed overhead for checkpointing */
+double scr_checkpoint_mtbf_node = SCR_CHECKPOINT_MTBF_NODE; /* node MTBF in seconds, drives Young/Daly interval */
+int    scr_checkpoint_adaptive  = SCR_CHECKPOINT_ADAPTIVE;  /* whether to retune reddesc intervals from measured costs */
 int    scr_need_checkpoint_count = 0;   /* tracks the number of times Need_checkpoint has been called */
 double scr_time_checkpoint_total = 0.0; /* keeps a running total of the time spent to checkpoint */
 int    scr_time_checkpoint_count = 0;   /* keeps a running count of the number of checkpoints taken */
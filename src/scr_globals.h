@@ -76,12 +76,14 @@
 #include "scr.h"
 #include "scr_err.h"
 #include "scr_io.h"
+#include "scr_crc.h"
 #include "scr_util.h"
 #include "scr_util_mpi.h"
 #include "spath_mpi.h"
 #include "scr_meta.h"
 #include "scr_dataset.h"
 #include "scr_halt.h"
+#include "scr_status.h"
 #include "scr_log.h"
 #include "scr_cache_index.h"
 #include "scr_filemap.h"
@@ -93,10 +95,14 @@
 #include "scr_groupdesc.h"
 #include "scr_storedesc.h"
 #include "scr_reddesc.h"
+#include "scr_partner.h"
+#include "scr_pack.h"
 #include "scr_summary.h"
 #include "scr_flush_file_mpi.h"
 #include "scr_cache.h"
 #include "scr_cache_rebuild.h"
+#include "scr_reap.h"
+#include "scr_dedup.h"
 #include "scr_prefix.h"
 #include "scr_fetch.h"
 #include "scr_flush.h"
@@ -130,6 +136,7 @@ extern char* scr_transfer_file;
  * so that the batch script and / or external commands can access them */
 extern spath* scr_halt_file;
 extern spath* scr_flush_file;
+extern spath* scr_status_file;
 extern spath* scr_nodes_file;
 
 extern scr_cache_index* scr_cindex; /* tracks datasets in cache */
@@ -161,25 +168,50 @@ extern char* scr_log_db_name;     /* mysql database name */
 
 extern int scr_cache_size;    /* number of checkpoints to keep in cache at one time */
 extern int scr_copy_type;     /* select which redundancy algorithm to use */
+extern int scr_partner_rma;   /* whether to use native one-sided partner copies */
 extern char* scr_group;       /* name of process group likely to fail */
 extern int scr_set_size;      /* specify number of tasks in redundancy set */
 extern int scr_set_failures;  /* specify number of failures to tolerate per set */
+extern int scr_encode_threads; /* number of threads to use when computing redundancy encoding */
+extern int scr_encode_async;  /* whether to defer redundancy encoding to a background thread */
+extern int scr_flush_pipeline; /* whether to start the async flush before a deferred encode finishes */
 extern int scr_cache_bypass;  /* default bypass, whether to directly read/write parallel file system */
+extern unsigned long scr_cache_pack_size; /* files below this size are packed into a per-rank packfile, 0 disables */
+extern int scr_topo_cache;    /* whether to reuse a persisted topology snapshot to speed up SCR_Init */
+extern int scr_cache_mirror;  /* whether to mirror bypass checkpoints back into cache in the background */
 
 extern size_t scr_mpi_buf_size;  /* set MPI buffer size to chunk file transfer */
 extern size_t scr_file_buf_size; /* set buffer size to chunk file copies to/from parallel file system */
 
 extern int scr_halt_seconds; /* secs remaining in allocation before job should be halted */
 extern int scr_halt_exit;    /* whether SCR will call exit if halt condition is detected */
+extern int scr_halt_watch;   /* whether rank 0 runs a thread to watch the halt file for changes */
+extern int scr_halt_watch_seconds; /* secs between halt file polls by the watcher thread */
+extern int scr_stats_dump;   /* whether to dump per-rank performance counters as JSON at SCR_Finalize */
+extern int scr_trace;        /* whether to record events in a binary trace ring in the control directory */
 
 extern int   scr_purge;            /* delete all datasets from cache on restart for debugging */
 extern int   scr_distribute;       /* whether to call scr_distribute_files during SCR_Init */
 extern int   scr_fetch;            /* whether to call scr_fetch_files during SCR_Init */
 extern int   scr_fetch_width;      /* specify number of processes to read files simultaneously */
+extern int   scr_fetch_threads;    /* number of worker threads per process for fetch */
+extern int   scr_fetch_async;      /* whether SCR_Init may fetch in a background thread */
+extern int   scr_fetch_lazy;       /* whether to fetch files on demand as restart routes them */
+extern int   scr_fetch_validate;   /* whether to validate a fetch candidate before copying its files */
 extern int   scr_fetch_bypass;     /* whether to use implied bypass on fetch operations */
 extern char* scr_fetch_current;    /* specify name of checkpoint to start with in fetch_latest */
+extern char* scr_fetch_type;       /* AXL transfer type used during fetch (NULL uses pthread) */
 extern int   scr_flush;            /* how many checkpoints between flushes */
 extern int   scr_flush_width;      /* specify number of processes to write files simultaneously */
+extern int   scr_flush_threads;    /* number of worker threads per process for synchronous flush */
+extern int   scr_flush_leaders;    /* max number of PFS writer ranks per node during flush (0 for all) */
+extern int   scr_flush_container;  /* whether to pack files into per-node containers during flush */
+extern int   scr_flush_incremental; /* whether to skip flushing files unchanged since last flush */
+extern int   scr_flush_straggler;  /* consecutive slow flushes before a node is reported (0 disables) */
+extern int   scr_flush_compress;   /* whether to compress file data during flush (0 none, 1 zlib) */
+extern double scr_flush_bw;        /* aggregate bandwidth limit imposed during flush (0 disables) */
+extern double scr_flush_bw_bulk;   /* aggregate bandwidth limit for bulk-priority datasets (0 disables) */
+extern int   scr_rank2file_shard;  /* ranks per rank2file part file during flush (0 adapts to job size) */
 extern int   scr_flush_on_restart; /* specify whether to flush cache on restart */
 extern int   scr_global_restart;   /* set if code must be restarted from parallel file system */
 extern int   scr_drop_after_current; /* auto-drop datasets from index that come after named checkpoint when calling SCR_Current */
@@ -190,17 +222,33 @@ extern int scr_prefix_purge; /* whether to delete all datasets listed in index f
 extern int scr_flush_async;             /* whether to use asynchronous flush */
 extern double scr_flush_async_bw;       /* bandwidth limit imposed during async flush */
 extern double scr_flush_async_percent;  /* runtime limit imposed during async flush */
-extern int scr_flush_async_in_progress; /* tracks whether an async flush is currently underway */
-extern int scr_flush_async_dataset_id;  /* tracks the id of the checkpoint being flushed */
+extern int scr_flush_async_depth;       /* max number of datasets that may be flushing at the same time */
+extern int scr_flush_async_stall_secs;  /* seconds without progress before an async flush is restarted (0 disables) */
+extern int scr_flush_handoff;           /* whether to hand outstanding flushes to the scr_flush_handoff helper at finalize */
+extern int scr_flush_async_in_progress; /* tracks the number of async flushes currently underway */
+extern int scr_flush_async_dataset_id;  /* tracks the id of the most recent checkpoint being flushed */
 extern double scr_flush_async_bytes;    /* records the total number of bytes to be flushed */
+extern unsigned long scr_flush_chunk_size; /* chunk size for per-chunk crc32 markers used to resume interrupted flushes */
 
 extern int scr_crc_on_copy;   /* whether to enable crc32 checks during scr_swap_files() */
 extern int scr_crc_on_flush;  /* whether to enable crc32 checks during flush and fetch */
 extern int scr_crc_on_delete; /* whether to enable crc32 checks when deleting checkpoints */
 
+extern int    scr_scrub;    /* whether to verify cached files against recorded CRCs in the background */
+extern double scr_scrub_bw; /* per-process read bandwidth consumed by the scrubber (0 disables throttle) */
+
+extern int scr_delete_async; /* whether to delete evicted datasets from cache in a background thread */
+
+extern int scr_flush_direct; /* whether to write flushed files to the parallel file system with O_DIRECT */
+
+extern int    scr_dedup;       /* whether to dedup unchanged blocks between consecutive flushes */
+extern size_t scr_dedup_block; /* block size used to hash and match content during dedup */
+
 extern int    scr_checkpoint_interval;   /* times to call Need_checkpoint between checkpoints */
 extern int    scr_checkpoint_seconds;    /* min number of seconds between checkpoints */
 extern double scr_checkpoint_overhead;   /* max allowed overhead for checkpointing */
+extern double scr_checkpoint_mtbf_node;  /* node MTBF in seconds, drives Young/Daly interval */
+extern int    scr_checkpoint_adaptive;   /* whether to retune reddesc intervals from measured costs */
 extern int    scr_need_checkpoint_count; /* tracks the number of times Need_checkpoint has been called */
 extern double scr_time_checkpoint_total; /* keeps a running total of the time spent to checkpoint */
 extern int    scr_time_checkpoint_count; /* keeps a running count of the number of checkpoints taken */
@@ -87,6 +87,332 @@ static int scr_groupdesc_create_by_str(
   return SCR_SUCCESS;
 }
 
+/* build a group descriptor from a precomputed color,
+ * a plain integer split is far cheaper than sorting hostnames
+ * across the job with rankstr_mpi_comm_split */
+static int scr_groupdesc_create_by_color(
+  scr_groupdesc* d, int index, const char* key, int color, MPI_Comm comm)
+{
+  /* initialize the descriptor */
+  scr_groupdesc_init(d);
+
+  /* enable descriptor, record its index, and copy its name */
+  d->enabled = 1;
+  d->index   = index;
+  d->name    = strdup(key);
+
+  /* split by color, keying on world rank to keep the same ordering
+   * the hostname-based split produces */
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_split(comm, color, rank, &d->comm);
+
+  /* find our position in the group communicator */
+  MPI_Comm_rank(d->comm, &d->rank);
+  MPI_Comm_size(d->comm, &d->ranks);
+
+  return SCR_SUCCESS;
+}
+
+/*
+=========================================
+Topology snapshot
+
+Group setup sorts hostnames across the job for every group, which
+dominates SCR_Init time at scale even though jobs often restart many
+times within the same allocation and recompute identical answers.
+After a fresh setup, rank 0 persists each rank's hostname and group
+colors to a snapshot in the prefix directory.  The next SCR_Init
+loads the snapshot, scatters each rank its record, and verifies with
+one allreduce that hostnames and configured groups still match, in
+which case communicators come from cheap integer splits instead.
+=========================================
+*/
+
+#define SCR_TOPO_KEY_VERSION ("VERSION")
+#define SCR_TOPO_KEY_RANKS   ("RANKS")
+#define SCR_TOPO_KEY_NDESCS  ("NDESCS")
+#define SCR_TOPO_KEY_GROUP   ("GROUP")
+#define SCR_TOPO_KEY_RANK    ("RANK")
+#define SCR_TOPO_KEY_HOST    ("HOST")
+#define SCR_TOPO_KEY_COLOR   ("COLOR")
+
+/* bump when the snapshot layout changes so stale files recompile */
+#define SCR_TOPO_VERSION (1)
+
+/* fixed field width for hostnames in scatter/gather buffers */
+#define SCR_TOPO_HOSTLEN (256)
+
+/* return path to the topology snapshot in the prefix directory,
+ * caller must free the returned string */
+static char* scr_groupdesc_topo_file(void)
+{
+  if (scr_prefix_scr == NULL) {
+    return NULL;
+  }
+  spath* path = spath_from_str(scr_prefix_scr);
+  spath_append_str(path, "topo.scr");
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* attempt to build group descriptors from the topology snapshot,
+ * returns SCR_SUCCESS if the snapshot was current and the
+ * descriptors have been created, SCR_FAILURE means the caller
+ * should fall back to a fresh setup */
+static int scr_groupdescs_create_cached(MPI_Comm comm)
+{
+  int g;
+  char gstr[32];
+
+  int rank, ranks;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &ranks);
+
+  /* rank 0 loads the snapshot and packs per-rank records */
+  int valid   = 1;
+  int ndescs  = 0;
+  int ngroups = 0;
+  kvtree* topo = NULL;
+  char* hosts  = NULL;
+  int* colors  = NULL;
+  if (rank == 0) {
+    char* file = scr_groupdesc_topo_file();
+    topo = kvtree_new();
+    if (file == NULL ||
+        scr_file_is_readable(file) != SCR_SUCCESS ||
+        kvtree_read_file(file, topo) != KVTREE_SUCCESS)
+    {
+      valid = 0;
+    }
+    scr_free(&file);
+
+    /* a snapshot from another layout or another job size is stale */
+    if (valid) {
+      int version = -1;
+      kvtree_util_get_int(topo, SCR_TOPO_KEY_VERSION, &version);
+      int file_ranks = -1;
+      kvtree_util_get_int(topo, SCR_TOPO_KEY_RANKS, &file_ranks);
+      kvtree_util_get_int(topo, SCR_TOPO_KEY_NDESCS, &ndescs);
+      ngroups = kvtree_size(kvtree_get(topo, SCR_TOPO_KEY_GROUP));
+      if (version != SCR_TOPO_VERSION ||
+          file_ranks != ranks ||
+          ndescs < ngroups ||
+          ngroups < 2)
+      {
+        valid = 0;
+      }
+    }
+
+    /* pack hostname and color arrays for the scatter */
+    if (valid) {
+      hosts  = (char*) SCR_MALLOC(ranks * SCR_TOPO_HOSTLEN);
+      colors = (int*)  SCR_MALLOC(ranks * ngroups * sizeof(int));
+      int r;
+      for (r = 0; r < ranks && valid; r++) {
+        kvtree* rh = kvtree_get_kv_int(topo, SCR_TOPO_KEY_RANK, r);
+        char* host = NULL;
+        kvtree_util_get_str(rh, SCR_TOPO_KEY_HOST, &host);
+        kvtree* ch = kvtree_get(rh, SCR_TOPO_KEY_COLOR);
+        if (host == NULL || ch == NULL) {
+          valid = 0;
+          break;
+        }
+        strncpy(&hosts[r * SCR_TOPO_HOSTLEN], host, SCR_TOPO_HOSTLEN);
+        hosts[r * SCR_TOPO_HOSTLEN + SCR_TOPO_HOSTLEN - 1] = '\0';
+        for (g = 0; g < ngroups; g++) {
+          snprintf(gstr, sizeof(gstr), "%d", g);
+          if (kvtree_util_get_int(ch, gstr, &colors[r * ngroups + g]) != KVTREE_SUCCESS) {
+            valid = 0;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  /* everyone learns whether rank 0 has a usable snapshot */
+  MPI_Bcast(&valid, 1, MPI_INT, 0, comm);
+  if (! valid) {
+    if (rank == 0) {
+      scr_free(&colors);
+      scr_free(&hosts);
+      kvtree_delete(&topo);
+    }
+    return SCR_FAILURE;
+  }
+
+  /* distribute snapshot shape and the group names in order */
+  MPI_Bcast(&ndescs,  1, MPI_INT, 0, comm);
+  MPI_Bcast(&ngroups, 1, MPI_INT, 0, comm);
+  char** names = (char**) SCR_MALLOC(ngroups * sizeof(char*));
+  for (g = 0; g < ngroups; g++) {
+    char* name = NULL;
+    if (rank == 0) {
+      snprintf(gstr, sizeof(gstr), "%d", g);
+      kvtree_util_get_str(kvtree_get(topo, SCR_TOPO_KEY_GROUP), gstr, &name);
+      if (name == NULL) {
+        name = "";
+      }
+      scr_str_bcast(&name, 0, comm);
+      names[g] = strdup(name);
+    } else {
+      scr_str_bcast(&name, 0, comm);
+      names[g] = name;
+    }
+  }
+
+  /* hand each rank its recorded hostname and colors */
+  char myhost[SCR_TOPO_HOSTLEN];
+  MPI_Scatter(hosts, SCR_TOPO_HOSTLEN, MPI_CHAR,
+              myhost, SCR_TOPO_HOSTLEN, MPI_CHAR, 0, comm);
+  int* mycolors = (int*) SCR_MALLOC(ngroups * sizeof(int));
+  MPI_Scatter(colors, ngroups, MPI_INT, mycolors, ngroups, MPI_INT, 0, comm);
+
+  /* the one cheap check that stands in for the full setup: we must
+   * still be the rank the snapshot thinks we are, and our config
+   * must still define exactly the custom groups it recorded */
+  int match = (strcmp(myhost, scr_my_hostname) == 0);
+  kvtree* groups = kvtree_get_kv(
+    scr_groupdesc_hash, SCR_CONFIG_KEY_GROUPDESC, scr_my_hostname
+  );
+  if (kvtree_size(groups) != ngroups - 2) {
+    match = 0;
+  }
+  for (g = 2; g < ngroups && match; g++) {
+    if (kvtree_get(groups, names[g]) == NULL) {
+      match = 0;
+    }
+  }
+
+  int all_match = scr_alltrue(match, comm);
+  if (all_match) {
+    /* snapshot checks out, build all communicators with integer splits */
+    scr_ngroupdescs = ndescs;
+    scr_groupdescs = (scr_groupdesc*) SCR_MALLOC(scr_ngroupdescs * sizeof(scr_groupdesc));
+    for (g = 0; g < scr_ngroupdescs; g++) {
+      scr_groupdesc_init(&scr_groupdescs[g]);
+    }
+    for (g = 0; g < ngroups; g++) {
+      scr_groupdesc_create_by_color(&scr_groupdescs[g], g, names[g], mycolors[g], comm);
+    }
+    if (rank == 0) {
+      scr_dbg(2, "Reused topology snapshot to set up %d group(s)", ngroups);
+    }
+  }
+
+  /* free scratch space */
+  for (g = 0; g < ngroups; g++) {
+    scr_free(&names[g]);
+  }
+  scr_free(&names);
+  scr_free(&mycolors);
+  if (rank == 0) {
+    scr_free(&colors);
+    scr_free(&hosts);
+    kvtree_delete(&topo);
+  }
+
+  return all_match ? SCR_SUCCESS : SCR_FAILURE;
+}
+
+/* record the topology we just computed so the next SCR_Init in
+ * this allocation can skip the hostname sorts, rank 0 writes the
+ * snapshot to a temporary file and renames it into place */
+static int scr_groupdescs_topo_store(MPI_Comm comm)
+{
+  int g;
+  char gstr[32];
+
+  int rank, ranks;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &ranks);
+
+  /* count created groups, they occupy the leading descriptor slots
+   * and are identical in number and order on every rank */
+  int ngroups = 0;
+  for (g = 0; g < scr_ngroupdescs; g++) {
+    if (scr_groupdescs[g].enabled) {
+      ngroups++;
+    }
+  }
+
+  /* our color for a group is the world rank of its leader */
+  int* mycolors = (int*) SCR_MALLOC(ngroups * sizeof(int));
+  for (g = 0; g < ngroups; g++) {
+    int color = scr_my_rank_world;
+    MPI_Bcast(&color, 1, MPI_INT, 0, scr_groupdescs[g].comm);
+    mycolors[g] = color;
+  }
+
+  /* gather hostnames and colors to rank 0 */
+  char myhost[SCR_TOPO_HOSTLEN];
+  memset(myhost, 0, sizeof(myhost));
+  strncpy(myhost, scr_my_hostname, SCR_TOPO_HOSTLEN - 1);
+  char* hosts = NULL;
+  int* colors = NULL;
+  if (rank == 0) {
+    hosts  = (char*) SCR_MALLOC(ranks * SCR_TOPO_HOSTLEN);
+    colors = (int*)  SCR_MALLOC(ranks * ngroups * sizeof(int));
+  }
+  MPI_Gather(myhost, SCR_TOPO_HOSTLEN, MPI_CHAR,
+             hosts,  SCR_TOPO_HOSTLEN, MPI_CHAR, 0, comm);
+  MPI_Gather(mycolors, ngroups, MPI_INT, colors, ngroups, MPI_INT, 0, comm);
+  scr_free(&mycolors);
+
+  /* rank 0 assembles and writes the snapshot */
+  int rc = SCR_SUCCESS;
+  if (rank == 0) {
+    kvtree* topo = kvtree_new();
+    kvtree_util_set_int(topo, SCR_TOPO_KEY_VERSION, SCR_TOPO_VERSION);
+    kvtree_util_set_int(topo, SCR_TOPO_KEY_RANKS,   ranks);
+    kvtree_util_set_int(topo, SCR_TOPO_KEY_NDESCS,  scr_ngroupdescs);
+
+    /* record group names in creation order */
+    kvtree* gh = kvtree_set(topo, SCR_TOPO_KEY_GROUP, kvtree_new());
+    for (g = 0; g < ngroups; g++) {
+      snprintf(gstr, sizeof(gstr), "%d", g);
+      kvtree_util_set_str(gh, gstr, scr_groupdescs[g].name);
+    }
+
+    /* record each rank's hostname and colors */
+    int r;
+    for (r = 0; r < ranks; r++) {
+      kvtree* rh = kvtree_set_kv_int(topo, SCR_TOPO_KEY_RANK, r);
+      kvtree_util_set_str(rh, SCR_TOPO_KEY_HOST, &hosts[r * SCR_TOPO_HOSTLEN]);
+      kvtree* ch = kvtree_set(rh, SCR_TOPO_KEY_COLOR, kvtree_new());
+      for (g = 0; g < ngroups; g++) {
+        snprintf(gstr, sizeof(gstr), "%d", g);
+        kvtree_util_set_int(ch, gstr, colors[r * ngroups + g]);
+      }
+    }
+
+    /* write to a temporary name and rename into place so a reader
+     * never sees a half-written snapshot */
+    char* file = scr_groupdesc_topo_file();
+    if (file != NULL) {
+      size_t tmp_len = strlen(file) + 32;
+      char* tmp_file = (char*) SCR_MALLOC(tmp_len);
+      snprintf(tmp_file, tmp_len, "%s.%d", file, (int) getpid());
+      if (kvtree_write_file(tmp_file, topo) != KVTREE_SUCCESS) {
+        rc = SCR_FAILURE;
+      } else if (rename(tmp_file, file) != 0) {
+        scr_file_unlink(tmp_file);
+        rc = SCR_FAILURE;
+      }
+      scr_free(&tmp_file);
+      scr_free(&file);
+    }
+
+    kvtree_delete(&topo);
+    scr_free(&colors);
+    scr_free(&hosts);
+  }
+
+  return rc;
+}
+
 /*
 =========================================
 Routines that operate on scr_groupdescs array
@@ -137,6 +463,13 @@ int scr_groupdescs_create(MPI_Comm comm)
   int i;
   int all_valid = 1;
 
+  /* when the topology snapshot from a previous run in this
+   * allocation still matches, it builds all of the descriptors
+   * without sorting hostnames across the job */
+  if (scr_topo_cache && scr_groupdescs_create_cached(comm) == SCR_SUCCESS) {
+    return SCR_SUCCESS;
+  }
+
   /* get our rank in comm */
   int rank;
   MPI_Comm_rank(comm, &rank);
@@ -242,6 +575,12 @@ int scr_groupdescs_create(MPI_Comm comm)
     }
   }
 
+  /* record the topology we just computed so the next run in this
+   * allocation can reuse it */
+  if (scr_topo_cache) {
+    scr_groupdescs_topo_store(comm);
+  }
+
   /* determine whether everyone found a valid group descriptor */
   if (! all_valid) {
     return SCR_FAILURE;
@@ -16,6 +16,7 @@
 #include "scr_err.h"
 #include "scr_util.h"
 #include "scr_halt.h"
+#include "scr_status.h"
 
 #include "kvtree.h"
 #include "spath.h"
@@ -81,6 +82,116 @@ cleanup:
   return rc;
 }
 
+/* refresh the halt summary in the binary status file,
+ * which lives next to the halt file */
+static void scr_halt_update_status(const spath* file_path, const kvtree* hash)
+{
+  spath* status_path = spath_dup(file_path);
+  spath_dirname(status_path);
+  spath_append_str(status_path, SCR_STATUS_FILENAME);
+  scr_status_update_halt(status_path, hash);
+  spath_delete(&status_path);
+}
+
+/* read in halt file (which program may have changed), apply all set and unset
+ * operations given in update, and write out halt file all while holding an
+ * exclusive lock, returns resulting file contents in hash */
+int scr_halt_sync_and_set(const spath* file_path, const scr_halt_update* update, kvtree* hash)
+{
+  /* convert path to string */
+  char* file = spath_strdup(file_path);
+
+  /* TODO: sleep and try the open several times if the first fails */
+  /* open the halt file for reading */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(file, O_RDWR | O_CREAT, mode_file);
+  if (fd < 0) {
+    scr_err("Opening file for write: scr_open(%s) errno=%d %s @ %s:%d",
+      file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    scr_free(&file);
+    return SCR_FAILURE;
+  }
+
+  /* acquire an exclusive file lock before reading,
+   * held across all updates so the whole batch costs one lock cycle */
+  int ret = scr_file_lock_write(file, fd);
+  if (ret != SCR_SUCCESS) {
+    scr_close(file, fd);
+    scr_free(&file);
+    return ret;
+  }
+
+  /* read in the current data from the file */
+  kvtree_read_fd(file, fd, hash);
+
+  /* set / unset values in file */
+  if (update->set_reason) {
+    kvtree_unset(hash, SCR_HALT_KEY_EXIT_REASON);
+    kvtree_set_kv(hash, SCR_HALT_KEY_EXIT_REASON, update->value_reason);
+  } else if (update->unset_reason) {
+    kvtree_unset(hash, SCR_HALT_KEY_EXIT_REASON);
+  }
+
+  if (update->set_checkpoints) {
+    kvtree_unset(hash, SCR_HALT_KEY_CHECKPOINTS);
+    kvtree_setf(hash, NULL, "%s %lu", SCR_HALT_KEY_CHECKPOINTS, update->value_checkpoints);
+  } else if (update->unset_checkpoints) {
+    kvtree_unset(hash, SCR_HALT_KEY_CHECKPOINTS);
+  }
+
+  if (update->set_before) {
+    kvtree_unset(hash, SCR_HALT_KEY_EXIT_BEFORE);
+    kvtree_setf(hash, NULL, "%s %lu", SCR_HALT_KEY_EXIT_BEFORE, update->value_before);
+  } else if (update->unset_before) {
+    kvtree_unset(hash, SCR_HALT_KEY_EXIT_BEFORE);
+  }
+
+  if (update->set_after) {
+    kvtree_unset(hash, SCR_HALT_KEY_EXIT_AFTER);
+    kvtree_setf(hash, NULL, "%s %lu", SCR_HALT_KEY_EXIT_AFTER, update->value_after);
+  } else if (update->unset_after) {
+    kvtree_unset(hash, SCR_HALT_KEY_EXIT_AFTER);
+  }
+
+  if (update->set_seconds) {
+    kvtree_unset(hash, SCR_HALT_KEY_SECONDS);
+    kvtree_setf(hash, NULL, "%s %lu", SCR_HALT_KEY_SECONDS, update->value_seconds);
+  } else if (update->unset_seconds) {
+    kvtree_unset(hash, SCR_HALT_KEY_SECONDS);
+  }
+
+  /* wind file pointer back to the start of the file */
+  lseek(fd, 0, SEEK_SET);
+
+  /* write our updated data */
+  ssize_t bytes_written = kvtree_write_fd(file, fd, hash);
+
+  /* truncate the file to the correct size (may be smaller than it was before) */
+  if (bytes_written >= 0) {
+    ftruncate(fd, (off_t) bytes_written);
+  }
+
+  /* release the file lock */
+  ret = scr_file_unlock(file, fd);
+  if (ret != SCR_SUCCESS) {
+    scr_close(file, fd);
+    scr_free(&file);
+    return ret;
+  }
+
+  /* close file */
+  scr_close(file, fd);
+
+  /* free file name string */
+  scr_free(&file);
+
+  /* refresh the halt summary in the status file for prejob tools */
+  scr_halt_update_status(file_path, hash);
+
+  return SCR_SUCCESS;
+}
+
 /* read in halt file (which user may have changed via scr_halt), update internal data structure,
  * optionally decrement the checkpoints_left field, and write out halt file all while locked */
 int scr_halt_sync_and_decrement(const spath* file_path, kvtree* hash, int dec_count)
@@ -182,6 +293,9 @@ int scr_halt_sync_and_decrement(const spath* file_path, kvtree* hash, int dec_co
   /* close file */
   scr_close(file, fd);
 
+  /* refresh the halt summary in the status file for prejob tools */
+  scr_halt_update_status(file_path, hash);
+
   /* success if we make it this far */
   rc = SCR_SUCCESS;
 
@@ -29,9 +29,36 @@ This file defines the data structure for a halt file.
 #define SCR_HALT_KEY_EXIT_AFTER  ("ExitAfter")
 #define SCR_HALT_KEY_CHECKPOINTS ("CheckpointsLeft")
 
-/* given the name of a halt file, read it and fill in data */
+/* describes a batch of halt file updates, so a caller can request
+ * several set and unset operations in one call and have them all
+ * applied under a single lock acquisition */
+typedef struct {
+  int set_checkpoints;
+  int set_before;
+  int set_after;
+  int set_seconds;
+  int set_reason;
+  int unset_checkpoints;
+  int unset_before;
+  int unset_after;
+  int unset_seconds;
+  int unset_reason;
+  int value_checkpoints;
+  int value_before;
+  int value_after;
+  int value_seconds;
+  char* value_reason;
+} scr_halt_update;
+
+/* given the name of a halt file, read it and fill in data,
+ * acquires a shared lock since the file is only read */
 int scr_halt_read(const spath* file, kvtree* hash);
 
+/* read in halt file (which program may have changed), apply all set and unset
+ * operations given in update, and write out halt file all while holding an
+ * exclusive lock, returns resulting file contents in hash */
+int scr_halt_sync_and_set(const spath* file, const scr_halt_update* update, kvtree* hash);
+
 /* read in halt file (which user may have changed via scr_halt), update internal data structure,
  * optionally decrement the checkpoints_left field, and write out halt file all while locked */
 int scr_halt_sync_and_decrement(const spath* file, kvtree* hash, int dec_count);
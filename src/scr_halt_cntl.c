@@ -45,6 +45,7 @@
 struct arglist {
   char* file;
   int list;
+  int query;
   int set_checkpoints;
   int set_before;
   int set_after;
@@ -71,6 +72,7 @@ int processArgs(int argc, char **argv, struct arglist* args)
   /* set to default values */
   args->file              = NULL;
   args->list              = 0;
+  args->query             = 0;
   args->set_checkpoints   = 0;
   args->set_before        = 0;
   args->set_after         = 0;
@@ -100,11 +102,14 @@ int processArgs(int argc, char **argv, struct arglist* args)
       }
       argptr = NULL;
 
-      if (strchr("l", flag)) {
+      if (strchr("lq", flag)) {
         switch(flag) {
         case 'l':
           args->list = 1;
           break;
+        case 'q':
+          args->query = 1;
+          break;
         }
         continue;
       }
@@ -185,102 +190,6 @@ int processArgs(int argc, char **argv, struct arglist* args)
   return 1;
 }
 
-/* read in halt file (which program may have changed), update internal data structure,
- * set & unset any fields, and write out halt file all while locked */
-int scr_halt_sync_and_set(const spath* file_path, struct arglist* args, kvtree* data)
-{
-  /* convert path to string */
-  char* file = spath_strdup(file_path);
-
-  /* TODO: sleep and try the open several times if the first fails */
-  /* open the halt file for reading */
-  mode_t mode_file = scr_getmode(1, 1, 0);
-  int fd = scr_open(file, O_RDWR | O_CREAT, mode_file);
-  if (fd < 0) {
-    scr_err("Opening file for write: scr_open(%s) errno=%d %s @ %s:%d",
-      file, errno, strerror(errno), __FILE__, __LINE__
-    );
-    /* restore the normal file mask */
-    scr_free(&file);
-    return SCR_FAILURE;
-  }
-
-  /* acquire an exclusive file lock before reading */
-  int ret = scr_file_lock_write(file,fd);
-  if (ret != SCR_SUCCESS) {
-    scr_close(file,fd);
-    scr_free(&file);
-    return ret;
-  }
-
-  /* read in the current data from the file */
-  kvtree_read_fd(file, fd, data);
-
-  /* set / unset values in file */
-  if (args->set_reason) {
-    kvtree_unset(data, SCR_HALT_KEY_EXIT_REASON);
-    kvtree_set_kv(data, SCR_HALT_KEY_EXIT_REASON, args->value_reason);
-  } else if (args->unset_reason) {
-    kvtree_unset(data, SCR_HALT_KEY_EXIT_REASON);
-  }
-
-  if (args->set_checkpoints) {
-    kvtree_unset(data, SCR_HALT_KEY_CHECKPOINTS);
-    kvtree_setf(data, NULL, "%s %lu", SCR_HALT_KEY_CHECKPOINTS, args->value_checkpoints);
-  } else if (args->unset_checkpoints) {
-    kvtree_unset(data, SCR_HALT_KEY_CHECKPOINTS);
-  }
-
-  if (args->set_before) {
-    kvtree_unset(data, SCR_HALT_KEY_EXIT_BEFORE);
-    kvtree_setf(data, NULL, "%s %lu", SCR_HALT_KEY_EXIT_BEFORE, args->value_before);
-  } else if (args->unset_before) {
-    kvtree_unset(data, SCR_HALT_KEY_EXIT_BEFORE);
-  }
-
-  if (args->set_after) {
-    kvtree_unset(data, SCR_HALT_KEY_EXIT_AFTER);
-    kvtree_setf(data, NULL, "%s %lu", SCR_HALT_KEY_EXIT_AFTER, args->value_after);
-  } else if (args->unset_after) {
-    kvtree_unset(data, SCR_HALT_KEY_EXIT_AFTER);
-  }
-
-  if (args->set_seconds) {
-    kvtree_unset(data, SCR_HALT_KEY_SECONDS);
-    kvtree_setf(data, NULL, "%s %lu", SCR_HALT_KEY_SECONDS, args->value_seconds);
-  } else if (args->unset_seconds) {
-    kvtree_unset(data, SCR_HALT_KEY_SECONDS);
-  }
-
-  /* wind file pointer back to the start of the file */
-  lseek(fd, 0, SEEK_SET);
-
-  /* write our updated data */
-  ssize_t bytes_written = kvtree_write_fd(file, fd, data);
-
-  /* truncate the file to the correct size (may be smaller than it was before) */
-  if (bytes_written >= 0) {
-    ftruncate(fd, (off_t) bytes_written);
-  }
-
-  /* release the file lock */
-  ret = scr_file_unlock(file, fd);
-  if (ret != SCR_SUCCESS) {
-    scr_close(file,fd);
-    scr_free(&file);
-    return ret;
-  }
-
-  /* close file */
-  scr_close(file, fd);
-
-  /* free file name string */
-  scr_free(&file);
-
-  /* write current values to halt file */
-  return SCR_SUCCESS;
-}
-
 int main (int argc, char *argv[])
 {
   int rc = 0;
@@ -297,8 +206,16 @@ int main (int argc, char *argv[])
   /* create path to halt file */
   spath* halt_file = spath_from_str(args.file);
 
-  if (args.list) {
-    /* if the user wants to list the values, just read the file, print the values, and exit */
+  /* check whether the user asked us to change anything */
+  int mutate = args.set_checkpoints   || args.unset_checkpoints ||
+               args.set_before        || args.unset_before      ||
+               args.set_after         || args.unset_after       ||
+               args.set_seconds       || args.unset_seconds     ||
+               args.set_reason        || args.unset_reason;
+
+  if (! mutate) {
+    /* nothing to change, just read the file with a shared lock,
+     * print the values, and exit without creating the file */
     char* halt_path = spath_strdup(halt_file);
     if (scr_file_is_readable(halt_path) == SCR_SUCCESS) {
       rc = scr_halt_read(halt_file, data);
@@ -338,7 +255,26 @@ int main (int argc, char *argv[])
 
     printf("\n");
 
-    rc = scr_halt_sync_and_set(halt_file, &args, data);
+    /* copy all requested changes into a single update,
+     * so they're applied under one lock acquisition */
+    scr_halt_update update;
+    update.set_checkpoints   = args.set_checkpoints;
+    update.set_before        = args.set_before;
+    update.set_after         = args.set_after;
+    update.set_seconds       = args.set_seconds;
+    update.set_reason        = args.set_reason;
+    update.unset_checkpoints = args.unset_checkpoints;
+    update.unset_before      = args.unset_before;
+    update.unset_after       = args.unset_after;
+    update.unset_seconds     = args.unset_seconds;
+    update.unset_reason      = args.unset_reason;
+    update.value_checkpoints = args.value_checkpoints;
+    update.value_before      = args.value_before;
+    update.value_after       = args.value_after;
+    update.value_seconds     = args.value_seconds;
+    update.value_reason      = args.value_reason;
+
+    rc = scr_halt_sync_and_set(halt_file, &update, data);
   }
 
   /* print the current settings */
@@ -388,6 +324,11 @@ int main (int argc, char *argv[])
     printf("  None\n");
   }
 
+  /* for a query, report via exit code whether any halt condition is set */
+  if (args.query) {
+    rc = have_one ? 0 : 1;
+  }
+
   /* delete path to halt file */
   spath_delete(&halt_file);
 
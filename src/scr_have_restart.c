@@ -12,8 +12,12 @@
 /* Utility to print the name of the latest restart */
 
 #include "scr.h"
+#include "scr_status.h"
 #include "mpi.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #ifdef SCR_GLOBALS_H
 #error "globals.h accessed from tools"
@@ -32,6 +36,54 @@ int main(int argc, char *argv[])
         fprintf(stderr, "%s: MPI_Init failed %d", myname, rc);
     }
 
+    rc = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rc != MPI_SUCCESS) {
+        fprintf(stderr, "%s: MPI_Comm_rank failed %d", myname, rc);
+    }
+
+    /* try the binary status file first, rank 0 reads it with one call
+     * and we skip SCR_Init, which reads configuration and inspects
+     * cache on every node, only trust the status file if it's at least
+     * as new as the flush file it summarizes */
+    int fast = 0;
+    if (rank == 0) {
+        /* like the library, the prefix defaults to the current working
+         * directory when SCR_PREFIX is not set */
+        char cwd[SCR_MAX_FILENAME];
+        const char* prefix = getenv("SCR_PREFIX");
+        if (prefix == NULL || strcmp(prefix, "") == 0) {
+            if (getcwd(cwd, sizeof(cwd)) != NULL) {
+                prefix = cwd;
+            } else {
+                prefix = NULL;
+            }
+        }
+
+        if (prefix != NULL) {
+            char status_file[SCR_MAX_FILENAME];
+            char flush_file[SCR_MAX_FILENAME];
+            snprintf(status_file, sizeof(status_file), "%s/.scr/%s", prefix, SCR_STATUS_FILENAME);
+            snprintf(flush_file,  sizeof(flush_file),  "%s/.scr/flush.scr", prefix);
+
+            scr_status status;
+            if (scr_status_fresh(status_file, flush_file) == SCR_SUCCESS &&
+                scr_status_read(status_file, &status) == SCR_SUCCESS)
+            {
+                fast = 1;
+                if ((status.flags & SCR_STATUS_FLAG_CKPT) && status.ckpt_name[0] != '\0') {
+                    printf("%s\n", status.ckpt_name);
+                }
+            }
+        }
+    }
+
+    /* all ranks must agree on whether the status file answered */
+    MPI_Bcast(&fast, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (fast) {
+        MPI_Finalize();
+        return 0;
+    }
+
     rc = SCR_Init();
     if (rc != SCR_SUCCESS) {
         fprintf(stderr, "%s: SCR_Init failed %d", myname, rc);
@@ -42,11 +94,6 @@ int main(int argc, char *argv[])
         fprintf(stderr, "%s: SCR_Have_restart failed %d", myname, rc);
     }
 
-    rc = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    if (rc != MPI_SUCCESS) {
-        fprintf(stderr, "%s: MPI_Comm_rank failed %d", myname, rc);
-    }
-
     if ( (rank == 0) && (flag > 0) ) {
         printf("%s\n", fname);
 
@@ -52,6 +52,8 @@
 
 #include <regex.h>
 
+#include <pthread.h>
+
 #define SCR_IO_KEY_DIR     ("DIR")
 #define SCR_IO_KEY_FILE    ("FILE")
 #define SCR_IO_KEY_UNKNOWN ("UNKNOWN")
@@ -63,6 +65,11 @@
 
 #define SCR_SCAN_KEY_MAP "MAP"
 
+/* max number of rebuild processes to run at one time,
+ * -1 starts one process per cpu, 0 imposes no limit,
+ * set from the --jobs option */
+static int scr_rebuild_jobs = -1;
+
 #ifdef SCR_GLOBALS_H
 #error "globals.h accessed from tools"
 #endif
@@ -408,10 +415,16 @@ int scr_summary_write(const spath* prefix, const spath* dir, kvtree* hash)
   return rc;
 }
 
+/* scr_fork_rebuilds reaps children with wait(), which would steal
+ * children forked by another thread, so only let one thread run a
+ * set of rebuilds at a time when scanning datasets with a worker pool */
+static pthread_mutex_t scr_fork_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* forks and execs processes to rebuild missing files and waits for them to complete,
  * returns SCR_FAILURE if any dataset failed to rebuild, SCR_SUCCESS otherwise */
 int scr_fork_rebuilds(const spath* dir, const char* build_cmd, kvtree* cmds)
 {
+  pthread_mutex_lock(&scr_fork_lock);
   int rc = SCR_SUCCESS;
 
   /* count the number of build commands */
@@ -425,6 +438,7 @@ int scr_fork_rebuilds(const spath* dir, const char* build_cmd, kvtree* cmds)
       scr_err("Failed to allocate space to record pids @ %s:%d",
         __FILE__, __LINE__
       );
+      pthread_mutex_unlock(&scr_fork_lock);
       return SCR_FAILURE;
     }
   }
@@ -432,7 +446,14 @@ int scr_fork_rebuilds(const spath* dir, const char* build_cmd, kvtree* cmds)
   /* allocate character string for chdir */
   char* dir_str = spath_strdup(dir);
 
-  /* TODO: flow control the number of builds ongoing at a time */
+  /* determine the max number of rebuild processes to run at one time,
+   * if the user didn't pick a value, start one process per cpu so that
+   * set rebuilds pipeline through the node without oversubscribing it */
+  int jobs = scr_rebuild_jobs;
+  if (jobs < 0) {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = (ncpus > 0) ? (int) ncpus : 1;
+  }
 
   /* step through and fork off each of our build commands */
   int pid_count = 0;
@@ -441,6 +462,25 @@ int scr_fork_rebuilds(const spath* dir, const char* build_cmd, kvtree* cmds)
        elem != NULL;
        elem = kvtree_elem_next(elem))
   {
+    /* flow control the number of builds ongoing at a time,
+     * reap one child before forking another once we hit our limit */
+    if (jobs > 0 && pid_count >= jobs) {
+      int stat = 0;
+      int ret = wait(&stat);
+      if (ret == -1 || ret == (pid_t)-1) {
+        scr_err("Got a -1 from wait @ %s:%d",
+          __FILE__, __LINE__
+        );
+        rc = SCR_FAILURE;
+      } else if (stat != 0) {
+        scr_err("Child returned with non-zero @ %s:%d",
+          __FILE__, __LINE__
+        );
+        rc = SCR_FAILURE;
+      }
+      pid_count--;
+    }
+
     /* get the hash of argv values for this command */
     kvtree* cmd_hash = kvtree_elem_hash(elem);
 
@@ -532,6 +572,8 @@ int scr_fork_rebuilds(const spath* dir, const char* build_cmd, kvtree* cmds)
   /* free the pid array */
   scr_free(&pids);
 
+  pthread_mutex_unlock(&scr_fork_lock);
+
   return rc;
 }
 
@@ -1766,26 +1808,23 @@ int index_list(const spath* prefix)
   char* current = NULL;
   scr_index_get_current(index, &current);
 
-  /* get a pointer to the checkpoint hash */
-  kvtree* dset_hash = kvtree_get(index, SCR_INDEX_1_KEY_DATASET);
-
-  /* sort datasets in descending order */
-  kvtree_sort_int(dset_hash, KVTREE_SORT_DESCENDING);
+  /* get sorted list of dataset ids in the index */
+  int count = 0;
+  int* ids = NULL;
+  scr_index_list_ids(index, &count, &ids);
 
   /* print header */
   printf("DSET VALID FLUSHED             CUR NAME\n");
 
-  /* iterate over each of the datasets and print the id and other info */
-  kvtree_elem* elem;
-  for (elem = kvtree_elem_first(dset_hash);
-       elem != NULL;
-       elem = kvtree_elem_next(elem))
-  {
+  /* iterate over the datasets in descending id order
+   * and print the id and other info */
+  int i;
+  for (i = count - 1; i >= 0; i--) {
     /* get the dataset id */
-    int dset = kvtree_elem_key_int(elem);
+    int dset = ids[i];
 
     /* get the hash for this dataset */
-    kvtree* info_hash = kvtree_elem_hash(elem);
+    kvtree* info_hash = kvtree_get_kv_int(index, SCR_INDEX_1_KEY_DATASET, dset);
 
     /* skip this dataset if it's not a checkpoint */
     kvtree* dataset_hash = kvtree_get(info_hash, SCR_INDEX_1_KEY_DATASET);
@@ -1880,6 +1919,9 @@ int index_list(const spath* prefix)
     printf("\n");
   }
 
+  /* free list of dataset ids */
+  scr_free(&ids);
+
   /* free off our index hash */
   kvtree_delete(&index);
 
@@ -2039,6 +2081,47 @@ cleanup:
   return rc;
 }
 
+/* record the dataset described by the given summary hash in the
+ * index hash, sets complete_flag to 1 if the dataset is marked
+ * complete, returns SCR_FAILURE if the summary is missing fields
+ * needed to index the dataset */
+static int index_record_summary(kvtree* index, int id, kvtree* summary, int* complete_flag)
+{
+  /* assume dataset is not complete */
+  *complete_flag = 0;
+
+  /* get the dataset hash from the summary */
+  scr_dataset* dataset = kvtree_get(summary, SCR_SUMMARY_6_KEY_DATASET);
+  if (dataset == NULL) {
+    /* failed to find dataset hash in summary file, so we can't index it */
+    return SCR_FAILURE;
+  }
+
+  /* get the dataset name */
+  char* dataset_name;
+  if (scr_dataset_get_name(dataset, &dataset_name) != SCR_SUCCESS) {
+    /* failed to find dataset name */
+    return SCR_FAILURE;
+  }
+
+  /* found the name, now check whether it's complete (assume that it's not) */
+  int complete;
+  if (kvtree_util_get_int(summary, SCR_SUMMARY_6_KEY_COMPLETE, &complete) != KVTREE_SUCCESS) {
+    /* failed to read complete flag */
+    return SCR_FAILURE;
+  }
+
+  /* write values to the index hash */
+  scr_index_remove(index, dataset_name);
+  scr_index_set_dataset(index, id, dataset_name, dataset, complete);
+  scr_index_mark_flushed(index, id, dataset_name);
+
+  /* update return flag to indicate that dataset is complete */
+  *complete_flag = complete;
+
+  return SCR_SUCCESS;
+}
+
 /* given a prefix directory and a dataset id,
  * attempt add the dataset to the index file.
  * Returns SCR_SUCCESS if dataset can be indexed,
@@ -2075,34 +2158,10 @@ int index_build(const spath* prefix, int id, int* complete_flag)
   }
   spath_delete(&dataset_path);
 
-  /* get the dataset hash for this directory */
-  scr_dataset* dataset = kvtree_get(summary, SCR_SUMMARY_6_KEY_DATASET);
-  if (dataset != NULL) {
-    /* get the dataset name */
-    char* dataset_name;
-    if (scr_dataset_get_name(dataset, &dataset_name) == SCR_SUCCESS) {
-      /* found the name, now check whether it's complete (assume that it's not) */
-      int complete;
-      if (kvtree_util_get_int(summary, SCR_SUMMARY_6_KEY_COMPLETE, &complete) == KVTREE_SUCCESS) {
-        /* write values to the index file */
-        scr_index_remove(index, dataset_name);
-        scr_index_set_dataset(index, id, dataset_name, dataset, complete);
-        scr_index_mark_flushed(index, id, dataset_name);
-        scr_index_write(prefix, index);
-
-        /* update return flag to indicate that dataset is complete */
-        *complete_flag = complete;
-      } else {
-        /* failed to read complete flag */
-        rc = SCR_FAILURE;
-      }
-    } else {
-      /* failed to find dataset id */
-      rc = SCR_FAILURE;
-    }
-  } else {
-    /* failed to find dataset hash in summary file, so we can't index it */
-    rc = SCR_FAILURE;
+  /* record the dataset in the index hash and write out the index file */
+  rc = index_record_summary(index, id, summary, complete_flag);
+  if (rc == SCR_SUCCESS) {
+    scr_index_write(prefix, index);
   }
 
   /* free our summary file hash */
@@ -2117,6 +2176,240 @@ int index_build(const spath* prefix, int id, int* complete_flag)
   return rc;
 }
 
+/* worker pool state for scanning datasets in parallel, each worker
+ * claims the next unclaimed dataset until the list is exhausted */
+struct scan_pool {
+  const spath* prefix;    /* prefix directory */
+  int count;              /* number of datasets in the list */
+  int next;               /* next dataset index to be claimed */
+  pthread_mutex_t lock;   /* guards next */
+  int* ids;               /* dataset ids to be scanned */
+  kvtree** summaries;     /* per-dataset summary hash filled in by workers */
+  int* valid;             /* per-dataset flag set to 1 if summary was read */
+};
+
+static void* scan_pool_worker(void* arg)
+{
+  struct scan_pool* pool = (struct scan_pool*) arg;
+  while (1) {
+    /* claim the next dataset in the list */
+    pthread_mutex_lock(&pool->lock);
+    int i = pool->next;
+    pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+    if (i >= pool->count) {
+      break;
+    }
+
+    /* build path to the dataset metadata directory */
+    int id = pool->ids[i];
+    spath* dataset_path = spath_dup(pool->prefix);
+    spath_append_str(dataset_path, ".scr");
+    spath_append_strf(dataset_path, "scr.dataset.%d", id);
+
+    /* read summary file from the dataset directory,
+     * attempting to build it first if it's missing */
+    kvtree* summary = kvtree_new();
+    if (scr_summary_read(dataset_path, summary) != SCR_SUCCESS) {
+      /* if summary file is missing, attempt to build it */
+      if (scr_summary_build(pool->prefix, dataset_path, id) == SCR_SUCCESS) {
+        /* if the build was successful, try the read again */
+        if (scr_summary_read(dataset_path, summary) == SCR_SUCCESS) {
+          pool->valid[i] = 1;
+        }
+      }
+    } else {
+      pool->valid[i] = 1;
+    }
+    pool->summaries[i] = summary;
+
+    spath_delete(&dataset_path);
+  }
+  return NULL;
+}
+
+/* compare two dataset ids for qsort */
+static int compare_ids(const void* a, const void* b)
+{
+  return *(const int*)a - *(const int*)b;
+}
+
+/* scan the hidden directory for scr.dataset.<id> directories and
+ * add each dataset found to the index file, building summary files
+ * as needed, dataset directories are scanned by a pool of worker
+ * threads and the index file is written once at the end,
+ * with incremental != 0 only dataset directories modified since
+ * the index file was last written are examined,
+ * returns SCR_SUCCESS if every dataset examined was indexed */
+int index_build_all(const spath* prefix, int threads, int incremental)
+{
+  int rc = SCR_SUCCESS;
+  int i;
+
+  /* path to hidden directory */
+  spath* hidden_path = spath_dup(prefix);
+  spath_append_str(hidden_path, ".scr");
+
+  /* in incremental mode, get the mtime of the index file,
+   * if we can't stat it, fall back to a full scan */
+  time_t index_mtime = 0;
+  if (incremental) {
+    spath* index_path = spath_dup(prefix);
+    spath_append_str(index_path, "index.scr");
+    char* index_file = spath_strdup(index_path);
+    struct stat statbuf;
+    if (stat(index_file, &statbuf) == 0) {
+      index_mtime = statbuf.st_mtime;
+    }
+    scr_free(&index_file);
+    spath_delete(&index_path);
+  }
+
+  /* read contents in hidden directory */
+  kvtree* list = kvtree_new();
+  if (scr_read_dir(hidden_path, list) != SCR_SUCCESS) {
+    kvtree_delete(&list);
+    spath_delete(&hidden_path);
+    return SCR_FAILURE;
+  }
+
+  /* count the dataset directories so we can size our id list */
+  kvtree* dirs = kvtree_get(list, SCR_IO_KEY_DIR);
+  int count = 0;
+  int* ids = (int*) malloc(kvtree_size(dirs) * sizeof(int));
+
+  /* iterate over list of directories picking out datasets to scan */
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(dirs);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    /* check whether we have a dataset directory */
+    char* dirname = kvtree_elem_key(elem);
+    if (strncmp(dirname, "scr.dataset.", 12) != 0) {
+      continue;
+    }
+
+    /* extract the dataset id from the directory name */
+    char* end = NULL;
+    long id = strtol(dirname + 12, &end, 10);
+    if (end == dirname + 12 || *end != '\0') {
+      continue;
+    }
+
+    /* in incremental mode, skip datasets whose directory has not
+     * been modified since the index file was last written */
+    if (index_mtime != 0) {
+      spath* dataset_path = spath_dup(hidden_path);
+      spath_append_str(dataset_path, dirname);
+      char* dataset_dir = spath_strdup(dataset_path);
+      struct stat statbuf;
+      int skip = (stat(dataset_dir, &statbuf) == 0 &&
+                  statbuf.st_mtime <= index_mtime);
+      scr_free(&dataset_dir);
+      spath_delete(&dataset_path);
+      if (skip) {
+        continue;
+      }
+    }
+
+    ids[count] = (int) id;
+    count++;
+  }
+
+  kvtree_delete(&list);
+  spath_delete(&hidden_path);
+
+  /* nothing to do if every dataset is already covered by the index */
+  if (count == 0) {
+    scr_free(&ids);
+    return SCR_SUCCESS;
+  }
+
+  /* scan datasets in ascending id order */
+  qsort(ids, count, sizeof(int), compare_ids);
+
+  /* record dataset list and scan state for the workers */
+  struct scan_pool pool;
+  pool.prefix    = prefix;
+  pool.count     = count;
+  pool.next      = 0;
+  pool.ids       = ids;
+  pool.summaries = (kvtree**) calloc(count, sizeof(kvtree*));
+  pool.valid     = (int*) calloc(count, sizeof(int));
+  pthread_mutex_init(&pool.lock, NULL);
+
+  /* default to one worker per cpu,
+   * and no sense starting more workers than we have datasets */
+  if (threads < 1) {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (ncpus > 0) ? (int) ncpus : 1;
+  }
+  if (threads > count) {
+    threads = count;
+  }
+
+  /* start our workers */
+  int started = 0;
+  pthread_t* tids = (pthread_t*) malloc(threads * sizeof(pthread_t));
+  if (tids != NULL) {
+    for (i = 0; i < threads; i++) {
+      if (pthread_create(&tids[i], NULL, scan_pool_worker, &pool) != 0) {
+        break;
+      }
+      started++;
+    }
+  }
+
+  /* if we failed to get any workers going,
+   * scan the datasets on this thread instead */
+  if (started == 0) {
+    scan_pool_worker(&pool);
+  }
+
+  /* wait for all workers to finish */
+  for (i = 0; i < started; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  scr_free(&tids);
+  pthread_mutex_destroy(&pool.lock);
+
+  /* create a new hash to store our index file data */
+  kvtree* index = kvtree_new();
+
+  /* read index file from the prefix directory */
+  scr_index_read(prefix, index);
+
+  /* record each dataset we scanned in the index hash */
+  for (i = 0; i < count; i++) {
+    int complete = 0;
+    if (pool.valid[i] &&
+        index_record_summary(index, ids[i], pool.summaries[i], &complete) == SCR_SUCCESS)
+    {
+      printf("Dataset %d indexed as %s\n",
+        ids[i], complete ? "complete" : "incomplete"
+      );
+    } else {
+      scr_err("Failed to index dataset %d @ %s:%d",
+        ids[i], __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+    kvtree_delete(&pool.summaries[i]);
+  }
+
+  /* write out new index file */
+  scr_index_write(prefix, index);
+
+  /* free our index hash and scan state */
+  kvtree_delete(&index);
+  scr_free(&pool.summaries);
+  scr_free(&pool.valid);
+  scr_free(&ids);
+
+  return rc;
+}
+
 /* add named dataset to index,
  * requires summary file to already exist,
  * scans scr.dataset.<id> directories looking
@@ -2263,6 +2556,10 @@ int print_usage()
   printf("  Options:\n");
   printf("    -l, --list              List indexed datasets (default behavior)\n");
   printf("    -b, --build=<id>        Rebuild dataset <id> and add to index\n");
+  printf("    -B, --build-all         Rebuild all datasets under prefix and add each to index\n");
+  printf("    -n, --incremental       With --build-all, only examine datasets modified since the index was last written\n");
+  printf("    -t, --threads=<n>       Worker threads to scan datasets for --build-all (default one per cpu)\n");
+  printf("    -j, --jobs=<n>          Max concurrent rebuild processes (default one per cpu, 0 for no limit)\n");
   printf("    -a, --add=<name>        Add dataset <name> to index (requires summary file to exist)\n");
   printf("        --drop=<name>       Drop dataset <name> from index (does not delete files)\n");
   printf("        --drop-after=<name> Drop all datasets after <name> from index (does not delete files)\n");
@@ -2277,8 +2574,12 @@ struct arglist {
   spath* prefix;
   char* name;
   int id;
+  int jobs;
+  int threads;
+  int incremental;
   int list;
   int build;
+  int build_all;
   int add;
   int drop;
   int drop_after;
@@ -2299,17 +2600,25 @@ int get_args(int argc, char **argv, struct arglist* args)
   args->prefix     = NULL;
   args->name       = NULL;
   args->id         = -1;
+  args->jobs       = -1;
+  args->threads    = -1;
+  args->incremental = 0;
   args->list       = 1;
   args->build      = 0;
+  args->build_all  = 0;
   args->add        = 0;
   args->drop       = 0;
   args->drop_after = 0;
   args->current    = 0;
 
-  static const char *opt_string = "lb:a:d:p:h";
+  static const char *opt_string = "lb:Bnt:j:a:d:p:h";
   static struct option long_options[] = {
-    {"list",       no_argument,       NULL, 'l'},
-    {"build",      required_argument, NULL, 'b'},
+    {"list",        no_argument,       NULL, 'l'},
+    {"build",       required_argument, NULL, 'b'},
+    {"build-all",   no_argument,       NULL, 'B'},
+    {"incremental", no_argument,       NULL, 'n'},
+    {"threads",     required_argument, NULL, 't'},
+    {"jobs",       required_argument, NULL, 'j'},
     {"add",        required_argument, NULL, 'a'},
     {"drop",       required_argument, NULL, 'd'},
     {"drop-after", required_argument, NULL, 'z'},
@@ -2331,6 +2640,19 @@ int get_args(int argc, char **argv, struct arglist* args)
         args->build = 1;
         args->list  = 0;
         break;
+      case 'B':
+        args->build_all = 1;
+        args->list      = 0;
+        break;
+      case 'n':
+        args->incremental = 1;
+        break;
+      case 't':
+        args->threads = atoi(optarg);
+        break;
+      case 'j':
+        args->jobs = atoi(optarg);
+        break;
       case 'a':
         args->name = strdup(optarg);
         args->add  = 1;
@@ -2399,8 +2721,11 @@ int main(int argc, char *argv[])
   char* name = args.name;
   int id = args.id;
 
+  /* record limit on concurrent rebuild processes for scr_fork_rebuilds */
+  scr_rebuild_jobs = args.jobs;
+
   /* these options all require a prefix directory */
-  if (args.build == 1 | args.add == 1 || args.drop == 1 || args.drop_after == 1 || args.current == 1 || args.list == 1) {
+  if (args.build == 1 | args.build_all == 1 || args.add == 1 || args.drop == 1 || args.drop_after == 1 || args.current == 1 || args.list == 1) {
     if (spath_is_null(prefix)) {
       print_usage();
       return 1;
@@ -2426,6 +2751,10 @@ int main(int argc, char *argv[])
         rc = SCR_SUCCESS;
       }
     }
+  } else if (args.build_all == 1) {
+    /* scan all dataset directories under the prefix and add each
+     * one to the index file, building missing files if necessary */
+    rc = index_build_all(prefix, args.threads, args.incremental);
   } else if (args.add == 1) {
     /* add the named dataset to the index file (requires summary file to exist) */
     rc = index_add(prefix, name);
@@ -44,6 +44,20 @@
 
 #define SCR_INDEX_FILENAME "index.scr"
 
+/* append-only journal holding hot-path index updates, writers append
+ * single records here instead of rewriting the whole index file, and
+ * readers replay the journal on top of the index after reading it,
+ * any full index write folds the journal in and truncates it */
+#define SCR_INDEX_JOURNAL_FILENAME "index.journal.scr"
+
+/* operation names for journal records */
+#define SCR_INDEX_JOURNAL_OP_COMPLETE     "COMPLETE"
+#define SCR_INDEX_JOURNAL_OP_FLUSHED      "FLUSHED"
+#define SCR_INDEX_JOURNAL_OP_FETCHED      "FETCHED"
+#define SCR_INDEX_JOURNAL_OP_FAILED       "FAILED"
+#define SCR_INDEX_JOURNAL_OP_CLEAR_FAILED "CLEAR_FAILED"
+#define SCR_INDEX_JOURNAL_OP_CURRENT      "CURRENT"
+
 /* Example contents of an index file:
  * This contains:
  *   - a VERSION number indicating the format of the file
@@ -129,7 +143,220 @@
  *          1
  */
 
-/* read the index file from given directory and merge its contents into the given hash */
+/* this adds an entry to the index that maps a name to a dataset id */
+static int scr_index_set_directory(kvtree* hash, const char* name, int id);
+
+/* build path to the index journal file, caller must free with scr_free */
+static char* scr_index_journal_path(const spath* dir)
+{
+  spath* path = spath_dup(dir);
+  spath_append_str(path, ".scr");
+  spath_append_str(path, SCR_INDEX_JOURNAL_FILENAME);
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* format the current time the way index timestamps are recorded */
+static void scr_index_timestamp(char* buf, size_t size)
+{
+  time_t now = time(NULL);
+  strftime(buf, size, "%Y-%m-%dT%H:%M:%S", localtime(&now));
+}
+
+/* append a single record to the index journal, formatted as:
+ *   <op> <id> <value> <name>
+ * a single O_APPEND write keeps records from concurrent writers
+ * from interleaving, so appenders need not take the index file lock */
+static int scr_index_journal_append(
+  const spath* dir,
+  const char* op,
+  int id,
+  const char* value,
+  const char* name)
+{
+  int rc = SCR_SUCCESS;
+
+  /* format the record, including its terminating newline */
+  char record[SCR_MAX_FILENAME];
+  int n = snprintf(record, sizeof(record), "%s %d %s %s\n", op, id, value, name);
+  if (n < 0 || n >= sizeof(record)) {
+    scr_err("Journal record too long for dataset %s @ %s:%d",
+      name, __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* open the journal for appending, creating it if needed */
+  char* file = scr_index_journal_path(dir);
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(file, O_WRONLY | O_CREAT | O_APPEND, mode_file);
+  if (fd < 0) {
+    scr_err("Failed to open index journal %s @ %s:%d",
+      file, __FILE__, __LINE__
+    );
+    scr_free(&file);
+    return SCR_FAILURE;
+  }
+
+  /* write the record in a single call so it lands atomically */
+  if (scr_write_attempt(file, fd, record, n) != n) {
+    rc = SCR_FAILURE;
+  }
+
+  /* flush the record to disk */
+  if (scr_close(file, fd) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  scr_free(&file);
+
+  return rc;
+}
+
+/* apply a single journal record to the given index hash */
+static int scr_index_journal_replay(kvtree* index, const char* record)
+{
+  /* parse the operation, dataset id, and value fields,
+   * the dataset name is everything that follows */
+  char op[32];
+  int id;
+  char value[64];
+  int offset = 0;
+  if (sscanf(record, "%31s %d %63s %n", op, &id, value, &offset) != 3 || offset == 0) {
+    return SCR_FAILURE;
+  }
+  const char* name = record + offset;
+
+  if (strcmp(op, SCR_INDEX_JOURNAL_OP_COMPLETE) == 0) {
+    scr_index_set_complete(index, id, name, atoi(value));
+  } else if (strcmp(op, SCR_INDEX_JOURNAL_OP_FLUSHED) == 0) {
+    kvtree* dset_hash = kvtree_set_kv_int(index, SCR_INDEX_1_KEY_DATASET, id);
+    kvtree_util_set_str(dset_hash, SCR_INDEX_1_KEY_FLUSHED, value);
+    scr_index_set_directory(index, name, id);
+  } else if (strcmp(op, SCR_INDEX_JOURNAL_OP_FETCHED) == 0) {
+    kvtree* dset_hash = kvtree_set_kv_int(index, SCR_INDEX_1_KEY_DATASET, id);
+    kvtree_set_kv(dset_hash, SCR_INDEX_1_KEY_FETCHED, value);
+    scr_index_set_directory(index, name, id);
+  } else if (strcmp(op, SCR_INDEX_JOURNAL_OP_FAILED) == 0) {
+    kvtree* dset_hash = kvtree_set_kv_int(index, SCR_INDEX_1_KEY_DATASET, id);
+    kvtree_util_set_str(dset_hash, SCR_INDEX_1_KEY_FAILED, value);
+    scr_index_set_directory(index, name, id);
+  } else if (strcmp(op, SCR_INDEX_JOURNAL_OP_CLEAR_FAILED) == 0) {
+    scr_index_clear_failed(index, id, name);
+  } else if (strcmp(op, SCR_INDEX_JOURNAL_OP_CURRENT) == 0) {
+    scr_index_set_current(index, name);
+  } else {
+    /* unknown operation, skip the record */
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* replay any journaled records on top of the given index hash,
+ * records are applied in the order they were appended */
+int scr_index_journal_apply(const spath* dir, kvtree* index)
+{
+  /* nothing to do if there is no journal */
+  char* file = scr_index_journal_path(dir);
+  if (scr_file_exists(file) != SCR_SUCCESS) {
+    scr_free(&file);
+    return SCR_SUCCESS;
+  }
+  unsigned long size = scr_file_size(file);
+  if (size == 0) {
+    scr_free(&file);
+    return SCR_SUCCESS;
+  }
+
+  /* read the journal contents */
+  char* buf = (char*) SCR_MALLOC(size + 1);
+  int fd = scr_open(file, O_RDONLY);
+  if (fd < 0) {
+    scr_err("Failed to open index journal %s @ %s:%d",
+      file, __FILE__, __LINE__
+    );
+    scr_free(&buf);
+    scr_free(&file);
+    return SCR_FAILURE;
+  }
+  ssize_t nread = scr_read_attempt(file, fd, buf, size);
+  scr_close_nofsync(file, fd);
+  if (nread < 0) {
+    scr_free(&buf);
+    scr_free(&file);
+    return SCR_FAILURE;
+  }
+  buf[nread] = '\0';
+
+  /* replay records in order, a torn trailing record that is missing
+   * its newline is ignored */
+  char* line = buf;
+  while (1) {
+    char* newline = strchr(line, '\n');
+    if (newline == NULL) {
+      break;
+    }
+    *newline = '\0';
+    if (*line != '\0') {
+      scr_index_journal_replay(index, line);
+    }
+    line = newline + 1;
+  }
+
+  scr_free(&buf);
+  scr_free(&file);
+
+  return SCR_SUCCESS;
+}
+
+/* journal a completeness code update for given dataset id and name */
+int scr_index_journal_set_complete(const spath* dir, int id, const char* name, int complete)
+{
+  char value[12];
+  snprintf(value, sizeof(value), "%d", complete);
+  return scr_index_journal_append(dir, SCR_INDEX_JOURNAL_OP_COMPLETE, id, value, name);
+}
+
+/* journal a flush event for given dataset id and name */
+int scr_index_journal_mark_flushed(const spath* dir, int id, const char* name)
+{
+  char timestamp[30];
+  scr_index_timestamp(timestamp, sizeof(timestamp));
+  return scr_index_journal_append(dir, SCR_INDEX_JOURNAL_OP_FLUSHED, id, timestamp, name);
+}
+
+/* journal a fetch event for given dataset id and name */
+int scr_index_journal_mark_fetched(const spath* dir, int id, const char* name)
+{
+  char timestamp[30];
+  scr_index_timestamp(timestamp, sizeof(timestamp));
+  return scr_index_journal_append(dir, SCR_INDEX_JOURNAL_OP_FETCHED, id, timestamp, name);
+}
+
+/* journal a failed fetch event for given dataset id and name */
+int scr_index_journal_mark_failed(const spath* dir, int id, const char* name)
+{
+  char timestamp[30];
+  scr_index_timestamp(timestamp, sizeof(timestamp));
+  return scr_index_journal_append(dir, SCR_INDEX_JOURNAL_OP_FAILED, id, timestamp, name);
+}
+
+/* journal removal of any failed fetch marker for given dataset id and name */
+int scr_index_journal_clear_failed(const spath* dir, int id, const char* name)
+{
+  return scr_index_journal_append(dir, SCR_INDEX_JOURNAL_OP_CLEAR_FAILED, id, "-", name);
+}
+
+/* journal an update to set the named dataset as current */
+int scr_index_journal_set_current(const spath* dir, const char* name)
+{
+  return scr_index_journal_append(dir, SCR_INDEX_JOURNAL_OP_CURRENT, 0, "-", name);
+}
+
+/* read the index file from given directory into the given hash,
+ * caller should pass an empty hash */
 int scr_index_read(const spath* dir, kvtree* index)
 {
   int rc = SCR_FAILURE;
@@ -140,26 +367,26 @@ int scr_index_read(const spath* dir, kvtree* index)
   spath_append_str(path_index, SCR_INDEX_FILENAME);
   char* index_file = spath_strdup(path_index);
 
-  /* if we can access it, read the index file */
+  /* if we can access it, read the index file,
+   * we parse straight into the caller's kvtree rather than reading
+   * into a scratch tree and merging, with thousands of datasets the
+   * merge doubled peak memory and deep-copied the entire index */
   if (scr_file_exists(index_file) == SCR_SUCCESS) {
-    kvtree* tmp = kvtree_new();
-    int kvtree_rc = kvtree_read_file(index_file, tmp);
+    int kvtree_rc = kvtree_read_file(index_file, index);
     rc = (kvtree_rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
 
     /* version check on file */
     if (rc == SCR_SUCCESS) {
       /* read version value from file */
       int version;
-      if (kvtree_util_get_int(tmp, SCR_INDEX_KEY_VERSION, &version) == KVTREE_SUCCESS) {
+      if (kvtree_util_get_int(index, SCR_INDEX_KEY_VERSION, &version) == KVTREE_SUCCESS) {
         /* got a version number, check that it's what we expect */
-        if (version == SCR_INDEX_FILE_VERSION_2) {
-          /* got the correct version, copy file contents into caller's kvtree */
-          kvtree_merge(index, tmp);
-        } else {
-          /* failed to find the version number in the file */
+        if (version != SCR_INDEX_FILE_VERSION_2) {
+          /* wrong version, don't hand back contents we can't interpret */
           scr_err("Found file format version %d but expected %d in index file: %s @ %s:%d",
             version, SCR_INDEX_FILE_VERSION_2, index_file, __FILE__, __LINE__
           );
+          kvtree_unset_all(index);
           rc = SCR_FAILURE;
         }
       } else {
@@ -167,11 +394,15 @@ int scr_index_read(const spath* dir, kvtree* index)
         scr_err("Failed to find file format version in index file: %s @ %s:%d",
           index_file, __FILE__, __LINE__
         );
+        kvtree_unset_all(index);
         rc = SCR_FAILURE;
       }
+    }
 
-      /* free our temporary tree */
-      kvtree_delete(&tmp);
+    /* replay any journaled updates on top of the file contents,
+     * so readers see hot-path updates without waiting on writers */
+    if (rc == SCR_SUCCESS) {
+      scr_index_journal_apply(dir, index);
     }
   }
 
@@ -200,6 +431,22 @@ int scr_index_write(const spath* dir, kvtree* index)
   int kvtree_rc = kvtree_write_path(path_index, index);
   int rc = (kvtree_rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
 
+  /* a full rewrite of the index acts as the journal compactor,
+   * callers read the index through scr_index_read which folded any
+   * journaled records into the hash we just wrote, so drop them,
+   * we truncate rather than unlink so a record appended by another
+   * process between our write and this truncate still lands in the
+   * journal file and is picked up by the next reader */
+  if (rc == SCR_SUCCESS) {
+    char* journal_file = scr_index_journal_path(dir);
+    if (truncate(journal_file, 0) != 0 && errno != ENOENT) {
+      scr_err("Failed to truncate index journal %s (errno=%d %s) @ %s:%d",
+        journal_file, errno, strerror(errno), __FILE__, __LINE__
+      );
+    }
+    scr_free(&journal_file);
+  }
+
   /* free path */
   spath_delete(&path_index);
 
@@ -507,6 +754,34 @@ int scr_index_get_id_by_name(const kvtree* index, const char* name, int* id)
   return SCR_FAILURE;
 }
 
+/* return list of dataset ids in the index sorted in ascending order,
+ * caller must free ids with scr_free */
+int scr_index_list_ids(const kvtree* index, int* count, int** ids)
+{
+  kvtree* dsets = kvtree_get(index, SCR_INDEX_1_KEY_DATASET);
+  kvtree_list_int(dsets, count, ids);
+  return SCR_SUCCESS;
+}
+
+/* binary search sorted id list for the position of the largest id
+ * that is strictly less than limit, returns -1 if no such id */
+static int scr_index_search_below(const int* ids, int count, int limit)
+{
+  int pos = -1;
+  int low  = 0;
+  int high = count - 1;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    if (ids[mid] < limit) {
+      pos = mid;
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return pos;
+}
+
 /* lookup the most recent complete dataset id and name whose id is less than earlier_than
  * setting earlier_than = -1 disables this filter */
 int scr_index_get_most_recent_complete(const kvtree* index, int earlier_than, int* id, char* name)
@@ -514,42 +789,32 @@ int scr_index_get_most_recent_complete(const kvtree* index, int earlier_than, in
   /* assume that we won't find a valid dataset */
   *id = -1;
 
-  /* search for the checkpoint with the maximum dataset id which is
-   * complete and less than earlier_than if earlier_than is set */
-  int max_id = -1;
-  kvtree* dsets = kvtree_get(index, SCR_INDEX_1_KEY_DATASET);
-  kvtree_elem* dset = NULL;
-  for (dset = kvtree_elem_first(dsets);
-       dset != NULL;
-       dset = kvtree_elem_next(dset))
-  {
-    /* get the id for this dataset */
-    char* key = kvtree_elem_key(dset);
-    if (key == NULL) {
-      continue;
-    }
-    int current_id = atoi(key);
+  /* get sorted list of dataset ids in index */
+  int count = 0;
+  int* ids = NULL;
+  scr_index_list_ids(index, &count, &ids);
 
-    /* if we have a limit and the current id is beyond that limit,
-     * skip it */
-    if (earlier_than != -1 && current_id >= earlier_than) {
-      continue;
-    }
+  /* binary search for the highest id below our limit,
+   * without a limit we start from the highest id we have */
+  int start = count - 1;
+  if (earlier_than != -1) {
+    start = scr_index_search_below(ids, count, earlier_than);
+  }
 
-    /* if the current id is earlier than the lastest we've found so far,
-     * skip it */
-    if (current_id < max_id) {
-      continue;
-    }
+  /* walk ids in descending order and stop at the first complete
+   * checkpoint, since the list is sorted nothing earlier can be
+   * more recent */
+  int i;
+  for (i = start; i >= 0; i--) {
+    int current_id = ids[i];
 
-    kvtree* dset_hash = kvtree_elem_hash(dset);
+    /* get the hash for this dataset */
+    kvtree* dset_hash = kvtree_get_kv_int((kvtree*) index, SCR_INDEX_1_KEY_DATASET, current_id);
 
-    /* alright, this dataset id is within range to be the most recent,
-     * now scan the various names we have for this dataset looking for a complete */
+    /* assume this dataset will do until proven otherwise */
     int found_one = 1;
 
-    /* this dataset id is less than our limit and it's more than
-     * our current max, check whether it's complete */
+    /* check whether it's complete */
     int complete;
     if (kvtree_util_get_int(dset_hash, SCR_INDEX_1_KEY_COMPLETE, &complete) == KVTREE_SUCCESS) {
       if (complete != 1) {
@@ -578,20 +843,20 @@ int scr_index_get_most_recent_complete(const kvtree* index, int earlier_than, in
       found_one = 0;
     }
 
-    /* get the name of the dataset */
-    char* current_name;
-    scr_dataset_get_name(dataset_hash, &current_name);
-
-    /* if we found one, copy the dataset id and name, and update our max */
+    /* if we found one, copy the dataset id and name, and we're done */
     if (found_one) {
+      char* current_name;
+      scr_dataset_get_name(dataset_hash, &current_name);
+
       *id = current_id;
       strcpy(name, current_name);
-
-      /* update our max */
-      max_id = current_id;
+      break;
     }
   }
 
+  /* free list of dataset ids */
+  scr_free(&ids);
+
   return SCR_FAILURE;
 }
 
@@ -602,43 +867,31 @@ int scr_index_get_oldest(const kvtree* index, int* id, char* name)
   /* assume that we won't find a valid dataset */
   *id = -1;
 
-  /* search for the checkpoint with the minimum dataset id */
-  int min_id = -1;
-  kvtree* dsets = kvtree_get(index, SCR_INDEX_1_KEY_DATASET);
-  kvtree_elem* dset = NULL;
-  for (dset = kvtree_elem_first(dsets);
-       dset != NULL;
-       dset = kvtree_elem_next(dset))
-  {
-    /* get the id for this dataset */
-    char* key = kvtree_elem_key(dset);
-    if (key == NULL) {
-      continue;
-    }
-    int current_id = atoi(key);
+  /* get sorted list of dataset ids in index */
+  int count = 0;
+  int* ids = NULL;
+  scr_index_list_ids(index, &count, &ids);
 
-    /* if the current id is more recent than the oldest we've found so far,
-     * skip it */
-    if (min_id != -1 && current_id > min_id) {
-      continue;
-    }
+  /* the oldest dataset is the first entry in the sorted list */
+  if (count > 0) {
+    int current_id = ids[0];
 
     /* get dataset info */
-    kvtree* dset_hash = kvtree_elem_hash(dset);
+    kvtree* dset_hash = kvtree_get_kv_int((kvtree*) index, SCR_INDEX_1_KEY_DATASET, current_id);
     kvtree* dataset_hash = kvtree_get(dset_hash, SCR_INDEX_1_KEY_DATASET);
 
     /* get the name of the dataset */
     char* current_name;
     scr_dataset_get_name(dataset_hash, &current_name);
 
-    /* if we found one, copy the dataset id and name, and update our max */
+    /* copy the dataset id and name */
     *id = current_id;
     strcpy(name, current_name);
-
-    /* update our min */
-    min_id = current_id;
   }
 
+  /* free list of dataset ids */
+  scr_free(&ids);
+
   return SCR_FAILURE;
 }
 
@@ -646,23 +899,19 @@ int scr_index_remove_later(kvtree* index, int target_id)
 {
   int rc = SCR_SUCCESS;
 
-  /* search for the checkpoint with the maximum dataset id which is
-   * complete and less than earlier_than if earlier_than is set */
-  kvtree* dsets = kvtree_get(index, SCR_INDEX_1_KEY_DATASET);
-
-  /* get list of dataset ids in index */
+  /* get sorted list of dataset ids in index */
   int count = 0;
   int* ids = NULL;
-  kvtree_list_int(dsets, &count, &ids);
+  scr_index_list_ids(index, &count, &ids);
+
+  /* binary search for the first id above the target,
+   * everything from there on up gets removed */
+  int first = scr_index_search_below(ids, count, target_id + 1) + 1;
 
   int i;
-  for (i = 0; i < count; i++) {
+  for (i = first; i < count; i++) {
     /* get id for this dataset */
     int id = ids[i];
-    if (id <= target_id) {
-      /* this dataset is earlier, throw it back */
-      continue;
-    }
 
     /* got a dataset that is later than the target,
      * get the dataset hash for this dataset */
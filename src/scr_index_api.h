@@ -19,12 +19,41 @@
 #include "kvtree.h"
 #include "scr_dataset.h"
 
-/* read the index file from given directory and merge its contents into the given hash */
+/* read the index file from given directory into the given hash,
+ * caller should pass an empty hash */
 int scr_index_read(const spath* dir, kvtree* index);
 
-/* overwrite the contents of the index file in given directory with given hash */
+/* overwrite the contents of the index file in given directory with given hash,
+ * also folds in and truncates the index journal */
 int scr_index_write(const spath* dir, kvtree* index);
 
+/* The index journal holds hot-path index updates as append-only records,
+ * so writers avoid the locked read-modify-write of the full index file.
+ * scr_index_read replays the journal on top of the index file contents,
+ * and scr_index_write folds journaled records into the file and
+ * truncates the journal. */
+
+/* replay any journaled updates on top of the given index hash */
+int scr_index_journal_apply(const spath* dir, kvtree* index);
+
+/* journal a completeness code update for given dataset id and name */
+int scr_index_journal_set_complete(const spath* dir, int id, const char* name, int complete);
+
+/* journal a flush event for given dataset id and name */
+int scr_index_journal_mark_flushed(const spath* dir, int id, const char* name);
+
+/* journal a fetch event for given dataset id and name */
+int scr_index_journal_mark_fetched(const spath* dir, int id, const char* name);
+
+/* journal a failed fetch event for given dataset id and name */
+int scr_index_journal_mark_failed(const spath* dir, int id, const char* name);
+
+/* journal removal of any failed fetch marker for given dataset id and name */
+int scr_index_journal_clear_failed(const spath* dir, int id, const char* name);
+
+/* journal an update to set the named dataset as current */
+int scr_index_journal_set_current(const spath* dir, const char* name);
+
 /* read index file and return max dataset and checkpoint ids,
  * returns SCR_SUCCESS if file read successfully */
 int scr_index_get_max_ids(const spath* dir, int* dset_id, int* ckpt_id, int* ckpt_dset_id);
@@ -71,6 +100,10 @@ int scr_index_get_complete(kvtree* index, int id, const char* name, int* complet
  * (assumes a name maps to a single dataset id) */
 int scr_index_get_id_by_name(const kvtree* index, const char* name, int* id);
 
+/* return list of dataset ids in the index sorted in ascending order,
+ * caller must free ids with scr_free */
+int scr_index_list_ids(const kvtree* index, int* count, int** ids);
+
 /* lookup the most recent complete dataset id and name whose id is less than earlier_than
  * setting earlier_than = -1 disables this filter */
 int scr_index_get_most_recent_complete(const kvtree* index, int earlier_than, int* id, char* name);
@@ -9,8 +9,13 @@
  * Please also read this file: LICENSE.TXT.
 */
 
-/* Executable that runs on each node during scavenge to read filemap
- * and report info about each dataset for which there are files. */
+/* Executable that runs on each node during scavenge to walk the
+ * datasets in cache and report which ranks have a complete set of
+ * files.  Filemaps are verified by a pool of worker threads, one
+ * rank's filemap per work unit, and each result line is printed and
+ * flushed as soon as that rank has been checked, so the scavenge
+ * scripts can start copying verified sets while the scan is still
+ * running. */
 
 #include "scr_keys.h"
 #include "scr.h"
@@ -29,6 +34,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <string.h>
+#include <regex.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
 
 /* variable length args */
 #include <stdarg.h>
@@ -42,13 +51,19 @@
 #error "globals.h accessed from tools"
 #endif
 
-int buffer_size = 128*1024;
+/* default number of worker threads to verify filemaps */
+#define SCR_INSPECT_DEFAULT_THREADS (8)
 
 static char scr_my_hostname[SCR_MAX_FILENAME];
 
-/* checks whether specifed file exists, is readable, and is complete */
-static int scr_bool_have_file(const scr_filemap* map, const char* file)
+/* checks whether the file of a file-set entry exists, is readable,
+ * and is complete, reads meta data through the entry so a scan of a
+ * large filemap avoids a hash lookup per file */
+static int scr_bool_have_file(const scr_filemap_fset_entry* entry)
 {
+  const char* file = entry->file;
+  scr_meta* meta = entry->meta;
+
   /* if no filename is given return false */
   if (file == NULL || strcmp(file,"") == 0) {
     scr_dbg(2, "File name is null or the empty string @ %s:%d",
@@ -65,13 +80,11 @@ static int scr_bool_have_file(const scr_filemap* map, const char* file)
     return 0;
   }
 
-  /* check that we can read meta file for the file */
-  scr_meta* meta = scr_meta_new();
-  if (scr_filemap_get_meta(map, file, meta) != SCR_SUCCESS) {
+  /* check that the filemap lists meta data for the file */
+  if (meta == NULL) {
     scr_dbg(2, "Failed to read meta data for file: %s @ %s:%d",
       file, __FILE__, __LINE__
     );
-    scr_meta_delete(&meta);
     return 0;
   }
 
@@ -80,67 +93,8 @@ static int scr_bool_have_file(const scr_filemap* map, const char* file)
     scr_dbg(2, "File is marked as incomplete: %s @ %s:%d",
       file, __FILE__, __LINE__
     );
-    scr_meta_delete(&meta);
-    return 0;
-  }
-
-  /* TODODSET: check that dataset id matches */
-#if 0
-  /* check that the file really belongs to the checkpoint id we think it does */
-  int meta_dset = -1;
-  if (scr_meta_get_checkpoint(meta, &meta_dset) != SCR_SUCCESS) {
-    scr_dbg(2, "Failed to read checkpoint field in meta data: %s @ %s:%d",
-      file, __FILE__, __LINE__
-    );
-    scr_meta_delete(&meta);
-    return 0;
-  }
-  if (dset != meta_dset) {
-    scr_dbg(2, "File's checkpoint ID (%d) does not match id in meta data file (%d) for %s @ %s:%d",
-      dset, meta_dset, file, __FILE__, __LINE__
-    );
-    scr_meta_delete(&meta);
-    return 0;
-  }
-#endif
-
-#if 0
-  /* check that the file really belongs to the rank we think it does */
-  int meta_rank = -1;
-  if (scr_meta_get_rank(meta, &meta_rank) != SCR_SUCCESS) {
-    scr_dbg(2, "Failed to read rank field in meta data: %s @ %s:%d",
-      file, __FILE__, __LINE__
-    );
-    scr_meta_delete(&meta);
-    return 0;
-  }
-  if (rank != meta_rank) {
-    scr_dbg(2, "File's rank (%d) does not match rank in meta data file (%d) for %s @ %s:%d",
-      rank, meta_rank, file, __FILE__, __LINE__
-    );
-    scr_meta_delete(&meta);
-    return 0;
-  }
-#endif
-
-#if 0
-  /* check that the file was written with same number of ranks we think it was */
-  int meta_ranks = -1;
-  if (scr_meta_get_ranks(meta, &meta_ranks) != SCR_SUCCESS) {
-    scr_dbg(2, "Failed to read ranks field in meta data: %s @ %s:%d",
-      file, __FILE__, __LINE__
-    );
-    scr_meta_delete(&meta);
     return 0;
   }
-  if (ranks != meta_ranks) {
-    scr_dbg(2, "File's ranks (%d) does not match ranks in meta data file (%d) for %s @ %s:%d",
-      ranks, meta_ranks, file, __FILE__, __LINE__
-    );
-    scr_meta_delete(&meta);
-    return 0;
-  }
-#endif
 
   /* check that the file size matches (use strtol while reading data) */
   unsigned long size = scr_file_size(file);
@@ -149,34 +103,160 @@ static int scr_bool_have_file(const scr_filemap* map, const char* file)
     scr_dbg(2, "Failed to read filesize field in meta data: %s @ %s:%d",
       file, __FILE__, __LINE__
     );
-    scr_meta_delete(&meta);
     return 0;
   }
   if (size != meta_size) {
     scr_dbg(2, "Filesize is incorrect, currently %lu, expected %lu for %s @ %s:%d",
       size, meta_size, file, __FILE__, __LINE__
     );
-    scr_meta_delete(&meta);
     return 0;
   }
 
   /* TODO: check that crc32 match if set (this would be expensive) */
 
-  scr_meta_delete(&meta);
-
   /* if we made it here, assume the file is good */
   return 1;
 }
 
-int main(int argc, char* argv[])
+/* one work unit: verify all files listed in one rank's filemap */
+struct inspect_task {
+  int dset;       /* dataset id */
+  int rank;       /* MPI rank the filemap belongs to */
+  char* filemap;  /* full path to the filemap file */
+};
+
+/* shared work queue, workers claim the next unclaimed task until the
+ * list is exhausted, results are printed under the print lock as each
+ * task completes so consumers can stream them */
+struct inspect_workset {
+  struct inspect_task* tasks;
+  int num_tasks;
+  int next;
+  pthread_mutex_t lock;       /* protects next */
+  pthread_mutex_t print_lock; /* serializes result lines */
+};
+
+/* verify one rank's filemap, prints the result line */
+static void inspect_filemap(struct inspect_task* task, pthread_mutex_t* print_lock)
 {
-  /* print usage if not enough arguments were given */
-  if (argc < 2) {
-    printf("Usage: scr_inspect_cache <cntldir>\n");
-    return 1;
+  /* read in the filemap for this rank */
+  scr_filemap* map = scr_filemap_new();
+  spath* path_filemap = spath_from_str(task->filemap);
+  scr_filemap_read(path_filemap, map);
+  spath_delete(&path_filemap);
+
+  /* check each file this rank wrote, walking a sorted array view
+   * of the map so each check reads its meta data without a hash
+   * lookup */
+  scr_filemap_fset* fset = scr_filemap_fset_from_map(map);
+  int files = scr_filemap_fset_num_files(fset);
+  int complete = 1;
+  int i;
+  for (i = 0; i < files; i++) {
+    const scr_filemap_fset_entry* entry = scr_filemap_fset_file(fset, i);
+
+    /* check that we can read the file */
+    if (! scr_bool_have_file(entry)) {
+      complete = 0;
+      scr_dbg(1, "File is unreadable or incomplete: Dataset %d, Rank %d, File: %s",
+        task->dset, task->rank, entry->file
+      );
+    }
+  }
+
+  scr_filemap_fset_delete(&fset);
+  scr_filemap_delete(&map);
+
+  /* report this rank now rather than waiting for the full scan,
+   * flush so a consumer reading our pipe sees the line immediately */
+  pthread_mutex_lock(print_lock);
+  printf("DSET=%d RANK=%d FILES=%d COMPLETE=%d\n",
+    task->dset, task->rank, files, complete
+  );
+  fflush(stdout);
+  pthread_mutex_unlock(print_lock);
+}
+
+/* verification thread, claims and processes filemaps until none remain */
+static void* inspect_worker(void* arg)
+{
+  struct inspect_workset* work = (struct inspect_workset*) arg;
+  while (1) {
+    /* grab the next unclaimed task */
+    pthread_mutex_lock(&work->lock);
+    int i = work->next;
+    work->next++;
+    pthread_mutex_unlock(&work->lock);
+    if (i >= work->num_tasks) {
+      break;
+    }
+
+    inspect_filemap(&work->tasks[i], &work->print_lock);
   }
+  return NULL;
+}
 
-  spath* scr_main_map_file = spath_from_str(strdup(argv[1]));
+int print_usage()
+{
+  printf("\n");
+  printf("  Usage:  scr_inspect_cache [options] <cntldir>\n");
+  printf("\n");
+  printf("  Options:\n");
+  printf("    -j, --threads=N   Number of verification threads (default %d)\n", SCR_INSPECT_DEFAULT_THREADS);
+  printf("    -i, --id=ID       Only inspect dataset ID (default all)\n");
+  printf("    -h, --help        Print usage\n");
+  printf("\n");
+  exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+  /* define our options */
+  static struct option long_options[] = {
+    {"threads", required_argument, NULL, 'j'},
+    {"id",      required_argument, NULL, 'i'},
+    {"help",    no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  int threads = SCR_INSPECT_DEFAULT_THREADS;
+  int only_id = -1;
+
+  /* loop through and process all options */
+  int c;
+  do {
+    int option_index = 0;
+    c = getopt_long(argc, argv, "j:i:h", long_options, &option_index);
+    switch (c) {
+      case 'j':
+        threads = atoi(optarg);
+        if (threads < 1) {
+          threads = 1;
+        }
+        break;
+      case 'i':
+        only_id = atoi(optarg);
+        break;
+      case 'h':
+        print_usage();
+        break;
+      case '?':
+        /* getopt_long printed an error message */
+        break;
+      default:
+        if (c != -1) {
+          scr_err("scr_inspect_cache: Option '%s' specified but not processed @ %s:%d",
+            argv[option_index], __FILE__, __LINE__
+          );
+        }
+    }
+  } while (c != -1);
+
+  /* print usage if we don't have a control directory */
+  if (argc - optind != 1) {
+    print_usage();
+  }
+  const char* cntldir = argv[optind];
 
   /* get my hostname */
   if (gethostname(scr_my_hostname, sizeof(scr_my_hostname)) != 0) {
@@ -186,98 +266,152 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  /* read in the main map */
-  kvtree* hash = kvtree_new();
-  kvtree_read_path(scr_main_map_file, hash);
+  /* dataset directories look like: "scr.dataset.<id>",
+   * filemaps within look like: "filemap_<rank>" */
+  regex_t re_dataset_dir;
+  regcomp(&re_dataset_dir, "^scr\\.dataset\\.([0-9]+)$", REG_EXTENDED);
 
-  /* create an empty filemap */
-  scr_filemap* map = scr_filemap_new();
+  regex_t re_filemap_file;
+  regcomp(&re_filemap_file, "^filemap_([0-9]+)$", REG_EXTENDED);
 
-  /* for each filemap listed in the main map */
-  kvtree_elem* elem;
-  for (elem = kvtree_elem_first(kvtree_get(hash, "Filemap"));
-       elem != NULL;
-       elem = kvtree_elem_next(elem))
-  {
-    /* get the filename of this filemap */
-    char* file = kvtree_elem_key(elem);
-
-    /* read in the filemap */
-    scr_filemap* tmp_map = scr_filemap_new();
-    spath* path_file = spath_from_str(file);
-    scr_filemap_read(path_file, tmp_map);
-    spath_delete(&path_file);
-
-    /* merge it with local 0 filemap */
-    scr_filemap_merge(map, tmp_map);
-
-    /* delete filemap */
-    scr_filemap_delete(&tmp_map);
+  /* build the list of filemaps to verify, one task per rank */
+  struct inspect_task* tasks = NULL;
+  int num_tasks = 0;
+  int max_tasks = 0;
+
+  errno = 0;
+  DIR* d = opendir(cntldir);
+  if (d == NULL) {
+    scr_err("scr_inspect_cache: Failed to open control directory: %s errno=%d %s @ %s:%d",
+      cntldir, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return 1;
   }
 
-  /* scan each file for each rank of each dataset */
-  kvtree_elem* dset_elem;
-  for (dset_elem = scr_filemap_first_dataset(map);
-       dset_elem != NULL;
-       dset_elem = kvtree_elem_next(dset_elem))
-  {
-    /* get dataset id */
-    int dset = kvtree_elem_key_int(dset_elem);
-
-    /* loop over each rank */
-    kvtree_elem* rank_elem;
-    for (rank_elem = scr_filemap_first_rank_by_dataset(map, dset);
-         rank_elem != NULL;
-         rank_elem = kvtree_elem_next(rank_elem))
-    {
-      /* get rank id */
-      int rank = kvtree_elem_key_int(rank_elem);
-
-      /* verify that the number of files matches the expected number */
-      int missing_file = 0;
-      /* first time through the file list, check that we have each file */
-      kvtree_elem* file_elem = NULL;
-      for (file_elem = scr_filemap_first_file(map);
-           file_elem != NULL;
-           file_elem = kvtree_elem_next(file_elem))
-      {
-        /* get filename */
-        char* file = kvtree_elem_key(file_elem);
-
-        /* check that we can read the file */
-        if (! scr_bool_have_file(map, dset, rank, file)) {
-            missing_file = 1;
-            scr_dbg(1, "File is unreadable or incomplete: Dataset %d, Rank %d, File: %s",
-              dset, rank, file
+  struct dirent* de;
+  while ((de = readdir(d)) != NULL) {
+    /* look for dataset directories */
+    size_t nmatch = 2;
+    regmatch_t pmatch[2];
+    if (regexec(&re_dataset_dir, de->d_name, nmatch, pmatch, 0) != 0) {
+      continue;
+    }
+
+    /* get the dataset id */
+    char* value = strndup(de->d_name + pmatch[1].rm_so,
+      (size_t)(pmatch[1].rm_eo - pmatch[1].rm_so));
+    int dset = atoi(value);
+    scr_free(&value);
+
+    /* skip datasets we weren't asked about */
+    if (only_id >= 0 && dset != only_id) {
+      continue;
+    }
+
+    /* filemaps live in the .scr subdirectory of the dataset */
+    spath* map_dir_path = spath_from_str(cntldir);
+    spath_append_str(map_dir_path, de->d_name);
+    spath_append_str(map_dir_path, ".scr");
+    spath_reduce(map_dir_path);
+    char* map_dir = spath_strdup(map_dir_path);
+
+    DIR* md = opendir(map_dir);
+    if (md != NULL) {
+      struct dirent* me;
+      while ((me = readdir(md)) != NULL) {
+        if (regexec(&re_filemap_file, me->d_name, nmatch, pmatch, 0) != 0) {
+          continue;
+        }
+
+        /* get the MPI rank of the filemap */
+        value = strndup(me->d_name + pmatch[1].rm_so,
+          (size_t)(pmatch[1].rm_eo - pmatch[1].rm_so));
+        int rank = atoi(value);
+        scr_free(&value);
+
+        /* grow the task list as needed */
+        if (num_tasks == max_tasks) {
+          max_tasks = (max_tasks > 0) ? max_tasks * 2 : 64;
+          tasks = (struct inspect_task*) realloc(tasks,
+            max_tasks * sizeof(struct inspect_task));
+          if (tasks == NULL) {
+            scr_abort(-1, "scr_inspect_cache: Failed to allocate task list @ %s:%d",
+              __FILE__, __LINE__
             );
+          }
         }
+
+        /* record the task */
+        spath* map_file_path = spath_from_str(map_dir);
+        spath_append_str(map_file_path, me->d_name);
+        tasks[num_tasks].dset    = dset;
+        tasks[num_tasks].rank    = rank;
+        tasks[num_tasks].filemap = spath_strdup(map_file_path);
+        spath_delete(&map_file_path);
+        num_tasks++;
       }
+      closedir(md);
+    }
 
-      /* TODO: print partner names */
-      /* if we're not missing a file for rank, print this info out */
-      if (! missing_file) {
-        kvtree* desc = kvtree_new();
-        scr_filemap_get_desc(map, dset, rank, desc);
-        char* type           = kvtree_elem_get_first_val(desc, SCR_CONFIG_KEY_TYPE);
-        char* groups_str     = kvtree_elem_get_first_val(desc, SCR_CONFIG_KEY_GROUPS);
-        char* group_id_str   = kvtree_elem_get_first_val(desc, SCR_CONFIG_KEY_GROUP_ID);
-        char* group_size_str = kvtree_elem_get_first_val(desc, SCR_CONFIG_KEY_GROUP_SIZE);
-        char* group_rank_str = kvtree_elem_get_first_val(desc, SCR_CONFIG_KEY_GROUP_RANK);
-        if (type != NULL && groups_str != NULL && group_id_str != NULL && group_size_str != NULL && group_rank_str != NULL) {
-          /* we already have a group id and rank, use that to rebuild the communicator */
-          int groups     = atoi(groups_str);
-          int group_id   = atoi(group_id_str);
-          int group_size = atoi(group_size_str);
-          int group_rank = atoi(group_rank_str);
-          printf("DSET=%d RANK=%d TYPE=%s GROUPS=%d GROUP_ID=%d GROUP_SIZE=%d GROUP_RANK=%d FILES=1\n",
-            dset, rank, type, groups, group_id, group_size, group_rank
-          );
-        }
+    scr_free(&map_dir);
+    spath_delete(&map_dir_path);
+  }
+  closedir(d);
+
+  regfree(&re_filemap_file);
+  regfree(&re_dataset_dir);
+
+  /* set up the shared work queue */
+  struct inspect_workset work;
+  work.tasks     = tasks;
+  work.num_tasks = num_tasks;
+  work.next      = 0;
+  pthread_mutex_init(&work.lock, NULL);
+  pthread_mutex_init(&work.print_lock, NULL);
+
+  /* no point spinning up more threads than we have filemaps */
+  if (threads > num_tasks) {
+    threads = num_tasks;
+  }
+
+  if (threads > 1) {
+    /* start the workers and wait for them to drain the queue */
+    pthread_t* tids = (pthread_t*) SCR_MALLOC(sizeof(pthread_t) * threads);
+    int t;
+    int started = 0;
+    for (t = 0; t < threads; t++) {
+      if (pthread_create(&tids[t], NULL, inspect_worker, &work) != 0) {
+        scr_err("scr_inspect_cache: Failed to create verification thread %d @ %s:%d",
+          t, __FILE__, __LINE__
+        );
+        break;
       }
+      started++;
+    }
+
+    /* if we failed to start any thread, drain the queue ourselves */
+    if (started == 0) {
+      inspect_worker(&work);
     }
+
+    for (t = 0; t < started; t++) {
+      pthread_join(tids[t], NULL);
+    }
+    scr_free(&tids);
+  } else {
+    /* single filemap or single thread, just run the queue inline */
+    inspect_worker(&work);
   }
 
-  spath_delete(&scr_main_map_file);
+  pthread_mutex_destroy(&work.print_lock);
+  pthread_mutex_destroy(&work.lock);
+
+  /* free the task list */
+  int i;
+  for (i = 0; i < num_tasks; i++) {
+    scr_free(&tasks[i].filemap);
+  }
+  scr_free(&tasks);
 
   return 0;
 }
@@ -18,6 +18,8 @@
  *   3) open()/fopen() to call SCR_Start_checkpoint() and/or SCR_Route_file()
  *      before opening the file
  *   4) close()/fclose() to call SCR_Complete_checkpoint() after closing file
+ *   5) write()/read()/lseek()/fsync() to coalesce small sequential writes
+ *      on checkpoint files into large ones via a per-file staging buffer
  *
  * This library determines which files are checkpoint files by comparing them
  * to a regular expression provided by the user via an environment variable.
@@ -35,6 +37,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -55,15 +58,14 @@
 static int scri_initialized       = 0;
 static int scri_interpose_enabled = 0;
 static int scri_in_checkpoint     = 0;
+static int scri_write_failed      = 0;
 static int scri_ranks             = 0;
 static int scri_rank              = -1;
 
 static int scri_re_low_high_compiled = 0;
 static int scri_re_low_N_compiled    = 0;
-static int scri_re_scr_file_compiled = 0;
 static regex_t scri_re_low_high;
 static regex_t scri_re_low_N;
-static regex_t scri_re_scr_file;
 
 /* interpose MPI functions */
 int (* scri_real_mpi_init)  (int *, char ***) = NULL;
@@ -88,11 +90,11 @@ int (* scri_real_mkdir)     (const char *, mode_t) = NULL;
  *   mkdir() -- for checkpoint directories -- turn into a NOP
  */
 
-/* interpose read/write functions */
-/*
-ssize_t (* real_read)  (int fd, void *buf, size_t count);
-ssize_t (* real_write) (int fd, const void *buf, size_t count);
-*/
+/* interpose read/write/seek functions, needed for write combining */
+ssize_t (* scri_real_read)  (int fd, void *buf, size_t count)       = NULL;
+ssize_t (* scri_real_write) (int fd, const void *buf, size_t count) = NULL;
+off_t   (* scri_real_lseek) (int fd, off_t offset, int whence)      = NULL;
+int     (* scri_real_fsync) (int fd)                                = NULL;
 
 /*
 ==============================================================================
@@ -104,6 +106,14 @@ Checkpoint tracking functions and data structures
 #define MAX_CHECKPOINT_FILES (8)
 #endif
 
+/* default size of the per-file write-combining buffer, legacy codes
+ * that emit streams of sub-kilobyte write() calls have them staged
+ * here and written out in chunks of this size, may be overridden
+ * with SCR_CHECKPOINT_WRITE_BUF, a value of 0 disables staging */
+#ifndef SCRI_WRITE_BUF_SIZE
+#define SCRI_WRITE_BUF_SIZE (1024*1024)
+#endif
+
 #define SCRI_FNULL   (0)
 #define SCRI_FD      (1)
 #define SCRI_FSTREAM (2)
@@ -116,11 +126,16 @@ struct scri_checkpointfile
   char* filename;
   char* tempname;
   regex_t re;
+  char* prefix;  /* literal lead of an anchored pattern, NULL if none */
+  char* literal; /* longest literal substring in pattern, NULL if none */
   int   ftype;
   int   fd;
   int   flags;
   FILE* fstream;
   char* mode;
+  char*  wbuf;      /* staging buffer that coalesces small sequential writes */
+  size_t wbuf_size; /* capacity of staging buffer, 0 if write combining is off */
+  size_t wbuf_used; /* number of bytes currently staged */
 };
 
 /* TODO: change this fixed array to a linked list */
@@ -132,6 +147,242 @@ static struct scri_checkpointfile scri_checkpoint_files[MAX_CHECKPOINT_FILES];
 /* keeps track of checkpoint directory */
 static int     scri_checkpoint_dir_valid = 0;
 static regex_t scri_re_checkpoint_dir;
+static char*   scri_checkpoint_dir_prefix  = NULL;
+static char*   scri_checkpoint_dir_literal = NULL;
+
+/* set once scri_define_checkpoint_files has run, filename lookups are
+ * only memoized after this point since earlier lookups see no patterns */
+static int scri_patterns_defined = 0;
+
+/* size of the write-combining buffer allocated per checkpoint file */
+static size_t scri_write_buf_size = SCRI_WRITE_BUF_SIZE;
+
+/*
+==============================================================================
+Hash tables for O(1) fd, fstream, and filename lookups
+
+Every intercepted open/close goes through scri_index_by_*, so we keep
+open-addressing hash tables alongside the checkpoint file array rather
+than scanning it.  The fd and fstream tables use linear probing with
+cluster re-insertion on remove.  The filename table is a direct-mapped
+memo of regex match results keyed by exact name, colliding names just
+overwrite, since the regex set is fixed after init a memoized result
+never goes stale.
+==============================================================================
+*/
+
+/* number of slots in each table, must be a power of two and comfortably
+ * larger than MAX_CHECKPOINT_FILES so probe chains stay short */
+#ifndef SCRI_HASH_SLOTS
+#define SCRI_HASH_SLOTS (64)
+#endif
+
+#define SCRI_SLOT_EMPTY (-1)
+
+/* maps open file descriptors to entries in scri_checkpoint_files */
+static int scri_fd_keys[SCRI_HASH_SLOTS];
+static int scri_fd_vals[SCRI_HASH_SLOTS];
+
+/* maps open file streams to entries in scri_checkpoint_files */
+static FILE* scri_fstream_keys[SCRI_HASH_SLOTS];
+static int   scri_fstream_vals[SCRI_HASH_SLOTS];
+
+/* memoizes filename regex match results, one strdup'd name per slot */
+static char* scri_name_keys[SCRI_HASH_SLOTS];
+static int   scri_name_vals[SCRI_HASH_SLOTS];
+
+/* Knuth multiplicative hash for integer keys */
+static unsigned int scri_hash_int(int key)
+{
+  return ((unsigned int) key) * 2654435761u;
+}
+
+/* hash a pointer, dropping the low bits which are mostly alignment */
+static unsigned int scri_hash_ptr(const void* p)
+{
+  return ((unsigned int) (((uintptr_t) p) >> 4)) * 2654435761u;
+}
+
+/* FNV-1a hash for filename strings */
+static unsigned int scri_hash_str(const char* s)
+{
+  unsigned int hash = 2166136261u;
+  while (*s != '\0') {
+    hash ^= (unsigned char) *s;
+    hash *= 16777619u;
+    s++;
+  }
+  return hash;
+}
+
+/* record that fd maps to the given checkpoint file entry */
+static void scri_fd_table_insert(int fd, int index)
+{
+  /* the table always has free slots since we hold at most
+   * MAX_CHECKPOINT_FILES open files at a time */
+  unsigned int slot = scri_hash_int(fd) & (SCRI_HASH_SLOTS - 1);
+  while (scri_fd_keys[slot] != SCRI_SLOT_EMPTY) {
+    slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+  }
+  scri_fd_keys[slot] = fd;
+  scri_fd_vals[slot] = index;
+}
+
+/* drop fd from the table, re-inserting the rest of its probe cluster
+ * so lookups that stop at the first empty slot still find every key */
+static void scri_fd_table_remove(int fd)
+{
+  unsigned int slot = scri_hash_int(fd) & (SCRI_HASH_SLOTS - 1);
+  while (scri_fd_keys[slot] != SCRI_SLOT_EMPTY) {
+    if (scri_fd_keys[slot] == fd) {
+      scri_fd_keys[slot] = SCRI_SLOT_EMPTY;
+      slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+      while (scri_fd_keys[slot] != SCRI_SLOT_EMPTY) {
+        int key = scri_fd_keys[slot];
+        int val = scri_fd_vals[slot];
+        scri_fd_keys[slot] = SCRI_SLOT_EMPTY;
+        scri_fd_table_insert(key, val);
+        slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+      }
+      return;
+    }
+    slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+  }
+}
+
+/* record that fstream maps to the given checkpoint file entry */
+static void scri_fstream_table_insert(const FILE* fstream, int index)
+{
+  unsigned int slot = scri_hash_ptr(fstream) & (SCRI_HASH_SLOTS - 1);
+  while (scri_fstream_keys[slot] != NULL) {
+    slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+  }
+  scri_fstream_keys[slot] = (FILE*) fstream;
+  scri_fstream_vals[slot] = index;
+}
+
+/* drop fstream from the table, re-inserting the rest of its probe cluster */
+static void scri_fstream_table_remove(const FILE* fstream)
+{
+  unsigned int slot = scri_hash_ptr(fstream) & (SCRI_HASH_SLOTS - 1);
+  while (scri_fstream_keys[slot] != NULL) {
+    if (scri_fstream_keys[slot] == fstream) {
+      scri_fstream_keys[slot] = NULL;
+      slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+      while (scri_fstream_keys[slot] != NULL) {
+        FILE* key = scri_fstream_keys[slot];
+        int   val = scri_fstream_vals[slot];
+        scri_fstream_keys[slot] = NULL;
+        scri_fstream_table_insert(key, val);
+        slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+      }
+      return;
+    }
+    slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
+  }
+}
+
+/* reset all tables to empty, frees any memoized filenames */
+static void scri_tables_init(void)
+{
+  int i;
+  for (i = 0; i < SCRI_HASH_SLOTS; i++) {
+    scri_fd_keys[i]      = SCRI_SLOT_EMPTY;
+    scri_fstream_keys[i] = NULL;
+    if (scri_name_keys[i] != NULL) {
+      free(scri_name_keys[i]);
+      scri_name_keys[i] = NULL;
+    }
+  }
+}
+
+/* Extract cheap literal screens from a regex pattern.  Returns the
+ * longest run of literal characters via literal, and, when the pattern
+ * is anchored with '^' and starts with literals, that leading run via
+ * prefix.  Either may come back NULL when the pattern offers nothing
+ * usable.  A literal character directly followed by a quantifier is
+ * excluded since it may match some other number of times. */
+static void scri_pattern_screens(const char* pattern, char** prefix, char** literal)
+{
+  *prefix  = NULL;
+  *literal = NULL;
+
+  int anchored = (pattern[0] == '^');
+
+  int best_start = 0;
+  int best_len   = 0;
+  int prefix_len = 0;
+  int run_start  = -1;
+
+  int i = anchored ? 1 : 0;
+  while (1) {
+    char c = pattern[i];
+    int skip = 1;
+    int in_run = 0;
+    if (c == '\\') {
+      /* escaped character, treat conservatively and end the run */
+      skip = (pattern[i+1] != '\0') ? 2 : 1;
+    } else if (c == '[') {
+      /* bracket expression, skip to the closing bracket */
+      int j = i + 1;
+      if (pattern[j] == '^') { j++; }
+      if (pattern[j] == ']') { j++; }
+      while (pattern[j] != '\0' && pattern[j] != ']') { j++; }
+      skip = (pattern[j] == ']') ? (j - i + 1) : (j - i);
+    } else if (c != '\0' && strchr("^$.()|*+?{}", c) == NULL) {
+      /* ordinary character, part of a literal run unless quantified */
+      char next = pattern[i+1];
+      if (next != '*' && next != '+' && next != '?' && next != '{') {
+        if (run_start < 0) { run_start = i; }
+        in_run = 1;
+      }
+    }
+
+    /* close out the current literal run if this character ended it */
+    if (!in_run && run_start >= 0) {
+      int len = i - run_start;
+      if (len > best_len) {
+        best_len   = len;
+        best_start = run_start;
+      }
+      if (anchored && run_start == 1) {
+        prefix_len = len;
+      }
+      run_start = -1;
+    }
+
+    if (c == '\0') { break; }
+    i += skip;
+  }
+
+  if (prefix_len > 0) {
+    *prefix = strndup(pattern + 1, (size_t) prefix_len);
+  }
+  if (best_len > 0) {
+    *literal = strndup(pattern + best_start, (size_t) best_len);
+  }
+}
+
+/* return 1 if name passes the literal screens for a pattern,
+ * 0 means the pattern cannot possibly match and the regex engine
+ * need not be invoked at all */
+static int scri_screens_pass(const char* name, const char* prefix, const char* literal)
+{
+  if (prefix != NULL && strncmp(name, prefix, strlen(prefix)) != 0) {
+    return 0;
+  }
+  if (literal != NULL && strstr(name, literal) == NULL) {
+    return 0;
+  }
+  return 1;
+}
+
+/* return 1 if name ends with the .scr extension */
+static int scri_name_is_scr(const char* name)
+{
+  size_t len = strlen(name);
+  return (len >= 4 && strcmp(name + len - 4, ".scr") == 0);
+}
 
 /* given a filename and regular expression, return whether there is a match */
 static int scri_file_matches(const char* filename, regex_t* re)
@@ -141,8 +392,8 @@ static int scri_file_matches(const char* filename, regex_t* re)
 
   /* check for a match on the filename, and check that it's *not* an .scr file */
   memset(pmatch, 0, sizeof(regmatch_t) * nmatch);
-  if (regexec(re, filename, nmatch, pmatch, 0) == 0 &&
-      regexec(&scri_re_scr_file, filename, nmatch, pmatch, 0) == REG_NOMATCH)
+  if (!scri_name_is_scr(filename) &&
+      regexec(re, filename, nmatch, pmatch, 0) == 0)
   {
     return 1;
   }
@@ -166,8 +417,9 @@ static int scri_start_checkpoint()
     SCR_Start_checkpoint();
     scri_interpose_enabled = 1;
 
-    /* mark us inside a checkpoint */
+    /* mark us inside a checkpoint with no write failures yet */
     scri_in_checkpoint = 1;
+    scri_write_failed = 0;
   }
 
   return SCR_SUCCESS;
@@ -192,11 +444,12 @@ static int scri_complete_checkpoint(int index)
       }
     }
 
-    /* if there are no files yet to be completed, complete the checkpoint */
+    /* if there are no files yet to be completed, complete the checkpoint,
+     * marking it invalid if any file lost staged writes */
     if (!still_open) {
       /* disable the interposer since SCR_Complete_checkpoint calls open/close */
       scri_interpose_enabled = 0;
-      SCR_Complete_checkpoint(1);
+      SCR_Complete_checkpoint(!scri_write_failed);
       scri_interpose_enabled = 1;
 
       /* mark us out of the checkpoint */
@@ -210,28 +463,55 @@ static int scri_complete_checkpoint(int index)
 /* lookup a checkpoint file index given a filename */
 static int scri_index_by_filename(const char* filename)
 {
+  /* names are matched by regex so they can't be hashed directly,
+   * instead we memoize the match result for each exact name,
+   * legacy codes reopen the same names over and over so this hits
+   * nearly always */
+  unsigned int slot = scri_hash_str(filename) & (SCRI_HASH_SLOTS - 1);
+  if (scri_patterns_defined &&
+      scri_name_keys[slot] != NULL &&
+      strcmp(scri_name_keys[slot], filename) == 0)
+  {
+    return scri_name_vals[slot];
+  }
+
+  /* miss, run the name past each pattern, checking the cheap literal
+   * screens first so non-checkpoint names usually skip the regex */
+  int index = MAX_CHECKPOINT_FILES;
   int i;
   for(i=0; i<MAX_CHECKPOINT_FILES; i++) {
     if (scri_checkpoint_files[i].valid &&
+        scri_screens_pass(filename, scri_checkpoint_files[i].prefix,
+                          scri_checkpoint_files[i].literal) &&
         scri_file_matches(filename, &scri_checkpoint_files[i].re))
     {
-      return i;
+      index = i;
+      break;
     }
   }
-  return MAX_CHECKPOINT_FILES;
+
+  /* memoize the result, including misses, but only once the pattern
+   * set has been defined so an early miss can't go stale */
+  if (scri_patterns_defined) {
+    if (scri_name_keys[slot] != NULL) {
+      free(scri_name_keys[slot]);
+    }
+    scri_name_keys[slot] = strdup(filename);
+    scri_name_vals[slot] = index;
+  }
+
+  return index;
 }
 
 /* lookup a checkpoint file index given an open file descriptor */
 static int scri_index_by_fd(const int fd)
 {
-  int i;
-  for(i=0; i<MAX_CHECKPOINT_FILES; i++) {
-    if (scri_checkpoint_files[i].valid &&
-        scri_checkpoint_files[i].ftype == SCRI_FD &&
-        fd == scri_checkpoint_files[i].fd)
-    {
-      return i;
+  unsigned int slot = scri_hash_int(fd) & (SCRI_HASH_SLOTS - 1);
+  while (scri_fd_keys[slot] != SCRI_SLOT_EMPTY) {
+    if (scri_fd_keys[slot] == fd) {
+      return scri_fd_vals[slot];
     }
+    slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
   }
   return MAX_CHECKPOINT_FILES;
 }
@@ -239,14 +519,12 @@ static int scri_index_by_fd(const int fd)
 /* lookup a checkpoint file index given an open file stream */
 static int scri_index_by_fstream(const FILE* fstream)
 {
-  int i;
-  for(i=0; i<MAX_CHECKPOINT_FILES; i++) {
-    if (scri_checkpoint_files[i].valid &&
-        scri_checkpoint_files[i].ftype == SCRI_FSTREAM &&
-        fstream == scri_checkpoint_files[i].fstream)
-    {
-      return i;
+  unsigned int slot = scri_hash_ptr(fstream) & (SCRI_HASH_SLOTS - 1);
+  while (scri_fstream_keys[slot] != NULL) {
+    if (scri_fstream_keys[slot] == fstream) {
+      return scri_fstream_vals[slot];
     }
+    slot = (slot + 1) & (SCRI_HASH_SLOTS - 1);
   }
   return MAX_CHECKPOINT_FILES;
 }
@@ -256,6 +534,7 @@ static int scri_is_checkpoint_dirname(const char* name)
 {
   if (scri_interpose_enabled &&
       scri_checkpoint_dir_valid &&
+      scri_screens_pass(name, scri_checkpoint_dir_prefix, scri_checkpoint_dir_literal) &&
       scri_file_matches(name, &scri_re_checkpoint_dir))
   {
     return 1;
@@ -302,6 +581,25 @@ static int scri_is_checkpoint_fstream(const FILE* fstream)
   return 0;
 }
 
+/* write out any bytes staged in the write-combining buffer for the
+ * given checkpoint file entry, returns 0 on success, on failure
+ * returns -1 with errno set by the underlying write */
+static int scri_wbuf_flush(int index)
+{
+  struct scri_checkpointfile* f = &scri_checkpoint_files[index];
+  size_t done = 0;
+  while (done < f->wbuf_used) {
+    ssize_t n = (*scri_real_write)(f->fd, f->wbuf + done, f->wbuf_used - done);
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      return -1;
+    }
+    done += (size_t) n;
+  }
+  f->wbuf_used = 0;
+  return 0;
+}
+
 /* record file descriptor and flags used in open call for this filename */
 static int scri_add_checkpoint_fd(const char* file, const char* temp, const int fd, const int flags)
 {
@@ -311,6 +609,21 @@ static int scri_add_checkpoint_fd(const char* file, const char* temp, const int
     scri_checkpoint_files[i].ftype    = SCRI_FD;
     scri_checkpoint_files[i].fd       = fd;
     scri_checkpoint_files[i].flags    = flags;
+
+    /* set up the write-combining buffer when the file is writable,
+     * legacy codes write checkpoints in tiny records and staging
+     * them here turns the stream into full-sized writes */
+    if (scri_write_buf_size > 0 &&
+        ((flags & O_RDWR) || (flags & O_WRONLY)))
+    {
+      scri_checkpoint_files[i].wbuf = (char*) malloc(scri_write_buf_size);
+      if (scri_checkpoint_files[i].wbuf != NULL) {
+        scri_checkpoint_files[i].wbuf_size = scri_write_buf_size;
+        scri_checkpoint_files[i].wbuf_used = 0;
+      }
+    }
+
+    scri_fd_table_insert(fd, i);
     return 0;
   }
 
@@ -335,6 +648,13 @@ static int scri_drop_checkpoint_fd(const int fd)
     scri_checkpoint_files[i].ftype = SCRI_FNULL;
     scri_checkpoint_files[i].fd    = -1;
     scri_checkpoint_files[i].flags = 0;
+    if (scri_checkpoint_files[i].wbuf != NULL) {
+      free(scri_checkpoint_files[i].wbuf);
+      scri_checkpoint_files[i].wbuf      = NULL;
+      scri_checkpoint_files[i].wbuf_size = 0;
+      scri_checkpoint_files[i].wbuf_used = 0;
+    }
+    scri_fd_table_remove(fd);
     return 0;
   }
   /* TODO: an error to get here */
@@ -350,6 +670,7 @@ static int scri_add_checkpoint_fstream(const char* file, const char* temp, const
     scri_checkpoint_files[i].ftype    = SCRI_FSTREAM;
     scri_checkpoint_files[i].fstream  = (FILE*) fstream;
     scri_checkpoint_files[i].mode     = strdup(mode);
+    scri_fstream_table_insert(fstream, i);
     return 0;
   }
 
@@ -377,6 +698,7 @@ static int scri_drop_checkpoint_fstream(const FILE* fstream)
       free(scri_checkpoint_files[i].mode);
       scri_checkpoint_files[i].mode = NULL;
     }
+    scri_fstream_table_remove(fstream);
     return 0;
   }
   /* TODO: an error to get here */
@@ -395,6 +717,9 @@ static int scri_define_checkpoint_dirname_regex(const char* dirname)
     exit(1);
   }
 
+  /* pull literal screens from the pattern for the fast-path check */
+  scri_pattern_screens(dirname, &scri_checkpoint_dir_prefix, &scri_checkpoint_dir_literal);
+
   /* note that the checkpoint directory regular expression is valid */
   scri_checkpoint_dir_valid = 1;
 
@@ -426,6 +751,11 @@ static int scri_define_checkpoint_filename_regex(const char* filename)
         exit(1);
       }
 
+      /* pull literal screens from the pattern for the fast-path check */
+      scri_pattern_screens(filename,
+        &scri_checkpoint_files[i].prefix, &scri_checkpoint_files[i].literal
+      );
+
       return 0;
     }
   }
@@ -528,6 +858,13 @@ static int scri_define_checkpoint_files()
     }
   }
 
+  /* read in the write-combining buffer size, 0 disables staging */
+  if ((value = getenv("SCR_CHECKPOINT_WRITE_BUF")) != NULL) {
+    if (strcmp(value, "") != 0) {
+      scri_write_buf_size = (size_t) strtoul(value, NULL, 0);
+    }
+  }
+
   /* add the regex patterns to our list */
   if (pattern != NULL) {
     int i = 0;
@@ -581,6 +918,9 @@ static int scri_define_checkpoint_files()
     exit(1);
   }
 
+  /* pattern set is now fixed, filename lookups may start memoizing */
+  scri_patterns_defined = 1;
+
   return 0;
 }
 
@@ -637,11 +977,19 @@ static void scr_interpose_init()
     scri_real_mkdir = (int (*)(const char*, mode_t)) mydlsym("mkdir");
   }
 
-  /* interpose read/write functions */
-/*
-  real_read  = (ssize_t (*)(int fd, void *buf, size_t count))       mydlsym("read");
-  real_write = (ssize_t (*)(int fd, const void *buf, size_t count)) mydlsym("write");
-*/
+  /* interpose read/write/seek functions for write combining */
+  if (scri_real_read == NULL) {
+    scri_real_read  = (ssize_t (*)(int fd, void *buf, size_t count)) mydlsym("read");
+  }
+  if (scri_real_write == NULL) {
+    scri_real_write = (ssize_t (*)(int fd, const void *buf, size_t count)) mydlsym("write");
+  }
+  if (scri_real_lseek == NULL) {
+    scri_real_lseek = (off_t (*)(int fd, off_t offset, int whence)) mydlsym("lseek");
+  }
+  if (scri_real_fsync == NULL) {
+    scri_real_fsync = (int (*)(int fd)) mydlsym("fsync");
+  }
 
   /* initialize the data structures */
   if (!scri_checkpoint_files_valid) {
@@ -652,12 +1000,20 @@ static void scr_interpose_init()
       scri_checkpoint_files[i].enabled  = 1;
       scri_checkpoint_files[i].filename = NULL;
       scri_checkpoint_files[i].tempname = NULL;
+      scri_checkpoint_files[i].prefix   = NULL;
+      scri_checkpoint_files[i].literal  = NULL;
       scri_checkpoint_files[i].ftype    = SCRI_FNULL;
       scri_checkpoint_files[i].fd       = -1;
       scri_checkpoint_files[i].flags    = 0;
       scri_checkpoint_files[i].fstream  = NULL;
       scri_checkpoint_files[i].mode     = NULL;
+      scri_checkpoint_files[i].wbuf      = NULL;
+      scri_checkpoint_files[i].wbuf_size = 0;
+      scri_checkpoint_files[i].wbuf_used = 0;
     }
+
+    /* start with empty lookup tables */
+    scri_tables_init();
   }
 
   /* compile the low-high range regex pattern */
@@ -667,7 +1023,6 @@ static void scr_interpose_init()
   int rc;
   char low_high_range[] = "^([0-9]+)-([0-9]+):";
   char low_N_range[]    = "^([0-9]+)-(N):";
-  char scr_file_ext[]   = ".scr$";
   if (!scri_re_low_high_compiled) {
     scri_re_low_high_compiled = 1;
     rc = regcomp(&scri_re_low_high, low_high_range, REG_EXTENDED);
@@ -688,17 +1043,6 @@ static void scr_interpose_init()
       exit(1);
     }
   }
-  if (!scri_re_scr_file_compiled) {
-    scri_re_scr_file_compiled = 1;
-    rc = regcomp(&scri_re_scr_file, scr_file_ext, REG_EXTENDED);
-    if (rc != 0) {
-      fprintf(stderr,"SCRI: ERROR: Failed to compile scr file extension regex: %s (rc=%d) @ %s:%d\n",
-             scr_file_ext, rc, __FILE__, __LINE__
-      );
-      exit(1);
-    }
-  }
-
   scri_interpose_enabled = 1;
   scri_initialized = 1;
 }
@@ -765,9 +1109,16 @@ int MPI_Finalize ()
   /* free off the regular expression structures */
   regfree(&scri_re_low_high);
   regfree(&scri_re_low_N);
-  regfree(&scri_re_scr_file);
   if (scri_checkpoint_dir_valid) {
     regfree(&scri_re_checkpoint_dir);
+    if (scri_checkpoint_dir_prefix != NULL) {
+      free(scri_checkpoint_dir_prefix);
+      scri_checkpoint_dir_prefix = NULL;
+    }
+    if (scri_checkpoint_dir_literal != NULL) {
+      free(scri_checkpoint_dir_literal);
+      scri_checkpoint_dir_literal = NULL;
+    }
   }
   if (scri_checkpoint_files_valid) {
     int i;
@@ -783,9 +1134,26 @@ int MPI_Finalize ()
           free(scri_checkpoint_files[i].tempname);
           scri_checkpoint_files[i].tempname = NULL;
         }
+        if (scri_checkpoint_files[i].prefix != NULL) {
+          free(scri_checkpoint_files[i].prefix);
+          scri_checkpoint_files[i].prefix = NULL;
+        }
+        if (scri_checkpoint_files[i].literal != NULL) {
+          free(scri_checkpoint_files[i].literal);
+          scri_checkpoint_files[i].literal = NULL;
+        }
+        if (scri_checkpoint_files[i].wbuf != NULL) {
+          free(scri_checkpoint_files[i].wbuf);
+          scri_checkpoint_files[i].wbuf      = NULL;
+          scri_checkpoint_files[i].wbuf_size = 0;
+          scri_checkpoint_files[i].wbuf_used = 0;
+        }
         regfree(&scri_checkpoint_files[i].re);
       }
     }
+
+    /* drop any table entries and memoized filenames */
+    scri_tables_init();
   }
 
   /* call the real MPI_Finalize */
@@ -868,6 +1236,22 @@ int close(int fd)
 
   /* TODO: need to fsync here as well? */
 
+  /* push out any writes staged for this descriptor before it goes away,
+   * we do this even when interposing is disabled so staged bytes
+   * can't be dropped, if the drain fails this close must fail like
+   * fclose would, since the application was already told those bytes
+   * were written */
+  int flush_errno = 0;
+  int index = scri_index_by_fd(fd);
+  if (index < MAX_CHECKPOINT_FILES &&
+      scri_checkpoint_files[index].wbuf != NULL)
+  {
+    if (scri_wbuf_flush(index) != 0) {
+      flush_errno = errno;
+      scri_write_failed = 1;
+    }
+  }
+
   /* close the file */
   int rc = (*scri_real_close)(fd);
 
@@ -881,9 +1265,16 @@ int close(int fd)
     scri_drop_checkpoint_fd(fd);
   }
 
+  /* surface a failed drain to the caller so the short file is not
+   * treated as a complete checkpoint file */
+  if (flush_errno != 0) {
+    errno = flush_errno;
+    return -1;
+  }
+
   /* return what ever the real close call gave us */
   return rc;
-} 
+}
 
 #ifdef fopen 
 #undef fopen
@@ -956,6 +1347,108 @@ int fclose(FILE* fstream)
   return rc;
 } 
 
+/*
+==============================================================================
+Interpose read/write functions
+
+Small sequential write() calls on a checkpoint file are coalesced in a
+per-file staging buffer and written out in scri_write_buf_size chunks,
+legacy codes that emit millions of tiny records then hit the underlying
+store with full-sized writes.  The staged bytes always sit at the
+current file offset, so any call that moves or reads the offset drains
+the buffer first.  Streams opened with fopen() are left to stdio's own
+buffering.
+==============================================================================
+*/
+
+#ifdef write
+#undef write
+#endif
+ssize_t write(int fd, const void *buf, size_t count)
+{
+  if (!scri_initialized) { scr_interpose_init(); }
+
+  /* pass descriptors we aren't staging straight through */
+  int i = scri_index_by_fd(fd);
+  if (i >= MAX_CHECKPOINT_FILES || scri_checkpoint_files[i].wbuf == NULL) {
+    return (*scri_real_write)(fd, buf, count);
+  }
+  struct scri_checkpointfile* f = &scri_checkpoint_files[i];
+
+  /* when interposing is off (we're inside an SCR call), drain the
+   * buffer and write directly to keep the bytes in order */
+  if (!scri_interpose_enabled) {
+    if (scri_wbuf_flush(i) != 0) { return -1; }
+    return (*scri_real_write)(fd, buf, count);
+  }
+
+  /* writes at least as large as the buffer gain nothing from staging,
+   * drain what's pending and send them straight to the file */
+  if (count >= f->wbuf_size) {
+    if (scri_wbuf_flush(i) != 0) { return -1; }
+    return (*scri_real_write)(fd, buf, count);
+  }
+
+  /* drain the buffer if this write doesn't fit behind the staged bytes */
+  if (f->wbuf_used + count > f->wbuf_size) {
+    if (scri_wbuf_flush(i) != 0) { return -1; }
+  }
+
+  /* stage this write and report it complete */
+  memcpy(f->wbuf + f->wbuf_used, buf, count);
+  f->wbuf_used += count;
+  return (ssize_t) count;
+}
+
+#ifdef read
+#undef read
+#endif
+ssize_t read(int fd, void *buf, size_t count)
+{
+  if (!scri_initialized) { scr_interpose_init(); }
+
+  /* a read consumes the file offset, so staged bytes must land first */
+  int i = scri_index_by_fd(fd);
+  if (i < MAX_CHECKPOINT_FILES && scri_checkpoint_files[i].wbuf != NULL) {
+    if (scri_wbuf_flush(i) != 0) { return -1; }
+  }
+
+  return (*scri_real_read)(fd, buf, count);
+}
+
+#ifdef lseek
+#undef lseek
+#endif
+off_t lseek(int fd, off_t offset, int whence)
+{
+  if (!scri_initialized) { scr_interpose_init(); }
+
+  /* a seek moves the file offset, so staged bytes must land first,
+   * this also keeps SEEK_CUR and SEEK_END answers honest */
+  int i = scri_index_by_fd(fd);
+  if (i < MAX_CHECKPOINT_FILES && scri_checkpoint_files[i].wbuf != NULL) {
+    if (scri_wbuf_flush(i) != 0) { return (off_t) -1; }
+  }
+
+  return (*scri_real_lseek)(fd, offset, whence);
+}
+
+#ifdef fsync
+#undef fsync
+#endif
+int fsync(int fd)
+{
+  if (!scri_initialized) { scr_interpose_init(); }
+
+  /* staged bytes must reach the file before it can be synced */
+  int i = scri_index_by_fd(fd);
+  if (i < MAX_CHECKPOINT_FILES && scri_checkpoint_files[i].wbuf != NULL) {
+    if (scri_wbuf_flush(i) != 0) { return -1; }
+  }
+
+  return (*scri_real_fsync)(fd);
+}
+
 /*
 ==============================================================================
 Interpose mkdir functions
@@ -41,12 +41,15 @@
 #include "scr_err.h"
 #include "scr_io.h"
 #include "scr_util.h"
+#include "scr_crc.h"
+#include "scr_stats.h"
 
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <fcntl.h>
 #include <string.h>
 #include <strings.h>
@@ -69,6 +72,14 @@
 /* gettimeofday */
 #include <sys/time.h>
 
+/* mmap */
+#include <sys/mman.h>
+
+/* use liburing to batch file copies if available */
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
 /*  use libcppr to copy files if available */
 #ifdef HAVE_LIBCPPR
 #include "cppr.h"
@@ -180,6 +191,95 @@ int scr_close(const char* file, int fd)
   return SCR_SUCCESS;
 }
 
+/* close file without an fsync, for files on memory-backed stores
+ * where there is no device to sync to */
+int scr_close_nofsync(const char* file, int fd)
+{
+  if (close(fd) != 0) {
+    /* hit an error, print message */
+    scr_err("Closing file descriptor %d for file %s: errno=%d %s @ %s:%d",
+      fd, file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* close file, syncing it according to the given SCR_SYNC_* policy */
+int scr_close_policy(const char* file, int fd, int policy)
+{
+  switch (policy) {
+  case SCR_SYNC_NONE:
+  case SCR_SYNC_DATASET:
+    /* nothing to sync at close, the DATASET policy defers to a
+     * file system sync once the full dataset has been written */
+    break;
+  case SCR_SYNC_FDATASYNC:
+    /* sync file data but skip metadata like timestamps */
+    if (fdatasync(fd) < 0) {
+      scr_dbg(2, "Failed to fdatasync file descriptor: %s errno=%d %s @ %s:%d",
+        file, errno, strerror(errno), __FILE__, __LINE__
+      );
+    }
+    break;
+  case SCR_SYNC_RANGE:
+    /* kick off writeback for the file without waiting for it,
+     * the dataset-level sync picks up whatever is still dirty */
+#ifdef HAVE_SYNC_FILE_RANGE
+    if (sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE) < 0) {
+      scr_dbg(2, "Failed to sync_file_range file descriptor: %s errno=%d %s @ %s:%d",
+        file, errno, strerror(errno), __FILE__, __LINE__
+      );
+    }
+    break;
+#endif
+    /* fall through to a full fsync when sync_file_range is missing */
+  case SCR_SYNC_FSYNC:
+  default:
+    if (fsync(fd) < 0) {
+      scr_dbg(2, "Failed to fsync file descriptor: %s errno=%d %s @ %s:%d",
+        file, errno, strerror(errno), __FILE__, __LINE__
+      );
+    }
+    break;
+  }
+
+  return scr_close_nofsync(file, fd);
+}
+
+/* sync the file system holding the given path, used by the
+ * dataset-level sync policies */
+int scr_sync_fs(const char* path)
+{
+#ifdef HAVE_SYNCFS
+  /* open the path to get a descriptor on its file system */
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    scr_err("Opening path to sync file system: open(%s) errno=%d %s @ %s:%d",
+      path, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* flush everything dirty on that file system */
+  int rc = SCR_SUCCESS;
+  if (syncfs(fd) < 0) {
+    scr_err("Failed to syncfs path: %s errno=%d %s @ %s:%d",
+      path, errno, strerror(errno), __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+
+  scr_close_nofsync(path, fd);
+  return rc;
+#else
+  /* no syncfs, fall back to syncing all file systems */
+  sync();
+  return SCR_SUCCESS;
+#endif
+}
+
 int scr_file_lock_read(const char* file, int fd)
 {
   #ifdef SCR_FILE_LOCK_USE_FLOCK
@@ -279,8 +379,15 @@ int scr_open_with_lock(const char* file, int flags, mode_t mode)
     return fd;
   }
 
-  /* acquire an exclusive file lock */
+  /* acquire an exclusive file lock,
+   * recording how long we wait on it */
+  struct timeval lock_start, lock_end;
+  gettimeofday(&lock_start, NULL);
   int ret = scr_file_lock_write(file, fd);
+  gettimeofday(&lock_end, NULL);
+  double lock_secs = (double) (lock_end.tv_sec - lock_start.tv_sec) +
+    (double) (lock_end.tv_usec - lock_start.tv_usec) / 1000000.0;
+  scr_stats_sample(SCR_STATS_PHASE_LOCK, lock_secs);
   if (ret != SCR_SUCCESS) {
     close(fd);
     return ret;
@@ -547,6 +654,59 @@ ssize_t scr_writef(const char* file, int fd, const char* format, ...)
   return rc;
 }
 
+/* service one segment of scr_read_pad_n by memory-mapping the file
+ * region and copying it straight into the caller's buffer, which skips
+ * the seek/read path through the file descriptor, returns SCR_FAILURE
+ * quietly if the region can't be mapped so the caller can fall back */
+static int scr_read_pad_mmap(
+  const char* file,
+  int fd,
+  char* buf,
+  size_t size,
+  off_t offset)
+{
+  /* nothing to do for an empty segment */
+  if (size == 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* mmap requires a page-aligned file offset */
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (page_size <= 0) {
+    return SCR_FAILURE;
+  }
+  off_t aligned = offset - (offset % (off_t) page_size);
+  size_t maplen = size + (size_t)(offset - aligned);
+
+  /* mmap succeeds even if the file is shorter than the requested
+   * region, but touching pages past EOF raises SIGBUS, and truncated
+   * files are expected input on the rebuild path, so check the file
+   * size and fall back to the read path if the region extends past
+   * the end of the file */
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return SCR_FAILURE;
+  }
+  if (st.st_size < aligned + (off_t) maplen) {
+    return SCR_FAILURE;
+  }
+
+  /* map the region read-only */
+  void* ptr = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, fd, aligned);
+  if (ptr == MAP_FAILED) {
+    return SCR_FAILURE;
+  }
+
+  /* we walk the mapping front to back exactly once */
+  madvise(ptr, maplen, MADV_SEQUENTIAL);
+
+  /* copy the segment into the caller's buffer and drop the mapping */
+  memcpy(buf, (char*) ptr + (offset - aligned), size);
+  munmap(ptr, maplen);
+
+  return SCR_SUCCESS;
+}
+
 /* logically concatenate n opened files and read count bytes from this logical file into buf starting
  * from offset, pad with zero on end if missing data */
 int scr_read_pad_n(int n, char** files, int* fds,
@@ -563,17 +723,10 @@ int scr_read_pad_n(int n, char** files, int* fds,
     i++;
   }
 
-  /* seek to the proper position in the current file */
+  /* compute position of our offset within the current file */
   if (i < n) {
       pos = offset - nseek;
       nseek += pos;
-      if (lseek(fds[i], pos, SEEK_SET) == (off_t)-1) {
-        /* our seek failed, return an error */
-        scr_err("Failed to seek to byte %lu in %s @ %s:%d",
-          pos, files[i], __FILE__, __LINE__
-        );
-        return SCR_FAILURE;
-      }
   }
 
   /* read data from files */
@@ -586,17 +739,10 @@ int scr_read_pad_n(int n, char** files, int* fds,
       num_to_read = count - nread;
     }
 
-    /* read data from file and add to the total read count */
-    if (scr_read_attempt(files[i], fds[i], buf + nread, num_to_read) != num_to_read) {
-      /* our read failed, return an error */
-      return SCR_FAILURE;
-    }
-    nread += num_to_read;
-
-    /* advance to next file and seek to byte 0 */
-    i++;
-    if (i < n) {
-      pos = 0;
+    /* prefer to map the file region and copy it directly, fall back
+     * to seeking and reading through the descriptor if that fails */
+    if (scr_read_pad_mmap(files[i], fds[i], buf + nread, num_to_read, pos) != SCR_SUCCESS) {
+      /* seek to the proper position in the current file */
       if (lseek(fds[i], pos, SEEK_SET) == (off_t)-1) {
         /* our seek failed, return an error */
         scr_err("Failed to seek to byte %lu in %s @ %s:%d",
@@ -604,7 +750,18 @@ int scr_read_pad_n(int n, char** files, int* fds,
         );
         return SCR_FAILURE;
       }
+
+      /* read data from file and add to the total read count */
+      if (scr_read_attempt(files[i], fds[i], buf + nread, num_to_read) != num_to_read) {
+        /* our read failed, return an error */
+        return SCR_FAILURE;
+      }
     }
+    nread += num_to_read;
+
+    /* advance to next file and start from byte 0 */
+    i++;
+    pos = 0;
   }
 
   /* if count is bigger than all of our file data, pad with zeros on the end */
@@ -771,7 +928,7 @@ int scr_crc32(const char* filename, uLong* crc)
   }
 
   /* initialize our crc value */
-  *crc = crc32(0L, Z_NULL, 0);
+  *crc = scr_crc_init();
 
   /* open the file for reading */
   int fd = scr_open(filename, O_RDONLY);
@@ -789,7 +946,7 @@ int scr_crc32(const char* filename, uLong* crc)
   do {
     nread = scr_read(filename, fd, buf, buffer_size);
     if (nread > 0) {
-      *crc = crc32(*crc, (const Bytef*) buf, (uInt) nread);
+      *crc = scr_crc_update(*crc, buf, (size_t) nread);
     }
   } while (nread == buffer_size);
 
@@ -902,20 +1059,283 @@ int scr_getcwd(char* buf, size_t size)
   return rc;
 }
 
+/*
+=========================================
+Aligned buffer pool
+=========================================
+*/
+
+/* the copy and encode loops used to malloc and free a chunk buffer
+ * on every call, which churns the allocator once worker threads are
+ * in play and yields buffers that O_DIRECT rejects for alignment,
+ * the pool below hands out page-aligned buffers and recycles them,
+ * each thread caches the last buffer it returned so the common
+ * get/copy/put pattern skips the lock,
+ * buffers are also kept numa-local: fresh allocations fault their
+ * pages in from the calling thread so first-touch places them on the
+ * caller's node, each buffer remembers that node, and gets prefer a
+ * pooled buffer from the caller's own node, since cross-socket copy
+ * and encode traffic runs at roughly half the local bandwidth */
+
+#include <pthread.h>
+#include <sys/syscall.h>
+
+/* header page kept in front of the user region of each buffer,
+ * the user pointer stays page-aligned because the header occupies
+ * a full page */
+struct scr_buf_item {
+  size_t size;                /* usable bytes in the user region */
+  int node;                   /* numa node the buffer pages live on */
+  struct scr_buf_item* next;  /* next item in the free list */
+};
+
+/* return the numa node the calling thread is currently running on,
+ * returns 0 when the kernel can't tell us */
+static int scr_buf_current_node(void)
+{
+#ifdef SYS_getcpu
+  unsigned int cpu  = 0;
+  unsigned int node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+    return (int) node;
+  }
+#endif
+  return 0;
+}
+
+/* global free list of parked buffers */
+static pthread_mutex_t scr_buf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct scr_buf_item* scr_buf_free_head = NULL;
+static int scr_buf_free_count = 0;
+
+/* cap on buffers parked in the global free list,
+ * anything beyond this is freed on put */
+#define SCR_BUF_POOL_MAX (16)
+
+/* per-thread cache of one buffer, returned to the global
+ * list when the thread exits */
+static pthread_key_t scr_buf_key;
+static pthread_once_t scr_buf_once = PTHREAD_ONCE_INIT;
+
+/* page size used for buffer alignment, set on first get */
+static size_t scr_buf_pagesize = 0;
+
+/* release a buffer back to the global free list,
+ * frees it outright if the list is full */
+static void scr_buf_park(struct scr_buf_item* item)
+{
+  pthread_mutex_lock(&scr_buf_mutex);
+  if (scr_buf_free_count < SCR_BUF_POOL_MAX) {
+    item->next = scr_buf_free_head;
+    scr_buf_free_head = item;
+    scr_buf_free_count++;
+    item = NULL;
+  }
+  pthread_mutex_unlock(&scr_buf_mutex);
+
+  if (item != NULL) {
+    free(item);
+  }
+}
+
+/* thread exit hook for the per-thread cache */
+static void scr_buf_thread_exit(void* p)
+{
+  if (p != NULL) {
+    scr_buf_park((struct scr_buf_item*) p);
+  }
+}
+
+/* one-time setup of the per-thread cache key */
+static void scr_buf_init(void)
+{
+  scr_buf_pagesize = (size_t) sysconf(_SC_PAGESIZE);
+  pthread_key_create(&scr_buf_key, &scr_buf_thread_exit);
+}
+
+/* get a page-aligned buffer of at least size bytes from the pool,
+ * returns NULL if the allocation fails */
+void* scr_buf_get(size_t size)
+{
+  pthread_once(&scr_buf_once, &scr_buf_init);
+
+  /* node the caller is running on, pooled buffers from the same node
+   * are preferred to keep copy and encode traffic socket-local */
+  int node = scr_buf_current_node();
+
+  /* check the calling thread's cached buffer first */
+  struct scr_buf_item* item = (struct scr_buf_item*) pthread_getspecific(scr_buf_key);
+  if (item != NULL && item->size >= size && item->node == node) {
+    pthread_setspecific(scr_buf_key, NULL);
+    return (char*) item + scr_buf_pagesize;
+  }
+
+  /* look for a big enough buffer on the global free list,
+   * preferring one whose pages live on the caller's node,
+   * settling for a remote one over a fresh allocation */
+  pthread_mutex_lock(&scr_buf_mutex);
+  struct scr_buf_item** remote = NULL;
+  struct scr_buf_item** prev = &scr_buf_free_head;
+  for (item = scr_buf_free_head; item != NULL; item = item->next) {
+    if (item->size >= size) {
+      if (item->node == node) {
+        *prev = item->next;
+        scr_buf_free_count--;
+        break;
+      }
+      if (remote == NULL) {
+        remote = prev;
+      }
+    }
+    prev = &item->next;
+  }
+  if (item == NULL && remote != NULL) {
+    item = *remote;
+    *remote = item->next;
+    scr_buf_free_count--;
+  }
+  pthread_mutex_unlock(&scr_buf_mutex);
+  if (item != NULL) {
+    return (char*) item + scr_buf_pagesize;
+  }
+
+  /* nothing suitable pooled, allocate a fresh buffer with a page
+   * for the header so the user region stays page-aligned */
+  size_t user = size;
+  if (user % scr_buf_pagesize != 0) {
+    user += scr_buf_pagesize - user % scr_buf_pagesize;
+  }
+  void* block = NULL;
+  if (posix_memalign(&block, scr_buf_pagesize, scr_buf_pagesize + user) != 0) {
+    scr_err("Allocating aligned buffer: posix_memalign(%llu) errno=%d %s @ %s:%d",
+      (unsigned long long) (scr_buf_pagesize + user), errno, strerror(errno), __FILE__, __LINE__
+    );
+    return NULL;
+  }
+  item = (struct scr_buf_item*) block;
+  item->size = user;
+  item->node = node;
+  item->next = NULL;
+
+  /* fault every page in from this thread so the kernel's first-touch
+   * policy places the buffer on the caller's numa node, rather than
+   * on whichever node later happens to touch it first */
+  char* user_buf = (char*) item + scr_buf_pagesize;
+  size_t off;
+  for (off = 0; off < user; off += scr_buf_pagesize) {
+    user_buf[off] = 0;
+  }
+
+  return user_buf;
+}
+
+/* return a buffer obtained from scr_buf_get to the pool */
+void scr_buf_put(void* buf)
+{
+  if (buf == NULL) {
+    return;
+  }
+  struct scr_buf_item* item = (struct scr_buf_item*) ((char*) buf - scr_buf_pagesize);
+
+  /* stash in the per-thread slot if it's empty */
+  if (pthread_getspecific(scr_buf_key) == NULL) {
+    pthread_setspecific(scr_buf_key, item);
+    return;
+  }
+
+  scr_buf_park(item);
+}
+
+/* free all buffers held in the pool, called at finalize */
+void scr_buf_pool_free(void)
+{
+  /* return the calling thread's cached buffer first */
+  if (scr_buf_pagesize != 0) {
+    struct scr_buf_item* item = (struct scr_buf_item*) pthread_getspecific(scr_buf_key);
+    if (item != NULL) {
+      pthread_setspecific(scr_buf_key, NULL);
+      scr_buf_park(item);
+    }
+  }
+
+  pthread_mutex_lock(&scr_buf_mutex);
+  while (scr_buf_free_head != NULL) {
+    struct scr_buf_item* item = scr_buf_free_head;
+    scr_buf_free_head = item->next;
+    free(item);
+  }
+  scr_buf_free_count = 0;
+  pthread_mutex_unlock(&scr_buf_mutex);
+}
+
 /*
 =========================================
 File Copy Functions
 =========================================
 */
 
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#if defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_SYS_SENDFILE_H)
+/* copy file data entirely within the kernel via copy_file_range or
+ * sendfile, which avoids staging every byte through a user space
+ * buffer, returns SCR_FAILURE without printing an error if the kernel
+ * or file systems don't support it, in which case the caller falls
+ * back to the read/write loop */
+static int scr_file_copy_inkernel(
+  const char* src_file,
+  int src_fd,
+  const char* dst_file,
+  int dst_fd)
+{
+  /* get number of bytes to copy */
+  struct stat stat_buf;
+  if (fstat(src_fd, &stat_buf) != 0) {
+    return SCR_FAILURE;
+  }
+  off_t remaining = stat_buf.st_size;
+
+  while (remaining > 0) {
+    /* move the next span of bytes, the kernel caps how much it will
+     * copy per call so we loop until the file is done */
+#ifdef HAVE_COPY_FILE_RANGE
+    ssize_t n = copy_file_range(src_fd, NULL, dst_fd, NULL, (size_t) remaining, 0);
+#else
+    ssize_t n = sendfile(dst_fd, src_fd, NULL, (size_t) remaining);
+#endif
+    if (n > 0) {
+      remaining -= (off_t) n;
+    } else if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    } else {
+      /* either the file systems don't support an in-kernel copy or we
+       * hit a real error mid-stream, rewind both files so the caller
+       * can redo the copy with the buffered loop */
+      lseek(src_fd, 0, SEEK_SET);
+      lseek(dst_fd, 0, SEEK_SET);
+      ftruncate(dst_fd, 0);
+      scr_dbg(2, "In-kernel copy not used for %s to %s: errno=%d %s @ %s:%d",
+        src_file, dst_file, errno, strerror(errno), __FILE__, __LINE__
+      );
+      return SCR_FAILURE;
+    }
+  }
+
+  return SCR_SUCCESS;
+}
+#endif /* HAVE_COPY_FILE_RANGE || HAVE_SYS_SENDFILE_H */
+
 /* TODO: could perhaps use O_DIRECT here as an optimization */
 /* TODO: could apply compression/decompression here */
 /* copy src_file (full path) to dest_path and return new full path in dest_file */
-int scr_file_copy(
+int scr_file_copy_opts(
   const char* src_file,
   const char* dst_file,
   unsigned long buf_size,
-  uLong* crc)
+  uLong* crc,
+  int direct)
 {
   /* check that we got something for a source file */
   if (src_file == NULL || strcmp(src_file, "") == 0) {
@@ -961,9 +1381,32 @@ cppr cppr_err=%d @ %s:%d", cppr_retval, __FILE__, __LINE__
     return SCR_FAILURE;
   }
 
-  /* open dest_file for writing */
+  /* O_DIRECT requires page-aligned buffers and write sizes */
+  unsigned long pagesize = (unsigned long) sysconf(_SC_PAGESIZE);
+#ifndef O_DIRECT
+  direct = 0;
+#endif
+  if (direct && buf_size % pagesize != 0) {
+    buf_size += pagesize - buf_size % pagesize;
+  }
+
+  /* open dest_file for writing, keep checkpoint traffic out of the
+   * page cache when the caller asked for direct writes, fall back to
+   * buffered I/O where the file system refuses O_DIRECT */
   mode_t mode_file = scr_getmode(1, 1, 0);
-  int dst_fd = scr_open(dst_file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  int dst_fd = -1;
+#ifdef O_DIRECT
+  if (direct) {
+    dst_fd = scr_open(dst_file, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, mode_file);
+    if (dst_fd < 0) {
+      scr_dbg(2, "Direct write not supported for %s, falling back to buffered I/O", dst_file);
+      direct = 0;
+    }
+  }
+#endif
+  if (dst_fd < 0) {
+    dst_fd = scr_open(dst_file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  }
   if (dst_fd < 0) {
     scr_err("Opening file for writing: scr_open(%s) errno=%d %s @ %s:%d",
       dst_file, errno, strerror(errno), __FILE__, __LINE__
@@ -982,24 +1425,35 @@ cppr cppr_err=%d @ %s:%d", cppr_retval, __FILE__, __LINE__
   posix_fadvise(dst_fd, 0, 0, POSIX_FADV_DONTNEED | POSIX_FADV_SEQUENTIAL);
 #endif
 
-  /* allocate buffer to read in file chunks */
-  char* buf = (char*) malloc(buf_size);
-  if (buf == NULL) {
-    scr_err("Allocating memory: malloc(%llu) errno=%d %s @ %s:%d",
-      buf_size, errno, strerror(errno), __FILE__, __LINE__
-    );
-    scr_close(dst_file, dst_fd);
-    scr_close(src_file, src_fd);
-    return SCR_FAILURE;
+  /* when no CRC is requested, try to copy the bytes entirely within
+   * the kernel rather than staging each chunk through user space */
+  int copied = 0;
+#if defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_SYS_SENDFILE_H)
+  if (crc == NULL && ! direct &&
+      scr_file_copy_inkernel(src_file, src_fd, dst_file, dst_fd) == SCR_SUCCESS)
+  {
+    copied = 1;
+  }
+#endif
+
+  /* grab buffer from the pool to read in file chunks */
+  char* buf = NULL;
+  if (! copied) {
+    buf = (char*) scr_buf_get(buf_size);
+    if (buf == NULL) {
+      scr_close(dst_file, dst_fd);
+      scr_close(src_file, src_fd);
+      return SCR_FAILURE;
+    }
   }
 
   /* initialize crc values */
   if (crc != NULL) {
-    *crc = crc32(0L, Z_NULL, 0);
+    *crc = scr_crc_init();
   }
 
   /* write chunks */
-  int copying = 1;
+  int copying = !copied;
   while (copying) {
     /* attempt to read buf_size bytes from file */
     int nread = scr_read_attempt(src_file, src_fd, buf, buf_size);
@@ -1008,9 +1462,22 @@ cppr cppr_err=%d @ %s:%d", cppr_retval, __FILE__, __LINE__
     if (nread > 0) {
       /* optionally compute crc value as we go */
       if (crc != NULL) {
-        *crc = crc32(*crc, (const Bytef*) buf, (uInt) nread);
+        *crc = scr_crc_update(*crc, buf, (size_t) nread);
       }
 
+#ifdef O_DIRECT
+      /* a short read marks the tail of the file, whose length is
+       * usually not a multiple of the page size, so drop O_DIRECT
+       * before writing it */
+      if (direct && (unsigned long) nread % pagesize != 0) {
+        int flags = fcntl(dst_fd, F_GETFL);
+        if (flags >= 0) {
+          fcntl(dst_fd, F_SETFL, flags & ~O_DIRECT);
+        }
+        direct = 0;
+      }
+#endif
+
       /* write our nread bytes out */
       int nwrite = scr_write_attempt(dst_file, dst_fd, buf, nread);
 
@@ -1035,8 +1502,8 @@ cppr cppr_err=%d @ %s:%d", cppr_retval, __FILE__, __LINE__
     }
   }
 
-  /* free buffer */
-  scr_free(&buf);
+  /* return buffer to the pool */
+  scr_buf_put(buf);
 
   /* close source and destination files */
   if (scr_close(dst_file, dst_fd) != SCR_SUCCESS) {
@@ -1061,6 +1528,641 @@ cppr cppr_err=%d @ %s:%d", cppr_retval, __FILE__, __LINE__
   return rc;
 }
 
+/* copy src_file to dst_file with buffered writes */
+int scr_file_copy(
+  const char* src_file,
+  const char* dst_file,
+  unsigned long buf_size,
+  uLong* crc)
+{
+  return scr_file_copy_opts(src_file, dst_file, buf_size, crc, 0);
+}
+
+#ifdef HAVE_LIBURING
+/* states for a file moving through the io_uring copy engine */
+#define SCR_URING_STATE_READ  (1)
+#define SCR_URING_STATE_WRITE (2)
+
+/* tracks progress of one file being copied by the io_uring engine */
+struct scr_uring_copy {
+  const char* src_file;   /* path of source file */
+  const char* dst_file;   /* path of destination file */
+  int src_fd;             /* opened source descriptor */
+  int dst_fd;             /* opened destination descriptor */
+  char* buf;              /* chunk buffer of buf_size bytes */
+  off_t offset;           /* file offset of chunk currently in buffer */
+  size_t chunk;           /* number of bytes read into buffer */
+  size_t written;         /* bytes of current chunk written out so far */
+  int state;              /* whether a read or write is in flight */
+  int rc;                 /* records whether this copy hit an error */
+};
+
+/* queue a read of the next chunk for the given file */
+static int scr_uring_submit_read(
+  struct io_uring* ring,
+  struct scr_uring_copy* f,
+  int idx,
+  unsigned long buf_size)
+{
+  struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+  if (sqe == NULL) {
+    /* should not happen since we size the ring for our batch depth */
+    scr_err("Failed to get submission entry to read %s @ %s:%d",
+      f->src_file, __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+  io_uring_prep_read(sqe, f->src_fd, f->buf, buf_size, f->offset);
+  io_uring_sqe_set_data(sqe, (void*)(uintptr_t)idx);
+  f->state = SCR_URING_STATE_READ;
+  return SCR_SUCCESS;
+}
+
+/* queue a write of the unwritten portion of the current chunk */
+static int scr_uring_submit_write(
+  struct io_uring* ring,
+  struct scr_uring_copy* f,
+  int idx)
+{
+  struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+  if (sqe == NULL) {
+    scr_err("Failed to get submission entry to write %s @ %s:%d",
+      f->dst_file, __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+  io_uring_prep_write(sqe, f->dst_fd,
+    f->buf + f->written, f->chunk - f->written, f->offset + f->written
+  );
+  io_uring_sqe_set_data(sqe, (void*)(uintptr_t)idx);
+  f->state = SCR_URING_STATE_WRITE;
+  return SCR_SUCCESS;
+}
+
+/* open source and destination files and queue the first read,
+ * marks the file failed and returns SCR_FAILURE if we can't open either one */
+static int scr_uring_start_file(
+  struct io_uring* ring,
+  struct scr_uring_copy* f,
+  int idx,
+  unsigned long buf_size)
+{
+  /* open source file for reading */
+  f->src_fd = scr_open(f->src_file, O_RDONLY);
+  if (f->src_fd < 0) {
+    scr_err("Opening file to copy: scr_open(%s) errno=%d %s @ %s:%d",
+      f->src_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* open destination file for writing */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  f->dst_fd = scr_open(f->dst_file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (f->dst_fd < 0) {
+    scr_err("Opening file for writing: scr_open(%s) errno=%d %s @ %s:%d",
+      f->dst_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    close(f->src_fd);
+    f->src_fd = -1;
+    return SCR_FAILURE;
+  }
+
+  /* grab buffer from the pool to move data in chunks */
+  f->buf = (char*) scr_buf_get(buf_size);
+  if (f->buf == NULL) {
+    close(f->dst_fd);
+    close(f->src_fd);
+    f->src_fd = -1;
+    f->dst_fd = -1;
+    return SCR_FAILURE;
+  }
+
+#if !defined(__APPLE__)
+  /* we stream through the file once, don't pollute the page cache */
+  posix_fadvise(f->src_fd, 0, 0, POSIX_FADV_DONTNEED | POSIX_FADV_SEQUENTIAL);
+  posix_fadvise(f->dst_fd, 0, 0, POSIX_FADV_DONTNEED | POSIX_FADV_SEQUENTIAL);
+#endif
+
+  /* kick off the first read */
+  f->offset  = 0;
+  f->chunk   = 0;
+  f->written = 0;
+  f->rc      = SCR_SUCCESS;
+  return scr_uring_submit_read(ring, f, idx, buf_size);
+}
+
+/* close out a file when its copy finishes or fails,
+ * deletes the destination file if the copy failed */
+static void scr_uring_finish_file(struct scr_uring_copy* f)
+{
+  scr_buf_put(f->buf);
+  f->buf = NULL;
+  if (f->dst_fd >= 0) {
+    if (scr_close(f->dst_file, f->dst_fd) != SCR_SUCCESS) {
+      f->rc = SCR_FAILURE;
+    }
+    f->dst_fd = -1;
+  }
+  if (f->src_fd >= 0) {
+    if (scr_close(f->src_file, f->src_fd) != SCR_SUCCESS) {
+      f->rc = SCR_FAILURE;
+    }
+    f->src_fd = -1;
+  }
+
+  /* unlink the file if the copy failed */
+  if (f->rc != SCR_SUCCESS) {
+    unlink(f->dst_file);
+  }
+}
+
+/* copy a list of files keeping up to SCR_COPY_BATCH_DEPTH transfers in
+ * flight through io_uring, returns SCR_SUCCESS only if every file copies,
+ * sets *engine_ok = 0 if the ring can't be created so the caller can fall
+ * back to the serial copy loop */
+static int scr_file_copy_uring(
+  int numfiles,
+  const char** src_files,
+  const char** dst_files,
+  unsigned long buf_size,
+  int* engine_ok)
+{
+  int rc = SCR_SUCCESS;
+  *engine_ok = 1;
+
+  /* create the ring, size it so every active file can have
+   * an operation queued at once */
+  struct io_uring ring;
+  if (io_uring_queue_init(2 * SCR_COPY_BATCH_DEPTH, &ring, 0) < 0) {
+    /* no io_uring support on this kernel, tell caller to fall back */
+    *engine_ok = 0;
+    return SCR_FAILURE;
+  }
+
+  /* allocate state for each file in the batch */
+  struct scr_uring_copy* files = (struct scr_uring_copy*) calloc(numfiles, sizeof(struct scr_uring_copy));
+  if (files == NULL) {
+    scr_err("Allocating memory: calloc(%d, %lu) errno=%d %s @ %s:%d",
+      numfiles, sizeof(struct scr_uring_copy), errno, strerror(errno), __FILE__, __LINE__
+    );
+    io_uring_queue_exit(&ring);
+    *engine_ok = 0;
+    return SCR_FAILURE;
+  }
+
+  int next   = 0; /* index of next file to start */
+  int active = 0; /* number of files with an operation in flight */
+  while (next < numfiles || active > 0) {
+    /* start new files to keep the pipeline full */
+    while (next < numfiles && active < SCR_COPY_BATCH_DEPTH) {
+      struct scr_uring_copy* f = &files[next];
+      f->src_file = src_files[next];
+      f->dst_file = dst_files[next];
+      if (scr_uring_start_file(&ring, f, next, buf_size) == SCR_SUCCESS) {
+        active++;
+      } else {
+        /* couldn't get this file going, record failure and move on */
+        f->rc = SCR_FAILURE;
+        rc = SCR_FAILURE;
+      }
+      next++;
+    }
+
+    /* submit anything we've queued and wait for one completion */
+    io_uring_submit(&ring);
+    struct io_uring_cqe* cqe;
+    int wait_rc = io_uring_wait_cqe(&ring, &cqe);
+    if (wait_rc < 0) {
+      if (wait_rc == -EINTR) {
+        continue;
+      }
+      /* ring is broken, fail all active copies */
+      scr_err("Waiting on copy completion: io_uring_wait_cqe errno=%d %s @ %s:%d",
+        -wait_rc, strerror(-wait_rc), __FILE__, __LINE__
+      );
+      int i;
+      for (i = 0; i < next; i++) {
+        if (files[i].src_fd >= 0 || files[i].dst_fd >= 0) {
+          files[i].rc = SCR_FAILURE;
+          scr_uring_finish_file(&files[i]);
+        }
+      }
+      rc = SCR_FAILURE;
+      break;
+    }
+
+    /* pick apart the completion */
+    int idx = (int)(uintptr_t) io_uring_cqe_get_data(cqe);
+    int res = cqe->res;
+    io_uring_cqe_seen(&ring, cqe);
+    struct scr_uring_copy* f = &files[idx];
+
+    int finished = 0;
+    if (res == -EINTR || res == -EAGAIN) {
+      /* interrupted, resubmit the same operation */
+      int tmp_rc;
+      if (f->state == SCR_URING_STATE_READ) {
+        tmp_rc = scr_uring_submit_read(&ring, f, idx, buf_size);
+      } else {
+        tmp_rc = scr_uring_submit_write(&ring, f, idx);
+      }
+      if (tmp_rc != SCR_SUCCESS) {
+        f->rc = SCR_FAILURE;
+        finished = 1;
+      }
+    } else if (res < 0) {
+      /* hard error on this file, give up on it */
+      scr_err("Error copying %s to %s: errno=%d %s @ %s:%d",
+        f->src_file, f->dst_file, -res, strerror(-res), __FILE__, __LINE__
+      );
+      f->rc = SCR_FAILURE;
+      finished = 1;
+    } else if (f->state == SCR_URING_STATE_READ) {
+      if (res == 0) {
+        /* hit end of file, this copy is done */
+        finished = 1;
+      } else {
+        /* got a chunk, write it out */
+        f->chunk   = (size_t) res;
+        f->written = 0;
+        if (scr_uring_submit_write(&ring, f, idx) != SCR_SUCCESS) {
+          f->rc = SCR_FAILURE;
+          finished = 1;
+        }
+      }
+    } else { /* SCR_URING_STATE_WRITE */
+      if (res == 0) {
+        /* something bad happened, write made no progress */
+        scr_err("Error writing %s: write returned 0 @ %s:%d",
+          f->dst_file, __FILE__, __LINE__
+        );
+        f->rc = SCR_FAILURE;
+        finished = 1;
+      } else {
+        f->written += (size_t) res;
+        int tmp_rc;
+        if (f->written < f->chunk) {
+          /* short write, push out the rest of the chunk */
+          tmp_rc = scr_uring_submit_write(&ring, f, idx);
+        } else {
+          /* chunk is on disk, advance and read the next one */
+          f->offset += f->chunk;
+          tmp_rc = scr_uring_submit_read(&ring, f, idx, buf_size);
+        }
+        if (tmp_rc != SCR_SUCCESS) {
+          f->rc = SCR_FAILURE;
+          finished = 1;
+        }
+      }
+    }
+
+    /* close out the file if it completed or failed */
+    if (finished) {
+      scr_uring_finish_file(f);
+      if (f->rc != SCR_SUCCESS) {
+        rc = SCR_FAILURE;
+      }
+      active--;
+    }
+  }
+
+  io_uring_queue_exit(&ring);
+  scr_free(&files);
+  return rc;
+}
+#endif /* HAVE_LIBURING */
+
+/* copy a list of files, keeping multiple transfers in flight at once when
+ * the io_uring engine is available, otherwise copy the files one at a time,
+ * returns SCR_SUCCESS only if all files are copied successfully */
+int scr_file_copy_batch(
+  int numfiles,
+  const char** src_files,
+  const char** dst_files,
+  unsigned long buf_size)
+{
+  if (numfiles <= 0) {
+    return SCR_SUCCESS;
+  }
+
+#ifdef HAVE_LIBURING
+  int engine_ok;
+  int rc = scr_file_copy_uring(numfiles, src_files, dst_files, buf_size, &engine_ok);
+  if (engine_ok) {
+    return rc;
+  }
+  /* kernel has no io_uring support, fall through to the serial loop */
+#endif
+
+  /* fall back to copying the files one at a time */
+  int i;
+  int ret = SCR_SUCCESS;
+  for (i = 0; i < numfiles; i++) {
+    if (scr_file_copy(src_files[i], dst_files[i], buf_size, NULL) != SCR_SUCCESS) {
+      ret = SCR_FAILURE;
+    }
+  }
+  return ret;
+}
+
+#ifdef HAVE_LIBURING
+/* copy the fields our callers consume from a statx result into a
+ * regular stat buffer */
+static void scr_statx_to_stat(const struct statx* stx, struct stat* st)
+{
+  memset(st, 0, sizeof(*st));
+  st->st_mode  = stx->stx_mode;
+  st->st_nlink = stx->stx_nlink;
+  st->st_uid   = stx->stx_uid;
+  st->st_gid   = stx->stx_gid;
+  st->st_size  = (off_t) stx->stx_size;
+  st->st_atim.tv_sec  = stx->stx_atime.tv_sec;
+  st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+  st->st_mtim.tv_sec  = stx->stx_mtime.tv_sec;
+  st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+  st->st_ctim.tv_sec  = stx->stx_ctime.tv_sec;
+  st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+
+/* query a list of files keeping up to SCR_STAT_BATCH_DEPTH statx
+ * requests in flight through io_uring, sets *engine_ok = 0 if the
+ * ring can't be created so the caller can fall back to one stat
+ * per file */
+static int scr_file_stat_batch_uring(
+  int numfiles,
+  const char** files,
+  struct stat* statbufs,
+  int* rcs,
+  int* engine_ok)
+{
+  *engine_ok = 1;
+
+  /* create the ring, size it so a full window of requests
+   * can be queued at once */
+  struct io_uring ring;
+  if (io_uring_queue_init(SCR_STAT_BATCH_DEPTH, &ring, 0) < 0) {
+    /* no io_uring support on this kernel, tell caller to fall back */
+    *engine_ok = 0;
+    return SCR_FAILURE;
+  }
+
+  /* allocate statx results for each file in the batch */
+  struct statx* stx = (struct statx*) calloc(numfiles, sizeof(struct statx));
+  if (stx == NULL) {
+    scr_err("Allocating memory: calloc(%d, %lu) errno=%d %s @ %s:%d",
+      numfiles, sizeof(struct statx), errno, strerror(errno), __FILE__, __LINE__
+    );
+    io_uring_queue_exit(&ring);
+    *engine_ok = 0;
+    return SCR_FAILURE;
+  }
+
+  int rc = SCR_SUCCESS;
+  int next   = 0; /* index of next file to query */
+  int done   = 0; /* number of files with a result */
+  int active = 0; /* number of requests in flight */
+  while (done < numfiles) {
+    /* queue new requests to keep the window full */
+    while (next < numfiles && active < SCR_STAT_BATCH_DEPTH) {
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+      if (sqe == NULL) {
+        break;
+      }
+      io_uring_prep_statx(sqe, AT_FDCWD, files[next], 0, STATX_BASIC_STATS, &stx[next]);
+      io_uring_sqe_set_data(sqe, (void*)(uintptr_t) next);
+      next++;
+      active++;
+    }
+
+    /* submit anything we've queued and wait for one completion */
+    io_uring_submit(&ring);
+    struct io_uring_cqe* cqe;
+    int wait_rc = io_uring_wait_cqe(&ring, &cqe);
+    if (wait_rc < 0) {
+      if (wait_rc == -EINTR) {
+        continue;
+      }
+      /* ring is broken, let the caller redo the batch serially */
+      scr_err("Waiting on statx completion: io_uring_wait_cqe errno=%d %s @ %s:%d",
+        -wait_rc, strerror(-wait_rc), __FILE__, __LINE__
+      );
+      io_uring_queue_exit(&ring);
+      scr_free(&stx);
+      *engine_ok = 0;
+      return SCR_FAILURE;
+    }
+
+    /* pick apart the completion */
+    int idx = (int)(uintptr_t) io_uring_cqe_get_data(cqe);
+    int res = cqe->res;
+    io_uring_cqe_seen(&ring, cqe);
+
+    if (res == -EINTR || res == -EAGAIN) {
+      /* interrupted, resubmit the same request */
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+      if (sqe != NULL) {
+        io_uring_prep_statx(sqe, AT_FDCWD, files[idx], 0, STATX_BASIC_STATS, &stx[idx]);
+        io_uring_sqe_set_data(sqe, (void*)(uintptr_t) idx);
+        continue;
+      }
+      /* couldn't requeue, count the file as failed */
+      rc = SCR_FAILURE;
+    } else if (res == 0) {
+      /* got attributes for this file */
+      scr_statx_to_stat(&stx[idx], &statbufs[idx]);
+      rcs[idx] = SCR_SUCCESS;
+    } else {
+      /* file is missing or unreadable, leave its rc as failure */
+      rc = SCR_FAILURE;
+    }
+    done++;
+    active--;
+  }
+
+  io_uring_queue_exit(&ring);
+  scr_free(&stx);
+  return rc;
+}
+#endif /* HAVE_LIBURING */
+
+/* stat a list of files in one batched pass, issues statx requests
+ * through io_uring when available so queries overlap on high-latency
+ * file systems, otherwise queries the files one at a time, rcs[i] is
+ * set to SCR_SUCCESS if statbufs[i] holds valid data for files[i],
+ * returns SCR_SUCCESS only if every file was queried successfully */
+int scr_file_stat_batch(
+  int numfiles,
+  const char** files,
+  struct stat* statbufs,
+  int* rcs)
+{
+  int i;
+  for (i = 0; i < numfiles; i++) {
+    rcs[i] = SCR_FAILURE;
+  }
+  if (numfiles <= 0) {
+    return SCR_SUCCESS;
+  }
+
+#ifdef HAVE_LIBURING
+  int engine_ok;
+  int rc = scr_file_stat_batch_uring(numfiles, files, statbufs, rcs, &engine_ok);
+  if (engine_ok) {
+    return rc;
+  }
+  /* kernel has no io_uring support, fall through to the serial loop */
+#endif
+
+  /* fall back to querying the files one at a time */
+  int ret = SCR_SUCCESS;
+  for (i = 0; i < numfiles; i++) {
+    if (stat(files[i], &statbufs[i]) == 0) {
+      rcs[i] = SCR_SUCCESS;
+    } else {
+      ret = SCR_FAILURE;
+    }
+  }
+  return ret;
+}
+
+/* copy src_file to dst_file, compressing the data with zlib,
+ * the destination holds a gzip stream that scr_file_decompress_zlib
+ * (or gunzip) can expand back to the original contents */
+int scr_file_compress_zlib(
+  const char* src_file,
+  const char* dst_file,
+  unsigned long buf_size)
+{
+  int rc = SCR_SUCCESS;
+
+  /* open source file for reading */
+  int fd_src = scr_open(src_file, O_RDONLY);
+  if (fd_src < 0) {
+    scr_err("Opening file to compress: scr_open(%s) errno=%d %s @ %s:%d",
+      src_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* open compressed stream on destination file */
+  gzFile gz = gzopen(dst_file, "wb");
+  if (gz == NULL) {
+    scr_err("Opening compressed file for writing: gzopen(%s) @ %s:%d",
+      dst_file, __FILE__, __LINE__
+    );
+    scr_close(src_file, fd_src);
+    return SCR_FAILURE;
+  }
+
+  /* grab buffer from the pool to chunk the copy */
+  char* buf = (char*) scr_buf_get(buf_size);
+  if (buf == NULL) {
+    gzclose(gz);
+    scr_close(src_file, fd_src);
+    return SCR_FAILURE;
+  }
+
+  /* read source data and feed it through the compressed stream */
+  ssize_t nread = scr_read_attempt(src_file, fd_src, buf, buf_size);
+  while (nread > 0) {
+    if (gzwrite(gz, buf, (unsigned int) nread) != (int) nread) {
+      scr_err("Error writing compressed file: gzwrite(%s) @ %s:%d",
+        dst_file, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+      break;
+    }
+    nread = scr_read_attempt(src_file, fd_src, buf, buf_size);
+  }
+  if (nread < 0) {
+    rc = SCR_FAILURE;
+  }
+
+  /* return the buffer and close the files */
+  scr_buf_put(buf);
+  if (gzclose(gz) != Z_OK) {
+    rc = SCR_FAILURE;
+  }
+  if (scr_close(src_file, fd_src) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  /* delete the destination file if the compression failed */
+  if (rc != SCR_SUCCESS) {
+    unlink(dst_file);
+  }
+
+  return rc;
+}
+
+/* copy src_file to dst_file, decompressing data written by scr_file_compress_zlib */
+int scr_file_decompress_zlib(
+  const char* src_file,
+  const char* dst_file,
+  unsigned long buf_size)
+{
+  int rc = SCR_SUCCESS;
+
+  /* open compressed stream on source file */
+  gzFile gz = gzopen(src_file, "rb");
+  if (gz == NULL) {
+    scr_err("Opening compressed file for reading: gzopen(%s) @ %s:%d",
+      src_file, __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* open destination file for writing */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd_dst = scr_open(dst_file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (fd_dst < 0) {
+    scr_err("Opening file to decompress to: scr_open(%s) errno=%d %s @ %s:%d",
+      dst_file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    gzclose(gz);
+    return SCR_FAILURE;
+  }
+
+  /* grab buffer from the pool to chunk the copy */
+  char* buf = (char*) scr_buf_get(buf_size);
+  if (buf == NULL) {
+    scr_close(dst_file, fd_dst);
+    gzclose(gz);
+    return SCR_FAILURE;
+  }
+
+  /* inflate the stream and write the original data to the destination */
+  int nread = gzread(gz, buf, (unsigned int) buf_size);
+  while (nread > 0) {
+    if (scr_write_attempt(dst_file, fd_dst, buf, nread) != nread) {
+      rc = SCR_FAILURE;
+      break;
+    }
+    nread = gzread(gz, buf, (unsigned int) buf_size);
+  }
+  if (nread < 0) {
+    scr_err("Error reading compressed file: gzread(%s) @ %s:%d",
+      src_file, __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+
+  /* return the buffer and close the files */
+  scr_buf_put(buf);
+  if (scr_close(dst_file, fd_dst) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+  gzclose(gz);
+
+  /* delete the destination file if the decompression failed */
+  if (rc != SCR_SUCCESS) {
+    unlink(dst_file);
+  }
+
+  return rc;
+}
+
 #ifdef HAVE_LIBCPPR
 cppr_return_t _scr_cppr_file_copy(
   const char* src_file,
@@ -15,6 +15,7 @@
 #include <config.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 
 /* compute crc32 */
 #include <zlib.h>
@@ -38,6 +39,38 @@ int scr_open(const char* file, int flags, ...);
 /* close file with an fsync */
 int scr_close(const char* file, int fd);
 
+/* close file without an fsync, for files on memory-backed stores
+ * where there is no device to sync to */
+int scr_close_nofsync(const char* file, int fd);
+
+/* sync policies applied when closing a file that was written,
+ * each store selects one via its SYNC parameter */
+#define SCR_SYNC_NONE      (0) /* skip the sync entirely */
+#define SCR_SYNC_FDATASYNC (1) /* sync file data but not file metadata */
+#define SCR_SYNC_FSYNC     (2) /* full fsync */
+#define SCR_SYNC_RANGE     (3) /* start writeback at close without waiting,
+                                * then sync the file system once per dataset */
+#define SCR_SYNC_DATASET   (4) /* no per-file sync,
+                                * sync the file system once per dataset */
+
+/* close file, syncing it according to the given SCR_SYNC_* policy */
+int scr_close_policy(const char* file, int fd, int policy);
+
+/* sync the file system holding the given path, used by the
+ * dataset-level sync policies */
+int scr_sync_fs(const char* path);
+
+/* get a page-aligned buffer of at least size bytes from the
+ * process-wide buffer pool, suitable for O_DIRECT, returns NULL if
+ * the allocation fails */
+void* scr_buf_get(size_t size);
+
+/* return a buffer obtained from scr_buf_get to the pool */
+void scr_buf_put(void* buf);
+
+/* free all buffers held in the pool, called at finalize */
+void scr_buf_pool_free(void);
+
 /* get and release file locks */
 int scr_file_lock_read(const char* file, int fd);
 int scr_file_lock_write(const char* file, int fd);
@@ -139,4 +172,53 @@ int scr_file_copy(
   uLong* crc
 );
 
+/* like scr_file_copy, but writes the destination with O_DIRECT when
+ * direct is set to keep the copy out of the page cache, buffers come
+ * from the aligned pool and the unaligned file tail is written after
+ * dropping O_DIRECT, falls back to buffered I/O where the file
+ * system refuses direct writes */
+int scr_file_copy_opts(
+  const char* src_file,
+  const char* dst_file,
+  unsigned long buf_size,
+  uLong* crc,
+  int direct
+);
+
+/* copy a list of files, keeping multiple transfers in flight at once when
+ * the io_uring engine is available, otherwise copy the files one at a time,
+ * returns SCR_SUCCESS only if all files are copied successfully */
+int scr_file_copy_batch(
+  int numfiles,
+  const char** src_files,
+  const char** dst_files,
+  unsigned long buf_size
+);
+
+/* stat a list of files in one batched pass, issues statx requests
+ * through io_uring when available so queries overlap on high-latency
+ * file systems, otherwise queries the files one at a time, rcs[i] is
+ * set to SCR_SUCCESS if statbufs[i] holds valid data for files[i],
+ * returns SCR_SUCCESS only if every file was queried successfully */
+int scr_file_stat_batch(
+  int numfiles,
+  const char** files,
+  struct stat* statbufs,
+  int* rcs
+);
+
+/* copy src_file to dst_file, compressing the data with zlib */
+int scr_file_compress_zlib(
+  const char* src_file,
+  const char* dst_file,
+  unsigned long buf_size
+);
+
+/* copy src_file to dst_file, decompressing data written by scr_file_compress_zlib */
+int scr_file_decompress_zlib(
+  const char* src_file,
+  const char* dst_file,
+  unsigned long buf_size
+);
+
 #endif
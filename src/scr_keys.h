@@ -44,6 +44,7 @@ Define common hash key strings
 #define SCR_KEY_PATH      ("PATH")
 #define SCR_KEY_SEGMENT   ("SEG")
 #define SCR_KEY_CONTAINER ("CTR")
+#define SCR_KEY_COMPRESS  ("COMPRESS")
 #define SCR_KEY_ID        ("ID")
 #define SCR_KEY_NAME      ("NAME")
 #define SCR_KEY_SIZE      ("SIZE")
@@ -171,6 +172,13 @@ Define common hash key strings
 #define SCR_CONFIG_KEY_GROUP_SIZE ("GROUP_SIZE")
 #define SCR_CONFIG_KEY_GROUP_RANK ("GROUP_RANK")
 #define SCR_CONFIG_KEY_MKDIR      ("MKDIR")
+#define SCR_CONFIG_KEY_THREADS    ("THREADS")
+#define SCR_CONFIG_KEY_BW         ("BW")
+#define SCR_CONFIG_KEY_MEMORY     ("MEMORY")
+#define SCR_CONFIG_KEY_SYNC       ("SYNC")
+#define SCR_CONFIG_KEY_DIRECT     ("DIRECT")
+#define SCR_CONFIG_KEY_FANOUT     ("FANOUT")
+#define SCR_CONFIG_KEY_PATHS      ("PATHS")
 #define SCR_CONFIG_KEY_TYPE       ("TYPE")
 #define SCR_CONFIG_KEY_VIEW       ("VIEW")
 
@@ -184,6 +192,7 @@ Define common hash key strings
 #define SCR_META_KEY_CRC      ("CRC")
 #define SCR_META_KEY_COMPLETE ("COMPLETE")
 #define SCR_META_KEY_MODE     ("MODE")
+#define SCR_META_KEY_PACK     ("PACK")
 #define SCR_META_KEY_UID      ("UID")
 #define SCR_META_KEY_GID      ("GID")
 #define SCR_META_KEY_ATIME_SECS  ("ATIME_SECS")
@@ -192,6 +201,16 @@ Define common hash key strings
 #define SCR_META_KEY_CTIME_NSECS ("CTIME_NSECS")
 #define SCR_META_KEY_MTIME_SECS  ("MTIME_SECS")
 #define SCR_META_KEY_MTIME_NSECS ("MTIME_NSECS")
+#define SCR_META_KEY_CHUNKSIZE   ("CHUNKSIZE")
+#define SCR_META_KEY_CHUNK       ("CHUNK")
+
+/* keys for the per-rank handoff files written to the control
+ * directory when SCR_FLUSH_HANDOFF is set, read by the standalone
+ * scr_flush_handoff helper to finish the transfer outside MPI */
+#define SCR_HANDOFF_KEY_DSET ("DSET")
+#define SCR_HANDOFF_KEY_NAME ("NAME")
+#define SCR_HANDOFF_KEY_FILE ("FILE")
+#define SCR_HANDOFF_KEY_DEST ("DEST")
 
 #define SCR_KEY_COPY_XOR_CHUNK   ("CHUNK")
 #define SCR_KEY_COPY_XOR_DATASET ("DSET")
@@ -60,6 +60,10 @@
 
 #include <syslog.h>
 
+/* background log flusher thread */
+#include <pthread.h>
+#include <unistd.h>
+
 #ifdef HAVE_LIBMYSQLCLIENT
 #include <mysql.h>
 #endif
@@ -83,6 +87,62 @@ static char* db_user = NULL; /* username to use to connect to DB server */
 static char* db_pass = NULL; /* password to use to connect to DB server */
 static char* db_name = NULL; /* database name to connect to */
 
+/* maximum string lengths captured in a deferred log entry */
+#define SCR_LOG_ENTRY_TYPE (64)
+#define SCR_LOG_ENTRY_NOTE (256)
+#define SCR_LOG_ENTRY_NAME (256)
+#define SCR_LOG_ENTRY_PATH (1024)
+
+/* entry kinds held in the ring buffer */
+#define SCR_LOG_ENTRY_EVENT    (1)
+#define SCR_LOG_ENTRY_TRANSFER (2)
+
+/* a log call captured for the flusher thread to emit later,
+ * all argument strings and values are copied in since the caller's
+ * pointers are not valid once the call returns */
+typedef struct scr_log_entry {
+  int kind;                          /* event or transfer */
+  char type[SCR_LOG_ENTRY_TYPE];     /* type string of event or transfer */
+  char note[SCR_LOG_ENTRY_NOTE];     /* note string for events */
+  char name[SCR_LOG_ENTRY_NAME];     /* dataset name */
+  char from[SCR_LOG_ENTRY_PATH];     /* source of transfer */
+  char to[SCR_LOG_ENTRY_PATH];       /* destination of transfer */
+  int has_note;                      /* flags recording which optional */
+  int has_name;                      /*   arguments were provided, */
+  int has_from;                      /*   since NULL pointers cannot */
+  int has_to;                        /*   be copied into the entry */
+  int has_dset;
+  int has_start;
+  int has_secs;
+  int has_bytes;
+  int has_files;
+  int dset;                          /* dataset id */
+  time_t start;                      /* start time of operation */
+  double secs;                       /* seconds the operation took */
+  double bytes;                      /* bytes moved by transfer */
+  int files;                         /* files moved by transfer */
+} scr_log_entry;
+
+/* single-producer single-consumer ring buffer of deferred log entries,
+ * the logging rank only moves the head and the flusher thread only
+ * moves the tail, so no lock is needed, a full memory barrier orders
+ * entry contents before the head is published, if the job aborts any
+ * entries still in the ring are lost, which bounds the loss at the
+ * ring size */
+static int async_enable = SCR_LOG_ASYNC_ENABLE; /* whether to emit log entries from a background thread */
+static scr_log_entry* async_ring = NULL;        /* ring buffer of deferred entries */
+static int async_ring_entries = SCR_LOG_ASYNC_ENTRIES; /* number of slots in the ring */
+static volatile int async_head = 0;             /* next slot to fill, written only by producer */
+static volatile int async_tail = 0;             /* next slot to drain, written only by flusher */
+static volatile int async_quit = 0;             /* tells flusher to exit once the ring is empty */
+static unsigned long async_dropped = 0;         /* entries dropped because the ring was full */
+static int async_running = 0;                   /* whether the flusher thread is running */
+static pthread_t async_thread;                  /* the flusher thread */
+
+/* serializes sink access (text file, syslog, mysql) between the
+ * flusher thread and the rare log calls that stay synchronous */
+static pthread_mutex_t scr_log_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /*
 =========================================
 MySQL functions
@@ -97,8 +157,20 @@ static unsigned long scr_db_jobid = 0; /* caches the jobid for the current job *
 
 #ifdef HAVE_LIBMYSQLCLIENT
 static kvtree* scr_db_types = NULL; /* caches type string to type id lookups */
+
+static MYSQL_STMT* scr_db_stmt_event = NULL; /* prepared insert statement for event records */
+static int scr_db_stmt_event_failed  = 0;    /* set if prepare failed, fall back to text queries */
+
+/* accumulates value tuples for a multi-row insert into the transfers
+ * table, so a batch of records costs one round trip to the server */
+static char*  scr_db_xfer_buf   = NULL; /* comma-separated value tuples */
+static size_t scr_db_xfer_size  = 0;    /* allocated size of buffer */
+static size_t scr_db_xfer_len   = 0;    /* used length of buffer */
+static int    scr_db_xfer_count = 0;    /* number of tuples in buffer */
 #endif
 
+static int db_batch = SCR_LOG_DB_BATCH; /* max transfer records to batch per insert */
+
 /* connects to the SCR log database */
 int scr_mysql_connect(
   const char* host,
@@ -119,6 +191,12 @@ int scr_mysql_connect(
   /* initialize our database structure */
   mysql_init(&scr_mysql);
 
+  /* ask the client library to transparently reconnect if the
+   * connection drops during a long idle stretch between checkpoints,
+   * char matches the size of both my_bool and bool across versions */
+  char reconnect = 1;
+  mysql_options(&scr_mysql, MYSQL_OPT_RECONNECT, &reconnect);
+
   /* connect to the database */
   if (! mysql_real_connect(&scr_mysql, host, user, pass, name, 0, NULL, 0)) {
     scr_err("Failed to connect to SCR log database %s on host %s for user %s @ %s:%d",
@@ -138,6 +216,18 @@ int scr_mysql_disconnect()
   /* free our type string to id cache */
   kvtree_delete(&scr_db_types);
 
+  /* release the prepared event statement */
+  if (scr_db_stmt_event != NULL) {
+    mysql_stmt_close(scr_db_stmt_event);
+    scr_db_stmt_event = NULL;
+  }
+
+  /* free the transfer batch buffer */
+  scr_free(&scr_db_xfer_buf);
+  scr_db_xfer_size  = 0;
+  scr_db_xfer_len   = 0;
+  scr_db_xfer_count = 0;
+
   mysql_close(&scr_mysql);
 #endif
   return SCR_SUCCESS;
@@ -424,6 +514,130 @@ int scr_mysql_type_id(const char* type, int* id)
   return SCR_SUCCESS;
 }
 
+#ifdef HAVE_LIBMYSQLCLIENT
+/* prepare the insert statement for event records the first time it is
+ * needed, returns SCR_SUCCESS once the statement is ready for use,
+ * remembers a failed prepare so we fall back to text queries */
+static int scr_mysql_prepare_event(void)
+{
+  if (scr_db_stmt_event != NULL) {
+    return SCR_SUCCESS;
+  }
+  if (scr_db_stmt_event_failed) {
+    return SCR_FAILURE;
+  }
+
+  const char* sql =
+    "INSERT"
+    " INTO `events`"
+    " (`id`,`job_id`,`type_id`,`dset_id`,`dset_name`,`start`,`secs`,`note`)"
+    " VALUES"
+    " (NULL, ?, ?, ?, ?, ?, ?, ?)";
+
+  scr_db_stmt_event = mysql_stmt_init(&scr_mysql);
+  if (scr_db_stmt_event == NULL ||
+      mysql_stmt_prepare(scr_db_stmt_event, sql, strlen(sql)) != 0)
+  {
+    scr_err("Failed to prepare event insert, falling back to text queries, error = (%s) @ %s:%d",
+            mysql_error(&scr_mysql), __FILE__, __LINE__
+    );
+    if (scr_db_stmt_event != NULL) {
+      mysql_stmt_close(scr_db_stmt_event);
+      scr_db_stmt_event = NULL;
+    }
+    scr_db_stmt_event_failed = 1;
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* insert an event record through the prepared statement,
+ * returns SCR_FAILURE if the statement is unavailable or the insert
+ * fails, in which case the caller falls back to a text query */
+static int scr_mysql_log_event_stmt(
+  int type_id,
+  const char* note,
+  const int* dset,
+  const char* name,
+  const time_t* start,
+  const double* secs)
+{
+  if (scr_mysql_prepare_event() != SCR_SUCCESS) {
+    return SCR_FAILURE;
+  }
+
+  /* convert start time to a datetime string for the server */
+  char startbuf[30];
+  unsigned long start_len = 0;
+  if (start != NULL) {
+    strftime(startbuf, sizeof(startbuf), "%Y-%m-%d %H:%M:%S", localtime(start));
+    start_len = strlen(startbuf);
+  }
+
+  /* the bind structures need addressable copies of each value */
+  unsigned long long job_id = (unsigned long long) scr_db_jobid;
+  int    dset_val = (dset != NULL) ? *dset : 0;
+  double secs_val = (secs != NULL) ? *secs : 0.0;
+  unsigned long name_len = (name != NULL) ? strlen(name) : 0;
+  unsigned long note_len = (note != NULL) ? strlen(note) : 0;
+
+  /* null flags, char matches the size of both my_bool and bool */
+  char null_dset  = (dset  == NULL);
+  char null_name  = (name  == NULL);
+  char null_start = (start == NULL);
+  char null_secs  = (secs  == NULL);
+  char null_note  = (note  == NULL);
+
+  MYSQL_BIND bind[7];
+  memset(bind, 0, sizeof(bind));
+
+  bind[0].buffer_type = MYSQL_TYPE_LONGLONG;
+  bind[0].buffer      = &job_id;
+  bind[0].is_unsigned = 1;
+
+  bind[1].buffer_type = MYSQL_TYPE_LONG;
+  bind[1].buffer      = &type_id;
+
+  bind[2].buffer_type = MYSQL_TYPE_LONG;
+  bind[2].buffer      = &dset_val;
+  bind[2].is_null     = (void*) &null_dset;
+
+  bind[3].buffer_type   = MYSQL_TYPE_STRING;
+  bind[3].buffer        = (void*) name;
+  bind[3].buffer_length = name_len;
+  bind[3].length        = &name_len;
+  bind[3].is_null       = (void*) &null_name;
+
+  bind[4].buffer_type   = MYSQL_TYPE_STRING;
+  bind[4].buffer        = startbuf;
+  bind[4].buffer_length = start_len;
+  bind[4].length        = &start_len;
+  bind[4].is_null       = (void*) &null_start;
+
+  bind[5].buffer_type = MYSQL_TYPE_DOUBLE;
+  bind[5].buffer      = &secs_val;
+  bind[5].is_null     = (void*) &null_secs;
+
+  bind[6].buffer_type   = MYSQL_TYPE_STRING;
+  bind[6].buffer        = (void*) note;
+  bind[6].buffer_length = note_len;
+  bind[6].length        = &note_len;
+  bind[6].is_null       = (void*) &null_note;
+
+  if (mysql_stmt_bind_param(scr_db_stmt_event, bind) != 0 ||
+      mysql_stmt_execute(scr_db_stmt_event) != 0)
+  {
+    scr_err("Prepared event insert failed, error = (%s) @ %s:%d",
+            mysql_stmt_error(scr_db_stmt_event), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+#endif
+
 /* records an SCR event in the SCR log database */
 int scr_mysql_log_event(
   const char* type,
@@ -443,6 +657,12 @@ int scr_mysql_log_event(
     return SCR_FAILURE;
   }
 
+  /* insert through the prepared statement when we can, which skips
+   * the quoting and parse cost of a fresh query string per record */
+  if (scr_mysql_log_event_stmt(type_id, note, dset, name, start, secs) == SCR_SUCCESS) {
+    return SCR_SUCCESS;
+  }
+
   char* qnote  = scr_mysql_quote_string(note);
   char* qdset  = scr_mysql_quote_int(dset);
   char* qname  = scr_mysql_quote_string(name);
@@ -504,6 +724,87 @@ int scr_mysql_log_event(
   return SCR_SUCCESS;
 }
 
+/* send any buffered transfer records to the database as a single
+ * multi-row insert */
+int scr_mysql_flush_transfers()
+{
+#ifdef HAVE_LIBMYSQLCLIENT
+  if (scr_db_xfer_count == 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* wrap the accumulated value tuples in an insert statement */
+  const char* insert =
+    "INSERT"
+    " INTO `transfers`"
+    " (`id`,`job_id`,`type_id`,`dset_id`,`dset_name`,`start`,`end`,`secs`,`bytes`,`bw`,`files`,`from`,`to`)"
+    " VALUES ";
+  size_t len = strlen(insert) + scr_db_xfer_len + 2;
+  char* query = (char*) SCR_MALLOC(len);
+  snprintf(query, len, "%s%s;", insert, scr_db_xfer_buf);
+
+  /* reset the batch buffer before we execute, so a failed insert
+   * does not replay the same records on the next flush */
+  scr_db_xfer_len   = 0;
+  scr_db_xfer_count = 0;
+
+  /* execute the query */
+  if (db_debug >= 1) {
+    scr_dbg(0, "%s", query);
+  }
+  if (mysql_real_query(&scr_mysql, query, (unsigned int) strlen(query))) {
+    scr_err("Insert failed, query = (%s), error = (%s) @ %s:%d",
+            query, mysql_error(&scr_mysql), __FILE__, __LINE__
+    );
+    scr_free(&query);
+    return SCR_FAILURE;
+  }
+
+  scr_free(&query);
+#endif
+  return SCR_SUCCESS;
+}
+
+#ifdef HAVE_LIBMYSQLCLIENT
+/* append a value tuple to the transfer batch buffer, flushing the
+ * batch once it holds db_batch records */
+static int scr_mysql_append_transfer(const char* tuple)
+{
+  /* grow the buffer if the tuple doesn't fit */
+  size_t tuple_len = strlen(tuple);
+  size_t needed = scr_db_xfer_len + tuple_len + 2;
+  if (needed > scr_db_xfer_size) {
+    size_t newsize = (scr_db_xfer_size > 0) ? scr_db_xfer_size : 16384;
+    while (newsize < needed) {
+      newsize *= 2;
+    }
+    char* newbuf = (char*) realloc(scr_db_xfer_buf, newsize);
+    if (newbuf == NULL) {
+      scr_abort(-1, "Failed to allocate %lu bytes for transfer batch buffer @ %s:%d",
+        (unsigned long) newsize, __FILE__, __LINE__
+      );
+    }
+    scr_db_xfer_buf = newbuf;
+    scr_db_xfer_size = newsize;
+  }
+
+  /* separate tuples with a comma */
+  if (scr_db_xfer_count > 0) {
+    scr_db_xfer_buf[scr_db_xfer_len++] = ',';
+  }
+  memcpy(scr_db_xfer_buf + scr_db_xfer_len, tuple, tuple_len + 1);
+  scr_db_xfer_len += tuple_len;
+  scr_db_xfer_count++;
+
+  /* send the batch once it's full */
+  if (scr_db_xfer_count >= db_batch) {
+    return scr_mysql_flush_transfers();
+  }
+
+  return SCR_SUCCESS;
+}
+#endif
+
 /* records an SCR file transfer (copy/fetch/flush/drain) in the SCR log database */
 int scr_mysql_log_transfer(
   const char* type,
@@ -572,15 +873,10 @@ int scr_mysql_log_transfer(
     return SCR_FAILURE;
   }
 
-  /* construct the query */
+  /* construct the value tuple for this record */
   char query[4096];
   int n = snprintf(query, sizeof(query),
-    "INSERT"
-    " INTO `transfers`"
-    " (`id`,`job_id`,`type_id`,`dset_id`,`dset_name`,`start`,`end`,`secs`,`bytes`,`bw`,`files`,`from`,`to`)"
-    " VALUES"
-    " (NULL, %lu, %d, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s)"
-    " ;",
+    "(NULL, %lu, %d, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s)",
     scr_db_jobid, type_id, qdset, qname, qstart, qend, qsecs, qbytes, qbw, qfiles, qfrom, qto
   );
 
@@ -596,7 +892,7 @@ int scr_mysql_log_transfer(
   scr_free(&qbw);
   scr_free(&qfiles);
 
-  /* check that we were able to construct the query ok */
+  /* check that we were able to construct the tuple ok */
   if (n >= sizeof(query)) {
     scr_err("Insufficient buffer space (%lu bytes) to build query (%lu bytes) @ %s:%d",
             sizeof(query), n, __FILE__, __LINE__
@@ -604,14 +900,9 @@ int scr_mysql_log_transfer(
     return SCR_FAILURE;
   }
 
-  /* execute the query */
-  if (db_debug >= 1) {
-    scr_dbg(0, "%s", query);
-  }
-  if (mysql_real_query(&scr_mysql, query, (unsigned int) strlen(query))) {
-    scr_err("Insert failed, query = (%s), error = (%s) @ %s:%d",
-            query, mysql_error(&scr_mysql), __FILE__, __LINE__
-    );
+  /* add the record to the batch, which is sent as one multi-row
+   * insert when it fills or when the log is flushed */
+  if (scr_mysql_append_transfer(query) != SCR_SUCCESS) {
     return SCR_FAILURE;
   }
 
@@ -906,6 +1197,27 @@ int scr_log_init(const char* prefix)
     db_name = strdup(value);
   }
 
+  /* number of transfer records to batch per database insert */
+  if ((value = scr_param_get("SCR_LOG_DB_BATCH")) != NULL) {
+    db_batch = atoi(value);
+    if (db_batch < 1) {
+      db_batch = 1;
+    }
+  }
+
+  /* check whether to emit log entries from a background thread */
+  if ((value = scr_param_get("SCR_LOG_ASYNC_ENABLE")) != NULL) {
+    async_enable = atoi(value);
+  }
+
+  /* number of entries in the ring buffer of deferred log entries */
+  if ((value = scr_param_get("SCR_LOG_ASYNC_ENTRIES")) != NULL) {
+    async_ring_entries = atoi(value);
+    if (async_ring_entries < 2) {
+      async_ring_entries = 2;
+    }
+  }
+
   scr_param_finalize();
 
   /* open log file if enabled */
@@ -933,12 +1245,25 @@ int scr_log_init(const char* prefix)
     }
   }
 
-  return rc; 
+  /* start the background flusher thread if requested,
+   * no point unless at least one sink is enabled */
+  if (async_enable && (txt_enable || syslog_enable || db_enable)) {
+    tmp_rc = scr_log_async_start();
+    if (tmp_rc != SCR_SUCCESS) {
+      rc = tmp_rc;
+    }
+  }
+
+  return rc;
 }
 
 /* shut down the logging */
 int scr_log_finalize()
 {
+  /* drain any deferred log entries and stop the flusher thread
+   * before we close the sinks out from under it */
+  scr_log_async_stop();
+
   /* close log file if we opened one */
   if (txt_enable) {
     if (txt_fd >= 0) {
@@ -953,8 +1278,10 @@ int scr_log_finalize()
     closelog();
   }
 
-  /* disconnect from database */
+  /* disconnect from database,
+   * pushing out any partial batch of transfer records first */
   if (db_enable) {
+    scr_mysql_flush_transfers();
     scr_mysql_disconnect();
   }
 
@@ -993,6 +1320,7 @@ int scr_log_job(
   id_prefix   = strdup(prefix);
 
   if (db_enable) {
+    pthread_mutex_lock(&scr_log_write_mutex);
     if (username != NULL && prefix != NULL) {
       int rc = scr_mysql_register_job(username, prefix, start, &scr_db_jobid);
       if (rc != SCR_SUCCESS) {
@@ -1009,6 +1337,7 @@ int scr_log_job(
       db_enable = 0;
       rc = SCR_FAILURE;
     }
+    pthread_mutex_unlock(&scr_log_write_mutex);
   }
 
   return rc;
@@ -1025,6 +1354,8 @@ int scr_log_run(time_t start, int procs, int nodes)
   char timestamp[32];
   strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", timeinfo);
 
+  pthread_mutex_lock(&scr_log_write_mutex);
+
   if (txt_enable) {
     char buf[1024];
     size_t remaining = sizeof(buf);
@@ -1064,6 +1395,8 @@ int scr_log_run(time_t start, int procs, int nodes)
     rc = scr_mysql_log_event("START", NULL, NULL, NULL, &start, NULL);
   }
 
+  pthread_mutex_unlock(&scr_log_write_mutex);
+
   return rc;
 }
 
@@ -1079,6 +1412,8 @@ int scr_log_halt(const char* reason)
   char timestamp[32];
   strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", timeinfo);
 
+  pthread_mutex_lock(&scr_log_write_mutex);
+
   if (txt_enable) {
     char buf[1024];
     size_t remaining = sizeof(buf);
@@ -1126,11 +1461,13 @@ int scr_log_halt(const char* reason)
     rc = scr_mysql_log_event("HALT", reason, NULL, NULL, &now, NULL);
   }
 
+  pthread_mutex_unlock(&scr_log_write_mutex);
+
   return rc;
 }
 
-/* log an event */
-int scr_log_event(
+/* emit an event to each enabled sink */
+static int scr_log_event_write(
   const char* type,
   const char* note,
   const int* dset,
@@ -1140,6 +1477,8 @@ int scr_log_event(
 {
   int rc = SCR_SUCCESS;
 
+  pthread_mutex_lock(&scr_log_write_mutex);
+
   int    dset_val  = (dset  != NULL) ? *dset  : -1;
   double secs_val  = (secs  != NULL) ? *secs  : 0.0;
   time_t start_val = (start != NULL) ? *start : scr_log_seconds();
@@ -1221,11 +1560,13 @@ int scr_log_event(
     rc = scr_mysql_log_event(type, note, dset, name, &start_val, secs);
   }
 
+  pthread_mutex_unlock(&scr_log_write_mutex);
+
   return rc;
 }
 
-/* log a transfer: copy / checkpoint / fetch / flush */
-int scr_log_transfer(
+/* emit a transfer to each enabled sink */
+static int scr_log_transfer_write(
   const char* type,
   const char* from,
   const char* to,
@@ -1238,6 +1579,8 @@ int scr_log_transfer(
 {
   int rc = SCR_SUCCESS;
 
+  pthread_mutex_lock(&scr_log_write_mutex);
+
   struct tm* timeinfo = localtime(start);
   char timestr[100];
   strftime(timestr, sizeof(timestr), "%s", timeinfo);
@@ -1344,5 +1687,246 @@ int scr_log_transfer(
     rc = scr_mysql_log_transfer(type, from, to, dset, name, start, secs, bytes, files);
   }
 
+  pthread_mutex_unlock(&scr_log_write_mutex);
+
   return rc;
 }
+
+/* copy an optional string argument into an entry field,
+ * sets the has flag to indicate the argument was provided */
+static void scr_log_entry_str(char* field, size_t size, int* has, const char* value)
+{
+  if (value != NULL) {
+    strncpy(field, value, size - 1);
+    field[size - 1] = '\0';
+    *has = 1;
+  }
+}
+
+/* append an entry to the ring buffer, returns SCR_FAILURE without
+ * blocking if the ring is full, in which case the entry is counted
+ * as dropped */
+static int scr_log_async_enqueue(const scr_log_entry* entry)
+{
+  /* grab the next slot, back off if the flusher has not caught up */
+  int head = async_head;
+  int next = (head + 1) % async_ring_entries;
+  if (next == async_tail) {
+    /* ring is full, drop the entry rather than block the caller,
+     * the sink is slow, which is exactly when we must not wait on it */
+    async_dropped++;
+    return SCR_FAILURE;
+  }
+
+  /* fill the slot, then publish it,
+   * the barrier ensures the flusher never reads a half-written entry */
+  memcpy(&async_ring[head], entry, sizeof(scr_log_entry));
+  __sync_synchronize();
+  async_head = next;
+
+  return SCR_SUCCESS;
+}
+
+/* drain all published entries to the sinks */
+static void scr_log_async_drain(void)
+{
+  while (async_tail != async_head) {
+    /* the barrier pairs with the one in enqueue so the entry
+     * contents are visible before we read them */
+    __sync_synchronize();
+    scr_log_entry* e = &async_ring[async_tail];
+
+    if (e->kind == SCR_LOG_ENTRY_EVENT) {
+      scr_log_event_write(
+        e->type,
+        e->has_note  ? e->note   : NULL,
+        e->has_dset  ? &e->dset  : NULL,
+        e->has_name  ? e->name   : NULL,
+        e->has_start ? &e->start : NULL,
+        e->has_secs  ? &e->secs  : NULL
+      );
+    } else {
+      scr_log_transfer_write(
+        e->type,
+        e->has_from  ? e->from   : NULL,
+        e->has_to    ? e->to     : NULL,
+        e->has_dset  ? &e->dset  : NULL,
+        e->has_name  ? e->name   : NULL,
+        e->has_start ? &e->start : NULL,
+        e->has_secs  ? &e->secs  : NULL,
+        e->has_bytes ? &e->bytes : NULL,
+        e->has_files ? &e->files : NULL
+      );
+    }
+
+    async_tail = (async_tail + 1) % async_ring_entries;
+  }
+}
+
+/* main routine for the flusher thread,
+ * drains the ring and naps until told to quit */
+static void* scr_log_async_func(void* arg)
+{
+  while (1) {
+    scr_log_async_drain();
+
+    /* exit once we've been told to quit and the ring is empty */
+    if (async_quit && async_tail == async_head) {
+      break;
+    }
+
+    usleep(100*1000);
+  }
+  return NULL;
+}
+
+/* allocate the ring and start the flusher thread */
+static int scr_log_async_start(void)
+{
+  if (async_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* allocate the ring buffer */
+  async_ring = (scr_log_entry*) SCR_MALLOC(async_ring_entries * sizeof(scr_log_entry));
+  async_head    = 0;
+  async_tail    = 0;
+  async_quit    = 0;
+  async_dropped = 0;
+
+  /* kick off the flusher thread, fall back to synchronous
+   * logging if we fail */
+  if (pthread_create(&async_thread, NULL, &scr_log_async_func, NULL) != 0) {
+    scr_err("Failed to start log flusher thread, logging synchronously @ %s:%d",
+      __FILE__, __LINE__
+    );
+    scr_free(&async_ring);
+    async_enable = 0;
+    return SCR_FAILURE;
+  }
+
+  async_running = 1;
+  return SCR_SUCCESS;
+}
+
+/* drain the ring, stop the flusher thread, and free the ring */
+static int scr_log_async_stop(void)
+{
+  if (! async_running) {
+    return SCR_SUCCESS;
+  }
+
+  /* signal the flusher and wait for it to drain the ring and exit */
+  async_quit = 1;
+  pthread_join(async_thread, NULL);
+  async_running = 0;
+
+  scr_free(&async_ring);
+
+  /* record how many entries we lost to a full ring, if any */
+  if (async_dropped > 0) {
+    char note[SCR_LOG_ENTRY_NOTE];
+    snprintf(note, sizeof(note), "dropped %lu log entries", async_dropped);
+    scr_log_event_write("LOG_DROP", note, NULL, NULL, NULL, NULL);
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* log an event */
+int scr_log_event(
+  const char* type,
+  const char* note,
+  const int* dset,
+  const char* name,
+  const time_t* start,
+  const double* secs)
+{
+  /* hand the entry to the flusher thread if async logging is on,
+   * so the caller pays for a memcpy rather than file or database i/o */
+  if (async_running) {
+    scr_log_entry e;
+    memset(&e, 0, sizeof(e));
+    e.kind = SCR_LOG_ENTRY_EVENT;
+    if (type != NULL) {
+      strncpy(e.type, type, sizeof(e.type) - 1);
+    }
+    scr_log_entry_str(e.note, sizeof(e.note), &e.has_note, note);
+    scr_log_entry_str(e.name, sizeof(e.name), &e.has_name, name);
+    if (dset != NULL) {
+      e.has_dset = 1;
+      e.dset = *dset;
+    }
+    if (start != NULL) {
+      e.has_start = 1;
+      e.start = *start;
+    }
+    if (secs != NULL) {
+      e.has_secs = 1;
+      e.secs = *secs;
+    }
+    if (scr_log_async_enqueue(&e) == SCR_SUCCESS) {
+      return SCR_SUCCESS;
+    }
+
+    /* ring was full, entry was dropped */
+    return SCR_FAILURE;
+  }
+
+  return scr_log_event_write(type, note, dset, name, start, secs);
+}
+
+/* log a transfer: copy / checkpoint / fetch / flush */
+int scr_log_transfer(
+  const char* type,
+  const char* from,
+  const char* to,
+  const int* dset,
+  const char* name,
+  const time_t* start,
+  const double* secs,
+  const double* bytes,
+  const int* files)
+{
+  /* hand the entry to the flusher thread if async logging is on,
+   * so the caller pays for a memcpy rather than file or database i/o */
+  if (async_running) {
+    scr_log_entry e;
+    memset(&e, 0, sizeof(e));
+    e.kind = SCR_LOG_ENTRY_TRANSFER;
+    if (type != NULL) {
+      strncpy(e.type, type, sizeof(e.type) - 1);
+    }
+    scr_log_entry_str(e.from, sizeof(e.from), &e.has_from, from);
+    scr_log_entry_str(e.to,   sizeof(e.to),   &e.has_to,   to);
+    scr_log_entry_str(e.name, sizeof(e.name), &e.has_name, name);
+    if (dset != NULL) {
+      e.has_dset = 1;
+      e.dset = *dset;
+    }
+    if (start != NULL) {
+      e.has_start = 1;
+      e.start = *start;
+    }
+    if (secs != NULL) {
+      e.has_secs = 1;
+      e.secs = *secs;
+    }
+    if (bytes != NULL) {
+      e.has_bytes = 1;
+      e.bytes = *bytes;
+    }
+    if (files != NULL) {
+      e.has_files = 1;
+      e.files = *files;
+    }
+    if (scr_log_async_enqueue(&e) == SCR_SUCCESS) {
+      return SCR_SUCCESS;
+    }
+
+    /* ring was full, entry was dropped */
+    return SCR_FAILURE;
+  }
+
+  return scr_log_transfer_write(type, from, to, dset, name, start, secs, bytes, files);
+}
@@ -150,6 +150,14 @@ int scr_meta_set_complete(scr_meta* meta, int complete)
   return SCR_SUCCESS;
 }
 
+/* marks the file as a small-file packfile */
+int scr_meta_set_pack(scr_meta* meta, int pack)
+{
+  kvtree_unset(meta, SCR_META_KEY_PACK);
+  kvtree_set_kv_int(meta, SCR_META_KEY_PACK, pack);
+  return SCR_SUCCESS;
+}
+
 /* sets crc value in meta data, overwrites any existing value with new value */
 int scr_meta_set_crc32(scr_meta* meta, uLong crc)
 {
@@ -157,6 +165,22 @@ int scr_meta_set_crc32(scr_meta* meta, uLong crc)
   return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
 }
 
+/* sets the chunk size used for per-chunk crc values in meta data */
+int scr_meta_set_chunk_size(scr_meta* meta, unsigned long size)
+{
+  int rc = kvtree_util_set_unsigned_long(meta, SCR_META_KEY_CHUNKSIZE, size);
+  return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+}
+
+/* sets crc value for the given chunk of the file in meta data,
+ * overwrites any existing value with new value */
+int scr_meta_set_chunk_crc32(scr_meta* meta, int chunk, uLong crc)
+{
+  kvtree* chunk_hash = kvtree_set_kv_int(meta, SCR_META_KEY_CHUNK, chunk);
+  int rc = kvtree_util_set_crc32(chunk_hash, SCR_META_KEY_CRC, crc);
+  return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+}
+
 static void scr_stat_get_atimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs)
 {
     *secs = (uint64_t) sb->st_atime;
@@ -299,6 +323,13 @@ int scr_meta_get_complete(const scr_meta* meta, int* complete)
   return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
 }
 
+/* get the packfile flag in meta data, returns SCR_SUCCESS if a field is set */
+int scr_meta_get_pack(const scr_meta* meta, int* pack)
+{
+  int rc = kvtree_util_get_int(meta, SCR_META_KEY_PACK, pack);
+  return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+}
+
 /* get the crc32 field in meta data, returns SCR_SUCCESS if a field is set */
 int scr_meta_get_crc32(const scr_meta* meta, uLong* crc)
 {
@@ -306,6 +337,21 @@ int scr_meta_get_crc32(const scr_meta* meta, uLong* crc)
   return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
 }
 
+/* get the chunk size used for per-chunk crc values, returns SCR_SUCCESS if a field is set */
+int scr_meta_get_chunk_size(const scr_meta* meta, unsigned long* size)
+{
+  int rc = kvtree_util_get_unsigned_long(meta, SCR_META_KEY_CHUNKSIZE, size);
+  return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+}
+
+/* get the crc32 field for the given chunk of the file, returns SCR_SUCCESS if a field is set */
+int scr_meta_get_chunk_crc32(const scr_meta* meta, int chunk, uLong* crc)
+{
+  kvtree* chunk_hash = kvtree_get_kv_int(meta, SCR_META_KEY_CHUNK, chunk);
+  int rc = kvtree_util_get_crc32(chunk_hash, SCR_META_KEY_CRC, crc);
+  return (rc == KVTREE_SUCCESS) ? SCR_SUCCESS : SCR_FAILURE;
+}
+
 /*
 =========================================
 Check field values
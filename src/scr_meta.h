@@ -91,12 +91,21 @@ int scr_meta_set_filesize(scr_meta* meta, unsigned long filesize);
 /* set the completeness field on meta */
 int scr_meta_set_complete(scr_meta* meta, int complete);
 
+/* mark the file as a small-file packfile */
+int scr_meta_set_pack(scr_meta* meta, int pack);
+
 /* capture stat metadata (uid, gid, mode, atime, ctime, mtime) */
 int scr_meta_set_stat(scr_meta* meta, struct stat* statbuf);
 
 /* set the crc32 field on meta */
 int scr_meta_set_crc32(scr_meta* meta, uLong crc);
 
+/* set the chunk size used for per-chunk crc32 fields on meta */
+int scr_meta_set_chunk_size(scr_meta* meta, unsigned long size);
+
+/* set the crc32 field for the given chunk of the file on meta */
+int scr_meta_set_chunk_crc32(scr_meta* meta, int chunk, uLong crc);
+
 /*
 =========================================
 Get field values
@@ -127,9 +136,18 @@ int scr_meta_get_filesize(const scr_meta* meta, unsigned long* filesize);
 /* get the completeness field in meta data, returns SCR_SUCCESS if successful */
 int scr_meta_get_complete(const scr_meta* meta, int* complete);
 
+/* get the packfile flag in meta data, returns SCR_SUCCESS if a field is set */
+int scr_meta_get_pack(const scr_meta* meta, int* pack);
+
 /* get the crc32 field in meta data, returns SCR_SUCCESS if a field is set */
 int scr_meta_get_crc32(const scr_meta* meta, uLong* crc);
 
+/* get the chunk size used for per-chunk crc32 fields, returns SCR_SUCCESS if a field is set */
+int scr_meta_get_chunk_size(const scr_meta* meta, unsigned long* size);
+
+/* get the crc32 field for the given chunk of the file, returns SCR_SUCCESS if a field is set */
+int scr_meta_get_chunk_crc32(const scr_meta* meta, int chunk, uLong* crc);
+
 /*
 =========================================
 Check field values
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Implements small-file packing, see scr_pack.h for an overview.
+ *
+ * Packfile layout:
+ *   bytes  0 -  7   magic "SCRPACK1"
+ *   bytes  8 - 15   manifest length in bytes
+ *   manifest        packed kvtree: FILE -> name -> {OFFSET, SIZE}
+ *   payloads        file contents back to back, OFFSET is relative
+ *                   to the end of the manifest so the manifest
+ *                   encoding never feeds back into the offsets */
+
+#include "scr_globals.h"
+#include "scr_pack.h"
+
+#include "kvtree.h"
+#include "kvtree_util.h"
+#include "spath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SCR_PACK_MAGIC     ("SCRPACK1")
+#define SCR_PACK_MAGIC_LEN (8)
+
+/* keys used in the packfile manifest */
+#define SCR_PACK_KEY_FILE   ("FILE")
+#define SCR_PACK_KEY_OFFSET ("OFFSET")
+#define SCR_PACK_KEY_SIZE   ("SIZE")
+
+/* build the path to this rank's packfile in the given cache
+ * directory, caller must free */
+static char* scr_pack_name(const char* dir)
+{
+  spath* path = spath_from_str(dir);
+  spath_append_strf(path, "pack.%d.scrpack", scr_my_rank_world);
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* returns 1 if the named file is a packfile, the name is checked
+ * first so only candidates pay for the open and magic read */
+static int scr_pack_detect(const char* file)
+{
+  /* packfiles are named pack.<rank>.scrpack */
+  spath* path = spath_from_str(file);
+  spath_basename(path);
+  char* base = spath_strdup(path);
+  spath_delete(&path);
+  int named = (strncmp(base, "pack.", strlen("pack.")) == 0);
+  size_t baselen = strlen(base);
+  size_t suflen  = strlen(".scrpack");
+  if (named) {
+    named = (baselen > suflen &&
+      strcmp(base + baselen - suflen, ".scrpack") == 0);
+  }
+  scr_free(&base);
+  if (! named) {
+    return 0;
+  }
+
+  /* verify the magic bytes */
+  int is_pack = 0;
+  int fd = scr_open(file, O_RDONLY);
+  if (fd >= 0) {
+    char magic[SCR_PACK_MAGIC_LEN];
+    ssize_t n = scr_read_attempt(file, fd, magic, sizeof(magic));
+    if (n == sizeof(magic) &&
+        memcmp(magic, SCR_PACK_MAGIC, SCR_PACK_MAGIC_LEN) == 0)
+    {
+      is_pack = 1;
+    }
+    scr_close_nofsync(file, fd);
+  }
+  return is_pack;
+}
+
+/* copy count bytes between two open descriptors through buf */
+static int scr_pack_copy_bytes(
+  const char* src_name, int src_fd,
+  const char* dst_name, int dst_fd,
+  unsigned long count,
+  char* buf, size_t bufsize)
+{
+  unsigned long left = count;
+  while (left > 0) {
+    size_t n = bufsize;
+    if ((unsigned long) n > left) {
+      n = (size_t) left;
+    }
+    if (scr_read_attempt(src_name, src_fd, buf, n) != (ssize_t) n) {
+      return SCR_FAILURE;
+    }
+    if (scr_write_attempt(dst_name, dst_fd, buf, n) != (ssize_t) n) {
+      return SCR_FAILURE;
+    }
+    left -= n;
+  }
+  return SCR_SUCCESS;
+}
+
+/* pack files smaller than scr_cache_pack_size from the map into a
+ * per-rank packfile for the given dataset */
+int scr_pack_apply(scr_filemap* map, int id, int* files_cut, unsigned long* bytes_add)
+{
+  *files_cut = 0;
+  *bytes_add = 0;
+
+  /* nothing to do when packing is disabled */
+  if (scr_cache_pack_size == 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* collect the files below the threshold, only complete files with
+   * a known size are considered */
+  int num_files = scr_filemap_num_files(map);
+  char** paths         = (char**) SCR_MALLOC(num_files * sizeof(char*));
+  unsigned long* sizes = (unsigned long*) SCR_MALLOC(num_files * sizeof(unsigned long));
+  int count = 0;
+  kvtree_elem* elem;
+  for (elem = scr_filemap_first_file(map);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    char* file = kvtree_elem_key(elem);
+    scr_meta* meta = scr_meta_new();
+    if (scr_filemap_get_meta(map, file, meta) == SCR_SUCCESS) {
+      int complete = 0;
+      unsigned long filesize = 0;
+      if (scr_meta_get_complete(meta, &complete) == SCR_SUCCESS &&
+          complete &&
+          scr_meta_get_filesize(meta, &filesize) == SCR_SUCCESS &&
+          filesize < scr_cache_pack_size)
+      {
+        paths[count] = strdup(file);
+        sizes[count] = filesize;
+        count++;
+      }
+    }
+    scr_meta_delete(&meta);
+  }
+
+  /* packing a single file saves nothing */
+  if (count < 2) {
+    goto cleanup_nopack;
+  }
+
+  /* look up the cache directory holding this dataset */
+  char* dir = NULL;
+  if (scr_cache_index_get_dir(scr_cindex, id, &dir) != SCR_SUCCESS) {
+    goto cleanup_nopack;
+  }
+  char* pack_path = scr_pack_name(dir);
+
+  /* build the manifest, offsets are relative to the payload start */
+  kvtree* manifest = kvtree_new();
+  unsigned long offset = 0;
+  int i;
+  for (i = 0; i < count; i++) {
+    spath* path = spath_from_str(paths[i]);
+    spath_basename(path);
+    char* base = spath_strdup(path);
+    spath_delete(&path);
+
+    kvtree* entry = kvtree_set_kv(manifest, SCR_PACK_KEY_FILE, base);
+    kvtree_util_set_unsigned_long(entry, SCR_PACK_KEY_OFFSET, offset);
+    kvtree_util_set_unsigned_long(entry, SCR_PACK_KEY_SIZE, sizes[i]);
+    offset += sizes[i];
+
+    scr_free(&base);
+  }
+
+  /* serialize the manifest */
+  unsigned long manifest_len = (unsigned long) kvtree_pack_size(manifest);
+  char* manifest_buf = (char*) SCR_MALLOC(manifest_len);
+  kvtree_pack(manifest_buf, manifest);
+  kvtree_delete(&manifest);
+
+  /* write magic, manifest length, manifest, then the payloads,
+   * a single file creation and a single fsync at close cover the
+   * whole set */
+  int rc = SCR_SUCCESS;
+  mode_t mode = scr_getmode(1, 1, 0);
+  int fd = scr_open(pack_path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+  if (fd < 0) {
+    scr_err("Opening packfile for write: scr_open(%s) errno=%d %s @ %s:%d",
+      pack_path, errno, strerror(errno), __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  } else {
+    if (scr_write_attempt(pack_path, fd, SCR_PACK_MAGIC, SCR_PACK_MAGIC_LEN) != SCR_PACK_MAGIC_LEN ||
+        scr_write_attempt(pack_path, fd, &manifest_len, sizeof(manifest_len)) != sizeof(manifest_len) ||
+        scr_write_attempt(pack_path, fd, manifest_buf, manifest_len) != (ssize_t) manifest_len)
+    {
+      rc = SCR_FAILURE;
+    }
+
+    char* buf = (char*) scr_buf_get(scr_file_buf_size);
+    for (i = 0; i < count && rc == SCR_SUCCESS; i++) {
+      int src_fd = scr_open(paths[i], O_RDONLY);
+      if (src_fd < 0) {
+        rc = SCR_FAILURE;
+        break;
+      }
+      rc = scr_pack_copy_bytes(paths[i], src_fd, pack_path, fd,
+        sizes[i], buf, scr_file_buf_size
+      );
+      scr_close_nofsync(paths[i], src_fd);
+    }
+    scr_buf_put(buf);
+
+    if (scr_close(pack_path, fd) != SCR_SUCCESS) {
+      rc = SCR_FAILURE;
+    }
+  }
+  scr_free(&manifest_buf);
+
+  if (rc != SCR_SUCCESS) {
+    /* leave the map and the original files untouched */
+    scr_err("Failed to write packfile %s, leaving files unpacked @ %s:%d",
+      pack_path, __FILE__, __LINE__
+    );
+    scr_file_unlink(pack_path);
+    scr_free(&pack_path);
+    goto cleanup_nopack;
+  }
+
+  /* the packfile replaces the packed entries in the map */
+  for (i = 0; i < count; i++) {
+    scr_filemap_remove_file(map, paths[i]);
+    scr_file_unlink(paths[i]);
+  }
+  scr_filemap_add_file(map, pack_path);
+
+  /* record meta data for the packfile, it flushes as one object
+   * into the dataset metadata directory under the prefix */
+  unsigned long header_bytes = SCR_PACK_MAGIC_LEN + sizeof(manifest_len) + manifest_len;
+  spath* metadir_path = spath_from_str(scr_prefix_scr);
+  spath_append_strf(metadir_path, "scr.dataset.%d", id);
+  char* metadir = spath_strdup(metadir_path);
+  spath_delete(&metadir_path);
+
+  spath* base_path = spath_from_str(pack_path);
+  spath_basename(base_path);
+  char* base = spath_strdup(base_path);
+  spath_delete(&base_path);
+
+  scr_meta* meta = scr_meta_new();
+  scr_meta_set_complete(meta, 1);
+  scr_meta_set_ranks(meta, scr_ranks_world);
+  scr_meta_set_filesize(meta, header_bytes + offset);
+  scr_meta_set_pack(meta, 1);
+  scr_meta_set_orig(meta, base);
+  scr_meta_set_origpath(meta, metadir);
+  scr_meta_set_origname(meta, base);
+  struct stat stat_buf;
+  if (stat(pack_path, &stat_buf) == 0) {
+    scr_meta_set_stat(meta, &stat_buf);
+  }
+  scr_filemap_set_meta(map, pack_path, meta);
+  scr_meta_delete(&meta);
+
+  scr_dbg(2, "Packed %d files (%lu bytes) into %s",
+    count, offset, pack_path
+  );
+
+  *files_cut = count - 1;
+  *bytes_add = header_bytes;
+
+  scr_free(&base);
+  scr_free(&metadir);
+  scr_free(&pack_path);
+
+cleanup_nopack:
+  for (i = 0; i < count; i++) {
+    scr_free(&paths[i]);
+  }
+  scr_free(&paths);
+  scr_free(&sizes);
+  return SCR_SUCCESS;
+}
+
+/* recreate the files held in one packfile, writing them next to it */
+static int scr_pack_extract_one(const char* pack_path)
+{
+  int rc = SCR_SUCCESS;
+
+  int fd = scr_open(pack_path, O_RDONLY);
+  if (fd < 0) {
+    return SCR_FAILURE;
+  }
+
+  /* read and verify the header */
+  char magic[SCR_PACK_MAGIC_LEN];
+  unsigned long manifest_len = 0;
+  if (scr_read_attempt(pack_path, fd, magic, sizeof(magic)) != sizeof(magic) ||
+      memcmp(magic, SCR_PACK_MAGIC, SCR_PACK_MAGIC_LEN) != 0 ||
+      scr_read_attempt(pack_path, fd, &manifest_len, sizeof(manifest_len)) != sizeof(manifest_len))
+  {
+    scr_close_nofsync(pack_path, fd);
+    return SCR_FAILURE;
+  }
+
+  /* read and unpack the manifest */
+  char* manifest_buf = (char*) SCR_MALLOC(manifest_len);
+  kvtree* manifest = kvtree_new();
+  if (scr_read_attempt(pack_path, fd, manifest_buf, manifest_len) != (ssize_t) manifest_len ||
+      kvtree_unpack(manifest_buf, manifest) == 0)
+  {
+    rc = SCR_FAILURE;
+  }
+  scr_free(&manifest_buf);
+
+  /* files are recreated in the directory holding the packfile */
+  spath* dir_path = spath_from_str(pack_path);
+  spath_dirname(dir_path);
+  char* dir = spath_strdup(dir_path);
+  spath_delete(&dir_path);
+
+  unsigned long payload = SCR_PACK_MAGIC_LEN + sizeof(manifest_len) + manifest_len;
+  char* buf = (char*) scr_buf_get(scr_file_buf_size);
+  mode_t mode = scr_getmode(1, 1, 0);
+
+  kvtree* files = kvtree_get(manifest, SCR_PACK_KEY_FILE);
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(files);
+       elem != NULL && rc == SCR_SUCCESS;
+       elem = kvtree_elem_next(elem))
+  {
+    const char* name = kvtree_elem_key(elem);
+    kvtree* entry = kvtree_elem_hash(elem);
+    unsigned long offset = 0;
+    unsigned long size   = 0;
+    kvtree_util_get_unsigned_long(entry, SCR_PACK_KEY_OFFSET, &offset);
+    kvtree_util_get_unsigned_long(entry, SCR_PACK_KEY_SIZE, &size);
+
+    /* build the destination path */
+    spath* dst_path = spath_from_str(dir);
+    spath_append_str(dst_path, name);
+    char* dst = spath_strdup(dst_path);
+    spath_delete(&dst_path);
+
+    /* skip files that are already in place */
+    if (scr_file_is_readable(dst) == SCR_SUCCESS &&
+        scr_file_size(dst) == size)
+    {
+      scr_free(&dst);
+      continue;
+    }
+
+    /* copy the payload out */
+    if (scr_lseek(pack_path, fd, (off_t) (payload + offset), SEEK_SET) != SCR_SUCCESS) {
+      rc = SCR_FAILURE;
+      scr_free(&dst);
+      break;
+    }
+    int dst_fd = scr_open(dst, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (dst_fd < 0) {
+      rc = SCR_FAILURE;
+      scr_free(&dst);
+      break;
+    }
+    rc = scr_pack_copy_bytes(pack_path, fd, dst, dst_fd,
+      size, buf, scr_file_buf_size
+    );
+    if (scr_close(dst, dst_fd) != SCR_SUCCESS) {
+      rc = SCR_FAILURE;
+    }
+    scr_free(&dst);
+  }
+
+  scr_buf_put(buf);
+  scr_free(&dir);
+  kvtree_delete(&manifest);
+  scr_close_nofsync(pack_path, fd);
+  return rc;
+}
+
+/* recreate the files held in any packfile listed in the map */
+int scr_pack_extract(const scr_filemap* map)
+{
+  int rc = SCR_SUCCESS;
+  kvtree_elem* elem;
+  for (elem = scr_filemap_first_file(map);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    char* file = kvtree_elem_key(elem);
+    if (scr_pack_detect(file)) {
+      if (scr_pack_extract_one(file) != SCR_SUCCESS) {
+        scr_err("Failed to extract files from packfile %s @ %s:%d",
+          file, __FILE__, __LINE__
+        );
+        rc = SCR_FAILURE;
+      }
+    }
+  }
+  return rc;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_PACK_H
+#define SCR_PACK_H
+
+#include "scr_filemap.h"
+
+/* Small-file packing.  When SCR_CACHE_PACK_SIZE is set, files below
+ * the threshold are concatenated into a single per-rank packfile in
+ * the cache directory at complete-output time and dropped from the
+ * filemap in favor of the packfile, so redundancy encoding, cache
+ * checks, and flush all pay one file's overhead for the whole set.
+ * The packfile is self-describing: its header carries a manifest of
+ * the files it holds, so the files can be recreated after a fetch or
+ * rebuild without any side metadata. */
+
+/* pack files smaller than scr_cache_pack_size from the map into a
+ * per-rank packfile for the given dataset, packed entries are removed
+ * from the map and the packfile is registered in their place, returns
+ * in files_cut the net drop in the map's file count and in bytes_add
+ * the header bytes the packfile adds, both are zero when nothing is
+ * packed, the map itself is untouched on failure */
+int scr_pack_apply(scr_filemap* map, int id, int* files_cut, unsigned long* bytes_add);
+
+/* recreate the files held in any packfile listed in the map, writing
+ * them next to the packfile, files already present with the right
+ * size are skipped, the packfile and its map entry are left in place
+ * since redundancy data references them, a no-op for maps without
+ * packfiles */
+int scr_pack_extract(const scr_filemap* map);
+
+#endif
@@ -59,10 +59,16 @@ static kvtree* scr_user_hash = NULL;
 /* this data structure will hold values read from the system config file */
 static kvtree* scr_system_hash = NULL;
 
-/* caches lookups via getenv, need to do this on some systems because returning
- * pointers to getenv values back too many functions was segfaulting on some
- * systems */
-static kvtree* scr_env_hash = NULL;
+/* flat cache of resolved parameter values, each entry maps a name to
+ * its final value after applying precedence (environment over user
+ * config over SCR_Config over system config) and expanding any
+ * environment variables, so scr_param_get is a single hash lookup,
+ * it also gives callers a stable pointer, returning pointers to
+ * getenv values directly was segfaulting on some systems */
+static kvtree* scr_param_cache = NULL;
+
+/* environment of the process, scanned once to seed the cache */
+extern char** environ;
 
 /* holds param values set through SCR_Config */
 kvtree* scr_app_hash = NULL;
@@ -163,75 +169,82 @@ static char* expand_env(const char* value)
   return retval;
 }
 
-/* searches for name and returns a character pointer to its value if set,
- * returns NULL if not found */
-const char* scr_param_get(const char* name)
+/* resolve name through the full precedence chain, expand any
+ * environment variables in its value, and intern the result in the
+ * parameter cache, returns a pointer to the cached value or NULL
+ * if the parameter is not set anywhere */
+static const char* scr_param_resolve(const char* name)
 {
   char* value = NULL;
 
   /* see if this parameter is one which is restricted from user */
   kvtree* no_user = kvtree_get(scr_no_user_hash, name);
 
-  /* if parameter is set in environment, return that value */
+  /* if parameter is set in environment, take that value */
   if (no_user == NULL && getenv(name) != NULL) {
-    /* we don't just return the getenv value directly because that causes
-     * segfaults on some systems, so instead we add it to a hash and return
-     * the pointer into the hash */
-
-    /* try to lookup the value for this name in case we've already cached it */
-    if (kvtree_util_get_str(scr_env_hash, name, &value) != KVTREE_SUCCESS) {
-      /* it's not in the hash yet, so add it */
-      char* tmp_value = expand_env(getenv(name));
-      kvtree_util_set_str(scr_env_hash, name, tmp_value);
-      scr_free(&tmp_value);
-
-      /* now issue our lookup again */
-      if (kvtree_util_get_str(scr_env_hash, name, &value) != KVTREE_SUCCESS) {
-        /* it's an error if we don't find it this time */
-        scr_abort(-1, "Failed to find value for %s in env hash @ %s:%d",
-          name, __FILE__, __LINE__
-        );
-      }
-    }
-
-    return value;
+    value = getenv(name);
   }
 
   /* otherwise, if parameter is set in user configuration file,
-   * return that value */
-  value = kvtree_elem_get_first_val(scr_user_hash, name);
-  if (no_user == NULL && value != NULL) {
-    /* evaluate environment variables */
-    if (strchr(value, '$')) {
-      value = expand_env(value);
-    }
-    return value;
+   * take that value */
+  if (value == NULL && no_user == NULL) {
+    value = kvtree_elem_get_first_val(scr_user_hash, name);
   }
 
-  /* otherwise, if this parameter is one which has been set by the application
-   * return that value */
-  value = kvtree_elem_get_first_val(scr_app_hash, name);
-  if (value != NULL) {
-    /* evaluate environment variables */
-    if (strchr(value, '$')) {
-      value = expand_env(value);
-    }
-    return value;
+  /* otherwise, if this parameter is one which has been set by the
+   * application, take that value */
+  if (value == NULL) {
+    value = kvtree_elem_get_first_val(scr_app_hash, name);
   }
 
   /* otherwise, if parameter is set in system configuration file,
-   * return that value */
-  value = kvtree_elem_get_first_val(scr_system_hash, name);
-  if (value != NULL) {
-    /* evaluate environment variables */
-    if (strchr(value, '$')) {
-      value = expand_env(value);
-    }
+   * take that value */
+  if (value == NULL) {
+    value = kvtree_elem_get_first_val(scr_system_hash, name);
+  }
+
+  /* parameter not set anywhere, leave it out of the cache so a later
+   * setenv or SCR_Config call can still define it */
+  if (value == NULL) {
+    return NULL;
+  }
+
+  /* evaluate environment variables and intern the expanded value,
+   * the caller gets a stable pointer into the cache */
+  char* expanded = expand_env(value);
+  kvtree_util_set_str(scr_param_cache, name, expanded);
+  scr_free(&expanded);
+
+  char* cached = NULL;
+  if (kvtree_util_get_str(scr_param_cache, name, &cached) != KVTREE_SUCCESS) {
+    /* it's an error if we don't find it after setting it */
+    scr_abort(-1, "Failed to find value for %s in parameter cache @ %s:%d",
+      name, __FILE__, __LINE__
+    );
+  }
+  return cached;
+}
+
+/* searches for name and returns a character pointer to its value if set,
+ * returns NULL if not found */
+const char* scr_param_get(const char* name)
+{
+  /* fast path: most parameters are resolved into the cache when
+   * scr_param_init reads the config files */
+  char* value = NULL;
+  if (kvtree_util_get_str(scr_param_cache, name, &value) == KVTREE_SUCCESS) {
     return value;
   }
 
-  /* parameter not found, return NULL */
-  return NULL;
+  /* miss: walk the precedence chain and cache whatever we find */
+  return scr_param_resolve(name);
+}
+
+/* returns hash mapping each known parameter name to its resolved
+ * value, caller must not modify or free the hash */
+const kvtree* scr_param_get_all(void)
+{
+  return scr_param_cache;
 }
 
 /* searchs for name and returns a newly allocated hash of its value if set,
@@ -372,6 +385,25 @@ static char* app_config_path()
   return file;
 }
 
+/* allocates a new string (to be freed with scr_free)
+ * that is path to compiled config bundle */
+static char* bundle_config_path()
+{
+  char* file = NULL;
+
+  /* get the prefix directory */
+  char* value = getenv("SCR_PREFIX");
+  spath* prefix_path = scr_get_prefix(value);
+
+  /* tack file name on to directory */
+  spath_append_str(prefix_path, ".scr");
+  spath_append_str(prefix_path, SCR_CONFIG_FILE_BUNDLE);
+  file = spath_strdup(prefix_path);
+  spath_delete(&prefix_path);
+
+  return file;
+}
+
 /* read config files and store contents */
 int scr_param_init()
 {
@@ -424,30 +456,26 @@ int scr_param_init()
     scr_no_user_hash = kvtree_new();
     kvtree_set(scr_no_user_hash, "SCR_CNTL_BASE", kvtree_new());
 
-    /* read in app config file which records any parameters set
-     * by application through calls to SCR_Config */
-    char* app_file = app_config_path();
-    if (app_file != NULL) {
-      scr_app_hash = kvtree_new();
-      scr_config_read(app_file, scr_app_hash);
-    }
-    scr_free(&app_file);
-
-    /* allocate hash object to store values from user config file,
-     * if specified */
-    char* user_file = user_config_path();
-    if (user_file != NULL) {
-      scr_user_hash = kvtree_new();
-      scr_config_read(user_file, scr_user_hash);
-    }
-    scr_free(&user_file);
-
-    /* allocate hash object to store values from system config file */
+    /* read the app config file (which records any parameters set by
+     * the application through calls to SCR_Config), the user config
+     * file, and the system config file, the compiled bundle caches
+     * the parsed contents of all three so repeated tool invocations
+     * load one packed file instead of re-parsing the same text */
+    scr_app_hash    = kvtree_new();
+    scr_user_hash   = kvtree_new();
     scr_system_hash = kvtree_new();
-    scr_config_read(scr_config_file, scr_system_hash);
+    char* app_file    = app_config_path();
+    char* user_file   = user_config_path();
+    char* bundle_file = bundle_config_path();
+    scr_config_read_bundled(bundle_file, app_file, user_file, scr_config_file,
+      scr_app_hash, scr_user_hash, scr_system_hash
+    );
+    scr_free(&bundle_file);
+    scr_free(&user_file);
+    scr_free(&app_file);
 
-    /* initialize our hash to cache lookups to getenv */
-    scr_env_hash = kvtree_new();
+    /* initialize the cache of resolved parameter values */
+    scr_param_cache = kvtree_new();
 
     /* warn user if they set any parameters in their environment or user
      * config file which aren't permitted */
@@ -469,6 +497,34 @@ int scr_param_init()
         );
       }
     }
+
+    /* seed the cache with every parameter named in a config file,
+     * resolving precedence and expanding environment variables once
+     * up front rather than on each lookup */
+    kvtree* hashes[] = { scr_user_hash, scr_app_hash, scr_system_hash };
+    for (i = 0; i < sizeof(hashes)/sizeof(hashes[0]); i++) {
+      for (elem = kvtree_elem_first(hashes[i]);
+           elem != NULL;
+           elem = kvtree_elem_next(elem))
+      {
+        scr_param_resolve(kvtree_elem_key(elem));
+      }
+    }
+
+    /* also seed any SCR_* variables set only in the environment */
+    for (i = 0; environ[i] != NULL; i++) {
+      if (strncmp(environ[i], "SCR_", 4) == 0) {
+        /* copy out the name portion up to the '=' */
+        char* sep = strchr(environ[i], '=');
+        if (sep != NULL && sep - environ[i] < SCR_MAX_FILENAME) {
+          char envname[SCR_MAX_FILENAME];
+          size_t namelen = sep - environ[i];
+          memcpy(envname, environ[i], namelen);
+          envname[namelen] = '\0';
+          scr_param_resolve(envname);
+        }
+      }
+    }
   }
 
   /* increment our reference count */
@@ -507,8 +563,8 @@ int scr_param_finalize()
     /* free our parameter hash */
     kvtree_delete(&scr_system_hash);
 
-    /* free our env hash */
-    kvtree_delete(&scr_env_hash);
+    /* free our cache of resolved values */
+    kvtree_delete(&scr_param_cache);
 
     /* free the hash listing parameters user cannot set */
     kvtree_delete(&scr_no_user_hash);
@@ -531,6 +587,10 @@ kvtree* scr_param_set(char* name, const char* value)
   kvtree* v = kvtree_set(k, value, kvtree_new());
   assert(k && v);
   kvtree_set(scr_app_hash, name, k);
+
+  /* drop any cached value so the next lookup resolves afresh */
+  kvtree_unset(scr_param_cache, name);
+
   return v;
 }
 
@@ -546,5 +606,8 @@ kvtree* scr_param_set_hash(char* name, kvtree* hash_value)
     );
   }
 
+  /* drop any cached value so the next lookup resolves afresh */
+  kvtree_unset(scr_param_cache, name);
+
   return kvtree_set(scr_app_hash, name, hash_value);
 }
@@ -54,6 +54,12 @@ int scr_param_finalize(void);
  * returns NULL if not found */
 const char* scr_param_get(const char* name);
 
+/* returns hash mapping each known parameter name to its resolved
+ * value, includes every parameter named in a config file or set as
+ * an SCR_* environment variable with precedence already applied,
+ * caller must not modify or free the hash */
+const kvtree* scr_param_get_all(void);
+
 /* searchs for name and returns a newly allocated hash of its value if set,
  * returns NULL if not found */
 const kvtree* scr_param_get_hash(const char* name);
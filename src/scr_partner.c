@@ -0,0 +1,1129 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Native one-sided partner copy.  The ER/redset partner scheme moves
+ * checkpoint bytes through a send-recv rendezvous with intermediate
+ * staging buffers, which leaves much of the fabric bandwidth on the
+ * table.  This module implements the partner copy directly: each rank
+ * concatenates its dataset files (and its filemap) into a byte stream
+ * and pushes it into an RMA window on its right-hand partner with
+ * MPI_Put, so the copy streams at wire speed on fabrics with native
+ * one-sided support.  The holder records what it received in a small
+ * partner map file next to the copies, which the recover path uses to
+ * stream lost files back to their owner.
+ *
+ * Partners are chosen round-robin across node failure groups with
+ * scr_set_partners(), so copies always land on another node.  The
+ * assignment depends only on the node layout and world ranks, which
+ * lets a replacement rank rebuild the same ring during recover.
+ *
+ * Datasets encoded this way carry no ER sets, so they cannot be
+ * rebuilt by the scavenge tools, the recover path here is the one
+ * that understands the format. */
+
+#include "scr_globals.h"
+
+/* keys used in the partner map file */
+#define SCR_PARTNER_KEY_SRC  ("SRC")
+#define SCR_PARTNER_KEY_FILE ("FILE")
+#define SCR_PARTNER_KEY_PATH ("PATH")
+#define SCR_PARTNER_KEY_SIZE ("SIZE")
+
+/* build path to the partner map file this rank writes in the given
+ * hidden directory, caller must free */
+static char* scr_partner_map_file(const char* dir)
+{
+  spath* path = spath_from_str(dir);
+  spath_append_strf(path, "partner.%d.scr", scr_my_rank_world);
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* build path to the copy of entry i that this rank holds for the
+ * given source rank, caller must free */
+static char* scr_partner_copy_file(const char* dir, int src_rank, int i)
+{
+  spath* path = spath_from_str(dir);
+  spath_append_strf(path, "partner.%d.%d", src_rank, i);
+  char* file = spath_strdup(path);
+  spath_delete(&path);
+  return file;
+}
+
+/* build the partner ring, splitting scr_comm_world so that adjacent
+ * ranks sit in different node failure groups, the construction is
+ * deterministic so recover can rebuild the same ring, caller must
+ * free the communicator */
+static int scr_partner_ring(
+  MPI_Comm* comm,
+  int* lhs_rank, int* lhs_world,
+  int* rhs_rank, int* rhs_world)
+{
+  /* put ranks with the same position within their node into the same
+   * communicator, ordered by world rank so neighbors are on
+   * different nodes */
+  const scr_groupdesc* groupdesc = scr_groupdescs_from_name(SCR_GROUP_NODE);
+  MPI_Comm_split(scr_comm_world, groupdesc->rank, scr_my_rank_world, comm);
+
+  /* find our left and right partners in the ring */
+  char* lhs_host = NULL;
+  char* rhs_host = NULL;
+  scr_set_partners(*comm, 1,
+    lhs_rank, lhs_world, &lhs_host,
+    rhs_rank, rhs_world, &rhs_host
+  );
+  scr_free(&lhs_host);
+  scr_free(&rhs_host);
+
+  return SCR_SUCCESS;
+}
+
+/* serialize a file list into a single string of the form
+ * "count\npath\nsize\n...", caller must free */
+static char* scr_partner_list_serialize(
+  int count,
+  char** paths,
+  const unsigned long* sizes)
+{
+  /* compute an upper bound on the string length */
+  size_t len = 32;
+  int i;
+  for (i = 0; i < count; i++) {
+    len += strlen(paths[i]) + 32;
+  }
+
+  /* write the count followed by each path and size */
+  char* str = (char*) SCR_MALLOC(len);
+  size_t off = (size_t) snprintf(str, len, "%d\n", count);
+  for (i = 0; i < count; i++) {
+    off += (size_t) snprintf(str + off, len - off, "%s\n%lu\n",
+      paths[i], sizes[i]
+    );
+  }
+
+  return str;
+}
+
+/* parse a string built by scr_partner_list_serialize, allocates and
+ * returns path and size arrays, caller must free each path and both
+ * arrays */
+static int scr_partner_list_parse(
+  const char* str,
+  int* count,
+  char*** paths,
+  unsigned long** sizes)
+{
+  *count = 0;
+  *paths = NULL;
+  *sizes = NULL;
+
+  /* read the entry count from the first line */
+  char* end = NULL;
+  int n = (int) strtol(str, &end, 10);
+  if (end == NULL || *end != '\n' || n < 0) {
+    return SCR_FAILURE;
+  }
+  const char* p = end + 1;
+
+  char** list_paths        = (char**) SCR_MALLOC(n * sizeof(char*));
+  unsigned long* list_sizes = (unsigned long*) SCR_MALLOC(n * sizeof(unsigned long));
+
+  /* read a path line and a size line for each entry */
+  int i;
+  for (i = 0; i < n; i++) {
+    const char* nl = strchr(p, '\n');
+    if (nl == NULL) {
+      break;
+    }
+    list_paths[i] = strndup(p, nl - p);
+    p = nl + 1;
+
+    list_sizes[i] = strtoul(p, &end, 10);
+    if (end == NULL || *end != '\n') {
+      scr_free(&list_paths[i]);
+      break;
+    }
+    p = end + 1;
+  }
+
+  /* fail if the string ran short */
+  if (i < n) {
+    while (i > 0) {
+      i--;
+      scr_free(&list_paths[i]);
+    }
+    scr_free(&list_paths);
+    scr_free(&list_sizes);
+    return SCR_FAILURE;
+  }
+
+  *count = n;
+  *paths = list_paths;
+  *sizes = list_sizes;
+  return SCR_SUCCESS;
+}
+
+/* state for reading a list of files as one concatenated byte stream */
+struct scr_partner_stream {
+  int count;            /* number of files in the list */
+  char** paths;         /* path of each file */
+  const unsigned long* sizes; /* size of each file */
+  int idx;              /* index of current file */
+  int fd;               /* descriptor of current file, -1 if none */
+  unsigned long left;   /* bytes left to move for current file */
+  int error;            /* set once any file operation fails */
+};
+
+static void scr_partner_stream_init(
+  struct scr_partner_stream* s,
+  int count, char** paths, const unsigned long* sizes)
+{
+  s->count = count;
+  s->paths = paths;
+  s->sizes = sizes;
+  s->idx   = 0;
+  s->fd    = -1;
+  s->left  = 0;
+  s->error = 0;
+}
+
+/* read the next chunk of up to size bytes from the stream into buf,
+ * crossing file boundaries as needed, returns bytes produced, on a
+ * read failure the remainder is zero-filled and error is set so the
+ * stream stays in lockstep with the receiver */
+static size_t scr_partner_stream_read(struct scr_partner_stream* s, char* buf, size_t size)
+{
+  size_t have = 0;
+  while (have < size) {
+    /* advance to the next file with bytes remaining */
+    if (s->left == 0) {
+      if (s->fd >= 0) {
+        scr_close(s->paths[s->idx], s->fd);
+        s->fd = -1;
+        s->idx++;
+      }
+      while (s->idx < s->count && s->sizes[s->idx] == 0) {
+        s->idx++;
+      }
+      if (s->idx >= s->count) {
+        break;
+      }
+      s->fd = scr_open(s->paths[s->idx], O_RDONLY);
+      if (s->fd < 0) {
+        scr_err("Opening file for partner copy: scr_open(%s) errno=%d %s @ %s:%d",
+          s->paths[s->idx], errno, strerror(errno), __FILE__, __LINE__
+        );
+        s->error = 1;
+      }
+      s->left = s->sizes[s->idx];
+    }
+
+    /* read as much of the current file as fits in the buffer */
+    size_t count = size - have;
+    if (count > s->left) {
+      count = (size_t) s->left;
+    }
+    if (s->fd >= 0) {
+      ssize_t nread = scr_read_attempt(s->paths[s->idx], s->fd, buf + have, count);
+      if (nread < 0 || (size_t) nread != count) {
+        s->error = 1;
+      }
+    }
+    if (s->error) {
+      /* keep the byte stream aligned for the receiver */
+      memset(buf + have, 0, count);
+    }
+    have += count;
+    s->left -= count;
+  }
+  return have;
+}
+
+/* write the next chunk of size bytes from buf into the stream,
+ * crossing file boundaries as needed */
+static void scr_partner_stream_write(struct scr_partner_stream* s, const char* buf, size_t size)
+{
+  size_t used = 0;
+  while (used < size) {
+    /* advance to the next file with bytes remaining */
+    if (s->left == 0) {
+      if (s->fd >= 0) {
+        scr_close(s->paths[s->idx], s->fd);
+        s->fd = -1;
+        s->idx++;
+      }
+      while (s->idx < s->count && s->sizes[s->idx] == 0) {
+        /* create empty files so zero-length entries exist as well */
+        int fd = scr_open(s->paths[s->idx], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+        if (fd >= 0) {
+          scr_close(s->paths[s->idx], fd);
+        } else {
+          s->error = 1;
+        }
+        s->idx++;
+      }
+      if (s->idx >= s->count) {
+        break;
+      }
+      s->fd = scr_open(s->paths[s->idx], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+      if (s->fd < 0) {
+        scr_err("Opening file for partner copy: scr_open(%s) errno=%d %s @ %s:%d",
+          s->paths[s->idx], errno, strerror(errno), __FILE__, __LINE__
+        );
+        s->error = 1;
+      }
+      s->left = s->sizes[s->idx];
+    }
+
+    /* write as much as belongs to the current file */
+    size_t count = size - used;
+    if (count > s->left) {
+      count = (size_t) s->left;
+    }
+    if (s->fd >= 0) {
+      ssize_t nwrite = scr_write_attempt(s->paths[s->idx], s->fd, buf + used, count);
+      if (nwrite < 0 || (size_t) nwrite != count) {
+        s->error = 1;
+      }
+    }
+    used += count;
+    s->left -= count;
+  }
+}
+
+/* close out a stream, returns SCR_SUCCESS if no operation failed */
+static int scr_partner_stream_fini(struct scr_partner_stream* s)
+{
+  if (s->fd >= 0) {
+    scr_close(s->paths[s->idx], s->fd);
+    s->fd = -1;
+  }
+  return s->error ? SCR_FAILURE : SCR_SUCCESS;
+}
+
+/* defined below, reads an existing partner map from the hidden dir */
+static int scr_partner_map_read(
+  const char* dir,
+  int* src_world,
+  int* count,
+  char*** copy_paths,
+  char*** orig_paths,
+  unsigned long** sizes);
+
+/* stream this rank's files into its right-hand partner's cache over
+ * an RMA window and record what we receive from our left-hand
+ * partner in our partner map, collective over scr_comm_world,
+ * when plan is set each rank first compares the incoming file list
+ * against the copies it already holds from a previous encode and the
+ * partners agree on a transfer plan before any data moves: entries
+ * whose copy is already in place move zero bytes and only the
+ * missing or stale entries are streamed */
+static int scr_partner_encode(
+  int count,
+  char** paths,
+  const unsigned long* sizes,
+  const char* dir,
+  int plan)
+{
+  int rc = SCR_SUCCESS;
+
+  /* build the cross-node partner ring */
+  MPI_Comm comm;
+  int lhs_rank, lhs_world, rhs_rank, rhs_world;
+  scr_partner_ring(&comm, &lhs_rank, &lhs_world, &rhs_rank, &rhs_world);
+
+  /* tell our right-hand partner what we're about to send,
+   * and learn what our left-hand partner will send us */
+  char* out_meta = scr_partner_list_serialize(count, paths, sizes);
+  char* in_meta  = NULL;
+  scr_str_sendrecv(out_meta, rhs_rank, &in_meta, lhs_rank, comm);
+  scr_free(&out_meta);
+
+  int in_count = 0;
+  char** in_paths = NULL;
+  unsigned long* in_sizes = NULL;
+  if (scr_partner_list_parse(in_meta, &in_count, &in_paths, &in_sizes) != SCR_SUCCESS) {
+    scr_err("Failed to parse partner file list @ %s:%d",
+      __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+    in_count = 0;
+  }
+  scr_free(&in_meta);
+
+  /* name the copy file each incoming entry lands in */
+  char** copy_paths = (char**) SCR_MALLOC(in_count * sizeof(char*));
+  int i;
+  for (i = 0; i < in_count; i++) {
+    copy_paths[i] = scr_partner_copy_file(dir, lhs_world, i);
+  }
+
+  /* with planning enabled, match the incoming list against the copies
+   * we already hold from a previous encode, a copy counts when its
+   * original path and size agree and the copy file itself is intact,
+   * kept copies are moved to their new index through a temporary name
+   * first since the entry order may have shifted */
+  char* in_mask = (char*) SCR_MALLOC(in_count + 2);
+  for (i = 0; i < in_count; i++) {
+    in_mask[i] = '0';
+  }
+  in_mask[in_count]     = '\n';
+  in_mask[in_count + 1] = '\0';
+  if (plan && rc == SCR_SUCCESS) {
+    int old_src, old_count;
+    char** old_copies;
+    char** old_origs;
+    unsigned long* old_sizes;
+    if (scr_partner_map_read(dir, &old_src, &old_count,
+        &old_copies, &old_origs, &old_sizes) == SCR_SUCCESS)
+    {
+      if (old_src == lhs_world) {
+        /* pair each incoming entry with at most one held copy */
+        int j;
+        int* match = (int*) SCR_MALLOC(in_count * sizeof(int));
+        char* used = (char*) SCR_MALLOC(old_count);
+        memset(used, 0, old_count);
+        for (i = 0; i < in_count; i++) {
+          match[i] = -1;
+          for (j = 0; j < old_count; j++) {
+            if (!used[j] &&
+                old_origs[j] != NULL &&
+                strcmp(old_origs[j], in_paths[i]) == 0 &&
+                old_sizes[j] == in_sizes[i] &&
+                scr_file_is_readable(old_copies[j]) == SCR_SUCCESS &&
+                scr_file_size(old_copies[j]) == in_sizes[i])
+            {
+              match[i] = j;
+              used[j] = 1;
+              break;
+            }
+          }
+        }
+
+        /* stage kept copies under temporary names so an old index
+         * is never overwritten before its own entry has moved */
+        for (i = 0; i < in_count; i++) {
+          if (match[i] >= 0) {
+            size_t len = strlen(old_copies[match[i]]) + strlen(".keep") + 1;
+            char* tmp = (char*) SCR_MALLOC(len);
+            snprintf(tmp, len, "%s.keep", old_copies[match[i]]);
+            if (rename(old_copies[match[i]], tmp) != 0) {
+              match[i] = -1;
+            }
+            scr_free(&tmp);
+          }
+        }
+        for (i = 0; i < in_count; i++) {
+          if (match[i] >= 0) {
+            size_t len = strlen(old_copies[match[i]]) + strlen(".keep") + 1;
+            char* tmp = (char*) SCR_MALLOC(len);
+            snprintf(tmp, len, "%s.keep", old_copies[match[i]]);
+            if (rename(tmp, copy_paths[i]) == 0) {
+              in_mask[i] = '1';
+            }
+            scr_free(&tmp);
+          }
+        }
+        scr_free(&used);
+        scr_free(&match);
+      }
+
+      for (i = 0; i < old_count; i++) {
+        scr_free(&old_copies[i]);
+        scr_free(&old_origs[i]);
+      }
+      scr_free(&old_copies);
+      scr_free(&old_origs);
+      scr_free(&old_sizes);
+    }
+  }
+
+  /* tell our left-hand partner which of its entries we already hold,
+   * and learn which of ours our right-hand partner kept, this settles
+   * the transfer plan before any data moves */
+  char* out_mask = NULL;
+  if (plan) {
+    scr_str_sendrecv(in_mask, lhs_rank, &out_mask, rhs_rank, comm);
+  }
+
+  /* expose a landing buffer to our left-hand partner */
+  size_t bufsize = scr_file_buf_size;
+  char* winbuf = NULL;
+  MPI_Win win;
+  MPI_Win_allocate((MPI_Aint) bufsize, 1, MPI_INFO_NULL, comm, &winbuf, &win);
+
+  /* and grab a staging buffer for our outgoing chunks */
+  char* sendbuf = (char*) scr_buf_get(bufsize);
+
+  /* drop planned-out entries from the byte streams, they still show
+   * up in the metadata exchange above and in the partner map below */
+  int send_count = 0;
+  char** send_paths         = (char**) SCR_MALLOC(count * sizeof(char*));
+  unsigned long* send_sizes = (unsigned long*) SCR_MALLOC(count * sizeof(unsigned long));
+  unsigned long out_total   = 0;
+  unsigned long out_skipped = 0;
+  for (i = 0; i < count; i++) {
+    if (out_mask != NULL && strlen(out_mask) > (size_t) count && out_mask[i] == '1') {
+      out_skipped += sizes[i];
+      continue;
+    }
+    send_paths[send_count] = paths[i];
+    send_sizes[send_count] = sizes[i];
+    out_total += sizes[i];
+    send_count++;
+  }
+
+  int recv_count = 0;
+  char** recv_paths         = (char**) SCR_MALLOC(in_count * sizeof(char*));
+  unsigned long* recv_sizes = (unsigned long*) SCR_MALLOC(in_count * sizeof(unsigned long));
+  unsigned long in_total = 0;
+  for (i = 0; i < in_count; i++) {
+    if (in_mask[i] == '1') {
+      continue;
+    }
+    recv_paths[recv_count] = copy_paths[i];
+    recv_sizes[recv_count] = in_sizes[i];
+    in_total += in_sizes[i];
+    recv_count++;
+  }
+
+  /* report how much of the refresh the plan saved */
+  if (plan) {
+    unsigned long my_bytes[2] = { out_total, out_skipped };
+    unsigned long sum_bytes[2];
+    MPI_Allreduce(my_bytes, sum_bytes, 2, MPI_UNSIGNED_LONG, MPI_SUM, scr_comm_world);
+    if (scr_my_rank_world == 0) {
+      scr_dbg(1, "Partner refresh plan: %lu bytes to move, %lu bytes already in place",
+        sum_bytes[0], sum_bytes[1]
+      );
+    }
+  }
+
+  /* total rounds of lockstep fence epochs, everyone in the ring
+   * advances through them together */
+  unsigned long my_rounds = (out_total + bufsize - 1) / bufsize;
+  unsigned long in_rounds = (in_total + bufsize - 1) / bufsize;
+  if (in_rounds > my_rounds) {
+    my_rounds = in_rounds;
+  }
+  unsigned long rounds;
+  MPI_Allreduce(&my_rounds, &rounds, 1, MPI_UNSIGNED_LONG, MPI_MAX, comm);
+
+  /* walk both byte streams a window at a time */
+  struct scr_partner_stream out_stream, in_stream;
+  scr_partner_stream_init(&out_stream, send_count, send_paths, send_sizes);
+  scr_partner_stream_init(&in_stream, recv_count, recv_paths, recv_sizes);
+
+  unsigned long out_left = out_total;
+  unsigned long in_left  = in_total;
+  MPI_Win_fence(0, win);
+  unsigned long r;
+  for (r = 0; r < rounds; r++) {
+    /* push our next chunk into our partner's window */
+    size_t n = (size_t) bufsize;
+    if ((unsigned long) n > out_left) {
+      n = (size_t) out_left;
+    }
+    if (n > 0) {
+      scr_partner_stream_read(&out_stream, sendbuf, n);
+      MPI_Put(sendbuf, (int) n, MPI_BYTE, rhs_rank, 0, (int) n, MPI_BYTE, win);
+      out_left -= n;
+    }
+
+    /* wait for the chunk headed our way to land */
+    MPI_Win_fence(0, win);
+
+    /* drain our window to disk */
+    size_t m = (size_t) bufsize;
+    if ((unsigned long) m > in_left) {
+      m = (size_t) in_left;
+    }
+    if (m > 0) {
+      scr_partner_stream_write(&in_stream, winbuf, m);
+      in_left -= m;
+    }
+
+    /* hold the next round of puts until our window is free again */
+    MPI_Win_fence(0, win);
+  }
+
+  if (scr_partner_stream_fini(&out_stream) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+  if (scr_partner_stream_fini(&in_stream) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  scr_buf_put(sendbuf);
+  MPI_Win_free(&win);
+
+  /* record what we hold and where it came from */
+  if (rc == SCR_SUCCESS) {
+    kvtree* hash = kvtree_new();
+    kvtree_util_set_int(hash, SCR_PARTNER_KEY_SRC, lhs_world);
+    for (i = 0; i < in_count; i++) {
+      spath* name = spath_from_str(copy_paths[i]);
+      spath_basename(name);
+      char* base = spath_strdup(name);
+      spath_delete(&name);
+
+      kvtree* entry = kvtree_set_kv(hash, SCR_PARTNER_KEY_FILE, base);
+      kvtree_util_set_str(entry, SCR_PARTNER_KEY_PATH, in_paths[i]);
+      kvtree_util_set_unsigned_long(entry, SCR_PARTNER_KEY_SIZE, in_sizes[i]);
+      scr_free(&base);
+    }
+
+    char* map_file = scr_partner_map_file(dir);
+    if (kvtree_write_file(map_file, hash) != KVTREE_SUCCESS) {
+      scr_err("Failed to write partner map %s @ %s:%d",
+        map_file, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+    scr_free(&map_file);
+    kvtree_delete(&hash);
+  }
+
+  /* free the stream lists, their entries are borrowed */
+  scr_free(&send_paths);
+  scr_free(&send_sizes);
+  scr_free(&recv_paths);
+  scr_free(&recv_sizes);
+  scr_free(&in_mask);
+  scr_free(&out_mask);
+
+  /* free incoming lists */
+  for (i = 0; i < in_count; i++) {
+    scr_free(&in_paths[i]);
+    scr_free(&copy_paths[i]);
+  }
+  scr_free(&in_paths);
+  scr_free(&in_sizes);
+  scr_free(&copy_paths);
+
+  MPI_Comm_free(&comm);
+
+  /* everyone succeeds or everyone fails */
+  if (! scr_alltrue(rc == SCR_SUCCESS, scr_comm_world)) {
+    rc = SCR_FAILURE;
+  }
+  return rc;
+}
+
+/* collect the list of files to protect for this dataset,
+ * the filemap itself rides along as the last entry so a replacement
+ * rank can recover its metadata too, for bypass datasets only the
+ * filemap is copied since the data lives in the prefix directory */
+static int scr_partner_filelist(
+  scr_filemap* map,
+  int bypass,
+  int id,
+  int* out_count,
+  char*** out_paths,
+  unsigned long** out_sizes)
+{
+  /* count the files we'll copy */
+  int count = 1;
+  if (! bypass) {
+    count += scr_filemap_num_files(map);
+  }
+
+  char** paths         = (char**) SCR_MALLOC(count * sizeof(char*));
+  unsigned long* sizes = (unsigned long*) SCR_MALLOC(count * sizeof(unsigned long));
+
+  int n = 0;
+  if (! bypass) {
+    kvtree_elem* file_elem;
+    for (file_elem = scr_filemap_first_file(map);
+         file_elem != NULL;
+         file_elem = kvtree_elem_next(file_elem))
+    {
+      char* file = kvtree_elem_key(file_elem);
+      paths[n] = strdup(file);
+      sizes[n] = scr_file_size(file);
+      n++;
+    }
+  }
+
+  /* append the filemap file */
+  const char* map_file = scr_cache_get_map_file(scr_cindex, id);
+  paths[n] = strdup(map_file);
+  sizes[n] = scr_file_size(map_file);
+  n++;
+  scr_free(&map_file);
+
+  *out_count = n;
+  *out_paths = paths;
+  *out_sizes = sizes;
+  return SCR_SUCCESS;
+}
+
+static void scr_partner_filelist_free(int count, char*** paths, unsigned long** sizes)
+{
+  int i;
+  for (i = 0; i < count; i++) {
+    scr_free(&(*paths)[i]);
+  }
+  scr_free(paths);
+  scr_free(sizes);
+}
+
+/* stream this rank's files for the dataset into its partner's cache,
+ * called in place of the ER encode, collective over scr_comm_world */
+int scr_partner_apply(scr_filemap* map, const scr_reddesc* desc, int id)
+{
+  /* start timer */
+  time_t timestamp_start;
+  double time_start;
+  if (scr_my_rank_world == 0) {
+    timestamp_start = scr_log_seconds();
+    time_start = MPI_Wtime();
+  }
+
+  /* get hidden directory where copies and the partner map live */
+  const char* dir_hidden = scr_cache_dir_hidden_get(desc, id);
+
+  /* gather the list of files to copy */
+  int count;
+  char** paths;
+  unsigned long* sizes;
+  scr_partner_filelist(map, desc->bypass, id, &count, &paths, &sizes);
+
+  /* sum bytes for the performance report */
+  unsigned long my_bytes = 0;
+  int i;
+  for (i = 0; i < count; i++) {
+    my_bytes += sizes[i];
+  }
+  unsigned long total_bytes;
+  MPI_Allreduce(&my_bytes, &total_bytes, 1, MPI_UNSIGNED_LONG, MPI_SUM, scr_comm_world);
+
+  /* stream the files to our partner */
+  int rc = scr_partner_encode(count, paths, sizes, dir_hidden, 0);
+
+  scr_partner_filelist_free(count, &paths, &sizes);
+  scr_free(&dir_hidden);
+
+  /* stop timer and report performance info */
+  if (scr_my_rank_world == 0) {
+    double bytes = (double) total_bytes;
+    double time_end = MPI_Wtime();
+    double time_diff = time_end - time_start;
+    double bw = 0.0;
+    if (time_diff > 0.0) {
+      bw = bytes / (1024.0 * 1024.0 * time_diff);
+    }
+    scr_dbg(1, "scr_partner_apply: %f secs, %e bytes, %f MB/s, %f MB/s per proc",
+      time_diff, bytes, bw, bw/scr_ranks_world
+    );
+
+    /* log data on the copy in the database */
+    if (scr_log_enable) {
+      int files = count;
+      scr_log_transfer("ENCODE", desc->base, desc->directory, &id, NULL, &timestamp_start, &time_diff, &bytes, &files);
+    }
+  }
+
+  return rc;
+}
+
+/* returns 1 if the dataset in the given hidden directory was encoded
+ * with the native partner mode, collective over scr_comm_world,
+ * a surviving rank carries a partner map file, ER-encoded datasets
+ * have none anywhere */
+int scr_partner_detect(const char* dir)
+{
+  char* map_file = scr_partner_map_file(dir);
+  int have = (scr_file_is_readable(map_file) == SCR_SUCCESS) ? 1 : 0;
+  scr_free(&map_file);
+
+  int any;
+  MPI_Allreduce(&have, &any, 1, MPI_INT, MPI_MAX, scr_comm_world);
+  return any;
+}
+
+/* read this rank's partner map if it exists, returns the source
+ * world rank and entry lists ordered by copy index, copy paths are
+ * full paths into the hidden directory */
+static int scr_partner_map_read(
+  const char* dir,
+  int* src_world,
+  int* count,
+  char*** copy_paths,
+  char*** orig_paths,
+  unsigned long** sizes)
+{
+  *src_world  = -1;
+  *count      = 0;
+  *copy_paths = NULL;
+  *orig_paths = NULL;
+  *sizes      = NULL;
+
+  char* map_file = scr_partner_map_file(dir);
+  kvtree* hash = kvtree_new();
+  int rc = kvtree_read_file(map_file, hash);
+  scr_free(&map_file);
+  if (rc != KVTREE_SUCCESS) {
+    kvtree_delete(&hash);
+    return SCR_FAILURE;
+  }
+
+  kvtree_util_get_int(hash, SCR_PARTNER_KEY_SRC, src_world);
+
+  kvtree* files = kvtree_get(hash, SCR_PARTNER_KEY_FILE);
+  int n = kvtree_size(files);
+  char** copies        = (char**) SCR_MALLOC(n * sizeof(char*));
+  char** origs         = (char**) SCR_MALLOC(n * sizeof(char*));
+  unsigned long* sz    = (unsigned long*) SCR_MALLOC(n * sizeof(unsigned long));
+
+  /* entries are keyed by copy name partner.<rank>.<i>,
+   * recover order matters only for the stream, so index by i */
+  int valid = 1;
+  int i;
+  for (i = 0; i < n; i++) {
+    copies[i] = NULL;
+    origs[i]  = NULL;
+    sz[i]     = 0;
+  }
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(files);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    const char* name = kvtree_elem_key(elem);
+
+    /* parse the copy index from the trailing component */
+    const char* dot = strrchr(name, '.');
+    int idx = (dot != NULL) ? atoi(dot + 1) : -1;
+    if (idx < 0 || idx >= n || copies[idx] != NULL) {
+      valid = 0;
+      break;
+    }
+
+    spath* path = spath_from_str(dir);
+    spath_append_str(path, name);
+    copies[idx] = spath_strdup(path);
+    spath_delete(&path);
+
+    kvtree* entry = kvtree_elem_hash(elem);
+    char* orig = NULL;
+    kvtree_util_get_str(entry, SCR_PARTNER_KEY_PATH, &orig);
+    origs[idx] = (orig != NULL) ? strdup(orig) : NULL;
+    kvtree_util_get_unsigned_long(entry, SCR_PARTNER_KEY_SIZE, &sz[idx]);
+    if (origs[idx] == NULL) {
+      valid = 0;
+      break;
+    }
+  }
+  kvtree_delete(&hash);
+
+  if (! valid) {
+    for (i = 0; i < n; i++) {
+      scr_free(&copies[i]);
+      scr_free(&origs[i]);
+    }
+    scr_free(&copies);
+    scr_free(&origs);
+    scr_free(&sz);
+    return SCR_FAILURE;
+  }
+
+  *count      = n;
+  *copy_paths = copies;
+  *orig_paths = origs;
+  *sizes      = sz;
+  return SCR_SUCCESS;
+}
+
+/* stream requested entries point-to-point, sending to our left-hand
+ * partner (the owner of the copies we hold) while receiving from our
+ * right-hand partner, nonblocking pairs keep the ring from
+ * deadlocking, this is the rare rebuild path so it uses plain
+ * send-recv rather than the RMA fast path */
+static int scr_partner_exchange(
+  MPI_Comm comm, int lhs_rank, int rhs_rank,
+  struct scr_partner_stream* out_stream, unsigned long out_total,
+  struct scr_partner_stream* in_stream, unsigned long in_total)
+{
+  size_t bufsize = scr_file_buf_size;
+  char* sendbuf = (char*) scr_buf_get(bufsize);
+  char* recvbuf = (char*) scr_buf_get(bufsize);
+
+  unsigned long out_rounds = (out_total + bufsize - 1) / bufsize;
+  unsigned long in_rounds  = (in_total + bufsize - 1) / bufsize;
+  unsigned long rounds = (out_rounds > in_rounds) ? out_rounds : in_rounds;
+
+  unsigned long out_left = out_total;
+  unsigned long in_left  = in_total;
+  unsigned long r;
+  for (r = 0; r < rounds; r++) {
+    MPI_Request request[2];
+    int k = 0;
+
+    /* post the receive for our next chunk */
+    size_t m = (size_t) bufsize;
+    if ((unsigned long) m > in_left) {
+      m = (size_t) in_left;
+    }
+    if (m > 0) {
+      MPI_Irecv(recvbuf, (int) m, MPI_BYTE, rhs_rank, 0, comm, &request[k]);
+      k++;
+    }
+
+    /* send our next chunk to the owner */
+    size_t n = (size_t) bufsize;
+    if ((unsigned long) n > out_left) {
+      n = (size_t) out_left;
+    }
+    if (n > 0) {
+      scr_partner_stream_read(out_stream, sendbuf, n);
+      MPI_Isend(sendbuf, (int) n, MPI_BYTE, lhs_rank, 0, comm, &request[k]);
+      k++;
+      out_left -= n;
+    }
+
+    MPI_Waitall(k, request, MPI_STATUSES_IGNORE);
+
+    if (m > 0) {
+      scr_partner_stream_write(in_stream, recvbuf, m);
+      in_left -= m;
+    }
+  }
+
+  scr_buf_put(sendbuf);
+  scr_buf_put(recvbuf);
+  return SCR_SUCCESS;
+}
+
+/* restore missing files from partner copies and refresh the copies
+ * afterwards, collective over scr_comm_world */
+int scr_partner_recover(scr_cache_index* cindex, int id, const char* dir)
+{
+  int rc = SCR_SUCCESS;
+
+  /* rebuild the same ring used during the encode */
+  MPI_Comm comm;
+  int lhs_rank, lhs_world, rhs_rank, rhs_world;
+  scr_partner_ring(&comm, &lhs_rank, &lhs_world, &rhs_rank, &rhs_world);
+
+  /* read the partner map describing what we hold for our left-hand
+   * partner, a replacement rank has none */
+  int src_world, hold_count;
+  char** hold_copies = NULL;
+  char** hold_origs  = NULL;
+  unsigned long* hold_sizes = NULL;
+  int have_map = (scr_partner_map_read(dir, &src_world, &hold_count,
+    &hold_copies, &hold_origs, &hold_sizes) == SCR_SUCCESS);
+
+  /* sanity check that the ring we rebuilt matches the one recorded
+   * during the encode */
+  if (have_map && src_world != lhs_world) {
+    scr_err("Partner map source rank %d does not match ring partner %d @ %s:%d",
+      src_world, lhs_world, __FILE__, __LINE__
+    );
+    have_map = 0;
+  }
+
+  /* tell the owner what we hold for it, learn what our partner holds
+   * for us, a rank without a map reports an empty list */
+  char* out_meta;
+  if (have_map) {
+    out_meta = scr_partner_list_serialize(hold_count, hold_origs, hold_sizes);
+  } else {
+    out_meta = strdup("0\n");
+  }
+  char* in_meta = NULL;
+  scr_str_sendrecv(out_meta, lhs_rank, &in_meta, rhs_rank, comm);
+  scr_free(&out_meta);
+
+  int my_count = 0;
+  char** my_paths = NULL;
+  unsigned long* my_sizes = NULL;
+  if (scr_partner_list_parse(in_meta, &my_count, &my_paths, &my_sizes) != SCR_SUCCESS) {
+    my_count = 0;
+  }
+  scr_free(&in_meta);
+
+  /* decide which of our files need to come back,
+   * a file is missing if it's absent or the wrong size */
+  char* my_mask = (char*) SCR_MALLOC(my_count + 2);
+  unsigned long my_need = 0;
+  int i;
+  for (i = 0; i < my_count; i++) {
+    int have = (access(my_paths[i], R_OK) == 0 &&
+      scr_file_size(my_paths[i]) == my_sizes[i]);
+    my_mask[i] = have ? '0' : '1';
+    if (! have) {
+      my_need += my_sizes[i];
+    }
+  }
+  my_mask[my_count] = '\n';
+  my_mask[my_count + 1] = '\0';
+
+  /* swap request masks with our partners */
+  char* lhs_mask = NULL;
+  scr_str_sendrecv(my_mask, rhs_rank, &lhs_mask, lhs_rank, comm);
+
+  /* build the outgoing stream of copies our left-hand partner wants */
+  int out_count = 0;
+  char** out_paths = (char**) SCR_MALLOC(hold_count * sizeof(char*));
+  unsigned long* out_sizes = (unsigned long*) SCR_MALLOC(hold_count * sizeof(unsigned long));
+  unsigned long out_total = 0;
+  if (have_map && lhs_mask != NULL && strlen(lhs_mask) > (size_t) hold_count) {
+    for (i = 0; i < hold_count; i++) {
+      if (lhs_mask[i] == '1') {
+        out_paths[out_count] = hold_copies[i];
+        out_sizes[out_count] = hold_sizes[i];
+        out_total += hold_sizes[i];
+        out_count++;
+      }
+    }
+  }
+  scr_free(&lhs_mask);
+
+  /* and the incoming stream of our own missing files,
+   * create any missing parent directories first */
+  int in_count = 0;
+  char** in_paths = (char**) SCR_MALLOC(my_count * sizeof(char*));
+  unsigned long* in_sizes = (unsigned long*) SCR_MALLOC(my_count * sizeof(unsigned long));
+  for (i = 0; i < my_count; i++) {
+    if (my_mask[i] == '1') {
+      spath* parent = spath_from_str(my_paths[i]);
+      spath_dirname(parent);
+      char* parent_str = spath_strdup(parent);
+      spath_delete(&parent);
+      scr_mkdir(parent_str, S_IRWXU);
+      scr_free(&parent_str);
+
+      in_paths[in_count] = my_paths[i];
+      in_sizes[in_count] = my_sizes[i];
+      in_count++;
+    }
+  }
+  scr_free(&my_mask);
+
+  /* stream the bytes around the ring */
+  struct scr_partner_stream out_stream, in_stream;
+  scr_partner_stream_init(&out_stream, out_count, out_paths, out_sizes);
+  scr_partner_stream_init(&in_stream, in_count, in_paths, in_sizes);
+  scr_partner_exchange(comm, lhs_rank, rhs_rank,
+    &out_stream, out_total, &in_stream, my_need
+  );
+  if (scr_partner_stream_fini(&out_stream) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+  if (scr_partner_stream_fini(&in_stream) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  scr_free(&out_paths);
+  scr_free(&out_sizes);
+  scr_free(&in_paths);
+  scr_free(&in_sizes);
+
+  for (i = 0; i < my_count; i++) {
+    scr_free(&my_paths[i]);
+  }
+  scr_free(&my_paths);
+  scr_free(&my_sizes);
+
+  if (have_map) {
+    for (i = 0; i < hold_count; i++) {
+      scr_free(&hold_copies[i]);
+      scr_free(&hold_origs[i]);
+    }
+  }
+  scr_free(&hold_copies);
+  scr_free(&hold_origs);
+  scr_free(&hold_sizes);
+
+  MPI_Comm_free(&comm);
+
+  /* verify against our filemap that we now have all of our files,
+   * a rank that lost both its files and its partner's copy of them
+   * cannot know what it's missing, but then its filemap is also
+   * gone and this check fails */
+  const char* map_file = scr_cache_get_map_file(cindex, id);
+  if (scr_file_is_readable(map_file) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  } else if (rc == SCR_SUCCESS) {
+    scr_filemap* map = scr_filemap_new();
+    scr_cache_get_map(cindex, id, map);
+    kvtree_elem* file_elem;
+    for (file_elem = scr_filemap_first_file(map);
+         file_elem != NULL;
+         file_elem = kvtree_elem_next(file_elem))
+    {
+      char* file = kvtree_elem_key(file_elem);
+      if (! scr_bool_have_file(map, file)) {
+        scr_dbg(2, "File determined to be invalid: %s", file);
+        rc = SCR_FAILURE;
+      }
+    }
+    scr_filemap_delete(&map);
+  }
+  scr_free(&map_file);
+
+  /* everyone succeeds or everyone fails */
+  if (! scr_alltrue(rc == SCR_SUCCESS, scr_comm_world)) {
+    return SCR_FAILURE;
+  }
+
+  /* re-run the encode so replacement ranks hold fresh copies and
+   * the dataset is fully protected again, the plan flag lets ranks
+   * whose partner already holds intact copies skip the bytes that
+   * never needed to move, which is most of them when only the
+   * rank-to-node mapping changed */
+  int bypass = 0;
+  scr_cache_index_get_bypass(cindex, id, &bypass);
+  scr_filemap* map = scr_filemap_new();
+  scr_cache_get_map(cindex, id, map);
+  int count;
+  char** paths;
+  unsigned long* sizes;
+  scr_partner_filelist(map, bypass, id, &count, &paths, &sizes);
+  rc = scr_partner_encode(count, paths, sizes, dir, 1);
+  scr_partner_filelist_free(count, &paths, &sizes);
+  scr_filemap_delete(&map);
+
+  return rc;
+}
+
+/* delete the partner copies this rank holds for the dataset */
+int scr_partner_unapply(int id, const char* dir)
+{
+  /* read our partner map to learn which copy files we hold */
+  int src_world, count;
+  char** copies = NULL;
+  char** origs  = NULL;
+  unsigned long* sizes = NULL;
+  if (scr_partner_map_read(dir, &src_world, &count,
+    &copies, &origs, &sizes) == SCR_SUCCESS)
+  {
+    int i;
+    for (i = 0; i < count; i++) {
+      scr_file_unlink(copies[i]);
+      scr_free(&copies[i]);
+      scr_free(&origs[i]);
+    }
+    scr_free(&copies);
+    scr_free(&origs);
+    scr_free(&sizes);
+  }
+
+  /* and drop the map itself */
+  char* map_file = scr_partner_map_file(dir);
+  scr_file_unlink(map_file);
+  scr_free(&map_file);
+
+  return SCR_SUCCESS;
+}
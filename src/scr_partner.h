@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_PARTNER_H
+#define SCR_PARTNER_H
+
+/* Native one-sided partner copy (see SCR_PARTNER_RMA).  When enabled
+ * for a PARTNER redundancy descriptor, each rank streams its dataset
+ * files (and its filemap) straight into a partner rank's cache over
+ * MPI RMA windows instead of handing them to the ER encode, avoiding
+ * the send-recv rendezvous and intermediate staging in that path.
+ * Partners are chosen round-robin across node failure groups. */
+
+/* stream this rank's files for the dataset into its partner's cache,
+ * called in place of the ER encode, collective over scr_comm_world */
+int scr_partner_apply(scr_filemap* map, const scr_reddesc* desc, int id);
+
+/* returns 1 if the dataset in the given hidden directory was encoded
+ * with the native partner mode, collective over scr_comm_world */
+int scr_partner_detect(const char* dir);
+
+/* restore missing files from partner copies and refresh the copies
+ * afterwards, collective over scr_comm_world */
+int scr_partner_recover(scr_cache_index* cindex, int id, const char* dir);
+
+/* delete the partner copies this rank holds for the dataset */
+int scr_partner_unapply(int id, const char* dir);
+
+#endif
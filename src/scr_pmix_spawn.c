@@ -137,12 +137,36 @@ static void errhandler_reg_callbk (pmix_status_t status,
 /* fence_helper declaration  */
 int fence_helper(void);
 
+/* maximum number of -L host groups accepted on the command line */
+#define MAX_SPAWN_HOSTS (128)
+static char *spawn_hosts[MAX_SPAWN_HOSTS];
+static int spawn_host_count = 0;
+
+/* tracks one outstanding non-blocking spawn request */
+struct spawn_request {
+        volatile int done;
+        pmix_status_t status;
+        char nspace[PMIX_MAX_NSLEN+1];
+};
+
+/* completion callback for a non-blocking spawn request */
+static void spawn_cb(pmix_status_t status, char nspace[], void *cbdata)
+{
+        struct spawn_request *req = (struct spawn_request *)cbdata;
+        req->status = status;
+        if(status == PMIX_SUCCESS && nspace != NULL){
+                strncpy(req->nspace, nspace, PMIX_MAX_NSLEN);
+        }
+        req->done = 1;
+}
+
 void print_usage(char *exe)
 {
         printf("Usage: %s [options] program_to_spawn [cmd line arguments for program_to_spawn]\n\
           options: -n <number of processing elements>\n\
                    -N <number of processing elements per node>\n\
-                   -L <node list in CSV format>\n\
+                   -L <node list in CSV format> - may be given multiple times,\
+                   each extra host group is spawned with its own concurrent spawn request\n\
                    -x <environment variable, e.g. 'PATH'> - export a specified environment variable THAT EXISTS IN THE CURRENT ENVIRONMENT to <program_to_spawn>\n\
                    -x SCR - check for any SCR environment variables in the current environment,\
                    and if they're defined, pass them to <program_to_spawn>\n\
@@ -276,6 +300,14 @@ int main(int argc, char **argv, const char **environ)
                 case 'L':
                         node_list = optarg;
                         host_to_use = node_list;
+                        /* each -L adds a host group, more than one group
+                         * triggers one concurrent spawn request per group */
+                        if(spawn_host_count >= MAX_SPAWN_HOSTS){
+                                printf("too many -L host groups, max is %d\n",
+                                       MAX_SPAWN_HOSTS);
+                                exit(1);
+                        }
+                        spawn_hosts[spawn_host_count++] = optarg;
                         if(verbose_print){
                                 printf("node_list = '%s'\n", node_list);
                         }
@@ -580,20 +612,136 @@ int main(int argc, char **argv, const char **environ)
         if(verbose_print){
                 printf("proc level info count: %d\n", proc_info_count);
         }
-        /* call spawn */
-        retval = PMIx_Spawn(job_info, job_info_count,
-                            spawned_app, 1, spawned_nsp);
+        if(spawn_host_count > 1){
+                /* more than one host group was given, issue one
+                 * non-blocking spawn request per group so all replacement
+                 * processes launch concurrently, a multi-node respawn then
+                 * takes roughly the time of a single-node respawn instead
+                 * of growing linearly with the number of lost nodes */
+                struct spawn_request *reqs = (struct spawn_request *)
+                        calloc(spawn_host_count, sizeof(struct spawn_request));
+                if(reqs == NULL){
+                        printf("error allocating memory for spawn requests\n");
+                        retval = PMIX_ERR_NOMEM;
+                        goto done;
+                }
 
-        if(verbose_print) {
-                printf("rank %d (host %s) just called spawn; spawned nspace: %s, retval:%d\n",
-                       main_proc.rank,
-                       hostn,
-                       spawned_nsp,
-                       retval);
+                pmix_app_t *apps = NULL;
+                PMIX_APP_CREATE(apps, spawn_host_count);
+
+                /* each app carries its own info array naming its host,
+                 * plus the stdout/stderr forwarding flags when debugging */
+                int per_info_count = 1;
+                if(verbose_print){
+                        per_info_count += 2;
+                }
+
+                int h;
+                for(h = 0; h < spawn_host_count; h++){
+                        pmix_info_t *pinfo = NULL;
+                        PMIX_INFO_CREATE(pinfo, per_info_count);
+                        int idx = 0;
+                        strncpy(pinfo[idx].key, PMIX_HOST, PMIX_MAX_KEYLEN);
+                        PMIX_VAL_SET(&(pinfo[idx].value), string,
+                                     spawn_hosts[h]);
+                        idx++;
+                        if(verbose_print){
+                                strncpy(pinfo[idx].key, PMIX_FWD_STDOUT,
+                                        PMIX_MAX_KEYLEN);
+                                PMIX_VAL_SET(&(pinfo[idx].value), flag, true);
+                                idx++;
+                                strncpy(pinfo[idx].key, PMIX_FWD_STDERR,
+                                        PMIX_MAX_KEYLEN);
+                                PMIX_VAL_SET(&(pinfo[idx].value), flag, true);
+                                idx++;
+                        }
+
+                        apps[h].maxprocs = number_of_clients;
+                        (void)asprintf(&apps[h].cmd, "%s", path_to_app);
+                        apps[h].argv = &argv[optind];
+                        apps[h].env = scr_environ;
+                        apps[h].info = pinfo;
+                        apps[h].ninfo = per_info_count;
+
+                        reqs[h].done = 0;
+                        reqs[h].status = PMIX_SUCCESS;
+                        rc = PMIx_Spawn_nb(job_info, job_info_count,
+                                           &apps[h], 1, spawn_cb, &reqs[h]);
+                        if(rc != PMIX_SUCCESS){
+                                /* record the failure, keep submitting the rest */
+                                reqs[h].status = rc;
+                                reqs[h].done = 1;
+                                error_helper(rc, spawn_hosts[h],
+                                             "error submitting spawn request");
+                        }
+                        else if(verbose_print){
+                                printf("submitted spawn request for host group '%s'\n",
+                                       spawn_hosts[h]);
+                        }
+                }
+
+                /* wait for all outstanding spawn requests to complete */
+                retval = PMIX_SUCCESS;
+                temp_counter = 0;
+                while(1){
+                        int pending = 0;
+                        for(h = 0; h < spawn_host_count; h++){
+                                if(!reqs[h].done){
+                                        pending = 1;
+                                }
+                        }
+                        if(!pending){
+                                break;
+                        }
+                        sleep(1);
+                        temp_counter++;
+                        if(temp_counter >= sleep_max){
+                                printf("timed out waiting for spawn requests\n");
+                                retval = PMIX_ERR_TIMEOUT;
+                                break;
+                        }
+                }
+
+                /* report per-host results */
+                for(h = 0; h < spawn_host_count; h++){
+                        if(reqs[h].done && reqs[h].status != PMIX_SUCCESS){
+                                error_helper(reqs[h].status, spawn_hosts[h],
+                                             "spawn request failed");
+                                retval = reqs[h].status;
+                        }
+                        else if(reqs[h].done && verbose_print){
+                                printf("spawned nspace '%s' on host group '%s'\n",
+                                       reqs[h].nspace, spawn_hosts[h]);
+                        }
+
+                        /* the argv and env arrays are shared across apps,
+                         * don't let PMIX_APP_FREE free them */
+                        apps[h].argv = NULL;
+                        apps[h].env = NULL;
+                }
+                PMIX_APP_FREE(apps, spawn_host_count);
+                free(reqs);
+
+                if(retval != PMIX_SUCCESS){
+                        goto done;
+                }
         }
-        if(retval != PMIX_SUCCESS){
-                error_helper(retval,  hostn, "error with spawn");
-                goto done;
+        else{
+                /* call spawn */
+                retval = PMIx_Spawn(job_info, job_info_count,
+                                    spawned_app, 1, spawned_nsp);
+
+                if(verbose_print) {
+                        printf("rank %d (host %s) just called spawn; spawned nspace: %s, retval:%d\n",
+                               main_proc.rank,
+                               hostn,
+                               spawned_nsp,
+                               retval);
+                }
+                if(retval != PMIX_SUCCESS){
+                        error_helper(retval,  hostn, "error with spawn");
+                        goto done;
+                }
         }
 
         /* TODO: TEMPORARY WORKAROUND TO WAIT FOR A SPAWNED PROCESS */
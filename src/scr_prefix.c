@@ -115,7 +115,30 @@ static int scr_prefix_delete_data(int id)
   }
 
   /* done with rank2file */
-  scr_free(&rank2file);  
+  scr_free(&rank2file);
+
+  /* when background delete is enabled, each rank renames its files
+   * into a private trash directory and hands that directory to the
+   * reaper, which overlaps the unlink work with whatever the
+   * application does next, the renames also empty the dataset
+   * directories so the rmdir pass below works unchanged */
+  char* trash_dir = NULL;
+  int trash_count = 0;
+  if (scr_delete_async) {
+    /* build name of our trash directory, each rank gets its own
+     * so background deletion is spread across all processes */
+    spath* trash_path = spath_from_str(scr_prefix_scr);
+    spath_append_strf(trash_path, "scr.trash.%d.%d", id, scr_my_rank_world);
+    trash_dir = spath_strdup(trash_path);
+    spath_delete(&trash_path);
+
+    /* create the trash directory,
+     * fall back to synchronous unlinks if that fails */
+    mode_t mode_dir = scr_getmode(1, 1, 1);
+    if (scr_mkdir(trash_dir, mode_dir) != SCR_SUCCESS) {
+      scr_free(&trash_dir);
+    }
+  }
 
   /* allocate list of file names */
   kvtree* files = kvtree_get(filelist, "FILE");
@@ -139,8 +162,20 @@ static int scr_prefix_delete_data(int id)
     spath_reduce(file_path);
     char* src_file = spath_strdup(file_path);
 
-    /* delete the file */
-    scr_file_unlink(src_file);
+    /* delete the file, if we have a trash directory we rename the
+     * file into it instead and let the reaper unlink it later */
+    if (trash_dir != NULL) {
+      size_t len = strlen(trash_dir) + 32;
+      char* trash_file = (char*) SCR_MALLOC(len);
+      snprintf(trash_file, len, "%s/f.%d", trash_dir, trash_count);
+      trash_count++;
+      if (rename(src_file, trash_file) != 0) {
+        scr_file_unlink(src_file);
+      }
+      scr_free(&trash_file);
+    } else {
+      scr_file_unlink(src_file);
+    }
 
     /* free file path string */
     scr_free(&src_file);
@@ -279,14 +314,22 @@ static int scr_prefix_delete_data(int id)
     scr_free(&depths);
   }
 
+  /* queue our trash directory for deletion in the background */
+  if (trash_dir != NULL) {
+    scr_reap_delete_dir(trash_dir);
+    scr_free(&trash_dir);
+  }
+
   /* done with the list of files */
   kvtree_delete(&filelist);
 
   return rc;
 }
 
-/* delete named dataset from the prefix directory */
-int scr_prefix_delete(int id, const char* name)
+/* delete named dataset from the prefix directory,
+ * updates the index file unless the caller asks to skip it,
+ * in which case the caller is responsible for the index */
+static int scr_prefix_delete_common(int id, const char* name, int update_index)
 {
   int rc = SCR_SUCCESS;
 
@@ -294,7 +337,7 @@ int scr_prefix_delete(int id, const char* name)
   if (scr_my_rank_world == 0) {
     scr_dbg(1, "Deleting dataset %d `%s' from `%s'", id, name, scr_prefix);
   }
-  
+
   /* first, delete user data files from prefix directory */
   scr_prefix_delete_data(id);
 
@@ -318,7 +361,9 @@ int scr_prefix_delete(int id, const char* name)
   }
 
   /* drop the entry from the index file */
-  scr_prefix_remove_index(name);
+  if (update_index) {
+    scr_prefix_remove_index(name);
+  }
 
   /* hold everyone until delete is complete */
   MPI_Barrier(scr_comm_world);
@@ -326,6 +371,12 @@ int scr_prefix_delete(int id, const char* name)
   return rc;
 }
 
+/* delete named dataset from the prefix directory */
+int scr_prefix_delete(int id, const char* name)
+{
+  return scr_prefix_delete_common(id, name, 1);
+}
+
 /* keep a sliding window of checkpoints in the prefix directory,
  * delete any pure checkpoints that fall outside of the window
  * defined by the given dataset id and the window width,
@@ -357,6 +408,7 @@ int scr_prefix_delete_sliding(int id, int window)
 
   /* iterate over all checkpoints in the prefix directory,
    * deleting any pure checkpoints that fall outside of the window */
+  int num_deleted = 0;
   int target_id = id;
   while (continue_deleting) {
     /* rank 0 determines the directory to fetch from */
@@ -403,21 +455,28 @@ int scr_prefix_delete_sliding(int id, int window)
       /* get name from rank 0 */
       scr_strn_bcast(target, sizeof(target), 0, scr_comm_world);
 
-      /* delete this dataset from the prefix directory */
-      scr_prefix_delete(target_id, target);
+      /* delete this dataset from the prefix directory,
+       * skip the per-dataset index update since we apply
+       * all removals to the index file in one write below */
+      scr_prefix_delete_common(target_id, target, 0);
 
       /* remove dataset from index hash */
       if (scr_my_rank_world == 0) {
         scr_index_remove(index_hash, target);
       }
+      num_deleted++;
     } else {
       /* ran out of checkpoints to consider */
       continue_deleting = 0;
     }
   }
 
-  /* delete the index hash */
+  /* write the updated index file once to drop all deleted datasets,
+   * then delete the index hash */
   if (scr_my_rank_world == 0) {
+    if (num_deleted > 0) {
+      scr_index_write(scr_prefix_path, index_hash);
+    }
     kvtree_delete(&index_hash);
   }
 
@@ -452,6 +511,7 @@ int scr_prefix_delete_all(void)
   }
 
   /* iterate and delete each dataset in the prefix directory */
+  int num_deleted = 0;
   while (continue_deleting) {
     /* rank 0 determines the directory to fetch from */
     int target_id;
@@ -469,21 +529,28 @@ int scr_prefix_delete_all(void)
       /* get name from rank 0 */
       scr_strn_bcast(target, sizeof(target), 0, scr_comm_world);
 
-      /* delete this dataset from the prefix directory */
-      scr_prefix_delete(target_id, target);
+      /* delete this dataset from the prefix directory,
+       * skip the per-dataset index update since we apply
+       * all removals to the index file in one write below */
+      scr_prefix_delete_common(target_id, target, 0);
 
       /* remove dataset from index hash */
       if (scr_my_rank_world == 0) {
         scr_index_remove(index_hash, target);
       }
+      num_deleted++;
     } else {
       /* ran out of checkpoints to consider */
       continue_deleting = 0;
     }
   }
 
-  /* delete the index hash */
+  /* write the updated index file once to drop all deleted datasets,
+   * then delete the index hash */
   if (scr_my_rank_world == 0) {
+    if (num_deleted > 0) {
+      scr_index_write(scr_prefix_path, index_hash);
+    }
     kvtree_delete(&index_hash);
   }
 
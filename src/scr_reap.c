@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Implements the background reclamation queue, see scr_reap.h.
+ * Directories are renamed onto the queue by the caller and unlinked
+ * file by file in a reaper thread, which keeps the cost of evicting
+ * a large dataset off the application's path. */
+
+#include "scr_conf.h"
+#include "scr.h"
+#include "scr_err.h"
+#include "scr_io.h"
+#include "scr_util.h"
+#include "scr_reap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* entry in the list of directories waiting to be deleted */
+struct scr_reap_item {
+  char* dir;                  /* trash name of the directory */
+  struct scr_reap_item* next; /* next item in the queue */
+};
+
+/* queue of directories to be deleted, protected by scr_reap_mutex */
+static struct scr_reap_item* scr_reap_head = NULL;
+static struct scr_reap_item* scr_reap_tail = NULL;
+
+/* set while the reaper thread is deleting a directory it has
+ * already popped from the queue, so drain knows to keep waiting */
+static int scr_reap_busy = 0;
+
+/* tells the reaper thread to exit once the queue is empty */
+static int scr_reap_quit = 0;
+
+/* reaper thread, started on first enqueue */
+static pthread_t scr_reap_thread;
+static int scr_reap_running = 0;
+
+static pthread_mutex_t scr_reap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scr_reap_cond = PTHREAD_COND_INITIALIZER;
+
+/* counter to build unique trash names within this process */
+static int scr_reap_count = 0;
+
+/* delete all items under dir and then dir itself,
+ * logs and continues past items it fails to delete */
+static int scr_reap_remove(const char* dir)
+{
+  int rc = SCR_SUCCESS;
+
+  /* scan over all items in the directory */
+  DIR* dirp = opendir(dir);
+  if (dirp == NULL) {
+    /* treat a missing directory as already deleted, since more than
+     * one process may queue overlapping trees for the same dataset */
+    if (errno == ENOENT) {
+      return SCR_SUCCESS;
+    }
+    scr_err("Failed to open directory for deletion: %s (errno=%d %s) @ %s:%d",
+      dir, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  struct dirent* de;
+  while ((de = readdir(dirp)) != NULL) {
+    char* name = de->d_name;
+
+    /* skip "." and ".." */
+    if (strcmp(name, ".")  == 0 ||
+        strcmp(name, "..") == 0)
+    {
+      continue;
+    }
+
+    /* got an item, build full path to it */
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char* item = (char*) SCR_MALLOC(len);
+    snprintf(item, len, "%s/%s", dir, name);
+
+    /* recurse into directories, unlink everything else,
+     * use lstat so we delete symlinks rather than follow them */
+    struct stat statbuf;
+    if (lstat(item, &statbuf) == 0 && S_ISDIR(statbuf.st_mode)) {
+      if (scr_reap_remove(item) != SCR_SUCCESS) {
+        rc = SCR_FAILURE;
+      }
+    } else {
+      scr_file_unlink(item);
+    }
+
+    scr_free(&item);
+  }
+
+  /* done deleting stuff from this directory */
+  closedir(dirp);
+
+  /* delete the directory itself */
+  if (scr_rmdir(dir) != SCR_SUCCESS) {
+    rc = SCR_FAILURE;
+  }
+
+  return rc;
+}
+
+/* reaper thread, pops directories off the queue and deletes them,
+ * exits once the queue is empty and quit has been set */
+static void* scr_reap_func(void* arg)
+{
+  pthread_mutex_lock(&scr_reap_mutex);
+  while (1) {
+    if (scr_reap_head != NULL) {
+      /* pop the head of the queue */
+      struct scr_reap_item* item = scr_reap_head;
+      scr_reap_head = item->next;
+      if (scr_reap_head == NULL) {
+        scr_reap_tail = NULL;
+      }
+
+      /* delete the directory without holding the lock */
+      scr_reap_busy = 1;
+      pthread_mutex_unlock(&scr_reap_mutex);
+
+      scr_dbg(2, "Reaping directory: %s", item->dir);
+      scr_reap_remove(item->dir);
+      scr_free(&item->dir);
+      scr_free(&item);
+
+      pthread_mutex_lock(&scr_reap_mutex);
+      scr_reap_busy = 0;
+
+      /* wake anyone waiting in drain */
+      pthread_cond_broadcast(&scr_reap_cond);
+    } else if (scr_reap_quit) {
+      /* queue is empty and we've been told to exit */
+      break;
+    } else {
+      /* queue is empty, wait for more work */
+      pthread_cond_wait(&scr_reap_cond, &scr_reap_mutex);
+    }
+  }
+  pthread_mutex_unlock(&scr_reap_mutex);
+  return NULL;
+}
+
+/* rename directory to a trash name and queue it for deletion by the
+ * background reaper thread, falls back to deleting the directory
+ * synchronously if the rename fails */
+int scr_reap_delete_dir(const char* dir)
+{
+  /* check that we got a directory name */
+  if (dir == NULL) {
+    return SCR_FAILURE;
+  }
+
+  /* build a unique trash name next to the directory so the rename
+   * stays within the same file system */
+  size_t len = strlen(dir) + 64;
+  char* trash = (char*) SCR_MALLOC(len);
+  snprintf(trash, len, "%s.reap.%d.%d", dir, (int) getpid(), scr_reap_count);
+  scr_reap_count++;
+
+  /* move the directory out of the way with a single rename */
+  if (rename(dir, trash) != 0) {
+    /* can't rename for some reason, delete it in place so we don't
+     * leave stale files in the store */
+    scr_warn("Failed to rename %s to %s, deleting synchronously (errno=%d %s) @ %s:%d",
+      dir, trash, errno, strerror(errno), __FILE__, __LINE__
+    );
+    scr_free(&trash);
+    return scr_reap_remove(dir);
+  }
+
+  /* build a queue item for the renamed directory */
+  struct scr_reap_item* item = (struct scr_reap_item*) SCR_MALLOC(sizeof(struct scr_reap_item));
+  item->dir  = trash;
+  item->next = NULL;
+
+  /* append item to the queue and wake the reaper */
+  pthread_mutex_lock(&scr_reap_mutex);
+  if (scr_reap_tail != NULL) {
+    scr_reap_tail->next = item;
+  } else {
+    scr_reap_head = item;
+  }
+  scr_reap_tail = item;
+
+  /* start the reaper thread on first use */
+  if (! scr_reap_running) {
+    if (pthread_create(&scr_reap_thread, NULL, &scr_reap_func, NULL) != 0) {
+      /* no thread, delete the directory ourselves */
+      scr_reap_head = NULL;
+      scr_reap_tail = NULL;
+      pthread_mutex_unlock(&scr_reap_mutex);
+
+      scr_warn("Failed to start reaper thread, deleting %s synchronously @ %s:%d",
+        trash, __FILE__, __LINE__
+      );
+      int rc = scr_reap_remove(item->dir);
+      scr_free(&item->dir);
+      scr_free(&item);
+      return rc;
+    }
+    scr_reap_running = 1;
+  }
+
+  pthread_cond_broadcast(&scr_reap_cond);
+  pthread_mutex_unlock(&scr_reap_mutex);
+
+  return SCR_SUCCESS;
+}
+
+/* wait until all queued directories have been deleted */
+int scr_reap_drain(void)
+{
+  pthread_mutex_lock(&scr_reap_mutex);
+  while (scr_reap_head != NULL || scr_reap_busy) {
+    pthread_cond_wait(&scr_reap_cond, &scr_reap_mutex);
+  }
+  pthread_mutex_unlock(&scr_reap_mutex);
+  return SCR_SUCCESS;
+}
+
+/* drain the queue and stop the reaper thread, called at finalize */
+int scr_reap_finish(void)
+{
+  /* tell the reaper to exit once the queue is empty */
+  pthread_mutex_lock(&scr_reap_mutex);
+  scr_reap_quit = 1;
+  pthread_cond_broadcast(&scr_reap_cond);
+  pthread_mutex_unlock(&scr_reap_mutex);
+
+  /* wait for the reaper to delete everything left in the queue */
+  if (scr_reap_running) {
+    pthread_join(scr_reap_thread, NULL);
+    scr_reap_running = 0;
+  }
+
+  /* allow the queue to be used again after a restart of the library */
+  scr_reap_quit = 0;
+
+  return SCR_SUCCESS;
+}
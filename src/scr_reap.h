@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_REAP_H
+#define SCR_REAP_H
+
+/* Background reclamation queue for directory trees.  A caller hands
+ * off a directory with scr_reap_delete_dir, which renames it to a
+ * unique trash name next to the original and queues it for a
+ * background thread to unlink, so eviction costs one rename on the
+ * calling thread.  The rename stays within the same file system and
+ * the trash name carries the pid, so a concurrent job sharing the
+ * store does not collide. */
+
+/* rename directory to a trash name and queue it for deletion by the
+ * background reaper thread, falls back to deleting the directory
+ * synchronously if the rename fails */
+int scr_reap_delete_dir(const char* dir);
+
+/* wait until all queued directories have been deleted */
+int scr_reap_drain(void);
+
+/* drain the queue and stop the reaper thread, called at finalize */
+int scr_reap_finish(void);
+
+#endif
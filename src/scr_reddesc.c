@@ -22,6 +22,10 @@
 
 #include "scr_globals.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 /*
 =========================================
 Redundancy descriptor functions
@@ -50,6 +54,7 @@ int scr_reddesc_init(scr_reddesc* d)
   d->base        = NULL;
   d->directory   = NULL;
   d->copy_type   = SCR_COPY_NULL;
+  d->encode_threads = 0;
   d->er_scheme   = -1;
 
   return SCR_SUCCESS;
@@ -158,6 +163,9 @@ int scr_reddesc_store_to_hash(const scr_reddesc* d, kvtree* hash)
     break;
   }
 
+  /* set the THREADS key */
+  kvtree_set_kv_int(hash, SCR_CONFIG_KEY_THREADS, d->encode_threads);
+
   return SCR_SUCCESS;
 }
 
@@ -271,8 +279,14 @@ int scr_reddesc_create_from_hash(
     );
   }
 
-  /* build the directory name */
-  spath* dir = spath_from_str(d->base);
+  /* build the directory name, on a multi-path store each rank's
+   * directory sits on its own stripe of the store so datasets
+   * spread across all of its devices */
+  const char* dirbase = d->base;
+  if (d->store_index >= 0 && d->store_index < scr_nstoredescs) {
+    dirbase = scr_storedesc_stripe_base(&scr_storedescs[d->store_index]);
+  }
+  spath* dir = spath_from_str(dirbase);
   spath_append_str(dir, scr_username);
   spath_append_strf(dir, "scr.%s", scr_jobid);
 //  spath_append_strf(dir, "index.%d", d->index);
@@ -311,6 +325,10 @@ int scr_reddesc_create_from_hash(
     }
   }
 
+  /* set the number of threads to use when computing the encoding */
+  d->encode_threads = scr_encode_threads;
+  kvtree_util_get_int(hash, SCR_CONFIG_KEY_THREADS, &(d->encode_threads));
+
   /* CONVENIENCE: if all ranks are on the same node, change
    * type to SINGLE, we do this so single-node jobs can run without
    * requiring the user to change the copy type */
@@ -534,9 +552,22 @@ int scr_reddesc_apply(
     my_counts[0] += 1;
     my_counts[1] += scr_file_size(file);
 
-    /* if crc_on_copy is set, compute crc and update meta file */
+    /* if crc_on_copy is set, compute crc and update meta file,
+     * skip the read-back when a crc was already folded in as the
+     * application streamed the file through SCR_Write */
     if (scr_crc_on_copy) {
-      scr_compute_crc(map, file);
+      int have_crc = 0;
+      scr_meta* meta = scr_meta_new();
+      if (scr_filemap_get_meta(map, file, meta) == SCR_SUCCESS) {
+        uLong crc;
+        if (scr_meta_get_crc32(meta, &crc) == SCR_SUCCESS) {
+          have_crc = 1;
+        }
+      }
+      scr_meta_delete(&meta);
+      if (! have_crc) {
+        scr_compute_crc(map, file);
+      }
     }
   }
 
@@ -561,6 +592,13 @@ int scr_reddesc_apply(
   /* get store descriptor for this redudancy scheme */
   scr_storedesc* store = scr_reddesc_get_store(desc);
 
+  /* with native one-sided partner copies enabled, stream our files
+   * and filemap straight into our partner's cache over RMA and skip
+   * the ER encode, see scr_partner.c */
+  if (scr_partner_rma && desc->copy_type == SCR_COPY_PARTNER) {
+    return scr_partner_apply(map, desc, id);
+  }
+
   /* first encode filemap files, need to capture multi-level storage
    * info (path in cache and path in prefix) in case of a rebuild on scavenge */
   int filemap_rc = scr_reddesc_apply_to_filemap(desc, id, store);
@@ -585,6 +623,15 @@ int scr_reddesc_apply(
   /* define path to er files */
   char* reddesc_dir = scr_reddesc_prefix(dir_hidden);
 
+#ifdef _OPENMP
+  /* the encode kernels live in the ER and redset libraries, when
+   * those are built with OpenMP this sets the size of the team
+   * they fork while computing the encoding */
+  if (desc->encode_threads > 0) {
+    omp_set_num_threads(desc->encode_threads);
+  }
+#endif
+
   /* create ER set */
   int set_id = ER_Create(scr_comm_world, store->comm, reddesc_dir, ER_DIRECTION_ENCODE, desc->er_scheme);
   if (set_id < 0) {
@@ -596,7 +643,7 @@ int scr_reddesc_apply(
   /* free directory path strings */
   scr_free(&reddesc_dir);
   scr_free(&dir_hidden);
- 
+
   /* step through each of my files for the specified dataset
    * to scan for any incomplete files */
   for (file_elem = scr_filemap_first_file(map);
@@ -717,6 +764,12 @@ int scr_reddesc_recover(scr_cache_index* cindex, int id, const char* dir)
   /* TODO: verify that everyone found a matching store descriptor */
   scr_storedesc* store = &scr_storedescs[store_index];
 
+  /* datasets encoded with the native partner mode carry partner map
+   * files instead of ER sets, recover those directly */
+  if (scr_partner_detect(dir)) {
+    return scr_partner_recover(cindex, id, dir);
+  }
+
   /* recover filemap files */
   char* reddesc_filemap = scr_reddesc_prefix_filemap(dir);
   if (scr_reddesc_er_recover(store->comm, reddesc_filemap) != SCR_SUCCESS) {
@@ -810,6 +863,12 @@ int scr_reddesc_unapply(const scr_cache_index* cindex, int id, const char* dir)
   /* TODO: verify that everyone found a matching store descriptor */
   scr_storedesc* store = &scr_storedescs[store_index];
 
+  /* datasets encoded with the native partner mode carry partner map
+   * files instead of ER sets, delete those directly */
+  if (scr_partner_detect(dir)) {
+    return scr_partner_unapply(id, dir);
+  }
+
   /* delete redundancy data for filemap files */
   char* reddesc_filemap = scr_reddesc_prefix_filemap(dir);
   if (scr_reddesc_er_unapply(store->comm, reddesc_filemap) != SCR_SUCCESS) {
@@ -55,6 +55,7 @@ typedef struct {
   char*    base;           /* base cache directory to use */
   char*    directory;      /* full directory base/dataset.id */
   int      copy_type;      /* redundancy scheme to apply */
+  int      encode_threads; /* number of threads to use when computing encoding (0 leaves default) */
   int      er_scheme;      /* encoding scheme id */
 } scr_reddesc;
 
@@ -18,6 +18,7 @@
 #include "scr_err.h"
 #include "scr_param.h"
 #include "scr_halt.h"
+#include "scr_status.h"
 
 #include "spath.h"
 #include "kvtree.h"
@@ -128,15 +129,91 @@ int main (int argc, char *argv[])
   /* otherwise, assume that we don't need to halt, and check for valid condition */
   int rc = DONT_HALT;
 
-  /* create a new hash to hold the file data */
-  kvtree* scr_halt_hash = kvtree_new();
+  /* halt condition values, filled from the binary status file when it
+   * is fresh, otherwise by parsing the halt file */
+  int have_reason      = 0;
+  int have_checkpoints = 0;
+  int have_before      = 0;
+  int have_after       = 0;
+  int have_seconds     = 0;
+  char reason[SCR_MAX_FILENAME] = "";
+  int checkpoints_left = -1;
+  int exit_before      = -1;
+  int exit_after       = -1;
+  int file_seconds     = -1;
+
+  /* build path to the binary status file next to the halt file */
+  spath* status_path = spath_from_str(args.dir);
+  spath_append_str(status_path, ".scr");
+  spath_append_str(status_path, SCR_STATUS_FILENAME);
+  char* status_file = spath_strdup(status_path);
+  spath_delete(&status_path);
+
+  /* read the status file if it's at least as new as the halt file,
+   * this is a single read of a fixed-size record instead of parsing
+   * the halt kvtree */
+  scr_status status;
+  if (scr_status_fresh(status_file, file) == SCR_SUCCESS &&
+      scr_status_read(status_file, &status) == SCR_SUCCESS &&
+      (status.flags & SCR_STATUS_FLAG_HALT))
+  {
+    if (status.halt_reason[0] != '\0') {
+      have_reason = 1;
+      strncpy(reason, status.halt_reason, sizeof(reason) - 1);
+    }
+    if (status.halt_checkpoints != -1) {
+      have_checkpoints = 1;
+      checkpoints_left = status.halt_checkpoints;
+    }
+    if (status.halt_exit_before != -1) {
+      have_before = 1;
+      exit_before = (int) status.halt_exit_before;
+    }
+    if (status.halt_exit_after != -1) {
+      have_after = 1;
+      exit_after = (int) status.halt_exit_after;
+    }
+    if (status.halt_seconds != -1) {
+      have_seconds = 1;
+      file_seconds = status.halt_seconds;
+    }
+    scr_free(&status_file);
+  } else {
+    /* no trustworthy status file, parse the halt file itself */
+    scr_free(&status_file);
+
+    /* create a new hash to hold the file data */
+    kvtree* scr_halt_hash = kvtree_new();
+
+    /* read in our halt file */
+    if (scr_halt_read(halt_file, scr_halt_hash) != SCR_SUCCESS) {
+      /* failed to read the halt file -- to be safe, assume we need to halt */
+      printf("%s: HALT RUN: Failed to open existing halt file.\n", PROG);
+      kvtree_delete(&scr_halt_hash);
+      rc = NEED_HALT;
+      goto cleanup;
+    }
+
+    const char* value = NULL;
+    if (kvtree_util_get_str(scr_halt_hash, SCR_HALT_KEY_EXIT_REASON, &value) == KVTREE_SUCCESS) {
+      have_reason = 1;
+      strncpy(reason, value, sizeof(reason) - 1);
+    }
+    if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_CHECKPOINTS, &checkpoints_left) == KVTREE_SUCCESS) {
+      have_checkpoints = 1;
+    }
+    if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_EXIT_BEFORE, &exit_before) == KVTREE_SUCCESS) {
+      have_before = 1;
+    }
+    if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_EXIT_AFTER, &exit_after) == KVTREE_SUCCESS) {
+      have_after = 1;
+    }
+    if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_SECONDS, &file_seconds) == KVTREE_SUCCESS) {
+      have_seconds = 1;
+    }
 
-  /* read in our halt file */
-  if (scr_halt_read(halt_file, scr_halt_hash) != SCR_SUCCESS) {
-    /* failed to read the halt file -- to be safe, assume we need to halt */
-    printf("%s: HALT RUN: Failed to open existing halt file.\n", PROG);
-    rc = NEED_HALT;
-    goto cleanup;
+    /* delete the hash holding the halt file data */
+    kvtree_delete(&scr_halt_hash);
   }
 
   /* TODO: all epochs are stored in ints, should be in unsigned ints? */
@@ -145,32 +222,32 @@ int main (int argc, char *argv[])
   gettimeofday(&tv, NULL);
   int now = tv.tv_sec;
 
-  const char* value = NULL;
-
   /* initialize our halt seconds */
   int halt_seconds = 0;
 
   /* adjust our halt seconds based on what we find in the parameters */
+  const char* param = NULL;
   scr_param_init();
-  if ((value = scr_param_get("SCR_HALT_SECONDS")) != NULL) {
-    halt_seconds = atoi(value);
+  if ((param = scr_param_get("SCR_HALT_SECONDS")) != NULL) {
+    halt_seconds = atoi(param);
   }
   scr_param_finalize();
 
   /* if halt seconds is set in halt file, use this value instead */
-  kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_SECONDS, &halt_seconds);
+  if (have_seconds) {
+    halt_seconds = file_seconds;
+  }
 
   /* check whether a reason has been specified */
-  if (kvtree_util_get_str(scr_halt_hash, SCR_HALT_KEY_EXIT_REASON, &value) == KVTREE_SUCCESS) {
-    if (strcmp(value, "") != 0) {
-      printf("%s: HALT RUN: Reason: %s.\n", PROG, value);
+  if (have_reason) {
+    if (strcmp(reason, "") != 0) {
+      printf("%s: HALT RUN: Reason: %s.\n", PROG, reason);
       rc = NEED_HALT;
     }
   }
 
   /* check whether we are out of checkpoints */
-  int checkpoints_left;
-  if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_CHECKPOINTS, &checkpoints_left) == KVTREE_SUCCESS) {
+  if (have_checkpoints) {
     if (checkpoints_left == 0) {
       printf("%s: HALT RUN: No checkpoints remaining.\n", PROG);
       rc = NEED_HALT;
@@ -178,8 +255,7 @@ int main (int argc, char *argv[])
   }
 
   /* check whether we need to exit before a specified time */
-  int exit_before;
-  if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_EXIT_BEFORE, &exit_before) == KVTREE_SUCCESS) {
+  if (have_before) {
     if (now >= (exit_before - halt_seconds)) {
       time_t time_now  = (time_t) now;
       time_t time_exit = (time_t) exit_before - halt_seconds;
@@ -195,8 +271,7 @@ int main (int argc, char *argv[])
   }
 
   /* check whether we need to exit after a specified time */
-  int exit_after;
-  if (kvtree_util_get_int(scr_halt_hash, SCR_HALT_KEY_EXIT_AFTER, &exit_after) == KVTREE_SUCCESS) {
+  if (have_after) {
     if (now >= exit_after) {
       time_t time_now  = (time_t) now;
       time_t time_exit = (time_t) exit_after;
@@ -210,9 +285,6 @@ int main (int argc, char *argv[])
   }
 
 cleanup:
-  /* delete the hash holding the halt file data */
-  kvtree_delete(&scr_halt_hash);
-
   /* free off our file name storage */
   scr_free(&file);
   spath_delete(&halt_file);
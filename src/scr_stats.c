@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Implements per-process performance counters: latency histograms per
+ * phase, bytes moved per store, and hosts flagged as flush stragglers,
+ * rendered as JSON on demand */
+
+#include "scr_conf.h"
+#include "scr.h"
+#include "scr_err.h"
+#include "scr_io.h"
+#include "scr_util.h"
+#include "scr_stats.h"
+#include "scr_trace_api.h"
+
+#include "kvtree.h"
+#include "kvtree_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include <pthread.h>
+
+/* number of histogram buckets, bucket i counts samples whose latency
+ * in microseconds rounds down to 2^i, the last bucket catches the rest */
+#define SCR_STATS_BUCKETS (32)
+
+/* latency histogram for one phase */
+typedef struct scr_stats_hist {
+  unsigned long count;   /* number of samples recorded */
+  double sum;            /* total seconds across all samples */
+  double min;            /* smallest sample in seconds */
+  double max;            /* largest sample in seconds */
+  unsigned long buckets[SCR_STATS_BUCKETS]; /* power-of-two latency buckets (microseconds) */
+} scr_stats_hist;
+
+/* names for each phase, indexed by scr_stats_phase,
+ * these become keys in the JSON output */
+static const char* scr_stats_phase_names[SCR_STATS_PHASE_COUNT] = {
+  "checkpoint",
+  "output",
+  "flush",
+  "fetch",
+  "lock_wait",
+};
+
+/* one histogram per phase */
+static scr_stats_hist scr_stats_hists[SCR_STATS_PHASE_COUNT];
+
+/* maps store name to BYTES and FILES tallies */
+static kvtree* scr_stats_stores = NULL;
+
+/* maps hostname to BW and STRIKES for nodes flagged as flush stragglers,
+ * populated on rank 0 only */
+static kvtree* scr_stats_stragglers = NULL;
+
+/* counters may be updated from background worker threads
+ * as well as the main thread */
+static pthread_mutex_t scr_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* reset all counters */
+void scr_stats_init(void)
+{
+  pthread_mutex_lock(&scr_stats_mutex);
+  memset(scr_stats_hists, 0, sizeof(scr_stats_hists));
+  kvtree_delete(&scr_stats_stores);
+  scr_stats_stores = kvtree_new();
+  kvtree_delete(&scr_stats_stragglers);
+  scr_stats_stragglers = kvtree_new();
+  pthread_mutex_unlock(&scr_stats_mutex);
+}
+
+/* free counter storage */
+void scr_stats_finalize(void)
+{
+  pthread_mutex_lock(&scr_stats_mutex);
+  kvtree_delete(&scr_stats_stores);
+  kvtree_delete(&scr_stats_stragglers);
+  pthread_mutex_unlock(&scr_stats_mutex);
+}
+
+/* record one sample of secs for the given phase */
+void scr_stats_sample(scr_stats_phase phase, double secs)
+{
+  if (phase < 0 || phase >= SCR_STATS_PHASE_COUNT) {
+    return;
+  }
+  if (secs < 0.0) {
+    secs = 0.0;
+  }
+
+  /* mirror the sample into the binary trace ring when tracing */
+  if (scr_trace_active()) {
+    scr_trace_emit(SCR_TRACE_KIND_PHASE, phase, secs, 0, 0);
+  }
+
+  /* find the bucket for this sample, bucket i covers latencies
+   * of 2^i microseconds */
+  unsigned long us = (unsigned long) (secs * 1000000.0);
+  int idx = 0;
+  while (us > 1 && idx < SCR_STATS_BUCKETS - 1) {
+    us >>= 1;
+    idx++;
+  }
+
+  pthread_mutex_lock(&scr_stats_mutex);
+
+  scr_stats_hist* h = &scr_stats_hists[phase];
+  if (h->count == 0 || secs < h->min) {
+    h->min = secs;
+  }
+  if (h->count == 0 || secs > h->max) {
+    h->max = secs;
+  }
+  h->sum += secs;
+  h->count++;
+  h->buckets[idx]++;
+
+  pthread_mutex_unlock(&scr_stats_mutex);
+}
+
+/* add bytes and files moved to the tally for the named store */
+void scr_stats_add_bytes(const char* store, double bytes, int files)
+{
+  if (store == NULL) {
+    return;
+  }
+
+  /* mirror the tally into the binary trace ring when tracing */
+  if (scr_trace_active()) {
+    scr_trace_emit(SCR_TRACE_KIND_BYTES, 0, 0.0, (unsigned long) bytes, files);
+  }
+
+  pthread_mutex_lock(&scr_stats_mutex);
+
+  /* create the store map on first use in case init was skipped */
+  if (scr_stats_stores == NULL) {
+    scr_stats_stores = kvtree_new();
+  }
+
+  /* tally bytes and files under the store name */
+  kvtree* hash = kvtree_get(scr_stats_stores, store);
+  if (hash == NULL) {
+    hash = kvtree_set(scr_stats_stores, store, kvtree_new());
+  }
+
+  double total_bytes = 0.0;
+  kvtree_util_get_double(hash, "BYTES", &total_bytes);
+  kvtree_util_set_double(hash, "BYTES", total_bytes + bytes);
+
+  unsigned long total_files = 0;
+  kvtree_util_get_unsigned_long(hash, "FILES", &total_files);
+  kvtree_util_set_unsigned_long(hash, "FILES", total_files + (unsigned long) files);
+
+  pthread_mutex_unlock(&scr_stats_mutex);
+}
+
+/* record that the named host has fallen behind its peers during flush */
+void scr_stats_set_straggler(const char* host, double bw, int strikes)
+{
+  if (host == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&scr_stats_mutex);
+
+  /* create the straggler map on first use in case init was skipped */
+  if (scr_stats_stragglers == NULL) {
+    scr_stats_stragglers = kvtree_new();
+  }
+
+  /* keep the latest bandwidth and strike count under the hostname */
+  kvtree* hash = kvtree_get(scr_stats_stragglers, host);
+  if (hash == NULL) {
+    hash = kvtree_set(scr_stats_stragglers, host, kvtree_new());
+  }
+  kvtree_util_set_double(hash, "BW", bw);
+  kvtree_util_set_int(hash, "STRIKES", strikes);
+
+  pthread_mutex_unlock(&scr_stats_mutex);
+}
+
+/* append formatted text at pos within buf of size,
+ * returns new position, like snprintf the position may run past size,
+ * in which case the output is truncated but the count remains valid */
+static int scr_stats_append(char* buf, size_t size, int pos, const char* format, ...)
+{
+  char* ptr = NULL;
+  size_t remaining = 0;
+  if (buf != NULL && (size_t) pos < size) {
+    ptr = buf + pos;
+    remaining = size - pos;
+  }
+
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(ptr, remaining, format, args);
+  va_end(args);
+
+  if (n > 0) {
+    pos += n;
+  }
+  return pos;
+}
+
+/* render counters as JSON into buf, returns the number of characters
+ * needed not counting the terminating NUL, like snprintf */
+int scr_stats_json(char* buf, size_t size)
+{
+  pthread_mutex_lock(&scr_stats_mutex);
+
+  int pos = 0;
+  pos = scr_stats_append(buf, size, pos, "{\"phases\":{");
+
+  /* one object per phase that has at least one sample */
+  int i, j;
+  int first = 1;
+  for (i = 0; i < SCR_STATS_PHASE_COUNT; i++) {
+    scr_stats_hist* h = &scr_stats_hists[i];
+    if (h->count == 0) {
+      continue;
+    }
+
+    pos = scr_stats_append(buf, size, pos,
+      "%s\"%s\":{\"count\":%lu,\"secs\":%f,\"min\":%f,\"max\":%f,\"buckets_us\":[",
+      first ? "" : ",", scr_stats_phase_names[i], h->count, h->sum, h->min, h->max
+    );
+    first = 0;
+
+    /* drop trailing empty buckets to keep the output small */
+    int last = SCR_STATS_BUCKETS - 1;
+    while (last > 0 && h->buckets[last] == 0) {
+      last--;
+    }
+    for (j = 0; j <= last; j++) {
+      pos = scr_stats_append(buf, size, pos, "%s%lu",
+        (j > 0) ? "," : "", h->buckets[j]
+      );
+    }
+    pos = scr_stats_append(buf, size, pos, "]}");
+  }
+
+  pos = scr_stats_append(buf, size, pos, "},\"stores\":{");
+
+  /* one object per store we have moved bytes to or from */
+  first = 1;
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(scr_stats_stores);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    char* name = kvtree_elem_key(elem);
+    kvtree* hash = kvtree_elem_hash(elem);
+
+    double bytes = 0.0;
+    kvtree_util_get_double(hash, "BYTES", &bytes);
+    unsigned long files = 0;
+    kvtree_util_get_unsigned_long(hash, "FILES", &files);
+
+    pos = scr_stats_append(buf, size, pos,
+      "%s\"%s\":{\"bytes\":%f,\"files\":%lu}",
+      first ? "" : ",", name, bytes, files
+    );
+    first = 0;
+  }
+
+  pos = scr_stats_append(buf, size, pos, "},\"stragglers\":{");
+
+  /* one object per host flagged as a flush straggler, rank 0 only */
+  first = 1;
+  for (elem = kvtree_elem_first(scr_stats_stragglers);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    char* name = kvtree_elem_key(elem);
+    kvtree* hash = kvtree_elem_hash(elem);
+
+    double bw = 0.0;
+    kvtree_util_get_double(hash, "BW", &bw);
+    int strikes = 0;
+    kvtree_util_get_int(hash, "STRIKES", &strikes);
+
+    pos = scr_stats_append(buf, size, pos,
+      "%s\"%s\":{\"bw\":%f,\"strikes\":%d}",
+      first ? "" : ",", name, bw, strikes
+    );
+    first = 0;
+  }
+
+  pos = scr_stats_append(buf, size, pos, "}}");
+
+  pthread_mutex_unlock(&scr_stats_mutex);
+
+  return pos;
+}
+
+/* write counters as JSON to the named file */
+int scr_stats_write(const char* file)
+{
+  /* size the buffer, then render into it */
+  int needed = scr_stats_json(NULL, 0);
+  char* buf = (char*) SCR_MALLOC(needed + 2);
+  scr_stats_json(buf, needed + 1);
+  buf[needed] = '\n';
+  buf[needed + 1] = '\0';
+
+  /* write the rendered JSON to the file */
+  int rc = SCR_SUCCESS;
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(file, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (fd >= 0) {
+    ssize_t n = scr_write(file, fd, buf, needed + 1);
+    if (n != needed + 1) {
+      rc = SCR_FAILURE;
+    }
+    scr_close(file, fd);
+  } else {
+    scr_err("Opening stats file for write: scr_open(%s) @ %s:%d",
+      file, __FILE__, __LINE__
+    );
+    rc = SCR_FAILURE;
+  }
+
+  scr_free(&buf);
+  return rc;
+}
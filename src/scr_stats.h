@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_STATS_H
+#define SCR_STATS_H
+
+#include <stddef.h>
+
+/* Tracks per-process performance counters: latency histograms for
+ * each phase, and bytes and file counts moved per store.  Counters
+ * can be rendered as JSON through SCR_Get_stats or dumped to a file
+ * at SCR_Finalize for post-mortem analysis, e.g. to find the node
+ * whose flush is slower than the rest. */
+
+/* phases tracked with latency histograms */
+typedef enum {
+  SCR_STATS_PHASE_CHECKPOINT = 0, /* time to complete a checkpoint dataset */
+  SCR_STATS_PHASE_OUTPUT,         /* time to complete a pure output dataset */
+  SCR_STATS_PHASE_FLUSH,          /* time to flush a dataset to the file system */
+  SCR_STATS_PHASE_FETCH,          /* time to fetch a dataset into cache */
+  SCR_STATS_PHASE_LOCK,           /* time spent waiting on file locks */
+  SCR_STATS_PHASE_COUNT           /* number of phases, must be last */
+} scr_stats_phase;
+
+/* reset all counters */
+void scr_stats_init(void);
+
+/* free counter storage */
+void scr_stats_finalize(void);
+
+/* record one sample of secs for the given phase */
+void scr_stats_sample(scr_stats_phase phase, double secs);
+
+/* add bytes and files moved to the tally for the named store */
+void scr_stats_add_bytes(const char* store, double bytes, int files);
+
+/* record that the named host has fallen behind its peers during flush,
+ * bw is the node bandwidth in bytes/sec observed on the latest flush and
+ * strikes is the number of consecutive slow flushes, only rank 0 holds
+ * these entries since the flush straggler check decides on rank 0 */
+void scr_stats_set_straggler(const char* host, double bw, int strikes);
+
+/* render counters as JSON into buf, returns the number of characters
+ * needed not counting the terminating NUL, like snprintf, so a return
+ * value >= size means the output was truncated */
+int scr_stats_json(char* buf, size_t size);
+
+/* write counters as JSON to the named file */
+int scr_stats_write(const char* file);
+
+#endif
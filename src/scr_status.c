@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Implements the fixed-layout binary status file, a one-read summary
+ * of the flush and halt files for prejob tools. */
+
+#include "scr_keys.h"
+#include "scr.h"
+#include "scr_io.h"
+#include "scr_err.h"
+#include "scr_util.h"
+#include "scr_halt.h"
+#include "scr_status.h"
+
+#include "kvtree.h"
+#include "kvtree_util.h"
+#include "spath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* initialize a status record to empty values */
+void scr_status_init(scr_status* status)
+{
+  memset(status, 0, sizeof(scr_status));
+  status->magic            = SCR_STATUS_MAGIC;
+  status->version          = SCR_STATUS_VERSION;
+  status->flags            = 0;
+  status->dset_id          = -1;
+  status->ckpt_id          = -1;
+  status->halt_checkpoints = -1;
+  status->halt_seconds     = -1;
+  status->halt_exit_before = -1;
+  status->halt_exit_after  = -1;
+}
+
+/* read status record from file with a single read,
+ * returns SCR_FAILURE if file is missing, truncated, or of wrong version */
+int scr_status_read(const char* file, scr_status* status)
+{
+  /* open the status file for reading */
+  int fd = scr_open(file, O_RDONLY);
+  if (fd < 0) {
+    return SCR_FAILURE;
+  }
+
+  /* read the full record in one call */
+  ssize_t nread = scr_read_attempt(file, fd, status, sizeof(scr_status));
+  scr_close_nofsync(file, fd);
+
+  /* a short read means the file is truncated or from a different layout */
+  if (nread != sizeof(scr_status)) {
+    return SCR_FAILURE;
+  }
+
+  /* check that the record is one we know how to interpret */
+  if (status->magic != SCR_STATUS_MAGIC ||
+      status->version != SCR_STATUS_VERSION)
+  {
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* write status record to file via temporary file and rename */
+int scr_status_write(const char* file, const scr_status* status)
+{
+  /* build name of temporary file in the same directory */
+  char tmp[SCR_MAX_FILENAME];
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= sizeof(tmp)) {
+    scr_err("Status temporary file name too long: %s @ %s:%d",
+      file, __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* write the full record to the temporary file */
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(tmp, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+  if (fd < 0) {
+    scr_err("Opening status file for write: scr_open(%s) errno=%d %s @ %s:%d",
+      tmp, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+  ssize_t nwrite = scr_write_attempt(tmp, fd, status, sizeof(scr_status));
+  scr_close(tmp, fd);
+  if (nwrite != sizeof(scr_status)) {
+    scr_file_unlink(tmp);
+    return SCR_FAILURE;
+  }
+
+  /* rename the temporary file into place, so readers either see the
+   * old record or the new one, but never a partial write */
+  if (rename(tmp, file) != 0) {
+    scr_err("Renaming status file: rename(%s, %s) errno=%d %s @ %s:%d",
+      tmp, file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    scr_file_unlink(tmp);
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* returns SCR_SUCCESS if status file exists and is at least as new as
+ * source file, so its summary of that file can be trusted */
+int scr_status_fresh(const char* status_file, const char* source_file)
+{
+  /* the status file must exist */
+  struct stat status_stat;
+  if (stat(status_file, &status_stat) != 0) {
+    return SCR_FAILURE;
+  }
+
+  /* if the source file does not exist, the status file can't be stale */
+  struct stat source_stat;
+  if (stat(source_file, &source_stat) != 0) {
+    return SCR_SUCCESS;
+  }
+
+  /* the library writes the status file after the file it summarizes,
+   * so a status file at least as new as the source is trustworthy,
+   * an older one means something else wrote the source since */
+  if (status_stat.st_mtime < source_stat.st_mtime) {
+    return SCR_FAILURE;
+  }
+
+  return SCR_SUCCESS;
+}
+
+/* read existing status record from file, or initialize an empty one
+ * if the file is missing or unreadable */
+static void scr_status_read_or_init(const char* file, scr_status* status)
+{
+  if (scr_status_read(file, status) != SCR_SUCCESS) {
+    scr_status_init(status);
+  }
+}
+
+/* refresh flush summary fields in status file from given flush file hash,
+ * preserves halt fields */
+int scr_status_update_flush(const spath* status_path, const kvtree* flush_hash)
+{
+  /* convert path to string */
+  char* file = spath_strdup(status_path);
+
+  /* start from the existing record so we keep the halt summary */
+  scr_status status;
+  scr_status_read_or_init(file, &status);
+
+  /* reset flush fields before rescanning */
+  status.dset_id = -1;
+  status.ckpt_id = -1;
+  status.flags &= ~(SCR_STATUS_FLAG_CKPT | SCR_STATUS_FLAG_FLUSHED | SCR_STATUS_FLAG_FLUSHING);
+  memset(status.ckpt_name, 0, sizeof(status.ckpt_name));
+
+  /* scan datasets for the highest dataset and checkpoint ids */
+  kvtree* ckpt_hash = NULL;
+  kvtree* dsets = kvtree_get(flush_hash, SCR_FLUSH_KEY_DATASET);
+  kvtree_elem* elem;
+  for (elem = kvtree_elem_first(dsets);
+       elem != NULL;
+       elem = kvtree_elem_next(elem))
+  {
+    int id = kvtree_elem_key_int(elem);
+    if (id > status.dset_id) {
+      status.dset_id = id;
+    }
+
+    /* remember the highest dataset marked as a checkpoint */
+    kvtree* dhash = kvtree_elem_hash(elem);
+    int flag;
+    if (kvtree_util_get_int(dhash, SCR_FLUSH_KEY_CKPT, &flag) == KVTREE_SUCCESS &&
+        flag == 1 && id > status.ckpt_id)
+    {
+      status.ckpt_id = id;
+      ckpt_hash = dhash;
+    }
+  }
+
+  /* record name and flush state of the latest checkpoint */
+  if (ckpt_hash != NULL) {
+    status.flags |= SCR_STATUS_FLAG_CKPT;
+
+    char* name;
+    if (kvtree_util_get_str(ckpt_hash, SCR_FLUSH_KEY_NAME, &name) == KVTREE_SUCCESS) {
+      strncpy(status.ckpt_name, name, sizeof(status.ckpt_name) - 1);
+    }
+
+    kvtree* location_hash = kvtree_get(ckpt_hash, SCR_FLUSH_KEY_LOCATION);
+    if (kvtree_elem_get(location_hash, SCR_FLUSH_KEY_LOCATION_PFS) != NULL) {
+      status.flags |= SCR_STATUS_FLAG_FLUSHED;
+    }
+    if (kvtree_elem_get(location_hash, SCR_FLUSH_KEY_LOCATION_FLUSHING) != NULL) {
+      status.flags |= SCR_STATUS_FLAG_FLUSHING;
+    }
+  }
+
+  /* write the updated record back out */
+  int rc = scr_status_write(file, &status);
+
+  scr_free(&file);
+
+  return rc;
+}
+
+/* refresh halt summary fields in status file from given halt file hash,
+ * preserves flush fields */
+int scr_status_update_halt(const spath* status_path, const kvtree* halt_hash)
+{
+  /* convert path to string */
+  char* file = spath_strdup(status_path);
+
+  /* start from the existing record so we keep the flush summary */
+  scr_status status;
+  scr_status_read_or_init(file, &status);
+
+  /* reset halt fields before copying from the hash */
+  status.halt_checkpoints = -1;
+  status.halt_seconds     = -1;
+  status.halt_exit_before = -1;
+  status.halt_exit_after  = -1;
+  memset(status.halt_reason, 0, sizeof(status.halt_reason));
+  status.flags |= SCR_STATUS_FLAG_HALT;
+
+  char* reason;
+  if (kvtree_util_get_str(halt_hash, SCR_HALT_KEY_EXIT_REASON, &reason) == KVTREE_SUCCESS) {
+    strncpy(status.halt_reason, reason, sizeof(status.halt_reason) - 1);
+  }
+
+  int value;
+  if (kvtree_util_get_int(halt_hash, SCR_HALT_KEY_CHECKPOINTS, &value) == KVTREE_SUCCESS) {
+    status.halt_checkpoints = value;
+  }
+  if (kvtree_util_get_int(halt_hash, SCR_HALT_KEY_SECONDS, &value) == KVTREE_SUCCESS) {
+    status.halt_seconds = value;
+  }
+  if (kvtree_util_get_int(halt_hash, SCR_HALT_KEY_EXIT_BEFORE, &value) == KVTREE_SUCCESS) {
+    status.halt_exit_before = value;
+  }
+  if (kvtree_util_get_int(halt_hash, SCR_HALT_KEY_EXIT_AFTER, &value) == KVTREE_SUCCESS) {
+    status.halt_exit_after = value;
+  }
+
+  /* write the updated record back out */
+  int rc = scr_status_write(file, &status);
+
+  scr_free(&file);
+
+  return rc;
+}
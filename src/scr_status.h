@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_STATUS_H
+#define SCR_STATUS_H
+
+#include <stdint.h>
+
+#include "scr.h"
+#include "kvtree.h"
+#include "spath.h"
+
+/* The status file is a small fixed-layout binary summary of the flush
+ * and halt files, kept at <prefix>/.scr/status.scr.  The library
+ * refreshes it whenever it rewrites the flush or halt file, using a
+ * write-to-temporary-and-rename so readers never see a partial record.
+ * Prejob tools read the whole record with a single read, which avoids
+ * parsing full kvtree files on every node at every job start.  Tools
+ * must check that the status file is at least as new as the file it
+ * summarizes before trusting it, see scr_status_fresh. */
+
+#define SCR_STATUS_FILENAME ("status.scr")
+
+#define SCR_STATUS_MAGIC   (0x53435253)
+#define SCR_STATUS_VERSION (1)
+
+/* have at least one checkpoint dataset */
+#define SCR_STATUS_FLAG_CKPT     (0x1)
+
+/* latest checkpoint has been flushed to the parallel file system */
+#define SCR_STATUS_FLAG_FLUSHED  (0x2)
+
+/* a flush of the latest checkpoint is in progress */
+#define SCR_STATUS_FLAG_FLUSHING (0x4)
+
+/* halt summary fields are valid */
+#define SCR_STATUS_FLAG_HALT     (0x8)
+
+typedef struct {
+  uint32_t magic;            /* identifies the file as a status file */
+  uint32_t version;          /* layout version of this record */
+  uint32_t flags;            /* bitmask of SCR_STATUS_FLAG values */
+  int32_t  dset_id;          /* highest dataset id in the flush file, -1 if none */
+  int32_t  ckpt_id;          /* highest checkpoint dataset id, -1 if none */
+  int32_t  halt_checkpoints; /* CheckpointsLeft from halt file, -1 if unset */
+  int32_t  halt_seconds;     /* HaltSeconds from halt file, -1 if unset */
+  int64_t  halt_exit_before; /* ExitBefore epoch seconds, -1 if unset */
+  int64_t  halt_exit_after;  /* ExitAfter epoch seconds, -1 if unset */
+  char ckpt_name[SCR_MAX_FILENAME];   /* name of latest checkpoint, empty if none */
+  char halt_reason[SCR_MAX_FILENAME]; /* ExitReason from halt file, empty if unset */
+} scr_status;
+
+/* initialize a status record to empty values */
+void scr_status_init(scr_status* status);
+
+/* read status record from file with a single read,
+ * returns SCR_FAILURE if file is missing, truncated, or of wrong version */
+int scr_status_read(const char* file, scr_status* status);
+
+/* write status record to file via temporary file and rename */
+int scr_status_write(const char* file, const scr_status* status);
+
+/* returns SCR_SUCCESS if status file exists and is at least as new as
+ * source file, so its summary of that file can be trusted */
+int scr_status_fresh(const char* status_file, const char* source_file);
+
+/* refresh flush summary fields in status file from given flush file hash,
+ * preserves halt fields */
+int scr_status_update_flush(const spath* status_path, const kvtree* flush_hash);
+
+/* refresh halt summary fields in status file from given halt file hash,
+ * preserves flush fields */
+int scr_status_update_halt(const spath* status_path, const kvtree* halt_hash);
+
+#endif
@@ -21,12 +21,44 @@
 
 #include "scr_globals.h"
 
+/* statfs to detect memory-backed file systems */
+#ifdef __linux__
+#include <sys/vfs.h>
+#ifndef TMPFS_MAGIC
+#define TMPFS_MAGIC 0x01021994
+#endif
+#ifndef RAMFS_MAGIC
+#define RAMFS_MAGIC 0x858458f6
+#endif
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+#endif
+
 /*
 =========================================
 Store descriptor functions
 =========================================
 */
 
+/* returns 1 if the file system holding the given path keeps its data
+ * in memory (tmpfs, ramfs, or hugepage-backed), 0 otherwise */
+static int scr_storedesc_base_in_memory(const char* base)
+{
+#ifdef __linux__
+  struct statfs fs;
+  if (statfs(base, &fs) == 0) {
+    if (fs.f_type == TMPFS_MAGIC ||
+        fs.f_type == RAMFS_MAGIC ||
+        fs.f_type == HUGETLBFS_MAGIC)
+    {
+      return 1;
+    }
+  }
+#endif
+  return 0;
+}
+
 /* initialize the specified store descriptor */
 static int scr_storedesc_init(scr_storedesc* s)
 {
@@ -43,7 +75,15 @@ static int scr_storedesc_init(scr_storedesc* s)
   s->index     = -1;
   s->name      = NULL;
   s->max_count = 0;
+  s->threads   = 0;
+  s->bw        = 0.0;
   s->can_mkdir = 0;
+  s->mem       = 0;
+  s->sync      = SCR_SYNC_FSYNC;
+  s->direct    = 0;
+  s->fanout    = 0;
+  s->paths     = 0;
+  s->path_list = NULL;
   s->type      = NULL;
   s->view      = NULL;
   s->comm      = MPI_COMM_NULL;
@@ -62,6 +102,13 @@ static int scr_storedesc_free(scr_storedesc* s)
     scr_free(&s->type);
     scr_free(&s->view);
 
+    /* free the stripe path list */
+    int i;
+    for (i = 0; i < s->paths; i++) {
+      scr_free(&s->path_list[i]);
+    }
+    scr_free(&s->path_list);
+
     /* free the communicator we created */
     if (s->comm != MPI_COMM_NULL) {
       MPI_Comm_free(&s->comm);
@@ -90,7 +137,22 @@ static int scr_storedesc_copy(scr_storedesc* out, const scr_storedesc* in)
   out->index     = in->index;
   out->name      = strdup(in->name);
   out->max_count = in->max_count;
+  out->threads   = in->threads;
+  out->bw        = in->bw;
   out->can_mkdir = in->can_mkdir;
+  out->mem       = in->mem;
+  out->sync      = in->sync;
+  out->direct    = in->direct;
+  out->fanout    = in->fanout;
+  out->paths     = in->paths;
+  out->path_list = NULL;
+  if (in->paths > 0) {
+    out->path_list = (char**) SCR_MALLOC(in->paths * sizeof(char*));
+    int i;
+    for (i = 0; i < in->paths; i++) {
+      out->path_list[i] = strdup(in->path_list[i]);
+    }
+  }
   out->type      = strdup(in->type);
   out->view      = strdup(in->view);
   MPI_Comm_dup(in->comm, &out->comm);
@@ -174,10 +236,102 @@ static int scr_storedesc_create_from_hash(
   s->max_count = scr_cache_size;
   kvtree_util_get_int(hash, SCR_CONFIG_KEY_COUNT, &(s->max_count));
 
+  /* cap on flush worker threads per process for this store,
+   * 0 applies no store-specific cap */
+  s->threads = 0;
+  kvtree_util_get_int(hash, SCR_CONFIG_KEY_THREADS, &(s->threads));
+
+  /* aggregate bandwidth limit for flushes to this store,
+   * zero means unlimited */
+  s->bw = 0.0;
+  kvtree_util_get_double(hash, SCR_CONFIG_KEY_BW, &(s->bw));
+
   /* assume we can call mkdir/rmdir on this store unless told otherwise */
   s->can_mkdir = 1;
   kvtree_util_get_int(hash, SCR_CONFIG_KEY_MKDIR, &(s->can_mkdir));
 
+  /* note whether this store is memory-backed, files written here
+   * never touch a device so callers can skip fsync when writing to
+   * it, detect tmpfs and friends by default and allow the config to
+   * override in either direction */
+  s->mem = scr_storedesc_base_in_memory(s->name);
+  kvtree_util_get_int(hash, SCR_CONFIG_KEY_MEMORY, &(s->mem));
+
+  /* whether to write data files to this store with O_DIRECT to
+   * keep checkpoint traffic out of the page cache, makes no sense
+   * for memory-backed stores where the page cache is the storage */
+  s->direct = 0;
+  if (! s->mem) {
+    kvtree_util_get_int(hash, SCR_CONFIG_KEY_DIRECT, &(s->direct));
+  }
+
+  /* number of hashed subdirectories to spread per-node dataset
+   * directories across on a global-view store, zero keeps the flat
+   * layout, useful to avoid piling one entry per node into a single
+   * parent directory on large runs */
+  s->fanout = 0;
+  kvtree_util_get_int(hash, SCR_CONFIG_KEY_FANOUT, &(s->fanout));
+  if (s->fanout < 0) {
+    s->fanout = 0;
+  }
+
+  /* a store may span several devices, PATHS lists their mount
+   * points separated by commas, each rank then places its cache
+   * files on one of them chosen round-robin by rank so that the
+   * node's aggregate cache bandwidth covers every device */
+  char* paths_str = NULL;
+  kvtree_util_get_str(hash, SCR_CONFIG_KEY_PATHS, &paths_str);
+  if (paths_str != NULL && strcmp(paths_str, "") != 0) {
+    /* count entries in the comma-separated list */
+    int count = 1;
+    const char* p;
+    for (p = paths_str; *p != '\0'; p++) {
+      if (*p == ',') {
+        count++;
+      }
+    }
+
+    /* split the list, reducing each path as we go */
+    s->path_list = (char**) SCR_MALLOC(count * sizeof(char*));
+    char* copy = strdup(paths_str);
+    char* part = copy;
+    int i;
+    for (i = 0; i < count; i++) {
+      char* stop = strchr(part, ',');
+      if (stop != NULL) {
+        *stop = '\0';
+      }
+      s->path_list[i] = spath_strdup_reduce_str(part);
+      part = (stop != NULL) ? stop + 1 : part;
+    }
+    scr_free(&copy);
+    s->paths = count;
+  }
+
+  /* select the sync policy applied when closing files written to
+   * this store, memory-backed stores have no device to sync to so
+   * they default to NONE, everything else keeps the full fsync */
+  s->sync = s->mem ? SCR_SYNC_NONE : SCR_SYNC_FSYNC;
+  char* sync_str = NULL;
+  kvtree_util_get_str(hash, SCR_CONFIG_KEY_SYNC, &sync_str);
+  if (sync_str != NULL) {
+    if (strcmp(sync_str, "NONE") == 0) {
+      s->sync = SCR_SYNC_NONE;
+    } else if (strcmp(sync_str, "FDATASYNC") == 0) {
+      s->sync = SCR_SYNC_FDATASYNC;
+    } else if (strcmp(sync_str, "FSYNC") == 0) {
+      s->sync = SCR_SYNC_FSYNC;
+    } else if (strcmp(sync_str, "RANGE") == 0) {
+      s->sync = SCR_SYNC_RANGE;
+    } else if (strcmp(sync_str, "DATASET") == 0) {
+      s->sync = SCR_SYNC_DATASET;
+    } else {
+      scr_warn("Unknown SYNC value `%s' for store %s, using default @ %s:%d",
+        sync_str, s->name, __FILE__, __LINE__
+      );
+    }
+  }
+
   /* set the type of the store. Default to POSIX */
   char* tmp_type = NULL;
   kvtree_util_get_str(hash, SCR_CONFIG_KEY_TYPE, &tmp_type);
@@ -225,6 +379,46 @@ static int scr_storedesc_create_from_hash(
   return SCR_SUCCESS;
 }
 
+/* return the base path this process should use on the store,
+ * ranks are assigned to stripes round-robin on a multi-path store */
+const char* scr_storedesc_stripe_base(const scr_storedesc* store)
+{
+  if (store == NULL) {
+    return NULL;
+  }
+  if (store->paths > 0 && store->path_list != NULL && store->rank >= 0) {
+    return store->path_list[store->rank % store->paths];
+  }
+  return store->name;
+}
+
+/* returns 1 if this process leads directory operations on the store,
+ * a single-path store has one leader, while a multi-path store has
+ * one leader per stripe so every device gets its directories, the
+ * directory names a leader operates on always sit on its own stripe
+ * since all ranks of a stripe build identical paths */
+static int scr_storedesc_is_leader(const scr_storedesc* store)
+{
+  if (store->paths > 1) {
+    return (store->rank >= 0 && store->rank < store->paths);
+  }
+  if (! strcmp(store->view, "GLOBAL")) {
+    return (scr_my_rank_host == 0);
+  }
+  return (store->rank == 0);
+}
+
+/* combine directory operation results across the store, with
+ * multi-path stores several leaders contribute so a broadcast from
+ * rank zero is not enough */
+static int scr_storedesc_combine_rc(const scr_storedesc* store, int rc)
+{
+  if (! scr_alltrue(rc == SCR_SUCCESS, store->comm)) {
+    rc = SCR_FAILURE;
+  }
+  return rc;
+}
+
 /* create specified directory on store */
 int scr_storedesc_dir_create(const scr_storedesc* store, const char* dir)
 {
@@ -238,18 +432,49 @@ int scr_storedesc_dir_create(const scr_storedesc* store, const char* dir)
     return SCR_FAILURE;
   }
 
-  /* rank 0 creates the directory */
+  /* leaders create the directory */
   int rc = SCR_SUCCESS;
-  if (!strcmp(store->view, "GLOBAL") && store->can_mkdir && scr_my_rank_host == 0) {
-    scr_dbg(2, "Creating directory: %s", dir);
-    rc = scr_mkdir(dir, S_IRWXU | S_IRWXG);
-  } else if (store->rank == 0 && store->can_mkdir) {
+  if (scr_storedesc_is_leader(store) && store->can_mkdir) {
     scr_dbg(2, "Creating directory: %s", dir);
     rc = scr_mkdir(dir, S_IRWXU | S_IRWXG);
   }
 
-  /* broadcast return code from rank zero to other ranks */
-  MPI_Bcast(&rc, 1, MPI_INT, 0, store->comm);
+  /* determine whether all leaders created their directories */
+  rc = scr_storedesc_combine_rc(store, rc);
+
+  return rc;
+}
+
+/* create a list of directories on store in one collective pass,
+ * the leader creates every directory in list order (so parents must
+ * precede children) and all ranks synchronize once on the combined
+ * result, which costs a single broadcast rather than one barrier
+ * and broadcast per directory */
+int scr_storedesc_dirs_create(const scr_storedesc* store, int count, const char** dirs)
+{
+  /* verify that we have a valid store descriptor and directory list */
+  if (store == NULL || (count > 0 && dirs == NULL)) {
+    return SCR_FAILURE;
+  }
+
+  /* return with failure if this store is disabled */
+  if (! store->enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* leaders create the directories, stop at the first failure since
+   * children of a missing parent cannot succeed */
+  int rc = SCR_SUCCESS;
+  if (scr_storedesc_is_leader(store) && store->can_mkdir) {
+    int i;
+    for (i = 0; i < count && rc == SCR_SUCCESS; i++) {
+      scr_dbg(2, "Creating directory: %s", dirs[i]);
+      rc = scr_mkdir(dirs[i], S_IRWXU | S_IRWXG);
+    }
+  }
+
+  /* determine whether all leaders created their directories */
+  rc = scr_storedesc_combine_rc(store, rc);
 
   return rc;
 }
@@ -270,11 +495,9 @@ int scr_storedesc_dir_delete(const scr_storedesc* store, const char* dir)
   /* barrier to ensure all procs are ready before we delete */
   MPI_Barrier(store->comm);
 
-  /* rank 0 deletes the directory */
+  /* leaders delete the directory */
   int rc = SCR_SUCCESS;
-  if ((store->rank == 0 || (scr_my_rank_host == 0 && !strcmp(store->view, "GLOBAL")))
-      && store->can_mkdir)
-  {
+  if (scr_storedesc_is_leader(store) && store->can_mkdir) {
     /* delete directory */
     if (scr_rmdir(dir) != SCR_SUCCESS) {
       /* whoops, something failed when we tried to delete our directory */
@@ -285,8 +508,110 @@ int scr_storedesc_dir_delete(const scr_storedesc* store, const char* dir)
     }
   }
 
-  /* broadcast return code from rank zero to other ranks */
-  MPI_Bcast(&rc, 1, MPI_INT, 0, store->comm);
+  /* determine whether all leaders deleted their directories */
+  rc = scr_storedesc_combine_rc(store, rc);
+
+  return rc;
+}
+
+/* variant of scr_storedesc_is_leader that rotates the leader by the
+ * given shift, so a caller deleting many directories can spread the
+ * background unlink work across the processes of the store, a shift
+ * of zero picks the same leader as scr_storedesc_is_leader */
+static int scr_storedesc_is_leader_shift(const scr_storedesc* store, int shift)
+{
+  /* with multiple paths the leader set is fixed by the stripe
+   * layout, since a leader can only operate on its own stripe */
+  if (store->paths > 1) {
+    return scr_storedesc_is_leader(store);
+  }
+  if (! strcmp(store->view, "GLOBAL")) {
+    /* directory names depend on the node, so rotate among the
+     * processes of the node */
+    int ranks_node;
+    MPI_Comm_size(scr_comm_node, &ranks_node);
+    return (scr_my_rank_host == shift % ranks_node);
+  }
+  if (store->ranks > 0) {
+    return (store->rank == shift % store->ranks);
+  }
+  return scr_storedesc_is_leader(store);
+}
+
+/* hand specified directory from store to the background reclamation
+ * queue, the directory is renamed out of the way and its files are
+ * unlinked by the reaper thread (see scr_reap.c), so the caller pays
+ * for a single rename instead of one unlink per file, the leader is
+ * rotated by shift so that reaping many directories engages the
+ * reaper threads of different processes */
+int scr_storedesc_dir_reap_shift(const scr_storedesc* store, const char* dir, int shift)
+{
+  /* verify that we have a valid store descriptor and directory name */
+  if (store == NULL || dir == NULL) {
+    return SCR_FAILURE;
+  }
+
+  /* return with failure if this store is disabled */
+  if (! store->enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* barrier to ensure all procs are done with files in the
+   * directory before we rename it */
+  MPI_Barrier(store->comm);
+
+  /* leaders rename their directories onto the reaper's queue */
+  int rc = SCR_SUCCESS;
+  if (scr_storedesc_is_leader_shift(store, shift) && store->can_mkdir) {
+    rc = scr_reap_delete_dir(dir);
+  }
+
+  /* determine whether all leaders queued their directories */
+  rc = scr_storedesc_combine_rc(store, rc);
+
+  return rc;
+}
+
+/* hand specified directory from store to the background reclamation
+ * queue using the default leader */
+int scr_storedesc_dir_reap(const scr_storedesc* store, const char* dir)
+{
+  return scr_storedesc_dir_reap_shift(store, dir, 0);
+}
+
+/* apply any dataset-level sync policy for the store, called once
+ * after all files of a dataset have been written to it, a single
+ * file system sync by one process replaces a per-file fsync at
+ * every close for the RANGE and DATASET policies */
+int scr_storedesc_sync_dataset(const scr_storedesc* store)
+{
+  /* verify that we have a valid store descriptor */
+  if (store == NULL) {
+    return SCR_FAILURE;
+  }
+
+  /* return with failure if this store is disabled */
+  if (! store->enabled) {
+    return SCR_FAILURE;
+  }
+
+  /* only the RANGE and DATASET policies defer work to this point */
+  if (store->sync != SCR_SYNC_RANGE && store->sync != SCR_SYNC_DATASET) {
+    return SCR_SUCCESS;
+  }
+
+  /* barrier to ensure all procs have written their files
+   * before we sync the file system */
+  MPI_Barrier(store->comm);
+
+  /* leaders sync the file system holding their stripe of the store */
+  int rc = SCR_SUCCESS;
+  if (scr_storedesc_is_leader(store)) {
+    rc = scr_sync_fs(scr_storedesc_stripe_base(store));
+  }
+
+  /* determine whether all leaders synced their file systems */
+  rc = scr_storedesc_combine_rc(store, rc);
 
   return rc;
 }
@@ -339,18 +664,30 @@ int scr_storedescs_index_from_child_path(const char* path)
 
   /* search through the scr_storedescs looking for a match */
   int i;
-  for (i = 0; i < scr_nstoredescs; i++) {
+  for (i = 0; i < scr_nstoredescs && index == -1; i++) {
+    if (! scr_storedescs[i].enabled) {
+      continue;
+    }
+
     /* get length of path for this descriptor */
     int pathlen = strlen(scr_storedescs[i].name);
 
     /* see if prefix of path matches path for this descriptor */
-    if (scr_storedescs[i].enabled &&
-        strncmp(path, scr_storedescs[i].name, pathlen) == 0)
-    {
-      /* found a match, record its index, and break */
+    if (strncmp(path, scr_storedescs[i].name, pathlen) == 0) {
+      /* found a match, record its index */
       index = i;
       break;
     }
+
+    /* on a multi-path store, the path may sit on any of its stripes */
+    int j;
+    for (j = 0; j < scr_storedescs[i].paths; j++) {
+      pathlen = strlen(scr_storedescs[i].path_list[j]);
+      if (strncmp(path, scr_storedescs[i].path_list[j], pathlen) == 0) {
+        index = i;
+        break;
+      }
+    }
   }
 
   return index;
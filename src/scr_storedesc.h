@@ -47,7 +47,15 @@ typedef struct {
   int      index;     /* each descriptor is indexed starting from 0 */
   char*    name;      /* name of store */
   int      max_count; /* maximum number of datasets to be stored in device */
+  int      threads;   /* max flush worker threads per process for this store, 0 for no cap */
+  double   bw;        /* aggregate bandwidth limit in bytes/sec for this store, 0 for no limit */
   int      can_mkdir; /* flag indicating whether mkdir/rmdir work */
+  int      mem;       /* flag indicating store is memory-backed (tmpfs/ramfs/hugetlbfs) */
+  int      sync;      /* sync policy applied when SCR closes files it wrote to this store (see SCR_SYNC_*) */
+  int      direct;    /* flag indicating SCR should write data files to this store with O_DIRECT */
+  int      fanout;    /* number of hashed subdirs to spread node dirs across on global stores, 0 for flat layout */
+  int      paths;     /* number of stripe paths when store spans several devices, 0 for a single base */
+  char**   path_list; /* mount point of each stripe, NULL when paths is 0 */
   char*    type;      /* AXL xfer type string (bbapi, sync, pthread, etc..) */
   char*    view;      /* indicates whether store is node-local or global */
   MPI_Comm comm;      /* communicator of processes that can access storage */
@@ -61,12 +69,33 @@ Store descriptor functions
 =========================================
 */
 
+/* return the base path this process should use on the store,
+ * selects this rank's stripe on a multi-path store and falls back
+ * to the store name otherwise */
+const char* scr_storedesc_stripe_base(const scr_storedesc* s);
+
 /* create specified directory on store */
 int scr_storedesc_dir_create(const scr_storedesc* s, const char* dir);
 
+/* create a list of directories on store in one collective pass,
+ * directories must be ordered parent before child */
+int scr_storedesc_dirs_create(const scr_storedesc* s, int count, const char** dirs);
+
 /* delete specified directory on store */
 int scr_storedesc_dir_delete(const scr_storedesc* s, const char* dir);
 
+/* rename specified directory on store onto the background
+ * reclamation queue, which deletes its contents asynchronously */
+int scr_storedesc_dir_reap(const scr_storedesc* s, const char* dir);
+
+/* same as scr_storedesc_dir_reap, but rotates the leader by shift
+ * so reaping many directories spreads across processes */
+int scr_storedesc_dir_reap_shift(const scr_storedesc* s, const char* dir, int shift);
+
+/* apply any dataset-level sync policy for the store, called once
+ * after all files of a dataset have been written to it */
+int scr_storedesc_sync_dataset(const scr_storedesc* s);
+
 /*
 =========================================
 Routines that operate on scr_storedescs array
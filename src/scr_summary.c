@@ -453,6 +453,292 @@ int scr_summary_read(const spath* dir, kvtree* summary_hash)
   return SCR_SUCCESS;
 }
 
+/* number of ranks whose file lists are gathered into one rank2file
+ * part file, computed from the job size unless overridden */
+static int scr_summary_shard_size(int ranks)
+{
+  /* an explicit setting wins */
+  if (scr_rank2file_shard > 0) {
+    return scr_rank2file_shard;
+  }
+
+  /* otherwise pick the smallest power of two at or above sqrt(ranks),
+   * so the gather cost per writer and the number of part files both
+   * grow as the square root of the job size */
+  int shard = 1;
+  while (shard * shard < ranks) {
+    shard <<= 1;
+  }
+
+  /* cap entries per part file at the most scr_index is prepared
+   * to read back when rebuilding the map */
+  if (shard > 8192) {
+    shard = 8192;
+  }
+
+  return shard;
+}
+
+/* write binary rank-indexed rank2file map next to the kvtree map,
+ * leaders pack one record per shard member and write them with a
+ * fixed-stride index so a rank can seek straight to its record at
+ * fetch time, this is best effort since fetch falls back to the
+ * kvtree map when the binary map is missing or damaged */
+static int scr_summary_write_rank2file_bin(
+  const char* file,
+  const kvtree* entries,
+  int rank,
+  int ranks,
+  int shard,
+  MPI_Comm comm)
+{
+  int rc = SCR_SUCCESS;
+
+  /* the writer of our shard is the first rank in the shard */
+  int writer = rank - rank % shard;
+
+  /* records start after the header and the index */
+  uint64_t data_start = (uint64_t) SCR_RANK2FILE_BIN_HEADER_SIZE +
+    (uint64_t) ranks * SCR_RANK2FILE_BIN_ENTRY_SIZE;
+
+  /* leaders pack one record per member into a contiguous buffer */
+  int count = 0;
+  char* buf = NULL;
+  unsigned long* sizes = NULL;
+  unsigned long total = 0;
+  if (rank == writer) {
+    /* number of members in our shard */
+    count = shard;
+    if (writer + count > ranks) {
+      count = ranks - writer;
+    }
+
+    /* compute packed size of each member's record */
+    sizes = (unsigned long*) SCR_MALLOC(count * sizeof(unsigned long));
+    int i;
+    for (i = 0; i < count; i++) {
+      kvtree* rank_hash = kvtree_get_kv_int((kvtree*) entries, "RANK", writer + i);
+      sizes[i] = (unsigned long) kvtree_pack_size(rank_hash);
+      total += sizes[i];
+    }
+
+    /* pack the records back to back */
+    buf = (char*) SCR_MALLOC(total);
+    unsigned long pos = 0;
+    for (i = 0; i < count; i++) {
+      kvtree* rank_hash = kvtree_get_kv_int((kvtree*) entries, "RANK", writer + i);
+      kvtree_pack(buf + pos, rank_hash);
+      pos += sizes[i];
+    }
+  }
+
+  /* compute where our shard's records land within the data region,
+   * each rank contributes its shard total so leaders receive the sum
+   * over all preceding shards */
+  unsigned long region_start = 0;
+  MPI_Exscan(&total, &region_start, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm);
+  if (rank == 0) {
+    /* MPI_Exscan leaves the recv buffer undefined on rank 0 */
+    region_start = 0;
+  }
+
+  /* build name of binary map */
+  char binfile[SCR_MAX_FILENAME];
+  snprintf(binfile, sizeof(binfile), "%s.bin", file);
+
+  /* rank 0 creates the file and writes the header */
+  if (rank == 0) {
+    mode_t mode_file = scr_getmode(1, 1, 0);
+    int fd = scr_open(binfile, O_WRONLY | O_CREAT | O_TRUNC, mode_file);
+    if (fd >= 0) {
+      char header[SCR_RANK2FILE_BIN_HEADER_SIZE];
+      memcpy(header, SCR_RANK2FILE_BIN_MAGIC, SCR_RANK2FILE_BIN_MAGIC_SIZE);
+      uint64_t ranks64 = (uint64_t) ranks;
+      memcpy(header + SCR_RANK2FILE_BIN_MAGIC_SIZE, &ranks64, sizeof(uint64_t));
+      if (scr_write_attempt(binfile, fd, header, sizeof(header)) != sizeof(header)) {
+        rc = SCR_FAILURE;
+      }
+      scr_close(binfile, fd);
+    } else {
+      scr_err("Opening binary rank2file map for write: scr_open(%s) errno=%d %s @ %s:%d",
+        binfile, errno, strerror(errno), __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+  }
+
+  /* hold everyone until the file exists */
+  MPI_Barrier(comm);
+
+  /* leaders write the index entries for their members followed by
+   * the packed records, both land in disjoint regions so writers
+   * need no coordination */
+  if (rank == writer) {
+    int fd = scr_open(binfile, O_WRONLY);
+    if (fd >= 0) {
+      /* index entries hold the absolute offset and size of each record */
+      uint64_t* index = (uint64_t*) SCR_MALLOC(count * 2 * sizeof(uint64_t));
+      uint64_t offset = data_start + region_start;
+      int i;
+      for (i = 0; i < count; i++) {
+        index[2 * i + 0] = offset;
+        index[2 * i + 1] = (uint64_t) sizes[i];
+        offset += sizes[i];
+      }
+
+      /* write index entries for our members */
+      off_t index_pos = SCR_RANK2FILE_BIN_HEADER_SIZE +
+        (off_t) writer * SCR_RANK2FILE_BIN_ENTRY_SIZE;
+      size_t index_size = count * 2 * sizeof(uint64_t);
+      lseek(fd, index_pos, SEEK_SET);
+      if (scr_write_attempt(binfile, fd, index, index_size) != (ssize_t) index_size) {
+        rc = SCR_FAILURE;
+      }
+
+      /* write the packed records for our shard */
+      lseek(fd, (off_t) (data_start + region_start), SEEK_SET);
+      if (scr_write_attempt(binfile, fd, buf, total) != (ssize_t) total) {
+        rc = SCR_FAILURE;
+      }
+
+      scr_free(&index);
+      scr_close(binfile, fd);
+    } else {
+      scr_err("Opening binary rank2file map for write: scr_open(%s) errno=%d %s @ %s:%d",
+        binfile, errno, strerror(errno), __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+  }
+
+  scr_free(&buf);
+  scr_free(&sizes);
+
+  /* if any writer failed, remove the file so fetch cannot trip over
+   * a partial map, it will use the kvtree map instead */
+  if (! scr_alltrue(rc == SCR_SUCCESS, comm)) {
+    if (rank == 0) {
+      scr_file_unlink(binfile);
+    }
+    rc = SCR_FAILURE;
+  }
+
+  return rc;
+}
+
+/* write rank2file map for ranks in comm, each process passes the
+ * kvtree listing its own files, entries are sharded across part files
+ * whose count scales with the job size so the metadata commit does not
+ * serialize through a handful of fixed writers, the on-disk format
+ * matches what kvtree_read_scatter expects during fetch */
+int scr_summary_write_rank2file(const char* file, const kvtree* filelist, MPI_Comm comm)
+{
+  int rc = SCR_SUCCESS;
+
+  /* get our rank and the number of ranks in comm */
+  int rank, ranks;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &ranks);
+
+  /* number of ranks per part file, the writer of each shard is
+   * the first rank in the shard */
+  int shard = scr_summary_shard_size(ranks);
+  int writer = rank - rank % shard;
+
+  /* part file entries collected by shard leaders */
+  kvtree* entries = NULL;
+
+  if (rank != writer) {
+    /* send our file list to the writer of our shard */
+    kvtree* send_hash = kvtree_new();
+    kvtree* rank_hash = kvtree_set_kv_int(send_hash, "RANK", rank);
+    kvtree_merge(rank_hash, filelist);
+    kvtree_send(send_hash, writer, comm);
+    kvtree_delete(&send_hash);
+  } else {
+    /* we write the part file for our shard, collect an entry
+     * from each member */
+    entries = kvtree_new();
+    kvtree_set_kv_int(entries, "LEVEL", 0);
+
+    int count = 0;
+    int member;
+    for (member = writer; member < writer + shard && member < ranks; member++) {
+      if (member == rank) {
+        /* record our own files */
+        kvtree* rank_hash = kvtree_set_kv_int(entries, "RANK", member);
+        kvtree_merge(rank_hash, filelist);
+      } else {
+        /* receive files from this member */
+        kvtree* recv_hash = kvtree_new();
+        kvtree_recv(recv_hash, member, comm);
+        kvtree_merge(entries, recv_hash);
+        kvtree_delete(&recv_hash);
+      }
+      count++;
+    }
+
+    /* record the number of ranks in this part */
+    kvtree_set_kv_int(entries, "RANKS", count);
+
+    /* write our part file */
+    char partfile[SCR_MAX_FILENAME];
+    snprintf(partfile, sizeof(partfile), "%s.0.%d", file, writer);
+    if (kvtree_write_file(partfile, entries) != KVTREE_SUCCESS) {
+      scr_err("Failed to write rank2file part %s @ %s:%d",
+        partfile, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+  }
+
+  /* rank 0 writes the top level map, the shard layout is deterministic
+   * so no communication is needed to name the part files */
+  if (rank == 0) {
+    kvtree* files_hash = kvtree_new();
+    kvtree_set_kv_int(files_hash, "LEVEL", 1);
+
+    int start;
+    for (start = 0; start < ranks; start += shard) {
+      /* record file name of part relative to the map itself */
+      char partname[SCR_MAX_FILENAME];
+      snprintf(partname, sizeof(partname), ".0.%d", start);
+      unsigned long offset = 0;
+      kvtree* files_rank_hash = kvtree_set_kv_int(files_hash, "RANK", start);
+      kvtree_util_set_str(files_rank_hash, "FILE", partname);
+      kvtree_util_set_bytecount(files_rank_hash, "OFFSET", offset);
+    }
+
+    /* record total number of ranks in the job */
+    kvtree_set_kv_int(files_hash, "RANKS", ranks);
+
+    /* write out the top level map */
+    if (kvtree_write_file(file, files_hash) != KVTREE_SUCCESS) {
+      scr_err("Failed to write rank2file map %s @ %s:%d",
+        file, __FILE__, __LINE__
+      );
+      rc = SCR_FAILURE;
+    }
+
+    kvtree_delete(&files_hash);
+  }
+
+  /* also write the binary rank-indexed map, fetch prefers it since
+   * each rank can seek straight to its record, failure here is not
+   * fatal because fetch falls back to the kvtree map */
+  scr_summary_write_rank2file_bin(file, entries, rank, ranks, shard, comm);
+
+  /* done with our shard entries */
+  kvtree_delete(&entries);
+
+  /* determine whether all parts of the map made it to disk */
+  if (! scr_alltrue(rc == SCR_SUCCESS, comm)) {
+    rc = SCR_FAILURE;
+  }
+
+  return rc;
+}
+
 /* write out the summary file to dir */
 int scr_summary_write(const spath* dir, const scr_dataset* dataset, int all_complete, kvtree* data)
 {
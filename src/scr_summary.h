@@ -12,11 +12,29 @@
 #ifndef SCR_SUMMARY_H
 #define SCR_SUMMARY_H
 
+#include "mpi.h"
+
 #include "spath.h"
 #include "kvtree.h"
 #include "scr_dataset.h"
 
+/* binary rank2file map written alongside the kvtree map, a fixed
+ * stride rank index lets each rank seek directly to its record at
+ * fetch time, layout is an 8-byte magic string and an 8-byte rank
+ * count, then one (offset, size) pair per rank, then packed kvtree
+ * records */
+#define SCR_RANK2FILE_BIN_MAGIC "SCRR2F01"
+#define SCR_RANK2FILE_BIN_MAGIC_SIZE (8)
+#define SCR_RANK2FILE_BIN_HEADER_SIZE (16)
+#define SCR_RANK2FILE_BIN_ENTRY_SIZE (16)
+
 /* read in the summary file from dir */
 int scr_summary_read(const spath* dir, kvtree* summary_hash);
 
+/* write rank2file map for ranks in comm, each process passes the
+ * kvtree listing its own files, entries are sharded across part files
+ * whose count scales with the job size, the on-disk format matches
+ * what kvtree_read_scatter expects during fetch */
+int scr_summary_write_rank2file(const char* file, const kvtree* filelist, MPI_Comm comm);
+
 #endif
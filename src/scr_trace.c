@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Utility to merge binary trace rings written under SCR_TRACE and
+ * render them as a timeline in the chrome://tracing JSON format.
+ * Each rank's ring becomes one thread row, so slow ranks that
+ * stretch a collective phase stand out as long bars next to the
+ * short ones of their peers.  Load the output in chrome://tracing
+ * or any viewer that accepts the trace event format. */
+
+#include "scr.h"
+#include "scr_stats.h"
+#include "scr_trace_api.h"
+#include "scr_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+
+/* names for phase records, indexed by scr_stats_phase */
+static const char* scr_trace_phase_names[] = {
+  "checkpoint",
+  "output",
+  "flush",
+  "fetch",
+  "lock",
+};
+
+static void print_usage(void)
+{
+  printf("\n");
+  printf("Usage: scr_trace [options] <trace file> ...\n");
+  printf("\n");
+  printf("  Merges binary trace rings written under SCR_TRACE,\n");
+  printf("  e.g. scr_trace /path/to/cntl/trace.*.scr > timeline.json\n");
+  printf("\n");
+  printf("  Options:\n");
+  printf("    -o, --output <file>  Write timeline to file (default stdout)\n");
+  printf("    -h, --help           Print usage\n");
+  printf("\n");
+}
+
+/* emit the events of one ring, returns 0 on success */
+static int dump_ring(const char* file, FILE* out, int* first)
+{
+  scr_trace_header hdr;
+  scr_trace_record* records = NULL;
+  uint64_t nrecords = 0;
+  if (scr_trace_read(file, &hdr, &records, &nrecords) != SCR_SUCCESS) {
+    return 1;
+  }
+
+  uint64_t i;
+  for (i = 0; i < nrecords; i++) {
+    scr_trace_record* r = &records[i];
+
+    /* the comma comes before each event after the first so the
+     * array stays valid however many rings we append */
+    if (! *first) {
+      fprintf(out, ",\n");
+    }
+    *first = 0;
+
+    if (r->kind == SCR_TRACE_KIND_PHASE) {
+      /* phase records carry an end time and a duration, tracing
+       * wants a start timestamp, both in microseconds */
+      const char* name = "phase";
+      if (r->phase < sizeof(scr_trace_phase_names) / sizeof(scr_trace_phase_names[0])) {
+        name = scr_trace_phase_names[r->phase];
+      }
+      fprintf(out,
+        "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+        name, (r->time - r->secs) * 1000000.0, r->secs * 1000000.0, hdr.rank
+      );
+    } else if (r->kind == SCR_TRACE_KIND_BYTES) {
+      /* byte tallies become instant events carrying their totals */
+      fprintf(out,
+        "{\"name\":\"bytes\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,"
+        "\"args\":{\"bytes\":%llu,\"files\":%u}}",
+        r->time * 1000000.0, hdr.rank,
+        (unsigned long long) r->bytes, r->count
+      );
+    } else {
+      /* unknown record kind, emit a placeholder so nothing is lost */
+      fprintf(out,
+        "{\"name\":\"unknown\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}",
+        r->time * 1000000.0, hdr.rank
+      );
+    }
+  }
+
+  scr_free(&records);
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  int rc = 0;
+
+  static const char *opt_string = "o:h";
+  static struct option long_options[] = {
+    {"output",  required_argument, NULL, 'o'},
+    {"help",    no_argument,       NULL, 'h'},
+    {NULL,      no_argument,       NULL,   0}
+  };
+
+  int usage = 0;
+  char* output = NULL;
+
+  int long_index = 0;
+  while (1) {
+    char c = getopt_long(argc, argv, opt_string, long_options, &long_index);
+    if (c == -1) {
+      break;
+    }
+
+    switch(c) {
+      case 'o':
+        output = strdup(optarg);
+        break;
+      case 'h':
+        usage = 1;
+        break;
+      default:
+        printf("ERROR: Unknown option: `%s'\n", argv[optind]);
+        usage = 1;
+        rc = 1;
+        break;
+    }
+  }
+
+  /* check that we were given at least one trace file */
+  int numargs = argc - optind;
+  if (!usage && numargs < 1) {
+    printf("ERROR: Missing trace file name\n");
+    usage = 1;
+    rc = 1;
+  }
+
+  if (usage) {
+    print_usage();
+    free(output);
+    return rc;
+  }
+
+  /* open the output file if one was named */
+  FILE* out = stdout;
+  if (output != NULL) {
+    out = fopen(output, "w");
+    if (out == NULL) {
+      printf("ERROR: Failed to open output file: `%s'\n", output);
+      free(output);
+      return 1;
+    }
+  }
+
+  /* merge the rings into one event array */
+  fprintf(out, "[\n");
+  int first = 1;
+  int i;
+  for (i = optind; i < argc; i++) {
+    if (dump_ring(argv[i], out, &first) != 0) {
+      rc = 1;
+    }
+  }
+  fprintf(out, "\n]\n");
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  free(output);
+
+  return rc;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+/* Binary event trace ring, see scr_trace_api.h for the format */
+
+#include "scr_conf.h"
+#include "scr.h"
+#include "scr_err.h"
+#include "scr_io.h"
+#include "scr_util.h"
+#include "scr_trace_api.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+/* state of the open ring, one per process */
+static void* scr_trace_map = NULL;            /* mapping of the ring file */
+static size_t scr_trace_map_size = 0;         /* size of the mapping in bytes */
+static scr_trace_header* scr_trace_hdr = NULL; /* header within the mapping */
+static scr_trace_record* scr_trace_recs = NULL; /* record slots within the mapping */
+static pthread_mutex_t scr_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* seconds since the epoch with sub-second resolution */
+static double scr_trace_now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
+
+/* create the ring file and map it */
+int scr_trace_open(const char* file, int rank, unsigned long slots)
+{
+  if (scr_trace_map != NULL) {
+    return SCR_FAILURE;
+  }
+
+  if (slots == 0) {
+    slots = SCR_TRACE_SLOTS;
+  }
+
+  /* size and create the file */
+  size_t size = sizeof(scr_trace_header) + (size_t) slots * sizeof(scr_trace_record);
+  mode_t mode_file = scr_getmode(1, 1, 0);
+  int fd = scr_open(file, O_RDWR | O_CREAT | O_TRUNC, mode_file);
+  if (fd < 0) {
+    scr_err("Opening trace ring for write: scr_open(%s) errno=%d %s @ %s:%d",
+      file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+  if (ftruncate(fd, (off_t) size) != 0) {
+    scr_err("Sizing trace ring: ftruncate(%s) errno=%d %s @ %s:%d",
+      file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    scr_close(file, fd);
+    return SCR_FAILURE;
+  }
+
+  /* map it, the file descriptor is not needed once mapped */
+  void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  scr_close_nofsync(file, fd);
+  if (map == MAP_FAILED) {
+    scr_err("Mapping trace ring: mmap(%s) errno=%d %s @ %s:%d",
+      file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  scr_trace_map      = map;
+  scr_trace_map_size = size;
+  scr_trace_hdr      = (scr_trace_header*) map;
+  scr_trace_recs     = (scr_trace_record*) ((char*) map + sizeof(scr_trace_header));
+
+  /* fill in the header */
+  memcpy(scr_trace_hdr->magic, SCR_TRACE_MAGIC, SCR_TRACE_MAGIC_SIZE);
+  scr_trace_hdr->version = SCR_TRACE_VERSION;
+  scr_trace_hdr->rank    = (uint32_t) rank;
+  scr_trace_hdr->slots   = (uint64_t) slots;
+  scr_trace_hdr->next    = 0;
+
+  return SCR_SUCCESS;
+}
+
+/* returns 1 when a ring is open */
+int scr_trace_active(void)
+{
+  return (scr_trace_map != NULL);
+}
+
+/* append a record to the ring */
+void scr_trace_emit(int kind, int phase, double secs, unsigned long bytes, int count)
+{
+  if (scr_trace_map == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&scr_trace_mutex);
+  scr_trace_record* r = &scr_trace_recs[scr_trace_hdr->next % scr_trace_hdr->slots];
+  r->time  = scr_trace_now();
+  r->secs  = secs;
+  r->bytes = (uint64_t) bytes;
+  r->count = (uint32_t) count;
+  r->kind  = (uint16_t) kind;
+  r->phase = (uint16_t) phase;
+  scr_trace_hdr->next++;
+  pthread_mutex_unlock(&scr_trace_mutex);
+}
+
+/* flush the header and unmap the ring */
+void scr_trace_close(void)
+{
+  if (scr_trace_map == NULL) {
+    return;
+  }
+  msync(scr_trace_map, scr_trace_map_size, MS_SYNC);
+  munmap(scr_trace_map, scr_trace_map_size);
+  scr_trace_map      = NULL;
+  scr_trace_map_size = 0;
+  scr_trace_hdr      = NULL;
+  scr_trace_recs     = NULL;
+}
+
+/* read a ring file and return its records oldest-first */
+int scr_trace_read(const char* file, scr_trace_header* hdr, scr_trace_record** records, uint64_t* nrecords)
+{
+  *records  = NULL;
+  *nrecords = 0;
+
+  int fd = scr_open(file, O_RDONLY);
+  if (fd < 0) {
+    scr_err("Opening trace ring for read: scr_open(%s) errno=%d %s @ %s:%d",
+      file, errno, strerror(errno), __FILE__, __LINE__
+    );
+    return SCR_FAILURE;
+  }
+
+  /* read and check the header */
+  if (scr_read_attempt(file, fd, hdr, sizeof(scr_trace_header)) != sizeof(scr_trace_header) ||
+      memcmp(hdr->magic, SCR_TRACE_MAGIC, SCR_TRACE_MAGIC_SIZE) != 0 ||
+      hdr->version != SCR_TRACE_VERSION)
+  {
+    scr_err("File `%s' is not a trace ring @ %s:%d",
+      file, __FILE__, __LINE__
+    );
+    scr_close(file, fd);
+    return SCR_FAILURE;
+  }
+
+  /* read the record slots */
+  size_t slots_size = (size_t) hdr->slots * sizeof(scr_trace_record);
+  scr_trace_record* slots = (scr_trace_record*) SCR_MALLOC(slots_size);
+  if (scr_read_attempt(file, fd, slots, slots_size) != (ssize_t) slots_size) {
+    scr_free(&slots);
+    scr_close(file, fd);
+    return SCR_FAILURE;
+  }
+  scr_close_nofsync(file, fd);
+
+  /* count the live records, the ring holds the most recent
+   * hdr->slots records once it has wrapped */
+  uint64_t n = hdr->next;
+  if (n <= hdr->slots) {
+    /* never wrapped, records run from slot 0 in order */
+    *records  = slots;
+    *nrecords = n;
+    return SCR_SUCCESS;
+  }
+
+  /* wrapped, rotate so the oldest record comes first */
+  n = hdr->slots;
+  scr_trace_record* out = (scr_trace_record*) SCR_MALLOC(n * sizeof(scr_trace_record));
+  uint64_t start = hdr->next % hdr->slots;
+  uint64_t i;
+  for (i = 0; i < n; i++) {
+    out[i] = slots[(start + i) % hdr->slots];
+  }
+  scr_free(&slots);
+
+  *records  = out;
+  *nrecords = n;
+  return SCR_SUCCESS;
+}
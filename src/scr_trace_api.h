@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2009, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Adam Moody <moody20@llnl.gov>.
+ * LLNL-CODE-411039.
+ * All rights reserved.
+ * This file is part of The Scalable Checkpoint / Restart (SCR) library.
+ * For details, see https://sourceforge.net/projects/scalablecr/
+ * Please also read this file: LICENSE.TXT.
+*/
+
+#ifndef SCR_TRACE_API_H
+#define SCR_TRACE_API_H
+
+#include <stdint.h>
+
+/* Binary event trace (see SCR_TRACE).  Each process appends
+ * fixed-size records to an mmap'd ring file in its node-local
+ * control directory, so emitting a record costs a couple of memory
+ * stores rather than a formatted write to the text log.  The ring
+ * wraps once full, keeping the most recent records.  The scr_trace
+ * tool merges rings from all ranks and renders a timeline. */
+
+#define SCR_TRACE_MAGIC      ("SCRTRACE")
+#define SCR_TRACE_MAGIC_SIZE (8)
+#define SCR_TRACE_VERSION    (1)
+
+/* default number of record slots in a ring */
+#define SCR_TRACE_SLOTS (65536)
+
+/* record kinds */
+#define SCR_TRACE_KIND_PHASE (1) /* a completed phase, phase field holds a scr_stats_phase id */
+#define SCR_TRACE_KIND_BYTES (2) /* bytes and files moved to or from a store */
+
+typedef struct {
+  char magic[SCR_TRACE_MAGIC_SIZE]; /* identifies the file as a trace ring */
+  uint32_t version;                 /* format version */
+  uint32_t rank;                    /* rank that wrote this ring */
+  uint64_t slots;                   /* number of record slots in the ring */
+  uint64_t next;                    /* records written so far, next % slots is the write slot */
+} scr_trace_header;
+
+typedef struct {
+  double   time;  /* end time of the event, seconds since the epoch */
+  double   secs;  /* duration of the event in seconds */
+  uint64_t bytes; /* bytes moved, zero when not applicable */
+  uint32_t count; /* file count for byte records */
+  uint16_t kind;  /* record kind */
+  uint16_t phase; /* phase id for phase records */
+} scr_trace_record;
+
+/* create the ring file and map it, rank is recorded in the header
+ * and slots sets the ring capacity, pass 0 for the default */
+int scr_trace_open(const char* file, int rank, unsigned long slots);
+
+/* returns 1 when a ring is open and records are being collected */
+int scr_trace_active(void);
+
+/* append a record to the ring, a no-op when no ring is open,
+ * thread-safe so background threads may emit records */
+void scr_trace_emit(int kind, int phase, double secs, unsigned long bytes, int count);
+
+/* flush the header and unmap the ring */
+void scr_trace_close(void);
+
+/* read a ring file, fills in hdr and returns a newly allocated
+ * record array in oldest-first order, the caller frees records */
+int scr_trace_read(const char* file, scr_trace_header* hdr, scr_trace_record** records, uint64_t* nrecords);
+
+#endif
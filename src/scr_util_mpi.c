@@ -205,6 +205,16 @@ int scr_alltrue(int flag, MPI_Comm comm)
   return all_true;
 }
 
+/* element-wise version of scr_alltrue, sets results[i] to true
+ * if flags[i] on each process in comm is true, packing several
+ * independent conditions into a single allreduce rather than
+ * paying for one collective per condition */
+int scr_alltrue_multi(const int* flags, int* results, int count, MPI_Comm comm)
+{
+  MPI_Allreduce((void*)flags, results, count, MPI_INT, MPI_LAND, comm);
+  return SCR_SUCCESS;
+}
+
 void scr_allabort(const char* file, int line, int code, const char* format, ...)
 {
   /* have rank 0 print the message and call abort */
@@ -20,6 +20,15 @@ Functions to send/recv strings
 =========================================
 */
 
+/* sends a NUL-terminated string to a process,
+ * which may be MPI_PROC_NULL */
+int scr_str_send(const char* str, int rank, MPI_Comm comm);
+
+/* recieves a NUL-terminated string from a process,
+ * and returns pointer to newly allocated string,
+ * returns NULL if rank is MPI_PROC_NULL */
+int scr_str_recv(char** str, int rank, MPI_Comm comm);
+
 /* sends a NUL-terminated string to a process,
  * allocates space and recieves a NUL-terminated string from a process,
  * can specify MPI_PROC_NULL as either send or recv rank */
@@ -47,6 +56,11 @@ MPI utility functions
 /* returns true (non-zero) if flag on each process in comm is true */
 int scr_alltrue(int flag, MPI_Comm comm);
 
+/* element-wise version of scr_alltrue, sets results[i] to true
+ * if flags[i] on each process in comm is true, use this to check
+ * several independent conditions with a single collective */
+int scr_alltrue_multi(const int* flags, int* results, int count, MPI_Comm comm);
+
 /* rank 0 prints a message and calls MPI_Abort, while others wait in a barrier */
 #define SCR_ALLABORT(X, ...)  \
     do { scr_allabort(__FILE__, __LINE__, X, __VA_ARGS__); } while (0)
@@ -54,6 +54,10 @@ typedef int SCR_Fint;
 # define FORTRAN_API
 #endif
 
+/* batched route calls up to this many files convert their strings in
+ * stack buffers rather than allocating from the heap */
+#define SCRF_ROUTE_STACK_FILES (16)
+
 /* convert a Fortran string to a C string, removing any trailing spaces and terminating with a NULL */
 static int scr_fstr2cstr(const char* fstr, int flen, char* cstr, int clen)
 {
@@ -146,6 +150,12 @@ FORTRAN_API void FORT_CALL scr_should_exit_(int* flag, int* ierror)
   return;
 }
 
+FORTRAN_API void FORT_CALL scr_flush_progress_(double* bytes_transferred, double* bytes_total, double* secs_remaining, int* ierror)
+{
+  *ierror = SCR_Flush_progress(bytes_transferred, bytes_total, secs_remaining);
+  return;
+}
+
 /*================================================
  * Programmatically change configuration options
  *================================================*/
@@ -279,6 +289,21 @@ FORTRAN_API void FORT_CALL scr_complete_output_(int* valid, int* ierror)
   return;
 }
 
+FORTRAN_API void FORT_CALL scr_complete_output_begin_(int* valid, int* ierror)
+{
+  int valid_tmp = *valid;
+  *ierror = SCR_Complete_output_begin(valid_tmp);
+  return;
+}
+
+FORTRAN_API void FORT_CALL scr_complete_output_test_(int* done, int* ierror)
+{
+  int done_tmp = 0;
+  *ierror = SCR_Complete_output_test(&done_tmp);
+  *done = done_tmp;
+  return;
+}
+
 /*================================================
  * Route file
  *================================================*/
@@ -307,6 +332,131 @@ FORTRAN_API void FORT_CALL scr_route_file_(char* name FORT_MIXED_LEN(name_len),
   return;
 }
 
+FORTRAN_API void FORT_CALL scr_route_files_(int* num,
+                                            char* names FORT_MIXED_LEN(names_len),
+                                            char* files FORT_MIXED_LEN(files_len),
+                                            int* ierror FORT_END_LEN(names_len) FORT_END_LEN(files_len))
+{
+  int i;
+  int n = *num;
+  if (n < 0) {
+    *ierror = !SCR_SUCCESS;
+    return;
+  }
+  if (n == 0) {
+    *ierror = SCR_SUCCESS;
+    return;
+  }
+
+  /* C string buffers and pointer lists for the file names,
+   * the Fortran arrays hold one fixed-length string per file,
+   * small batches use these stack buffers so this per-checkpoint
+   * path does not touch the heap, larger batches fall back to malloc */
+  char stack_name_buf[SCRF_ROUTE_STACK_FILES * SCR_MAX_FILENAME];
+  char stack_file_buf[SCRF_ROUTE_STACK_FILES * SCR_MAX_FILENAME];
+  char* stack_name_ptr[SCRF_ROUTE_STACK_FILES];
+  char* stack_file_ptr[SCRF_ROUTE_STACK_FILES];
+
+  char* name_buf;
+  char* file_buf;
+  char** name_ptr;
+  char** file_ptr;
+  int heap = (n > SCRF_ROUTE_STACK_FILES);
+  if (heap) {
+    name_buf = (char*) malloc(n * SCR_MAX_FILENAME);
+    file_buf = (char*) malloc(n * SCR_MAX_FILENAME);
+    name_ptr = (char**) malloc(n * sizeof(char*));
+    file_ptr = (char**) malloc(n * sizeof(char*));
+    if (name_buf == NULL || file_buf == NULL || name_ptr == NULL || file_ptr == NULL) {
+      free(name_buf);
+      free(file_buf);
+      free(name_ptr);
+      free(file_ptr);
+      *ierror = !SCR_SUCCESS;
+      return;
+    }
+  } else {
+    name_buf = stack_name_buf;
+    file_buf = stack_file_buf;
+    name_ptr = stack_name_ptr;
+    file_ptr = stack_file_ptr;
+  }
+
+  /* convert each filename from a Fortran string to C string */
+  for (i = 0; i < n; i++) {
+    name_ptr[i] = name_buf + i * SCR_MAX_FILENAME;
+    file_ptr[i] = file_buf + i * SCR_MAX_FILENAME;
+    if (scr_fstr2cstr(names + i * names_len, names_len, name_ptr[i], SCR_MAX_FILENAME) != 0) {
+      if (heap) {
+        free(name_buf);
+        free(file_buf);
+        free(name_ptr);
+        free(file_ptr);
+      }
+      *ierror = !SCR_SUCCESS;
+      return;
+    }
+  }
+
+  /* get the filenames to use */
+  *ierror = SCR_Route_files(n, (const char**) name_ptr, file_ptr);
+
+  /* convert each filename from C to Fortran string */
+  for (i = 0; i < n; i++) {
+    if (scr_cstr2fstr(file_ptr[i], files + i * files_len, files_len) != 0) {
+      *ierror = !SCR_SUCCESS;
+      break;
+    }
+  }
+
+  if (heap) {
+    free(name_buf);
+    free(file_buf);
+    free(name_ptr);
+    free(file_ptr);
+  }
+
+  return;
+}
+
+/*================================================
+ * Streaming write
+ *================================================*/
+
+FORTRAN_API void FORT_CALL scr_open_(char* name FORT_MIXED_LEN(name_len), int* fh, int* ierror FORT_END_LEN(name_len))
+{
+  /* convert name from a Fortran string to C string */
+  char name_tmp[SCR_MAX_FILENAME];
+  if (scr_fstr2cstr(name, name_len, name_tmp, sizeof(name_tmp)) != 0) {
+    *ierror = !SCR_SUCCESS;
+    return;
+  }
+
+  int fh_tmp = -1;
+  *ierror = SCR_Open(name_tmp, &fh_tmp);
+  *fh = fh_tmp;
+
+  return;
+}
+
+FORTRAN_API void FORT_CALL scr_write_(int* fh, void* buf, int* size, int* ierror)
+{
+  int fh_tmp = *fh;
+  if (*size < 0) {
+    *ierror = !SCR_SUCCESS;
+    return;
+  }
+  *ierror = SCR_Write(fh_tmp, buf, (unsigned long) *size);
+  return;
+}
+
+FORTRAN_API void FORT_CALL scr_close_(int* fh, int* ierror)
+{
+  int fh_tmp = *fh;
+  *ierror = SCR_Close(fh_tmp);
+  return;
+}
+
 /*================================================
  * Dataset management
  *================================================*/